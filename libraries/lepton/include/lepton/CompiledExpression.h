@@ -55,7 +55,9 @@ class ParsedExpression;
  * it many times as quickly as possible.  You should treat it as an opaque object; none of the internal representation
  * is visible.
  * 
- * A CompiledExpression is created by calling createCompiledExpression() on a ParsedExpression.
+ * A CompiledExpression is created by calling createCompiledExpression() on a ParsedExpression.  It may
+ * also be created from several ParsedExpressions, in which case evaluate() computes all of them at once
+ * and shares any subexpressions they have in common.
  * 
  * WARNING: CompiledExpression is NOT thread safe.  You should never access a CompiledExpression from two threads at
  * the same time.
@@ -84,17 +86,50 @@ public:
     void setVariableLocations(std::map<std::string, double*>& variableLocations);
     /**
      * Evaluate the expression.  The values of all variables should have been set before calling this.
+     * If this object was created from multiple expressions, all of them are evaluated and the value of
+     * the first one is returned.
      */
     double evaluate() const;
+    /**
+     * Get the number of expressions that are computed by evaluate().
+     */
+    int getNumValues() const;
+    /**
+     * Get the value of one of the expressions, as computed by the most recent call to evaluate().
+     *
+     * @param index    the index of the expression, in the order they were specified when this object was created
+     */
+    double getValue(int index) const;
+    /**
+     * Evaluate the expression at many points at once.  The variables are given in structure-of-arrays form:
+     * each one is an array holding its value at every point.  This is equivalent to setting the variables and
+     * calling evaluate() once for each point, but avoids the overhead of doing it from the calling code.
+     * Variables that are not included in the map keep their current values, so anything that is the same at
+     * every point (such as global parameters) can be set with getVariableReference() or setVariableLocations()
+     * as usual.  Variables in the map that the expression does not depend on are ignored.
+     *
+     * The values of the variables in the map are stored in the same places evaluate() reads them from.  If
+     * setVariableLocations() was used to put a variable in memory owned by the caller, that memory is
+     * overwritten, and on exit it holds the variable's value at the last point.
+     *
+     * @param numPoints    the number of points at which to evaluate the expression
+     * @param variables    a map from variable names to arrays of length numPoints containing their values
+     * @param results      an array of length numPoints for each expression, in the same order as getValue().
+     *                     On exit, results[i][j] is the value of expression i at point j.  This may contain
+     *                     fewer than getNumValues() elements, and any element may be NULL if that value is not needed.
+     */
+    void evaluate(int numPoints, const std::map<std::string, const double*>& variables, const std::vector<double*>& results) const;
 private:
     friend class ParsedExpression;
     CompiledExpression(const ParsedExpression& expression);
+    CompiledExpression(const std::vector<ParsedExpression>& expressions);
     void compileExpression(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
     int findTempIndex(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
     std::map<std::string, double*> variablePointers;
     std::vector<std::pair<double*, double*> > variablesToCopy;
     std::vector<std::vector<int> > arguments;
     std::vector<int> target;
+    std::vector<int> outputIndex;
     std::vector<Operation*> operation;
     std::map<std::string, int> variableIndices;
     std::set<std::string> variableNames;
@@ -59,7 +59,8 @@ class ParsedExpression;
  * You should treat it as an opaque object; none of the internal representation is visible.
  * 
  * A CompiledVectorExpression is created by calling createCompiledVectorExpression() on a ParsedExpression.  When you create
- * it, you must specify the width of the vectors on which to compute the expression.  The allowed widths depend on the type of
+ * it, you must specify the width of the vectors on which to compute the expression.  It may also be created from several
+ * ParsedExpressions, in which case evaluate() computes all of them at once and shares any subexpressions they have in common.  The allowed widths depend on the type of
  * CPU it is running on.  4 is always allowed, and 8 is allowed on x86 processors with AVX.  Call getAllowedWidths() to query
  * the allowed values.
  * 
@@ -98,10 +99,42 @@ public:
     void setVariableLocations(std::map<std::string, float*>& variableLocations);
     /**
      * Evaluate the expression.  The values of all variables should have been set before calling this.
+     * If this object was created from multiple expressions, all of them are evaluated and the values of
+     * the first one are returned.
      * 
      * @return a pointer to N floating point values, where N is the vector width
      */
     const float* evaluate() const;
+    /**
+     * Get the number of expressions that are computed by evaluate().
+     */
+    int getNumValues() const;
+    /**
+     * Get the values of one of the expressions, as computed by the most recent call to evaluate().
+     *
+     * @param index    the index of the expression, in the order they were specified when this object was created
+     * @return a pointer to N floating point values, where N is the vector width
+     */
+    const float* getValue(int index) const;
+    /**
+     * Evaluate the expression at an arbitrary number of points.  The variables are given in structure-of-arrays
+     * form: each one is an array holding its value at every point.  The points are processed N at a time, where
+     * N is the vector width, and the last block is padded if numPoints is not a multiple of N.  Variables that
+     * are not included in the map keep their current values in every lane, so anything that is the same at every
+     * point (such as global parameters) can be set with getVariablePointer() or setVariableLocations() as usual.
+     * Variables in the map that the expression does not depend on are ignored.
+     *
+     * The values of the variables in the map are stored in the same places evaluate() reads them from.  If
+     * setVariableLocations() was used to put a variable in memory owned by the caller, that memory is
+     * overwritten, and on exit it holds the variable's values for the last block of points.
+     *
+     * @param numPoints    the number of points at which to evaluate the expression
+     * @param variables    a map from variable names to arrays of length numPoints containing their values
+     * @param results      an array of length numPoints for each expression, in the same order as getValue().
+     *                     On exit, results[i][j] is the value of expression i at point j.  This may contain
+     *                     fewer than getNumValues() elements, and any element may be NULL if that value is not needed.
+     */
+    void evaluate(int numPoints, const std::map<std::string, const float*>& variables, const std::vector<float*>& results) const;
     /**
      * Get the list of vector widths that are supported on the current processor.
      */
@@ -109,6 +142,7 @@ public:
 private:
     friend class ParsedExpression;
     CompiledVectorExpression(const ParsedExpression& expression, int width);
+    CompiledVectorExpression(const std::vector<ParsedExpression>& expressions, int width);
     void compileExpression(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps, int& workspaceSize);
     int findTempIndex(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
     int width;
@@ -116,6 +150,7 @@ private:
     std::vector<std::pair<float*, float*> > variablesToCopy;
     std::vector<std::vector<int> > arguments;
     std::vector<int> target;
+    std::vector<int> outputIndex;
     std::vector<Operation*> operation;
     std::map<std::string, int> variableIndices;
     std::set<std::string> variableNames;
@@ -129,11 +164,25 @@ private:
 #if defined(__ARM__) || defined(__ARM64__)
     void generateSingleArgCall(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, float (*function)(float));
     void generateTwoArgCall(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg1, asmjit::arm::Vec& arg2, float (*function)(float, float));
+    void generateExp(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, asmjit::arm::Gp& table);
+    void generateLog(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, asmjit::arm::Gp& table);
+    void generatePow(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& base, asmjit::arm::Vec& exponent, asmjit::arm::Gp& table);
+    void generateSinCos(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, asmjit::arm::Gp& table, bool cosine);
+    void generateAtan(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, asmjit::arm::Gp& table);
+    void generateErfc(asmjit::a64::Compiler& c, asmjit::arm::Vec& dest, asmjit::arm::Vec& arg, asmjit::arm::Gp& table);
 #else
     void generateSingleArgCall(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, float (*function)(float));
     void generateTwoArgCall(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg1, asmjit::x86::Ymm& arg2, float (*function)(float, float));
+    void generateExp(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, asmjit::x86::Gp& table);
+    void generateLog(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, asmjit::x86::Gp& table);
+    void generatePow(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& base, asmjit::x86::Ymm& exponent, asmjit::x86::Gp& table);
+    void generateSinCos(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, asmjit::x86::Gp& table, bool cosine);
+    void generateAtan(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, asmjit::x86::Gp& table);
+    void generateErfc(asmjit::x86::Compiler& c, asmjit::x86::Ymm& dest, asmjit::x86::Ymm& arg, asmjit::x86::Gp& table);
+    bool generateSpline(asmjit::x86::Compiler& c, const Operation& op, asmjit::x86::Ymm& dest, std::vector<asmjit::x86::Ymm>& args);
 #endif
     std::vector<float> constants;
+    std::vector<std::vector<float> > splineData;
     asmjit::JitRuntime runtime;
 #endif
 };
@@ -31,9 +31,46 @@
  * -------------------------------------------------------------------------- */
 
 #include "windowsIncludes.h"
+#include <vector>
 
 namespace Lepton {
 
+/**
+ * This class describes a function of one or two variables that is represented as a piecewise cubic
+ * polynomial on a uniform grid.  A CustomFunction that can be described this way may return one from
+ * getUniformSpline().  This lets CompiledVectorExpression evaluate it with vectorized code instead of
+ * calling evaluate() separately for every argument.
+ */
+
+class LEPTON_EXPORT UniformSpline {
+public:
+    UniformSpline() : dimensions(0), periodic(false) {
+    }
+    /**
+     * The number of arguments the function takes (1 or 2)
+     */
+    int dimensions;
+    /**
+     * The number of grid cells along each axis
+     */
+    int size[2];
+    /**
+     * The lower and upper bounds of the grid along each axis
+     */
+    double min[2], max[2];
+    /**
+     * If true, arguments are wrapped into the range covered by the grid.  If false, the function
+     * is 0 outside the grid.
+     */
+    bool periodic;
+    /**
+     * The polynomial coefficients for each grid cell, ordered with the first index varying fastest.
+     * Each cell has 4^dimensions coefficients.  Coefficient i+4*j multiplies t^i*u^j, where t and u
+     * are the fractional positions (between 0 and 1) of the point within the cell along the two axes.
+     */
+    std::vector<double> coefficients;
+};
+
 /**
  * This class is the interface for defining your own function that may be included in expressions.
  * To use it, create a concrete subclass that implements all of the virtual methods for each new function
@@ -68,6 +105,19 @@ public:
      * Create a new duplicate of this object on the heap using the "new" operator.
      */
     virtual CustomFunction* clone() const = 0;
+    /**
+     * Get a representation of this function, or one of its derivatives, as a piecewise cubic
+     * polynomial on a uniform grid.  The default implementation returns false, indicating that
+     * no such representation is available.
+     *
+     * @param derivOrder   an array specifying the derivative to represent, in the same format as for
+     *                     evaluateDerivative().  All elements are 0 for the value of the function itself.
+     * @param spline       on exit, the representation of the function
+     * @return true if the function could be represented, false otherwise
+     */
+    virtual bool getUniformSpline(const int* derivOrder, UniformSpline& spline) const {
+        return false;
+    }
 };
 
 /**
@@ -31,7 +31,9 @@
  * -------------------------------------------------------------------------- */
 
 #include "windowsIncludes.h"
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Lepton {
@@ -44,6 +46,10 @@ class ParsedExpression;
  * Each node is defined by an Operation and a set of children.  When the expression is
  * evaluated, each child is first evaluated in order, then the resulting values are passed
  * as the arguments to the Operation's evaluate() method.
+ *
+ * Nodes are immutable once created, so copying one is cheap: the copy shares its Operation
+ * and children with the original.  An expression built up from existing nodes is really a
+ * directed acyclic graph in which common subtrees are stored only once.
  */
 
 class LEPTON_EXPORT ExpressionTreeNode {
@@ -56,6 +62,14 @@ public:
      * @param children     the children of this node
      */
     ExpressionTreeNode(Operation* operation, const std::vector<ExpressionTreeNode>& children);
+    /**
+     * Create a new ExpressionTreeNode, taking ownership of a vector of children instead of copying it.
+     *
+     * @param operation    the operation for this node.  The ExpressionTreeNode takes over ownership
+     *                     of this object, and deletes it when the node is itself deleted.
+     * @param children     the children of this node
+     */
+    ExpressionTreeNode(Operation* operation, std::vector<ExpressionTreeNode>&& children);
     /**
      * Create a new ExpressionTreeNode with two children.
      *
@@ -98,10 +112,12 @@ public:
     const std::vector<ExpressionTreeNode>& getChildren() const;
 private:
     friend class ParsedExpression;
-    void assignTags(std::vector<const ExpressionTreeNode*>& examples) const;
-    Operation* operation;
-    std::vector<ExpressionTreeNode> children;
-    mutable int tag;
+    typedef std::unordered_map<const ExpressionTreeNode*, int> TagMap;
+    void assignTags(std::vector<const ExpressionTreeNode*>& examples, TagMap& tags) const;
+    void assignTags(std::vector<const ExpressionTreeNode*>& examples, TagMap& tags, std::unordered_map<std::size_t, std::vector<int> >& tagsByHash) const;
+    std::size_t hashWithTags(const TagMap& tags) const;
+    std::shared_ptr<Operation> operation;
+    std::shared_ptr<const std::vector<ExpressionTreeNode> > children;
 };
 
 } // namespace Lepton
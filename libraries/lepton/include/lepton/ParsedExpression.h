@@ -111,6 +111,25 @@ public:
      *                 to query the allowed widths on the current processor.
      */
     CompiledVectorExpression createCompiledVectorExpression(int width) const;
+    /**
+     * Create a CompiledExpression that evaluates several expressions at once, for example an
+     * energy and its derivatives.  Subexpressions that appear in more than one of them are only
+     * computed once.  Call evaluate() on it to compute all the expressions, then getValue() to
+     * retrieve the individual values.
+     *
+     * @param expressions    the expressions to evaluate
+     */
+    static CompiledExpression createCompiledExpression(const std::vector<ParsedExpression>& expressions);
+    /**
+     * Create a CompiledVectorExpression that evaluates several expressions at once, for example an
+     * energy and its derivatives.  Subexpressions that appear in more than one of them are only
+     * computed once.  Call evaluate() on it to compute all the expressions, then getValue() to
+     * retrieve the individual values.
+     *
+     * @param expressions    the expressions to evaluate
+     * @param width          the width of the vectors to evaluate them on
+     */
+    static CompiledVectorExpression createCompiledVectorExpression(const std::vector<ParsedExpression>& expressions, int width);
     /**
      * Create a new ParsedExpression which is identical to this one, except that the names of some
      * variables have been changed.
@@ -122,9 +141,9 @@ public:
 private:
     static double evaluate(const ExpressionTreeNode& node, const std::map<std::string, double>& variables);
     static ExpressionTreeNode preevaluateVariables(const ExpressionTreeNode& node, const std::map<std::string, double>& variables);
-    static ExpressionTreeNode precalculateConstantSubexpressions(const ExpressionTreeNode& node, std::map<int, ExpressionTreeNode>& nodeCache);
-    static ExpressionTreeNode substituteSimplerExpression(const ExpressionTreeNode& node, std::map<int, ExpressionTreeNode>& nodeCache);
-    static ExpressionTreeNode differentiate(const ExpressionTreeNode& node, const std::string& variable, std::map<int, ExpressionTreeNode>& nodeCache);
+    static ExpressionTreeNode precalculateConstantSubexpressions(const ExpressionTreeNode& node, const ExpressionTreeNode::TagMap& tags, std::vector<ExpressionTreeNode>& nodeCache);
+    static ExpressionTreeNode substituteSimplerExpression(const ExpressionTreeNode& node, const ExpressionTreeNode::TagMap& tags, std::vector<ExpressionTreeNode>& nodeCache);
+    static ExpressionTreeNode differentiate(const ExpressionTreeNode& node, const std::string& variable, const ExpressionTreeNode::TagMap& tags, std::vector<ExpressionTreeNode>& nodeCache);
     static bool isConstant(const ExpressionTreeNode& node);
     static double getConstantValue(const ExpressionTreeNode& node);
     static ExpressionTreeNode renameNodeVariables(const ExpressionTreeNode& node, const std::map<std::string, std::string>& replacements);
@@ -41,10 +41,19 @@ using namespace std;
 CompiledExpression::CompiledExpression() : jitCode(NULL) {
 }
 
-CompiledExpression::CompiledExpression(const ParsedExpression& expression) : jitCode(NULL) {
-    ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+CompiledExpression::CompiledExpression(const ParsedExpression& expression) : CompiledExpression(vector<ParsedExpression>(1, expression)) {
+}
+
+CompiledExpression::CompiledExpression(const vector<ParsedExpression>& expressions) : jitCode(NULL) {
+    // Compile all the expressions into a single workspace, so common subexpressions are only
+    // evaluated once.
+
     vector<pair<ExpressionTreeNode, int> > temps;
-    compileExpression(expr.getRootNode(), temps);
+    for (const ParsedExpression& expression : expressions) {
+        ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+        compileExpression(expr.getRootNode(), temps);
+        outputIndex.push_back(temps[findTempIndex(expr.getRootNode(), temps)].second);
+    }
     int maxArguments = 1;
     for (int i = 0; i < (int) operation.size(); i++)
         if (operation[i]->getNumArguments() > maxArguments)
@@ -68,6 +77,7 @@ CompiledExpression::CompiledExpression(const CompiledExpression& expression) : j
 CompiledExpression& CompiledExpression::operator=(const CompiledExpression& expression) {
     arguments = expression.arguments;
     target = expression.target;
+    outputIndex = expression.outputIndex;
     variableIndices = expression.variableIndices;
     variableNames = expression.variableNames;
     workspace.resize(expression.workspace.size());
@@ -178,7 +188,50 @@ double CompiledExpression::evaluate() const {
             workspace[target[step]] = operation[step]->evaluate(&argValues[0], dummyVariables);
         }
     }
-    return workspace[workspace.size()-1];
+    return workspace[outputIndex[0]];
+}
+
+int CompiledExpression::getNumValues() const {
+    return outputIndex.size();
+}
+
+double CompiledExpression::getValue(int index) const {
+    return workspace[outputIndex[index]];
+}
+
+void CompiledExpression::evaluate(int numPoints, const map<string, const double*>& variables, const vector<double*>& results) const {
+    if (results.size() > outputIndex.size())
+        throw Exception("evaluate: More result arrays were specified than the number of expressions");
+
+    // Find where the value of each variable needs to be stored, and where to read each result from.
+
+    vector<pair<double*, const double*> > inputs;
+    for (map<string, const double*>::const_iterator iter = variables.begin(); iter != variables.end(); ++iter) {
+        map<string, double*>::const_iterator pointer = variablePointers.find(iter->first);
+        if (pointer != variablePointers.end())
+            inputs.push_back(make_pair(pointer->second, iter->second));
+        else {
+            map<string, int>::const_iterator index = variableIndices.find(iter->first);
+            if (index != variableIndices.end())
+                inputs.push_back(make_pair(&workspace[index->second], iter->second));
+        }
+    }
+    vector<pair<double*, const double*> > outputs;
+    for (int i = 0; i < (int) results.size(); i++)
+        if (results[i] != NULL)
+            outputs.push_back(make_pair(results[i], &workspace[outputIndex[i]]));
+
+    // Evaluate each point.
+
+    int numInputs = inputs.size();
+    int numOutputs = outputs.size();
+    for (int j = 0; j < numPoints; j++) {
+        for (int i = 0; i < numInputs; i++)
+            *inputs[i].first = inputs[i].second[j];
+        evaluate();
+        for (int i = 0; i < numOutputs; i++)
+            outputs[i].first[j] = *outputs[i].second;
+    }
 }
 
 #ifdef LEPTON_USE_JIT
@@ -486,7 +539,15 @@ void CompiledExpression::generateJitCode() {
                 invoke->setRet(0, workspaceVar[target[step]]);
         }
     }
-    c.ret(workspaceVar[workspace.size()-1]);
+
+    // Store the values of all the expressions so they can be retrieved with getValue().
+
+    arm::Gp resultPointer = c.newIntPtr();
+    for (int index : outputIndex) {
+        c.mov(resultPointer, imm(&workspace[index]));
+        c.str(workspaceVar[index].d(), arm::ptr(resultPointer, 0));
+    }
+    c.ret(workspaceVar[outputIndex[0]]);
     c.endFunc();
     c.finalize();
     runtime.add(&jitCode, &code);
@@ -782,7 +843,14 @@ void CompiledExpression::generateJitCode() {
                 invoke->setRet(0, workspaceVar[target[step]]);
         }
     }
-    c.ret(workspaceVar[workspace.size()-1]);
+
+    // Store the values of all the expressions so they can be retrieved with getValue().
+
+    x86::Gp resultPointer = c.newIntPtr();
+    c.mov(resultPointer, imm(&workspace[0]));
+    for (int index : outputIndex)
+        c.vmovsd(x86::ptr(resultPointer, 8*index, 0), workspaceVar[index]);
+    c.ret(workspaceVar[outputIndex[0]]);
     c.endFunc();
     c.finalize();
     runtime.add(&jitCode, &code);
@@ -31,6 +31,9 @@
 #include "lepton/Operation.h"
 #include "lepton/ParsedExpression.h"
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <utility>
 
 using namespace Lepton;
@@ -42,14 +45,24 @@ using namespace asmjit;
 CompiledVectorExpression::CompiledVectorExpression() : jitCode(NULL) {
 }
 
-CompiledVectorExpression::CompiledVectorExpression(const ParsedExpression& expression, int width) : jitCode(NULL), width(width) {
+CompiledVectorExpression::CompiledVectorExpression(const ParsedExpression& expression, int width) : CompiledVectorExpression(vector<ParsedExpression>(1, expression), width) {
+}
+
+CompiledVectorExpression::CompiledVectorExpression(const vector<ParsedExpression>& expressions, int width) : jitCode(NULL), width(width) {
     const vector<int> allowedWidths = getAllowedWidths();
     if (find(allowedWidths.begin(), allowedWidths.end(), width) == allowedWidths.end())
         throw Exception("Unsupported width for vector expression: "+to_string(width));
-    ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+
+    // Compile all the expressions into a single workspace, so common subexpressions are only
+    // evaluated once.
+
     vector<pair<ExpressionTreeNode, int> > temps;
     int workspaceSize = 0;
-    compileExpression(expr.getRootNode(), temps, workspaceSize);
+    for (const ParsedExpression& expression : expressions) {
+        ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+        compileExpression(expr.getRootNode(), temps, workspaceSize);
+        outputIndex.push_back(temps[findTempIndex(expr.getRootNode(), temps)].second);
+    }
     workspace.resize(workspaceSize*width);
     int maxArguments = 1;
     for (int i = 0; i < (int) operation.size(); i++)
@@ -75,6 +88,7 @@ CompiledVectorExpression& CompiledVectorExpression::operator=(const CompiledVect
     arguments = expression.arguments;
     width = expression.width;
     target = expression.target;
+    outputIndex = expression.outputIndex;
     variableIndices = expression.variableIndices;
     variableNames = expression.variableNames;
     workspace.resize(expression.workspace.size());
@@ -187,7 +201,7 @@ void CompiledVectorExpression::setVariableLocations(map<string, float*>& variabl
 const float* CompiledVectorExpression::evaluate() const {
     if (jitCode) {
         jitCode();
-        return &workspace[workspace.size()-width];
+        return &workspace[outputIndex[0]*width];
     }
     for (int i = 0; i < variablesToCopy.size(); i++)
         for (int j = 0; j < width; j++)
@@ -211,7 +225,64 @@ const float* CompiledVectorExpression::evaluate() const {
             }
         }
     }
-    return &workspace[workspace.size()-width];
+    return &workspace[outputIndex[0]*width];
+}
+
+int CompiledVectorExpression::getNumValues() const {
+    return outputIndex.size();
+}
+
+const float* CompiledVectorExpression::getValue(int index) const {
+    return &workspace[outputIndex[index]*width];
+}
+
+void CompiledVectorExpression::evaluate(int numPoints, const map<string, const float*>& variables, const vector<float*>& results) const {
+    if (results.size() > outputIndex.size())
+        throw Exception("evaluate: More result arrays were specified than the number of expressions");
+
+    // Find where the value of each variable needs to be stored, and where to read each result from.
+
+    vector<pair<float*, const float*> > inputs;
+    for (map<string, const float*>::const_iterator iter = variables.begin(); iter != variables.end(); ++iter) {
+        map<string, float*>::const_iterator pointer = variablePointers.find(iter->first);
+        if (pointer != variablePointers.end())
+            inputs.push_back(make_pair(pointer->second, iter->second));
+        else {
+            map<string, int>::const_iterator index = variableIndices.find(iter->first);
+            if (index != variableIndices.end())
+                inputs.push_back(make_pair(&workspace[index->second*width], iter->second));
+        }
+    }
+    vector<pair<float*, const float*> > outputs;
+    for (int i = 0; i < (int) results.size(); i++)
+        if (results[i] != NULL)
+            outputs.push_back(make_pair(results[i], &workspace[outputIndex[i]*width]));
+
+    // Evaluate full blocks of points.
+
+    int numInputs = inputs.size();
+    int numOutputs = outputs.size();
+    int start = 0;
+    for (; start+width <= numPoints; start += width) {
+        for (int i = 0; i < numInputs; i++)
+            memcpy(inputs[i].first, inputs[i].second+start, width*sizeof(float));
+        evaluate();
+        for (int i = 0; i < numOutputs; i++)
+            memcpy(outputs[i].first+start, outputs[i].second, width*sizeof(float));
+    }
+
+    // Evaluate the remaining points.  The unused lanes repeat the last point so they never
+    // produce spurious overflows or NaNs.
+
+    int remaining = numPoints-start;
+    if (remaining > 0) {
+        for (int i = 0; i < numInputs; i++)
+            for (int j = 0; j < width; j++)
+                inputs[i].first[j] = inputs[i].second[start+min(j, remaining-1)];
+        evaluate();
+        for (int i = 0; i < numOutputs; i++)
+            memcpy(outputs[i].first+start, outputs[i].second, remaining*sizeof(float));
+    }
 }
 
 #ifdef LEPTON_USE_JIT
@@ -221,6 +292,91 @@ static double evaluateOperation(Operation* op, double* args) {
     return op->evaluate(args, dummyVariables);
 }
 
+/**
+ * Constants used by the inline implementations of transcendental functions.  The polynomial
+ * coefficients for each function are stored consecutively, starting with the highest order term.
+ */
+enum MathConstant {
+    MathZero, MathOne, MathTwo, MathHalf, MathMinusOne, MathAbsMask, MathSignMask, MathInfinity, MathNegInfinity, MathNaN,
+    MathExponentBias, MathMantissaScale, MathInvMantissaScale, MathExponentMask, MathMantissaMask,
+    ExpMin, ExpMax, ExpLog2e, ExpC1, ExpC2, ExpP0, ExpP1, ExpP2, ExpP3, ExpP4, ExpP5,
+    LogMinNormal, LogExponentOffset, LogSqrtHalf, LogP0, LogP1, LogP2, LogP3, LogP4, LogP5, LogP6, LogP7, LogP8,
+    TrigTwoOverPi, TrigDP1, TrigDP2, TrigDP3, TrigQuarter, TrigFour, SinP0, SinP1, SinP2, CosP0, CosP1, CosP2,
+    AtanTan3PiOver8, AtanTanPiOver8, AtanPiOver2, AtanPiOver4, AtanP0, AtanP1, AtanP2, AtanP3,
+    ErfcP0, ErfcP1, ErfcP2, ErfcP3, ErfcP4, ErfcP5, ErfcP6, ErfcP7, ErfcP8, ErfcP9,
+    NumMathConstants
+};
+
+/**
+ * A table holding the values of all MathConstants.  Each value is replicated across eight
+ * lanes, so it can be used directly as a vector memory operand or loaded with a single
+ * instruction.
+ */
+struct MathConstantTable {
+    alignas(32) float values[NumMathConstants][8];
+    MathConstantTable() {
+        set(MathZero, 0.0f);
+        set(MathOne, 1.0f);
+        set(MathTwo, 2.0f);
+        set(MathHalf, 0.5f);
+        set(MathMinusOne, -1.0f);
+        setBits(MathAbsMask, 0x7FFFFFFF);
+        setBits(MathSignMask, 0x80000000);
+        set(MathInfinity, numeric_limits<float>::infinity());
+        set(MathNegInfinity, -numeric_limits<float>::infinity());
+        set(MathNaN, numeric_limits<float>::quiet_NaN());
+        set(MathExponentBias, 127.0f);
+        set(MathMantissaScale, 8388608.0f);
+        set(MathInvMantissaScale, 1.0f/8388608.0f);
+        setBits(MathExponentMask, 0x7F800000);
+        setBits(MathMantissaMask, 0x007FFFFF);
+        set(ExpMin, -87.3365478515625f);
+        set(ExpMax, 88.72283935546875f);
+        set(ExpLog2e, 1.44269504088896341f);
+        set(ExpC1, 0.693359375f);
+        set(ExpC2, -2.12194440e-4f);
+        setCoefficients(ExpP0, {1.9875691500e-4f, 1.3981999507e-3f, 8.3334519073e-3f, 4.1665795894e-2f, 1.6666665459e-1f, 5.0000001201e-1f});
+        set(LogMinNormal, numeric_limits<float>::min());
+        set(LogExponentOffset, 126.0f);
+        set(LogSqrtHalf, 0.707106781186547524f);
+        setCoefficients(LogP0, {7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f, -1.2420140846e-1f, 1.4249322787e-1f,
+                -1.6668057665e-1f, 2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f});
+        set(TrigTwoOverPi, 0.636619772367581343f);
+        set(TrigDP1, 1.5703125f);
+        set(TrigDP2, 4.837512969970703125e-4f);
+        set(TrigDP3, 7.54978995489188216e-8f);
+        set(TrigQuarter, 0.25f);
+        set(TrigFour, 4.0f);
+        setCoefficients(SinP0, {-1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f});
+        setCoefficients(CosP0, {2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f});
+        set(AtanTan3PiOver8, 2.414213562373095f);
+        set(AtanTanPiOver8, 0.4142135623730950f);
+        set(AtanPiOver2, 1.5707963267948966f);
+        set(AtanPiOver4, 0.7853981633974483f);
+        setCoefficients(AtanP0, {8.05374449538e-2f, -1.38776856032e-1f, 1.99777106478e-1f, -3.33329491539e-1f});
+        setCoefficients(ErfcP0, {0.17087277f, -0.82215223f, 1.48851587f, -1.13520398f, 0.27886807f, -0.18628806f, 0.09678418f,
+                0.37409196f, 1.00002368f, -1.26551223f});
+    }
+    void set(int index, float value) {
+        for (int i = 0; i < 8; i++)
+            values[index][i] = value;
+    }
+    void setBits(int index, uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(float));
+        set(index, value);
+    }
+    void setCoefficients(int firstIndex, const vector<float>& coefficients) {
+        for (int i = 0; i < coefficients.size(); i++)
+            set(firstIndex+i, coefficients[i]);
+    }
+};
+
+static const MathConstantTable& getMathConstants() {
+    static MathConstantTable table;
+    return table;
+}
+
 void CompiledVectorExpression::findPowerGroups(vector<vector<int> >& groups, vector<vector<int> >& groupPowers, vector<int>& stepGroup) {
     // Identify every step that raises an argument to an integer power.
 
@@ -275,6 +431,8 @@ void CompiledVectorExpression::generateJitCode() {
         workspaceVar[i] = c.newVecQ();
     arm::Gp argsPointer = c.newIntPtr();
     c.mov(argsPointer, imm(&argValues[0]));
+    arm::Gp mathTable = c.newIntPtr();
+    c.mov(mathTable, imm(&getMathConstants().values[0][0]));
     vector<vector<int> > groups, groupPowers;
     vector<int> stepGroup;
     findPowerGroups(groups, groupPowers, stepGroup);
@@ -419,7 +577,7 @@ void CompiledVectorExpression::generateJitCode() {
                 c.fdiv(workspaceVar[target[step]].s4(), workspaceVar[args[0]].s4(), workspaceVar[args[1]].s4());
                 break;
             case Operation::POWER:
-                generateTwoArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]], powf);
+                generatePow(c, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]], mathTable);
                 break;
             case Operation::NEGATE:
                 c.fneg(workspaceVar[target[step]].s4(), workspaceVar[args[0]].s4());
@@ -428,16 +586,16 @@ void CompiledVectorExpression::generateJitCode() {
                 c.fsqrt(workspaceVar[target[step]].s4(), workspaceVar[args[0]].s4());
                 break;
             case Operation::EXP:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], expf);
+                generateExp(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
                 break;
             case Operation::LOG:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], logf);
+                generateLog(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
                 break;
             case Operation::SIN:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], sinf);
+                generateSinCos(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable, false);
                 break;
             case Operation::COS:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], cosf);
+                generateSinCos(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable, true);
                 break;
             case Operation::TAN:
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], tanf);
@@ -449,7 +607,7 @@ void CompiledVectorExpression::generateJitCode() {
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], acosf);
                 break;
             case Operation::ATAN:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], atanf);
+                generateAtan(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
                 break;
             case Operation::ATAN2:
                 generateTwoArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]], atan2f);
@@ -463,6 +621,9 @@ void CompiledVectorExpression::generateJitCode() {
             case Operation::TANH:
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], tanhf);
                 break;
+            case Operation::ERFC:
+                generateErfc(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
+                break;
             case Operation::STEP:
                 c.cmge(workspaceVar[target[step]].s4(), workspaceVar[args[0]].s4(), imm(0));
                 c.and_(workspaceVar[target[step]], workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
@@ -488,7 +649,7 @@ void CompiledVectorExpression::generateJitCode() {
                 c.fmul(workspaceVar[target[step]].s4(), workspaceVar[args[0]].s4(), constantVar[operationConstantIndex[step]].s4());
                 break;
             case Operation::POWER_CONSTANT:
-                generateTwoArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]], powf);
+                generatePow(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]], mathTable);
                 break;
             case Operation::MIN:
                 c.fmin(workspaceVar[target[step]].s4(), workspaceVar[args[0]].s4(), workspaceVar[args[1]].s4());
@@ -530,13 +691,273 @@ void CompiledVectorExpression::generateJitCode() {
         }
     }
     arm::Gp resultPointer = c.newIntPtr();
-    c.mov(resultPointer, imm(&workspace[workspace.size()-width]));
-    c.str(workspaceVar.back().s4(), arm::ptr(resultPointer, 0));
+    for (int index : outputIndex) {
+        c.mov(resultPointer, imm(&workspace[index*width]));
+        c.str(workspaceVar[index].s4(), arm::ptr(resultPointer, 0));
+    }
     c.endFunc();
     c.finalize();
     runtime.add(&jitCode, &code);
 }
 
+static arm::Vec loadMathConstant(a64::Compiler& c, arm::Gp& table, int index) {
+    arm::Vec v = c.newVecQ();
+    c.ldr(v.s4(), arm::ptr(table, 32*index));
+    return v;
+}
+
+/**
+ * Set dest to ifTrue in the lanes where mask is set, and ifFalse in the others.
+ */
+static void generateSelect(a64::Compiler& c, arm::Vec& dest, arm::Vec& mask, arm::Vec ifTrue, arm::Vec ifFalse) {
+    arm::Vec t = c.newVecQ();
+    c.mov(t.s4(), mask.s4());
+    c.bsl(t, ifTrue, ifFalse);
+    c.mov(dest.s4(), t.s4());
+}
+
+/**
+ * Evaluate a polynomial in x with Horner's rule.  The coefficients are stored in the
+ * constant table starting from the highest order term.
+ */
+static void generatePolynomial(a64::Compiler& c, arm::Vec& result, arm::Vec& x, arm::Gp& table, int firstCoefficient, int numCoefficients) {
+    c.ldr(result.s4(), arm::ptr(table, 32*firstCoefficient));
+    for (int i = 1; i < numCoefficients; i++) {
+        c.fmul(result.s4(), result.s4(), x.s4());
+        c.fadd(result.s4(), result.s4(), loadMathConstant(c, table, firstCoefficient+i).s4());
+    }
+}
+
+void CompiledVectorExpression::generateExp(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, arm::Gp& table) {
+    // This uses the same algorithm as the x86 version.  See the comments there for details.
+
+    arm::Vec x = c.newVecQ();
+    arm::Vec fx = c.newVecQ();
+    arm::Vec t = c.newVecQ();
+    arm::Vec r = c.newVecQ();
+    arm::Vec z = c.newVecQ();
+    arm::Vec y = c.newVecQ();
+    arm::Vec one = loadMathConstant(c, table, MathOne);
+    c.fmax(x.s4(), arg.s4(), loadMathConstant(c, table, ExpMin).s4());
+    c.fmin(x.s4(), x.s4(), loadMathConstant(c, table, ExpMax).s4());
+    c.fmul(fx.s4(), x.s4(), loadMathConstant(c, table, ExpLog2e).s4());
+    c.frintn(fx.s4(), fx.s4());
+    c.fmul(r.s4(), fx.s4(), loadMathConstant(c, table, ExpC1).s4());
+    c.fsub(r.s4(), x.s4(), r.s4());
+    c.fmul(z.s4(), fx.s4(), loadMathConstant(c, table, ExpC2).s4());
+    c.fsub(r.s4(), r.s4(), z.s4());
+    c.fmul(z.s4(), r.s4(), r.s4());
+    generatePolynomial(c, y, r, table, ExpP0, 6);
+    c.fmul(y.s4(), y.s4(), z.s4());
+    c.fadd(y.s4(), y.s4(), r.s4());
+    c.fadd(y.s4(), y.s4(), one.s4());
+    c.fcmgt(t.s4(), fx.s4(), imm(0));
+    c.and_(t, t, one);
+    c.fsub(fx.s4(), fx.s4(), t.s4());
+    c.fadd(fx.s4(), fx.s4(), loadMathConstant(c, table, MathExponentBias).s4());
+    c.fmul(fx.s4(), fx.s4(), loadMathConstant(c, table, MathMantissaScale).s4());
+    c.fcvtzs(fx.s4(), fx.s4());
+    c.fmul(y.s4(), y.s4(), fx.s4());
+    c.fadd(t.s4(), t.s4(), one.s4());
+    c.fmul(y.s4(), y.s4(), t.s4());
+    c.fcmgt(t.s4(), loadMathConstant(c, table, ExpMin).s4(), arg.s4());
+    c.bic(y, y, t);
+    c.fcmgt(t.s4(), arg.s4(), loadMathConstant(c, table, ExpMax).s4());
+    generateSelect(c, y, t, loadMathConstant(c, table, MathInfinity), y);
+    c.fcmeq(t.s4(), arg.s4(), arg.s4());
+    generateSelect(c, dest, t, y, arg);
+}
+
+void CompiledVectorExpression::generateLog(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, arm::Gp& table) {
+    // This uses the same algorithm as the x86 version.  See the comments there for details.
+
+    arm::Vec x = c.newVecQ();
+    arm::Vec e = c.newVecQ();
+    arm::Vec m = c.newVecQ();
+    arm::Vec mask = c.newVecQ();
+    arm::Vec t = c.newVecQ();
+    arm::Vec r = c.newVecQ();
+    arm::Vec z = c.newVecQ();
+    arm::Vec y = c.newVecQ();
+    arm::Vec one = loadMathConstant(c, table, MathOne);
+    arm::Vec half = loadMathConstant(c, table, MathHalf);
+    c.fmax(x.s4(), arg.s4(), loadMathConstant(c, table, LogMinNormal).s4());
+    c.and_(e, x, loadMathConstant(c, table, MathExponentMask));
+    c.scvtf(e.s4(), e.s4());
+    c.fmul(e.s4(), e.s4(), loadMathConstant(c, table, MathInvMantissaScale).s4());
+    c.fsub(e.s4(), e.s4(), loadMathConstant(c, table, LogExponentOffset).s4());
+    c.and_(m, x, loadMathConstant(c, table, MathMantissaMask));
+    c.orr(m, m, half);
+    c.fcmgt(mask.s4(), loadMathConstant(c, table, LogSqrtHalf).s4(), m.s4());
+    c.and_(t, mask, one);
+    c.fsub(e.s4(), e.s4(), t.s4());
+    c.fsub(r.s4(), m.s4(), one.s4());
+    c.and_(t, mask, m);
+    c.fadd(r.s4(), r.s4(), t.s4());
+    c.fmul(z.s4(), r.s4(), r.s4());
+    generatePolynomial(c, y, r, table, LogP0, 9);
+    c.fmul(y.s4(), y.s4(), r.s4());
+    c.fmul(y.s4(), y.s4(), z.s4());
+    c.fmul(t.s4(), e.s4(), loadMathConstant(c, table, ExpC2).s4());
+    c.fadd(y.s4(), y.s4(), t.s4());
+    c.fmul(t.s4(), z.s4(), half.s4());
+    c.fsub(y.s4(), y.s4(), t.s4());
+    c.fadd(r.s4(), r.s4(), y.s4());
+    c.fmul(t.s4(), e.s4(), loadMathConstant(c, table, ExpC1).s4());
+    c.fadd(r.s4(), r.s4(), t.s4());
+    c.fcmlt(mask.s4(), arg.s4(), imm(0));
+    generateSelect(c, r, mask, loadMathConstant(c, table, MathNaN), r);
+    c.fcmeq(mask.s4(), arg.s4(), imm(0));
+    generateSelect(c, r, mask, loadMathConstant(c, table, MathNegInfinity), r);
+    arm::Vec infinity = loadMathConstant(c, table, MathInfinity);
+    c.fcmeq(mask.s4(), arg.s4(), infinity.s4());
+    generateSelect(c, r, mask, infinity, r);
+    c.fcmeq(mask.s4(), arg.s4(), arg.s4());
+    generateSelect(c, dest, mask, r, arg);
+}
+
+void CompiledVectorExpression::generatePow(a64::Compiler& c, arm::Vec& dest, arm::Vec& base, arm::Vec& exponent, arm::Gp& table) {
+    // This uses the same algorithm as the x86 version.  See the comments there for details.
+
+    arm::Vec x = c.newVecQ();
+    arm::Vec r = c.newVecQ();
+    arm::Vec mask = c.newVecQ();
+    arm::Vec t = c.newVecQ();
+    arm::Vec u = c.newVecQ();
+    c.fabs(x.s4(), base.s4());
+    generateLog(c, x, x, table);
+    c.fmul(x.s4(), x.s4(), exponent.s4());
+    generateExp(c, r, x, table);
+    c.fcmlt(mask.s4(), base.s4(), imm(0));
+    c.fmul(t.s4(), exponent.s4(), loadMathConstant(c, table, MathHalf).s4());
+    c.frintn(u.s4(), t.s4());
+    c.fcmeq(t.s4(), t.s4(), u.s4());
+    c.bic(t, mask, t);
+    c.and_(t, t, loadMathConstant(c, table, MathSignMask));
+    c.eor(r, r, t);
+    c.frintn(u.s4(), exponent.s4());
+    c.fcmeq(t.s4(), exponent.s4(), u.s4());
+    c.bic(t, mask, t);
+    generateSelect(c, r, t, loadMathConstant(c, table, MathNaN), r);
+    c.fcmeq(t.s4(), exponent.s4(), imm(0));
+    c.fcmeq(u.s4(), base.s4(), loadMathConstant(c, table, MathOne).s4());
+    c.orr(t, t, u);
+    generateSelect(c, dest, t, loadMathConstant(c, table, MathOne), r);
+}
+
+void CompiledVectorExpression::generateSinCos(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, arm::Gp& table, bool cosine) {
+    // This uses the same algorithm as the x86 version.  See the comments there for details.
+
+    arm::Vec j = c.newVecQ();
+    arm::Vec r = c.newVecQ();
+    arm::Vec z = c.newVecQ();
+    arm::Vec t = c.newVecQ();
+    arm::Vec sinPoly = c.newVecQ();
+    arm::Vec cosPoly = c.newVecQ();
+    arm::Vec q = c.newVecQ();
+    arm::Vec mask = c.newVecQ();
+    arm::Vec one = loadMathConstant(c, table, MathOne);
+    arm::Vec two = loadMathConstant(c, table, MathTwo);
+    arm::Vec half = loadMathConstant(c, table, MathHalf);
+    c.fmul(j.s4(), arg.s4(), loadMathConstant(c, table, TrigTwoOverPi).s4());
+    c.frintn(j.s4(), j.s4());
+    c.fmul(t.s4(), j.s4(), loadMathConstant(c, table, TrigDP1).s4());
+    c.fsub(r.s4(), arg.s4(), t.s4());
+    c.fmul(t.s4(), j.s4(), loadMathConstant(c, table, TrigDP2).s4());
+    c.fsub(r.s4(), r.s4(), t.s4());
+    c.fmul(t.s4(), j.s4(), loadMathConstant(c, table, TrigDP3).s4());
+    c.fsub(r.s4(), r.s4(), t.s4());
+    c.fmul(z.s4(), r.s4(), r.s4());
+    generatePolynomial(c, sinPoly, z, table, SinP0, 3);
+    c.fmul(sinPoly.s4(), sinPoly.s4(), z.s4());
+    c.fmul(sinPoly.s4(), sinPoly.s4(), r.s4());
+    c.fadd(sinPoly.s4(), sinPoly.s4(), r.s4());
+    generatePolynomial(c, cosPoly, z, table, CosP0, 3);
+    c.fmul(cosPoly.s4(), cosPoly.s4(), z.s4());
+    c.fmul(cosPoly.s4(), cosPoly.s4(), z.s4());
+    c.fmul(t.s4(), z.s4(), half.s4());
+    c.fsub(cosPoly.s4(), cosPoly.s4(), t.s4());
+    c.fadd(cosPoly.s4(), cosPoly.s4(), one.s4());
+    c.fmul(q.s4(), j.s4(), loadMathConstant(c, table, TrigQuarter).s4());
+    c.frintm(q.s4(), q.s4());
+    c.fmul(q.s4(), q.s4(), loadMathConstant(c, table, TrigFour).s4());
+    c.fsub(q.s4(), j.s4(), q.s4());
+    c.fmul(t.s4(), q.s4(), half.s4());
+    c.frintm(t.s4(), t.s4());
+    c.fadd(t.s4(), t.s4(), t.s4());
+    c.fsub(t.s4(), q.s4(), t.s4());
+    c.fcmeq(mask.s4(), t.s4(), one.s4());
+    if (cosine) {
+        generateSelect(c, r, mask, sinPoly, cosPoly);
+        c.fcmeq(mask.s4(), q.s4(), one.s4());
+        c.fcmeq(t.s4(), q.s4(), two.s4());
+        c.orr(mask, mask, t);
+    }
+    else {
+        generateSelect(c, r, mask, cosPoly, sinPoly);
+        c.fcmge(mask.s4(), q.s4(), two.s4());
+    }
+    c.and_(mask, mask, loadMathConstant(c, table, MathSignMask));
+    c.eor(dest, r, mask);
+}
+
+void CompiledVectorExpression::generateAtan(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, arm::Gp& table) {
+    // This uses the same algorithm as the x86 version.  See the comments there for details.
+
+    arm::Vec x = c.newVecQ();
+    arm::Vec big = c.newVecQ();
+    arm::Vec mid = c.newVecQ();
+    arm::Vec num = c.newVecQ();
+    arm::Vec den = c.newVecQ();
+    arm::Vec t = c.newVecQ();
+    arm::Vec y0 = c.newVecQ();
+    arm::Vec z = c.newVecQ();
+    arm::Vec y = c.newVecQ();
+    arm::Vec one = loadMathConstant(c, table, MathOne);
+    c.fabs(x.s4(), arg.s4());
+    c.fcmgt(big.s4(), x.s4(), loadMathConstant(c, table, AtanTan3PiOver8).s4());
+    c.fcmgt(mid.s4(), x.s4(), loadMathConstant(c, table, AtanTanPiOver8).s4());
+    c.fsub(t.s4(), x.s4(), one.s4());
+    generateSelect(c, num, mid, t, x);
+    generateSelect(c, num, big, loadMathConstant(c, table, MathMinusOne), num);
+    c.fadd(t.s4(), x.s4(), one.s4());
+    generateSelect(c, den, mid, t, one);
+    generateSelect(c, den, big, x, den);
+    c.fdiv(x.s4(), num.s4(), den.s4());
+    c.and_(y0, mid, loadMathConstant(c, table, AtanPiOver4));
+    generateSelect(c, y0, big, loadMathConstant(c, table, AtanPiOver2), y0);
+    c.fmul(z.s4(), x.s4(), x.s4());
+    generatePolynomial(c, y, z, table, AtanP0, 4);
+    c.fmul(y.s4(), y.s4(), z.s4());
+    c.fmul(y.s4(), y.s4(), x.s4());
+    c.fadd(y.s4(), y.s4(), x.s4());
+    c.fadd(y.s4(), y.s4(), y0.s4());
+    c.and_(t, arg, loadMathConstant(c, table, MathSignMask));
+    c.eor(dest, y, t);
+}
+
+void CompiledVectorExpression::generateErfc(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, arm::Gp& table) {
+    // This uses the same algorithm as the x86 version.  See the comments there for details.
+
+    arm::Vec z = c.newVecQ();
+    arm::Vec t = c.newVecQ();
+    arm::Vec p = c.newVecQ();
+    arm::Vec u = c.newVecQ();
+    arm::Vec one = loadMathConstant(c, table, MathOne);
+    c.fabs(z.s4(), arg.s4());
+    c.fmul(u.s4(), z.s4(), loadMathConstant(c, table, MathHalf).s4());
+    c.fadd(u.s4(), u.s4(), one.s4());
+    c.fdiv(t.s4(), one.s4(), u.s4());
+    generatePolynomial(c, p, t, table, ErfcP0, 10);
+    c.fmul(u.s4(), z.s4(), z.s4());
+    c.fsub(p.s4(), p.s4(), u.s4());
+    generateExp(c, u, p, table);
+    c.fmul(p.s4(), t.s4(), u.s4());
+    c.fsub(u.s4(), loadMathConstant(c, table, MathTwo).s4(), p.s4());
+    c.fcmlt(t.s4(), arg.s4(), imm(0));
+    generateSelect(c, dest, t, u, p);
+}
+
 void CompiledVectorExpression::generateSingleArgCall(a64::Compiler& c, arm::Vec& dest, arm::Vec& arg, float (*function)(float)) {
     arm::Gp fn = c.newIntPtr();
     c.mov(fn, imm((void*) function));
@@ -585,6 +1006,9 @@ void CompiledVectorExpression::generateJitCode() {
         workspaceVar[i] = c.newYmmPs();
     x86::Gp argsPointer = c.newIntPtr();
     c.mov(argsPointer, imm(&argValues[0]));
+    x86::Gp mathTable = c.newIntPtr();
+    c.mov(mathTable, imm(&getMathConstants().values[0][0]));
+    splineData.clear();
     vector<vector<int> > groups, groupPowers;
     vector<int> stepGroup;
     findPowerGroups(groups, groupPowers, stepGroup);
@@ -736,7 +1160,7 @@ void CompiledVectorExpression::generateJitCode() {
                 c.vdivps(workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]]);
                 break;
             case Operation::POWER:
-                generateTwoArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]], powf);
+                generatePow(c, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]], mathTable);
                 break;
             case Operation::NEGATE:
                 c.vxorps(workspaceVar[target[step]], workspaceVar[target[step]], workspaceVar[target[step]]);
@@ -746,16 +1170,16 @@ void CompiledVectorExpression::generateJitCode() {
                 c.vsqrtps(workspaceVar[target[step]], workspaceVar[args[0]]);
                 break;
             case Operation::EXP:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], expf);
+                generateExp(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
                 break;
             case Operation::LOG:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], logf);
+                generateLog(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
                 break;
             case Operation::SIN:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], sinf);
+                generateSinCos(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable, false);
                 break;
             case Operation::COS:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], cosf);
+                generateSinCos(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable, true);
                 break;
             case Operation::TAN:
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], tanf);
@@ -767,7 +1191,7 @@ void CompiledVectorExpression::generateJitCode() {
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], acosf);
                 break;
             case Operation::ATAN:
-                generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], atanf);
+                generateAtan(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
                 break;
             case Operation::ATAN2:
                 generateTwoArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]], atan2f);
@@ -781,6 +1205,9 @@ void CompiledVectorExpression::generateJitCode() {
             case Operation::TANH:
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], tanhf);
                 break;
+            case Operation::ERFC:
+                generateErfc(c, workspaceVar[target[step]], workspaceVar[args[0]], mathTable);
+                break;
             case Operation::STEP:
                 c.vxorps(workspaceVar[target[step]], workspaceVar[target[step]], workspaceVar[target[step]]);
                 c.vcmpps(workspaceVar[target[step]], workspaceVar[target[step]], workspaceVar[args[0]], imm(18)); // Comparison mode is _CMP_LE_OQ = 18
@@ -808,7 +1235,7 @@ void CompiledVectorExpression::generateJitCode() {
                 c.vmulps(workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]]);
                 break;
             case Operation::POWER_CONSTANT:
-                generateTwoArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]], powf);
+                generatePow(c, workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]], mathTable);
                 break;
             case Operation::MIN:
                 c.vminps(workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]]);
@@ -833,6 +1260,15 @@ void CompiledVectorExpression::generateJitCode() {
                 c.vblendvps(workspaceVar[target[step]], workspaceVar[args[1]], workspaceVar[args[2]], mask);
                 break;
             }
+            case Operation::CUSTOM:
+            {
+                vector<x86::Ymm> argVars;
+                for (int i : args)
+                    argVars.push_back(workspaceVar[i]);
+                if (generateSpline(c, op, workspaceVar[target[step]], argVars))
+                    break;
+                // If it can't be evaluated as a spline, fall through to the default implementation.
+            }
             default:
                 // Just invoke evaluateOperation().
 
@@ -864,16 +1300,403 @@ void CompiledVectorExpression::generateJitCode() {
         }
     }
     x86::Gp resultPointer = c.newIntPtr();
-    c.mov(resultPointer, imm(&workspace[workspace.size()-width]));
-    if (width == 4)
-        c.vmovdqu(x86::ptr(resultPointer, 0, 0), workspaceVar.back().xmm());
-    else
-        c.vmovdqu(x86::ptr(resultPointer, 0, 0), workspaceVar.back());
+    c.mov(resultPointer, imm(&workspace[0]));
+    for (int index : outputIndex) {
+        if (width == 4)
+            c.vmovdqu(x86::ptr(resultPointer, 4*width*index, 0), workspaceVar[index].xmm());
+        else
+            c.vmovdqu(x86::ptr(resultPointer, 4*width*index, 0), workspaceVar[index]);
+    }
     c.endFunc();
     c.finalize();
     runtime.add(&jitCode, &code);
 }
 
+static x86::Mem mathConstant(x86::Gp& table, int index) {
+    return x86::ymmword_ptr(table, 32*index);
+}
+
+/**
+ * Evaluate a polynomial in x with Horner's rule.  The coefficients are stored in the
+ * constant table starting from the highest order term.
+ */
+static void generatePolynomial(x86::Compiler& c, x86::Ymm& result, x86::Ymm& x, x86::Gp& table, int firstCoefficient, int numCoefficients) {
+    c.vmovaps(result, mathConstant(table, firstCoefficient));
+    for (int i = 1; i < numCoefficients; i++) {
+        c.vmulps(result, result, x);
+        c.vaddps(result, result, mathConstant(table, firstCoefficient+i));
+    }
+}
+
+void CompiledVectorExpression::generateExp(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, x86::Gp& table) {
+    // Write exp(x) = 2^n * exp(r) with |r| <= ln(2)/2, and approximate exp(r) with a polynomial
+    // (from Cephes).  The maximum relative error is about 1e-7.  Arguments that overflow give
+    // infinity, and ones whose result would be denormal give 0.
+
+    x86::Ymm x = c.newYmmPs();
+    x86::Ymm fx = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    x86::Ymm r = c.newYmmPs();
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm y = c.newYmmPs();
+    c.vmaxps(x, arg, mathConstant(table, ExpMin));
+    c.vminps(x, x, mathConstant(table, ExpMax));
+    c.vmulps(fx, x, mathConstant(table, ExpLog2e));
+    c.vroundps(fx, fx, imm(0));
+    c.vmulps(r, fx, mathConstant(table, ExpC1));
+    c.vsubps(r, x, r);
+    c.vmulps(z, fx, mathConstant(table, ExpC2));
+    c.vsubps(r, r, z);
+    c.vmulps(z, r, r);
+    generatePolynomial(c, y, r, table, ExpP0, 6);
+    c.vmulps(y, y, z);
+    c.vaddps(y, y, r);
+    c.vaddps(y, y, mathConstant(table, MathOne));
+
+    // Multiply by 2^n.  The bits of 2^n are (n+127)<<23, which we compute in floating point and
+    // then convert to an integer.  n can be 128 at the top of the range, so for positive n we
+    // multiply by 2^(n-1) and then by 2.
+
+    c.vcmpps(t, fx, mathConstant(table, MathZero), imm(30)); // Comparison mode is _CMP_GT_OQ = 30
+    c.vandps(t, t, mathConstant(table, MathOne));
+    c.vsubps(fx, fx, t);
+    c.vaddps(fx, fx, mathConstant(table, MathExponentBias));
+    c.vmulps(fx, fx, mathConstant(table, MathMantissaScale));
+    c.vcvttps2dq(fx, fx);
+    c.vmulps(y, y, fx);
+    c.vaddps(t, t, mathConstant(table, MathOne));
+    c.vmulps(y, y, t);
+
+    // Handle arguments outside the valid range.
+
+    c.vcmpps(t, arg, mathConstant(table, ExpMin), imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+    c.vandnps(y, t, y);
+    c.vcmpps(t, arg, mathConstant(table, ExpMax), imm(30));
+    c.vblendvps(y, y, mathConstant(table, MathInfinity), t);
+    c.vcmpps(t, arg, arg, imm(3)); // Comparison mode is _CMP_UNORD_Q = 3
+    c.vblendvps(dest, y, arg, t);
+}
+
+void CompiledVectorExpression::generateLog(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, x86::Gp& table) {
+    // Write x = 2^e * m with sqrt(1/2) <= m < sqrt(2), and approximate log(m) with a polynomial
+    // (from Cephes).  The maximum absolute error is about 1e-7 for |log(x)| < 1, and the maximum
+    // relative error about 1e-7 elsewhere.  Denormal arguments are treated as the smallest
+    // normal number.
+
+    x86::Ymm x = c.newYmmPs();
+    x86::Ymm e = c.newYmmPs();
+    x86::Ymm m = c.newYmmPs();
+    x86::Ymm mask = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    x86::Ymm r = c.newYmmPs();
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm y = c.newYmmPs();
+    c.vmaxps(x, arg, mathConstant(table, LogMinNormal));
+    c.vandps(e, x, mathConstant(table, MathExponentMask));
+    c.vcvtdq2ps(e, e);
+    c.vmulps(e, e, mathConstant(table, MathInvMantissaScale));
+    c.vsubps(e, e, mathConstant(table, LogExponentOffset));
+    c.vandps(m, x, mathConstant(table, MathMantissaMask));
+    c.vorps(m, m, mathConstant(table, MathHalf));
+    c.vcmpps(mask, m, mathConstant(table, LogSqrtHalf), imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+    c.vandps(t, mask, mathConstant(table, MathOne));
+    c.vsubps(e, e, t);
+    c.vsubps(r, m, mathConstant(table, MathOne));
+    c.vandps(t, mask, m);
+    c.vaddps(r, r, t);
+    c.vmulps(z, r, r);
+    generatePolynomial(c, y, r, table, LogP0, 9);
+    c.vmulps(y, y, r);
+    c.vmulps(y, y, z);
+    c.vmulps(t, e, mathConstant(table, ExpC2));
+    c.vaddps(y, y, t);
+    c.vmulps(t, z, mathConstant(table, MathHalf));
+    c.vsubps(y, y, t);
+    c.vaddps(r, r, y);
+    c.vmulps(t, e, mathConstant(table, ExpC1));
+    c.vaddps(r, r, t);
+
+    // Handle special cases.
+
+    c.vcmpps(mask, arg, mathConstant(table, MathZero), imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+    c.vblendvps(r, r, mathConstant(table, MathNaN), mask);
+    c.vcmpps(mask, arg, mathConstant(table, MathZero), imm(0)); // Comparison mode is _CMP_EQ_OQ = 0
+    c.vblendvps(r, r, mathConstant(table, MathNegInfinity), mask);
+    c.vcmpps(mask, arg, mathConstant(table, MathInfinity), imm(0));
+    c.vblendvps(r, r, mathConstant(table, MathInfinity), mask);
+    c.vcmpps(mask, arg, arg, imm(3)); // Comparison mode is _CMP_UNORD_Q = 3
+    c.vblendvps(dest, r, arg, mask);
+}
+
+void CompiledVectorExpression::generatePow(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& base, x86::Ymm& exponent, x86::Gp& table) {
+    // Compute exp(exponent*log(|base|)).  The relative error is about 1e-7*(1+|exponent*log(base)|).
+    // A negative base gives NaN unless the exponent is an integer, in which case odd exponents
+    // flip the sign.  As in the C library, x^0 and 1^y are 1 even if the other argument is NaN.
+
+    x86::Ymm x = c.newYmmPs();
+    x86::Ymm r = c.newYmmPs();
+    x86::Ymm mask = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    x86::Ymm u = c.newYmmPs();
+    c.vandps(x, base, mathConstant(table, MathAbsMask));
+    generateLog(c, x, x, table);
+    c.vmulps(x, x, exponent);
+    generateExp(c, r, x, table);
+    c.vcmpps(mask, base, mathConstant(table, MathZero), imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+    c.vmulps(t, exponent, mathConstant(table, MathHalf));
+    c.vroundps(u, t, imm(0));
+    c.vcmpps(t, t, u, imm(4)); // Comparison mode is _CMP_NEQ_UQ = 4
+    c.vandps(t, t, mask);
+    c.vandps(t, t, mathConstant(table, MathSignMask));
+    c.vxorps(r, r, t);
+    c.vroundps(u, exponent, imm(0));
+    c.vcmpps(t, exponent, u, imm(4));
+    c.vandps(t, t, mask);
+    c.vblendvps(r, r, mathConstant(table, MathNaN), t);
+    c.vcmpps(t, exponent, mathConstant(table, MathZero), imm(0)); // Comparison mode is _CMP_EQ_OQ = 0
+    c.vcmpps(u, base, mathConstant(table, MathOne), imm(0));
+    c.vorps(t, t, u);
+    c.vblendvps(dest, r, mathConstant(table, MathOne), t);
+}
+
+void CompiledVectorExpression::generateSinCos(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, x86::Gp& table, bool cosine) {
+    // Reduce the argument to [-pi/4, pi/4] by subtracting a multiple j of pi/2, then evaluate
+    // polynomial approximations to sin and cos (from Cephes) and pick one based on j mod 4.
+    // The maximum absolute error is about 1e-7 for |x| < 8192.  Accuracy degrades for larger
+    // arguments.
+
+    x86::Ymm j = c.newYmmPs();
+    x86::Ymm r = c.newYmmPs();
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    x86::Ymm sinPoly = c.newYmmPs();
+    x86::Ymm cosPoly = c.newYmmPs();
+    x86::Ymm q = c.newYmmPs();
+    x86::Ymm mask = c.newYmmPs();
+    c.vmulps(j, arg, mathConstant(table, TrigTwoOverPi));
+    c.vroundps(j, j, imm(0));
+    c.vmulps(t, j, mathConstant(table, TrigDP1));
+    c.vsubps(r, arg, t);
+    c.vmulps(t, j, mathConstant(table, TrigDP2));
+    c.vsubps(r, r, t);
+    c.vmulps(t, j, mathConstant(table, TrigDP3));
+    c.vsubps(r, r, t);
+    c.vmulps(z, r, r);
+    generatePolynomial(c, sinPoly, z, table, SinP0, 3);
+    c.vmulps(sinPoly, sinPoly, z);
+    c.vmulps(sinPoly, sinPoly, r);
+    c.vaddps(sinPoly, sinPoly, r);
+    generatePolynomial(c, cosPoly, z, table, CosP0, 3);
+    c.vmulps(cosPoly, cosPoly, z);
+    c.vmulps(cosPoly, cosPoly, z);
+    c.vmulps(t, z, mathConstant(table, MathHalf));
+    c.vsubps(cosPoly, cosPoly, t);
+    c.vaddps(cosPoly, cosPoly, mathConstant(table, MathOne));
+
+    // Find the quadrant q = j mod 4 and select the result.
+
+    c.vmulps(q, j, mathConstant(table, TrigQuarter));
+    c.vroundps(q, q, imm(1));
+    c.vmulps(q, q, mathConstant(table, TrigFour));
+    c.vsubps(q, j, q);
+    c.vmulps(t, q, mathConstant(table, MathHalf));
+    c.vroundps(t, t, imm(1));
+    c.vaddps(t, t, t);
+    c.vsubps(t, q, t);
+    c.vcmpps(mask, t, mathConstant(table, MathOne), imm(0)); // Comparison mode is _CMP_EQ_OQ = 0
+    if (cosine) {
+        c.vblendvps(r, cosPoly, sinPoly, mask);
+        c.vcmpps(mask, q, mathConstant(table, MathOne), imm(0));
+        c.vcmpps(t, q, mathConstant(table, MathTwo), imm(0));
+        c.vorps(mask, mask, t);
+    }
+    else {
+        c.vblendvps(r, sinPoly, cosPoly, mask);
+        c.vcmpps(mask, q, mathConstant(table, MathTwo), imm(29)); // Comparison mode is _CMP_GE_OQ = 29
+    }
+    c.vandps(mask, mask, mathConstant(table, MathSignMask));
+    c.vxorps(dest, r, mask);
+}
+
+void CompiledVectorExpression::generateAtan(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, x86::Gp& table) {
+    // Reduce |x| to [0, tan(pi/8)] and approximate atan with a polynomial (from Cephes).  The
+    // maximum relative error is about 2e-7.
+
+    x86::Ymm x = c.newYmmPs();
+    x86::Ymm big = c.newYmmPs();
+    x86::Ymm mid = c.newYmmPs();
+    x86::Ymm num = c.newYmmPs();
+    x86::Ymm den = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    x86::Ymm y0 = c.newYmmPs();
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm y = c.newYmmPs();
+    c.vandps(x, arg, mathConstant(table, MathAbsMask));
+    c.vcmpps(big, x, mathConstant(table, AtanTan3PiOver8), imm(30)); // Comparison mode is _CMP_GT_OQ = 30
+    c.vcmpps(mid, x, mathConstant(table, AtanTanPiOver8), imm(30));
+    c.vsubps(t, x, mathConstant(table, MathOne));
+    c.vblendvps(num, x, t, mid);
+    c.vblendvps(num, num, mathConstant(table, MathMinusOne), big);
+    c.vaddps(t, x, mathConstant(table, MathOne));
+    c.vmovaps(den, mathConstant(table, MathOne));
+    c.vblendvps(den, den, t, mid);
+    c.vblendvps(den, den, x, big);
+    c.vdivps(x, num, den);
+    c.vandps(y0, mid, mathConstant(table, AtanPiOver4));
+    c.vblendvps(y0, y0, mathConstant(table, AtanPiOver2), big);
+    c.vmulps(z, x, x);
+    generatePolynomial(c, y, z, table, AtanP0, 4);
+    c.vmulps(y, y, z);
+    c.vmulps(y, y, x);
+    c.vaddps(y, y, x);
+    c.vaddps(y, y, y0);
+    c.vandps(t, arg, mathConstant(table, MathSignMask));
+    c.vxorps(dest, y, t);
+}
+
+void CompiledVectorExpression::generateErfc(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, x86::Gp& table) {
+    // Use the approximation erfc(z) = t*exp(-z^2+P(t)) with t = 1/(1+z/2) from Numerical Recipes,
+    // and erfc(-z) = 2-erfc(z).  The approximation itself has a relative error below 1.2e-7.
+    // Rounding error in the exponent raises that to about 1e-5 when erfc(z) is close to underflow.
+
+    x86::Ymm z = c.newYmmPs();
+    x86::Ymm t = c.newYmmPs();
+    x86::Ymm p = c.newYmmPs();
+    x86::Ymm u = c.newYmmPs();
+    c.vandps(z, arg, mathConstant(table, MathAbsMask));
+    c.vmulps(u, z, mathConstant(table, MathHalf));
+    c.vaddps(u, u, mathConstant(table, MathOne));
+    c.vmovaps(t, mathConstant(table, MathOne));
+    c.vdivps(t, t, u);
+    generatePolynomial(c, p, t, table, ErfcP0, 10);
+    c.vmulps(u, z, z);
+    c.vsubps(p, p, u);
+    generateExp(c, u, p, table);
+    c.vmulps(p, t, u);
+    c.vmovaps(u, mathConstant(table, MathTwo));
+    c.vsubps(u, u, p);
+    c.vcmpps(t, arg, mathConstant(table, MathZero), imm(17)); // Comparison mode is _CMP_LT_OQ = 17
+    c.vblendvps(dest, p, u, t);
+}
+
+bool CompiledVectorExpression::generateSpline(x86::Compiler& c, const Operation& op, x86::Ymm& dest, vector<x86::Ymm>& args) {
+    // See whether the function can be represented as a spline on a uniform grid.  Evaluating it
+    // requires gather instructions, which were introduced in AVX2.
+
+    if (!CpuInfo::host().hasFeature(CpuFeatures::X86::kAVX2))
+        return false;
+    const Operation::Custom& custom = dynamic_cast<const Operation::Custom&>(op);
+    UniformSpline spline;
+    if (!custom.getFunction().getUniformSpline(&custom.getDerivOrder()[0], spline))
+        return false;
+    int dimensions = spline.dimensions;
+    int coeffsPerCell = (dimensions == 1 ? 4 : 16);
+    int numCells = (dimensions == 1 ? spline.size[0] : spline.size[0]*spline.size[1]);
+    if (dimensions != op.getNumArguments() || (int) spline.coefficients.size() != numCells*coeffsPerCell || numCells*coeffsPerCell >= (1<<24))
+        return false;
+
+    // Record the grid parameters for each axis (minimum, inverse spacing, number of cells, and
+    // index of the last cell), then the number of coefficients per cell, then the coefficients.
+    // The index into the table is computed in single precision, which is exact since it is
+    // below 2^24.
+
+    const int headerSize = 12;
+    splineData.push_back(vector<float>(headerSize, 0.0f));
+    vector<float>& data = splineData.back();
+    for (int i = 0; i < dimensions; i++) {
+        data[4*i] = spline.min[i];
+        data[4*i+1] = spline.size[i]/(spline.max[i]-spline.min[i]);
+        data[4*i+2] = spline.size[i];
+        data[4*i+3] = spline.size[i]-1;
+    }
+    data[8] = coeffsPerCell;
+    data.insert(data.end(), spline.coefficients.begin(), spline.coefficients.end());
+    x86::Gp dataPointer = c.newIntPtr();
+    c.mov(dataPointer, imm(&data[0]));
+
+    // Find the grid cell containing the point, and the position within it.
+
+    x86::Ymm zero = c.newYmmPs();
+    x86::Ymm inRange = c.newYmmPs();
+    x86::Ymm mask = c.newYmmPs();
+    x86::Ymm param = c.newYmmPs();
+    x86::Ymm index = c.newYmmPs();
+    vector<x86::Ymm> fraction(dimensions);
+    c.vxorps(zero, zero, zero);
+    c.vcmpps(inRange, zero, zero, imm(0)); // Comparison mode is _CMP_EQ_OQ = 0
+    for (int i = 0; i < dimensions; i++) {
+        x86::Ymm s = c.newYmmPs();
+        x86::Ymm cell = c.newYmmPs();
+        fraction[i] = c.newYmmPs();
+        c.vbroadcastss(param, x86::ptr(dataPointer, 16*i));
+        c.vsubps(s, args[i], param);
+        c.vbroadcastss(param, x86::ptr(dataPointer, 16*i+4));
+        c.vmulps(s, s, param);
+        c.vbroadcastss(param, x86::ptr(dataPointer, 16*i+8));
+        if (spline.periodic) {
+            c.vdivps(cell, s, param);
+            c.vroundps(cell, cell, imm(1));
+            c.vmulps(cell, cell, param);
+            c.vsubps(s, s, cell);
+        }
+        else {
+            c.vcmpps(mask, s, zero, imm(29)); // Comparison mode is _CMP_GE_OQ = 29
+            c.vandps(inRange, inRange, mask);
+            c.vcmpps(mask, s, param, imm(18)); // Comparison mode is _CMP_LE_OQ = 18
+            c.vandps(inRange, inRange, mask);
+        }
+
+        // Always clamp the cell index so that invalid arguments (including NaN) can never lead
+        // to an out of bounds memory access.  If either argument to vmaxps is NaN, it returns
+        // the second one.
+
+        c.vroundps(cell, s, imm(1));
+        c.vmaxps(cell, cell, zero);
+        c.vbroadcastss(param, x86::ptr(dataPointer, 16*i+12));
+        c.vminps(cell, cell, param);
+        c.vsubps(fraction[i], s, cell);
+        if (i == 0)
+            c.vmovaps(index, cell);
+        else {
+            c.vbroadcastss(param, x86::ptr(dataPointer, 8));
+            c.vmulps(cell, cell, param);
+            c.vaddps(index, index, cell);
+        }
+    }
+    c.vbroadcastss(param, x86::ptr(dataPointer, 32));
+    c.vmulps(index, index, param);
+    c.vcvttps2dq(index, index);
+
+    // Gather the coefficients and evaluate the polynomial.
+
+    x86::Ymm coeff = c.newYmmPs();
+    x86::Ymm value = c.newYmmPs();
+    x86::Ymm inner = c.newYmmPs();
+    for (int j = (dimensions == 1 ? 0 : 3); j >= 0; j--) {
+        for (int i = 3; i >= 0; i--) {
+            c.vcmpps(mask, zero, zero, imm(0)); // The gather instruction clears the mask, so we need to reset it every time.
+            c.vgatherdps(coeff, x86::ptr(dataPointer, index, 2, 4*(headerSize+i+4*j)), mask);
+            if (i == 3)
+                c.vmovaps(inner, coeff);
+            else {
+                c.vmulps(inner, inner, fraction[0]);
+                c.vaddps(inner, inner, coeff);
+            }
+        }
+        if (j == 3 || dimensions == 1)
+            c.vmovaps(value, inner);
+        else {
+            c.vmulps(value, value, fraction[1]);
+            c.vaddps(value, value, inner);
+        }
+    }
+    if (spline.periodic)
+        c.vmovaps(dest, value);
+    else
+        c.vandps(dest, value, inRange);
+    return true;
+}
+
 void CompiledVectorExpression::generateSingleArgCall(x86::Compiler& c, x86::Ymm& dest, x86::Ymm& arg, float (*function)(float)) {
     x86::Gp fn = c.newIntPtr();
     c.mov(fn, imm((void*) function));
@@ -106,3 +106,111 @@ double ExpressionProgram::evaluate(const std::map<std::string, double>& variable
     }
     return stack[stackSize-1];
 }
+
+void ExpressionProgram::evaluate(int numPoints, const std::map<std::string, const double*>& variables, double* results) const {
+    if (numPoints <= 0)
+        return;
+
+    // The stack holds one row of numPoints values for each element.  Each Operation is applied
+    // to every point before moving on to the next one.  The most common operations are handled
+    // directly as simple loops, and everything else falls back to evaluating point by point.
+
+    vector<double> stack((stackSize+1)*numPoints);
+    vector<double> args(maxArgs+1);
+    map<string, double> dummyVariables;
+    int stackPointer = stackSize;
+    for (int i = 0; i < (int) operations.size(); i++) {
+        const Operation& op = *operations[i];
+        int numArgs = op.getNumArguments();
+        const double* arg1 = (numArgs > 0 ? &stack[stackPointer*numPoints] : NULL);
+        const double* arg2 = (numArgs > 1 ? &stack[(stackPointer+1)*numPoints] : NULL);
+        stackPointer += numArgs-1;
+        double* result = &stack[stackPointer*numPoints];
+        switch (op.getId()) {
+            case Operation::CONSTANT: {
+                double value = dynamic_cast<const Operation::Constant&>(op).getValue();
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = value;
+                break;
+            }
+            case Operation::VARIABLE: {
+                map<string, const double*>::const_iterator iter = variables.find(op.getName());
+                if (iter == variables.end())
+                    throw Exception("No value specified for variable "+op.getName());
+                const double* values = iter->second;
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = values[j];
+                break;
+            }
+            case Operation::ADD:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]+arg2[j];
+                break;
+            case Operation::SUBTRACT:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]-arg2[j];
+                break;
+            case Operation::MULTIPLY:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]*arg2[j];
+                break;
+            case Operation::DIVIDE:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]/arg2[j];
+                break;
+            case Operation::NEGATE:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = -arg1[j];
+                break;
+            case Operation::SQUARE:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]*arg1[j];
+                break;
+            case Operation::CUBE:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]*arg1[j]*arg1[j];
+                break;
+            case Operation::RECIPROCAL:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = 1.0/arg1[j];
+                break;
+            case Operation::SQRT:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = sqrt(arg1[j]);
+                break;
+            case Operation::EXP:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = exp(arg1[j]);
+                break;
+            case Operation::LOG:
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = log(arg1[j]);
+                break;
+            case Operation::ADD_CONSTANT: {
+                double value = dynamic_cast<const Operation::AddConstant&>(op).getValue();
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]+value;
+                break;
+            }
+            case Operation::MULTIPLY_CONSTANT: {
+                double value = dynamic_cast<const Operation::MultiplyConstant&>(op).getValue();
+                for (int j = 0; j < numPoints; j++)
+                    result[j] = arg1[j]*value;
+                break;
+            }
+            default: {
+                // Gather the arguments for each point and evaluate it individually.
+
+                int firstArg = stackPointer-numArgs+1;
+                for (int j = 0; j < numPoints; j++) {
+                    for (int k = 0; k < numArgs; k++)
+                        args[k] = stack[(firstArg+k)*numPoints+j];
+                    result[j] = op.evaluate(&args[0], dummyVariables);
+                }
+            }
+        }
+    }
+    const double* value = &stack[(stackSize-1)*numPoints];
+    for (int j = 0; j < numPoints; j++)
+        results[j] = value[j];
+}
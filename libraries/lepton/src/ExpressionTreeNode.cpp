@@ -35,46 +35,62 @@
 using namespace Lepton;
 using namespace std;
 
-ExpressionTreeNode::ExpressionTreeNode(Operation* operation, const vector<ExpressionTreeNode>& children) : operation(operation), children(children) {
+// If an argument count is wrong, the constructors throw an exception before taking ownership
+// of the Operation, so the caller is still responsible for deleting it.
+
+ExpressionTreeNode::ExpressionTreeNode(Operation* operation, const vector<ExpressionTreeNode>& children) {
     if (operation->getNumArguments() != children.size())
         throw Exception("wrong number of arguments to function: "+operation->getName());
+    this->operation.reset(operation);
+    this->children = make_shared<const vector<ExpressionTreeNode> >(children);
 }
 
-ExpressionTreeNode::ExpressionTreeNode(Operation* operation, const ExpressionTreeNode& child1, const ExpressionTreeNode& child2) : operation(operation) {
-    children.push_back(child1);
-    children.push_back(child2);
+ExpressionTreeNode::ExpressionTreeNode(Operation* operation, vector<ExpressionTreeNode>&& children) {
     if (operation->getNumArguments() != children.size())
         throw Exception("wrong number of arguments to function: "+operation->getName());
+    this->operation.reset(operation);
+    this->children = make_shared<const vector<ExpressionTreeNode> >(std::move(children));
 }
 
-ExpressionTreeNode::ExpressionTreeNode(Operation* operation, const ExpressionTreeNode& child) : operation(operation) {
-    children.push_back(child);
-    if (operation->getNumArguments() != children.size())
+ExpressionTreeNode::ExpressionTreeNode(Operation* operation, const ExpressionTreeNode& child1, const ExpressionTreeNode& child2) {
+    if (operation->getNumArguments() != 2)
         throw Exception("wrong number of arguments to function: "+operation->getName());
+    this->operation.reset(operation);
+    vector<ExpressionTreeNode> args;
+    args.reserve(2);
+    args.push_back(child1);
+    args.push_back(child2);
+    children = make_shared<const vector<ExpressionTreeNode> >(std::move(args));
 }
 
-ExpressionTreeNode::ExpressionTreeNode(Operation* operation) : operation(operation) {
-    if (operation->getNumArguments() != children.size())
+ExpressionTreeNode::ExpressionTreeNode(Operation* operation, const ExpressionTreeNode& child) {
+    if (operation->getNumArguments() != 1)
         throw Exception("wrong number of arguments to function: "+operation->getName());
+    this->operation.reset(operation);
+    children = make_shared<const vector<ExpressionTreeNode> >(1, child);
 }
 
-ExpressionTreeNode::ExpressionTreeNode(const ExpressionTreeNode& node) : operation(node.operation == NULL ? NULL : node.operation->clone()), children(node.getChildren()) {
+ExpressionTreeNode::ExpressionTreeNode(Operation* operation) {
+    if (operation->getNumArguments() != 0)
+        throw Exception("wrong number of arguments to function: "+operation->getName());
+    this->operation.reset(operation);
 }
 
-ExpressionTreeNode::ExpressionTreeNode(ExpressionTreeNode&& node) : operation(node.operation), children(std::move(node.children)) {
-    node.operation = NULL;
-    node.children.clear();
+ExpressionTreeNode::ExpressionTreeNode(const ExpressionTreeNode& node) : operation(node.operation), children(node.children) {
 }
 
-ExpressionTreeNode::ExpressionTreeNode() : operation(NULL) {
+ExpressionTreeNode::ExpressionTreeNode(ExpressionTreeNode&& node) : operation(std::move(node.operation)), children(std::move(node.children)) {
+}
+
+ExpressionTreeNode::ExpressionTreeNode() {
 }
 
 ExpressionTreeNode::~ExpressionTreeNode() {
-    if (operation != NULL)
-        delete operation;
 }
 
 bool ExpressionTreeNode::operator!=(const ExpressionTreeNode& node) const {
+    if (operation == node.operation && children == node.children)
+        return false; // They share the same representation, so they must be equal.
     if (node.getOperation() != getOperation())
         return true;
     if (getOperation().isSymmetric() && getChildren().size() == 2) {
@@ -95,20 +111,14 @@ bool ExpressionTreeNode::operator==(const ExpressionTreeNode& node) const {
 }
 
 ExpressionTreeNode& ExpressionTreeNode::operator=(const ExpressionTreeNode& node) {
-    if (operation != NULL)
-        delete operation;
-    operation = node.getOperation().clone();
-    children = node.getChildren();
+    operation = node.operation;
+    children = node.children;
     return *this;
 }
 
 ExpressionTreeNode& ExpressionTreeNode::operator=(ExpressionTreeNode&& node) {
-    if (operation != NULL)
-        delete operation;
-    operation = node.operation;
+    operation = std::move(node.operation);
     children = std::move(node.children);
-    node.operation = NULL;
-    node.children.clear();
     return *this;
 }
 
@@ -117,35 +127,68 @@ const Operation& ExpressionTreeNode::getOperation() const {
 }
 
 const vector<ExpressionTreeNode>& ExpressionTreeNode::getChildren() const {
-    return children;
+    static const vector<ExpressionTreeNode> noChildren;
+    if (children == NULL)
+        return noChildren;
+    return *children;
 }
 
-void ExpressionTreeNode::assignTags(vector<const ExpressionTreeNode*>& examples) const {
+void ExpressionTreeNode::assignTags(vector<const ExpressionTreeNode*>& examples, TagMap& tags) const {
     // Assign tag values to all nodes in a tree, such that two nodes have the same
     // tag if and only if they (and all their children) are equal.  This is used to
-    // optimize other operations.
+    // optimize other operations.  Nodes may be shared between expressions, including
+    // ones being processed on other threads, so the tags are stored in a table owned
+    // by the caller rather than on the nodes themselves.
+
+    unordered_map<size_t, vector<int> > tagsByHash;
+    for (int i = 0; i < examples.size(); i++)
+        tagsByHash[examples[i]->hashWithTags(tags)].push_back(i);
+    assignTags(examples, tags, tagsByHash);
+}
+
+void ExpressionTreeNode::assignTags(vector<const ExpressionTreeNode*>& examples, TagMap& tags, unordered_map<size_t, vector<int> >& tagsByHash) const {
+    // Nodes are bucketed by a hash of their operation and the tags of their children,
+    // so each one only needs to be compared to the few previous nodes in its bucket.
+    // This is what makes the tags behave like hash-consed node identities.  A node
+    // that appears more than once in the graph only needs to be tagged once.
 
-    int numTags = examples.size();
+    if (tags.find(this) != tags.end())
+        return;
     for (const ExpressionTreeNode& child : getChildren())
-        child.assignTags(examples);
-    if (numTags == examples.size()) {
-        // All the children matched existing tags, so possibly this node does too.
-        
-        for (int i = 0; i < examples.size(); i++) {
-            const ExpressionTreeNode& example = *examples[i];
-            bool matches = (getChildren().size() == example.getChildren().size() && getOperation() == example.getOperation());
-            for (int j = 0; matches && j < getChildren().size(); j++)
-                if (getChildren()[j].tag != example.getChildren()[j].tag)
-                    matches = false;
-            if (matches) {
-                tag = i;
-                return;
-            }
+        child.assignTags(examples, tags, tagsByHash);
+    vector<int>& candidates = tagsByHash[hashWithTags(tags)];
+    for (int i : candidates) {
+        const ExpressionTreeNode& example = *examples[i];
+        bool matches = (getChildren().size() == example.getChildren().size() && getOperation() == example.getOperation());
+        for (int j = 0; matches && j < getChildren().size(); j++)
+            if (tags.at(&getChildren()[j]) != tags.at(&example.getChildren()[j]))
+                matches = false;
+        if (matches) {
+            tags[this] = i;
+            return;
         }
     }
     
     // This node does not match any previous node, so assign a new tag.
     
-    tag = examples.size();
+    int tag = examples.size();
+    tags[this] = tag;
+    candidates.push_back(tag);
     examples.push_back(this);
 }
+
+size_t ExpressionTreeNode::hashWithTags(const TagMap& tags) const {
+    // Combine the operation with the tags of the children.  Operations that carry data
+    // (constants, variables, and functions) also include it, so distinct values are
+    // unlikely to collide.
+
+    const Operation& op = getOperation();
+    size_t hash = op.getId();
+    if (op.getId() == Operation::CONSTANT)
+        hash = hash*1000003 ^ std::hash<double>()(dynamic_cast<const Operation::Constant&>(op).getValue());
+    else if (op.getId() == Operation::VARIABLE || op.getId() == Operation::CUSTOM)
+        hash = hash*1000003 ^ std::hash<string>()(op.getName());
+    for (const ExpressionTreeNode& child : getChildren())
+        hash = hash*1000003 ^ (size_t) tags.at(&child);
+    return hash;
+}
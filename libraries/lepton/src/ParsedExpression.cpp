@@ -69,14 +69,17 @@ double ParsedExpression::evaluate(const ExpressionTreeNode& node, const map<stri
 ParsedExpression ParsedExpression::optimize() const {
     ExpressionTreeNode result = getRootNode();
     vector<const ExpressionTreeNode*> examples;
-    result.assignTags(examples);
-    map<int, ExpressionTreeNode> nodeCache;
-    result = precalculateConstantSubexpressions(result, nodeCache);
+    ExpressionTreeNode::TagMap tags;
+    result.assignTags(examples, tags);
+    vector<ExpressionTreeNode> nodeCache(examples.size());
+    result = precalculateConstantSubexpressions(result, tags, nodeCache);
     while (true) {
         examples.clear();
-        result.assignTags(examples);
+        tags.clear();
+        result.assignTags(examples, tags);
         nodeCache.clear();
-        ExpressionTreeNode simplified = substituteSimplerExpression(result, nodeCache);
+        nodeCache.resize(examples.size());
+        ExpressionTreeNode simplified = substituteSimplerExpression(result, tags, nodeCache);
         if (simplified == result)
             break;
         result = simplified;
@@ -87,14 +90,17 @@ ParsedExpression ParsedExpression::optimize() const {
 ParsedExpression ParsedExpression::optimize(const map<string, double>& variables) const {
     ExpressionTreeNode result = preevaluateVariables(getRootNode(), variables);
     vector<const ExpressionTreeNode*> examples;
-    result.assignTags(examples);
-    map<int, ExpressionTreeNode> nodeCache;
-    result = precalculateConstantSubexpressions(result, nodeCache);
+    ExpressionTreeNode::TagMap tags;
+    result.assignTags(examples, tags);
+    vector<ExpressionTreeNode> nodeCache(examples.size());
+    result = precalculateConstantSubexpressions(result, tags, nodeCache);
     while (true) {
         examples.clear();
-        result.assignTags(examples);
+        tags.clear();
+        result.assignTags(examples, tags);
         nodeCache.clear();
-        ExpressionTreeNode simplified = substituteSimplerExpression(result, nodeCache);
+        nodeCache.resize(examples.size());
+        ExpressionTreeNode simplified = substituteSimplerExpression(result, tags, nodeCache);
         if (simplified == result)
             break;
         result = simplified;
@@ -113,42 +119,42 @@ ExpressionTreeNode ParsedExpression::preevaluateVariables(const ExpressionTreeNo
     vector<ExpressionTreeNode> children(node.getChildren().size());
     for (int i = 0; i < (int) children.size(); i++)
         children[i] = preevaluateVariables(node.getChildren()[i], variables);
-    return ExpressionTreeNode(node.getOperation().clone(), children);
+    return ExpressionTreeNode(node.getOperation().clone(), std::move(children));
 }
 
-ExpressionTreeNode ParsedExpression::precalculateConstantSubexpressions(const ExpressionTreeNode& node, map<int, ExpressionTreeNode>& nodeCache) {
-    auto cached = nodeCache.find(node.tag);
-    if (cached != nodeCache.end())
-        return cached->second;
+ExpressionTreeNode ParsedExpression::precalculateConstantSubexpressions(const ExpressionTreeNode& node, const ExpressionTreeNode::TagMap& tags, vector<ExpressionTreeNode>& nodeCache) {
+    int tag = tags.at(&node);
+    if (nodeCache[tag].operation != NULL)
+        return nodeCache[tag];
     vector<ExpressionTreeNode> children(node.getChildren().size());
     for (int i = 0; i < (int) children.size(); i++)
-        children[i] = precalculateConstantSubexpressions(node.getChildren()[i], nodeCache);
-    ExpressionTreeNode result = ExpressionTreeNode(node.getOperation().clone(), children);
+        children[i] = precalculateConstantSubexpressions(node.getChildren()[i], tags, nodeCache);
+    ExpressionTreeNode result = ExpressionTreeNode(node.getOperation().clone(), std::move(children));
     if (node.getOperation().getId() == Operation::VARIABLE || node.getOperation().getId() == Operation::CUSTOM) {
-        nodeCache[node.tag] = result;
+        nodeCache[tag] = result;
         return result;
     }
-    for (int i = 0; i < (int) children.size(); i++)
-        if (children[i].getOperation().getId() != Operation::CONSTANT) {
-            nodeCache[node.tag] = result;
+    for (const ExpressionTreeNode& child : result.getChildren())
+        if (child.getOperation().getId() != Operation::CONSTANT) {
+            nodeCache[tag] = result;
             return result;
         }
     result = ExpressionTreeNode(new Operation::Constant(evaluate(result, map<string, double>())));
-    nodeCache[node.tag] = result;
+    nodeCache[tag] = result;
     return result;
 }
 
-ExpressionTreeNode ParsedExpression::substituteSimplerExpression(const ExpressionTreeNode& node, map<int, ExpressionTreeNode>& nodeCache) {
+ExpressionTreeNode ParsedExpression::substituteSimplerExpression(const ExpressionTreeNode& node, const ExpressionTreeNode::TagMap& tags, vector<ExpressionTreeNode>& nodeCache) {
     vector<ExpressionTreeNode> children(node.getChildren().size());
     for (int i = 0; i < (int) children.size(); i++) {
         const ExpressionTreeNode& child = node.getChildren()[i];
-        auto cached = nodeCache.find(child.tag);
-        if (cached == nodeCache.end()) {
-            children[i] = substituteSimplerExpression(child, nodeCache);
-            nodeCache[child.tag] = children[i];
+        ExpressionTreeNode& cached = nodeCache[tags.at(&child)];
+        if (cached.operation == NULL) {
+            children[i] = substituteSimplerExpression(child, tags, nodeCache);
+            cached = children[i];
         }
         else
-            children[i] = cached->second;
+            children[i] = cached;
     }
 
     // Collect some info on constant expressions in children
@@ -339,25 +345,26 @@ ExpressionTreeNode ParsedExpression::substituteSimplerExpression(const Expressio
         }
 
     }
-    return ExpressionTreeNode(node.getOperation().clone(), children);
+    return ExpressionTreeNode(node.getOperation().clone(), std::move(children));
 }
 
 ParsedExpression ParsedExpression::differentiate(const string& variable) const {
     vector<const ExpressionTreeNode*> examples;
-    getRootNode().assignTags(examples);
-    map<int, ExpressionTreeNode> nodeCache;
-    return differentiate(getRootNode(), variable, nodeCache);
+    ExpressionTreeNode::TagMap tags;
+    getRootNode().assignTags(examples, tags);
+    vector<ExpressionTreeNode> nodeCache(examples.size());
+    return differentiate(getRootNode(), variable, tags, nodeCache);
 }
 
-ExpressionTreeNode ParsedExpression::differentiate(const ExpressionTreeNode& node, const string& variable, map<int, ExpressionTreeNode>& nodeCache) {
-    auto cached = nodeCache.find(node.tag);
-    if (cached != nodeCache.end())
-        return cached->second;
+ExpressionTreeNode ParsedExpression::differentiate(const ExpressionTreeNode& node, const string& variable, const ExpressionTreeNode::TagMap& tags, vector<ExpressionTreeNode>& nodeCache) {
+    int tag = tags.at(&node);
+    if (nodeCache[tag].operation != NULL)
+        return nodeCache[tag];
     vector<ExpressionTreeNode> childDerivs(node.getChildren().size());
     for (int i = 0; i < (int) childDerivs.size(); i++)
-        childDerivs[i] = differentiate(node.getChildren()[i], variable, nodeCache);
+        childDerivs[i] = differentiate(node.getChildren()[i], variable, tags, nodeCache);
     ExpressionTreeNode result = node.getOperation().differentiate(node.getChildren(), childDerivs, variable);
-    nodeCache[node.tag] = result;
+    nodeCache[tag] = result;
     return result;
 }
 
@@ -384,6 +391,14 @@ CompiledVectorExpression ParsedExpression::createCompiledVectorExpression(int wi
     return CompiledVectorExpression(*this, width);
 }
 
+CompiledExpression ParsedExpression::createCompiledExpression(const vector<ParsedExpression>& expressions) {
+    return CompiledExpression(expressions);
+}
+
+CompiledVectorExpression ParsedExpression::createCompiledVectorExpression(const vector<ParsedExpression>& expressions, int width) {
+    return CompiledVectorExpression(expressions, width);
+}
+
 ParsedExpression ParsedExpression::renameVariables(const map<string, string>& replacements) const {
     return ParsedExpression(renameNodeVariables(getRootNode(), replacements));
 }
@@ -397,7 +412,7 @@ ExpressionTreeNode ParsedExpression::renameNodeVariables(const ExpressionTreeNod
     vector<ExpressionTreeNode> children;
     for (int i = 0; i < (int) node.getChildren().size(); i++)
         children.push_back(renameNodeVariables(node.getChildren()[i], replacements));
-    return ExpressionTreeNode(node.getOperation().clone(), children);
+    return ExpressionTreeNode(node.getOperation().clone(), std::move(children));
 }
 
 ostream& Lepton::operator<<(ostream& out, const ExpressionTreeNode& node) {
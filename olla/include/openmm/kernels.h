@@ -62,6 +62,7 @@
 #include "openmm/RGForce.h"
 #include "openmm/RMSDForce.h"
 #include "openmm/NonbondedForce.h"
+#include "openmm/OpenMMException.h"
 #include "openmm/System.h"
 #include "openmm/VariableLangevinIntegrator.h"
 #include "openmm/VariableVerletIntegrator.h"
@@ -71,6 +72,7 @@
 #include "openmm/ATMForce.h"
 #include "openmm/internal/CustomCPPForceImpl.h"
 #include <iosfwd>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
@@ -120,6 +122,33 @@ public:
      * energy directly, <i>or</i> add it to an internal buffer so that it will be included here.
      */
     virtual double finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid) = 0;
+    /**
+     * Get whether this kernel implements finishGroupComputation().  If it does not,
+     * ContextImpl::calcForcesAndEnergyByGroup() performs a separate computation for each force group.
+     */
+    virtual bool supportsGroupComputation() const {
+        return false;
+    }
+    /**
+     * This is called by ContextImpl::calcForcesAndEnergyByGroup() after calcForcesAndEnergy() has been called on
+     * every ForceImpl for one force group.  It should retrieve the forces and energy parameter derivatives that
+     * have been accumulated since beginComputation() or the previous call to this method, then reset them to zero
+     * so the next group starts from scratch.  finishComputation() is still called once after the last group.
+     * This is only called if supportsGroupComputation() returns true.
+     *
+     * @param context       the context in which to execute this kernel
+     * @param includeForce  true if forces should be computed
+     * @param includeEnergy true if potential energy should be computed
+     * @param group         the index of the force group that was just computed
+     * @param forces        on exit, if includeForce is true, this contains the forces from the group
+     * @param derivs        on exit, this contains the energy parameter derivatives from the group
+     * @return the potential energy of the group that was added to internal buffers rather than being returned
+     * by the ForceImpls
+     */
+    virtual double finishGroupComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int group,
+            std::vector<Vec3>& forces, std::map<std::string, double>& derivs) {
+        throw OpenMMException("finishGroupComputation: This platform does not support computing force groups in one pass");
+    }
 };
 
 /**
@@ -1911,6 +1940,37 @@ public:
      * @param innerContext1  the second context created by the ATMForce for computing displaced energy
      */
     virtual void copyState(ContextImpl& context, ContextImpl& innerContext0, ContextImpl& innerContext1) = 0;
+    /**
+     * Get whether this kernel implements copySharedState() and applySharedForces().  If it does not,
+     * ATMForce evaluates every Force in both inner contexts, including ones that do not act on any
+     * displaced particle.
+     */
+    virtual bool supportsSharedForces() const {
+        return false;
+    }
+    /**
+     * Copy state information to the context that computes the Forces which do not act on any
+     * displaced particle.  Its particles are not displaced.  This is only called if
+     * supportsSharedForces() returns true.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param sharedContext  the context created by the ATMForce for computing the energy shared by both states
+     */
+    virtual void copySharedState(ContextImpl& context, ContextImpl& sharedContext) {
+        throw OpenMMException("copySharedState: This platform does not support shared ATMForce forces");
+    }
+    /**
+     * Scale the forces from the shared context and apply them to the main context.  This is only
+     * called if supportsSharedForces() returns true.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param sharedContext  the context created by the ATMForce for computing the energy shared by both states
+     * @param scale          the derivative of the final energy with respect to the shared energy, which is
+     *                       the sum of its derivatives with respect to both inner contexts' energies
+     */
+    virtual void applySharedForces(ContextImpl& context, ContextImpl& sharedContext, double scale) {
+        throw OpenMMException("applySharedForces: This platform does not support shared ATMForce forces");
+    }
 };
 
 /**
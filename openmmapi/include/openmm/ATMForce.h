@@ -75,6 +75,15 @@ namespace OpenMM {
  * or by the offset of the positions between two given particles. As any per-particle parameters, changes in particle coordinate 
  * transformations take effect only after calling updateParametersInContext().
  *
+ * A Force added with addForce() that does not act on any displaced particle has the same energy in both states.
+ * Such Forces are evaluated only once rather than once for each state.  This applies to bonded Forces,
+ * CustomExternalForce, CustomCompoundBondForce, CustomCentroidBondForce, CustomNonbondedForce with interaction
+ * groups, and NonbondedForce.  A NonbondedForce is only shared if every displaced particle has zero charge and
+ * epsilon, is not in any exception with nonzero parameters, and is not affected by any parameter offset.  A
+ * Force that does act on a displaced particle is always evaluated in full for both states; there is no partial
+ * evaluation of only the interactions that involve displaced particles.  Other types of Forces are always
+ * evaluated for both states.
+ *
  * As an example, the following code creates an ATMForce based on the change in energy of
  * two particles when the second particle is displaced by 1 nm in the x direction.
  * The energy change is dialed using an alchemical parameter Lambda, which in this case is set to 1/2:
@@ -397,7 +406,8 @@ public:
      * Update the per-particle parameters in a Context to match those stored in this Force object.  This method 
      * should be called after updating parameters with setParticleParameters() to copy them over to the Context.
      * The only information this method updates is the values of per-particle parameters.  The number of particles
-     * cannot be changed.
+     * cannot be changed, and a particle cannot become displaced if a Force that acts on it was previously found
+     * not to act on any displaced particle.
      */
     void updateParametersInContext(Context& context);
     /**
@@ -449,7 +449,6 @@ private:
     Vec3 externalField;
     bool exceptionsUsePeriodic, useChargeConstraint, usePreconditioner;
     int nx, ny, nz;
-    void addExclusionsToSet(const std::vector<std::set<int> >& bonded12, std::set<int>& exclusions, int baseParticle, int fromParticle, int currentLevel) const;
     std::vector<ParticleInfo> particles;
     std::vector<ExceptionInfo> exceptions;
     std::vector<ElectrodeInfo> electrodes;
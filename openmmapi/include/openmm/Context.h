@@ -282,6 +282,43 @@ public:
      * belong to exactly one molecule.
      */
     const std::vector<std::vector<int> >& getMolecules() const;
+    /**
+     * Set whether to record timing statistics.  When enabled, the Context records the wall clock time
+     * spent in each phase of the computation: evaluating each Force, applying constraints, computing
+     * virtual sites, etc.  Platforms may add entries of their own, such as the time each worker thread
+     * spent busy and idle.  Timing is disabled by default, and has negligible cost when disabled.
+     *
+     * Be aware that GPU platforms execute kernels asynchronously, so on those platforms the times
+     * mostly reflect the cost of launching work from the host rather than of executing it.
+     */
+    void setTimingEnabled(bool enabled);
+    /**
+     * Get whether timing statistics are being recorded.
+     */
+    bool getTimingEnabled() const;
+    /**
+     * Get the timing statistics that have been recorded since timing was enabled or
+     * resetTimingStatistics() was last called.
+     *
+     * @param[out] times    maps the name of each phase of the computation to the total wall clock time
+     *                      (in seconds) spent in it
+     * @param[out] counts   maps the name of each phase of the computation to the number of times it was executed
+     */
+    void getTimingStatistics(std::map<std::string, double>& times, std::map<std::string, int>& counts) const;
+    /**
+     * Discard all timing statistics that have been recorded so far.
+     */
+    void resetTimingStatistics();
+    /**
+     * Get the wall clock time spent in each phase of creating this Context: validating the System, creating
+     * the Platform's data structures, initializing the kernels for each Force, etc.  These times are always
+     * recorded, whether or not timing is enabled, and can be used to find what makes Context creation slow
+     * for very large Systems.  Molecules are identified the first time they are needed (for example, by a
+     * barostat), and the time this takes is reported as "Find molecules" once it has happened.
+     *
+     * @param[out] times    maps the name of each phase to the wall clock time (in seconds) spent in it
+     */
+    void getStartupTimes(std::map<std::string, double>& times) const;
 private:
     friend class ContextImpl;
     friend class Force;
@@ -40,15 +40,28 @@ public:
 private:
     const ATMForce& owner;
     Kernel kernel;
-    System innerSystem0, innerSystem1;
-    VerletIntegrator innerIntegrator0, innerIntegrator1;
-    Context *innerContext0, *innerContext1;
+    System innerSystem0, innerSystem1, sharedSystem;
+    VerletIntegrator innerIntegrator0, innerIntegrator1, sharedIntegrator;
+    Context *innerContext0, *innerContext1, *sharedContext;
     Lepton::CompiledExpression energyExpression, u0DerivExpression, u1DerivExpression;
     double state0Energy, state1Energy, combinedEnergy;
     std::vector<std::string> globalParameterNames, paramDerivNames;
     std::vector<double> globalValues;
     std::vector<Lepton::CompiledExpression> paramDerivExpressions;
-    void copySystem(ContextImpl& context, const System& system, System& innerSystem);
+    std::vector<bool> forceIsShared, forceIsSplit;
+    std::set<int> displacedParticles;
+    void copySystem(ContextImpl& context, const System& system, System& innerSystem, bool shared);
+    /**
+     * Identify the contained forces that do not act on any displaced particle.  Their energy
+     * and forces are the same in both states, so they only need to be evaluated once.
+     */
+    std::vector<bool> findSharedForces() const;
+    /**
+     * Identify the contained NonbondedForces that are not shared but can be split into interactions
+     * between undisplaced particles, evaluated once, and interactions involving a displaced particle,
+     * evaluated for each state.
+     */
+    std::vector<bool> findSplitForces(const std::vector<bool>& shared) const;
 };
 
 } // namespace OpenMM
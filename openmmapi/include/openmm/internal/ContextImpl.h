@@ -35,6 +35,7 @@
 #include "openmm/Vec3.h"
 #include <iosfwd>
 #include <map>
+#include <utility>
 #include <vector>
 
 namespace OpenMM {
@@ -204,6 +205,21 @@ public:
      * @return the potential energy of the system, or 0 if includeEnergy is false
      */
     double calcForcesAndEnergy(bool includeForces, bool includeEnergy, int groups=0xFFFFFFFF);
+    /**
+     * Calculate the potential energy of each of several force groups, and optionally the forces and energy
+     * parameter derivatives from each one.  This gives the same results as calling calcForcesAndEnergy() once
+     * for each group, but if the Platform supports it, the computation is only begun once.  Work that does not
+     * depend on the group, such as converting positions and updating neighbor lists, is then shared by all the
+     * groups.
+     *
+     * @param includeForces  true if forces should be calculated
+     * @param groups         the indices of the force groups to compute
+     * @param energies       on exit, energies[i] is the potential energy of group groups[i]
+     * @param forces         on exit, if includeForces is true, forces[i] contains the forces from group groups[i]
+     * @param derivs         on exit, derivs[i] contains the energy parameter derivatives from group groups[i]
+     */
+    void calcForcesAndEnergyByGroup(bool includeForces, const std::vector<int>& groups, std::vector<double>& energies,
+            std::vector<std::vector<Vec3> >& forces, std::vector<std::map<std::string, double> >& derivs);
     /**
      * Get the set of force group flags that were passed to the most recent call to calcForcesAndEnergy().
      * 
@@ -284,6 +300,17 @@ public:
      * you should never call it.  It is exposed here because the same logic is useful to other classes too.
      */
     static std::vector<std::vector<int> > findMolecules(int numParticles, std::vector<std::vector<int> >& particleBonds);
+    /**
+     * Identify the molecules formed by a set of bonds.  This is equivalent to the other version of findMolecules(),
+     * but takes a flat list of bonds instead of per-particle adjacency lists.  Molecules are ordered by their lowest
+     * index particle, and the particles within each molecule are in increasing order.
+     *
+     * @param numParticles   the number of particles
+     * @param bonds          each element is a pair of particles that belong to the same molecule
+     * @param numThreads     the number of threads to use when there are many bonds.  If this is 0, the number of
+     *                       logical CPU cores is used.
+     */
+    static std::vector<std::vector<int> > findMolecules(int numParticles, const std::vector<std::pair<int, int> >& bonds, int numThreads=1);
     /**
      * Create a new Context based on this one.  The new context will use the same Platform, device, and property
      * values as this one.  With the CUDA and OpenCL platforms, it also shares the same GPU context, allowing data
@@ -293,17 +320,60 @@ public:
      * means you shouldn't.
      */
     Context* createLinkedContext(const System& system, Integrator& integrator);
+    /**
+     * Set whether timing statistics should be recorded.
+     */
+    void setTimingEnabled(bool enabled);
+    /**
+     * Get whether timing statistics are being recorded.  Platforms can check this to decide whether
+     * to record timings for their own phases of the computation.
+     */
+    bool getTimingEnabled() const {
+        return timingEnabled;
+    }
+    /**
+     * Add a measurement to the timing statistics.  This has no effect if timing is disabled.
+     *
+     * @param name    the name of the phase of the computation that was timed
+     * @param time    the elapsed wall clock time in seconds
+     */
+    void recordTiming(const std::string& name, double time);
+    /**
+     * Get the timing statistics that have been recorded.
+     *
+     * @param times    on exit, maps the name of each phase to the total wall clock time in seconds spent in it
+     * @param counts   on exit, maps the name of each phase to the number of times it was executed
+     */
+    void getTimingStatistics(std::map<std::string, double>& times, std::map<std::string, int>& counts) const;
+    /**
+     * Discard all timing statistics that have been recorded so far.
+     */
+    void resetTimingStatistics();
+    /**
+     * Get the time spent in each phase of creating the Context.
+     *
+     * @param times    on exit, maps the name of each phase to the wall clock time in seconds spent in it
+     */
+    void getStartupTimes(std::map<std::string, double>& times) const;
 private:
     friend class Context;
     void initialize();
+    /**
+     * Record the time spent in one phase of creating the Context.  Unlike recordTiming(), this always
+     * records the time, since timing cannot be enabled until the Context already exists.
+     */
+    void recordStartupTiming(const std::string& name, double time) const;
     Context& owner;
     const System& system;
     Integrator& integrator;
     std::vector<ForceImpl*> forceImpls;
     std::map<std::string, double> parameters;
     mutable std::vector<std::vector<int> > molecules;
-    bool hasInitializedForces, hasSetPositions, integratorIsDeleted;
+    bool hasInitializedForces, hasSetPositions, integratorIsDeleted, timingEnabled;
     int lastForceGroups;
+    std::map<std::string, double> timingTotals;
+    std::map<std::string, int> timingCounts;
+    mutable std::map<std::string, double> startupTimes;
     Platform* platform;
     Kernel initializeForcesKernel, updateStateDataKernel, applyConstraintsKernel, virtualSitesKernel;
     void* platformData;
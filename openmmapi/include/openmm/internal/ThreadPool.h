@@ -66,6 +66,15 @@ public:
      * Get the number of worker threads in the pool.
      */
     int getNumThreads() const;
+    /**
+     * Restrict a worker thread to run only on a specified set of logical CPUs.  This is only
+     * supported on Linux.  On other operating systems it has no effect.
+     *
+     * @param threadIndex  the index of the worker thread to pin
+     * @param cpus         the indices of the logical CPUs the thread is allowed to run on
+     * @return true if the affinity was successfully set, false otherwise
+     */
+    bool setThreadAffinity(int threadIndex, const std::vector<int>& cpus);
     /**
      * Execute a Task in parallel on the worker threads.
      */
@@ -88,8 +97,29 @@ public:
      * Instruct the threads to resume running after blocking at a synchronization point.
      */
     void resumeThreads();
+    /**
+     * Set whether to record how much time each thread spends executing tasks.  This is disabled
+     * by default.
+     */
+    void setTimingEnabled(bool enabled);
+    /**
+     * Get whether the time each thread spends executing tasks is being recorded.
+     */
+    bool getTimingEnabled() const;
+    /**
+     * Get the total wall clock time (in seconds) each thread has spent executing tasks since
+     * resetBusyTimes() was last called.  This is only recorded while timing is enabled.
+     * 
+     * @param times     on exit, element i contains the time for thread i
+     */
+    void getBusyTimes(std::vector<double>& times) const;
+    /**
+     * Reset the times returned by getBusyTimes() to zero.
+     */
+    void resetBusyTimes();
 private:
-    bool isDeleted;
+    bool isDeleted, timingEnabled;
+    std::vector<double> busyTimes;
     int numThreads, waitCount;
     std::vector<std::thread> threads;
     std::vector<ThreadData*> threadData;
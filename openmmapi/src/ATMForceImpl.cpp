@@ -37,15 +37,29 @@
 #endif
 #include "openmm/internal/ATMForceImpl.h"
 
+#include "openmm/CMAPTorsionForce.h"
+#include "openmm/CustomAngleForce.h"
+#include "openmm/CustomBondForce.h"
+#include "openmm/CustomCentroidBondForce.h"
+#include "openmm/CustomCompoundBondForce.h"
+#include "openmm/CustomExternalForce.h"
+#include "openmm/CustomNonbondedForce.h"
+#include "openmm/CustomTorsionForce.h"
+#include "openmm/HarmonicAngleForce.h"
+#include "openmm/HarmonicBondForce.h"
 #include "openmm/NonbondedForce.h"
+#include "openmm/PeriodicTorsionForce.h"
+#include "openmm/RBTorsionForce.h"
 #include "openmm/kernels.h"
 #include "openmm/serialization/XmlSerializer.h"
 #include "openmm/Vec3.h"
 
 #include "openmm/OpenMMException.h"
 #include "openmm/internal/ContextImpl.h"
+#include "SimTKOpenMMRealType.h"
 #include "lepton/ParsedExpression.h"
 #include "lepton/Parser.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <map>
@@ -57,8 +71,289 @@
 using namespace OpenMM;
 using namespace std;
 
-ATMForceImpl::ATMForceImpl(const ATMForce& owner) : owner(owner), innerIntegrator0(1.0), innerIntegrator1(1.0),
-        innerContext0(NULL), innerContext1(NULL) {
+/**
+ * Find the particles a Force acts on.  This returns false if the Force is not of a type whose
+ * particles can be determined, in which case it is assumed to depend on all of them.
+ */
+static bool getForceParticles(const Force& force, set<int>& particles) {
+    if (dynamic_cast<const HarmonicBondForce*>(&force) != NULL) {
+        const HarmonicBondForce& f = dynamic_cast<const HarmonicBondForce&>(force);
+        for (int i = 0; i < f.getNumBonds(); i++) {
+            int p1, p2;
+            double length, k;
+            f.getBondParameters(i, p1, p2, length, k);
+            particles.insert({p1, p2});
+        }
+        return true;
+    }
+    if (dynamic_cast<const HarmonicAngleForce*>(&force) != NULL) {
+        const HarmonicAngleForce& f = dynamic_cast<const HarmonicAngleForce&>(force);
+        for (int i = 0; i < f.getNumAngles(); i++) {
+            int p1, p2, p3;
+            double angle, k;
+            f.getAngleParameters(i, p1, p2, p3, angle, k);
+            particles.insert({p1, p2, p3});
+        }
+        return true;
+    }
+    if (dynamic_cast<const PeriodicTorsionForce*>(&force) != NULL) {
+        const PeriodicTorsionForce& f = dynamic_cast<const PeriodicTorsionForce&>(force);
+        for (int i = 0; i < f.getNumTorsions(); i++) {
+            int p1, p2, p3, p4, periodicity;
+            double phase, k;
+            f.getTorsionParameters(i, p1, p2, p3, p4, periodicity, phase, k);
+            particles.insert({p1, p2, p3, p4});
+        }
+        return true;
+    }
+    if (dynamic_cast<const RBTorsionForce*>(&force) != NULL) {
+        const RBTorsionForce& f = dynamic_cast<const RBTorsionForce&>(force);
+        for (int i = 0; i < f.getNumTorsions(); i++) {
+            int p1, p2, p3, p4;
+            double c0, c1, c2, c3, c4, c5;
+            f.getTorsionParameters(i, p1, p2, p3, p4, c0, c1, c2, c3, c4, c5);
+            particles.insert({p1, p2, p3, p4});
+        }
+        return true;
+    }
+    if (dynamic_cast<const CMAPTorsionForce*>(&force) != NULL) {
+        const CMAPTorsionForce& f = dynamic_cast<const CMAPTorsionForce&>(force);
+        for (int i = 0; i < f.getNumTorsions(); i++) {
+            int map, a1, a2, a3, a4, b1, b2, b3, b4;
+            f.getTorsionParameters(i, map, a1, a2, a3, a4, b1, b2, b3, b4);
+            particles.insert({a1, a2, a3, a4, b1, b2, b3, b4});
+        }
+        return true;
+    }
+    if (dynamic_cast<const CustomBondForce*>(&force) != NULL) {
+        const CustomBondForce& f = dynamic_cast<const CustomBondForce&>(force);
+        for (int i = 0; i < f.getNumBonds(); i++) {
+            int p1, p2;
+            vector<double> params;
+            f.getBondParameters(i, p1, p2, params);
+            particles.insert({p1, p2});
+        }
+        return true;
+    }
+    if (dynamic_cast<const CustomAngleForce*>(&force) != NULL) {
+        const CustomAngleForce& f = dynamic_cast<const CustomAngleForce&>(force);
+        for (int i = 0; i < f.getNumAngles(); i++) {
+            int p1, p2, p3;
+            vector<double> params;
+            f.getAngleParameters(i, p1, p2, p3, params);
+            particles.insert({p1, p2, p3});
+        }
+        return true;
+    }
+    if (dynamic_cast<const CustomTorsionForce*>(&force) != NULL) {
+        const CustomTorsionForce& f = dynamic_cast<const CustomTorsionForce&>(force);
+        for (int i = 0; i < f.getNumTorsions(); i++) {
+            int p1, p2, p3, p4;
+            vector<double> params;
+            f.getTorsionParameters(i, p1, p2, p3, p4, params);
+            particles.insert({p1, p2, p3, p4});
+        }
+        return true;
+    }
+    if (dynamic_cast<const CustomExternalForce*>(&force) != NULL) {
+        const CustomExternalForce& f = dynamic_cast<const CustomExternalForce&>(force);
+        for (int i = 0; i < f.getNumParticles(); i++) {
+            int p;
+            vector<double> params;
+            f.getParticleParameters(i, p, params);
+            particles.insert(p);
+        }
+        return true;
+    }
+    if (dynamic_cast<const CustomCompoundBondForce*>(&force) != NULL) {
+        const CustomCompoundBondForce& f = dynamic_cast<const CustomCompoundBondForce&>(force);
+        for (int i = 0; i < f.getNumBonds(); i++) {
+            vector<int> bondParticles;
+            vector<double> params;
+            f.getBondParameters(i, bondParticles, params);
+            particles.insert(bondParticles.begin(), bondParticles.end());
+        }
+        return true;
+    }
+    if (dynamic_cast<const CustomCentroidBondForce*>(&force) != NULL) {
+        const CustomCentroidBondForce& f = dynamic_cast<const CustomCentroidBondForce&>(force);
+        for (int i = 0; i < f.getNumGroups(); i++) {
+            vector<int> groupParticles;
+            vector<double> weights;
+            f.getGroupParameters(i, groupParticles, weights);
+            particles.insert(groupParticles.begin(), groupParticles.end());
+        }
+        return true;
+    }
+    if (dynamic_cast<const NonbondedForce*>(&force) != NULL) {
+        // A particle takes part in the interactions if it has nonzero parameters, is in an exception
+        // with nonzero parameters, or has parameters that can be changed by an offset.
+
+        const NonbondedForce& f = dynamic_cast<const NonbondedForce&>(force);
+        for (int i = 0; i < f.getNumParticles(); i++) {
+            double charge, sigma, epsilon;
+            f.getParticleParameters(i, charge, sigma, epsilon);
+            if (charge != 0.0 || epsilon != 0.0)
+                particles.insert(i);
+        }
+        for (int i = 0; i < f.getNumExceptions(); i++) {
+            int p1, p2;
+            double chargeProd, sigma, epsilon;
+            f.getExceptionParameters(i, p1, p2, chargeProd, sigma, epsilon);
+            if (chargeProd != 0.0 || epsilon != 0.0)
+                particles.insert({p1, p2});
+        }
+        for (int i = 0; i < f.getNumParticleParameterOffsets(); i++) {
+            string parameter;
+            int index;
+            double chargeScale, sigmaScale, epsilonScale;
+            f.getParticleParameterOffset(i, parameter, index, chargeScale, sigmaScale, epsilonScale);
+            particles.insert(index);
+        }
+        for (int i = 0; i < f.getNumExceptionParameterOffsets(); i++) {
+            string parameter;
+            int index, p1, p2;
+            double chargeProdScale, sigmaScale, epsilonScale, chargeProd, sigma, epsilon;
+            f.getExceptionParameterOffset(i, parameter, index, chargeProdScale, sigmaScale, epsilonScale);
+            f.getExceptionParameters(index, p1, p2, chargeProd, sigma, epsilon);
+            particles.insert({p1, p2});
+        }
+        return true;
+    }
+    if (dynamic_cast<const CustomNonbondedForce*>(&force) != NULL) {
+        // Without interaction groups, every particle interacts with every other one.
+
+        const CustomNonbondedForce& f = dynamic_cast<const CustomNonbondedForce&>(force);
+        if (f.getNumInteractionGroups() == 0)
+            return false;
+        for (int i = 0; i < f.getNumInteractionGroups(); i++) {
+            set<int> set1, set2;
+            f.getInteractionGroupParameters(i, set1, set2);
+            particles.insert(set1.begin(), set1.end());
+            particles.insert(set2.begin(), set2.end());
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Find the particles that are displaced in at least one state.
+ */
+static set<int> findDisplacedParticles(const ATMForce& force) {
+    set<int> displaced;
+    for (int i = 0; i < force.getNumParticles(); i++) {
+        const ATMForce::CoordinateTransformation& transformation = force.getParticleTransformation(i);
+        const ATMForce::FixedDisplacement* fixed = dynamic_cast<const ATMForce::FixedDisplacement*>(&transformation);
+        if (fixed == NULL || fixed->getFixedDisplacement1() != Vec3() || fixed->getFixedDisplacement0() != Vec3())
+            displaced.insert(i);
+    }
+    return displaced;
+}
+
+/**
+ * Determine whether the interactions of a NonbondedForce can be split into a sum over pairs.  That
+ * is not possible for Ewald and PME, whose reciprocal space term depends on all charges at once,
+ * or for the dispersion correction.  Parameter offsets are not supported either.
+ */
+static bool canSplitNonbonded(const NonbondedForce& force) {
+    NonbondedForce::NonbondedMethod method = force.getNonbondedMethod();
+    if (method != NonbondedForce::NoCutoff && method != NonbondedForce::CutoffNonPeriodic && method != NonbondedForce::CutoffPeriodic)
+        return false;
+    if (method == NonbondedForce::CutoffPeriodic && force.getUseDispersionCorrection())
+        return false;
+    return (force.getNumParticleParameterOffsets() == 0 && force.getNumExceptionParameterOffsets() == 0);
+}
+
+static string formatNumber(double value) {
+    stringstream str;
+    str.precision(17);
+    str << value;
+    return str.str();
+}
+
+/**
+ * Create a copy of a NonbondedForce that omits every interaction involving a displaced particle.
+ */
+static NonbondedForce* createUndisplacedNonbonded(const NonbondedForce& force, const set<int>& displaced) {
+    NonbondedForce* copy = XmlSerializer::clone<NonbondedForce>(force);
+    for (int p : displaced) {
+        double charge, sigma, epsilon;
+        copy->getParticleParameters(p, charge, sigma, epsilon);
+        copy->setParticleParameters(p, 0.0, sigma, 0.0);
+    }
+    for (int i = 0; i < copy->getNumExceptions(); i++) {
+        int p1, p2;
+        double chargeProd, sigma, epsilon;
+        copy->getExceptionParameters(i, p1, p2, chargeProd, sigma, epsilon);
+        if (displaced.find(p1) != displaced.end() || displaced.find(p2) != displaced.end())
+            copy->setExceptionParameters(i, p1, p2, 0.0, sigma, 0.0);
+    }
+    return copy;
+}
+
+/**
+ * Add Forces to a System that compute exactly the interactions of a NonbondedForce that involve a
+ * displaced particle: a CustomNonbondedForce for the direct interactions, and a CustomBondForce for
+ * the exceptions.  This must only be called if canSplitNonbonded() returns true.
+ */
+static void addDisplacedNonbonded(const NonbondedForce& force, const set<int>& displaced, System& system) {
+    NonbondedForce::NonbondedMethod method = force.getNonbondedMethod();
+    double cutoff = force.getCutoffDistance();
+    string coulomb = "q1*q2/r";
+    if (method != NonbondedForce::NoCutoff) {
+        double dielectric = force.getReactionFieldDielectric();
+        double krf = pow(cutoff, -3.0)*(dielectric-1.0)/(2.0*dielectric+1.0);
+        double crf = (1.0/cutoff)*(3.0*dielectric)/(2.0*dielectric+1.0);
+        coulomb = "q1*q2*(1/r+"+formatNumber(krf)+"*r^2-"+formatNumber(crf)+")";
+    }
+    string switchValue = "1";
+    if (method != NonbondedForce::NoCutoff && force.getUseSwitchingFunction()) {
+        double switchDistance = force.getSwitchingDistance();
+        switchValue = "(1-step(r-"+formatNumber(switchDistance)+")*t^3*(10-15*t+6*t^2)); t=(r-"+formatNumber(switchDistance)+")/"+formatNumber(cutoff-switchDistance);
+    }
+    CustomNonbondedForce* direct = new CustomNonbondedForce(formatNumber(ONE_4PI_EPS0)+"*"+coulomb+"+4*epsilon*((sigma/r)^12-(sigma/r)^6)*"+switchValue+
+            "; sigma=0.5*(sigma1+sigma2); epsilon=sqrt(epsilon1*epsilon2)");
+    direct->addPerParticleParameter("q");
+    direct->addPerParticleParameter("sigma");
+    direct->addPerParticleParameter("epsilon");
+    if (method == NonbondedForce::CutoffNonPeriodic)
+        direct->setNonbondedMethod(CustomNonbondedForce::CutoffNonPeriodic);
+    else if (method == NonbondedForce::CutoffPeriodic)
+        direct->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    direct->setCutoffDistance(cutoff);
+    set<int> all;
+    for (int i = 0; i < force.getNumParticles(); i++) {
+        double charge, sigma, epsilon;
+        force.getParticleParameters(i, charge, sigma, epsilon);
+        direct->addParticle({charge, sigma, epsilon});
+        all.insert(i);
+    }
+    direct->addInteractionGroup(displaced, all);
+    CustomBondForce* exceptions = new CustomBondForce(formatNumber(ONE_4PI_EPS0)+"*chargeProd/r+4*epsilon*((sigma/r)^12-(sigma/r)^6)");
+    exceptions->addPerBondParameter("chargeProd");
+    exceptions->addPerBondParameter("sigma");
+    exceptions->addPerBondParameter("epsilon");
+    exceptions->setUsesPeriodicBoundaryConditions(method == NonbondedForce::CutoffPeriodic && force.getExceptionsUsePeriodicBoundaryConditions());
+    for (int i = 0; i < force.getNumExceptions(); i++) {
+        int p1, p2;
+        double chargeProd, sigma, epsilon;
+        force.getExceptionParameters(i, p1, p2, chargeProd, sigma, epsilon);
+        if (displaced.find(p1) == displaced.end() && displaced.find(p2) == displaced.end())
+            continue;
+        direct->addExclusion(p1, p2);
+        if (chargeProd != 0.0 || epsilon != 0.0)
+            exceptions->addBond(p1, p2, {chargeProd, sigma, epsilon});
+    }
+    system.addForce(direct);
+    if (exceptions->getNumBonds() > 0)
+        system.addForce(exceptions);
+    else
+        delete exceptions;
+}
+
+ATMForceImpl::ATMForceImpl(const ATMForce& owner) : owner(owner), innerIntegrator0(1.0), innerIntegrator1(1.0), sharedIntegrator(1.0),
+        innerContext0(NULL), innerContext1(NULL), sharedContext(NULL) {
     Lepton::ParsedExpression expr = Lepton::Parser::parse(owner.getEnergyFunction()).optimize();
     energyExpression = expr.createCompiledExpression();
     u0DerivExpression = expr.differentiate("u0").createCompiledExpression();
@@ -87,9 +382,35 @@ ATMForceImpl::~ATMForceImpl() {
         delete innerContext0;
     if (innerContext1 != NULL)
         delete innerContext1;
+    if (sharedContext != NULL)
+        delete sharedContext;
+}
+
+vector<bool> ATMForceImpl::findSharedForces() const {
+    set<int> displaced = findDisplacedParticles(owner);
+    vector<bool> shared(owner.getNumForces(), false);
+    for (int i = 0; i < owner.getNumForces(); i++) {
+        set<int> particles;
+        if (!getForceParticles(owner.getForce(i), particles))
+            continue;
+        shared[i] = true;
+        for (int p : particles)
+            if (displaced.find(p) != displaced.end())
+                shared[i] = false;
+    }
+    return shared;
 }
 
-void ATMForceImpl::copySystem(ContextImpl& context, const OpenMM::System& system, OpenMM::System& innerSystem) {
+vector<bool> ATMForceImpl::findSplitForces(const vector<bool>& shared) const {
+    vector<bool> split(owner.getNumForces(), false);
+    for (int i = 0; i < owner.getNumForces(); i++) {
+        const NonbondedForce* nonbonded = dynamic_cast<const NonbondedForce*>(&owner.getForce(i));
+        split[i] = (!shared[i] && nonbonded != NULL && canSplitNonbonded(*nonbonded));
+    }
+    return split;
+}
+
+void ATMForceImpl::copySystem(ContextImpl& context, const OpenMM::System& system, OpenMM::System& innerSystem, bool shared) {
     //copy particles
     for (int i = 0; i < system.getNumParticles(); i++)
         innerSystem.addParticle(system.getParticleMass(i));
@@ -101,6 +422,16 @@ void ATMForceImpl::copySystem(ContextImpl& context, const OpenMM::System& system
 
     // Add forces to the inner contexts
     for (int i = 0; i < owner.getNumForces(); i++) {
+        if (forceIsSplit[i]) {
+            const NonbondedForce& nonbonded = dynamic_cast<const NonbondedForce&>(owner.getForce(i));
+            if (shared)
+                innerSystem.addForce(createUndisplacedNonbonded(nonbonded, displacedParticles));
+            else
+                addDisplacedNonbonded(nonbonded, displacedParticles, innerSystem);
+            continue;
+        }
+        if (forceIsShared[i] != shared)
+            continue;
         const Force &force = owner.getForce(i);
         innerSystem.addForce(XmlSerializer::clone<Force>(force));
     }
@@ -109,18 +440,39 @@ void ATMForceImpl::copySystem(ContextImpl& context, const OpenMM::System& system
 void ATMForceImpl::initialize(ContextImpl& context) {
     const OpenMM::System& system = context.getSystem();
 
-    copySystem(context, system, innerSystem0);
-    copySystem(context, system, innerSystem1);
+    // Create the kernel.
+
+    kernel = context.getPlatform().createKernel(CalcATMForceKernel::Name(), context);
+    kernel.getAs<CalcATMForceKernel>().initialize(context.getSystem(), owner);
+
+    // Forces that do not act on any displaced particle are the same in both states.  If the
+    // platform supports it, put them in a separate context that is evaluated only once, at the
+    // undisplaced coordinates.  NonbondedForces that are pairwise additive are split: interactions
+    // between undisplaced particles go in the shared context, and only the ones involving a
+    // displaced particle are evaluated for each state.
+
+    displacedParticles = findDisplacedParticles(owner);
+    if (kernel.getAs<CalcATMForceKernel>().supportsSharedForces()) {
+        forceIsShared = findSharedForces();
+        forceIsSplit = findSplitForces(forceIsShared);
+    }
+    else {
+        forceIsShared.assign(owner.getNumForces(), false);
+        forceIsSplit.assign(owner.getNumForces(), false);
+    }
+    copySystem(context, system, innerSystem0, false);
+    copySystem(context, system, innerSystem1, false);
 
     // Create the inner context.
 
     innerContext0 = context.createLinkedContext(innerSystem0, innerIntegrator0);
     innerContext1 = context.createLinkedContext(innerSystem1, innerIntegrator1);
-
-    // Create the kernel.
-
-    kernel = context.getPlatform().createKernel(CalcATMForceKernel::Name(), context);
-    kernel.getAs<CalcATMForceKernel>().initialize(context.getSystem(), owner);
+    bool anyShared = (find(forceIsShared.begin(), forceIsShared.end(), true) != forceIsShared.end());
+    bool anySplit = (find(forceIsSplit.begin(), forceIsSplit.end(), true) != forceIsSplit.end());
+    if (anyShared || anySplit) {
+        copySystem(context, system, sharedSystem, true);
+        sharedContext = context.createLinkedContext(sharedSystem, sharedIntegrator);
+    }
 }
 
 double ATMForceImpl::calcForcesAndEnergy(ContextImpl& context, bool includeForces, bool includeEnergy, int groups) {
@@ -139,6 +491,16 @@ double ATMForceImpl::calcForcesAndEnergy(ContextImpl& context, bool includeForce
     state0Energy = innerContextImpl0.calcForcesAndEnergy(includeForces, true);
     state1Energy = innerContextImpl1.calcForcesAndEnergy(includeForces, true);
 
+    // Forces that do not act on displaced particles contribute equally to both states.
+
+    if (sharedContext != NULL) {
+        ContextImpl& sharedContextImpl = getContextImpl(*sharedContext);
+        kernel.getAs<CalcATMForceKernel>().copySharedState(context, sharedContextImpl);
+        double sharedEnergy = sharedContextImpl.calcForcesAndEnergy(includeForces, true);
+        state0Energy += sharedEnergy;
+        state1Energy += sharedEnergy;
+    }
+
     // set global parameters for energy expression
 
     for (int i = 0; i < globalParameterNames.size(); i++)
@@ -164,6 +526,8 @@ double ATMForceImpl::calcForcesAndEnergy(ContextImpl& context, bool includeForce
         for (int i = 0; i < paramDerivExpressions.size(); i++)
             energyParamDerivs[paramDerivNames[i]] += paramDerivExpressions[i].evaluate();
         kernel.getAs<CalcATMForceKernel>().applyForces(context, innerContextImpl0, innerContextImpl1, dEdu0, dEdu1, energyParamDerivs);
+        if (sharedContext != NULL)
+            kernel.getAs<CalcATMForceKernel>().applySharedForces(context, getContextImpl(*sharedContext), dEdu0+dEdu1);
     }
 
     return (includeEnergy ? combinedEnergy : 0.0);
@@ -172,6 +536,8 @@ double ATMForceImpl::calcForcesAndEnergy(ContextImpl& context, bool includeForce
 std::map<std::string, double> ATMForceImpl::getDefaultParameters() {
     map<string, double> parameters;
     parameters.insert(innerContext0->getParameters().begin(), innerContext0->getParameters().end());
+    if (sharedContext != NULL)
+        parameters.insert(sharedContext->getParameters().begin(), sharedContext->getParameters().end());
     for (int i = 0; i < owner.getNumGlobalParameters(); i++)
         parameters[owner.getGlobalParameterName(i)] = owner.getGlobalParameterDefaultValue(i);
     return parameters;
@@ -185,15 +551,27 @@ std::vector<std::string> ATMForceImpl::getKernelNames() {
 
 vector<pair<int, int> > ATMForceImpl::getBondedParticles() const {
     vector<pair<int, int> > bonds;
-    const ContextImpl& innerContextImpl = getContextImpl(*innerContext0);
-    for (auto& impl : innerContextImpl.getForceImpls()) {
-        for (auto& bond : impl->getBondedParticles())
-            bonds.push_back(bond);
+    for (Context* innerContext : {innerContext0, sharedContext}) {
+        if (innerContext == NULL)
+            continue;
+        const ContextImpl& innerContextImpl = getContextImpl(*innerContext);
+        for (auto& impl : innerContextImpl.getForceImpls()) {
+            for (auto& bond : impl->getBondedParticles())
+                bonds.push_back(bond);
+        }
     }
     return bonds;
 }
 
 void ATMForceImpl::updateParametersInContext(ContextImpl& context) {
+    vector<bool> shared = findSharedForces();
+    for (int i = 0; i < shared.size(); i++)
+        if (forceIsShared[i] && !shared[i])
+            throw OpenMMException("updateParametersInContext: A Force that did not act on any displaced particle now does");
+    if (find(forceIsSplit.begin(), forceIsSplit.end(), true) != forceIsSplit.end())
+        for (int p : findDisplacedParticles(owner))
+            if (displacedParticles.find(p) == displacedParticles.end())
+                throw OpenMMException("updateParametersInContext: A particle that was not displaced now is");
     kernel.getAs<CalcATMForceKernel>().copyParametersToContext(context, owner);
 }
 
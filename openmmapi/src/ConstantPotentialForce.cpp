@@ -32,6 +32,7 @@
 #include "openmm/ConstantPotentialForce.h"
 #include "openmm/internal/AssertionUtilities.h"
 #include "openmm/internal/ConstantPotentialForceImpl.h"
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <sstream>
@@ -156,53 +157,77 @@ ForceImpl* ConstantPotentialForce::createImpl() const {
     return new ConstantPotentialForceImpl(*this);
 }
 
+/**
+ * Find all particles within a given number of bonds of a particle, not including the particle itself.
+ * The bonds are stored in compressed sparse row format: the particles bonded to particle i are
+ * bonded[bondedStart[i]] through bonded[bondedStart[i+1]-1].  On exit, neighbors contains the
+ * particles in increasing order.
+ */
+static void findBondedNeighbors(const vector<int>& bondedStart, const vector<int>& bonded, int particle, int maxBonds, vector<int>& neighbors) {
+    neighbors.assign(bonded.begin()+bondedStart[particle], bonded.begin()+bondedStart[particle+1]);
+    int levelStart = 0;
+    for (int level = 1; level < maxBonds; level++) {
+        int levelEnd = neighbors.size();
+        for (int i = levelStart; i < levelEnd; i++) {
+            int p = neighbors[i];
+            neighbors.insert(neighbors.end(), bonded.begin()+bondedStart[p], bonded.begin()+bondedStart[p+1]);
+        }
+        levelStart = levelEnd;
+    }
+    sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    auto self = lower_bound(neighbors.begin(), neighbors.end(), particle);
+    if (self != neighbors.end() && *self == particle)
+        neighbors.erase(self);
+}
+
 void ConstantPotentialForce::createExceptionsFromBonds(const vector<pair<int, int> >& bonds, double coulomb14Scale) {
     for (auto& bond : bonds)
         if (bond.first < 0 || bond.second < 0 || bond.first >= particles.size() || bond.second >= particles.size())
             throw OpenMMException("createExceptionsFromBonds: Illegal particle index in list of bonds");
 
-    // Find particles separated by 1, 2, or 3 bonds.
+    // Build a flat list of the particles bonded to each one.
 
-    vector<set<int> > exclusions(particles.size());
-    vector<set<int> > bonded12(exclusions.size());
+    int numParticles = particles.size();
+    vector<int> bondedStart(numParticles+1, 0);
     for (auto& bond : bonds) {
-        bonded12[bond.first].insert(bond.second);
-        bonded12[bond.second].insert(bond.first);
+        bondedStart[bond.first+1]++;
+        bondedStart[bond.second+1]++;
     }
-    for (int i = 0; i < (int) exclusions.size(); ++i)
-        addExclusionsToSet(bonded12, exclusions[i], i, i, 2);
-
-    // Find particles separated by 1 or 2 bonds and create the exceptions.
-
-    for (int i = 0; i < (int) exclusions.size(); ++i) {
-        set<int> bonded13;
-        addExclusionsToSet(bonded12, bonded13, i, i, 1);
-        for (int j : exclusions[i]) {
-            if (j < i) {
-                if (bonded13.find(j) == bonded13.end()) {
-                    // This is a 1-4 interaction.
-
-                    const ParticleInfo& particle1 = particles[j];
-                    const ParticleInfo& particle2 = particles[i];
-                    const double chargeProd = coulomb14Scale*particle1.charge*particle2.charge;
-                    addException(j, i, chargeProd);
-                }
-                else {
-                    // This interaction should be completely excluded.
-
-                    addException(j, i, 0.0);
-                }
-            }
-        }
+    for (int i = 0; i < numParticles; i++)
+        bondedStart[i+1] += bondedStart[i];
+    vector<int> bonded(bondedStart[numParticles]);
+    vector<int> nextBonded(bondedStart.begin(), bondedStart.end()-1);
+    for (auto& bond : bonds) {
+        bonded[nextBonded[bond.first]++] = bond.second;
+        bonded[nextBonded[bond.second]++] = bond.first;
     }
-}
 
-void ConstantPotentialForce::addExclusionsToSet(const vector<set<int> >& bonded12, set<int>& exclusions, int baseParticle, int fromParticle, int currentLevel) const {
-    for (int i : bonded12[fromParticle]) {
-        if (i != baseParticle)
-            exclusions.insert(i);
-        if (currentLevel > 0)
-            addExclusionsToSet(bonded12, exclusions, baseParticle, i, currentLevel-1);
+    // Find particles separated by 1, 2, or 3 bonds and create the exceptions.
+
+    vector<int> bonded13, exclusions;
+    for (int i = 0; i < numParticles; ++i) {
+        if (bondedStart[i] == bondedStart[i+1])
+            continue;
+        findBondedNeighbors(bondedStart, bonded, i, 2, bonded13);
+        findBondedNeighbors(bondedStart, bonded, i, 3, exclusions);
+        for (int j : exclusions) {
+            if (j >= i)
+                break;
+            if (!binary_search(bonded13.begin(), bonded13.end(), j)) {
+                // This is a 1-4 interaction.
+
+                const ParticleInfo& particle1 = particles[j];
+                const ParticleInfo& particle2 = particles[i];
+                const double chargeProd = coulomb14Scale*particle1.charge*particle2.charge;
+                addException(j, i, chargeProd);
+            }
+            else {
+                // This interaction should be completely excluded.
+
+                addException(j, i, 0.0);
+            }
+        }
     }
 }
 
@@ -58,7 +58,7 @@ void ConstantPotentialForceImpl::initialize(ContextImpl& context) {
         throw OpenMMException("ConstantPotentialForce must have exactly as many particles as the System it belongs to.");
 
     // Check for errors in the specification of exceptions.
-    vector<set<int> > exceptions(owner.getNumParticles());
+    vector<pair<int, int> > exceptions(owner.getNumExceptions());
     for (int i = 0; i < owner.getNumExceptions(); i++) {
         int particle[2];
         double chargeProd;
@@ -73,15 +73,17 @@ void ConstantPotentialForceImpl::initialize(ContextImpl& context) {
                 throw OpenMMException(msg.str());
             }
         }
-        if (exceptions[minp].count(maxp) > 0) {
-            stringstream msg;
-            msg << "ConstantPotentialForce: Multiple exceptions are specified for particles ";
-            msg << particle[0];
-            msg << " and ";
-            msg << particle[1];
-            throw OpenMMException(msg.str());
-        }
-        exceptions[minp].insert(maxp);
+        exceptions[i] = make_pair(minp, maxp);
+    }
+    sort(exceptions.begin(), exceptions.end());
+    auto duplicate = adjacent_find(exceptions.begin(), exceptions.end());
+    if (duplicate != exceptions.end()) {
+        stringstream msg;
+        msg << "ConstantPotentialForce: Multiple exceptions are specified for particles ";
+        msg << duplicate->first;
+        msg << " and ";
+        msg << duplicate->second;
+        throw OpenMMException(msg.str());
     }
 
     // Check for problems with the periodic box vectors.
@@ -280,3 +280,23 @@ const ContextImpl& Context::getImpl() const {
 const vector<vector<int> >& Context::getMolecules() const {
     return impl->getMolecules();
 }
+
+void Context::setTimingEnabled(bool enabled) {
+    impl->setTimingEnabled(enabled);
+}
+
+bool Context::getTimingEnabled() const {
+    return impl->getTimingEnabled();
+}
+
+void Context::getTimingStatistics(map<string, double>& times, map<string, int>& counts) const {
+    impl->getTimingStatistics(times, counts);
+}
+
+void Context::resetTimingStatistics() {
+    impl->resetTimingStatistics();
+}
+
+void Context::getStartupTimes(map<string, double>& times) const {
+    impl->getStartupTimes(times);
+}
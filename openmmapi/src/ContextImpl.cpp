@@ -34,14 +34,19 @@
 #include "openmm/kernels.h"
 #include "openmm/internal/ForceImpl.h"
 #include "openmm/internal/ContextImpl.h"
+#include "openmm/internal/ThreadPool.h"
+#include "openmm/internal/timer.h"
 #include "openmm/State.h"
 #include "openmm/VirtualSite.h"
 #include "openmm/Context.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <sstream>
 #include <utility>
 #include <vector>
 #include <string.h>
@@ -53,7 +58,8 @@ const static char CHECKPOINT_MAGIC_BYTES[] = "OpenMM Binary Checkpoint\n";
 
 ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integrator, Platform* platform, const map<string, string>& properties, ContextImpl* originalContext) :
         owner(owner), system(system), integrator(integrator), hasInitializedForces(false), hasSetPositions(false), integratorIsDeleted(false),
-        lastForceGroups(-1), platform(platform), platformData(NULL) {
+        timingEnabled(false), lastForceGroups(-1), platform(platform), platformData(NULL) {
+    double startTime = getCurrentTime();
     int numParticles = system.getNumParticles();
     if (numParticles == 0)
         throw OpenMMException("Cannot create a Context for a System with no particles");
@@ -63,7 +69,7 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
     for (int i = 0; i < numParticles; i++)
         if (system.isVirtualSite(i) && system.getParticleMass(i) != 0.0)
             throw OpenMMException("Virtual site has nonzero mass");
-    set<pair<int, int> > constraintAtoms;
+    vector<pair<int, int> > constraintAtoms(system.getNumConstraints());
     for (int i = 0; i < system.getNumConstraints(); i++) {
         int particle1, particle2;
         double distance;
@@ -76,11 +82,11 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
         double mass2 = system.getParticleMass(particle2);
         if ((mass1 == 0.0 && mass2 != 0.0) || (mass2 == 0.0 && mass1 != 0.0))
             throw OpenMMException("A constraint cannot involve a massless particle");
-        pair<int, int> atoms = make_pair(min(particle1, particle2), max(particle1, particle2));
-        if (constraintAtoms.find(atoms) != constraintAtoms.end())
-            throw OpenMMException("The System has two constraints between the same atoms.  This will produce a singular constraint matrix.");
-        constraintAtoms.insert(atoms);
+        constraintAtoms[i] = make_pair(min(particle1, particle2), max(particle1, particle2));
     }
+    sort(constraintAtoms.begin(), constraintAtoms.end());
+    if (adjacent_find(constraintAtoms.begin(), constraintAtoms.end()) != constraintAtoms.end())
+        throw OpenMMException("The System has two constraints between the same atoms.  This will produce a singular constraint matrix.");
     
     // Validate the list of properties.
 
@@ -106,6 +112,10 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
         // There can't be any platform-specific properties if there's no platform
     }
 
+    double time = getCurrentTime();
+    recordStartupTiming("Validate system", time-startTime);
+    startTime = time;
+
     // Find the list of kernels required.
     
     vector<string> kernelNames;
@@ -121,6 +131,9 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
     hasInitializedForces = true;
     vector<string> integratorKernels = integrator.getKernelNames();
     kernelNames.insert(kernelNames.begin(), integratorKernels.begin(), integratorKernels.end());
+    time = getCurrentTime();
+    recordStartupTiming("Create force impls", time-startTime);
+    startTime = time;
     
     // Select a platform to use.
     
@@ -160,11 +173,13 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
             throw;
         }
     }
+    recordStartupTiming("Create platform data", getCurrentTime()-startTime);
 }
 
 void ContextImpl::initialize() {
     // Create and initialize kernels and other objects.
     
+    double startTime = getCurrentTime();
     initializeForcesKernel = platform->createKernel(CalcForcesAndEnergyKernel::Name(), *this);
     initializeForcesKernel.getAs<CalcForcesAndEnergyKernel>().initialize(system);
     updateStateDataKernel = platform->createKernel(UpdateStateDataKernel::Name(), *this);
@@ -176,16 +191,21 @@ void ContextImpl::initialize() {
     Vec3 periodicBoxVectors[3];
     system.getDefaultPeriodicBoxVectors(periodicBoxVectors[0], periodicBoxVectors[1], periodicBoxVectors[2]);
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setPeriodicBoxVectors(*this, periodicBoxVectors[0], periodicBoxVectors[1], periodicBoxVectors[2]);
+    recordStartupTiming("Initialize kernels", getCurrentTime()-startTime);
     for (size_t i = 0; i < forceImpls.size(); ++i) {
+        startTime = getCurrentTime();
         forceImpls[i]->initialize(*this);
+        recordStartupTiming("Initialize force "+std::to_string(i)+" ("+forceImpls[i]->getOwner().getName()+")", getCurrentTime()-startTime);
         map<string, double> forceParameters = forceImpls[i]->getDefaultParameters();
         for (auto param : forceParameters)
             if (parameters.find(param.first) != parameters.end() && parameters[param.first] != forceParameters[param.first])
                 throw OpenMMException("Two Forces define different default values for the parameter '"+param.first+"'");
         parameters.insert(forceParameters.begin(), forceParameters.end());
     }
+    startTime = getCurrentTime();
     integrator.initialize(*this);
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setVelocities(*this, vector<Vec3>(system.getNumParticles()));
+    recordStartupTiming("Initialize integrator", getCurrentTime()-startTime);
 }
 
 ContextImpl::~ContextImpl() {
@@ -284,17 +304,26 @@ void ContextImpl::setPeriodicBoxVectors(const Vec3& a, const Vec3& b, const Vec3
 void ContextImpl::applyConstraints(double tol) {
     if (!hasSetPositions)
         throw OpenMMException("Particle positions have not been set");
+    double startTime = (timingEnabled ? getCurrentTime() : 0.0);
     applyConstraintsKernel.getAs<ApplyConstraintsKernel>().apply(*this, tol);
+    if (timingEnabled)
+        recordTiming("Constraints", getCurrentTime()-startTime);
 }
 
 void ContextImpl::applyVelocityConstraints(double tol) {
     if (!hasSetPositions)
         throw OpenMMException("Particle positions have not been set");
+    double startTime = (timingEnabled ? getCurrentTime() : 0.0);
     applyConstraintsKernel.getAs<ApplyConstraintsKernel>().applyToVelocities(*this, tol);
+    if (timingEnabled)
+        recordTiming("Velocity constraints", getCurrentTime()-startTime);
 }
 
 void ContextImpl::computeVirtualSites() {
+    double startTime = (timingEnabled ? getCurrentTime() : 0.0);
     virtualSitesKernel.getAs<VirtualSitesKernel>().computePositions(*this);
+    if (timingEnabled)
+        recordTiming("Virtual sites", getCurrentTime()-startTime);
 }
 
 double ContextImpl::calcForcesAndEnergy(bool includeForces, bool includeEnergy, int groups) {
@@ -304,16 +333,92 @@ double ContextImpl::calcForcesAndEnergy(bool includeForces, bool includeEnergy,
     CalcForcesAndEnergyKernel& kernel = initializeForcesKernel.getAs<CalcForcesAndEnergyKernel>();
     while (true) {
         double energy = 0.0;
+        double startTime = (timingEnabled ? getCurrentTime() : 0.0);
         kernel.beginComputation(*this, includeForces, includeEnergy, groups);
-        for (auto force : forceImpls)
-            energy += force->calcForcesAndEnergy(*this, includeForces, includeEnergy, groups);
+        double time = 0.0;
+        if (timingEnabled) {
+            time = getCurrentTime();
+            recordTiming("Begin computation", time-startTime);
+        }
+        for (int i = 0; i < forceImpls.size(); i++) {
+            energy += forceImpls[i]->calcForcesAndEnergy(*this, includeForces, includeEnergy, groups);
+            if (timingEnabled) {
+                startTime = time;
+                time = getCurrentTime();
+                const Force& force = forceImpls[i]->getOwner();
+                if ((groups&(1<<force.getForceGroup())) != 0)
+                    recordTiming("Force "+std::to_string(i)+" ("+force.getName()+")", time-startTime);
+            }
+        }
+        startTime = time;
         bool valid = true;
         energy += kernel.finishComputation(*this, includeForces, includeEnergy, groups, valid);
+        if (timingEnabled)
+            recordTiming("Finish computation", getCurrentTime()-startTime);
         if (valid)
             return energy;
     }
 }
 
+void ContextImpl::calcForcesAndEnergyByGroup(bool includeForces, const vector<int>& groups, vector<double>& energies,
+            vector<vector<Vec3> >& forces, vector<map<string, double> >& derivs) {
+    if (!hasSetPositions)
+        throw OpenMMException("Particle positions have not been set");
+    int numGroups = groups.size();
+    energies.resize(numGroups);
+    forces.resize(numGroups);
+    derivs.resize(numGroups);
+    CalcForcesAndEnergyKernel& kernel = initializeForcesKernel.getAs<CalcForcesAndEnergyKernel>();
+    if (!kernel.supportsGroupComputation()) {
+        // Compute each group separately.
+
+        for (int i = 0; i < numGroups; i++) {
+            energies[i] = calcForcesAndEnergy(includeForces, true, 1<<groups[i]);
+            if (includeForces)
+                getForces(forces[i]);
+            getEnergyParameterDerivatives(derivs[i]);
+        }
+        return;
+    }
+    int allGroups = 0;
+    for (int group : groups)
+        allGroups |= 1<<group;
+    lastForceGroups = allGroups;
+    while (true) {
+        double startTime = (timingEnabled ? getCurrentTime() : 0.0);
+        kernel.beginComputation(*this, includeForces, true, allGroups);
+        double time = 0.0;
+        if (timingEnabled) {
+            time = getCurrentTime();
+            recordTiming("Begin computation", time-startTime);
+        }
+        for (int i = 0; i < numGroups; i++) {
+            int groupFlags = 1<<groups[i];
+            energies[i] = 0.0;
+            for (int j = 0; j < forceImpls.size(); j++) {
+                energies[i] += forceImpls[j]->calcForcesAndEnergy(*this, includeForces, true, groupFlags);
+                if (timingEnabled) {
+                    startTime = time;
+                    time = getCurrentTime();
+                    const Force& force = forceImpls[j]->getOwner();
+                    if ((groupFlags&(1<<force.getForceGroup())) != 0)
+                        recordTiming("Force "+std::to_string(j)+" ("+force.getName()+")", time-startTime);
+                }
+            }
+            energies[i] += kernel.finishGroupComputation(*this, includeForces, true, groups[i], forces[i], derivs[i]);
+            if (timingEnabled)
+                time = getCurrentTime();
+        }
+        startTime = time;
+        bool valid = true;
+        kernel.finishComputation(*this, includeForces, true, allGroups, valid);
+        if (timingEnabled)
+            recordTiming("Finish computation", getCurrentTime()-startTime);
+        if (valid)
+            return;
+    }
+}
+
 int& ContextImpl::getLastForceGroups() {
     return lastForceGroups;
 }
@@ -328,8 +433,11 @@ void ContextImpl::computeShiftedVelocities(double timeShift, std::vector<Vec3>&
 
 bool ContextImpl::updateContextState() {
     bool forcesInvalid = false;
+    double startTime = (timingEnabled ? getCurrentTime() : 0.0);
     for (auto force : forceImpls)
         force->updateContextState(*this, forcesInvalid);
+    if (timingEnabled)
+        recordTiming("Update context state", getCurrentTime()-startTime);
     return forcesInvalid;
 }
 
@@ -358,6 +466,7 @@ const vector<vector<int> >& ContextImpl::getMolecules() const {
         throw OpenMMException("ContextImpl: getMolecules() cannot be called until all ForceImpls have been initialized");
     if (molecules.size() > 0 || system.getNumParticles() == 0)
         return molecules;
+    double startTime = getCurrentTime();
 
     // First make a list of bonds and constraints.
 
@@ -380,60 +489,102 @@ const vector<vector<int> >& ContextImpl::getMolecules() const {
         }
     }
 
-    // Make a list of every other particle to which each particle is connected
+    // Now identify particles by which molecule they belong to.  If the Platform lets the user
+    // choose how many threads to use, respect that choice.
 
-    int numParticles = system.getNumParticles();
-    vector<vector<int> > particleBonds(numParticles);
-    for (auto& bond : bonds) {
-        particleBonds[bond.first].push_back(bond.second);
-        particleBonds[bond.second].push_back(bond.first);
-    }
-
-    // Now identify particles by which molecule they belong to.
-
-    molecules = findMolecules(numParticles, particleBonds);
+    int numThreads = 0;
+    const vector<string>& propertyNames = platform->getPropertyNames();
+    if (find(propertyNames.begin(), propertyNames.end(), "Threads") != propertyNames.end())
+        stringstream(platform->getPropertyValue(owner, "Threads")) >> numThreads;
+    molecules = findMolecules(system.getNumParticles(), bonds, numThreads);
+    recordStartupTiming("Find molecules", getCurrentTime()-startTime);
     return molecules;
 }
 
 vector<vector<int> > ContextImpl::findMolecules(int numParticles, vector<vector<int> >& particleBonds) {
-    // This is essentially a recursive algorithm, but it is reformulated as a loop to avoid
-    // stack overflows.  It selects a particle, marks it as a new molecule, then recursively
-    // marks every particle bonded to it as also being in that molecule.
-    
-    vector<int> particleMolecule(numParticles, -1);
-    int numMolecules = 0;
+    vector<pair<int, int> > bonds;
     for (int i = 0; i < numParticles; i++)
-        if (particleMolecule[i] == -1) {
-            // Start a new molecule.
-            
-            vector<int> particleStack;
-            vector<int> neighborStack;
-            particleStack.push_back(i);
-            neighborStack.push_back(0);
-            int molecule = numMolecules++;
-            
-            // Recursively tag all the bonded particles.
-            
-            while (particleStack.size() > 0) {
-                int particle = particleStack.back();
-                particleMolecule[particle] = molecule;
-                int& neighbor = neighborStack.back();
-                while (neighbor < particleBonds[particle].size() && particleMolecule[particleBonds[particle][neighbor]] != -1)
-                    neighbor++;
-                if (neighbor < particleBonds[particle].size()) {
-                    particleStack.push_back(particleBonds[particle][neighbor]);
-                    neighborStack.push_back(0);
-                }
-                else {
-                    particleStack.pop_back();
-                    neighborStack.pop_back();
-                }
+        for (int j : particleBonds[i])
+            if (j > i)
+                bonds.push_back(make_pair(i, j));
+    return findMolecules(numParticles, bonds);
+}
+
+/**
+ * Find the root of the tree containing a particle, halving the path to it along the way.
+ * Parents only ever change to point at an ancestor, so concurrent calls are safe.
+ */
+static int findRoot(atomic<int>* parent, int particle) {
+    int p = parent[particle];
+    while (p != particle) {
+        int grandparent = parent[p];
+        if (grandparent != p)
+            parent[particle].compare_exchange_weak(p, grandparent);
+        particle = p;
+        p = parent[particle];
+    }
+    return particle;
+}
+
+vector<vector<int> > ContextImpl::findMolecules(int numParticles, const vector<pair<int, int> >& bonds, int numThreads) {
+    // Merge bonded particles with a union-find structure.  Each tree is always rooted at its
+    // lowest index particle, which makes the result independent of the order in which bonds
+    // are processed.  Large systems process bonds in parallel, linking roots with an atomic
+    // compare-and-swap.
+
+    unique_ptr<atomic<int>[]> parent(new atomic<int>[numParticles]);
+    for (int i = 0; i < numParticles; i++)
+        parent[i] = i;
+    auto mergeBonds = [&] (int start, int end) {
+        for (int i = start; i < end; i++) {
+            int root1 = findRoot(parent.get(), bonds[i].first);
+            int root2 = findRoot(parent.get(), bonds[i].second);
+            while (root1 != root2) {
+                if (root1 < root2)
+                    swap(root1, root2);
+                int expected = root1;
+                if (parent[root1].compare_exchange_strong(expected, root2))
+                    break;
+                root1 = findRoot(parent.get(), root1);
+                root2 = findRoot(parent.get(), root2);
             }
         }
-    
+    };
+    int numBonds = bonds.size();
+    if (numBonds < 100000 || numThreads == 1)
+        mergeBonds(0, numBonds);
+    else {
+        ThreadPool threads(numThreads);
+        numThreads = threads.getNumThreads();
+        threads.execute([&] (ThreadPool& pool, int threadIndex) {
+            mergeBonds((long long) numBonds*threadIndex/numThreads, (long long) numBonds*(threadIndex+1)/numThreads);
+        });
+        threads.waitForThreads();
+    }
+
+    // Number the molecules in order of their lowest index particle.  Every root has a lower
+    // index than the other particles in its tree, so it has already been numbered by the time
+    // they are reached.
+
+    vector<int> particleMolecule(numParticles);
+    vector<int> moleculeSize;
+    for (int i = 0; i < numParticles; i++) {
+        int root = findRoot(parent.get(), i);
+        if (root == i) {
+            particleMolecule[i] = moleculeSize.size();
+            moleculeSize.push_back(0);
+        }
+        else
+            particleMolecule[i] = particleMolecule[root];
+        moleculeSize[particleMolecule[i]]++;
+    }
+
     // Build the final output vector.
     
+    int numMolecules = moleculeSize.size();
     vector<vector<int> > molecules(numMolecules);
+    for (int i = 0; i < numMolecules; i++)
+        molecules[i].reserve(moleculeSize[i]);
     for (int i = 0; i < numParticles; i++)
         molecules[particleMolecule[i]].push_back(i);
     return molecules;
@@ -507,3 +658,32 @@ void ContextImpl::systemChanged() {
 Context* ContextImpl::createLinkedContext(const System& system, Integrator& integrator) {
     return new Context(system, integrator, *this);
 }
+
+void ContextImpl::setTimingEnabled(bool enabled) {
+    timingEnabled = enabled;
+}
+
+void ContextImpl::recordTiming(const string& name, double time) {
+    if (!timingEnabled)
+        return;
+    timingTotals[name] += time;
+    timingCounts[name]++;
+}
+
+void ContextImpl::getTimingStatistics(map<string, double>& times, map<string, int>& counts) const {
+    times = timingTotals;
+    counts = timingCounts;
+}
+
+void ContextImpl::recordStartupTiming(const string& name, double time) const {
+    startupTimes[name] += time;
+}
+
+void ContextImpl::getStartupTimes(map<string, double>& times) const {
+    times = startupTimes;
+}
+
+void ContextImpl::resetTimingStatistics() {
+    timingTotals.clear();
+    timingCounts.clear();
+}
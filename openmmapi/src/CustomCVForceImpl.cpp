@@ -110,11 +110,12 @@ map<string, double> CustomCVForceImpl::getDefaultParameters() {
 
 void CustomCVForceImpl::getCollectiveVariableValues(ContextImpl& context, vector<double>& values) {
     kernel.getAs<CalcCustomCVForceKernel>().copyState(context, getContextImpl(*innerContext));
-    values.clear();
-    for (int i = 0; i < innerSystem.getNumForces(); i++) {
-        double value = innerContext->getState(State::Energy, false, 1<<i).getPotentialEnergy();
-        values.push_back(value);
-    }
+    vector<int> groups(innerSystem.getNumForces());
+    for (int i = 0; i < groups.size(); i++)
+        groups[i] = i;
+    vector<vector<Vec3> > forces;
+    vector<map<string, double> > derivs;
+    getContextImpl(*innerContext).calcForcesAndEnergyByGroup(false, groups, values, forces, derivs);
 }
 
 Context& CustomCVForceImpl::getInnerContext() {
@@ -74,7 +74,7 @@ void NonbondedForceImpl::initialize(ContextImpl& context) {
         if (epsilon < 0)
             throw OpenMMException("NonbondedForce: epsilon for a particle cannot be negative");
     }
-    vector<set<int> > exceptions(owner.getNumParticles());
+    vector<pair<int, int> > exceptions(owner.getNumExceptions());
     for (int i = 0; i < owner.getNumExceptions(); i++) {
         int particle[2];
         double chargeProd, sigma, epsilon;
@@ -89,20 +89,22 @@ void NonbondedForceImpl::initialize(ContextImpl& context) {
                 throw OpenMMException(msg.str());
             }
         }
-        if (exceptions[minp].count(maxp) > 0) {
-            stringstream msg;
-            msg << "NonbondedForce: Multiple exceptions are specified for particles ";
-            msg << particle[0];
-            msg << " and ";
-            msg << particle[1];
-            throw OpenMMException(msg.str());
-        }
-        exceptions[minp].insert(maxp);
+        exceptions[i] = make_pair(minp, maxp);
         if (sigma < 0)
             throw OpenMMException("NonbondedForce: sigma for an exception cannot be negative");
         if (epsilon < 0)
             throw OpenMMException("NonbondedForce: epsilon for an exception cannot be negative");
     }
+    sort(exceptions.begin(), exceptions.end());
+    auto duplicate = adjacent_find(exceptions.begin(), exceptions.end());
+    if (duplicate != exceptions.end()) {
+        stringstream msg;
+        msg << "NonbondedForce: Multiple exceptions are specified for particles ";
+        msg << duplicate->first;
+        msg << " and ";
+        msg << duplicate->second;
+        throw OpenMMException(msg.str());
+    }
     for (int i = 0; i < owner.getNumParticleParameterOffsets(); i++) {
         string parameter;
         int particleIndex;
@@ -29,6 +29,11 @@
 
 #include "openmm/internal/ThreadPool.h"
 #include "openmm/internal/hardware.h"
+#include "openmm/internal/timer.h"
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
 
 using namespace std;
 
@@ -39,10 +44,14 @@ public:
     ThreadData(ThreadPool& owner, int index) : owner(owner), index(index), isDeleted(false) {
     }
     void executeTask() {
+        bool timingEnabled = owner.timingEnabled;
+        double startTime = (timingEnabled ? getCurrentTime() : 0.0);
         if (owner.currentTask != NULL)
             owner.currentTask->execute(owner, index);
         else
             owner.currentFunction(owner, index);
+        if (timingEnabled)
+            owner.busyTimes[index] += getCurrentTime()-startTime;
     }
     ThreadPool& owner;
     int index;
@@ -65,10 +74,11 @@ static void* threadBody(void* args) {
     return 0;
 }
 
-ThreadPool::ThreadPool(int numThreads) : currentTask(NULL) {
+ThreadPool::ThreadPool(int numThreads) : timingEnabled(false), currentTask(NULL) {
     if (numThreads <= 0)
         numThreads = getNumProcessors();
     this->numThreads = numThreads;
+    busyTimes.resize(numThreads, 0.0);
     unique_lock<mutex> ul(lock);
     waitCount = 0;
     for (int i = 0; i < numThreads; i++) {
@@ -95,6 +105,24 @@ int ThreadPool::getNumThreads() const {
     return numThreads;
 }
 
+bool ThreadPool::setThreadAffinity(int threadIndex, const vector<int>& cpus) {
+#if defined(__linux__) && !defined(__ANDROID__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    bool anyCpus = false;
+    for (int cpu : cpus)
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpuSet);
+            anyCpus = true;
+        }
+    if (!anyCpus)
+        return false;
+    return (pthread_setaffinity_np(threads[threadIndex].native_handle(), sizeof(cpuSet), &cpuSet) == 0);
+#else
+    return false;
+#endif
+}
+
 void ThreadPool::execute(Task& task) {
     currentTask = &task;
     resumeThreads();
@@ -125,4 +153,21 @@ void ThreadPool::resumeThreads() {
     startCondition.notify_all();
 }
 
+void ThreadPool::setTimingEnabled(bool enabled) {
+    timingEnabled = enabled;
+}
+
+bool ThreadPool::getTimingEnabled() const {
+    return timingEnabled;
+}
+
+void ThreadPool::getBusyTimes(vector<double>& times) const {
+    times = busyTimes;
+}
+
+void ThreadPool::resetBusyTimes() {
+    for (double& time : busyTimes)
+        time = 0.0;
+}
+
 } // namespace OpenMM
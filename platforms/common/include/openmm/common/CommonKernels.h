@@ -249,7 +249,7 @@ public:
 private:
     class ForceInfo;
     int numBonds;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -293,7 +293,7 @@ public:
 private:
     class ForceInfo;
     int numBonds;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -336,7 +336,7 @@ public:
 private:
     class ForceInfo;
     int numAngles;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -380,7 +380,7 @@ public:
 private:
     class ForceInfo;
     int numAngles;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -423,7 +423,7 @@ public:
 private:
     class ForceInfo;
     int numTorsions;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -464,7 +464,7 @@ public:
 private:
     class ForceInfo;
     int numTorsions;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -509,7 +509,7 @@ public:
 private:
     class ForceInfo;
     int numTorsions;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -550,7 +550,7 @@ public:
 private:
     class ForceInfo;
     int numTorsions;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -597,7 +597,7 @@ public:
 private:
     class ForceInfo;
     int numParticles;
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ForceInfo* info;
     const System& system;
@@ -1344,7 +1344,7 @@ private:
  */
 class CommonCalcATMForceKernel : public CalcATMForceKernel {
 public:
-    CommonCalcATMForceKernel(std::string name, const Platform& platform, ComputeContext& cc): CalcATMForceKernel(name, platform), hasInitializedKernel(false), cc(cc) {
+    CommonCalcATMForceKernel(std::string name, const Platform& platform, ComputeContext& cc): CalcATMForceKernel(name, platform), hasInitializedKernel(false), hasInitializedSharedKernels(false), cc(cc) {
     }
 
     ~CommonCalcATMForceKernel();
@@ -1382,6 +1382,28 @@ public:
      * @param innerContext2  the second context created by the ATMForce for computing displaced energy
      */
     void copyState(ContextImpl& context, ContextImpl& innerContext1, ContextImpl& innerContext2);
+    /**
+     * Get whether this kernel implements copySharedState() and applySharedForces().
+     */
+    bool supportsSharedForces() const {
+        return true;
+    }
+    /**
+     * Copy state information to the context that computes the Forces which do not act on any
+     * displaced particle.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param sharedContext  the context created by the ATMForce for computing the energy shared by both states
+     */
+    void copySharedState(ContextImpl& context, ContextImpl& sharedContext);
+    /**
+     * Scale the forces from the shared context and apply them to the main context.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param sharedContext  the context created by the ATMForce for computing the energy shared by both states
+     * @param scale          the derivative of the final energy with respect to the shared energy
+     */
+    void applySharedForces(ContextImpl& context, ContextImpl& sharedContext, double scale);
     /**
      * Get the ComputeContext corresponding to the inner Context.
      */
@@ -1391,19 +1413,22 @@ private:
     class ReorderListener;
 
     void initKernels(ContextImpl& context, ContextImpl& innerContext0, ContextImpl& innerContext1);
+    void initSharedKernels(ContextImpl& context, ContextImpl& sharedContext);
     void loadParams(int numParticles, const ATMForce& force, std::vector<Vec3>& d1, std::vector<Vec3>& d0, std::vector<int>& j1, std::vector<int>& i1, std::vector<int>& j0, std::vector<int>& i0);
 
-    bool hasInitializedKernel;
+    bool hasInitializedKernel, hasInitializedSharedKernels;
     ComputeContext& cc;
     ComputeArray displacement1, displacement0; // fixed lab-frame displacements
     ComputeArray displParticles;               // variable displacements based on atom positions
                                                // int4 arranged as (pDestination1, pOrigin1, pDestination0, pOrigin0  
-    ComputeArray invAtomOrder, inner0InvAtomOrder, inner1InvAtomOrder;
+    ComputeArray invAtomOrder, inner0InvAtomOrder, inner1InvAtomOrder, sharedInvAtomOrder;
     ComputeArray dforce0, dforce1;             // forces due to variable displacements
     ComputeKernel copyStateKernel;
     ComputeKernel resetDisplForceKernel;
     ComputeKernel displForceKernel;
     ComputeKernel hybridForceKernel;
+    ComputeKernel copySharedStateKernel;
+    ComputeKernel sharedForceKernel;
 
     int numParticles;
 };
@@ -4166,6 +4166,7 @@ void CommonCalcATMForceKernel::initialize(const System& system, const ATMForce&
     invAtomOrder.initialize<int>(cc, cc.getPaddedNumAtoms(), "invAtomOrder");
     inner0InvAtomOrder.initialize<int>(cc, cc.getPaddedNumAtoms(), "inner0InvAtomOrder");
     inner1InvAtomOrder.initialize<int>(cc, cc.getPaddedNumAtoms(), "inner1InvAtomOrder");
+    sharedInvAtomOrder.initialize<int>(cc, cc.getPaddedNumAtoms(), "sharedInvAtomOrder");
     for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
         cc.addEnergyParameterDerivative(force.getEnergyParameterDerivativeName(i));
 }
@@ -4258,6 +4259,47 @@ void CommonCalcATMForceKernel::initKernels(ContextImpl& context, ContextImpl& in
     }
 }
 
+void CommonCalcATMForceKernel::initSharedKernels(ContextImpl& context, ContextImpl& sharedContext) {
+    if (!hasInitializedSharedKernels) {
+        hasInitializedSharedKernels = true;
+        ComputeContext& ccShared = getInnerComputeContext(sharedContext);
+
+        // Copy positions to the shared context.
+        vector<Vec3> positions;
+        context.getPositions(positions);
+        sharedContext.setPositions(positions);
+
+        // Initialize the listener.  The one for the main context is created by initKernels().
+        ReorderListener* listener = new ReorderListener(ccShared, sharedInvAtomOrder);
+        ccShared.addReorderListener(listener);
+        listener->execute();
+
+        ComputeProgram program = cc.compileProgram(CommonKernelSources::atmforce);
+
+        copySharedStateKernel = program->createKernel("copySharedState");
+        copySharedStateKernel->addArg(numParticles);
+        copySharedStateKernel->addArg(cc.getPosq());
+        copySharedStateKernel->addArg(ccShared.getPosq());
+        copySharedStateKernel->addArg(cc.getAtomIndexArray());
+        copySharedStateKernel->addArg(sharedInvAtomOrder);
+        if (cc.getUseMixedPrecision()) {
+            copySharedStateKernel->addArg(cc.getPosqCorrection());
+            copySharedStateKernel->addArg(ccShared.getPosqCorrection());
+        }
+
+        sharedForceKernel = program->createKernel("sharedForce");
+        sharedForceKernel->addArg(numParticles);
+        sharedForceKernel->addArg(cc.getPaddedNumAtoms());
+        sharedForceKernel->addArg(cc.getLongForceBuffer());
+        sharedForceKernel->addArg(ccShared.getLongForceBuffer());
+        sharedForceKernel->addArg(invAtomOrder);
+        sharedForceKernel->addArg(sharedInvAtomOrder);
+        sharedForceKernel->addArg();
+
+        ccShared.addForce(new ComputeForceInfo());
+    }
+}
+
 void CommonCalcATMForceKernel::applyForces(ContextImpl& context, ContextImpl& innerContext0, ContextImpl& innerContext1,
         double dEdu0, double dEdu1, const map<string, double>& energyParamDerivs) {
     ContextSelector selector(cc);
@@ -4307,6 +4349,34 @@ void CommonCalcATMForceKernel::copyState(ContextImpl& context,
         innerContext1.setParameter(param.first, context.getParameter(param.first));
 }
 
+void CommonCalcATMForceKernel::copySharedState(ContextImpl& context, ContextImpl& sharedContext) {
+    ContextSelector selector(cc);
+    initSharedKernels(context, sharedContext);
+    ComputeContext& ccShared = getInnerComputeContext(sharedContext);
+
+    Vec3 a, b, c;
+    context.getPeriodicBoxVectors(a, b, c);
+    sharedContext.setPeriodicBoxVectors(a, b, c);
+    sharedContext.setTime(context.getTime());
+
+    ccShared.reorderAtoms();
+    copySharedStateKernel->execute(numParticles);
+
+    map<string, double> innerParameters = sharedContext.getParameters();
+    for (auto& param : innerParameters)
+        sharedContext.setParameter(param.first, context.getParameter(param.first));
+}
+
+void CommonCalcATMForceKernel::applySharedForces(ContextImpl& context, ContextImpl& sharedContext, double scale) {
+    ContextSelector selector(cc);
+    initSharedKernels(context, sharedContext);
+    if (cc.getUseDoublePrecision())
+        sharedForceKernel->setArg(6, scale);
+    else
+        sharedForceKernel->setArg(6, (float) scale);
+    sharedForceKernel->execute(numParticles);
+}
+
 void CommonCalcATMForceKernel::copyParametersToContext(ContextImpl& context, const ATMForce& force) {
     ContextSelector selector(cc);
     if (force.getNumParticles() != numParticles)
@@ -26,6 +26,22 @@ KERNEL void hybridForce(int numParticles,
     }
 }
 
+KERNEL void sharedForce(int numParticles,
+                        int paddedNumParticles,
+                        GLOBAL mm_long* RESTRICT force,
+                        GLOBAL mm_long* RESTRICT forceShared,
+                        GLOBAL int* RESTRICT invAtomOrder,
+                        GLOBAL int* RESTRICT sharedInvAtomOrder,
+                        real scale) {
+    for (int i = GLOBAL_ID; i < numParticles; i += GLOBAL_SIZE) {
+        int index = invAtomOrder[i];
+        int indexShared = sharedInvAtomOrder[i];
+        force[index]                      += (mm_long) (scale*forceShared[indexShared]);
+        force[index+paddedNumParticles]   += (mm_long) (scale*forceShared[indexShared+paddedNumParticles]);
+        force[index+paddedNumParticles*2] += (mm_long) (scale*forceShared[indexShared+paddedNumParticles*2]);
+    }
+}
+
 //reset variable displacement forces
 KERNEL void resetDisplForce(int numParticles,
                             int paddedNumParticles,
@@ -152,3 +168,25 @@ KERNEL void copyState(int numParticles,
 #endif
     }
 }
+
+KERNEL void copySharedState(int numParticles,
+                            GLOBAL real4* RESTRICT posq,
+                            GLOBAL real4* RESTRICT posqShared,
+                            GLOBAL int* RESTRICT atomOrder,
+                            GLOBAL int* RESTRICT sharedInvAtomOrder
+#ifdef USE_MIXED_PRECISION
+                            ,
+                            GLOBAL real4* RESTRICT posqCorrection,
+                            GLOBAL real4* RESTRICT posqSharedCorrection
+#endif
+                    ) {
+    for (int i = GLOBAL_ID; i < numParticles; i += GLOBAL_SIZE) {
+        int indexShared = sharedInvAtomOrder[atomOrder[i]];
+        real4 p = posq[i];
+        p.w = posqShared[indexShared].w;
+        posqShared[indexShared] = p;
+#ifdef USE_MIXED_PRECISION
+        posqSharedCorrection[indexShared] = posqCorrection[i];
+#endif
+    }
+}
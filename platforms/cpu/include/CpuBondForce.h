@@ -59,9 +59,23 @@ public:
      */
     void threadComputeForce(ThreadPool& threads, int threadIndex, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<std::vector<double> >& parameters,
             std::vector<OpenMM::Vec3>& forces, double* totalEnergy, ReferenceBondIxn& referenceBondIxn);
+    /**
+     * Get the bonds assigned to a thread.  No two threads have bonds that share an atom, so
+     * the bonds for different threads can be processed at the same time.
+     */
+    const std::vector<int>& getThreadBonds(int threadIndex) const {
+        return threadBonds[threadIndex];
+    }
+    /**
+     * Get the bonds that could not be assigned to any thread.  They must be processed after
+     * all the threads have finished.
+     */
+    const std::vector<int>& getExtraBonds() const {
+        return extraBonds;
+    }
 private:
     bool canAssignBond(int bond, int thread, std::vector<int>& atomThread);
-    void assignBond(int bond, int thread, std::vector<int>& atomThread, std::vector<int>& bondThread, std::vector<std::set<int> >& atomBonds, std::list<int>& candidateBonds);
+    void assignBond(int bond, int thread, std::vector<int>& atomThread, std::vector<int>& bondThread, const std::vector<int>& atomBondStart, const std::vector<int>& atomBonds, std::list<int>& candidateBonds);
     int numBonds, numAtomsPerBond;
     std::vector<int>* bondAtoms;
     ThreadPool* threads;
@@ -0,0 +1,125 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_CMAP_TORSION_FORCE_H__
+#define OPENMM_CPU_CMAP_TORSION_FORCE_H__
+
+#include "CpuBondForce.h"
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes a CMAPTorsionForce.  The torsion pairs are divided between threads with
+ * CpuBondForce, so each thread can add forces directly to the force array.  Each thread processes
+ * its torsion pairs in blocks, first computing both dihedral angles for every pair in the block,
+ * then evaluating the bicubic patches, then applying the forces.  The coefficients for all maps
+ * are stored in a single contiguous array, with the 16 coefficients of each patch adjacent.
+ */
+class CpuCMAPTorsionForce {
+public:
+    /**
+     * Create a new CpuCMAPTorsionForce.
+     *
+     * @param numAtoms        the number of atoms in the system
+     * @param torsionAtoms    the eight atoms that define each torsion pair
+     * @param threads         the thread pool to use
+     */
+    CpuCMAPTorsionForce(int numAtoms, const std::vector<std::vector<int> >& torsionAtoms, ThreadPool& threads);
+
+    /**
+     * Set the maps and which one is used by each torsion pair.
+     *
+     * @param torsionMaps     the index of the map used by each torsion pair
+     * @param coeff           coeff[i][j] contains the 16 spline coefficients for patch j of map i, as computed by CMAPTorsionForceImpl::calcMapDerivatives()
+     */
+    void setMaps(const std::vector<int>& torsionMaps, const std::vector<std::vector<std::vector<double> > >& coeff);
+
+    /**
+     * Set the force to use periodic boundary conditions.
+     *
+     * @param periodicBoxVectors    the vectors defining the periodic box
+     */
+    void setPeriodic(Vec3* periodicBoxVectors);
+
+    /**
+     * Calculate the interaction.
+     *
+     * @param positions    atom coordinates
+     * @param forces       forces on atoms are added to this
+     * @return the energy of the interaction
+     */
+    double calculateIxn(const std::vector<Vec3>& positions, std::vector<Vec3>& forces);
+
+private:
+    class ThreadData;
+    static const int BlockSize = 32;
+    ThreadPool& threads;
+    bool usePeriodic;
+    Vec3 periodicBoxVectors[3];
+    std::vector<int> torsionMaps;
+    std::vector<std::vector<int> > torsionAtoms;
+    std::vector<int> mapSize, mapOffset;
+    std::vector<double> coefficients;
+    CpuBondForce bondForce;
+    std::vector<ThreadData> threadData;
+    // The following variables are used to make information accessible to the individual threads.
+    const Vec3* positions;
+    Vec3* forces;
+
+    /**
+     * Compute the interactions for a list of torsion pairs.
+     */
+    void computeTorsions(const std::vector<int>& torsions, ThreadData& data);
+
+    /**
+     * Compute the interactions for a block of torsion pairs.
+     */
+    void computeBlock(const int* torsions, int numTorsions, ThreadData& data);
+
+    /**
+     * Compute the displacement between two positions, applying periodic boundary conditions if appropriate.
+     */
+    Vec3 computeDelta(const Vec3& pos1, const Vec3& pos2) const;
+};
+
+class CpuCMAPTorsionForce::ThreadData {
+public:
+    // Values for the two dihedrals of each torsion pair in the block.
+    std::vector<Vec3> delta[2][3], cross[2][2];
+    std::vector<double> angle[2], dEdAngle[2];
+    double energy;
+    ThreadData();
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_CMAP_TORSION_FORCE_H__
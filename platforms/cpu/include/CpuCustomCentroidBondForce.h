@@ -0,0 +1,151 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_CUSTOM_CENTROID_BOND_FORCE_H__
+#define OPENMM_CPU_CUSTOM_CENTROID_BOND_FORCE_H__
+
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include "AlignedArray.h"
+#include "lepton/CompiledExpression.h"
+#include "lepton/ParsedExpression.h"
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes a CustomCentroidBondForce.  The group centers are computed in parallel,
+ * then the bonds are divided into blocks that are processed by different threads, evaluating
+ * the energy and all its derivatives for a whole block at once.  Finally the forces on groups
+ * are distributed to their atoms in parallel.
+ *
+ * The energy is computed in double precision.  It depends on the absolute coordinates of the
+ * group centers, and the point functions take differences between them, so single precision
+ * would lose too much accuracy.
+ */
+class CpuCustomCentroidBondForce {
+public:
+    /**
+     * Create a new CpuCustomCentroidBondForce.
+     *
+     * @param numGroupsPerBond       the number of groups in each bond
+     * @param groupAtoms             the atoms in each group
+     * @param normalizedWeights      the normalized weight of each atom in each group
+     * @param bondGroups             the groups in each bond
+     * @param energyExpression       the expression for the energy of each bond
+     * @param bondParameterNames     the names of the per-bond parameters
+     * @param energyParamDerivNames  the names of parameters to compute derivatives of the energy with respect to
+     * @param threads                the thread pool to use
+     */
+    CpuCustomCentroidBondForce(int numGroupsPerBond, const std::vector<std::vector<int> >& groupAtoms,
+                               const std::vector<std::vector<double> >& normalizedWeights, const std::vector<std::vector<int> >& bondGroups,
+                               const Lepton::ParsedExpression& energyExpression, const std::vector<std::string>& bondParameterNames,
+                               const std::vector<std::string>& energyParamDerivNames, ThreadPool& threads);
+
+    ~CpuCustomCentroidBondForce();
+
+    /**
+     * Get the list of groups in each bond.
+     */
+    const std::vector<std::vector<int> >& getBondGroups() const {
+        return bondGroups;
+    }
+
+    /**
+     * Set the values of the per-bond parameters.
+     *
+     * @param bondParameters  bondParameters[i][j] is the value of parameter j for bond i
+     */
+    void setBondParameters(const std::vector<std::vector<double> >& bondParameters);
+
+    /**
+     * Calculate the interaction.
+     *
+     * @param positions          atom coordinates
+     * @param globalParameters   the values of global parameters
+     * @param threadForce        the collection of arrays for each thread to add forces to
+     * @param includeForces      whether to compute forces
+     * @param includeEnergy      whether to compute energy
+     * @param energyParamDerivs  derivatives of the energy with respect to parameters are added to this
+     * @return the energy of the interaction
+     */
+    double calculateIxn(const std::vector<Vec3>& positions, const std::map<std::string, double>& globalParameters,
+                        std::vector<AlignedArray<float> >& threadForce, bool includeForces, bool includeEnergy, double* energyParamDerivs);
+
+private:
+    class ThreadData;
+    static const int BlockSize = 64;
+    ThreadPool& threads;
+    int numGroupsPerBond, numEnergyParamDerivs;
+    std::vector<std::vector<int> > groupAtoms;
+    std::vector<std::vector<double> > normalizedWeights;
+    std::vector<std::vector<int> > bondGroups;
+    std::vector<std::string> bondParameterNames;
+    std::vector<std::vector<double> > bondParameterValues;
+    std::vector<Vec3> groupCenters;
+    std::vector<ThreadData*> threadData;
+    // The following variables are used to make information accessible to the individual threads.
+    const Vec3* positions;
+    const std::map<std::string, double>* globalParameters;
+    std::vector<AlignedArray<float> >* threadForce;
+    bool includeForces, includeEnergy;
+    std::atomic<int> atomicCounter;
+
+    /**
+     * Compute the centers of a range of groups.
+     */
+    void threadComputeCenters(ThreadPool& threads, int threadIndex);
+
+    /**
+     * Compute the forces on groups for blocks of bonds.
+     */
+    void threadComputeBonds(ThreadPool& threads, int threadIndex);
+
+    /**
+     * Apply the forces on a range of groups to their atoms.
+     */
+    void threadApplyForces(ThreadPool& threads, int threadIndex);
+};
+
+class CpuCustomCentroidBondForce::ThreadData {
+public:
+    Lepton::CompiledExpression expression;
+    std::vector<std::vector<double> > coordinates, values;
+    std::vector<Vec3> groupForces;
+    std::vector<double> energyParamDerivs;
+    double energy;
+    ThreadData(const Lepton::CompiledExpression& expression, int numGroups, int numGroupsPerBond, int numEnergyParamDerivs);
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_CUSTOM_CENTROID_BOND_FORCE_H__
@@ -0,0 +1,185 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_CUSTOM_COMPOUND_BOND_FORCE_H__
+#define OPENMM_CPU_CUSTOM_COMPOUND_BOND_FORCE_H__
+
+#include "CpuBondForce.h"
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include "lepton/CompiledExpression.h"
+#include "lepton/CompiledVectorExpression.h"
+#include "lepton/ExpressionTreeNode.h"
+#include "lepton/ParsedExpression.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes a CustomCompoundBondForce.  The bonds are divided between threads with
+ * CpuBondForce, so that each thread can add forces directly to the force array.  Each thread
+ * processes its bonds in blocks.  All the distances, angles, and dihedrals used by the energy
+ * are computed for a whole block at once, then the energy and its derivatives are evaluated for
+ * the block by a single compiled expression, and finally the forces are found by applying the
+ * chain rule to the geometric terms.
+ *
+ * When the energy depends on particle positions only through geometric terms, the terms and
+ * forces are computed four bonds at a time with SIMD, and the expression is evaluated in single
+ * precision with a CompiledVectorExpression.  Expressions that use the coordinates directly are
+ * evaluated in double precision with a CompiledExpression.
+ */
+class CpuCustomCompoundBondForce {
+public:
+    /**
+     * Create a new CpuCustomCompoundBondForce.
+     *
+     * @param numAtoms               the number of atoms in the system
+     * @param numParticlesPerBond    the number of particles in each bond
+     * @param bondAtoms              the particles in each bond
+     * @param energyExpression       the expression for the energy of each bond, as returned by CustomCompoundBondForceImpl::prepareExpression()
+     * @param bondParameterNames     the names of the per-bond parameters
+     * @param energyParamDerivNames  the names of parameters to compute derivatives of the energy with respect to
+     * @param threads                the thread pool to use
+     */
+    CpuCustomCompoundBondForce(int numAtoms, int numParticlesPerBond, const std::vector<std::vector<int> >& bondAtoms,
+                               const Lepton::ParsedExpression& energyExpression, const std::vector<std::string>& bondParameterNames,
+                               const std::vector<std::string>& energyParamDerivNames, ThreadPool& threads);
+
+    ~CpuCustomCompoundBondForce();
+
+    /**
+     * Get the list of particles in each bond.
+     */
+    const std::vector<std::vector<int> >& getBondAtoms() const {
+        return bondAtoms;
+    }
+
+    /**
+     * Set the force to use periodic boundary conditions.
+     *
+     * @param periodicBoxVectors    the vectors defining the periodic box
+     */
+    void setPeriodic(Vec3* periodicBoxVectors);
+
+    /**
+     * Set the values of the per-bond parameters.
+     *
+     * @param bondParameters  bondParameters[i][j] is the value of parameter j for bond i
+     */
+    void setBondParameters(const std::vector<std::vector<double> >& bondParameters);
+
+    /**
+     * Calculate the interaction.
+     *
+     * @param positions          atom coordinates
+     * @param globalParameters   the values of global parameters
+     * @param forces             forces on atoms are added to this
+     * @param includeForces      whether to compute forces
+     * @param includeEnergy      whether to compute energy
+     * @param energyParamDerivs  derivatives of the energy with respect to parameters are added to this
+     * @return the energy of the interaction
+     */
+    double calculateIxn(const std::vector<Vec3>& positions, const std::map<std::string, double>& globalParameters,
+                        std::vector<Vec3>& forces, bool includeForces, bool includeEnergy, double* energyParamDerivs);
+
+private:
+    class TermInfo;
+    class ThreadData;
+    static const int BlockSize = 64;
+    ThreadPool& threads;
+    int numParticlesPerBond, numEnergyParamDerivs;
+    bool usePeriodic, useVectorExpression;
+    Vec3 periodicBoxVectors[3];
+    std::vector<std::vector<int> > bondAtoms;
+    CpuBondForce bondForce;
+    std::vector<std::string> bondParameterNames;
+    std::vector<std::vector<double> > bondParameters;
+    std::vector<TermInfo> terms;
+    std::vector<std::pair<int, int> > coordinateDerivs;
+    std::vector<ThreadData*> threadData;
+    // The following variables are used to make information accessible to the individual threads.
+    const Vec3* positions;
+    Vec3* forces;
+    bool includeForces, includeEnergy;
+
+    /**
+     * Replace every call to pointdistance(), pointangle(), or pointdihedral() whose arguments are
+     * simply particle coordinates with a variable, and record the geometric term it represents.
+     */
+    Lepton::ExpressionTreeNode replacePointFunctions(const Lepton::ExpressionTreeNode& node, const std::map<std::string, std::pair<int, int> >& coordinates);
+
+    /**
+     * Compute the interactions for a list of bonds.
+     */
+    void computeBonds(const std::vector<int>& bonds, ThreadData& data);
+
+    /**
+     * Compute the interactions for a block of bonds in double precision.
+     */
+    void computeBlock(const int* bonds, int numBonds, ThreadData& data);
+
+    /**
+     * Compute the interactions for a block of bonds with SIMD.  This is only used when the
+     * expression does not depend directly on coordinates.
+     */
+    void computeBlockVectorized(const int* bonds, int numBonds, ThreadData& data);
+
+    /**
+     * Compute the displacement between two positions, applying periodic boundary conditions if appropriate.
+     */
+    Vec3 computeDelta(const Vec3& pos1, const Vec3& pos2) const;
+};
+
+class CpuCustomCompoundBondForce::TermInfo {
+public:
+    enum Type {Distance, Angle, Dihedral};
+    std::string name;
+    Type type;
+    std::vector<int> atoms;
+    TermInfo(const std::string& name, Type type, const std::vector<int>& atoms) : name(name), type(type), atoms(atoms) {
+    }
+};
+
+class CpuCustomCompoundBondForce::ThreadData {
+public:
+    Lepton::CompiledExpression expression;
+    Lepton::CompiledVectorExpression vecExpression;
+    std::vector<std::vector<double> > coordinates, parameters, termValues, deltas, values;
+    std::vector<std::vector<float> > vecParameters, vecTermValues, vecDeltas, vecValues;
+    std::vector<double> energyParamDerivs;
+    double energy;
+    ThreadData(const Lepton::CompiledExpression& expression, int numCoordinates, int numParameters, int numTerms, int numValues, int numEnergyParamDerivs);
+    ThreadData(const Lepton::CompiledVectorExpression& vecExpression, int numParameters, int numTerms, int numValues, int numEnergyParamDerivs);
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_CUSTOM_COMPOUND_BOND_FORCE_H__
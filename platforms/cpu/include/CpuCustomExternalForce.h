@@ -0,0 +1,116 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_CUSTOM_EXTERNAL_FORCE_H__
+#define OPENMM_CPU_CUSTOM_EXTERNAL_FORCE_H__
+
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include "AlignedArray.h"
+#include "lepton/CompiledVectorExpression.h"
+#include "lepton/ParsedExpression.h"
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes a CustomExternalForce.  The particles are divided into blocks that are
+ * processed in parallel, and the energy and its gradient are evaluated for a whole block at
+ * once with a CompiledVectorExpression.
+ */
+class CpuCustomExternalForce {
+public:
+    /**
+     * Create a new CpuCustomExternalForce.
+     *
+     * @param energyExpression   the expression for the energy of each particle
+     * @param parameterNames     the names of the per-particle parameters
+     * @param particles          the index of each particle the force is applied to
+     * @param threads            the thread pool to use
+     */
+    CpuCustomExternalForce(const Lepton::ParsedExpression& energyExpression, const std::vector<std::string>& parameterNames,
+                           const std::vector<int>& particles, ThreadPool& threads);
+
+    ~CpuCustomExternalForce();
+
+    /**
+     * Set the values of the per-particle parameters.
+     *
+     * @param particleParameters  particleParameters[i][j] is the value of parameter j for the i'th particle the force is applied to
+     */
+    void setParticleParameters(const std::vector<std::vector<double> >& particleParameters);
+
+    /**
+     * Calculate the interaction.
+     *
+     * @param positions          atom coordinates
+     * @param globalParameters   the values of global parameters
+     * @param threadForce        the collection of arrays for each thread to add forces to
+     * @param includeForces      whether to compute forces
+     * @param includeEnergy      whether to compute energy
+     * @return the energy of the interaction
+     */
+    double calculateIxn(const std::vector<Vec3>& positions, const std::map<std::string, double>& globalParameters,
+                        std::vector<AlignedArray<float> >& threadForce, bool includeForces, bool includeEnergy);
+
+private:
+    class ThreadData;
+    static const int BlockSize = 256;
+    ThreadPool& threads;
+    std::vector<int> particles;
+    std::vector<std::string> parameterNames;
+    std::vector<std::vector<float> > parameterValues;
+    std::vector<ThreadData*> threadData;
+    // The following variables are used to make information accessible to the individual threads.
+    const Vec3* positions;
+    const std::map<std::string, double>* globalParameters;
+    std::vector<AlignedArray<float> >* threadForce;
+    bool includeForces, includeEnergy;
+    std::atomic<int> atomicCounter;
+
+    /**
+     * This routine contains the code executed by each thread.
+     */
+    void threadComputeForce(ThreadPool& threads, int threadIndex);
+};
+
+class CpuCustomExternalForce::ThreadData {
+public:
+    Lepton::CompiledVectorExpression expression;
+    std::vector<float> x, y, z, energy, forceX, forceY, forceZ;
+    double totalEnergy;
+    ThreadData(const Lepton::CompiledVectorExpression& expression);
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_CUSTOM_EXTERNAL_FORCE_H__
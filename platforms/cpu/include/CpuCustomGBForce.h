@@ -182,7 +182,10 @@ private:
 public:
 
     /**
-     * Construct a new CpuCustomGBForce.
+     * Construct a new CpuCustomGBForce.  Each element of energyExpressions computes an energy term
+     * followed by all the derivatives of it that are needed: with respect to r and each computed
+     * value (for pair terms) or each computed value and x, y, and z (for single particle terms),
+     * and finally with respect to each global parameter whose derivative is requested.
      */
 
      CpuCustomGBForce(int numAtoms, const std::vector<std::set<int> >& exclusions,
@@ -193,9 +196,6 @@ public:
                         const std::vector<std::string>& valueNames,
                         const std::vector<CustomGBForce::ComputationType>& valueTypes,
                         const std::vector<Lepton::CompiledExpression>& energyExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
                         const std::vector<CustomGBForce::ComputationType>& energyTypes,
                         const std::vector<std::string>& parameterNames, ThreadPool& threads);
 
@@ -245,9 +245,6 @@ public:
                const std::vector<std::vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                const std::vector<std::string>& valueNames,
                const std::vector<Lepton::CompiledExpression>& energyExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
                const std::vector<std::string>& parameterNames);
     CompiledExpressionSet expressionSet;
     std::vector<Lepton::CompiledExpression> valueExpressions;
@@ -256,9 +253,6 @@ public:
     std::vector<std::vector<Lepton::CompiledExpression> > valueParamDerivExpressions;
     std::vector<double> value;
     std::vector<Lepton::CompiledExpression> energyExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyDerivExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyGradientExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyParamDerivExpressions;
     std::vector<double> param;
     std::vector<double> particleParam;
     std::vector<double> particleValue;
@@ -0,0 +1,209 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_CUSTOM_HBOND_FORCE_H__
+#define OPENMM_CPU_CUSTOM_HBOND_FORCE_H__
+
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include "AlignedArray.h"
+#include "lepton/CompiledExpression.h"
+#include "lepton/ParsedExpression.h"
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes a CustomHbondForce.  When a cutoff is used, the acceptors are sorted into
+ * a grid of cells whose width is at least the cutoff distance, so each donor only needs to
+ * consider the acceptors in the surrounding 27 cells.  The donors are divided between threads,
+ * and the energy and its derivatives with respect to every distance, angle, and dihedral are
+ * computed together by a single compiled expression.
+ */
+class CpuCustomHbondForce {
+public:
+    /**
+     * Create a new CpuCustomHbondForce.
+     *
+     * @param donorAtoms              the atoms in each donor group
+     * @param acceptorAtoms           the atoms in each acceptor group
+     * @param exclusions              exclusions[i] contains the acceptors excluded from interacting with donor i
+     * @param energyExpression        the expression for the energy of each interaction
+     * @param donorParameterNames     the names of the per-donor parameters
+     * @param acceptorParameterNames  the names of the per-acceptor parameters
+     * @param distances               the distances the energy depends on, as returned by CustomHbondForceImpl::prepareExpression()
+     * @param angles                  the angles the energy depends on, as returned by CustomHbondForceImpl::prepareExpression()
+     * @param dihedrals               the dihedrals the energy depends on, as returned by CustomHbondForceImpl::prepareExpression()
+     * @param threads                 the thread pool to use
+     */
+    CpuCustomHbondForce(const std::vector<std::vector<int> >& donorAtoms, const std::vector<std::vector<int> >& acceptorAtoms,
+                        const std::vector<std::set<int> >& exclusions, const Lepton::ParsedExpression& energyExpression,
+                        const std::vector<std::string>& donorParameterNames, const std::vector<std::string>& acceptorParameterNames,
+                        const std::map<std::string, std::vector<int> >& distances, const std::map<std::string, std::vector<int> >& angles,
+                        const std::map<std::string, std::vector<int> >& dihedrals, ThreadPool& threads);
+
+    ~CpuCustomHbondForce();
+
+    /**
+     * Get the list of atoms for each donor group.
+     */
+    const std::vector<std::vector<int> >& getDonorAtoms() const {
+        return donorAtoms;
+    }
+
+    /**
+     * Get the list of atoms for each acceptor group.
+     */
+    const std::vector<std::vector<int> >& getAcceptorAtoms() const {
+        return acceptorAtoms;
+    }
+
+    /**
+     * Set the force to use a cutoff.
+     *
+     * @param distance   the cutoff distance
+     */
+    void setUseCutoff(double distance);
+
+    /**
+     * Set the force to use periodic boundary conditions.  This requires that a cutoff has
+     * already been set, and the smallest side of the periodic box is at least twice the cutoff
+     * distance.
+     *
+     * @param periodicBoxVectors    the vectors defining the periodic box
+     */
+    void setPeriodic(Vec3* periodicBoxVectors);
+
+    /**
+     * Set the values of the per-donor and per-acceptor parameters.
+     *
+     * @param donorParameters     donorParameters[i][j] is the value of parameter j for donor i
+     * @param acceptorParameters  acceptorParameters[i][j] is the value of parameter j for acceptor i
+     */
+    void setParameters(const std::vector<std::vector<double> >& donorParameters, const std::vector<std::vector<double> >& acceptorParameters);
+
+    /**
+     * Calculate the interaction.
+     *
+     * @param positions          atom coordinates
+     * @param globalParameters   the values of global parameters
+     * @param threadForce        the collection of arrays for each thread to add forces to
+     * @param includeForces      whether to compute forces
+     * @param includeEnergy      whether to compute energy
+     * @return the energy of the interaction
+     */
+    double calculateIxn(const std::vector<Vec3>& positions, const std::map<std::string, double>& globalParameters,
+                        std::vector<AlignedArray<float> >& threadForce, bool includeForces, bool includeEnergy);
+
+private:
+    class TermInfo;
+    class ThreadData;
+    ThreadPool& threads;
+    bool useCutoff, usePeriodic;
+    double cutoffDistance;
+    Vec3 periodicBoxVectors[3];
+    std::vector<std::vector<int> > donorAtoms, acceptorAtoms;
+    std::vector<std::vector<int> > exclusions;
+    std::vector<std::string> donorParamNames, acceptorParamNames;
+    std::vector<std::vector<double> > donorParamValues, acceptorParamValues;
+    std::vector<TermInfo> terms;
+    std::vector<int> atomsUsed;
+    std::vector<ThreadData*> threadData;
+    // The cell grid used to find acceptors near each donor.
+    int numCells[3];
+    Vec3 gridOrigin, gridScale;
+    std::vector<int> cellStart, cellAcceptors;
+    // The following variables are used to make information accessible to the individual threads.
+    const Vec3* positions;
+    std::vector<AlignedArray<float> >* threadForce;
+    bool includeForces, includeEnergy;
+    std::atomic<int> atomicCounter;
+
+    /**
+     * Sort the acceptors into cells.
+     */
+    void buildCellGrid();
+
+    /**
+     * Get the cell containing a position.  With periodic boundary conditions the position is
+     * first wrapped into the box.  Otherwise, positions outside the grid are assigned to the
+     * nearest cell.
+     */
+    void getCell(const Vec3& pos, int* cell) const;
+
+    /**
+     * This routine contains the code executed by each thread.
+     */
+    void threadComputeForce(ThreadPool& threads, int threadIndex);
+
+    /**
+     * Compute the interaction between one donor and one acceptor, if they are within the cutoff.
+     */
+    void calculateOneIxn(int donor, int acceptor, ThreadData& data, Vec3* forces);
+
+    /**
+     * Compute the displacement from atom1 to atom2.  On output, delta[0..2] contain the
+     * displacement, delta[3] the squared distance, and delta[4] the distance.
+     */
+    void computeDelta(int atom1, int atom2, double* delta) const;
+};
+
+class CpuCustomHbondForce::TermInfo {
+public:
+    enum Type {Distance, Angle, Dihedral};
+    std::string name;
+    Type type;
+    int atoms[4];
+    TermInfo(const std::string& name, Type type, const std::vector<int>& termAtoms);
+};
+
+class CpuCustomHbondForce::ThreadData {
+public:
+    Lepton::CompiledExpression expression;
+    std::vector<double*> termValues, donorParams, acceptorParams;
+    std::vector<double> deltas, crossProducts;
+    std::vector<Vec3> forces;
+    double unused;
+    double energy;
+    ThreadData(const Lepton::CompiledExpression& expression, const std::vector<TermInfo>& terms,
+               const std::vector<std::string>& donorParamNames, const std::vector<std::string>& acceptorParamNames);
+
+    /**
+     * Get a pointer to where the value of a variable should be stored.
+     */
+    double* getVariablePointer(const std::string& name);
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_CUSTOM_HBOND_FORCE_H__
@@ -55,7 +55,7 @@ private:
     AlignedArray<fvec4> periodicBoxVec4;
     CpuNeighborList* neighborList;
     ThreadPool& threads;
-    std::vector<std::set<int> > exclusions;
+    CpuExclusionList exclusions;
     std::vector<int> particleTypes;
     std::vector<int> orderIndex;
     std::vector<std::vector<int> > particleOrder;
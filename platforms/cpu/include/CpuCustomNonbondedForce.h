@@ -193,13 +193,12 @@ protected:
 
 class CpuCustomNonbondedForce::ThreadData {
 public:
-    ThreadData(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledVectorExpression& energyVecExpression,
-            const Lepton::CompiledExpression& forceExpression, const Lepton::CompiledVectorExpression& forceVecExpression, const std::vector<std::string>& parameterNames,
-            const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions, const std::vector<std::string>& computedValueNames,
+    ThreadData(const Lepton::CompiledExpression& expression, const Lepton::CompiledVectorExpression& vecExpression,
+            const std::vector<std::string>& parameterNames, const std::vector<std::string>& computedValueNames,
             const std::vector<Lepton::CompiledExpression> computedValueExpressions, std::vector<std::vector<double> >& atomComputedValues);
-    Lepton::CompiledExpression energyExpression, forceExpression;
-    Lepton::CompiledVectorExpression energyVecExpression, forceVecExpression;
-    std::vector<Lepton::CompiledExpression> computedValueExpressions, energyParamDerivExpressions;
+    Lepton::CompiledExpression expression;
+    Lepton::CompiledVectorExpression vecExpression;
+    std::vector<Lepton::CompiledExpression> computedValueExpressions;
     CompiledExpressionSet expressionSet;
     std::vector<double> particleParam, computedValues;
     std::vector<float> rvec, vecParticle1Params, vecParticle2Params, vecParticle1Values, vecParticle2Values;
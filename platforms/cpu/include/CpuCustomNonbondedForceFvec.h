@@ -170,10 +170,11 @@ void CpuCustomNonbondedForceFvec<FVEC, BLOCK_SIZE>::calculateBlockIxnImpl(Thread
         const auto inverseR = rsqrt(r2);
         const auto r = r2*inverseR;
         r.store(data.rvec.data());
-        FVEC dEdR(data.forceVecExpression.evaluate());
+        data.vecExpression.evaluate();
+        FVEC dEdR(data.vecExpression.getValue(1));
         FVEC energy;
         if (includeEnergy || useSwitch)
-            energy = FVEC(data.energyVecExpression.evaluate());
+            energy = FVEC(data.vecExpression.getValue(0));
         if (useSwitch) {
             const auto t = blendZero((r-switchingDistance)*invSwitchingInterval, r>switchingDistance);
             const auto switchValue = 1+t*t*t*(-10.0f+t*(15.0f-t*6.0f));
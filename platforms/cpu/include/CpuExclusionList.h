@@ -0,0 +1,120 @@
+#ifndef OPENMM_CPU_EXCLUSIONLIST_H_
+#define OPENMM_CPU_EXCLUSIONLIST_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "windowsExportCpu.h"
+#include "openmm/internal/ThreadPool.h"
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class stores the exclusions for a set of atoms in compressed sparse row format.  The
+ * exclusions for each atom are stored as a sorted list of atom indices, and the lists for all
+ * atoms are packed into a single array.  This takes much less memory than a vector<set<int> >
+ * and can be scanned with sequential memory access.
+ */
+class OPENMM_EXPORT_CPU CpuExclusionList {
+public:
+    /**
+     * Create an empty list with no atoms.
+     */
+    CpuExclusionList();
+    /**
+     * Create a list for a set of atoms with no exclusions.
+     *
+     * @param numAtoms    the number of atoms
+     */
+    explicit CpuExclusionList(int numAtoms);
+    /**
+     * Create a list from a set of exclusions.
+     *
+     * @param exclusions  exclusions[i] contains the indices of all atoms with which atom i should not interact
+     */
+    explicit CpuExclusionList(const std::vector<std::set<int> >& exclusions);
+    /**
+     * Create a list from pairs of atoms that should not interact.  This is much faster than building
+     * a vector<set<int> > for very large systems.  Each pair is added in both directions, and
+     * duplicate pairs are allowed.  The per-atom lists are sorted in parallel.
+     *
+     * @param numAtoms    the number of atoms
+     * @param pairs       each element is a pair of atoms that should not interact
+     * @param threads     the ThreadPool to use for sorting
+     */
+    CpuExclusionList(int numAtoms, const std::vector<std::pair<int, int> >& pairs, ThreadPool& threads);
+    /**
+     * Get the number of atoms.
+     */
+    int getNumAtoms() const {
+        return offsets.size()-1;
+    }
+    /**
+     * Get the number of atoms an atom is excluded from interacting with.
+     */
+    int getNumExclusions(int atom) const {
+        return offsets[atom+1]-offsets[atom];
+    }
+    /**
+     * Get a pointer to the sorted list of atoms an atom is excluded from interacting with.  It
+     * contains getNumExclusions(atom) elements.
+     */
+    const int* getExclusions(int atom) const {
+        return indices.data()+offsets[atom];
+    }
+    /**
+     * Get whether two atoms are excluded from interacting with each other.
+     */
+    bool isExcluded(int atom1, int atom2) const;
+    /**
+     * Get a value that identifies the contents of this list.  Every list that is constructed gets a
+     * different value, and a copy has the same value as the list it was copied from.  Because a list
+     * cannot be modified after it is created, two lists with the same version have the same contents.
+     */
+    long long getVersion() const {
+        return version;
+    }
+    bool operator==(const CpuExclusionList& other) const {
+        return offsets == other.offsets && indices == other.indices;
+    }
+    bool operator!=(const CpuExclusionList& other) const {
+        return !(*this == other);
+    }
+private:
+    std::vector<int> offsets, indices;
+    long long version;
+    static long long createVersion();
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_EXCLUSIONLIST_H_
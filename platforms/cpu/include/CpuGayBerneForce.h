@@ -53,13 +53,12 @@ public:
      * Compute the interaction.
      *
      * @param positions     the positions of the atoms
-     * @param forces        forces will be added to this vector
-     * @param threadForce   individual threads can add their forces to this vector
+     * @param threadForce   individual threads add their forces to this vector
      * @param boxVectors    the periodic box vectors
      * @param data          the platform data for the current context
      * @return the energy of the interaction
      */
-    double calculateForce(const std::vector<Vec3>& positions, std::vector<Vec3>& forces, std::vector<AlignedArray<float> >& threadForce, Vec3* boxVectors, CpuPlatform::PlatformData& data);
+    double calculateForce(const std::vector<Vec3>& positions, std::vector<AlignedArray<float> >& threadForce, Vec3* boxVectors, CpuPlatform::PlatformData& data);
 
     /**
      * This routine contains the code executed by each thread.
@@ -83,20 +82,32 @@ private:
     bool useSwitchingFunction;
     std::vector<double> s;
     std::vector<Matrix> A, B, G;
+    std::vector<Vec3> xAxis, xAxisScaled, yAxisScaled;
     std::vector<double> threadEnergy;
-    std::vector<std::vector<Vec3> > threadTorque;
     // The following variables are used to make information accessible to the individual threads.
     Vec3 const* positions;
+    float const* posq;
     std::vector<AlignedArray<float> >* threadForce;
     Vec3* boxVectors;
+    float boxSize[3], recipBoxSize[3];
+    bool triclinic, useSingleDistances;
     std::atomic<int> atomicCounter;
 
-    void computeEllipsoidFrames(const std::vector<Vec3>& positions);
-    
-    void applyTorques(const std::vector<Vec3>& positions, std::vector<Vec3>& forces);
+    void computeEllipsoidFrames(const std::vector<Vec3>& positions, int start, int end);
+
+    /**
+     * Compute the single precision squared distances between one atom and every atom in a block
+     * of the neighbor list, processing four atoms at a time.
+     */
+    void computeBlockDistances(int atom, const float* blockX, const float* blockY, const float* blockZ, int blockSize, float* r2) const;
+
+    /**
+     * Convert a torque on an ellipsoid into forces on the particles that define its orientation.
+     */
+    void applyTorque(int particle, const Vec3& torque, float* forces) const;
 
     double computeOneInteraction(int particle1, int particle2, double sigma, double epsilon, const Vec3* positions,
-            float* forces, std::vector<Vec3>& torques, const Vec3* boxVectors);
+            float* forces, const Vec3* boxVectors);
 };
 
 struct CpuGayBerneForce::ParticleInfo {
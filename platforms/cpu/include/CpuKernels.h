@@ -31,8 +31,13 @@
  * -------------------------------------------------------------------------- */
 
 #include "CpuBondForce.h"
+#include "CpuCMAPTorsionForce.h"
 #include "CpuConstantPotentialForce.h"
+#include "CpuCustomCentroidBondForce.h"
+#include "CpuCustomCompoundBondForce.h"
+#include "CpuCustomExternalForce.h"
 #include "CpuCustomGBForce.h"
+#include "CpuCustomHbondForce.h"
 #include "CpuCustomManyParticleForce.h"
 #include "CpuCustomNonbondedForce.h"
 #include "CpuGayBerneForce.h"
@@ -40,7 +45,10 @@
 #include "CpuLangevinMiddleDynamics.h"
 #include "CpuNeighborList.h"
 #include "CpuNonbondedForce.h"
+#include "CpuOrientationRestraintForce.h"
 #include "CpuPlatform.h"
+#include "CpuRGForce.h"
+#include "CpuRMSDForce.h"
 #include "ReferenceKernels.h"
 #include "openmm/kernels.h"
 #include "openmm/System.h"
@@ -89,10 +97,38 @@ public:
      * energy directly, <i>or</i> add it to an internal buffer so that it will be included here.
      */
     double finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid);
+    /**
+     * Get whether this kernel implements finishGroupComputation().
+     */
+    bool supportsGroupComputation() const {
+        return true;
+    }
+    /**
+     * This is called by ContextImpl::calcForcesAndEnergyByGroup() after calcForcesAndEnergy() has been called on
+     * every ForceImpl for one force group.  It retrieves the forces and energy parameter derivatives accumulated
+     * for the group, then resets them to zero.
+     *
+     * @param context       the context in which to execute this kernel
+     * @param includeForce  true if forces should be computed
+     * @param includeEnergy true if potential energy should be computed
+     * @param group         the index of the force group that was just computed
+     * @param forces        on exit, if includeForce is true, this contains the forces from the group
+     * @param derivs        on exit, this contains the energy parameter derivatives from the group
+     * @return the potential energy of the group that was added to internal buffers
+     */
+    double finishGroupComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int group,
+            std::vector<Vec3>& forces, std::map<std::string, double>& derivs);
 private:
+    /**
+     * Add the forces accumulated by all threads to the forces stored in the context.
+     */
+    void sumThreadForces(ContextImpl& context);
     CpuPlatform::PlatformData& data;
     Kernel referenceKernel;
     std::vector<Vec3> lastPositions;
+    std::vector<double> startBusyTimes;
+    double computationStartTime;
+    bool enabledPoolTiming;
 };
 
 /**
@@ -242,6 +278,47 @@ private:
     bool usePeriodic;
 };
 
+/**
+ * This kernel is invoked by CMAPTorsionForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcCMAPTorsionForceKernel : public CalcCMAPTorsionForceKernel {
+public:
+    CpuCalcCMAPTorsionForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) :
+            CalcCMAPTorsionForceKernel(name, platform), data(data), ixn(NULL) {
+    }
+    ~CpuCalcCMAPTorsionForceKernel();
+    /**
+     * Initialize the kernel.
+     * 
+     * @param system     the System this kernel will be applied to
+     * @param force      the CMAPTorsionForce this kernel will be used for
+     */
+    void initialize(const System& system, const CMAPTorsionForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CMAPTorsionForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const CMAPTorsionForce& force);
+private:
+    CpuPlatform::PlatformData& data;
+    std::vector<std::vector<std::vector<double> > > coeff;
+    std::vector<int> torsionMaps;
+    std::vector<std::vector<int> > torsionIndices;
+    CpuCMAPTorsionForce* ixn;
+    bool usePeriodic;
+};
+
 /**
  * This kernel is invoked by NonbondedForce to calculate the forces acting on the system.
  */
@@ -303,11 +380,10 @@ private:
     int numParticles, num14, chargePosqIndex, ljPosqIndex;
     std::vector<std::vector<int> > bonded14IndexArray;
     std::vector<std::vector<double> > bonded14ParamArray;
-    std::map<int, int> nb14Index;
+    std::vector<int> nb14Index;
     double nonbondedCutoff, switchingDistance, rfDielectric, ewaldAlpha, ewaldDispersionAlpha, ewaldSelfEnergy, dispersionCoefficient, totalCharge;
     int kmax[3], gridSize[3], dispersionGridSize[3];
     bool useSwitchingFunction, exceptionsArePeriodic, useOptimizedPme, hasInitializedPme, hasInitializedDispersionPme, hasParticleOffsets, hasExceptionOffsets;
-    std::vector<std::set<int> > exclusions;
     std::vector<std::pair<float, float> > particleParams;
     std::vector<float> C6params;
     std::vector<float> charges;
@@ -530,6 +606,7 @@ private:
     double nonbondedCutoff;
     CpuCustomGBForce* ixn;
     CpuNeighborList* neighborList;
+    CpuExclusionList noExclusions;
     std::vector<std::set<int> > exclusions;
     std::vector<std::string> particleParameterNames, globalParameterNames, energyParamDerivNames, valueNames;
     std::vector<OpenMM::CustomGBForce::ComputationType> valueTypes;
@@ -581,6 +658,188 @@ private:
     NonbondedMethod nonbondedMethod;
 };
 
+/**
+ * This kernel is invoked by CustomExternalForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcCustomExternalForceKernel : public CalcCustomExternalForceKernel {
+public:
+    CpuCalcCustomExternalForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcCustomExternalForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcCustomExternalForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the CustomExternalForce this kernel will be used for
+     */
+    void initialize(const System& system, const CustomExternalForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context        the context to copy parameters to
+     * @param force          the CustomExternalForce to copy the parameters from
+     * @param firstParticle  the index of the first particle whose parameters might have changed
+     * @param lastParticle   the index of the last particle whose parameters might have changed
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, int firstParticle, int lastParticle);
+private:
+    CpuPlatform::PlatformData& data;
+    int numParticles;
+    CpuCustomExternalForce* ixn;
+    std::vector<int> particles;
+    std::vector<std::vector<double> > particleParamArray;
+    std::vector<std::string> globalParameterNames;
+    Vec3* boxVectors;
+};
+
+/**
+ * This kernel is invoked by CustomCentroidBondForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcCustomCentroidBondForceKernel : public CalcCustomCentroidBondForceKernel {
+public:
+    CpuCalcCustomCentroidBondForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcCustomCentroidBondForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcCustomCentroidBondForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the CustomCentroidBondForce this kernel will be used for
+     */
+    void initialize(const System& system, const CustomCentroidBondForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CustomCentroidBondForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomCentroidBondForce& force);
+private:
+    void createInteraction(const CustomCentroidBondForce& force);
+    CpuPlatform::PlatformData& data;
+    int numBonds;
+    std::vector<std::vector<int> > bondGroups;
+    std::vector<std::vector<int> > groupAtoms;
+    std::vector<std::vector<double> > normalizedWeights;
+    std::vector<std::vector<double> > bondParamArray;
+    CpuCustomCentroidBondForce* ixn;
+    std::vector<std::string> globalParameterNames, energyParamDerivNames;
+    std::map<std::string, int> tabulatedFunctionUpdateCount;
+    bool usePeriodic;
+    Vec3* boxVectors;
+};
+
+/**
+ * This kernel is invoked by CustomCompoundBondForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcCustomCompoundBondForceKernel : public CalcCustomCompoundBondForceKernel {
+public:
+    CpuCalcCustomCompoundBondForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcCustomCompoundBondForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcCustomCompoundBondForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the CustomCompoundBondForce this kernel will be used for
+     */
+    void initialize(const System& system, const CustomCompoundBondForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CustomCompoundBondForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomCompoundBondForce& force);
+private:
+    void createInteraction(const CustomCompoundBondForce& force);
+    CpuPlatform::PlatformData& data;
+    int numAtoms, numBonds;
+    std::vector<std::vector<int> > bondParticles;
+    std::vector<std::vector<double> > bondParamArray;
+    CpuCustomCompoundBondForce* ixn;
+    std::vector<std::string> globalParameterNames, energyParamDerivNames;
+    std::map<std::string, int> tabulatedFunctionUpdateCount;
+    bool usePeriodic;
+    Vec3* boxVectors;
+};
+
+/**
+ * This kernel is invoked by CustomHbondForce to calculate the forces acting on the system.
+ */
+class CpuCalcCustomHbondForceKernel : public CalcCustomHbondForceKernel {
+public:
+    CpuCalcCustomHbondForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcCustomHbondForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcCustomHbondForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the CustomHbondForce this kernel will be used for
+     */
+    void initialize(const System& system, const CustomHbondForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CustomHbondForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomHbondForce& force);
+private:
+    void createInteraction(const CustomHbondForce& force);
+    CpuPlatform::PlatformData& data;
+    int numDonors, numAcceptors;
+    NonbondedMethod nonbondedMethod;
+    double cutoffDistance;
+    std::vector<std::vector<int> > donorParticles, acceptorParticles;
+    std::vector<std::vector<double> > donorParamArray, acceptorParamArray;
+    std::vector<std::set<int> > exclusions;
+    CpuCustomHbondForce* ixn;
+    std::vector<std::string> globalParameterNames;
+    std::map<std::string, int> tabulatedFunctionUpdateCount;
+};
+
 /**
  * This kernel is invoked by GayBerneForce to calculate the forces acting on the system.
  */
@@ -617,6 +876,112 @@ private:
     CpuGayBerneForce* ixn;
 };
 
+/**
+ * This kernel is invoked by RMSDForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcRMSDForceKernel : public CalcRMSDForceKernel {
+public:
+    CpuCalcRMSDForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcRMSDForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcRMSDForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the RMSDForce this kernel will be used for
+     */
+    void initialize(const System& system, const RMSDForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the RMSDForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const RMSDForce& force);
+private:
+    CpuPlatform::PlatformData& data;
+    int numReferencePositions;
+    CpuRMSDForce* ixn;
+};
+
+/**
+ * This kernel is invoked by RGForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcRGForceKernel : public CalcRGForceKernel {
+public:
+    CpuCalcRGForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcRGForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcRGForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the RGForce this kernel will be used for
+     */
+    void initialize(const System& system, const RGForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+private:
+    CpuPlatform::PlatformData& data;
+    CpuRGForce* ixn;
+};
+
+/**
+ * This kernel is invoked by OrientationRestraintForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcOrientationRestraintForceKernel : public CalcOrientationRestraintForceKernel {
+public:
+    CpuCalcOrientationRestraintForceKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data) :
+            CalcOrientationRestraintForceKernel(name, platform), data(data), ixn(NULL) {
+    }
+    ~CpuCalcOrientationRestraintForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the OrientationRestraintForce this kernel will be used for
+     */
+    void initialize(const System& system, const OrientationRestraintForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the OrientationRestraintForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const OrientationRestraintForce& force);
+private:
+    CpuPlatform::PlatformData& data;
+    int numReferencePositions;
+    CpuOrientationRestraintForce* ixn;
+};
+
 /**
  * This kernel is invoked by LangevinMiddleIntegrator to take one time step.
  */
@@ -31,6 +31,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "AlignedArray.h"
+#include "CpuExclusionList.h"
 #include "openmm/Vec3.h"
 #include "windowsExportCpu.h"
 #include "openmm/internal/ThreadPool.h"
@@ -46,26 +47,53 @@ public:
     class Voxels;
     class NeighborIterator;
     CpuNeighborList(int blockSize);
+    ~CpuNeighborList();
     /**
      * Compute the neighbor list based on the current positions of atoms.
      * 
      * @param numAtoms            the number of atoms in the system
      * @param atomLocations       the positions of the atoms
-     * @param exclusions          exclusions[i] contains the indices of all atoms with which atom i should not interact
+     * @param exclusions          the atoms each atom should not interact with.  The exclusions for each block are
+     *                            cached between calls, and only recomputed when the set of atoms in the block changes.
+     *                            They are discarded if a CpuExclusionList with a different version is passed.
      * @param periodicBoxVectors  the current periodic box vectors
      * @param usePeriodic         whether to apply periodic boundary conditions
      * @param maxDistance         the neighbor list will contain all pairs that are within this distance of each other
      * @param threads             used for parallelization
      */
-    void computeNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const std::vector<std::set<int> >& exclusions,
+    void computeNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const CpuExclusionList& exclusions,
+            const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads);
+    /**
+     * Update the neighbor list after a subset of atoms have moved.  This is much faster than computeNeighborList()
+     * when only a small fraction of atoms have moved short distances.  The atoms keep their existing order along the
+     * Hilbert curve, and only blocks that contain a moved atom or are within range of one are rebuilt.  Atoms that are not listed
+     * in movedAtoms are treated as still being at the positions they had when they were last added to the list.
+     * The list is updated in place.
+     *
+     * If an incremental update is not possible (the list has not been built yet, the periodic box or cutoff has
+     * changed, a moved atom has left the region covered by a nonperiodic list, or an atom has moved so far that
+     * its block is no longer compact), this instead rebuilds the whole list by calling computeNeighborList().
+     *
+     * @param numAtoms            the number of atoms in the system
+     * @param atomLocations       the positions of the atoms
+     * @param movedAtoms          the indices of the atoms whose positions should be updated
+     * @param exclusions          the atoms each atom should not interact with.  If this does not have the same
+     *                            version as the list that was used to build the neighbor list, it is rebuilt.
+     * @param periodicBoxVectors  the current periodic box vectors
+     * @param usePeriodic         whether to apply periodic boundary conditions
+     * @param maxDistance         the neighbor list will contain all pairs that are within this distance of each other
+     * @param threads             used for parallelization
+     * @return true if the list was updated incrementally, false if it was completely rebuilt
+     */
+    bool updateNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const std::vector<int>& movedAtoms, const CpuExclusionList& exclusions,
             const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads);
     /**
      * Build a dense neighbor list, in which every atom interacts with every other (except exclusions), regardless of distance.
      * 
      * @param numAtoms            the number of atoms in the system
-     * @param exclusions          exclusions[i] contains the indices of all atoms with which atom i should not interact
+     * @param exclusions          the atoms each atom should not interact with
      */
-    void createDenseNeighborList(int numAtoms, const std::vector<std::set<int> >& exclusions);
+    void createDenseNeighborList(int numAtoms, const CpuExclusionList& exclusions);
     int getNumBlocks() const;
     int getBlockSize() const;
     /**
@@ -89,16 +117,35 @@ public:
     void threadComputeNeighborList(ThreadPool& threads, int threadIndex);
     void runThread(int index);
 private:
+    /**
+     * Build the neighbors and exclusions for blocks, taking them from the shared counter.  If incremental
+     * is true, blocks that are unaffected by the moved atoms are skipped.
+     */
+    void threadBuildBlocks(bool incremental);
+    /**
+     * Compute the exclusions for the atoms in a block, sorted by the index of the excluded atom.
+     */
+    void computeBlockExclusionTile(int blockIndex, std::vector<std::pair<int, BlockExclusionMask> >& flags);
     int blockSize;
-    std::vector<int> sortedAtoms;
-    std::vector<float> sortedPositions;
+    std::vector<int> sortedAtoms, atomSortedIndex;
+    std::vector<float> sortedPositions, blockBounds;
     std::vector<std::vector<int> > blockNeighbors, blockExclusionIndices;
     std::vector<std::vector<BlockExclusionMask> > blockExclusions;
+    // Per-block exclusion tiles.  tileAtoms[i] lists the atoms that are excluded from interacting with at least one
+    // atom in block i, and tileMasks[i] holds the corresponding bit flags.  tileSortedAtoms records the atom order
+    // the tiles were computed for.
+    std::vector<std::vector<int> > tileAtoms;
+    std::vector<std::vector<BlockExclusionMask> > tileMasks;
+    std::vector<int> tileSortedAtoms;
+    long long tileExclusionsVersion;
+    bool reuseTiles;
     // The following variables are used to make information accessible to the individual threads.
     float minx, maxx, miny, maxy, minz, maxz;
     std::vector<std::pair<int, int> > atomBins;
     Voxels* voxels;
-    const std::vector<std::set<int> >* exclusions;
+    Voxels* movedVoxels;
+    std::vector<bool> blockMoved;
+    const CpuExclusionList* exclusions;
     const float* atomLocations;
     Vec3 periodicBoxVectors[3];
     int numAtoms;
@@ -143,16 +143,16 @@ class CpuNonbondedForce {
          @param atomCoordinates  atom coordinates (in format needed by PME)
          @param atomParameters   atom parameters (sigma/2, 2*sqrt(epsilon))
          @param C6Paramrs        C6 parameters for multiplicative representation of dispersion
-         @param exclusions       atom exclusion indices
-                                 exclusions[atomIndex] contains the list of exclusions for that atom
+         @param exclusions       the atoms each atom is excluded from interacting with
          @param forces           force array (forces added)
          @param totalEnergy      total energy
+         @param threads          the thread pool to use for PME
             
          --------------------------------------------------------------------------------------- */
 
       void calculateReciprocalIxn(int numberOfAtoms, float* posq, const std::vector<Vec3>& atomCoordinates,
                                   const std::vector<std::pair<float, float> >& atomParameters, const std::vector<float> &C6params,
-                                  const std::vector<std::set<int> >& exclusions, std::vector<Vec3>& forces, double* totalEnergy) const;
+                                  const CpuExclusionList& exclusions, std::vector<Vec3>& forces, double* totalEnergy, ThreadPool& threads) const;
       
       /**---------------------------------------------------------------------------------------
       
@@ -162,8 +162,7 @@ class CpuNonbondedForce {
          @param posq             atom coordinates and charges
          @param atomCoordinates  atom coordinates (periodic boundary conditions not applied)
          @param atomParameters   atom parameters (sigma/2, 2*sqrt(epsilon))
-         @param exclusions       atom exclusion indices
-                                 exclusions[atomIndex] contains the list of exclusions for that atom
+         @param exclusions       the atoms each atom is excluded from interacting with
          @param forces           force array (forces added)
          @param totalEnergy      total energy
          @param threads          the thread pool to use
@@ -171,7 +170,7 @@ class CpuNonbondedForce {
          --------------------------------------------------------------------------------------- */
           
       void calculateDirectIxn(int numberOfAtoms, float* posq, const std::vector<Vec3>& atomCoordinates, const std::vector<std::pair<float, float> >& atomParameters,
-            const std::vector<float>& C6params, const std::vector<std::set<int> >& exclusions, std::vector<AlignedArray<float> >& threadForce, double* totalEnergy, ThreadPool& threads);
+            const std::vector<float>& C6params, const CpuExclusionList& exclusions, std::vector<AlignedArray<float> >& threadForce, double* totalEnergy, ThreadPool& threads);
 
     /**
      * This routine contains the code executed by each thread.
@@ -205,7 +204,7 @@ protected:
         Vec3 const* atomCoordinates;
         std::pair<float, float> const* atomParameters;        
         float const *C6params;
-        std::set<int> const* exclusions;
+        const CpuExclusionList* exclusions;
         std::vector<AlignedArray<float> >* threadForce;
         bool includeEnergy;
         float inverseRcut6;
@@ -31,6 +31,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "AlignedArray.h"
+#include "CpuExclusionList.h"
 #include "CpuRandom.h"
 #include "CpuNeighborList.h"
 #include "ReferencePlatform.h"
@@ -75,6 +76,16 @@ public:
         static const std::string key = "DeterministicForces";
         return key;
     }
+    /**
+     * This is the name of the parameter for selecting how worker threads are pinned to CPU cores.  Allowed
+     * values are "none" (threads are not pinned), "core" (each thread is pinned to a single logical CPU), and
+     * "node" (each thread is pinned to the set of CPUs in one NUMA node).  In the latter two cases, consecutive
+     * threads are placed on the same NUMA node whenever possible.  Pinning is only supported on Linux.
+     */
+    static const std::string& CpuThreadAffinity() {
+        static const std::string key = "ThreadAffinity";
+        return key;
+    }
     /**
      * We cannot use the standard mechanism for platform data, because that is already used by the superclass.
      * Instead, we maintain a table of ContextImpls to PlatformDatas.
@@ -87,7 +98,7 @@ private:
 
 class CpuPlatform::PlatformData {
 public:
-    PlatformData(int numParticles, ThreadPool& threads, bool deterministicForces);
+    PlatformData(int numParticles, ThreadPool& threads, bool deterministicForces, const std::string& threadAffinity);
     ~PlatformData();
     /**
      * Request that a neighbor list be built and maintained.
@@ -102,6 +113,11 @@ public:
      *                        particles with which particle i should not interact
      */
     void requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const std::vector<std::set<int> >& exclusionList);
+    /**
+     * Request that a neighbor list be computed.  This is identical to the other version, except that
+     * the exclusions are given as a CpuExclusionList.
+     */
+    void requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const CpuExclusionList& exclusionList);
     int requestPosqIndex();
     AlignedArray<float> posq;
     std::vector<AlignedArray<float> > threadForce;
@@ -114,7 +130,7 @@ public:
     double cutoff, paddedCutoff;
     bool anyExclusions, deterministicForces;
     int currentPosqIndex, nextPosqIndex;
-    std::vector<std::set<int> > exclusions;
+    CpuExclusionList exclusions;
 };
 
 } // namespace OpenMM
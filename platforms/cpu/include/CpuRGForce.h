@@ -0,0 +1,70 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_RG_FORCE_H__
+#define OPENMM_CPU_RG_FORCE_H__
+
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes an RGForce.  The centroid and sum of squared distances are accumulated in a
+ * single threaded pass over the particles, and the forces are then applied in parallel.
+ */
+class CpuRGForce {
+public:
+    /**
+     * Create a new CpuRGForce.
+     *
+     * @param particles       the indices of the particles the radius of gyration is computed for
+     * @param threads         the thread pool to use
+     */
+    CpuRGForce(const std::vector<int>& particles, ThreadPool& threads);
+
+    /**
+     * Calculate the interaction.
+     *
+     * @param atomCoordinates    atom coordinates
+     * @param forces             forces on atoms are added to this
+     * @return the energy of the interaction
+     */
+    double calculateIxn(const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces);
+
+private:
+    ThreadPool& threads;
+    std::vector<int> particles;
+    std::vector<double> threadSums;
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_RG_FORCE_H__
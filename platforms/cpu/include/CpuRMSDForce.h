@@ -0,0 +1,88 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_RMSD_FORCE_H__
+#define OPENMM_CPU_RMSD_FORCE_H__
+
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes an RMSDForce.  The centroid and correlation matrix are accumulated in a single
+ * threaded pass over the particles, the optimal rotation is found with the quaternion characteristic
+ * polynomial (QCP) method, and the forces are then applied in parallel.
+ */
+class CpuRMSDForce {
+public:
+    /**
+     * Create a new CpuRMSDForce.
+     *
+     * @param referencePos    the reference positions for all particles in the System
+     * @param particles       the indices of the particles the RMSD is computed for
+     * @param threads         the thread pool to use
+     */
+    CpuRMSDForce(const std::vector<Vec3>& referencePos, const std::vector<int>& particles, ThreadPool& threads);
+
+    /**
+     * Calculate the interaction.
+     *
+     * @param atomCoordinates    atom coordinates
+     * @param forces             forces on atoms are added to this
+     * @return the energy of the interaction
+     */
+    double calculateIxn(const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces);
+
+    /**
+     * Find the largest eigenvalue of the 4x4 key matrix used for superposition, and the corresponding
+     * eigenvector.  This uses Newton's method to find the largest root of the characteristic polynomial,
+     * starting from an upper bound, then computes the eigenvector from the adjugate matrix.  If the
+     * eigenvalue is degenerate, it falls back to a full eigendecomposition.
+     *
+     * @param F           the symmetric, traceless key matrix
+     * @param upperBound  an upper bound on the largest eigenvalue
+     * @param q           on exit, contains the normalized eigenvector
+     * @return the largest eigenvalue
+     */
+    static double findLargestEigenvalue(const double F[4][4], double upperBound, double q[4]);
+
+private:
+    ThreadPool& threads;
+    std::vector<int> particles;
+    std::vector<Vec3> referencePos;
+    Vec3 referenceSum;
+    double referenceNorm;
+    std::vector<double> threadSums;
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_RMSD_FORCE_H__
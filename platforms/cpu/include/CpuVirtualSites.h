@@ -0,0 +1,85 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef OPENMM_CPU_VIRTUAL_SITES_H__
+#define OPENMM_CPU_VIRTUAL_SITES_H__
+
+#include "ReferenceVirtualSites.h"
+#include "windowsExportCpu.h"
+#include "openmm/internal/ThreadPool.h"
+#include <functional>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes virtual site positions and distributes their forces in parallel.  Sites are
+ * grouped into dependency levels: every site in a level depends only on atoms and sites in lower
+ * levels, so all sites in a level can be processed at once.  For distributing forces, each level is
+ * further divided so that no two sites processed together share a parent particle.  Within a group,
+ * the sites are sorted by type, and the common types have their parameters stored in flat arrays.
+ */
+class OPENMM_EXPORT_CPU CpuVirtualSites : public ReferenceVirtualSites {
+public:
+    CpuVirtualSites(const System& system, ThreadPool& threads);
+    /**
+     * Compute the positions of all virtual sites.
+     */
+    void computePositions(const System& system, std::vector<Vec3>& atomCoordinates, const Vec3* boxVectors) const;
+    /**
+     * Distribute forces from virtual sites to the atoms they are based on.
+     */
+    void distributeForces(const System& system, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces, const Vec3* boxVectors) const;
+private:
+    class SiteBlock;
+    typedef std::vector<SiteBlock> SiteGroup;
+    ThreadPool& threads;
+    std::vector<SiteGroup> positionGroups, forceGroups;
+    /**
+     * Build a SiteGroup containing a set of virtual sites.
+     */
+    static SiteGroup createGroup(const System& system, const std::vector<int>& sites);
+    /**
+     * Execute a function for every site in a group, dividing them between threads if there are enough of them.
+     */
+    void processGroup(const SiteGroup& group, const std::function<void(const SiteBlock&, int, int)>& function) const;
+};
+
+class CpuVirtualSites::SiteBlock {
+public:
+    enum Type {TwoParticleAverage, ThreeParticleAverage, OutOfPlane, Other};
+    Type type;
+    int particlesPerSite;
+    std::vector<int> sites, particles;
+    std::vector<double> weights;
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_VIRTUAL_SITES_H__
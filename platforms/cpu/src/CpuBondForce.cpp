@@ -44,13 +44,21 @@ void CpuBondForce::initialize(int numAtoms, int numBonds, int numAtomsPerBond, v
     int numThreads = threads.getNumThreads();
     int targetBondsPerThread = numBonds/numThreads;
     
-    // Record the bonds that include each atom.
+    // Record the bonds that include each atom.  They are stored in a flat array: the bonds for
+    // atom i are atomBonds[atomBondStart[i]] through atomBonds[atomBondStart[i+1]-1], in
+    // increasing order.
     
-    vector<set<int> > atomBonds(numAtoms);
-    for (int bond = 0; bond < numBonds; bond++) {
+    vector<int> atomBondStart(numAtoms+1, 0);
+    for (int bond = 0; bond < numBonds; bond++)
         for (int i = 0; i < numAtomsPerBond; i++)
-            atomBonds[bondAtoms[bond][i]].insert(bond);
-    }
+            atomBondStart[bondAtoms[bond][i]+1]++;
+    for (int i = 0; i < numAtoms; i++)
+        atomBondStart[i+1] += atomBondStart[i];
+    vector<int> atomBonds(atomBondStart[numAtoms]);
+    vector<int> nextAtomBond(atomBondStart.begin(), atomBondStart.end()-1);
+    for (int bond = 0; bond < numBonds; bond++)
+        for (int i = 0; i < numAtomsPerBond; i++)
+            atomBonds[nextAtomBond[bondAtoms[bond][i]]++] = bond;
     
     // Divide bonds into groups.
     
@@ -77,14 +85,14 @@ void CpuBondForce::initialize(int numAtoms, int numBonds, int numAtomsPerBond, v
         
         // Assign this bond to the thread.
         
-        assignBond(numProcessed++, thread, atomThread, bondThread, atomBonds, candidateBonds);
+        assignBond(numProcessed++, thread, atomThread, bondThread, atomBondStart, atomBonds, candidateBonds);
         
         // Assign additional bonds that have been identified as involving atoms assigned to this thread.
         
         while (!candidateBonds.empty() && threadBonds[thread].size() < targetBondsPerThread) {
             int bond = *candidateBonds.begin();
             if (bondThread[bond] == -1 && canAssignBond(bond, thread, atomThread))
-                assignBond(bond, thread, atomThread, bondThread, atomBonds, candidateBonds);
+                assignBond(bond, thread, atomThread, bondThread, atomBondStart, atomBonds, candidateBonds);
             candidateBonds.pop_front();
         }
         
@@ -121,7 +129,7 @@ void CpuBondForce::initialize(int numAtoms, int numBonds, int numAtomsPerBond, v
                 
                 if (assignment == -1)
                     assignment = numThreads-1;
-                assignBond(bond, assignment, atomThread, bondThread, atomBonds, candidateBonds);
+                assignBond(bond, assignment, atomThread, bondThread, atomBondStart, atomBonds, candidateBonds);
             }
             else {
                 // Add it to the list of "extra" bonds.
@@ -141,7 +149,7 @@ bool CpuBondForce::canAssignBond(int bond, int thread, vector<int>& atomThread)
     return true;
 }
 
-void CpuBondForce::assignBond(int bond, int thread, vector<int>& atomThread, vector<int>& bondThread, vector<set<int> >& atomBonds, list<int>& candidateBonds) {
+void CpuBondForce::assignBond(int bond, int thread, vector<int>& atomThread, vector<int>& bondThread, const vector<int>& atomBondStart, const vector<int>& atomBonds, list<int>& candidateBonds) {
     // Assign the bond to a thread.
     
     bondThread[bond] = thread;
@@ -151,14 +159,14 @@ void CpuBondForce::assignBond(int bond, int thread, vector<int>& atomThread, vec
     // bonds to the list of candidates.
     
     for (int i = 0; i < numAtomsPerBond; i++) {
-        int& atom = atomThread[bondAtoms[bond][i]];
-        if (atom == thread)
+        int atom = bondAtoms[bond][i];
+        if (atomThread[atom] == thread)
             continue;
-        if (atom != -1)
+        if (atomThread[atom] != -1)
             throw OpenMMException("CpuBondForce: Internal error: atoms assigned to threads incorrectly");
-        atom = thread;
-        for (int bondIndex : atomBonds[atom])
-            candidateBonds.push_back(bondIndex);
+        atomThread[atom] = thread;
+        for (int j = atomBondStart[atom]; j < atomBondStart[atom+1]; j++)
+            candidateBonds.push_back(atomBonds[j]);
     }
 }
 
@@ -0,0 +1,184 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuCMAPTorsionForce.h"
+#include "ReferenceBondIxn.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuCMAPTorsionForce::ThreadData::ThreadData() {
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 3; j++)
+            delta[i][j].resize(BlockSize);
+        cross[i][0].resize(BlockSize);
+        cross[i][1].resize(BlockSize);
+        angle[i].resize(BlockSize);
+        dEdAngle[i].resize(BlockSize);
+    }
+}
+
+CpuCMAPTorsionForce::CpuCMAPTorsionForce(int numAtoms, const vector<vector<int> >& torsionAtoms, ThreadPool& threads) :
+        threads(threads), usePeriodic(false), torsionAtoms(torsionAtoms), threadData(threads.getNumThreads()) {
+    bondForce.initialize(numAtoms, torsionAtoms.size(), 8, this->torsionAtoms, threads);
+}
+
+void CpuCMAPTorsionForce::setMaps(const vector<int>& torsionMaps, const vector<vector<vector<double> > >& coeff) {
+    this->torsionMaps = torsionMaps;
+    int numMaps = coeff.size();
+    mapSize.resize(numMaps);
+    mapOffset.resize(numMaps);
+    int numPatches = 0;
+    for (int i = 0; i < numMaps; i++) {
+        mapSize[i] = (int) sqrt(coeff[i].size());
+        mapOffset[i] = 16*numPatches;
+        numPatches += coeff[i].size();
+    }
+    coefficients.resize(16*numPatches);
+    for (int i = 0; i < numMaps; i++)
+        for (int j = 0; j < (int) coeff[i].size(); j++)
+            for (int k = 0; k < 16; k++)
+                coefficients[mapOffset[i]+16*j+k] = coeff[i][j][k];
+}
+
+void CpuCMAPTorsionForce::setPeriodic(Vec3* periodicBoxVectors) {
+    usePeriodic = true;
+    this->periodicBoxVectors[0] = periodicBoxVectors[0];
+    this->periodicBoxVectors[1] = periodicBoxVectors[1];
+    this->periodicBoxVectors[2] = periodicBoxVectors[2];
+}
+
+double CpuCMAPTorsionForce::calculateIxn(const vector<Vec3>& positions, vector<Vec3>& forces) {
+    this->positions = &positions[0];
+    this->forces = &forces[0];
+    for (auto& data : threadData)
+        data.energy = 0;
+
+    // Each thread computes its own torsions, then the ones that could not be assigned to a
+    // thread are computed at the end.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { computeTorsions(bondForce.getThreadBonds(threadIndex), threadData[threadIndex]); });
+    threads.waitForThreads();
+    computeTorsions(bondForce.getExtraBonds(), threadData[0]);
+    double energy = 0;
+    for (auto& data : threadData)
+        energy += data.energy;
+    return energy;
+}
+
+void CpuCMAPTorsionForce::computeTorsions(const vector<int>& torsions, ThreadData& data) {
+    int numTorsions = torsions.size();
+    for (int start = 0; start < numTorsions; start += BlockSize)
+        computeBlock(&torsions[start], min(start+BlockSize, numTorsions)-start, data);
+}
+
+void CpuCMAPTorsionForce::computeBlock(const int* torsions, int numTorsions, ThreadData& data) {
+    // Compute the two dihedral angles for every torsion pair.
+
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < numTorsions; i++) {
+            const int* atoms = &torsionAtoms[torsions[i]][4*k];
+            Vec3 delta1 = computeDelta(positions[atoms[0]], positions[atoms[1]]);
+            Vec3 delta2 = computeDelta(positions[atoms[2]], positions[atoms[1]]);
+            Vec3 delta3 = computeDelta(positions[atoms[2]], positions[atoms[3]]);
+            Vec3 cross1 = delta1.cross(delta2);
+            Vec3 cross2 = delta2.cross(delta3);
+            double angle = ReferenceBondIxn::getAngleBetweenTwoVectors(&cross1[0], &cross2[0]);
+            if (delta1.dot(cross2) < 0)
+                angle = -angle;
+            data.angle[k][i] = fmod(angle+2.0*M_PI, 2.0*M_PI);
+            data.delta[k][0][i] = delta1;
+            data.delta[k][1][i] = delta2;
+            data.delta[k][2][i] = delta3;
+            data.cross[k][0][i] = cross1;
+            data.cross[k][1][i] = cross2;
+        }
+    }
+
+    // Evaluate the splines to determine the energy and gradients.
+
+    for (int i = 0; i < numTorsions; i++) {
+        int map = torsionMaps[torsions[i]];
+        int size = mapSize[map];
+        double delta = 2*M_PI/size;
+        double angleA = data.angle[0][i];
+        double angleB = data.angle[1][i];
+        int s = (int) fmin(angleA/delta, size-1);
+        int t = (int) fmin(angleB/delta, size-1);
+        const double* c = &coefficients[mapOffset[map]+16*(s+size*t)];
+        double da = angleA/delta-s;
+        double db = angleB/delta-t;
+        double energy = 0;
+        double dEdA = 0;
+        double dEdB = 0;
+        for (int j = 3; j >= 0; j--) {
+            energy = da*energy + ((c[j*4+3]*db + c[j*4+2])*db + c[j*4+1])*db + c[j*4+0];
+            dEdA = db*dEdA + (3.0*c[j+3*4]*da + 2.0*c[j+2*4])*da + c[j+1*4];
+            dEdB = da*dEdB + (3.0*c[j*4+3]*db + 2.0*c[j*4+2])*db + c[j*4+1];
+        }
+        data.energy += energy;
+        data.dEdAngle[0][i] = dEdA/delta;
+        data.dEdAngle[1][i] = dEdB/delta;
+    }
+
+    // Apply the forces.
+
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < numTorsions; i++) {
+            const int* atoms = &torsionAtoms[torsions[i]][4*k];
+            const Vec3& delta1 = data.delta[k][0][i];
+            const Vec3& delta2 = data.delta[k][1][i];
+            const Vec3& delta3 = data.delta[k][2][i];
+            const Vec3& cross1 = data.cross[k][0][i];
+            const Vec3& cross2 = data.cross[k][1][i];
+            double dEdAngle = data.dEdAngle[k][i];
+            double norm2Delta2 = delta2.dot(delta2);
+            double normDelta2 = sqrt(norm2Delta2);
+            Vec3 f0 = cross1*(-dEdAngle*normDelta2/cross1.dot(cross1));
+            Vec3 f3 = cross2*(dEdAngle*normDelta2/cross2.dot(cross2));
+            Vec3 s = f0*(delta1.dot(delta2)/norm2Delta2) - f3*(delta3.dot(delta2)/norm2Delta2);
+            forces[atoms[0]] += f0;
+            forces[atoms[1]] -= f0-s;
+            forces[atoms[2]] -= f3+s;
+            forces[atoms[3]] += f3;
+        }
+    }
+}
+
+Vec3 CpuCMAPTorsionForce::computeDelta(const Vec3& pos1, const Vec3& pos2) const {
+    Vec3 delta = pos1-pos2;
+    if (usePeriodic) {
+        delta -= periodicBoxVectors[2]*floor(delta[2]/periodicBoxVectors[2][2]+0.5);
+        delta -= periodicBoxVectors[1]*floor(delta[1]/periodicBoxVectors[1][1]+0.5);
+        delta -= periodicBoxVectors[0]*floor(delta[0]/periodicBoxVectors[0][0]+0.5);
+    }
+    return delta;
+}
@@ -0,0 +1,230 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuCustomCentroidBondForce.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuCustomCentroidBondForce::CpuCustomCentroidBondForce(int numGroupsPerBond, const vector<vector<int> >& groupAtoms,
+            const vector<vector<double> >& normalizedWeights, const vector<vector<int> >& bondGroups,
+            const Lepton::ParsedExpression& energyExpression, const vector<string>& bondParameterNames,
+            const vector<string>& energyParamDerivNames, ThreadPool& threads) : threads(threads), numGroupsPerBond(numGroupsPerBond),
+            numEnergyParamDerivs(energyParamDerivNames.size()), groupAtoms(groupAtoms), normalizedWeights(normalizedWeights),
+            bondGroups(bondGroups), bondParameterNames(bondParameterNames) {
+    // Compile the energy and all its derivatives into a single expression.  The values are
+    // the energy, then the derivatives with respect to x, y, and z of each group, then the
+    // derivatives with respect to parameters.
+
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(energyExpression);
+    for (int i = 0; i < numGroupsPerBond; i++) {
+        for (char axis : {'x', 'y', 'z'}) {
+            stringstream name;
+            name << axis << (i+1);
+            expressions.push_back(energyExpression.differentiate(name.str()).optimize());
+        }
+    }
+    for (auto& paramName : energyParamDerivNames)
+        expressions.push_back(energyExpression.differentiate(paramName).optimize());
+    Lepton::CompiledExpression expression = Lepton::ParsedExpression::createCompiledExpression(expressions);
+    for (int i = 0; i < threads.getNumThreads(); i++)
+        threadData.push_back(new ThreadData(expression, groupAtoms.size(), numGroupsPerBond, numEnergyParamDerivs));
+}
+
+CpuCustomCentroidBondForce::~CpuCustomCentroidBondForce() {
+    for (auto data : threadData)
+        delete data;
+}
+
+void CpuCustomCentroidBondForce::setBondParameters(const vector<vector<double> >& bondParameters) {
+    // Store the parameters as one array for each parameter, so blocks of them can be passed directly to the expression.
+
+    int numBonds = bondGroups.size();
+    int numParameters = bondParameterNames.size();
+    bondParameterValues.resize(numParameters);
+    for (int i = 0; i < numParameters; i++) {
+        bondParameterValues[i].resize(numBonds);
+        for (int j = 0; j < numBonds; j++)
+            bondParameterValues[i][j] = bondParameters[j][i];
+    }
+}
+
+double CpuCustomCentroidBondForce::calculateIxn(const vector<Vec3>& positions, const map<string, double>& globalParameters,
+            vector<AlignedArray<float> >& threadForce, bool includeForces, bool includeEnergy, double* energyParamDerivs) {
+    // Record the parameters for the threads.
+
+    this->positions = &positions[0];
+    this->globalParameters = &globalParameters;
+    this->threadForce = &threadForce;
+    this->includeForces = includeForces;
+    this->includeEnergy = includeEnergy;
+    groupCenters.resize(groupAtoms.size());
+
+    // Compute the group centers, then the interactions, then apply the forces to atoms.  Each
+    // step needs the results of the previous one from all threads.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeCenters(threads, threadIndex); });
+    threads.waitForThreads();
+    atomicCounter = 0;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeBonds(threads, threadIndex); });
+    threads.waitForThreads();
+    if (includeForces) {
+        threads.execute([&] (ThreadPool& threads, int threadIndex) { threadApplyForces(threads, threadIndex); });
+        threads.waitForThreads();
+    }
+
+    // Combine the energies and parameter derivatives from all the threads.
+
+    double energy = 0;
+    for (auto data : threadData) {
+        energy += data->energy;
+        for (int i = 0; i < numEnergyParamDerivs; i++)
+            energyParamDerivs[i] += data->energyParamDerivs[i];
+    }
+    return energy;
+}
+
+void CpuCustomCentroidBondForce::threadComputeCenters(ThreadPool& threads, int threadIndex) {
+    int numGroups = groupAtoms.size();
+    int numThreads = threads.getNumThreads();
+    int start = threadIndex*numGroups/numThreads;
+    int end = (threadIndex+1)*numGroups/numThreads;
+    for (int group = start; group < end; group++) {
+        Vec3 center;
+        const vector<int>& atoms = groupAtoms[group];
+        const vector<double>& weights = normalizedWeights[group];
+        for (int i = 0; i < (int) atoms.size(); i++)
+            center += positions[atoms[i]]*weights[i];
+        groupCenters[group] = center;
+    }
+}
+
+void CpuCustomCentroidBondForce::threadComputeBonds(ThreadPool& threads, int threadIndex) {
+    ThreadData& data = *threadData[threadIndex];
+    Lepton::CompiledExpression& expression = data.expression;
+    data.energy = 0;
+    for (int i = 0; i < numEnergyParamDerivs; i++)
+        data.energyParamDerivs[i] = 0;
+    if (includeForces)
+        for (auto& f : data.groupForces)
+            f = Vec3();
+    for (auto& param : *globalParameters)
+        if (expression.getVariables().find(param.first) != expression.getVariables().end())
+            expression.getVariableReference(param.first) = param.second;
+
+    // Build the lists of variables and results.
+
+    map<string, const double*> variables;
+    for (int i = 0; i < numGroupsPerBond; i++) {
+        for (int j = 0; j < 3; j++) {
+            stringstream name;
+            name << "xyz"[j] << (i+1);
+            variables[name.str()] = data.coordinates[3*i+j].data();
+        }
+    }
+    vector<double*> results;
+    for (auto& v : data.values)
+        results.push_back(v.data());
+    int firstParamDeriv = 1+3*numGroupsPerBond;
+    if (!includeEnergy)
+        results[0] = NULL;
+    if (!includeForces)
+        for (int i = 1; i < firstParamDeriv; i++)
+            results[i] = NULL;
+
+    // Process blocks of bonds.
+
+    int numBonds = bondGroups.size();
+    int numParameters = bondParameterNames.size();
+    while (true) {
+        int start = BlockSize*(atomicCounter++);
+        if (start >= numBonds)
+            break;
+        int count = min(start+BlockSize, numBonds)-start;
+        for (int bond = 0; bond < count; bond++) {
+            const vector<int>& groups = bondGroups[start+bond];
+            for (int i = 0; i < numGroupsPerBond; i++) {
+                const Vec3& center = groupCenters[groups[i]];
+                for (int j = 0; j < 3; j++)
+                    data.coordinates[3*i+j][bond] = center[j];
+            }
+        }
+        for (int i = 0; i < numParameters; i++)
+            variables[bondParameterNames[i]] = &bondParameterValues[i][start];
+        expression.evaluate(count, variables, results);
+
+        // Accumulate the results.
+
+        if (includeEnergy)
+            for (int bond = 0; bond < count; bond++)
+                data.energy += data.values[0][bond];
+        if (includeForces) {
+            for (int bond = 0; bond < count; bond++) {
+                const vector<int>& groups = bondGroups[start+bond];
+                for (int i = 0; i < numGroupsPerBond; i++) {
+                    Vec3& f = data.groupForces[groups[i]];
+                    for (int j = 0; j < 3; j++)
+                        f[j] -= data.values[1+3*i+j][bond];
+                }
+            }
+        }
+        for (int i = 0; i < numEnergyParamDerivs; i++)
+            for (int bond = 0; bond < count; bond++)
+                data.energyParamDerivs[i] += data.values[firstParamDeriv+i][bond];
+    }
+}
+
+void CpuCustomCentroidBondForce::threadApplyForces(ThreadPool& threads, int threadIndex) {
+    int numGroups = groupAtoms.size();
+    int numThreads = threads.getNumThreads();
+    int start = threadIndex*numGroups/numThreads;
+    int end = (threadIndex+1)*numGroups/numThreads;
+    float* forces = &(*threadForce)[threadIndex][0];
+    for (int group = start; group < end; group++) {
+        Vec3 f;
+        for (auto data : threadData)
+            f += data->groupForces[group];
+        const vector<int>& atoms = groupAtoms[group];
+        const vector<double>& weights = normalizedWeights[group];
+        for (int i = 0; i < (int) atoms.size(); i++) {
+            int index = 4*atoms[i];
+            forces[index] += (float) (f[0]*weights[i]);
+            forces[index+1] += (float) (f[1]*weights[i]);
+            forces[index+2] += (float) (f[2]*weights[i]);
+        }
+    }
+}
+
+CpuCustomCentroidBondForce::ThreadData::ThreadData(const Lepton::CompiledExpression& expression, int numGroups, int numGroupsPerBond, int numEnergyParamDerivs) :
+        expression(expression), coordinates(3*numGroupsPerBond, vector<double>(BlockSize)), values(expression.getNumValues(), vector<double>(BlockSize)),
+        groupForces(numGroups), energyParamDerivs(numEnergyParamDerivs) {
+}
@@ -0,0 +1,597 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuCustomCompoundBondForce.h"
+#include "ReferenceBondIxn.h"
+#include "openmm/internal/hardware.h"
+#include "openmm/internal/vectorize.h"
+#include "lepton/Operation.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
+
+using namespace OpenMM;
+using namespace std;
+
+static void findVariables(const Lepton::ExpressionTreeNode& node, set<string>& variables) {
+    if (node.getOperation().getId() == Lepton::Operation::VARIABLE)
+        variables.insert(node.getOperation().getName());
+    for (auto& child : node.getChildren())
+        findVariables(child, variables);
+}
+
+// Vectors whose x, y, and z components are stored separately, with each fvec4 holding one component for four bonds.
+
+static inline fvec4 dotSoA(const fvec4* v1, const fvec4* v2) {
+    return v1[0]*v2[0] + v1[1]*v2[1] + v1[2]*v2[2];
+}
+
+static inline void crossSoA(const fvec4* v1, const fvec4* v2, fvec4* result) {
+    result[0] = v1[1]*v2[2] - v1[2]*v2[1];
+    result[1] = v1[2]*v2[0] - v1[0]*v2[2];
+    result[2] = v1[0]*v2[1] - v1[1]*v2[0];
+}
+
+/**
+ * Compute atan2() for each element.  When both arguments are 0 (which happens when a bond has two
+ * particles at the same position), this returns pi/2 to match ReferenceBondIxn.
+ */
+static inline fvec4 atan2SoA(fvec4 y, fvec4 x) {
+    float yValues[4], xValues[4], result[4];
+    y.store(yValues);
+    x.store(xValues);
+    for (int i = 0; i < 4; i++)
+        result[i] = (yValues[i] == 0.0f && xValues[i] == 0.0f ? (float) (0.5*M_PI) : atan2f(yValues[i], xValues[i]));
+    return fvec4(result);
+}
+
+CpuCustomCompoundBondForce::ThreadData::ThreadData(const Lepton::CompiledExpression& expression, int numCoordinates, int numParameters,
+            int numTerms, int numValues, int numEnergyParamDerivs) : expression(expression), coordinates(numCoordinates, vector<double>(BlockSize)),
+            parameters(numParameters, vector<double>(BlockSize)), termValues(numTerms, vector<double>(BlockSize)),
+            deltas(9*numTerms, vector<double>(BlockSize)), values(numValues, vector<double>(BlockSize)), energyParamDerivs(numEnergyParamDerivs) {
+}
+
+CpuCustomCompoundBondForce::ThreadData::ThreadData(const Lepton::CompiledVectorExpression& vecExpression, int numParameters,
+            int numTerms, int numValues, int numEnergyParamDerivs) : vecExpression(vecExpression), vecParameters(numParameters, vector<float>(BlockSize)),
+            vecTermValues(numTerms, vector<float>(BlockSize)), vecDeltas(9*numTerms, vector<float>(BlockSize)),
+            vecValues(numValues, vector<float>(BlockSize)), energyParamDerivs(numEnergyParamDerivs) {
+}
+
+CpuCustomCompoundBondForce::CpuCustomCompoundBondForce(int numAtoms, int numParticlesPerBond, const vector<vector<int> >& bondAtoms,
+            const Lepton::ParsedExpression& energyExpression, const vector<string>& bondParameterNames,
+            const vector<string>& energyParamDerivNames, ThreadPool& threads) : threads(threads), numParticlesPerBond(numParticlesPerBond),
+            numEnergyParamDerivs(energyParamDerivNames.size()), usePeriodic(false), bondAtoms(bondAtoms), bondParameterNames(bondParameterNames) {
+    // Replace the geometric functions with variables.
+
+    map<string, pair<int, int> > coordinates;
+    for (int i = 0; i < numParticlesPerBond; i++)
+        for (int j = 0; j < 3; j++) {
+            stringstream name;
+            name << "xyz"[j] << (i+1);
+            coordinates[name.str()] = make_pair(i, j);
+        }
+    Lepton::ParsedExpression expression = Lepton::ParsedExpression(replacePointFunctions(energyExpression.getRootNode(), coordinates));
+    set<string> variables;
+    findVariables(expression.getRootNode(), variables);
+    for (auto& coord : coordinates)
+        if (variables.find(coord.first) != variables.end())
+            coordinateDerivs.push_back(coord.second);
+    useVectorExpression = coordinateDerivs.empty();
+
+    // Compile the energy and all its derivatives into a single expression.  The values are the
+    // energy, then the derivatives with respect to each geometric term, then the derivatives
+    // with respect to the coordinates that appear directly, then the derivatives with respect
+    // to parameters.
+
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(expression);
+    for (auto& term : terms)
+        expressions.push_back(expression.differentiate(term.name).optimize());
+    for (auto& coord : coordinateDerivs) {
+        stringstream name;
+        name << "xyz"[coord.second] << (coord.first+1);
+        expressions.push_back(expression.differentiate(name.str()).optimize());
+    }
+    for (auto& paramName : energyParamDerivNames)
+        expressions.push_back(expression.differentiate(paramName).optimize());
+    if (useVectorExpression) {
+        Lepton::CompiledVectorExpression compiled = Lepton::ParsedExpression::createCompiledVectorExpression(expressions, getVectorWidth());
+        for (int i = 0; i < threads.getNumThreads(); i++)
+            threadData.push_back(new ThreadData(compiled, bondParameterNames.size(), terms.size(), expressions.size(), numEnergyParamDerivs));
+    }
+    else {
+        Lepton::CompiledExpression compiled = Lepton::ParsedExpression::createCompiledExpression(expressions);
+        for (int i = 0; i < threads.getNumThreads(); i++)
+            threadData.push_back(new ThreadData(compiled, 3*numParticlesPerBond, bondParameterNames.size(), terms.size(), expressions.size(), numEnergyParamDerivs));
+    }
+
+    // Decide which bonds to compute on each thread.
+
+    bondForce.initialize(numAtoms, bondAtoms.size(), numParticlesPerBond, this->bondAtoms, threads);
+}
+
+CpuCustomCompoundBondForce::~CpuCustomCompoundBondForce() {
+    for (auto data : threadData)
+        delete data;
+}
+
+Lepton::ExpressionTreeNode CpuCustomCompoundBondForce::replacePointFunctions(const Lepton::ExpressionTreeNode& node, const map<string, pair<int, int> >& coordinates) {
+    const Lepton::Operation& op = node.getOperation();
+    const vector<Lepton::ExpressionTreeNode>& children = node.getChildren();
+    TermInfo::Type type;
+    if (op.getId() == Lepton::Operation::CUSTOM && op.getName() == "pointdistance")
+        type = TermInfo::Distance;
+    else if (op.getId() == Lepton::Operation::CUSTOM && op.getName() == "pointangle")
+        type = TermInfo::Angle;
+    else if (op.getId() == Lepton::Operation::CUSTOM && op.getName() == "pointdihedral")
+        type = TermInfo::Dihedral;
+    else {
+        vector<Lepton::ExpressionTreeNode> newChildren;
+        for (auto& child : children)
+            newChildren.push_back(replacePointFunctions(child, coordinates));
+        return Lepton::ExpressionTreeNode(op.clone(), newChildren);
+    }
+
+    // See whether the arguments are the coordinates of particles.  If not, leave the function
+    // to be evaluated directly.
+
+    vector<int> atoms;
+    for (int i = 0; i < (int) children.size(); i += 3) {
+        int atom = -1;
+        for (int j = 0; j < 3; j++) {
+            const Lepton::Operation& argOp = children[i+j].getOperation();
+            auto coord = coordinates.end();
+            if (argOp.getId() == Lepton::Operation::VARIABLE)
+                coord = coordinates.find(argOp.getName());
+            if (coord == coordinates.end() || coord->second.second != j || (j > 0 && coord->second.first != atom))
+                return node;
+            atom = coord->second.first;
+        }
+        atoms.push_back(atom);
+    }
+
+    // Replace it with a variable, sharing it with any identical term.
+
+    for (auto& term : terms)
+        if (term.type == type && term.atoms == atoms)
+            return Lepton::ExpressionTreeNode(new Lepton::Operation::Variable(term.name));
+    stringstream name;
+    name << op.getName() << "(";
+    for (int i = 0; i < (int) atoms.size(); i++)
+        name << (i == 0 ? "p" : ",p") << (atoms[i]+1);
+    name << ")";
+    terms.push_back(TermInfo(name.str(), type, atoms));
+    return Lepton::ExpressionTreeNode(new Lepton::Operation::Variable(name.str()));
+}
+
+void CpuCustomCompoundBondForce::setPeriodic(Vec3* periodicBoxVectors) {
+    usePeriodic = true;
+    this->periodicBoxVectors[0] = periodicBoxVectors[0];
+    this->periodicBoxVectors[1] = periodicBoxVectors[1];
+    this->periodicBoxVectors[2] = periodicBoxVectors[2];
+}
+
+void CpuCustomCompoundBondForce::setBondParameters(const vector<vector<double> >& bondParameters) {
+    this->bondParameters = bondParameters;
+}
+
+double CpuCustomCompoundBondForce::calculateIxn(const vector<Vec3>& positions, const map<string, double>& globalParameters,
+            vector<Vec3>& forces, bool includeForces, bool includeEnergy, double* energyParamDerivs) {
+    // Record the parameters for the threads.
+
+    this->positions = &positions[0];
+    this->forces = &forces[0];
+    this->includeForces = includeForces;
+    this->includeEnergy = includeEnergy;
+    for (auto data : threadData) {
+        data->energy = 0;
+        for (int i = 0; i < numEnergyParamDerivs; i++)
+            data->energyParamDerivs[i] = 0;
+        if (useVectorExpression) {
+            Lepton::CompiledVectorExpression& expression = data->vecExpression;
+            int width = expression.getWidth();
+            for (auto& param : globalParameters)
+                if (expression.getVariables().find(param.first) != expression.getVariables().end()) {
+                    float* pointer = expression.getVariablePointer(param.first);
+                    for (int i = 0; i < width; i++)
+                        pointer[i] = (float) param.second;
+                }
+        }
+        else {
+            Lepton::CompiledExpression& expression = data->expression;
+            for (auto& param : globalParameters)
+                if (expression.getVariables().find(param.first) != expression.getVariables().end())
+                    expression.getVariableReference(param.first) = param.second;
+        }
+    }
+
+    // Each thread computes its own bonds, then the ones that could not be assigned to a
+    // thread are computed at the end.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { computeBonds(bondForce.getThreadBonds(threadIndex), *threadData[threadIndex]); });
+    threads.waitForThreads();
+    computeBonds(bondForce.getExtraBonds(), *threadData[0]);
+
+    // Combine the energies and parameter derivatives from all the threads.
+
+    double energy = 0;
+    for (auto data : threadData) {
+        energy += data->energy;
+        for (int i = 0; i < numEnergyParamDerivs; i++)
+            energyParamDerivs[i] += data->energyParamDerivs[i];
+    }
+    return energy;
+}
+
+void CpuCustomCompoundBondForce::computeBonds(const vector<int>& bonds, ThreadData& data) {
+    int numBonds = bonds.size();
+    for (int start = 0; start < numBonds; start += BlockSize) {
+        if (useVectorExpression)
+            computeBlockVectorized(&bonds[start], min(start+BlockSize, numBonds)-start, data);
+        else
+            computeBlock(&bonds[start], min(start+BlockSize, numBonds)-start, data);
+    }
+}
+
+void CpuCustomCompoundBondForce::computeBlock(const int* bonds, int numBonds, ThreadData& data) {
+    // Record the coordinates and parameters of the bonds.
+
+    for (int i = 0; i < numParticlesPerBond; i++) {
+        double* x = &data.coordinates[3*i][0];
+        double* y = &data.coordinates[3*i+1][0];
+        double* z = &data.coordinates[3*i+2][0];
+        for (int bond = 0; bond < numBonds; bond++) {
+            const Vec3& pos = positions[bondAtoms[bonds[bond]][i]];
+            x[bond] = pos[0];
+            y[bond] = pos[1];
+            z[bond] = pos[2];
+        }
+    }
+    int numParameters = bondParameterNames.size();
+    for (int i = 0; i < numParameters; i++)
+        for (int bond = 0; bond < numBonds; bond++)
+            data.parameters[i][bond] = bondParameters[bonds[bond]][i];
+
+    // Compute the geometric terms.  The displacements they depend on are saved for computing forces.
+
+    int numTerms = terms.size();
+    for (int t = 0; t < numTerms; t++) {
+        const TermInfo& term = terms[t];
+        double* value = &data.termValues[t][0];
+        vector<double>* deltas = &data.deltas[9*t];
+        for (int bond = 0; bond < numBonds; bond++) {
+            Vec3 pos[4];
+            for (int i = 0; i < (int) term.atoms.size(); i++)
+                for (int j = 0; j < 3; j++)
+                    pos[i][j] = data.coordinates[3*term.atoms[i]+j][bond];
+            Vec3 delta[3];
+            if (term.type == TermInfo::Distance) {
+                delta[0] = computeDelta(pos[0], pos[1]);
+                value[bond] = sqrt(delta[0].dot(delta[0]));
+            }
+            else if (term.type == TermInfo::Angle) {
+                delta[0] = computeDelta(pos[1], pos[0]);
+                delta[1] = computeDelta(pos[1], pos[2]);
+                value[bond] = ReferenceBondIxn::getAngleBetweenTwoVectors(&delta[0][0], &delta[1][0]);
+            }
+            else {
+                delta[0] = computeDelta(pos[0], pos[1]);
+                delta[1] = computeDelta(pos[2], pos[1]);
+                delta[2] = computeDelta(pos[2], pos[3]);
+                value[bond] = ReferenceBondIxn::getDihedralAngleBetweenThreeVectors(&delta[0][0], &delta[1][0], &delta[2][0], NULL, NULL, &delta[0][0]);
+            }
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    deltas[3*i+j][bond] = delta[i][j];
+        }
+    }
+
+    // Evaluate the energy and its derivatives.
+
+    map<string, const double*> variables;
+    for (int i = 0; i < numParticlesPerBond; i++)
+        for (int j = 0; j < 3; j++) {
+            stringstream name;
+            name << "xyz"[j] << (i+1);
+            variables[name.str()] = &data.coordinates[3*i+j][0];
+        }
+    for (int i = 0; i < numParameters; i++)
+        variables[bondParameterNames[i]] = &data.parameters[i][0];
+    for (int t = 0; t < numTerms; t++)
+        variables[terms[t].name] = &data.termValues[t][0];
+    int firstCoordDeriv = 1+numTerms;
+    int firstParamDeriv = firstCoordDeriv+coordinateDerivs.size();
+    vector<double*> results;
+    for (auto& v : data.values)
+        results.push_back(&v[0]);
+    if (!includeEnergy)
+        results[0] = NULL;
+    if (!includeForces)
+        for (int i = 1; i < firstParamDeriv; i++)
+            results[i] = NULL;
+    data.expression.evaluate(numBonds, variables, results);
+
+    // Accumulate the energy and parameter derivatives.
+
+    if (includeEnergy)
+        for (int bond = 0; bond < numBonds; bond++)
+            data.energy += data.values[0][bond];
+    for (int i = 0; i < numEnergyParamDerivs; i++)
+        for (int bond = 0; bond < numBonds; bond++)
+            data.energyParamDerivs[i] += data.values[firstParamDeriv+i][bond];
+    if (!includeForces)
+        return;
+
+    // Apply forces from coordinates that appear directly in the expression.
+
+    for (int i = 0; i < (int) coordinateDerivs.size(); i++) {
+        int atom = coordinateDerivs[i].first;
+        int component = coordinateDerivs[i].second;
+        const double* dEdx = &data.values[firstCoordDeriv+i][0];
+        for (int bond = 0; bond < numBonds; bond++)
+            forces[bondAtoms[bonds[bond]][atom]][component] -= dEdx[bond];
+    }
+
+    // Apply forces from the geometric terms.
+
+    for (int t = 0; t < numTerms; t++) {
+        const TermInfo& term = terms[t];
+        const double* dEdTerm = &data.values[1+t][0];
+        const vector<double>* deltas = &data.deltas[9*t];
+        for (int bond = 0; bond < numBonds; bond++) {
+            const vector<int>& atoms = bondAtoms[bonds[bond]];
+            Vec3 delta[3];
+            for (int i = 0; i < 3; i++)
+                delta[i] = Vec3(deltas[3*i][bond], deltas[3*i+1][bond], deltas[3*i+2][bond]);
+            if (term.type == TermInfo::Distance) {
+                double r = sqrt(delta[0].dot(delta[0]));
+                if (r == 0)
+                    continue;
+                Vec3 f = delta[0]*(dEdTerm[bond]/r);
+                forces[atoms[term.atoms[0]]] -= f;
+                forces[atoms[term.atoms[1]]] += f;
+            }
+            else if (term.type == TermInfo::Angle) {
+                Vec3 thetaCross = delta[0].cross(delta[1]);
+                double lengthThetaCross = sqrt(thetaCross.dot(thetaCross));
+                if (lengthThetaCross < 1.0e-6)
+                    lengthThetaCross = 1.0e-6;
+                Vec3 f0 = delta[0].cross(thetaCross)*(dEdTerm[bond]/(delta[0].dot(delta[0])*lengthThetaCross));
+                Vec3 f2 = delta[1].cross(thetaCross)*(-dEdTerm[bond]/(delta[1].dot(delta[1])*lengthThetaCross));
+                forces[atoms[term.atoms[0]]] += f0;
+                forces[atoms[term.atoms[1]]] -= f0+f2;
+                forces[atoms[term.atoms[2]]] += f2;
+            }
+            else {
+                Vec3 cross1 = delta[0].cross(delta[1]);
+                Vec3 cross2 = delta[1].cross(delta[2]);
+                double norm2Delta32 = delta[1].dot(delta[1]);
+                double normDelta32 = sqrt(norm2Delta32);
+                Vec3 f0 = cross1*(-dEdTerm[bond]*normDelta32/cross1.dot(cross1));
+                Vec3 f3 = cross2*(dEdTerm[bond]*normDelta32/cross2.dot(cross2));
+                Vec3 s = f0*(delta[0].dot(delta[1])/norm2Delta32) - f3*(delta[2].dot(delta[1])/norm2Delta32);
+                forces[atoms[term.atoms[0]]] += f0;
+                forces[atoms[term.atoms[1]]] -= f0-s;
+                forces[atoms[term.atoms[2]]] -= f3+s;
+                forces[atoms[term.atoms[3]]] += f3;
+            }
+        }
+    }
+}
+
+void CpuCustomCompoundBondForce::computeBlockVectorized(const int* bonds, int numBonds, ThreadData& data) {
+    // Record the parameters of the bonds.
+
+    int numParameters = bondParameterNames.size();
+    for (int i = 0; i < numParameters; i++)
+        for (int bond = 0; bond < numBonds; bond++)
+            data.vecParameters[i][bond] = (float) bondParameters[bonds[bond]][i];
+
+    // Record the displacements each geometric term depends on.  The differences are taken in
+    // double precision before converting to float.  The block is padded to a multiple of 4 by
+    // repeating the last bond.
+
+    static const int deltaAtoms[3][3][2] = {{{0, 1}}, {{1, 0}, {1, 2}}, {{0, 1}, {2, 1}, {2, 3}}};
+    int paddedBonds = 4*((numBonds+3)/4);
+    int numTerms = terms.size();
+    for (int t = 0; t < numTerms; t++) {
+        const TermInfo& term = terms[t];
+        int numDeltas = term.atoms.size()-1;
+        for (int i = 0; i < numDeltas; i++) {
+            int atom1 = term.atoms[deltaAtoms[term.type][i][0]];
+            int atom2 = term.atoms[deltaAtoms[term.type][i][1]];
+            float* x = &data.vecDeltas[9*t+3*i][0];
+            float* y = &data.vecDeltas[9*t+3*i+1][0];
+            float* z = &data.vecDeltas[9*t+3*i+2][0];
+            for (int bond = 0; bond < paddedBonds; bond++) {
+                const vector<int>& atoms = bondAtoms[bonds[min(bond, numBonds-1)]];
+                Vec3 delta = positions[atoms[atom1]]-positions[atoms[atom2]];
+                x[bond] = (float) delta[0];
+                y[bond] = (float) delta[1];
+                z[bond] = (float) delta[2];
+            }
+        }
+    }
+
+    // Apply periodic boundary conditions and compute the geometric terms, four bonds at a time.
+
+    fvec4 boxSize[3], invBoxSize[3], boxVec[3][3];
+    if (usePeriodic)
+        for (int i = 0; i < 3; i++) {
+            boxSize[i] = fvec4((float) periodicBoxVectors[i][i]);
+            invBoxSize[i] = fvec4((float) (1.0/periodicBoxVectors[i][i]));
+            for (int j = 0; j < 3; j++)
+                boxVec[i][j] = fvec4((float) periodicBoxVectors[i][j]);
+        }
+    for (int t = 0; t < numTerms; t++) {
+        const TermInfo& term = terms[t];
+        int numDeltas = term.atoms.size()-1;
+        for (int bond = 0; bond < paddedBonds; bond += 4) {
+            fvec4 delta[3][3];
+            for (int i = 0; i < numDeltas; i++) {
+                for (int j = 0; j < 3; j++)
+                    delta[i][j] = fvec4(&data.vecDeltas[9*t+3*i+j][bond]);
+                if (usePeriodic) {
+                    for (int k = 2; k >= 0; k--) {
+                        fvec4 shift = floor(delta[i][k]*invBoxSize[k]+0.5f);
+                        for (int j = 0; j < 3; j++)
+                            delta[i][j] -= boxVec[k][j]*shift;
+                    }
+                    for (int j = 0; j < 3; j++)
+                        delta[i][j].store(&data.vecDeltas[9*t+3*i+j][bond]);
+                }
+            }
+            fvec4 value;
+            if (term.type == TermInfo::Distance)
+                value = sqrt(dotSoA(delta[0], delta[0]));
+            else if (term.type == TermInfo::Angle) {
+                fvec4 thetaCross[3];
+                crossSoA(delta[0], delta[1], thetaCross);
+                value = atan2SoA(sqrt(dotSoA(thetaCross, thetaCross)), dotSoA(delta[0], delta[1]));
+            }
+            else {
+                fvec4 cross1[3], cross2[3];
+                crossSoA(delta[0], delta[1], cross1);
+                crossSoA(delta[1], delta[2], cross2);
+                value = atan2SoA(sqrt(dotSoA(delta[1], delta[1]))*dotSoA(delta[0], cross2), dotSoA(cross1, cross2));
+            }
+            value.store(&data.vecTermValues[t][bond]);
+        }
+    }
+
+    // Evaluate the energy and its derivatives.
+
+    map<string, const float*> variables;
+    for (int i = 0; i < numParameters; i++)
+        variables[bondParameterNames[i]] = &data.vecParameters[i][0];
+    for (int t = 0; t < numTerms; t++)
+        variables[terms[t].name] = &data.vecTermValues[t][0];
+    int firstParamDeriv = 1+numTerms;
+    vector<float*> results;
+    for (auto& v : data.vecValues)
+        results.push_back(&v[0]);
+    if (!includeEnergy)
+        results[0] = NULL;
+    if (!includeForces)
+        for (int i = 1; i < firstParamDeriv; i++)
+            results[i] = NULL;
+    data.vecExpression.evaluate(numBonds, variables, results);
+
+    // Accumulate the energy and parameter derivatives.
+
+    if (includeEnergy)
+        for (int bond = 0; bond < numBonds; bond++)
+            data.energy += data.vecValues[0][bond];
+    for (int i = 0; i < numEnergyParamDerivs; i++)
+        for (int bond = 0; bond < numBonds; bond++)
+            data.energyParamDerivs[i] += data.vecValues[firstParamDeriv+i][bond];
+    if (!includeForces)
+        return;
+
+    // Apply forces from the geometric terms.  The forces on the atoms of four bonds are computed
+    // at once, then added to the force array one bond at a time.
+
+    for (int t = 0; t < numTerms; t++) {
+        const TermInfo& term = terms[t];
+        int numDeltas = term.atoms.size()-1;
+        int numAtoms = term.atoms.size();
+        for (int bond = 0; bond < paddedBonds; bond += 4) {
+            fvec4 delta[3][3], f[4][3];
+            for (int i = 0; i < numDeltas; i++)
+                for (int j = 0; j < 3; j++)
+                    delta[i][j] = fvec4(&data.vecDeltas[9*t+3*i+j][bond]);
+            fvec4 dEdTerm(&data.vecValues[1+t][bond]);
+            if (term.type == TermInfo::Distance) {
+                fvec4 r = sqrt(dotSoA(delta[0], delta[0]));
+                fvec4 scale = blendZero(dEdTerm/r, r != 0.0f);
+                for (int j = 0; j < 3; j++) {
+                    f[0][j] = -delta[0][j]*scale;
+                    f[1][j] = delta[0][j]*scale;
+                }
+            }
+            else if (term.type == TermInfo::Angle) {
+                fvec4 thetaCross[3], cross0[3], cross2[3];
+                crossSoA(delta[0], delta[1], thetaCross);
+                fvec4 lengthThetaCross = max(sqrt(dotSoA(thetaCross, thetaCross)), 1.0e-6f);
+                crossSoA(delta[0], thetaCross, cross0);
+                crossSoA(delta[1], thetaCross, cross2);
+                fvec4 scale0 = dEdTerm/(dotSoA(delta[0], delta[0])*lengthThetaCross);
+                fvec4 scale2 = -dEdTerm/(dotSoA(delta[1], delta[1])*lengthThetaCross);
+                for (int j = 0; j < 3; j++) {
+                    f[0][j] = cross0[j]*scale0;
+                    f[2][j] = cross2[j]*scale2;
+                    f[1][j] = -f[0][j]-f[2][j];
+                }
+            }
+            else {
+                fvec4 cross1[3], cross2[3];
+                crossSoA(delta[0], delta[1], cross1);
+                crossSoA(delta[1], delta[2], cross2);
+                fvec4 norm2Delta32 = dotSoA(delta[1], delta[1]);
+                fvec4 normDelta32 = sqrt(norm2Delta32);
+                fvec4 scale0 = -dEdTerm*normDelta32/dotSoA(cross1, cross1);
+                fvec4 scale3 = dEdTerm*normDelta32/dotSoA(cross2, cross2);
+                fvec4 s0 = dotSoA(delta[0], delta[1])/norm2Delta32;
+                fvec4 s3 = dotSoA(delta[2], delta[1])/norm2Delta32;
+                for (int j = 0; j < 3; j++) {
+                    f[0][j] = cross1[j]*scale0;
+                    f[3][j] = cross2[j]*scale3;
+                    fvec4 s = f[0][j]*s0 - f[3][j]*s3;
+                    f[1][j] = s-f[0][j];
+                    f[2][j] = -f[3][j]-s;
+                }
+            }
+            float components[4][3][4];
+            for (int i = 0; i < numAtoms; i++)
+                for (int j = 0; j < 3; j++)
+                    f[i][j].store(components[i][j]);
+            int count = min(4, numBonds-bond);
+            for (int k = 0; k < count; k++) {
+                const vector<int>& atoms = bondAtoms[bonds[bond+k]];
+                for (int i = 0; i < numAtoms; i++) {
+                    Vec3& force = forces[atoms[term.atoms[i]]];
+                    force[0] += components[i][0][k];
+                    force[1] += components[i][1][k];
+                    force[2] += components[i][2][k];
+                }
+            }
+        }
+    }
+}
+
+Vec3 CpuCustomCompoundBondForce::computeDelta(const Vec3& pos1, const Vec3& pos2) const {
+    Vec3 delta = pos1-pos2;
+    if (usePeriodic) {
+        delta -= periodicBoxVectors[2]*floor(delta[2]/periodicBoxVectors[2][2]+0.5);
+        delta -= periodicBoxVectors[1]*floor(delta[1]/periodicBoxVectors[1][1]+0.5);
+        delta -= periodicBoxVectors[0]*floor(delta[0]/periodicBoxVectors[0][0]+0.5);
+    }
+    return delta;
+}
@@ -0,0 +1,146 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuCustomExternalForce.h"
+#include "openmm/internal/hardware.h"
+#include <algorithm>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuCustomExternalForce::CpuCustomExternalForce(const Lepton::ParsedExpression& energyExpression, const vector<string>& parameterNames,
+            const vector<int>& particles, ThreadPool& threads) : threads(threads), particles(particles), parameterNames(parameterNames) {
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(energyExpression);
+    expressions.push_back(energyExpression.differentiate("x").optimize());
+    expressions.push_back(energyExpression.differentiate("y").optimize());
+    expressions.push_back(energyExpression.differentiate("z").optimize());
+    Lepton::CompiledVectorExpression expression = Lepton::ParsedExpression::createCompiledVectorExpression(expressions, getVectorWidth());
+    for (int i = 0; i < threads.getNumThreads(); i++)
+        threadData.push_back(new ThreadData(expression));
+}
+
+CpuCustomExternalForce::~CpuCustomExternalForce() {
+    for (auto data : threadData)
+        delete data;
+}
+
+void CpuCustomExternalForce::setParticleParameters(const vector<vector<double> >& particleParameters) {
+    // Store the parameters as one array for each parameter, so blocks of them can be passed directly to the expression.
+
+    int numParticles = particles.size();
+    int numParameters = parameterNames.size();
+    parameterValues.resize(numParameters);
+    for (int i = 0; i < numParameters; i++) {
+        parameterValues[i].resize(numParticles);
+        for (int j = 0; j < numParticles; j++)
+            parameterValues[i][j] = (float) particleParameters[j][i];
+    }
+}
+
+double CpuCustomExternalForce::calculateIxn(const vector<Vec3>& positions, const map<string, double>& globalParameters,
+            vector<AlignedArray<float> >& threadForce, bool includeForces, bool includeEnergy) {
+    // Record the parameters for the threads.
+
+    this->positions = &positions[0];
+    this->globalParameters = &globalParameters;
+    this->threadForce = &threadForce;
+    this->includeForces = includeForces;
+    this->includeEnergy = includeEnergy;
+    atomicCounter = 0;
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeForce(threads, threadIndex); });
+    threads.waitForThreads();
+
+    // Combine the energies from all the threads.
+
+    double energy = 0;
+    if (includeEnergy)
+        for (auto data : threadData)
+            energy += data->totalEnergy;
+    return energy;
+}
+
+void CpuCustomExternalForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
+    ThreadData& data = *threadData[threadIndex];
+    data.totalEnergy = 0;
+    Lepton::CompiledVectorExpression& expression = data.expression;
+    int width = expression.getWidth();
+    for (auto& param : *globalParameters)
+        if (expression.getVariables().find(param.first) != expression.getVariables().end()) {
+            float* pointer = expression.getVariablePointer(param.first);
+            for (int i = 0; i < width; i++)
+                pointer[i] = (float) param.second;
+        }
+    vector<float*> results = {includeEnergy ? data.energy.data() : NULL, data.forceX.data(), data.forceY.data(), data.forceZ.data()};
+    if (!includeForces)
+        results.resize(1);
+    map<string, const float*> variables = {{"x", data.x.data()}, {"y", data.y.data()}, {"z", data.z.data()}};
+    float* forces = &(*threadForce)[threadIndex][0];
+    int numParticles = particles.size();
+    int numParameters = parameterNames.size();
+    while (true) {
+        int start = BlockSize*(atomicCounter++);
+        if (start >= numParticles)
+            break;
+        int count = min(start+BlockSize, numParticles)-start;
+
+        // Gather the inputs for this block and evaluate the expression.
+
+        for (int i = 0; i < count; i++) {
+            const Vec3& pos = positions[particles[start+i]];
+            data.x[i] = (float) pos[0];
+            data.y[i] = (float) pos[1];
+            data.z[i] = (float) pos[2];
+        }
+        for (int i = 0; i < numParameters; i++)
+            variables[parameterNames[i]] = &parameterValues[i][start];
+        expression.evaluate(count, variables, results);
+
+        // Accumulate the results.
+
+        if (includeForces) {
+            for (int i = 0; i < count; i++) {
+                int index = 4*particles[start+i];
+                forces[index] -= data.forceX[i];
+                forces[index+1] -= data.forceY[i];
+                forces[index+2] -= data.forceZ[i];
+            }
+        }
+        if (includeEnergy)
+            for (int i = 0; i < count; i++)
+                data.totalEnergy += data.energy[i];
+    }
+}
+
+CpuCustomExternalForce::ThreadData::ThreadData(const Lepton::CompiledVectorExpression& expression) : expression(expression),
+        x(BlockSize), y(BlockSize), z(BlockSize), energy(BlockSize), forceX(BlockSize), forceY(BlockSize), forceZ(BlockSize) {
+}
@@ -39,13 +39,9 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
                       const vector<vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                       const vector<string>& valueNames,
                       const vector<Lepton::CompiledExpression>& energyExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
                       const vector<string>& parameterNames) :
             valueExpressions(valueExpressions), valueDerivExpressions(valueDerivExpressions), valueGradientExpressions(valueGradientExpressions),
-            valueParamDerivExpressions(valueParamDerivExpressions), energyExpressions(energyExpressions), energyDerivExpressions(energyDerivExpressions),
-            energyGradientExpressions(energyGradientExpressions), energyParamDerivExpressions(energyParamDerivExpressions) {
+            valueParamDerivExpressions(valueParamDerivExpressions), energyExpressions(energyExpressions) {
     firstAtom = (threadIndex*(long long) numAtoms)/numThreads;
     lastAtom = ((threadIndex+1)*(long long) numAtoms)/numThreads;
     map<string, double*> variableLocations;
@@ -96,21 +92,6 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
         expression.setVariableLocations(variableLocations);
         expressionSet.registerExpression(expression);
     }
-    for (auto& expressions : this->energyDerivExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
-    for (auto& expressions : this->energyGradientExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
-    for (auto& expressions : this->energyParamDerivExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
     value0.resize(numAtoms);
     dEdV.resize(valueNames.size());
     for (auto& v : dEdV)
@@ -132,16 +113,13 @@ CpuCustomGBForce::CpuCustomGBForce(int numAtoms, const std::vector<std::set<int>
                      const vector<string>& valueNames,
                      const vector<CustomGBForce::ComputationType>& valueTypes,
                      const vector<Lepton::CompiledExpression>& energyExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
                      const vector<CustomGBForce::ComputationType>& energyTypes,
                      const vector<string>& parameterNames, ThreadPool& threads) :
             exclusions(exclusions), cutoff(false), periodic(false), valueTypes(valueTypes), energyTypes(energyTypes), numValues(valueNames.size()),
             numParams(parameterNames.size()), threads(threads) {
     for (int i = 0; i < threads.getNumThreads(); i++)
         threadData.push_back(new ThreadData(numAtoms, threads.getNumThreads(), i, valueExpressions, valueDerivExpressions, valueGradientExpressions,
-                valueParamDerivExpressions, valueNames, energyExpressions, energyDerivExpressions, energyGradientExpressions, energyParamDerivExpressions, parameterNames));
+                valueParamDerivExpressions, valueNames, energyExpressions, parameterNames));
     values.resize(numValues);
     dEdV.resize(numValues);
     for (int i = 0; i < (int) values.size(); i++) {
@@ -431,18 +409,21 @@ void CpuCustomGBForce::calculateSingleParticleEnergyTerm(int index, ThreadData&
             data.param[j] = atomParameters[i][j];
         for (int j = 0; j < (int) values.size(); j++)
             data.value[j] = values[j][i];
+        const Lepton::CompiledExpression& expression = data.energyExpressions[index];
+        double energy = expression.evaluate();
         if (includeEnergy)
-            totalEnergy += (float) data.energyExpressions[index].evaluate();
+            totalEnergy += (float) energy;
         for (int j = 0; j < (int) values.size(); j++)
-            data.dEdV[j][i] += (float) data.energyDerivExpressions[index][j].evaluate();
-        forces[4*i+0] -= (float) data.energyGradientExpressions[index][0].evaluate();
-        forces[4*i+1] -= (float) data.energyGradientExpressions[index][1].evaluate();
-        forces[4*i+2] -= (float) data.energyGradientExpressions[index][2].evaluate();
+            data.dEdV[j][i] += (float) expression.getValue(j+1);
+        int gradientIndex = values.size()+1;
+        forces[4*i+0] -= (float) expression.getValue(gradientIndex);
+        forces[4*i+1] -= (float) expression.getValue(gradientIndex+1);
+        forces[4*i+2] -= (float) expression.getValue(gradientIndex+2);
         
         // Compute derivatives with respect to parameters.
         
-        for (int k = 0; k < data.energyParamDerivExpressions[index].size(); k++)
-            data.energyParamDerivs[k] += data.energyParamDerivExpressions[index][k].evaluate();
+        for (int k = 0; k < data.energyParamDerivs.size(); k++)
+            data.energyParamDerivs[k] += expression.getValue(gradientIndex+3+k);
     }
 }
 
@@ -515,22 +496,25 @@ void CpuCustomGBForce::calculateOnePairEnergyTerm(int index, int atom1, int atom
 
     // Evaluate the energy and its derivatives.
 
+    const Lepton::CompiledExpression& expression = data.energyExpressions[index];
+    double energy = expression.evaluate();
     if (includeEnergy)
-        totalEnergy += (float) data.energyExpressions[index].evaluate();
-    float dEdR = (float) data.energyDerivExpressions[index][0].evaluate();
+        totalEnergy += (float) energy;
+    float dEdR = (float) expression.getValue(1);
     dEdR *= 1/r;
     fvec4 result = deltaR*dEdR;
     (fvec4(forces+4*atom1)-result).store(forces+4*atom1);
     (fvec4(forces+4*atom2)+result).store(forces+4*atom2);
     for (int i = 0; i < (int) values.size(); i++) {
-        data.dEdV[i][atom1] += (float) data.energyDerivExpressions[index][2*i+1].evaluate();
-        data.dEdV[i][atom2] += (float) data.energyDerivExpressions[index][2*i+2].evaluate();
+        data.dEdV[i][atom1] += (float) expression.getValue(2*i+2);
+        data.dEdV[i][atom2] += (float) expression.getValue(2*i+3);
     }
         
     // Compute derivatives with respect to parameters.
 
-    for (int i = 0; i < data.energyParamDerivExpressions[index].size(); i++)
-        data.energyParamDerivs[i] += data.energyParamDerivExpressions[index][i].evaluate();
+    int firstParamDeriv = 2*values.size()+2;
+    for (int i = 0; i < data.energyParamDerivs.size(); i++)
+        data.energyParamDerivs[i] += expression.getValue(firstParamDeriv+i);
 }
 
 void CpuCustomGBForce::calculateChainRuleForces(ThreadData& data, int numAtoms, float* posq, vector<double>* atomParameters,
@@ -0,0 +1,434 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuCustomHbondForce.h"
+#include "ReferenceBondIxn.h"
+#include "ReferenceForce.h"
+#include "SimTKOpenMMUtilities.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+static const int DeltaSize = ReferenceForce::LastDeltaRIndex;
+
+CpuCustomHbondForce::TermInfo::TermInfo(const string& name, Type type, const vector<int>& termAtoms) : name(name), type(type) {
+    for (int i = 0; i < (int) termAtoms.size(); i++)
+        atoms[i] = termAtoms[i];
+}
+
+CpuCustomHbondForce::ThreadData::ThreadData(const Lepton::CompiledExpression& expression, const vector<TermInfo>& terms,
+            const vector<string>& donorParamNames, const vector<string>& acceptorParamNames) : expression(expression) {
+    for (auto& term : terms)
+        termValues.push_back(getVariablePointer(term.name));
+    for (auto& name : donorParamNames)
+        donorParams.push_back(getVariablePointer(name));
+    for (auto& name : acceptorParamNames)
+        acceptorParams.push_back(getVariablePointer(name));
+    deltas.resize(3*DeltaSize*terms.size());
+    crossProducts.resize(6*terms.size());
+}
+
+double* CpuCustomHbondForce::ThreadData::getVariablePointer(const string& name) {
+    if (expression.getVariables().find(name) == expression.getVariables().end())
+        return &unused;
+    return &expression.getVariableReference(name);
+}
+
+CpuCustomHbondForce::CpuCustomHbondForce(const vector<vector<int> >& donorAtoms, const vector<vector<int> >& acceptorAtoms,
+            const vector<set<int> >& exclusions, const Lepton::ParsedExpression& energyExpression,
+            const vector<string>& donorParameterNames, const vector<string>& acceptorParameterNames,
+            const map<string, vector<int> >& distances, const map<string, vector<int> >& angles,
+            const map<string, vector<int> >& dihedrals, ThreadPool& threads) : threads(threads), useCutoff(false), usePeriodic(false),
+            donorAtoms(donorAtoms), acceptorAtoms(acceptorAtoms), donorParamNames(donorParameterNames), acceptorParamNames(acceptorParameterNames) {
+    // Store the exclusions as sorted lists so they can be searched quickly.
+
+    this->exclusions.resize(exclusions.size());
+    for (int i = 0; i < (int) exclusions.size(); i++)
+        this->exclusions[i] = vector<int>(exclusions[i].begin(), exclusions[i].end());
+
+    // Compile the energy and its derivatives with respect to every term into a single expression.
+
+    for (auto& term : distances)
+        terms.push_back(TermInfo(term.first, TermInfo::Distance, term.second));
+    for (auto& term : angles)
+        terms.push_back(TermInfo(term.first, TermInfo::Angle, term.second));
+    for (auto& term : dihedrals)
+        terms.push_back(TermInfo(term.first, TermInfo::Dihedral, term.second));
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(energyExpression);
+    for (auto& term : terms)
+        expressions.push_back(energyExpression.differentiate(term.name).optimize());
+    Lepton::CompiledExpression expression = Lepton::ParsedExpression::createCompiledExpression(expressions);
+    for (int i = 0; i < threads.getNumThreads(); i++)
+        threadData.push_back(new ThreadData(expression, terms, donorParamNames, acceptorParamNames));
+
+    // Forces are accumulated in double precision, since a single atom can interact with many
+    // others.  Record which atoms can have forces so only they need to be processed.
+
+    set<int> atoms;
+    for (auto& group : donorAtoms)
+        atoms.insert(group.begin(), group.end());
+    for (auto& group : acceptorAtoms)
+        atoms.insert(group.begin(), group.end());
+    atoms.erase(-1);
+    atomsUsed = vector<int>(atoms.begin(), atoms.end());
+    int numAtoms = (atomsUsed.size() == 0 ? 0 : atomsUsed.back()+1);
+    for (auto data : threadData)
+        data->forces.resize(numAtoms);
+}
+
+CpuCustomHbondForce::~CpuCustomHbondForce() {
+    for (auto data : threadData)
+        delete data;
+}
+
+void CpuCustomHbondForce::setUseCutoff(double distance) {
+    useCutoff = true;
+    cutoffDistance = distance;
+}
+
+void CpuCustomHbondForce::setPeriodic(Vec3* periodicBoxVectors) {
+    usePeriodic = true;
+    this->periodicBoxVectors[0] = periodicBoxVectors[0];
+    this->periodicBoxVectors[1] = periodicBoxVectors[1];
+    this->periodicBoxVectors[2] = periodicBoxVectors[2];
+}
+
+void CpuCustomHbondForce::setParameters(const vector<vector<double> >& donorParameters, const vector<vector<double> >& acceptorParameters) {
+    donorParamValues = donorParameters;
+    acceptorParamValues = acceptorParameters;
+}
+
+double CpuCustomHbondForce::calculateIxn(const vector<Vec3>& positions, const map<string, double>& globalParameters,
+            vector<AlignedArray<float> >& threadForce, bool includeForces, bool includeEnergy) {
+    // Record the parameters for the threads.
+
+    this->positions = &positions[0];
+    this->threadForce = &threadForce;
+    this->includeForces = includeForces;
+    this->includeEnergy = includeEnergy;
+    for (auto data : threadData)
+        for (auto& param : globalParameters)
+            *data->getVariablePointer(param.first) = param.second;
+    if (useCutoff)
+        buildCellGrid();
+
+    // Compute the interactions.
+
+    atomicCounter = 0;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeForce(threads, threadIndex); });
+    threads.waitForThreads();
+
+    // Combine the energies from all the threads.
+
+    double energy = 0;
+    for (auto data : threadData)
+        energy += data->energy;
+    return energy;
+}
+
+void CpuCustomHbondForce::buildCellGrid() {
+    // Decide how many cells to use along each axis.  Every cell must be at least as wide as the
+    // cutoff, so any acceptor within the cutoff of a donor is in the same cell or an adjacent one.
+
+    const int maxCellsPerAxis = 64;
+    int numAcceptors = acceptorAtoms.size();
+    if (usePeriodic) {
+        // The cells are defined in the coordinate system of the box vectors.  The width of the box
+        // along each axis is its volume divided by the area of the opposite face.
+
+        const Vec3* box = periodicBoxVectors;
+        double volume = box[0][0]*box[1][1]*box[2][2];
+        for (int i = 0; i < 3; i++) {
+            Vec3 face = box[(i+1)%3].cross(box[(i+2)%3]);
+            double width = volume/sqrt(face.dot(face));
+            numCells[i] = max(1, min(maxCellsPerAxis, (int) floor(width/cutoffDistance)));
+        }
+    }
+    else {
+        Vec3 minPos, maxPos;
+        if (numAcceptors > 0)
+            minPos = maxPos = positions[acceptorAtoms[0][0]];
+        for (int i = 1; i < numAcceptors; i++) {
+            const Vec3& pos = positions[acceptorAtoms[i][0]];
+            for (int j = 0; j < 3; j++) {
+                minPos[j] = min(minPos[j], pos[j]);
+                maxPos[j] = max(maxPos[j], pos[j]);
+            }
+        }
+        gridOrigin = minPos;
+        for (int i = 0; i < 3; i++) {
+            double width = maxPos[i]-minPos[i];
+            numCells[i] = max(1, min(maxCellsPerAxis, (int) floor(width/cutoffDistance)));
+            gridScale[i] = (width > 0 ? 1.0/width : 0.0);
+        }
+    }
+
+    // Sort the acceptors by cell.
+
+    int totalCells = numCells[0]*numCells[1]*numCells[2];
+    vector<int> acceptorCell(numAcceptors);
+    cellStart.resize(totalCells+1);
+    fill(cellStart.begin(), cellStart.end(), 0);
+    for (int i = 0; i < numAcceptors; i++) {
+        int cell[3];
+        getCell(positions[acceptorAtoms[i][0]], cell);
+        acceptorCell[i] = cell[0]+numCells[0]*(cell[1]+numCells[1]*cell[2]);
+        cellStart[acceptorCell[i]+1]++;
+    }
+    for (int i = 0; i < totalCells; i++)
+        cellStart[i+1] += cellStart[i];
+    cellAcceptors.resize(numAcceptors);
+    vector<int> cellEnd(cellStart.begin(), cellStart.end()-1);
+    for (int i = 0; i < numAcceptors; i++)
+        cellAcceptors[cellEnd[acceptorCell[i]]++] = i;
+}
+
+void CpuCustomHbondForce::getCell(const Vec3& pos, int* cell) const {
+    double scaled[3];
+    if (usePeriodic) {
+        const Vec3* box = periodicBoxVectors;
+        scaled[2] = pos[2]/box[2][2];
+        scaled[1] = (pos[1]-scaled[2]*box[2][1])/box[1][1];
+        scaled[0] = (pos[0]-scaled[2]*box[2][0]-scaled[1]*box[1][0])/box[0][0];
+        for (int i = 0; i < 3; i++)
+            scaled[i] -= floor(scaled[i]);
+    }
+    else
+        for (int i = 0; i < 3; i++)
+            scaled[i] = (pos[i]-gridOrigin[i])*gridScale[i];
+    for (int i = 0; i < 3; i++)
+        cell[i] = max(0, min(numCells[i]-1, (int) floor(scaled[i]*numCells[i])));
+}
+
+void CpuCustomHbondForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
+    ThreadData& data = *threadData[threadIndex];
+    data.energy = 0;
+    Vec3* forces = data.forces.data();
+    if (includeForces)
+        for (int atom : atomsUsed)
+            forces[atom] = Vec3();
+    int numDonors = donorAtoms.size();
+    int numAcceptors = acceptorAtoms.size();
+    int numDonorParams = donorParamNames.size();
+    while (true) {
+        int donor = atomicCounter++;
+        if (donor >= numDonors)
+            break;
+        for (int i = 0; i < numDonorParams; i++)
+            *data.donorParams[i] = donorParamValues[donor][i];
+        const vector<int>& excluded = exclusions[donor];
+        if (!useCutoff) {
+            for (int acceptor = 0; acceptor < numAcceptors; acceptor++)
+                if (!binary_search(excluded.begin(), excluded.end(), acceptor))
+                    calculateOneIxn(donor, acceptor, data, forces);
+            continue;
+        }
+
+        // Identify the range of cells to search along each axis.  If there are fewer than three
+        // cells along an axis, all of them must be searched.
+
+        int donorCell[3], firstCell[3], lastCell[3];
+        getCell(positions[donorAtoms[donor][0]], donorCell);
+        for (int i = 0; i < 3; i++) {
+            if (numCells[i] < 3) {
+                firstCell[i] = 0;
+                lastCell[i] = numCells[i]-1;
+            }
+            else if (usePeriodic) {
+                firstCell[i] = donorCell[i]-1;
+                lastCell[i] = donorCell[i]+1;
+            }
+            else {
+                firstCell[i] = max(0, donorCell[i]-1);
+                lastCell[i] = min(numCells[i]-1, donorCell[i]+1);
+            }
+        }
+
+        // Loop over acceptors in the neighboring cells.
+
+        for (int z = firstCell[2]; z <= lastCell[2]; z++) {
+            int cellz = (z+numCells[2])%numCells[2];
+            for (int y = firstCell[1]; y <= lastCell[1]; y++) {
+                int celly = (y+numCells[1])%numCells[1];
+                for (int x = firstCell[0]; x <= lastCell[0]; x++) {
+                    int cellx = (x+numCells[0])%numCells[0];
+                    int cell = cellx+numCells[0]*(celly+numCells[1]*cellz);
+                    for (int i = cellStart[cell]; i < cellStart[cell+1]; i++) {
+                        int acceptor = cellAcceptors[i];
+                        if (!binary_search(excluded.begin(), excluded.end(), acceptor))
+                            calculateOneIxn(donor, acceptor, data, forces);
+                    }
+                }
+            }
+        }
+    }
+
+    // Add the forces to this thread's force buffer.
+
+    if (includeForces) {
+        float* f = &(*threadForce)[threadIndex][0];
+        for (int atom : atomsUsed)
+            for (int j = 0; j < 3; j++)
+                f[4*atom+j] += (float) forces[atom][j];
+    }
+}
+
+void CpuCustomHbondForce::calculateOneIxn(int donor, int acceptor, ThreadData& data, Vec3* forces) {
+    int atoms[6];
+    atoms[0] = acceptorAtoms[acceptor][0];
+    atoms[1] = acceptorAtoms[acceptor][1];
+    atoms[2] = acceptorAtoms[acceptor][2];
+    atoms[3] = donorAtoms[donor][0];
+    atoms[4] = donorAtoms[donor][1];
+    atoms[5] = donorAtoms[donor][2];
+
+    // Compute the distance between the primary donor and acceptor atoms, and compare to the cutoff.
+
+    if (useCutoff) {
+        double delta[DeltaSize];
+        computeDelta(atoms[0], atoms[3], delta);
+        if (delta[ReferenceForce::RIndex] >= cutoffDistance)
+            return;
+    }
+
+    // Compute all of the variables the energy can depend on.
+
+    for (int i = 0; i < (int) acceptorParamNames.size(); i++)
+        *data.acceptorParams[i] = acceptorParamValues[acceptor][i];
+    int numTerms = terms.size();
+    for (int i = 0; i < numTerms; i++) {
+        const TermInfo& term = terms[i];
+        double* delta1 = &data.deltas[3*DeltaSize*i];
+        double* delta2 = delta1+DeltaSize;
+        double* delta3 = delta2+DeltaSize;
+        if (term.type == TermInfo::Distance) {
+            computeDelta(atoms[term.atoms[0]], atoms[term.atoms[1]], delta1);
+            *data.termValues[i] = delta1[ReferenceForce::RIndex];
+        }
+        else if (term.type == TermInfo::Angle) {
+            computeDelta(atoms[term.atoms[0]], atoms[term.atoms[1]], delta1);
+            computeDelta(atoms[term.atoms[2]], atoms[term.atoms[1]], delta2);
+            double cosine = DOT3(delta1, delta2)/sqrt(delta1[ReferenceForce::R2Index]*delta2[ReferenceForce::R2Index]);
+            double angle;
+            if (cosine >= 1)
+                angle = 0;
+            else if (cosine <= -1)
+                angle = PI_M;
+            else
+                angle = acos(cosine);
+            *data.termValues[i] = angle;
+        }
+        else {
+            computeDelta(atoms[term.atoms[1]], atoms[term.atoms[0]], delta1);
+            computeDelta(atoms[term.atoms[1]], atoms[term.atoms[2]], delta2);
+            computeDelta(atoms[term.atoms[3]], atoms[term.atoms[2]], delta3);
+            double dotDihedral, signOfDihedral;
+            double* crossProduct[] = {&data.crossProducts[6*i], &data.crossProducts[6*i+3]};
+            *data.termValues[i] = ReferenceBondIxn::getDihedralAngleBetweenThreeVectors(delta1, delta2, delta3, crossProduct, &dotDihedral, delta1, &signOfDihedral, 1);
+        }
+    }
+
+    // Evaluate the energy and its derivatives.
+
+    Lepton::CompiledExpression& expression = data.expression;
+    expression.evaluate();
+    if (includeEnergy)
+        data.energy += expression.getValue(0);
+    if (!includeForces)
+        return;
+
+    // Apply the forces.
+
+    for (int i = 0; i < numTerms; i++) {
+        const TermInfo& term = terms[i];
+        double* delta1 = &data.deltas[3*DeltaSize*i];
+        double* delta2 = delta1+DeltaSize;
+        double* delta3 = delta2+DeltaSize;
+        double dEdTerm = expression.getValue(i+1);
+        if (term.type == TermInfo::Distance) {
+            double dEdR = dEdTerm/delta1[ReferenceForce::RIndex];
+            Vec3 force = Vec3(delta1[0], delta1[1], delta1[2])*(-dEdR);
+            forces[atoms[term.atoms[0]]] -= force;
+            forces[atoms[term.atoms[1]]] += force;
+        }
+        else if (term.type == TermInfo::Angle) {
+            double thetaCross[3];
+            SimTKOpenMMUtilities::crossProductVector3(delta1, delta2, thetaCross);
+            double lengthThetaCross = sqrt(DOT3(thetaCross, thetaCross));
+            if (lengthThetaCross < 1.0e-06)
+                lengthThetaCross = 1.0e-06;
+            double termA = dEdTerm/(delta1[ReferenceForce::R2Index]*lengthThetaCross);
+            double termC = -dEdTerm/(delta2[ReferenceForce::R2Index]*lengthThetaCross);
+            double deltaCrossP[3][3];
+            SimTKOpenMMUtilities::crossProductVector3(delta1, thetaCross, deltaCrossP[0]);
+            SimTKOpenMMUtilities::crossProductVector3(delta2, thetaCross, deltaCrossP[2]);
+            for (int j = 0; j < 3; j++) {
+                deltaCrossP[0][j] *= termA;
+                deltaCrossP[2][j] *= termC;
+                deltaCrossP[1][j] = -(deltaCrossP[0][j]+deltaCrossP[2][j]);
+            }
+            for (int k = 0; k < 3; k++)
+                forces[atoms[term.atoms[k]]] += Vec3(deltaCrossP[k][0], deltaCrossP[k][1], deltaCrossP[k][2]);
+        }
+        else {
+            const double* cross1 = &data.crossProducts[6*i];
+            const double* cross2 = &data.crossProducts[6*i+3];
+            double internalF[4][3];
+            double forceFactors[4];
+            double normCross1 = DOT3(cross1, cross1);
+            double normBC = delta2[ReferenceForce::RIndex];
+            forceFactors[0] = (-dEdTerm*normBC)/normCross1;
+            double normCross2 = DOT3(cross2, cross2);
+            forceFactors[3] = (dEdTerm*normBC)/normCross2;
+            forceFactors[1] = DOT3(delta1, delta2)/delta2[ReferenceForce::R2Index];
+            forceFactors[2] = DOT3(delta3, delta2)/delta2[ReferenceForce::R2Index];
+            for (int j = 0; j < 3; j++) {
+                internalF[0][j] = forceFactors[0]*cross1[j];
+                internalF[3][j] = forceFactors[3]*cross2[j];
+                double s = forceFactors[1]*internalF[0][j] - forceFactors[2]*internalF[3][j];
+                internalF[1][j] = internalF[0][j] - s;
+                internalF[2][j] = internalF[3][j] + s;
+            }
+            forces[atoms[term.atoms[0]]] += Vec3(internalF[0][0], internalF[0][1], internalF[0][2]);
+            forces[atoms[term.atoms[1]]] -= Vec3(internalF[1][0], internalF[1][1], internalF[1][2]);
+            forces[atoms[term.atoms[2]]] -= Vec3(internalF[2][0], internalF[2][1], internalF[2][2]);
+            forces[atoms[term.atoms[3]]] += Vec3(internalF[3][0], internalF[3][1], internalF[3][2]);
+        }
+    }
+}
+
+void CpuCustomHbondForce::computeDelta(int atom1, int atom2, double* delta) const {
+    if (usePeriodic)
+        ReferenceForce::getDeltaRPeriodic(positions[atom1], positions[atom2], periodicBoxVectors, delta);
+    else
+        ReferenceForce::getDeltaR(positions[atom1], positions[atom2], delta);
+}
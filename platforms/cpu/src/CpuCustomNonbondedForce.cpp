@@ -30,14 +30,11 @@ using namespace OpenMM;
 using namespace Lepton;
 using namespace std;
 
-CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& energyExpression, const CompiledVectorExpression& energyVecExpression,
-            const CompiledExpression& forceExpression, const CompiledVectorExpression& forceVecExpression,
-            const vector<string>& parameterNames, const std::vector<CompiledExpression> energyParamDerivExpressions,
-            const vector<string>& computedValueNames, const vector<CompiledExpression> computedValueExpressions,
-            vector<vector<double> >& atomComputedValues) :
-            energyExpression(energyExpression), energyVecExpression(energyVecExpression), forceExpression(forceExpression),
-            forceVecExpression(forceVecExpression), energyParamDerivExpressions(energyParamDerivExpressions),
-            computedValueExpressions(computedValueExpressions), atomComputedValues(atomComputedValues) {
+CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& expression, const CompiledVectorExpression& vecExpression,
+            const vector<string>& parameterNames, const vector<string>& computedValueNames,
+            const vector<CompiledExpression> computedValueExpressions, vector<vector<double> >& atomComputedValues) :
+            expression(expression), vecExpression(vecExpression), computedValueExpressions(computedValueExpressions),
+            atomComputedValues(atomComputedValues) {
     // Prepare for passing variables to expressions.
 
     map<string, double*> variableLocations;
@@ -52,15 +49,9 @@ CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& energy
         variableLocations[computedValueNames[i]+"1"] = &computedValues[i*2];
         variableLocations[computedValueNames[i]+"2"] = &computedValues[i*2+1];
     }
-    energyParamDerivs.resize(energyParamDerivExpressions.size());
-    this->energyExpression.setVariableLocations(variableLocations);
-    this->forceExpression.setVariableLocations(variableLocations);
-    expressionSet.registerExpression(this->energyExpression);
-    expressionSet.registerExpression(this->forceExpression);
-    for (auto& expression : this->energyParamDerivExpressions) {
-        expression.setVariableLocations(variableLocations);
-        expressionSet.registerExpression(expression);
-    }
+    energyParamDerivs.resize(expression.getNumValues()-2);
+    this->expression.setVariableLocations(variableLocations);
+    expressionSet.registerExpression(this->expression);
 
     // Prepare for passing variables to vectorized expressions.
 
@@ -80,8 +71,7 @@ CpuCustomNonbondedForce::ThreadData::ThreadData(const CompiledExpression& energy
         vecVariableLocations[computedValueNames[i]+"1"] = &vecParticle1Values[i*blockSize];
         vecVariableLocations[computedValueNames[i]+"2"] = &vecParticle2Values[i*blockSize];
     }
-    this->energyVecExpression.setVariableLocations(vecVariableLocations);
-    this->forceVecExpression.setVariableLocations(vecVariableLocations);
+    this->vecExpression.setVariableLocations(vecVariableLocations);
 
     // Prepare for passing variables to the computed value expressions.
 
@@ -105,18 +95,22 @@ void CpuCustomNonbondedForce::initialize(const ParsedExpression& energyExpressio
     this->paramNames = parameterNames;
     this->exclusions = exclusions;
     this->computedValueNames = computedValueNames;
-    CompiledExpression compiledEnergyExpression = energyExpression.createCompiledExpression();
-    CompiledExpression compiledForceExpression = forceExpression.createCompiledExpression();
-    CompiledVectorExpression energyVecExpression = energyExpression.createCompiledVectorExpression(getVectorWidth());
-    CompiledVectorExpression forceVecExpression = forceExpression.createCompiledVectorExpression(getVectorWidth());
-    vector<CompiledExpression> compiledDerivExpressions, compiledValueExpressions;
-    for (auto& exp : energyParamDerivExpressions)
-        compiledDerivExpressions.push_back(exp.createCompiledExpression());
+
+    // The energy, its derivative with respect to r, and its derivatives with respect to parameters
+    // are compiled together so subexpressions they share only get computed once.
+
+    vector<ParsedExpression> expressions;
+    expressions.push_back(energyExpression);
+    expressions.push_back(forceExpression);
+    CompiledVectorExpression compiledVecExpression = ParsedExpression::createCompiledVectorExpression(expressions, getVectorWidth());
+    expressions.insert(expressions.end(), energyParamDerivExpressions.begin(), energyParamDerivExpressions.end());
+    CompiledExpression compiledExpression = ParsedExpression::createCompiledExpression(expressions);
+    vector<CompiledExpression> compiledValueExpressions;
     for (auto& exp : computedValueExpressions)
         compiledValueExpressions.push_back(exp.createCompiledExpression());
     for (int i = 0; i < threads.getNumThreads(); i++)
-        threadData.push_back(new ThreadData(compiledEnergyExpression, energyVecExpression, compiledForceExpression, forceVecExpression, parameterNames,
-                compiledDerivExpressions, computedValueNames, compiledValueExpressions, atomComputedValues));
+        threadData.push_back(new ThreadData(compiledExpression, compiledVecExpression, parameterNames,
+                computedValueNames, compiledValueExpressions, atomComputedValues));
 }
 
 CpuCustomNonbondedForce::~CpuCustomNonbondedForce() {
@@ -220,15 +214,7 @@ void CpuCustomNonbondedForce::threadComputeForce(ThreadPool& threads, int thread
     for (auto& param : *globalParameters) {
         data.expressionSet.setVariable(data.expressionSet.getVariableIndex(param.first), param.second);
         try {
-            float* p = data.energyVecExpression.getVariablePointer(param.first);
-            for (int i = 0; i < blockSize; i++)
-                p[i] = param.second;
-        }
-        catch (...) {
-            // The expression doesn't use this parameter.
-        }
-        try {
-            float* p = data.forceVecExpression.getVariablePointer(param.first);
+            float* p = data.vecExpression.getVariablePointer(param.first);
             for (int i = 0; i < blockSize; i++)
                 p[i] = param.second;
         }
@@ -332,10 +318,10 @@ void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data,
 
     // accumulate forces
 
-    double dEdR = (includeForce ? data.forceExpression.evaluate()/r : 0.0);
-    double energy = 0.0;
-    if (includeEnergy || (useSwitch && r > switchingDistance))
-        energy = data.energyExpression.evaluate();
+    double energy = data.expression.evaluate();
+    double dEdR = (includeForce ? data.expression.getValue(1)/r : 0.0);
+    if (!includeEnergy && !(useSwitch && r > switchingDistance))
+        energy = 0.0;
     double switchValue = 1.0;
     if (useSwitch) {
         if (r > switchingDistance) {
@@ -356,8 +342,8 @@ void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data,
     
     // Accumulate energy derivatives.
 
-    for (int i = 0; i < data.energyParamDerivExpressions.size(); i++)
-        data.energyParamDerivs[i] += switchValue*data.energyParamDerivExpressions[i].evaluate();
+    for (int i = 0; i < data.energyParamDerivs.size(); i++)
+        data.energyParamDerivs[i] += switchValue*data.expression.getValue(i+2);
 }
 
 void CpuCustomNonbondedForce::getDeltaR(const fvec4& posI, const fvec4& posJ, fvec4& deltaR, float& r2, const fvec4& boxSize, const fvec4& invBoxSize) const {
@@ -0,0 +1,108 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuExclusionList.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuExclusionList::CpuExclusionList() : offsets(1, 0), version(createVersion()) {
+}
+
+CpuExclusionList::CpuExclusionList(int numAtoms) : offsets(numAtoms+1, 0), version(createVersion()) {
+}
+
+CpuExclusionList::CpuExclusionList(const vector<set<int> >& exclusions) : version(createVersion()) {
+    int numAtoms = exclusions.size();
+    offsets.resize(numAtoms+1);
+    offsets[0] = 0;
+    for (int i = 0; i < numAtoms; i++)
+        offsets[i+1] = offsets[i]+exclusions[i].size();
+    indices.reserve(offsets[numAtoms]);
+    for (int i = 0; i < numAtoms; i++)
+        indices.insert(indices.end(), exclusions[i].begin(), exclusions[i].end());
+}
+
+CpuExclusionList::CpuExclusionList(int numAtoms, const vector<pair<int, int> >& pairs, ThreadPool& threads) : version(createVersion()) {
+    // Bucket the pairs by atom.
+
+    vector<int> start(numAtoms+1, 0);
+    for (auto& p : pairs) {
+        start[p.first+1]++;
+        start[p.second+1]++;
+    }
+    for (int i = 0; i < numAtoms; i++)
+        start[i+1] += start[i];
+    vector<int> unsorted(start[numAtoms]);
+    vector<int> next(start.begin(), start.end()-1);
+    for (auto& p : pairs) {
+        unsorted[next[p.first]++] = p.second;
+        unsorted[next[p.second]++] = p.first;
+    }
+
+    // Sort each atom's list and remove duplicates.  This is where most of the time goes,
+    // so it is done in parallel.
+
+    vector<int> count(numAtoms);
+    int numThreads = threads.getNumThreads();
+    threads.execute([&] (ThreadPool& pool, int threadIndex) {
+        int first = (long long) numAtoms*threadIndex/numThreads;
+        int last = (long long) numAtoms*(threadIndex+1)/numThreads;
+        for (int i = first; i < last; i++) {
+            auto begin = unsorted.begin()+start[i];
+            auto end = unsorted.begin()+start[i+1];
+            sort(begin, end);
+            count[i] = unique(begin, end)-begin;
+        }
+    });
+    threads.waitForThreads();
+
+    // Pack the lists together.
+
+    offsets.resize(numAtoms+1);
+    offsets[0] = 0;
+    for (int i = 0; i < numAtoms; i++)
+        offsets[i+1] = offsets[i]+count[i];
+    indices.resize(offsets[numAtoms]);
+    for (int i = 0; i < numAtoms; i++)
+        copy(unsorted.begin()+start[i], unsorted.begin()+start[i]+count[i], indices.begin()+offsets[i]);
+}
+
+bool CpuExclusionList::isExcluded(int atom1, int atom2) const {
+    const int* begin = getExclusions(atom1);
+    const int* end = begin+getNumExclusions(atom1);
+    return binary_search(begin, end, atom2);
+}
+
+long long CpuExclusionList::createVersion() {
+    static atomic<long long> nextVersion(0);
+    return nextVersion++;
+}
@@ -35,6 +35,7 @@
 #include "ReferenceForce.h"
 #include "openmm/OpenMMException.h"
 #include "openmm/GayBerneForce.h"
+#include "openmm/internal/vectorize.h"
 #include <algorithm>
 #include <cmath>
 
@@ -90,6 +91,9 @@ CpuGayBerneForce::CpuGayBerneForce(const GayBerneForce& force) {
     A.resize(numParticles);
     B.resize(numParticles);
     G.resize(numParticles);
+    xAxis.resize(numParticles);
+    xAxisScaled.resize(numParticles);
+    yAxisScaled.resize(numParticles);
 
     // We can precompute the shape factors.
 
@@ -103,28 +107,42 @@ const vector<set<int> >& CpuGayBerneForce::getExclusions() const {
     return particleExclusions;
 }
 
-double CpuGayBerneForce::calculateForce(const vector<Vec3>& positions, std::vector<Vec3>& forces, std::vector<AlignedArray<float> >& threadForce, Vec3* boxVectors, CpuPlatform::PlatformData& data) {
+double CpuGayBerneForce::calculateForce(const vector<Vec3>& positions, std::vector<AlignedArray<float> >& threadForce, Vec3* boxVectors, CpuPlatform::PlatformData& data) {
     if (nonbondedMethod == GayBerneForce::CutoffPeriodic) {
         double minAllowedSize = 1.999999*cutoffDistance;
         if (boxVectors[0][0] < minAllowedSize || boxVectors[1][1] < minAllowedSize || boxVectors[2][2] < minAllowedSize)
             throw OpenMMException("The periodic box size has decreased to less than twice the nonbonded cutoff.");
     }
 
-    // First find the orientations of the particles and compute the matrices we'll be needing.
-
-    computeEllipsoidFrames(positions);
-
     // Record the parameters for the threads.
     
     ThreadPool& threads = data.threads;
     int numThreads = threads.getNumThreads();
+    int numParticles = particles.size();
     this->positions = &positions[0];
+    this->posq = &data.posq[0];
     this->threadForce = &threadForce;
     this->boxVectors = boxVectors;
+    for (int i = 0; i < 3; i++) {
+        boxSize[i] = (float) boxVectors[i][i];
+        recipBoxSize[i] = (float) (1/boxVectors[i][i]);
+    }
+    triclinic = (boxVectors[0][1] != 0 || boxVectors[0][2] != 0 || boxVectors[1][0] != 0 || boxVectors[1][2] != 0 || boxVectors[2][0] != 0 || boxVectors[2][1] != 0);
+
+    // The single precision positions in posq are wrapped into the box whenever any Force in the System
+    // is periodic, so they can only be used to screen out distant pairs if that agrees with this Force.
+
+    useSingleDistances = ((nonbondedMethod == GayBerneForce::CutoffPeriodic) == data.isPeriodic);
     threadEnergy.resize(numThreads);
-    threadTorque.resize(numThreads);
     atomicCounter = 0;
-    
+
+    // Find the orientations of the particles and compute the matrices we'll be needing.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        computeEllipsoidFrames(positions, threadIndex*numParticles/numThreads, (threadIndex+1)*numParticles/numThreads);
+    });
+    threads.waitForThreads();
+
     // Signal the threads to compute the pairwise interactions.
     
     threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeForce(threads, threadIndex, data.neighborList); });
@@ -141,10 +159,6 @@ double CpuGayBerneForce::calculateForce(const vector<Vec3>& positions, std::vect
     double energy = 0;
     for (int i = 0; i < numThreads; i++)
         energy += threadEnergy[i];
-    
-    // Apply torques.
-    
-    applyTorques(positions, forces);
     return energy;
 }
 
@@ -153,10 +167,6 @@ void CpuGayBerneForce::threadComputeForce(ThreadPool& threads, int threadIndex,
     int numThreads = threads.getNumThreads();
     threadEnergy[threadIndex] = 0;
     float* forces = &(*threadForce)[threadIndex][0];
-    vector<Vec3>& torques = threadTorque[threadIndex];
-    torques.resize(numParticles);
-    for (int i = 0; i < numParticles; i++)
-        torques[i] = Vec3();
     double energy = 0.0;
 
     // Compute this thread's subset of interactions.
@@ -175,31 +185,49 @@ void CpuGayBerneForce::threadComputeForce(ThreadPool& threads, int threadIndex,
                     continue; // This interaction will be handled by an exception.
                 double sigma = particles[i].sigmaOver2+particles[j].sigmaOver2;
                 double epsilon = particles[i].sqrtEpsilon*particles[j].sqrtEpsilon;
-                energy += computeOneInteraction(i, j, sigma, epsilon, positions, forces, torques, boxVectors);
+                energy += computeOneInteraction(i, j, sigma, epsilon, positions, forces, boxVectors);
             }
         }
     }
     else {
+        // The neighbor list includes padding, so many of the pairs in it are beyond the cutoff.  Compute
+        // single precision distances to a whole block at once to skip them cheaply.  The limit is
+        // slightly larger than the cutoff so rounding error can never discard a pair that is inside
+        // it.  computeOneInteraction() applies the exact cutoff in double precision.
+
+        const int blockSize = neighborList->getBlockSize();
+        const int paddedBlockSize = 4*((blockSize+3)/4);
+        vector<float> blockX(paddedBlockSize, 0.0f), blockY(paddedBlockSize, 0.0f), blockZ(paddedBlockSize, 0.0f), r2(paddedBlockSize);
+        float screeningCutoff = (float) (cutoffDistance*1.0001+1e-4);
+        float screeningCutoff2 = screeningCutoff*screeningCutoff;
         while (true) {
             int blockIndex = atomicCounter++;
             if (blockIndex >= neighborList->getNumBlocks())
                 break;
-            const int blockSize = neighborList->getBlockSize();
             const int32_t* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
             const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
             const auto& exclusions = neighborList->getBlockExclusions(blockIndex);
+            for (int k = 0; k < blockSize; k++) {
+                blockX[k] = posq[4*blockAtom[k]];
+                blockY[k] = posq[4*blockAtom[k]+1];
+                blockZ[k] = posq[4*blockAtom[k]+2];
+            }
             for (int i = 0; i < (int) neighbors.size(); i++) {
                 int first = neighbors[i];
                 if (particles[first].sqrtEpsilon == 0.0f)
                     continue;
+                if (useSingleDistances)
+                    computeBlockDistances(first, &blockX[0], &blockY[0], &blockZ[0], paddedBlockSize, &r2[0]);
                 for (int k = 0; k < blockSize; k++) {
                     if ((exclusions[i] & (1<<k)) == 0) {
+                        if (useSingleDistances && r2[k] > screeningCutoff2)
+                            continue;
                         int second = blockAtom[k];
                         if (particles[second].sqrtEpsilon == 0.0f)
                             continue;
                         double sigma = particles[first].sigmaOver2+particles[second].sigmaOver2;
                         double epsilon = particles[first].sqrtEpsilon*particles[second].sqrtEpsilon;
-                        energy += computeOneInteraction(first, second, sigma, epsilon, positions, forces, torques, boxVectors);
+                        energy += computeOneInteraction(first, second, sigma, epsilon, positions, forces, boxVectors);
                     }
                 }
             }
@@ -218,15 +246,43 @@ void CpuGayBerneForce::threadComputeForce(ThreadPool& threads, int threadIndex,
         int end = min(start+groupSize, numExceptions);
         for (int i = start; i < end; i++) {
             ExceptionInfo& e = exceptions[i];
-            energy += computeOneInteraction(e.particle1, e.particle2, e.sigma, e.epsilon, positions, forces, torques, boxVectors);
+            energy += computeOneInteraction(e.particle1, e.particle2, e.sigma, e.epsilon, positions, forces, boxVectors);
         }
     }
     threadEnergy[threadIndex] = energy;
 }
 
-void CpuGayBerneForce::computeEllipsoidFrames(const vector<Vec3>& positions) {
-    int numParticles = particles.size();
-    for (int particle = 0; particle < numParticles; particle++) {
+void CpuGayBerneForce::computeBlockDistances(int atom, const float* blockX, const float* blockY, const float* blockZ, int blockSize, float* r2) const {
+    fvec4 x(posq[4*atom]), y(posq[4*atom+1]), z(posq[4*atom+2]);
+    for (int k = 0; k < blockSize; k += 4) {
+        fvec4 dx = fvec4(blockX+k)-x;
+        fvec4 dy = fvec4(blockY+k)-y;
+        fvec4 dz = fvec4(blockZ+k)-z;
+        if (nonbondedMethod == GayBerneForce::CutoffPeriodic) {
+            if (triclinic) {
+                fvec4 scale3 = floor(dz*recipBoxSize[2]+0.5f);
+                dx -= scale3*(float) boxVectors[2][0];
+                dy -= scale3*(float) boxVectors[2][1];
+                dz -= scale3*(float) boxVectors[2][2];
+                fvec4 scale2 = floor(dy*recipBoxSize[1]+0.5f);
+                dx -= scale2*(float) boxVectors[1][0];
+                dy -= scale2*(float) boxVectors[1][1];
+                fvec4 scale1 = floor(dx*recipBoxSize[0]+0.5f);
+                dx -= scale1*(float) boxVectors[0][0];
+            }
+            else {
+                dx -= round(dx*recipBoxSize[0])*boxSize[0];
+                dy -= round(dy*recipBoxSize[1])*boxSize[1];
+                dz -= round(dz*recipBoxSize[2])*boxSize[2];
+            }
+        }
+        fvec4 dist2 = dx*dx + dy*dy + dz*dz;
+        dist2.store(r2+k);
+    }
+}
+
+void CpuGayBerneForce::computeEllipsoidFrames(const vector<Vec3>& positions, int start, int end) {
+    for (int particle = start; particle < end; particle++) {
         ParticleInfo& p = particles[particle];
 
         // Compute the local coordinate system of the ellipsoid;
@@ -277,46 +333,52 @@ void CpuGayBerneForce::computeEllipsoidFrames(const vector<Vec3>& positions) {
                     g[i][j] += a[k][i]*r2[k]*a[k][j];
                 }
             }
-    }
-}
 
-void CpuGayBerneForce::applyTorques(const vector<Vec3>& positions, vector<Vec3>& forces) {
-    int numParticles = particles.size();
-    int numThreads = threadTorque.size();
-    for (int particle = 0; particle < numParticles; particle++) {
-        ParticleInfo& p = particles[particle];
-        Vec3 pos = positions[particle];
+        // Record the vectors needed to convert torques to forces.
+
         if (p.xparticle != -1) {
-            // Add up the torques from the individual threads.
-            
-            Vec3 torque;
-            for (int i = 0; i < numThreads; i++)
-                torque += threadTorque[i][particle];
-            
-            // Apply a force to the x particle.
-            
-            Vec3 dx = positions[p.xparticle]-pos;
-            double dx2 = dx.dot(dx);
-            Vec3 f = torque.cross(dx)/dx2;
-            forces[p.xparticle] += f;
-            forces[particle] -= f;
+            Vec3 dx = positions[p.xparticle]-positions[particle];
+            xAxis[particle] = dx;
+            xAxisScaled[particle] = dx/dx.dot(dx);
             if (p.yparticle != -1) {
-                // Apply a force to the y particle.  This is based on the component of the torque
-                // that was not already applied to the x particle.
-                
-                Vec3 dy = positions[p.yparticle]-pos;
-                double dy2 = dy.dot(dy);
-                Vec3 torque2 = dx*(torque.dot(dx)/dx2);
-                f = torque2.cross(dy)/dy2;
-                forces[p.yparticle] += f;
-                forces[particle] -= f;
+                Vec3 dy = positions[p.yparticle]-positions[particle];
+                yAxisScaled[particle] = dy/dy.dot(dy);
             }
         }
     }
 }
 
+void CpuGayBerneForce::applyTorque(int particle, const Vec3& torque, float* forces) const {
+    // Torques are converted to forces on the x and y particles.  The conversion is linear, so each
+    // thread can apply the torques it computes without first summing them over threads.  The resulting
+    // forces are accumulated in single precision, just like the pair forces.
+
+    const ParticleInfo& p = particles[particle];
+    if (p.xparticle == -1)
+        return;
+
+    // Apply a force to the x particle.
+
+    Vec3 f = torque.cross(xAxisScaled[particle]);
+    for (int i = 0; i < 3; i++) {
+        forces[4*p.xparticle+i] += f[i];
+        forces[4*particle+i] -= f[i];
+    }
+    if (p.yparticle != -1) {
+        // Apply a force to the y particle.  This is based on the component of the torque
+        // that was not already applied to the x particle.
+
+        Vec3 torque2 = xAxis[particle]*torque.dot(xAxisScaled[particle]);
+        f = torque2.cross(yAxisScaled[particle]);
+        for (int i = 0; i < 3; i++) {
+            forces[4*p.yparticle+i] += f[i];
+            forces[4*particle+i] -= f[i];
+        }
+    }
+}
+
 double CpuGayBerneForce::computeOneInteraction(int particle1, int particle2, double sigma, double epsilon, const Vec3* positions,
-        float* forces, vector<Vec3>& torques, const Vec3* boxVectors) {
+        float* forces, const Vec3* boxVectors) {
     // Compute the displacement and check against the cutoff.
 
     double deltaR[ReferenceForce::LastDeltaRIndex];
@@ -440,7 +502,7 @@ double CpuGayBerneForce::computeOneInteraction(int particle1, int particle2, dou
         for (int i = 0; i < 3; i++)
             detadq += Vec3(a[i][0], a[i][1], a[i][2]).cross(Vec3(d[i][0], d[i][1], d[i][2]));
         Vec3 torque = (dchidq*(u*eta) + detadq*(u*chi) + dudq*(eta*chi))*switchValue;
-        torques[particle] -= torque;
+        applyTorque(particle, -torque, forces);
     }
     return switchValue*energy;
 }
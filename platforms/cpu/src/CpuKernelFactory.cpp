@@ -48,6 +48,8 @@ KernelImpl* CpuKernelFactory::createKernelImpl(std::string name, const Platform&
         return new CpuCalcPeriodicTorsionForceKernel(name, platform, data);
     if (name == CalcRBTorsionForceKernel::Name())
         return new CpuCalcRBTorsionForceKernel(name, platform, data);
+    if (name == CalcCMAPTorsionForceKernel::Name())
+        return new CpuCalcCMAPTorsionForceKernel(name, platform, data);
     if (name == CalcNonbondedForceKernel::Name())
         return new CpuCalcNonbondedForceKernel(name, platform, data);
     if (name == CalcConstantPotentialForceKernel::Name())
@@ -56,12 +58,26 @@ KernelImpl* CpuKernelFactory::createKernelImpl(std::string name, const Platform&
         return new CpuCalcCustomNonbondedForceKernel(name, platform, data);
     if (name == CalcCustomManyParticleForceKernel::Name())
         return new CpuCalcCustomManyParticleForceKernel(name, platform, data);
+    if (name == CalcCustomExternalForceKernel::Name())
+        return new CpuCalcCustomExternalForceKernel(name, platform, data);
+    if (name == CalcCustomCentroidBondForceKernel::Name())
+        return new CpuCalcCustomCentroidBondForceKernel(name, platform, data);
+    if (name == CalcCustomCompoundBondForceKernel::Name())
+        return new CpuCalcCustomCompoundBondForceKernel(name, platform, data);
+    if (name == CalcCustomHbondForceKernel::Name())
+        return new CpuCalcCustomHbondForceKernel(name, platform, data);
     if (name == CalcGBSAOBCForceKernel::Name())
         return new CpuCalcGBSAOBCForceKernel(name, platform, data);
     if (name == CalcCustomGBForceKernel::Name())
         return new CpuCalcCustomGBForceKernel(name, platform, data);
     if (name == CalcGayBerneForceKernel::Name())
         return new CpuCalcGayBerneForceKernel(name, platform, data);
+    if (name == CalcRMSDForceKernel::Name())
+        return new CpuCalcRMSDForceKernel(name, platform, data);
+    if (name == CalcRGForceKernel::Name())
+        return new CpuCalcRGForceKernel(name, platform, data);
+    if (name == CalcOrientationRestraintForceKernel::Name())
+        return new CpuCalcOrientationRestraintForceKernel(name, platform, data);
     if (name == IntegrateLangevinMiddleStepKernel::Name())
         return new CpuIntegrateLangevinMiddleStepKernel(name, platform, data);
     throw OpenMMException((std::string("Tried to create kernel with illegal kernel name '") + name + "'").c_str());
@@ -35,15 +35,21 @@
 #include "ReferenceKernelFactory.h"
 #include "ReferenceKernels.h"
 #include "ReferenceLJCoulomb14.h"
+#include "ReferencePointFunctions.h"
 #include "ReferenceProperDihedralBond.h"
 #include "ReferenceRbDihedralBond.h"
 #include "ReferenceTabulatedFunction.h"
 #include "openmm/Context.h"
 #include "openmm/OpenMMException.h"
 #include "openmm/Vec3.h"
+#include "openmm/internal/CMAPTorsionForceImpl.h"
 #include "openmm/internal/ContextImpl.h"
+#include "openmm/internal/CustomCentroidBondForceImpl.h"
+#include "openmm/internal/CustomCompoundBondForceImpl.h"
+#include "openmm/internal/CustomHbondForceImpl.h"
 #include "openmm/internal/NonbondedForceImpl.h"
 #include "openmm/internal/ConstantPotentialForceImpl.h"
+#include "openmm/internal/timer.h"
 #include "openmm/internal/vectorize.h"
 #include "lepton/CompiledExpression.h"
 #include "lepton/CustomFunction.h"
@@ -158,7 +164,7 @@ static void copyChargesToPosq(ContextImpl& context, const vector<float>& charges
 }
 
 CpuCalcForcesAndEnergyKernel::CpuCalcForcesAndEnergyKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data, ContextImpl& context) :
-        CalcForcesAndEnergyKernel(name, platform), data(data) {
+        CalcForcesAndEnergyKernel(name, platform), data(data), enabledPoolTiming(false) {
     // Create a Reference platform version of this kernel.
     
     ReferenceKernelFactory referenceFactory;
@@ -173,6 +179,19 @@ void CpuCalcForcesAndEnergyKernel::initialize(const System& system) {
 void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups) {
     referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().beginComputation(context, includeForce, includeEnergy, groups);
     
+    // If timing is enabled, record how long each thread spends working during this computation.
+    // Another computation may be timing the same thread pool, so never reset its busy times.
+    // Instead, take the difference between the start and end of this computation.  Only turn
+    // off timing at the end if this computation was the one that turned it on.
+
+    bool timingEnabled = context.getTimingEnabled();
+    if (timingEnabled) {
+        enabledPoolTiming = !data.threads.getTimingEnabled();
+        data.threads.setTimingEnabled(true);
+        data.threads.getBusyTimes(startBusyTimes);
+        computationStartTime = getCurrentTime();
+    }
+
     // Convert positions to single precision and clear the forces.
 
     int numParticles = context.getSystem().getNumParticles();
@@ -250,13 +269,14 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
             double dist2 = delta.dot(delta);
             if (dist2 > closeCutoff2) {
                 moved.push_back(i);
-                if (dist2 > farCutoff2 || moved.size() > maxNumMoved) {
+                if (dist2 > farCutoff2)
                     needRecompute = true;
+                if (moved.size() > maxNumMoved)
                     break;
-                }
             }
         }
-        if (!needRecompute && moved.size() > 0) {
+        bool fullRebuild = (moved.size() > maxNumMoved);
+        if (!needRecompute && !fullRebuild && moved.size() > 0) {
             // Some particles have moved further than half the padding distance.  Look for pairs
             // that are missing from the neighbor list.
 
@@ -277,16 +297,27 @@ void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool i
                     }
                 }
         }
-        if (needRecompute) {
-            data.neighborList->computeNeighborList(numParticles, data.posq, data.exclusions, extractBoxVectors(context), data.isPeriodic, data.paddedCutoff, data.threads);
-            lastPositions = posData;
+        if (needRecompute || fullRebuild) {
+            // If only a few particles have moved, update the existing list so only the blocks near them
+            // get rebuilt.  Other particles keep their old reference positions.
+
+            double startTime = (timingEnabled ? getCurrentTime() : 0.0);
+            if (!fullRebuild && data.neighborList->updateNeighborList(numParticles, data.posq, moved, data.exclusions, extractBoxVectors(context), data.isPeriodic, data.paddedCutoff, data.threads)) {
+                for (int i : moved)
+                    lastPositions[i] = posData[i];
+            }
+            else {
+                if (fullRebuild)
+                    data.neighborList->computeNeighborList(numParticles, data.posq, data.exclusions, extractBoxVectors(context), data.isPeriodic, data.paddedCutoff, data.threads);
+                lastPositions = posData;
+            }
+            if (timingEnabled)
+                context.recordTiming("Neighbor list", getCurrentTime()-startTime);
         }
     }
 }
 
-double CpuCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid) {
-    // Sum the forces from all the threads.
-    
+void CpuCalcForcesAndEnergyKernel::sumThreadForces(ContextImpl& context) {
     data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
         // Sum the contributions to forces that have been calculated by different threads.
         
@@ -305,9 +336,45 @@ double CpuCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, boo
         }
     });
     data.threads.waitForThreads();
+}
+
+double CpuCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid) {
+    // Sum the forces from all the threads.
+    
+    sumThreadForces(context);
+    if (context.getTimingEnabled()) {
+        double elapsed = getCurrentTime()-computationStartTime;
+        vector<double> busyTimes;
+        data.threads.getBusyTimes(busyTimes);
+        for (int i = 0; i < busyTimes.size(); i++) {
+            double busy = busyTimes[i]-startBusyTimes[i];
+            context.recordTiming("Thread "+to_string(i)+" busy", busy);
+            context.recordTiming("Thread "+to_string(i)+" idle", max(0.0, elapsed-busy));
+        }
+        if (enabledPoolTiming)
+            data.threads.setTimingEnabled(false);
+        enabledPoolTiming = false;
+    }
     return referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().finishComputation(context, includeForce, includeEnergy, groups, valid);
 }
 
+double CpuCalcForcesAndEnergyKernel::finishGroupComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int group,
+            vector<Vec3>& forces, map<string, double>& derivs) {
+    // Move the forces from the thread buffers into the context, then clear the buffers for the next group.
+
+    if (includeForce) {
+        sumThreadForces(context);
+        data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            int numParticles = context.getSystem().getNumParticles();
+            fvec4 zero(0.0f);
+            for (int j = 0; j < numParticles; j++)
+                zero.store(&data.threadForce[threadIndex][j*4]);
+        });
+        data.threads.waitForThreads();
+    }
+    return referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().finishGroupComputation(context, includeForce, includeEnergy, group, forces, derivs);
+}
+
 void CpuUpdateStateDataKernel::createCheckpoint(ContextImpl& context, ostream& stream) {
     ReferenceUpdateStateDataKernel::createCheckpoint(context, stream);
     data.random.createCheckpoint(stream);
@@ -468,6 +535,68 @@ void CpuCalcRBTorsionForceKernel::copyParametersToContext(ContextImpl& context,
     }
 }
 
+CpuCalcCMAPTorsionForceKernel::~CpuCalcCMAPTorsionForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcCMAPTorsionForceKernel::initialize(const System& system, const CMAPTorsionForce& force) {
+    int numMaps = force.getNumMaps();
+    int numTorsions = force.getNumTorsions();
+    coeff.resize(numMaps);
+    vector<double> energy;
+    for (int i = 0; i < numMaps; i++) {
+        int size;
+        force.getMapParameters(i, size, energy);
+        CMAPTorsionForceImpl::calcMapDerivatives(size, energy, coeff[i]);
+    }
+    torsionMaps.resize(numTorsions);
+    torsionIndices.resize(numTorsions, vector<int>(8));
+    for (int i = 0; i < numTorsions; i++)
+        force.getTorsionParameters(i, torsionMaps[i], torsionIndices[i][0], torsionIndices[i][1], torsionIndices[i][2],
+            torsionIndices[i][3], torsionIndices[i][4], torsionIndices[i][5], torsionIndices[i][6], torsionIndices[i][7]);
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+    ixn = new CpuCMAPTorsionForce(system.getNumParticles(), torsionIndices, data.threads);
+    ixn->setMaps(torsionMaps, coeff);
+}
+
+double CpuCalcCMAPTorsionForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    if (usePeriodic)
+        ixn->setPeriodic(extractBoxVectors(context));
+    return ixn->calculateIxn(extractPositions(context), extractForces(context));
+}
+
+void CpuCalcCMAPTorsionForceKernel::copyParametersToContext(ContextImpl& context, const CMAPTorsionForce& force) {
+    int numMaps = force.getNumMaps();
+    int numTorsions = force.getNumTorsions();
+    if (coeff.size() != numMaps)
+        throw OpenMMException("updateParametersInContext: The number of maps has changed");
+    if (torsionMaps.size() != numTorsions)
+        throw OpenMMException("updateParametersInContext: The number of CMAP torsions has changed");
+
+    // Update the maps.
+
+    vector<double> energy;
+    for (int i = 0; i < numMaps; i++) {
+        int size;
+        force.getMapParameters(i, size, energy);
+        if (coeff[i].size() != size*size)
+            throw OpenMMException("updateParametersInContext: The size of a map has changed");
+        CMAPTorsionForceImpl::calcMapDerivatives(size, energy, coeff[i]);
+    }
+
+    // Update the indices.
+
+    for (int i = 0; i < numTorsions; i++) {
+        int index[8];
+        force.getTorsionParameters(i, torsionMaps[i], index[0], index[1], index[2], index[3], index[4], index[5], index[6], index[7]);
+        for (int j = 0; j < 8; j++)
+            if (index[j] != torsionIndices[i][j])
+                throw OpenMMException("updateParametersInContext: The set of particles in a CMAP torsion has changed");
+    }
+    ixn->setMaps(torsionMaps, coeff);
+}
+
 class CpuCalcNonbondedForceKernel::PmeIO : public CalcPmeReciprocalForceKernel::IO {
 public:
     PmeIO(float* posq, float* force, int numParticles) : posq(posq), force(force), numParticles(numParticles) {
@@ -507,24 +636,24 @@ void CpuCalcNonbondedForceKernel::initialize(const System& system, const Nonbond
 
     // Identify which exceptions are 1-4 interactions.
 
-    set<int> exceptionsWithOffsets;
+    vector<bool> exceptionHasOffset(force.getNumExceptions(), false);
     for (int i = 0; i < force.getNumExceptionParameterOffsets(); i++) {
         string param;
         int exception;
         double charge, sigma, epsilon;
         force.getExceptionParameterOffset(i, param, exception, charge, sigma, epsilon);
-        exceptionsWithOffsets.insert(exception);
+        exceptionHasOffset[exception] = true;
     }
     numParticles = force.getNumParticles();
-    exclusions.resize(numParticles);
+    vector<pair<int, int> > exclusionPairs(force.getNumExceptions());
     vector<int> nb14s;
+    nb14Index.resize(force.getNumExceptions(), -1);
     for (int i = 0; i < force.getNumExceptions(); i++) {
         int particle1, particle2;
         double chargeProd, sigma, epsilon;
         force.getExceptionParameters(i, particle1, particle2, chargeProd, sigma, epsilon);
-        exclusions[particle1].insert(particle2);
-        exclusions[particle2].insert(particle1);
-        if (chargeProd != 0.0 || epsilon != 0.0 || exceptionsWithOffsets.find(i) != exceptionsWithOffsets.end()) {
+        exclusionPairs[i] = make_pair(particle1, particle2);
+        if (chargeProd != 0.0 || epsilon != 0.0 || exceptionHasOffset[i]) {
             nb14Index[i] = nb14s.size();
             nb14s.push_back(i);
         }
@@ -595,6 +724,7 @@ void CpuCalcNonbondedForceKernel::initialize(const System& system, const Nonbond
     
     nonbondedMethod = CalcNonbondedForceKernel::NonbondedMethod(force.getNonbondedMethod());
     nonbondedCutoff = force.getCutoffDistance();
+    CpuExclusionList exclusions(numParticles, exclusionPairs, data.threads);
     if (nonbondedMethod == NoCutoff) {
         data.requestNeighborList(0.0, 0.0, true, exclusions);
         useSwitchingFunction = false;
@@ -699,7 +829,7 @@ double CpuCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeFo
     }
     double nonbondedEnergy = 0;
     if (includeDirect)
-        nonbonded->calculateDirectIxn(numParticles, &posq[0], posData, particleParams, C6params, exclusions, data.threadForce, includeEnergy ? &nonbondedEnergy : NULL, data.threads);
+        nonbonded->calculateDirectIxn(numParticles, &posq[0], posData, particleParams, C6params, data.exclusions, data.threadForce, includeEnergy ? &nonbondedEnergy : NULL, data.threads);
     if (includeReciprocal) {
         if (useOptimizedPme) {
             PmeIO io(&posq[0], &data.threadForce[0][0], numParticles);
@@ -713,7 +843,7 @@ double CpuCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeFo
             }
         }
         else
-            nonbonded->calculateReciprocalIxn(numParticles, &posq[0], posData, particleParams, C6params, exclusions, forceData, includeEnergy ? &nonbondedEnergy : NULL);
+            nonbonded->calculateReciprocalIxn(numParticles, &posq[0], posData, particleParams, C6params, data.exclusions, forceData, includeEnergy ? &nonbondedEnergy : NULL, data.threads);
         if (ewald || pme || ljpme) {
             // Add the correction for the neutralizing plasma.
 
@@ -754,7 +884,7 @@ void CpuCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context,
         int particle1, particle2;
         double chargeProd, sigma, epsilon;
         force.getExceptionParameters(i, particle1, particle2, chargeProd, sigma, epsilon);
-        if (nb14Index.find(i) == nb14Index.end()) {
+        if (i >= nb14Index.size() || nb14Index[i] == -1) {
             if (chargeProd != 0.0 || epsilon != 0.0 || exceptionsWithOffsets.find(i) != exceptionsWithOffsets.end())
                 throw OpenMMException("updateParametersInContext: The set of non-excluded exceptions has changed");
         }
@@ -1483,6 +1613,7 @@ void CpuCalcCustomGBForceKernel::initialize(const System& system, const CustomGB
     // Record the exclusions.
 
     numParticles = force.getNumParticles();
+    noExclusions = CpuExclusionList(numParticles);
     exclusions.resize(numParticles);
     for (int i = 0; i < force.getNumExclusions(); i++) {
         int particle1, particle2;
@@ -1578,34 +1709,36 @@ void CpuCalcCustomGBForceKernel::createInteraction(const CustomGBForce& force) {
     // Parse the expressions for energy terms.
 
     energyTypes.clear();
-    vector<vector<Lepton::CompiledExpression> > energyDerivExpressions(force.getNumEnergyTerms());
-    vector<vector<Lepton::CompiledExpression> > energyGradientExpressions(force.getNumEnergyTerms());
-    vector<vector<Lepton::CompiledExpression> > energyParamDerivExpressions(force.getNumEnergyTerms());
     for (int i = 0; i < force.getNumEnergyTerms(); i++) {
         string expression;
         CustomGBForce::ComputationType type;
         force.getEnergyTermParameters(i, expression, type);
         Lepton::ParsedExpression ex = Lepton::Parser::parse(expression, functions).optimize();
-        energyExpressions.push_back(ex.createCompiledExpression());
         energyTypes.push_back(type);
-        if (type != CustomGBForce::SingleParticle)
-            energyDerivExpressions[i].push_back(ex.differentiate("r").createCompiledExpression());
-        for (int j = 0; j < force.getNumComputedValues(); j++) {
-            if (type == CustomGBForce::SingleParticle) {
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]).createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("x").createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("y").createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("z").createCompiledExpression());
-                validateVariables(ex.getRootNode(), particleVariables);
-            }
-            else {
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]+"1").createCompiledExpression());
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]+"2").createCompiledExpression());
-                validateVariables(ex.getRootNode(), pairVariables);
+
+        // The energy and all its derivatives are compiled together so they can share subexpressions.
+
+        vector<Lepton::ParsedExpression> expressions;
+        expressions.push_back(ex);
+        if (type == CustomGBForce::SingleParticle) {
+            for (int j = 0; j < force.getNumComputedValues(); j++)
+                expressions.push_back(ex.differentiate(valueNames[j]));
+            expressions.push_back(ex.differentiate("x"));
+            expressions.push_back(ex.differentiate("y"));
+            expressions.push_back(ex.differentiate("z"));
+            validateVariables(ex.getRootNode(), particleVariables);
+        }
+        else {
+            expressions.push_back(ex.differentiate("r"));
+            for (int j = 0; j < force.getNumComputedValues(); j++) {
+                expressions.push_back(ex.differentiate(valueNames[j]+"1"));
+                expressions.push_back(ex.differentiate(valueNames[j]+"2"));
             }
+            validateVariables(ex.getRootNode(), pairVariables);
         }
         for (int j = 0; j < force.getNumEnergyParameterDerivatives(); j++)
-            energyParamDerivExpressions[i].push_back(ex.differentiate(force.getEnergyParameterDerivativeName(j)).createCompiledExpression());
+            expressions.push_back(ex.differentiate(force.getEnergyParameterDerivativeName(j)));
+        energyExpressions.push_back(Lepton::ParsedExpression::createCompiledExpression(expressions));
     }
 
     // Delete the custom functions.
@@ -1613,7 +1746,7 @@ void CpuCalcCustomGBForceKernel::createInteraction(const CustomGBForce& force) {
     for (auto& function : functions)
         delete function.second;
     ixn = new CpuCustomGBForce(numParticles, exclusions, valueExpressions, valueDerivExpressions, valueGradientExpressions, valueParamDerivExpressions,
-        valueNames, valueTypes, energyExpressions, energyDerivExpressions, energyGradientExpressions, energyParamDerivExpressions, energyTypes,
+        valueNames, valueTypes, energyExpressions, energyTypes,
         particleParameterNames, data.threads);
 }
 
@@ -1624,7 +1757,6 @@ double CpuCalcCustomGBForceKernel::execute(ContextImpl& context, bool includeFor
     if (data.isPeriodic)
         ixn->setPeriodic(extractBoxSize(context));
     if (nonbondedMethod != NoCutoff) {
-        vector<set<int> > noExclusions(numParticles);
         neighborList->computeNeighborList(numParticles, data.posq, noExclusions, boxVectors, data.isPeriodic, nonbondedCutoff, data.threads);
         ixn->setUseCutoff(nonbondedCutoff, *neighborList);
     }
@@ -1751,6 +1883,442 @@ void CpuCalcCustomManyParticleForceKernel::copyParametersToContext(ContextImpl&
     }
 }
 
+CpuCalcCustomExternalForceKernel::~CpuCalcCustomExternalForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcCustomExternalForceKernel::initialize(const System& system, const CustomExternalForce& force) {
+    numParticles = force.getNumParticles();
+    int numParameters = force.getNumPerParticleParameters();
+
+    // Build the arrays.
+
+    particles.resize(numParticles);
+    particleParamArray.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        force.getParticleParameters(i, particles[i], particleParamArray[i]);
+
+    // Parse the expression used to calculate the force.
+
+    map<string, Lepton::CustomFunction*> functions;
+    ReferencePointDistanceFunction periodicDistance(true, &boxVectors);
+    functions["periodicdistance"] = &periodicDistance;
+    Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction(), functions).optimize();
+    vector<string> parameterNames;
+    for (int i = 0; i < numParameters; i++)
+        parameterNames.push_back(force.getPerParticleParameterName(i));
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+    set<string> variables;
+    variables.insert("x");
+    variables.insert("y");
+    variables.insert("z");
+    variables.insert(parameterNames.begin(), parameterNames.end());
+    variables.insert(globalParameterNames.begin(), globalParameterNames.end());
+    validateVariables(expression.getRootNode(), variables);
+
+    // Create the interaction.
+
+    ixn = new CpuCustomExternalForce(expression, parameterNames, particles, data.threads);
+    ixn->setParticleParameters(particleParamArray);
+}
+
+double CpuCalcCustomExternalForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    boxVectors = extractBoxVectors(context);
+    return ixn->calculateIxn(extractPositions(context), globalParameters, data.threadForce, includeForces, includeEnergy);
+}
+
+void CpuCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, int firstParticle, int lastParticle) {
+    if (numParticles != force.getNumParticles())
+        throw OpenMMException("updateParametersInContext: The number of particles has changed");
+
+    // Record the values.
+
+    int numParameters = force.getNumPerParticleParameters();
+    vector<double> params;
+    for (int i = firstParticle; i <= lastParticle; ++i) {
+        int particle;
+        force.getParticleParameters(i, particle, params);
+        if (particle != particles[i])
+            throw OpenMMException("updateParametersInContext: A particle index has changed");
+        for (int j = 0; j < numParameters; j++)
+            particleParamArray[i][j] = params[j];
+    }
+    ixn->setParticleParameters(particleParamArray);
+}
+
+CpuCalcCustomCentroidBondForceKernel::~CpuCalcCustomCentroidBondForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcCustomCentroidBondForceKernel::initialize(const System& system, const CustomCentroidBondForce& force) {
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+
+    // Build the arrays.
+
+    int numGroups = force.getNumGroups();
+    groupAtoms.resize(numGroups);
+    vector<double> ignored;
+    for (int i = 0; i < numGroups; i++)
+        force.getGroupParameters(i, groupAtoms[i], ignored);
+    CustomCentroidBondForceImpl::computeNormalizedWeights(force, system, normalizedWeights);
+    numBonds = force.getNumBonds();
+    bondGroups.resize(numBonds);
+    bondParamArray.resize(numBonds);
+    for (int i = 0; i < numBonds; ++i)
+        force.getBondParameters(i, bondGroups[i], bondParamArray[i]);
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
+        energyParamDerivNames.push_back(force.getEnergyParameterDerivativeName(i));
+
+    // Record the tabulated function update counts for future reference.
+
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        tabulatedFunctionUpdateCount[force.getTabulatedFunctionName(i)] = force.getTabulatedFunction(i).getUpdateCount();
+
+    // Create the interaction.
+
+    createInteraction(force);
+}
+
+void CpuCalcCustomCentroidBondForceKernel::createInteraction(const CustomCentroidBondForce& force) {
+    // Create custom functions for the tabulated functions.
+
+    map<string, Lepton::CustomFunction*> functions;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+
+    // Create implementations of point functions.
+
+    functions["pointdistance"] = new ReferencePointDistanceFunction(usePeriodic, &boxVectors);
+    functions["pointangle"] = new ReferencePointAngleFunction(usePeriodic, &boxVectors);
+    functions["pointdihedral"] = new ReferencePointDihedralFunction(usePeriodic, &boxVectors);
+
+    // Parse the expression and create the object used to calculate the interaction.
+
+    Lepton::ParsedExpression energyExpression = CustomCentroidBondForceImpl::prepareExpression(force, functions);
+    vector<string> bondParameterNames;
+    for (int i = 0; i < force.getNumPerBondParameters(); i++)
+        bondParameterNames.push_back(force.getPerBondParameterName(i));
+    ixn = new CpuCustomCentroidBondForce(force.getNumGroupsPerBond(), groupAtoms, normalizedWeights, bondGroups, energyExpression,
+            bondParameterNames, energyParamDerivNames, data.threads);
+    ixn->setBondParameters(bondParamArray);
+
+    // Delete the custom functions.
+
+    for (auto& function : functions)
+        delete function.second;
+}
+
+double CpuCalcCustomCentroidBondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    boxVectors = extractBoxVectors(context);
+    vector<double> energyParamDerivValues(energyParamDerivNames.size()+1, 0.0);
+    double energy = ixn->calculateIxn(extractPositions(context), globalParameters, data.threadForce, includeForces, includeEnergy, &energyParamDerivValues[0]);
+    map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
+    for (int i = 0; i < energyParamDerivNames.size(); i++)
+        energyParamDerivs[energyParamDerivNames[i]] += energyParamDerivValues[i];
+    return energy;
+}
+
+void CpuCalcCustomCentroidBondForceKernel::copyParametersToContext(ContextImpl& context, const CustomCentroidBondForce& force) {
+    if (numBonds != force.getNumBonds())
+        throw OpenMMException("updateParametersInContext: The number of bonds has changed");
+
+    // Record the values.
+
+    int numParameters = force.getNumPerBondParameters();
+    vector<int> groups;
+    vector<double> params;
+    for (int i = 0; i < numBonds; ++i) {
+        force.getBondParameters(i, groups, params);
+        for (int j = 0; j < groups.size(); j++)
+            if (groups[j] != bondGroups[i][j])
+                throw OpenMMException("updateParametersInContext: The set of groups in a bond has changed");
+        for (int j = 0; j < numParameters; j++)
+            bondParamArray[i][j] = params[j];
+    }
+
+    // See if any tabulated functions have changed.
+
+    bool changed = false;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++) {
+        string name = force.getTabulatedFunctionName(i);
+        if (force.getTabulatedFunction(i).getUpdateCount() != tabulatedFunctionUpdateCount[name]) {
+            tabulatedFunctionUpdateCount[name] = force.getTabulatedFunction(i).getUpdateCount();
+            changed = true;
+        }
+    }
+    if (changed) {
+        delete ixn;
+        ixn = NULL;
+        createInteraction(force);
+    }
+    else
+        ixn->setBondParameters(bondParamArray);
+}
+
+CpuCalcCustomCompoundBondForceKernel::~CpuCalcCustomCompoundBondForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcCustomCompoundBondForceKernel::initialize(const System& system, const CustomCompoundBondForce& force) {
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+
+    // Build the arrays.
+
+    numAtoms = system.getNumParticles();
+    numBonds = force.getNumBonds();
+    bondParticles.resize(numBonds);
+    bondParamArray.resize(numBonds);
+    for (int i = 0; i < numBonds; ++i)
+        force.getBondParameters(i, bondParticles[i], bondParamArray[i]);
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
+        energyParamDerivNames.push_back(force.getEnergyParameterDerivativeName(i));
+
+    // Record the tabulated function update counts for future reference.
+
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        tabulatedFunctionUpdateCount[force.getTabulatedFunctionName(i)] = force.getTabulatedFunction(i).getUpdateCount();
+
+    // Create the interaction.
+
+    createInteraction(force);
+}
+
+void CpuCalcCustomCompoundBondForceKernel::createInteraction(const CustomCompoundBondForce& force) {
+    // Create custom functions for the tabulated functions.
+
+    map<string, Lepton::CustomFunction*> functions;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+
+    // Create implementations of point functions.  They are only used for calls that do not
+    // directly take particle coordinates as arguments.
+
+    functions["pointdistance"] = new ReferencePointDistanceFunction(usePeriodic, &boxVectors);
+    functions["pointangle"] = new ReferencePointAngleFunction(usePeriodic, &boxVectors);
+    functions["pointdihedral"] = new ReferencePointDihedralFunction(usePeriodic, &boxVectors);
+
+    // Parse the expression and create the object used to calculate the interaction.
+
+    Lepton::ParsedExpression energyExpression = CustomCompoundBondForceImpl::prepareExpression(force, functions);
+    vector<string> bondParameterNames;
+    for (int i = 0; i < force.getNumPerBondParameters(); i++)
+        bondParameterNames.push_back(force.getPerBondParameterName(i));
+    ixn = new CpuCustomCompoundBondForce(numAtoms, force.getNumParticlesPerBond(), bondParticles, energyExpression,
+            bondParameterNames, energyParamDerivNames, data.threads);
+    ixn->setBondParameters(bondParamArray);
+
+    // Delete the custom functions.
+
+    for (auto& function : functions)
+        delete function.second;
+}
+
+double CpuCalcCustomCompoundBondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    boxVectors = extractBoxVectors(context);
+    if (usePeriodic)
+        ixn->setPeriodic(boxVectors);
+    vector<double> energyParamDerivValues(energyParamDerivNames.size()+1, 0.0);
+    double energy = ixn->calculateIxn(extractPositions(context), globalParameters, extractForces(context), includeForces, includeEnergy, &energyParamDerivValues[0]);
+    map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
+    for (int i = 0; i < energyParamDerivNames.size(); i++)
+        energyParamDerivs[energyParamDerivNames[i]] += energyParamDerivValues[i];
+    return energy;
+}
+
+void CpuCalcCustomCompoundBondForceKernel::copyParametersToContext(ContextImpl& context, const CustomCompoundBondForce& force) {
+    if (numBonds != force.getNumBonds())
+        throw OpenMMException("updateParametersInContext: The number of bonds has changed");
+
+    // Record the values.
+
+    int numParameters = force.getNumPerBondParameters();
+    vector<int> particles;
+    vector<double> params;
+    for (int i = 0; i < numBonds; ++i) {
+        force.getBondParameters(i, particles, params);
+        for (int j = 0; j < particles.size(); j++)
+            if (particles[j] != bondParticles[i][j])
+                throw OpenMMException("updateParametersInContext: The set of particles in a bond has changed");
+        for (int j = 0; j < numParameters; j++)
+            bondParamArray[i][j] = params[j];
+    }
+
+    // See if any tabulated functions have changed.
+
+    bool changed = false;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++) {
+        string name = force.getTabulatedFunctionName(i);
+        if (force.getTabulatedFunction(i).getUpdateCount() != tabulatedFunctionUpdateCount[name]) {
+            tabulatedFunctionUpdateCount[name] = force.getTabulatedFunction(i).getUpdateCount();
+            changed = true;
+        }
+    }
+    if (changed) {
+        delete ixn;
+        ixn = NULL;
+        createInteraction(force);
+    }
+    else
+        ixn->setBondParameters(bondParamArray);
+}
+
+CpuCalcCustomHbondForceKernel::~CpuCalcCustomHbondForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcCustomHbondForceKernel::initialize(const System& system, const CustomHbondForce& force) {
+    // Record the exclusions.
+
+    numDonors = force.getNumDonors();
+    numAcceptors = force.getNumAcceptors();
+    exclusions.resize(numDonors);
+    for (int i = 0; i < force.getNumExclusions(); i++) {
+        int donor, acceptor;
+        force.getExclusionParticles(i, donor, acceptor);
+        exclusions[donor].insert(acceptor);
+    }
+
+    // Build the arrays.
+
+    donorParticles.resize(numDonors);
+    donorParamArray.resize(numDonors);
+    for (int i = 0; i < numDonors; ++i) {
+        int d1, d2, d3;
+        force.getDonorParameters(i, d1, d2, d3, donorParamArray[i]);
+        donorParticles[i] = {d1, d2, d3};
+    }
+    acceptorParticles.resize(numAcceptors);
+    acceptorParamArray.resize(numAcceptors);
+    for (int i = 0; i < numAcceptors; ++i) {
+        int a1, a2, a3;
+        force.getAcceptorParameters(i, a1, a2, a3, acceptorParamArray[i]);
+        acceptorParticles[i] = {a1, a2, a3};
+    }
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+    nonbondedMethod = CalcCustomHbondForceKernel::NonbondedMethod(force.getNonbondedMethod());
+    cutoffDistance = force.getCutoffDistance();
+
+    // Record the tabulated function update counts for future reference.
+
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        tabulatedFunctionUpdateCount[force.getTabulatedFunctionName(i)] = force.getTabulatedFunction(i).getUpdateCount();
+
+    // Create the interaction.
+
+    createInteraction(force);
+}
+
+void CpuCalcCustomHbondForceKernel::createInteraction(const CustomHbondForce& force) {
+    // Create custom functions for the tabulated functions.
+
+    map<string, Lepton::CustomFunction*> functions;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++)
+        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+
+    // Parse the expression and create the object used to calculate the interaction.
+
+    map<string, vector<int> > distances;
+    map<string, vector<int> > angles;
+    map<string, vector<int> > dihedrals;
+    Lepton::ParsedExpression energyExpression = CustomHbondForceImpl::prepareExpression(force, functions, distances, angles, dihedrals);
+    vector<string> donorParameterNames;
+    vector<string> acceptorParameterNames;
+    for (int i = 0; i < force.getNumPerDonorParameters(); i++)
+        donorParameterNames.push_back(force.getPerDonorParameterName(i));
+    for (int i = 0; i < force.getNumPerAcceptorParameters(); i++)
+        acceptorParameterNames.push_back(force.getPerAcceptorParameterName(i));
+    ixn = new CpuCustomHbondForce(donorParticles, acceptorParticles, exclusions, energyExpression, donorParameterNames,
+            acceptorParameterNames, distances, angles, dihedrals, data.threads);
+    ixn->setParameters(donorParamArray, acceptorParamArray);
+    if (nonbondedMethod != NoCutoff)
+        ixn->setUseCutoff(cutoffDistance);
+
+    // Delete the custom functions.
+
+    for (auto& function : functions)
+        delete function.second;
+}
+
+double CpuCalcCustomHbondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    if (nonbondedMethod == CutoffPeriodic) {
+        Vec3* boxVectors = extractBoxVectors(context);
+        double minAllowedSize = 2*cutoffDistance;
+        if (boxVectors[0][0] < minAllowedSize || boxVectors[1][1] < minAllowedSize || boxVectors[2][2] < minAllowedSize)
+            throw OpenMMException("The periodic box size has decreased to less than twice the nonbonded cutoff.");
+        ixn->setPeriodic(boxVectors);
+    }
+    return ixn->calculateIxn(extractPositions(context), globalParameters, data.threadForce, includeForces, includeEnergy);
+}
+
+void CpuCalcCustomHbondForceKernel::copyParametersToContext(ContextImpl& context, const CustomHbondForce& force) {
+    if (numDonors != force.getNumDonors())
+        throw OpenMMException("updateParametersInContext: The number of donors has changed");
+    if (numAcceptors != force.getNumAcceptors())
+        throw OpenMMException("updateParametersInContext: The number of acceptors has changed");
+
+    // Record the values.
+
+    vector<double> parameters;
+    int numDonorParameters = force.getNumPerDonorParameters();
+    for (int i = 0; i < numDonors; ++i) {
+        int d1, d2, d3;
+        force.getDonorParameters(i, d1, d2, d3, parameters);
+        if (d1 != donorParticles[i][0] || d2 != donorParticles[i][1] || d3 != donorParticles[i][2])
+            throw OpenMMException("updateParametersInContext: The set of particles in a donor group has changed");
+        for (int j = 0; j < numDonorParameters; j++)
+            donorParamArray[i][j] = parameters[j];
+    }
+    int numAcceptorParameters = force.getNumPerAcceptorParameters();
+    for (int i = 0; i < numAcceptors; ++i) {
+        int a1, a2, a3;
+        force.getAcceptorParameters(i, a1, a2, a3, parameters);
+        if (a1 != acceptorParticles[i][0] || a2 != acceptorParticles[i][1] || a3 != acceptorParticles[i][2])
+            throw OpenMMException("updateParametersInContext: The set of particles in an acceptor group has changed");
+        for (int j = 0; j < numAcceptorParameters; j++)
+            acceptorParamArray[i][j] = parameters[j];
+    }
+
+    // See if any tabulated functions have changed.
+
+    bool changed = false;
+    for (int i = 0; i < force.getNumTabulatedFunctions(); i++) {
+        string name = force.getTabulatedFunctionName(i);
+        if (force.getTabulatedFunction(i).getUpdateCount() != tabulatedFunctionUpdateCount[name]) {
+            tabulatedFunctionUpdateCount[name] = force.getTabulatedFunction(i).getUpdateCount();
+            changed = true;
+        }
+    }
+    if (changed) {
+        delete ixn;
+        ixn = NULL;
+        createInteraction(force);
+    }
+    else
+        ixn->setParameters(donorParamArray, acceptorParamArray);
+}
+
 CpuCalcGayBerneForceKernel::~CpuCalcGayBerneForceKernel() {
     if (ixn != NULL)
         delete ixn;
@@ -1766,7 +2334,7 @@ void CpuCalcGayBerneForceKernel::initialize(const System& system, const GayBerne
 }
 
 double CpuCalcGayBerneForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
-    return ixn->calculateForce(extractPositions(context), extractForces(context), data.threadForce, extractBoxVectors(context), data);
+    return ixn->calculateForce(extractPositions(context), data.threadForce, extractBoxVectors(context), data);
 }
 
 void CpuCalcGayBerneForceKernel::copyParametersToContext(ContextImpl& context, const GayBerneForce& force) {
@@ -1775,6 +2343,72 @@ void CpuCalcGayBerneForceKernel::copyParametersToContext(ContextImpl& context, c
     ixn = new CpuGayBerneForce(force);
 }
 
+static vector<int> getRestrainedParticles(const System& system, const vector<int>& particles) {
+    if (particles.size() > 0)
+        return particles;
+    vector<int> allParticles(system.getNumParticles());
+    for (int i = 0; i < allParticles.size(); i++)
+        allParticles[i] = i;
+    return allParticles;
+}
+
+CpuCalcRMSDForceKernel::~CpuCalcRMSDForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcRMSDForceKernel::initialize(const System& system, const RMSDForce& force) {
+    numReferencePositions = force.getReferencePositions().size();
+    ixn = new CpuRMSDForce(force.getReferencePositions(), getRestrainedParticles(system, force.getParticles()), data.threads);
+}
+
+double CpuCalcRMSDForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    return ixn->calculateIxn(extractPositions(context), extractForces(context));
+}
+
+void CpuCalcRMSDForceKernel::copyParametersToContext(ContextImpl& context, const RMSDForce& force) {
+    if (numReferencePositions != force.getReferencePositions().size())
+        throw OpenMMException("updateParametersInContext: The number of reference positions has changed");
+    delete ixn;
+    ixn = NULL;
+    ixn = new CpuRMSDForce(force.getReferencePositions(), getRestrainedParticles(context.getSystem(), force.getParticles()), data.threads);
+}
+
+CpuCalcRGForceKernel::~CpuCalcRGForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcRGForceKernel::initialize(const System& system, const RGForce& force) {
+    ixn = new CpuRGForce(getRestrainedParticles(system, force.getParticles()), data.threads);
+}
+
+double CpuCalcRGForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    return ixn->calculateIxn(extractPositions(context), extractForces(context));
+}
+
+CpuCalcOrientationRestraintForceKernel::~CpuCalcOrientationRestraintForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcOrientationRestraintForceKernel::initialize(const System& system, const OrientationRestraintForce& force) {
+    numReferencePositions = force.getReferencePositions().size();
+    ixn = new CpuOrientationRestraintForce(force.getK(), force.getReferencePositions(), getRestrainedParticles(system, force.getParticles()), data.threads);
+}
+
+double CpuCalcOrientationRestraintForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    return ixn->calculateIxn(extractPositions(context), extractForces(context));
+}
+
+void CpuCalcOrientationRestraintForceKernel::copyParametersToContext(ContextImpl& context, const OrientationRestraintForce& force) {
+    if (numReferencePositions != force.getReferencePositions().size())
+        throw OpenMMException("updateParametersInContext: The number of reference positions has changed");
+    delete ixn;
+    ixn = NULL;
+    ixn = new CpuOrientationRestraintForce(force.getK(), force.getReferencePositions(), getRestrainedParticles(context.getSystem(), force.getParticles()), data.threads);
+}
+
 CpuIntegrateLangevinMiddleStepKernel::~CpuIntegrateLangevinMiddleStepKernel() {
     if (dynamics)
         delete dynamics;
@@ -101,6 +101,38 @@ public:
         VoxelIndex voxelIndex = getVoxelIndex(location);
         bins[voxelIndex.y][voxelIndex.z].push_back(make_pair(location[0], atom));
     }
+
+    /**
+     * Insert a particle into the voxel data structure, keeping its voxel sorted by x coordinate.
+     */
+    void insertSorted(int atom, const float* location) {
+        VoxelIndex voxelIndex = getVoxelIndex(location);
+        vector<pair<float, int> >& bin = bins[voxelIndex.y][voxelIndex.z];
+        pair<float, int> item = make_pair(location[0], atom);
+        bin.insert(lower_bound(bin.begin(), bin.end(), item), item);
+    }
+
+    /**
+     * Remove a particle from the voxel data structure.  The location must be identical to
+     * the one it was inserted with.
+     */
+    void remove(int atom, const float* location) {
+        VoxelIndex voxelIndex = getVoxelIndex(location);
+        vector<pair<float, int> >& bin = bins[voxelIndex.y][voxelIndex.z];
+        pair<float, int> item = make_pair(location[0], atom);
+        auto pos = lower_bound(bin.begin(), bin.end(), item);
+        if (pos != bin.end() && *pos == item)
+            bin.erase(pos);
+    }
+
+    /**
+     * Remove all particles from the voxel data structure.
+     */
+    void clear() {
+        for (int i = 0; i < ny; i++)
+            for (int j = 0; j < nz; j++)
+                bins[i][j].clear();
+    }
     
     /**
      * Sort the particles in each voxel by x coordinate.
@@ -408,10 +440,17 @@ private:
     vector<vector<vector<pair<float, int> > > > bins;
 };
 
-CpuNeighborList::CpuNeighborList(int blockSize) : blockSize(blockSize) {
+CpuNeighborList::CpuNeighborList(int blockSize) : blockSize(blockSize), tileExclusionsVersion(-1), voxels(NULL), movedVoxels(NULL), dense(false) {
 }
 
-void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const vector<set<int> >& exclusions,
+CpuNeighborList::~CpuNeighborList() {
+    if (voxels != NULL)
+        delete voxels;
+    if (movedVoxels != NULL)
+        delete movedVoxels;
+}
+
+void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const CpuExclusionList& exclusions,
             const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads) {
     dense = false;
     int numBlocks = (numAtoms+blockSize-1)/blockSize;
@@ -419,6 +458,11 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
     blockExclusions.resize(numBlocks);
     sortedAtoms.resize(numAtoms);
     sortedPositions.resize(4*numAtoms);
+    atomSortedIndex.resize(numAtoms);
+    blockBounds.resize(8*numBlocks);
+    reuseTiles = (exclusions.getVersion() == tileExclusionsVersion && tileAtoms.size() == numBlocks && tileSortedAtoms.size() == numAtoms);
+    tileAtoms.resize(numBlocks);
+    tileMasks.resize(numBlocks);
     
     // Record the parameters for the threads.
     
@@ -463,16 +507,21 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
         edgeSizeY = 0.6f*periodicBoxVectors[1][1]/floorf(periodicBoxVectors[1][1]/maxDistance);
         edgeSizeZ = 0.6f*periodicBoxVectors[2][2]/floorf(periodicBoxVectors[2][2]/maxDistance);
     }
-    Voxels voxels(blockSize, edgeSizeY, edgeSizeZ, miny, maxy, minz, maxz, periodicBoxVectors, usePeriodic);
+    if (voxels != NULL)
+        delete voxels;
+    if (movedVoxels != NULL)
+        delete movedVoxels;
+    voxels = new Voxels(blockSize, edgeSizeY, edgeSizeZ, miny, maxy, minz, maxz, periodicBoxVectors, usePeriodic);
+    movedVoxels = new Voxels(blockSize, edgeSizeY, edgeSizeZ, miny, maxy, minz, maxz, periodicBoxVectors, usePeriodic);
     for (int i = 0; i < numAtoms; i++) {
         int atomIndex = atomBins[i].second;
         sortedAtoms[i] = atomIndex;
+        atomSortedIndex[atomIndex] = i;
         fvec4 atomPos(&atomLocations[4*atomIndex]);
         atomPos.store(&sortedPositions[4*i]);
-        voxels.insert(i, &atomLocations[4*atomIndex]);
+        voxels->insert(i, &atomLocations[4*atomIndex]);
     }
-    voxels.sortItems();
-    this->voxels = &voxels;
+    voxels->sortItems();
 
     // Signal the threads to start running and wait for them to finish.
     
@@ -480,20 +529,94 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
     threads.resumeThreads();
     threads.waitForThreads();
     
-    // Add padding atoms to fill up the last block.
+    tileSortedAtoms = sortedAtoms;
+    tileExclusionsVersion = exclusions.getVersion();
+
+    // Add padding atoms to fill up the last block.  Their exclusion flags were set when the block was built.
     
     int numPadding = numBlocks*blockSize-numAtoms;
-    if (numPadding > 0) {
-        const BlockExclusionMask mask = (~0) << (blockSize - numPadding);
-        for (int i = 0; i < numPadding; i++)
-            sortedAtoms.push_back(0);
-        auto& exc = blockExclusions[blockExclusions.size()-1];
-        for (int i = 0; i < (int) exc.size(); i++)
-            exc[i] |= mask;
+    for (int i = 0; i < numPadding; i++)
+        sortedAtoms.push_back(0);
+}
+
+bool CpuNeighborList::updateNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const vector<int>& movedAtoms, const CpuExclusionList& exclusions,
+            const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads) {
+    // An incremental update is only possible if the list was built with the same parameters and exclusions.  For a
+    // nonperiodic system, the moved atoms must also still lie inside the region covered by the voxels.
+
+    bool canUpdate = (!dense && voxels != NULL && numAtoms == this->numAtoms && usePeriodic == this->usePeriodic &&
+                      maxDistance == this->maxDistance && exclusions.getVersion() == tileExclusionsVersion);
+    if (canUpdate && usePeriodic)
+        for (int i = 0; i < 3; i++)
+            if (periodicBoxVectors[i] != this->periodicBoxVectors[i])
+                canUpdate = false;
+
+    // Blocks must stay compact for the list to be efficient, so if an atom has moved too far from the region
+    // its block originally covered, the list must be rebuilt to put atoms back in order along the Hilbert
+    // curve.  In a rectangular box, the test uses the periodic image closest to the block, so atoms can be
+    // wrapped into the box.  The bounding box tests for triclinic boxes assume the atoms in each block really
+    // are close together, so there the atom's actual position must lie near the block.
+
+    bool triclinic = (periodicBoxVectors[0][1] != 0.0 || periodicBoxVectors[0][2] != 0.0 ||
+                      periodicBoxVectors[1][0] != 0.0 || periodicBoxVectors[1][2] != 0.0 ||
+                      periodicBoxVectors[2][0] != 0.0 || periodicBoxVectors[2][1] != 0.0);
+    float margin = 0.25f*maxDistance;
+    fvec4 boxSize((float) periodicBoxVectors[0][0], (float) periodicBoxVectors[1][1], (float) periodicBoxVectors[2][2], 0);
+    fvec4 invBoxSize(1.0f/boxSize[0], 1.0f/boxSize[1], 1.0f/boxSize[2], 0);
+    for (int atom : movedAtoms) {
+        fvec4 pos(&atomLocations[4*atom]);
+        if (!usePeriodic && (pos[1] < miny || pos[1] > maxy || pos[2] < minz || pos[2] > maxz)) {
+            canUpdate = false;
+            break;
+        }
+        int sortedIndex = atomSortedIndex[atom];
+        if (usePeriodic && !triclinic) {
+            fvec4 oldPos(&sortedPositions[4*sortedIndex]);
+            fvec4 delta = pos-oldPos;
+            pos = oldPos+delta-round(delta*invBoxSize)*boxSize;
+        }
+        int block = sortedIndex/blockSize;
+        for (int j = 0; j < 3; j++)
+            if (pos[j] < blockBounds[8*block+j]-margin || pos[j] > blockBounds[8*block+4+j]+margin)
+                canUpdate = false;
+        if (!canUpdate)
+            break;
+    }
+    if (!canUpdate) {
+        computeNeighborList(numAtoms, atomLocations, exclusions, periodicBoxVectors, usePeriodic, maxDistance, threads);
+        return false;
+    }
+    this->exclusions = &exclusions;
+    this->atomLocations = &atomLocations[0];
+    reuseTiles = true;
+
+    // Move each atom to its new voxel, keeping its position along the Hilbert curve, and record
+    // which blocks contain moved atoms.
+
+    int numBlocks = blockNeighbors.size();
+    blockMoved.assign(numBlocks, false);
+    for (int atom : movedAtoms) {
+        int sortedIndex = atomSortedIndex[atom];
+        float* pos = &sortedPositions[4*sortedIndex];
+        voxels->remove(sortedIndex, pos);
+        fvec4 atomPos(&atomLocations[4*atom]);
+        atomPos.store(pos);
+        voxels->insertSorted(sortedIndex, pos);
+        movedVoxels->insert(sortedIndex, pos);
+        blockMoved[sortedIndex/blockSize] = true;
     }
+    movedVoxels->sortItems();
+
+    // Rebuild only the blocks whose neighbors might have changed.
+
+    atomicCounter = 0;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadBuildBlocks(true); });
+    threads.waitForThreads();
+    movedVoxels->clear();
+    return true;
 }
 
-void CpuNeighborList::createDenseNeighborList(int numAtoms, const vector<set<int> >& exclusions) {
+void CpuNeighborList::createDenseNeighborList(int numAtoms, const CpuExclusionList& exclusions) {
     dense = true;
     this->numAtoms = numAtoms;
     int numBlocks = (numAtoms+blockSize-1)/blockSize;
@@ -512,9 +635,11 @@ void CpuNeighborList::createDenseNeighborList(int numAtoms, const vector<set<int
             exclusionMap[firstIndex+j] = (1<<(j+1))-1;
         }
         for (int j = 0; j < atomsInBlock; j++) {
-            const set<int>& atomExclusions = exclusions[firstIndex+j];
+            const int* atomExclusions = exclusions.getExclusions(firstIndex+j);
+            int numExclusions = exclusions.getNumExclusions(firstIndex+j);
             const BlockExclusionMask mask = 1<<j;
-            for (int exclusion : atomExclusions) {
+            for (int k = 0; k < numExclusions; k++) {
+                int exclusion = atomExclusions[k];
                 if (firstIndex <= exclusion) {
                     auto thisAtomFlags = exclusionMap.find(exclusion);
                     if (thisAtomFlags == exclusionMap.end())
@@ -592,10 +717,17 @@ void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadI
 
     // Compute this thread's subset of neighbors.
 
+    threadBuildBlocks(false);
+}
+
+void CpuNeighborList::threadBuildBlocks(bool incremental) {
     int numBlocks = blockNeighbors.size();
-    vector<int> blockAtoms;
+    int numPadding = numBlocks*blockSize-numAtoms;
+    vector<int> blockAtoms, movedNeighbors;
     vector<float> blockAtomX(blockSize), blockAtomY(blockSize), blockAtomZ(blockSize);
     vector<VoxelIndex> atomVoxelIndex;
+    vector<BlockExclusionMask> movedExclusions;
+    vector<pair<int, BlockExclusionMask> > exclusionFlags;
     while (true) {
         int i = atomicCounter++;
         if (i >= numBlocks)
@@ -609,7 +741,7 @@ void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadI
         atomVoxelIndex.resize(atomsInBlock);
         for (int j = 0; j < atomsInBlock; j++) {
             blockAtoms[j] = sortedAtoms[firstIndex+j];
-            atomVoxelIndex[j] = voxels->getVoxelIndex(&atomLocations[4*blockAtoms[j]]);
+            atomVoxelIndex[j] = voxels->getVoxelIndex(&sortedPositions[4*(firstIndex+j)]);
         }
         fvec4 minPos(&sortedPositions[4*firstIndex]);
         fvec4 maxPos = minPos;
@@ -628,28 +760,72 @@ void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadI
             blockAtomY[j] = 1e10;
             blockAtomZ[j] = 1e10;
         }
-        voxels->getNeighbors(blockNeighbors[i], i, (maxPos+minPos)*0.5f, (maxPos-minPos)*0.5f, sortedAtoms, blockExclusions[i], maxDistance, blockAtoms, blockAtomX, blockAtomY, blockAtomZ, sortedPositions, atomVoxelIndex);
+        if (!incremental) {
+            minPos.store(&blockBounds[8*i]);
+            maxPos.store(&blockBounds[8*i+4]);
+        }
+        fvec4 blockCenter = (maxPos+minPos)*0.5f;
+        fvec4 blockWidth = (maxPos-minPos)*0.5f;
+        if (incremental && !blockMoved[i]) {
+            // None of this block's atoms have moved.  It only needs to be rebuilt if a moved atom
+            // is now within range of it.
+
+            movedVoxels->getNeighbors(movedNeighbors, i, blockCenter, blockWidth, sortedAtoms, movedExclusions, maxDistance, blockAtoms, blockAtomX, blockAtomY, blockAtomZ, sortedPositions, atomVoxelIndex);
+            if (movedNeighbors.size() == 0)
+                continue;
+        }
+        voxels->getNeighbors(blockNeighbors[i], i, blockCenter, blockWidth, sortedAtoms, blockExclusions[i], maxDistance, blockAtoms, blockAtomX, blockAtomY, blockAtomZ, sortedPositions, atomVoxelIndex);
 
-        // Record the exclusions for this block.
+        // Record the exclusions for this block.  The exclusion tile only needs to be recomputed if the
+        // atoms in the block have changed since it was last built.
 
-        map<int, BlockExclusionMask> atomFlags;
-        for (int j = 0; j < atomsInBlock; j++) {
-            const set<int>& atomExclusions = (*exclusions)[sortedAtoms[firstIndex+j]];
-            const BlockExclusionMask mask = 1<<j;
-            for (int exclusion : atomExclusions) {
-                const auto thisAtomFlags = atomFlags.find(exclusion);
-                if (thisAtomFlags == atomFlags.end())
-                    atomFlags[exclusion] = mask;
-                else
-                    thisAtomFlags->second |= mask;
+        if (!reuseTiles || !equal(sortedAtoms.begin()+firstIndex, sortedAtoms.begin()+firstIndex+atomsInBlock, tileSortedAtoms.begin()+firstIndex))
+            computeBlockExclusionTile(i, exclusionFlags);
+        const vector<int>& excludedAtoms = tileAtoms[i];
+        const vector<BlockExclusionMask>& excludedMasks = tileMasks[i];
+        int numNeighbors = blockNeighbors[i].size();
+        if (excludedAtoms.size() > 0) {
+            for (int k = 0; k < numNeighbors; k++) {
+                int atomIndex = blockNeighbors[i][k];
+                auto pos = lower_bound(excludedAtoms.begin(), excludedAtoms.end(), atomIndex);
+                if (pos != excludedAtoms.end() && *pos == atomIndex)
+                    blockExclusions[i][k] |= excludedMasks[pos-excludedAtoms.begin()];
             }
         }
-        int numNeighbors = blockNeighbors[i].size();
-        for (int k = 0; k < numNeighbors; k++) {
-            int atomIndex = blockNeighbors[i][k];
-            auto thisAtomFlags = atomFlags.find(atomIndex);
-            if (thisAtomFlags != atomFlags.end())
-                blockExclusions[i][k] |= thisAtomFlags->second;
+
+        // Padding atoms in the last block are excluded from everything.
+
+        if (i == numBlocks-1 && numPadding > 0) {
+            const BlockExclusionMask mask = (~0) << (blockSize - numPadding);
+            for (int k = 0; k < numNeighbors; k++)
+                blockExclusions[i][k] |= mask;
+        }
+    }
+}
+
+void CpuNeighborList::computeBlockExclusionTile(int blockIndex, vector<pair<int, BlockExclusionMask> >& flags) {
+    int firstIndex = blockSize*blockIndex;
+    int atomsInBlock = min(blockSize, numAtoms-firstIndex);
+    flags.clear();
+    for (int j = 0; j < atomsInBlock; j++) {
+        int atom = sortedAtoms[firstIndex+j];
+        const int* atomExclusions = exclusions->getExclusions(atom);
+        int numExclusions = exclusions->getNumExclusions(atom);
+        const BlockExclusionMask mask = 1<<j;
+        for (int k = 0; k < numExclusions; k++)
+            flags.push_back(make_pair(atomExclusions[k], mask));
+    }
+    sort(flags.begin(), flags.end());
+    vector<int>& excludedAtoms = tileAtoms[blockIndex];
+    vector<BlockExclusionMask>& excludedMasks = tileMasks[blockIndex];
+    excludedAtoms.clear();
+    excludedMasks.clear();
+    for (auto& flag : flags) {
+        if (excludedAtoms.size() > 0 && excludedAtoms.back() == flag.first)
+            excludedMasks.back() |= flag.second;
+        else {
+            excludedAtoms.push_back(flag.first);
+            excludedMasks.push_back(flag.second);
         }
     }
 }
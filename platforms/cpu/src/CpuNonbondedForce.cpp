@@ -243,8 +243,8 @@ void CpuNonbondedForce::tabulateExpTerms() {
 }
 
 void CpuNonbondedForce::calculateReciprocalIxn(int numberOfAtoms, float* posq, const vector<Vec3>& atomCoordinates,
-                                               const vector<pair<float, float> >& atomParameters, const vector<float> &C6params, const vector<set<int> >& exclusions,
-                                               vector<Vec3>& forces, double* totalEnergy) const {
+                                               const vector<pair<float, float> >& atomParameters, const vector<float> &C6params, const CpuExclusionList& exclusions,
+                                               vector<Vec3>& forces, double* totalEnergy, ThreadPool& threads) const {
     typedef std::complex<float> d_complex;
 
     static const float epsilon     =  1.0;
@@ -257,6 +257,7 @@ void CpuNonbondedForce::calculateReciprocalIxn(int numberOfAtoms, float* posq, c
     if (pme) {
         pme_t pmedata;
         pme_init(&pmedata, alphaEwald, numberOfAtoms, meshDim, 5, 1);
+        pme_set_threads(pmedata, &threads);
         vector<double> charges(numberOfAtoms);
         for (int i = 0; i < numberOfAtoms; i++)
             charges[i] = posq[4*i+3];
@@ -269,6 +270,7 @@ void CpuNonbondedForce::calculateReciprocalIxn(int numberOfAtoms, float* posq, c
         if (ljpme) {
             // Dispersion reciprocal space terms
             pme_init(&pmedata,alphaDispersionEwald,numberOfAtoms,dispersionMeshDim,5,1);
+            pme_set_threads(pmedata, &threads);
 
             std::vector<Vec3> dpmeforces;
             for (int i = 0; i < numberOfAtoms; i++){
@@ -378,7 +380,7 @@ void CpuNonbondedForce::calculateReciprocalIxn(int numberOfAtoms, float* posq, c
 
 
 void CpuNonbondedForce::calculateDirectIxn(int numberOfAtoms, float* posq, const vector<Vec3>& atomCoordinates, const vector<pair<float, float> >& atomParameters,
-                                           const vector<float>& C6params, const vector<set<int> >& exclusions, vector<AlignedArray<float> >& threadForce, double* totalEnergy, ThreadPool& threads) {
+                                           const vector<float>& C6params, const CpuExclusionList& exclusions, vector<AlignedArray<float> >& threadForce, double* totalEnergy, ThreadPool& threads) {
     // Record the parameters for the threads.
     
     this->numberOfAtoms = numberOfAtoms;
@@ -386,7 +388,7 @@ void CpuNonbondedForce::calculateDirectIxn(int numberOfAtoms, float* posq, const
     this->atomCoordinates = &atomCoordinates[0];
     this->atomParameters = &atomParameters[0];
     this->C6params = &C6params[0];
-    this->exclusions = &exclusions[0];
+    this->exclusions = &exclusions;
     this->threadForce = &threadForce;
     includeEnergy = (totalEnergy != NULL);
     threadEnergy.resize(threads.getNumThreads());
@@ -438,9 +440,11 @@ void CpuNonbondedForce::threadComputeDirect(ThreadPool& threads, int threadIndex
             for (int i = start; i < end; i++) {
                 fvec4 posI((float) atomCoordinates[i][0], (float) atomCoordinates[i][1], (float) atomCoordinates[i][2], 0.0f);
                 float scaledChargeI = (float) (ONE_4PI_EPS0*posq[4*i+3]);
-                for (int excluded : exclusions[i]) {
-                    if (excluded > i) {
-                        int j = excluded;
+                const int* excluded = exclusions->getExclusions(i);
+                int numExcluded = exclusions->getNumExclusions(i);
+                for (int k = 0; k < numExcluded; k++) {
+                    if (excluded[k] > i) {
+                        int j = excluded[k];
                         fvec4 deltaR;
                         fvec4 posJ((float) atomCoordinates[j][0], (float) atomCoordinates[j][1], (float) atomCoordinates[j][2], 0.0f);
                         float r2;
@@ -0,0 +1,162 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuOrientationRestraintForce.h"
+#include "jama_eig.h"
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+static const int NumSums = 12;
+
+CpuOrientationRestraintForce::CpuOrientationRestraintForce(double k, const vector<Vec3>& referencePos, const vector<int>& particles, ThreadPool& threads) :
+        threads(threads), k(k), particles(particles), threadSums(NumSums*threads.getNumThreads()) {
+    // Store the centered reference positions in the same order as the particles, so they can be
+    // accessed sequentially.
+
+    int numParticles = particles.size();
+    Vec3 center;
+    for (int i : particles)
+        center += referencePos[i];
+    center /= numParticles;
+    this->referencePos.resize(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        this->referencePos[i] = referencePos[particles[i]]-center;
+        referenceSum += this->referencePos[i];
+    }
+}
+
+double CpuOrientationRestraintForce::calculateIxn(const vector<Vec3>& atomCoordinates, vector<Vec3>& forces) {
+    // Compute the centroid and the correlation matrix in a single pass.  Positions are taken relative
+    // to the first particle to avoid losing precision when the molecule is far from the origin.
+
+    int numParticles = particles.size();
+    int numThreads = threads.getNumThreads();
+    Vec3 origin = atomCoordinates[particles[0]];
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        double sums[NumSums] = {0};
+        for (int i = start; i < end; i++) {
+            Vec3 pos = atomCoordinates[particles[i]]-origin;
+            const Vec3& ref = referencePos[i];
+            sums[0] += pos[0];
+            sums[1] += pos[1];
+            sums[2] += pos[2];
+            for (int j = 0; j < 3; j++)
+                for (int m = 0; m < 3; m++)
+                    sums[3+3*j+m] += ref[j]*pos[m];
+        }
+        for (int j = 0; j < NumSums; j++)
+            threadSums[NumSums*threadIndex+j] = sums[j];
+    });
+    threads.waitForThreads();
+    double sums[NumSums] = {0};
+    for (int i = 0; i < numThreads; i++)
+        for (int j = 0; j < NumSums; j++)
+            sums[j] += threadSums[NumSums*i+j];
+    Vec3 center = Vec3(sums[0], sums[1], sums[2])/numParticles;
+    double R[3][3];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            R[i][j] = sums[3+3*i+j]-referenceSum[i]*center[j];
+
+    // Compute the F matrix and find its eigenvalues and eigenvectors.
+
+    TNT::Array2D<double> F(4, 4);
+    F[0][0] =  R[0][0] + R[1][1] + R[2][2];
+    F[1][0] =  R[1][2] - R[2][1];
+    F[2][0] =  R[2][0] - R[0][2];
+    F[3][0] =  R[0][1] - R[1][0];
+
+    F[0][1] =  R[1][2] - R[2][1];
+    F[1][1] =  R[0][0] - R[1][1] - R[2][2];
+    F[2][1] =  R[0][1] + R[1][0];
+    F[3][1] =  R[0][2] + R[2][0];
+
+    F[0][2] =  R[2][0] - R[0][2];
+    F[1][2] =  R[0][1] + R[1][0];
+    F[2][2] = -R[0][0] + R[1][1] - R[2][2];
+    F[3][2] =  R[1][2] + R[2][1];
+
+    F[0][3] =  R[0][1] - R[1][0];
+    F[1][3] =  R[0][2] + R[2][0];
+    F[2][3] =  R[1][2] + R[2][1];
+    F[3][3] = -R[0][0] - R[1][1] + R[2][2];
+    JAMA::Eigenvalue<double> eigen(F);
+    TNT::Array1D<double> values;
+    eigen.getRealEigenvalues(values);
+    TNT::Array2D<double> vectors;
+    eigen.getV(vectors);
+
+    // Construct the quaternion and use it to compute the energy.
+
+    double q[] = {vectors[0][3], vectors[1][3], vectors[2][3], vectors[3][3]};
+    double energy = 2*k*(1.0-q[0]*q[0]);
+    if (q[0]*q[0] >= 1.0)
+        return energy;
+
+    // Compute the forces, as in ReferenceOrientationRestraintForce.  The parts of the derivative of q[0]
+    // that do not depend on the particle are computed once.  The particles are all distinct, so each
+    // thread can write to its own range of them.
+
+    double theta = 2*asin(sqrt(1.0-q[0]*q[0]));
+    double dxdq = 4.0*k*sin(theta/2)*cos(theta/2)/sqrt(1.0-q[0]*q[0]);
+    if (vectors[0][3] > 0)
+        dxdq = -dxdq;
+    double coeff[4][4];
+    for (int i = 0; i < 4; i++) {
+        double c = (vectors[i][2]*vectors[0][2]) / (values[3]-values[2]) +
+                   (vectors[i][1]*vectors[0][1]) / (values[3]-values[1]) +
+                   (vectors[i][0]*vectors[0][0]) / (values[3]-values[0]);
+        for (int j = 0; j < 4; j++)
+            coeff[i][j] = dxdq*c*vectors[j][3];
+    }
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int index = start; index < end; index++) {
+            const Vec3& p = referencePos[index];
+            Vec3 ds[4][4] = {
+                {Vec3(p[0], p[1], p[2]), Vec3(0.0, -p[2], p[1]), Vec3(p[2], 0.0, -p[0]), Vec3(-p[1], p[0], 0.0)},
+                {Vec3(0.0, -p[2], p[1]), Vec3(p[0], -p[1], -p[2]), Vec3(p[1], p[0], 0.0), Vec3(p[2], 0.0, p[0])},
+                {Vec3(p[2], 0.0, -p[0]), Vec3(p[1], p[0], 0.0), Vec3(-p[0], p[1], -p[2]), Vec3(0.0, p[2], p[1])},
+                {Vec3(-p[1], p[0], 0.0), Vec3(p[2], 0.0, p[0]), Vec3(0.0, p[2], p[1]), Vec3(-p[0], -p[1], p[2])}
+            };
+            Vec3 dq;
+            for (int i = 0; i < 4; i++)
+                for (int j = 0; j < 4; j++)
+                    dq += ds[i][j]*coeff[i][j];
+            forces[particles[index]] -= dq;
+        }
+    });
+    threads.waitForThreads();
+    return energy;
+}
@@ -31,13 +31,18 @@
 #include "CpuKernelFactory.h"
 #include "CpuKernels.h"
 #include "CpuSETTLE.h"
+#include "CpuVirtualSites.h"
 #include "ReferenceConstraints.h"
 #include "openmm/OpenMMException.h"
 #include "openmm/internal/hardware.h"
 #include "openmm/internal/vectorize.h"
 #include <algorithm>
+#include <fstream>
 #include <sstream>
 #include <stdlib.h>
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <sched.h>
+#endif
 
 using namespace OpenMM;
 using namespace std;
@@ -58,6 +63,105 @@ extern "C" OPENMM_EXPORT_CPU void registerPlatforms() {
 
 map<const ContextImpl*, CpuPlatform::PlatformData*> CpuPlatform::contextData;
 
+#if defined(__linux__) && !defined(__ANDROID__)
+/**
+ * Parse a Linux CPU list such as "0-7,16-23" into the indices it contains.
+ */
+static vector<int> parseCpuList(const string& list) {
+    vector<int> cpus;
+    stringstream ss(list);
+    string range;
+    while (getline(ss, range, ',')) {
+        int first, last;
+        size_t dash = range.find('-');
+        if (dash == string::npos) {
+            if (!(stringstream(range) >> first))
+                continue;
+            last = first;
+        }
+        else if (!(stringstream(range.substr(0, dash)) >> first) || !(stringstream(range.substr(dash+1)) >> last))
+            continue;
+        for (int i = first; i <= last; i++)
+            cpus.push_back(i);
+    }
+    return cpus;
+}
+#endif
+
+/**
+ * Get the logical CPUs this process is allowed to run on, grouped by NUMA node.  If the
+ * topology cannot be determined, everything is reported as a single node.
+ */
+static vector<vector<int> > getNumaNodeCpus() {
+    vector<vector<int> > nodes;
+#if defined(__linux__) && !defined(__ANDROID__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return nodes;
+    vector<bool> assigned(CPU_SETSIZE, false);
+    for (int node = 0; ; node++) {
+        stringstream path;
+        path << "/sys/devices/system/node/node" << node << "/cpulist";
+        ifstream file(path.str().c_str());
+        if (!file.is_open())
+            break;
+        string list;
+        getline(file, list);
+        vector<int> cpus;
+        for (int cpu : parseCpuList(list))
+            if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed) && !assigned[cpu]) {
+                cpus.push_back(cpu);
+                assigned[cpu] = true;
+            }
+        if (cpus.size() > 0)
+            nodes.push_back(cpus);
+    }
+
+    // Any allowed CPUs that were not listed under a node (or all of them, if the node
+    // information is unavailable) are treated as one additional node.
+
+    vector<int> remaining;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &allowed) && !assigned[cpu])
+            remaining.push_back(cpu);
+    if (remaining.size() > 0)
+        nodes.push_back(remaining);
+#endif
+    return nodes;
+}
+
+/**
+ * Pin the worker threads of a ThreadPool according to the ThreadAffinity property.  CPUs are
+ * ordered node by node, so consecutive thread indices share a NUMA node whenever possible.
+ */
+static void setThreadAffinity(ThreadPool& threads, const string& mode) {
+    if (mode == "none")
+        return;
+    vector<vector<int> > nodes = getNumaNodeCpus();
+    vector<int> orderedCpus, cpuNode;
+    for (int i = 0; i < nodes.size(); i++)
+        for (int cpu : nodes[i]) {
+            orderedCpus.push_back(cpu);
+            cpuNode.push_back(i);
+        }
+    if (orderedCpus.size() == 0)
+        return;
+
+    // If there are fewer threads than CPUs, spread them evenly over the ordered list so every
+    // node gets a share of the threads.
+
+    int numThreads = threads.getNumThreads();
+    int numCpus = orderedCpus.size();
+    for (int i = 0; i < numThreads; i++) {
+        int index = (numThreads > numCpus ? i%numCpus : (int) (i*(long long) numCpus/numThreads));
+        if (mode == "core")
+            threads.setThreadAffinity(i, vector<int>(1, orderedCpus[index]));
+        else
+            threads.setThreadAffinity(i, nodes[cpuNode[index]]);
+    }
+}
+
 CpuPlatform::CpuPlatform() {
     deprecatedPropertyReplacements["CpuThreads"] = CpuThreads();
     CpuKernelFactory* factory = new CpuKernelFactory();
@@ -66,16 +170,25 @@ CpuPlatform::CpuPlatform() {
     registerKernelFactory(CalcHarmonicAngleForceKernel::Name(), factory);
     registerKernelFactory(CalcPeriodicTorsionForceKernel::Name(), factory);
     registerKernelFactory(CalcRBTorsionForceKernel::Name(), factory);
+    registerKernelFactory(CalcCMAPTorsionForceKernel::Name(), factory);
     registerKernelFactory(CalcNonbondedForceKernel::Name(), factory);
     registerKernelFactory(CalcConstantPotentialForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomNonbondedForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomManyParticleForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomExternalForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomCentroidBondForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomCompoundBondForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomHbondForceKernel::Name(), factory);
     registerKernelFactory(CalcGBSAOBCForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomGBForceKernel::Name(), factory);
     registerKernelFactory(CalcGayBerneForceKernel::Name(), factory);
+    registerKernelFactory(CalcRMSDForceKernel::Name(), factory);
+    registerKernelFactory(CalcRGForceKernel::Name(), factory);
+    registerKernelFactory(CalcOrientationRestraintForceKernel::Name(), factory);
     registerKernelFactory(IntegrateLangevinMiddleStepKernel::Name(), factory);
     platformProperties.push_back(CpuThreads());
     platformProperties.push_back(CpuDeterministicForces());
+    platformProperties.push_back(CpuThreadAffinity());
     int threads = getNumProcessors();
     char* threadsEnv = getenv("OPENMM_CPU_THREADS");
     if (threadsEnv != NULL)
@@ -84,6 +197,7 @@ CpuPlatform::CpuPlatform() {
     defaultThreads << threads;
     setPropertyDefaultValue(CpuThreads(), defaultThreads.str());
     setPropertyDefaultValue(CpuDeterministicForces(), "false");
+    setPropertyDefaultValue(CpuThreadAffinity(), "none");
 }
 
 const string& CpuPlatform::getPropertyValue(const Context& context, const string& property) const {
@@ -120,8 +234,14 @@ void CpuPlatform::contextCreated(ContextImpl& context, const map<string, string>
             getPropertyDefaultValue(CpuDeterministicForces()) : properties.find(CpuDeterministicForces())->second);
     transform(deterministicForcesValue.begin(), deterministicForcesValue.end(), deterministicForcesValue.begin(), ::tolower);
     bool deterministicForces = (deterministicForcesValue == "true");
+    string threadAffinityValue = (properties.find(CpuThreadAffinity()) == properties.end() ?
+            getPropertyDefaultValue(CpuThreadAffinity()) : properties.find(CpuThreadAffinity())->second);
+    transform(threadAffinityValue.begin(), threadAffinityValue.end(), threadAffinityValue.begin(), ::tolower);
+    if (threadAffinityValue != "none" && threadAffinityValue != "core" && threadAffinityValue != "node")
+        throw OpenMMException("Illegal value for ThreadAffinity: "+threadAffinityValue);
     ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
-    PlatformData* data = new PlatformData(context.getSystem().getNumParticles(), refData->threads, deterministicForces);
+    setThreadAffinity(refData->threads, threadAffinityValue);
+    PlatformData* data = new PlatformData(context.getSystem().getNumParticles(), refData->threads, deterministicForces, threadAffinityValue);
     contextData[&context] = data;
     ReferenceConstraints& constraints = *(ReferenceConstraints*) refData->constraints;
     if (constraints.settle != NULL) {
@@ -129,6 +249,9 @@ void CpuPlatform::contextCreated(ContextImpl& context, const map<string, string>
         delete constraints.settle;
         constraints.settle = parallelSettle;
     }
+    CpuVirtualSites* parallelSites = new CpuVirtualSites(context.getSystem(), data->threads);
+    delete refData->virtualSites;
+    refData->virtualSites = parallelSites;
 }
 
 void CpuPlatform::contextDestroyed(ContextImpl& context) const {
@@ -147,18 +270,33 @@ const CpuPlatform::PlatformData& CpuPlatform::getPlatformData(const ContextImpl&
     return *contextData[&context];
 }
 
-CpuPlatform::PlatformData::PlatformData(int numParticles, ThreadPool& threads, bool deterministicForces) : posq(4*numParticles), threads(threads),
-        deterministicForces(deterministicForces), numParticles(numParticles), neighborList(NULL), cutoff(0.0), paddedCutoff(0.0), anyExclusions(false),
-        currentPosqIndex(-1), nextPosqIndex(0) {
+CpuPlatform::PlatformData::PlatformData(int numParticles, ThreadPool& threads, bool deterministicForces, const string& threadAffinity) : posq(4*numParticles),
+        threads(threads), deterministicForces(deterministicForces), numParticles(numParticles), neighborList(NULL), cutoff(0.0), paddedCutoff(0.0),
+        anyExclusions(false), currentPosqIndex(-1), nextPosqIndex(0) {
     int numThreads = threads.getNumThreads();
     threadForce.resize(numThreads);
-    for (int i = 0; i < numThreads; i++)
-        threadForce[i].resize(4*numParticles);
+
+    // Each thread allocates and touches its own force buffer, along with the section of posq
+    // it will later copy positions into.  With a first-touch policy this places the memory on
+    // the NUMA node of the thread that uses it.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        AlignedArray<float>& f = threadForce[threadIndex];
+        f.resize(4*numParticles);
+        for (int i = 0; i < 4*numParticles; i++)
+            f[i] = 0.0f;
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = 4*start; i < 4*end; i++)
+            posq[i] = 0.0f;
+    });
+    threads.waitForThreads();
     isPeriodic = false;
     stringstream threadsProperty;
     threadsProperty << numThreads;
     propertyValues[CpuThreads()] = threadsProperty.str();
     propertyValues[CpuDeterministicForces()] = deterministicForces ? "true" : "false";
+    propertyValues[CpuThreadAffinity()] = threadAffinity;
 }
 
 CpuPlatform::PlatformData::~PlatformData() {
@@ -167,10 +305,14 @@ CpuPlatform::PlatformData::~PlatformData() {
 }
 
 void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const vector<set<int> >& exclusionList) {
+    requestNeighborList(cutoffDistance, padding, useExclusions, CpuExclusionList(exclusionList));
+}
+
+void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const CpuExclusionList& newExclusions) {
     if (neighborList == NULL) {
         neighborList = new CpuNeighborList(getVectorWidth());
         if (cutoffDistance == 0.0)
-            neighborList->createDenseNeighborList(numParticles, exclusionList);
+            neighborList->createDenseNeighborList(numParticles, newExclusions);
     }
     else if ((cutoffDistance == 0.0) != (cutoff == 0.0))
         throw OpenMMException("All nonbonded Forces must agree on whether to apply a cutoff");
@@ -179,15 +321,15 @@ void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, doubl
     if (cutoffDistance+padding > paddedCutoff)
         paddedCutoff = cutoffDistance+padding;
     if (useExclusions) {
-        if (anyExclusions && exclusions != exclusionList)
+        if (anyExclusions && exclusions != newExclusions)
             throw OpenMMException("All Forces must have identical exclusions");
         else {
-            exclusions = exclusionList;
+            exclusions = newExclusions;
             anyExclusions = true;
         }
     }
     else if (!anyExclusions)
-        exclusions = exclusionList;
+        exclusions = newExclusions;
 }
 
 int CpuPlatform::PlatformData::requestPosqIndex() {
@@ -0,0 +1,91 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuRGForce.h"
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuRGForce::CpuRGForce(const vector<int>& particles, ThreadPool& threads) : threads(threads), particles(particles),
+        threadSums(4*threads.getNumThreads()) {
+}
+
+double CpuRGForce::calculateIxn(const vector<Vec3>& atomCoordinates, vector<Vec3>& forces) {
+    // Compute the center position and the sum of squared distances in a single pass.  Positions are
+    // taken relative to the first particle to avoid losing precision when the molecule is far from
+    // the origin.
+
+    int numParticles = particles.size();
+    int numThreads = threads.getNumThreads();
+    Vec3 origin = atomCoordinates[particles[0]];
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        Vec3 sum;
+        double sum2 = 0;
+        for (int i = start; i < end; i++) {
+            Vec3 pos = atomCoordinates[particles[i]]-origin;
+            sum += pos;
+            sum2 += pos.dot(pos);
+        }
+        threadSums[4*threadIndex] = sum[0];
+        threadSums[4*threadIndex+1] = sum[1];
+        threadSums[4*threadIndex+2] = sum[2];
+        threadSums[4*threadIndex+3] = sum2;
+    });
+    threads.waitForThreads();
+    Vec3 center;
+    double sum2 = 0;
+    for (int i = 0; i < numThreads; i++) {
+        center += Vec3(threadSums[4*i], threadSums[4*i+1], threadSums[4*i+2]);
+        sum2 += threadSums[4*i+3];
+    }
+    center /= numParticles;
+
+    // Compute the radius of gyration.
+
+    double rg = sqrt(max(0.0, sum2/numParticles-center.dot(center)));
+
+    // Compute the forces.  The particles are all distinct, so each thread can write to its own
+    // range of them.
+
+    double scale = 1.0/(rg*numParticles);
+    Vec3 shift = origin+center;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++) {
+            int index = particles[i];
+            forces[index] -= (atomCoordinates[index]-shift)*scale;
+        }
+    });
+    threads.waitForThreads();
+    return rg;
+}
@@ -0,0 +1,237 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuRMSDForce.h"
+#include "jama_eig.h"
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+static const int NumSums = 13;
+
+CpuRMSDForce::CpuRMSDForce(const vector<Vec3>& referencePos, const vector<int>& particles, ThreadPool& threads) :
+        threads(threads), particles(particles), threadSums(NumSums*threads.getNumThreads()) {
+    // Store the centered reference positions in the same order as the particles, so they can be
+    // accessed sequentially.
+
+    int numParticles = particles.size();
+    Vec3 center;
+    for (int i : particles)
+        center += referencePos[i];
+    center /= numParticles;
+    this->referencePos.resize(numParticles);
+    referenceNorm = 0.0;
+    for (int i = 0; i < numParticles; i++) {
+        Vec3 p = referencePos[particles[i]]-center;
+        this->referencePos[i] = p;
+        referenceSum += p;
+        referenceNorm += p.dot(p);
+    }
+}
+
+double CpuRMSDForce::calculateIxn(const vector<Vec3>& atomCoordinates, vector<Vec3>& forces) {
+    // Compute the centroid, the sum of squared distances, and the correlation matrix in a single pass.
+    // Positions are taken relative to the first particle to avoid losing precision when the molecule
+    // is far from the origin.
+
+    int numParticles = particles.size();
+    int numThreads = threads.getNumThreads();
+    Vec3 origin = atomCoordinates[particles[0]];
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        double sums[NumSums] = {0};
+        for (int i = start; i < end; i++) {
+            Vec3 pos = atomCoordinates[particles[i]]-origin;
+            const Vec3& ref = referencePos[i];
+            sums[0] += pos[0];
+            sums[1] += pos[1];
+            sums[2] += pos[2];
+            sums[3] += pos.dot(pos);
+            for (int j = 0; j < 3; j++)
+                for (int k = 0; k < 3; k++)
+                    sums[4+3*j+k] += pos[j]*ref[k];
+        }
+        for (int j = 0; j < NumSums; j++)
+            threadSums[NumSums*threadIndex+j] = sums[j];
+    });
+    threads.waitForThreads();
+    double sums[NumSums] = {0};
+    for (int i = 0; i < numThreads; i++)
+        for (int j = 0; j < NumSums; j++)
+            sums[j] += threadSums[NumSums*i+j];
+    Vec3 center = Vec3(sums[0], sums[1], sums[2])/numParticles;
+    double R[3][3];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            R[i][j] = sums[4+3*i+j]-center[i]*referenceSum[j];
+
+    // Compute the F matrix and find its largest eigenvalue.
+
+    double F[4][4] = {{R[0][0]+R[1][1]+R[2][2], R[1][2]-R[2][1], R[2][0]-R[0][2], R[0][1]-R[1][0]},
+                      {R[1][2]-R[2][1], R[0][0]-R[1][1]-R[2][2], R[0][1]+R[1][0], R[0][2]+R[2][0]},
+                      {R[2][0]-R[0][2], R[0][1]+R[1][0], -R[0][0]+R[1][1]-R[2][2], R[1][2]+R[2][1]},
+                      {R[0][1]-R[1][0], R[0][2]+R[2][0], R[1][2]+R[2][1], -R[0][0]-R[1][1]+R[2][2]}};
+    double sum = sums[3]-numParticles*center.dot(center)+referenceNorm;
+    double q[4];
+    double lambda = findLargestEigenvalue(F, 0.5*sum, q);
+
+    // Compute the RMSD.
+
+    double msd = (sum-2*lambda)/numParticles;
+    if (msd < 1e-20) {
+        // The particles are perfectly aligned, so all the forces should be zero.
+        // Numerical error can lead to NaNs, so just return 0 now.
+        return 0.0;
+    }
+    double rmsd = sqrt(msd);
+
+    // Compute the rotation matrix.
+
+    double q00 = q[0]*q[0], q01 = q[0]*q[1], q02 = q[0]*q[2], q03 = q[0]*q[3];
+    double q11 = q[1]*q[1], q12 = q[1]*q[2], q13 = q[1]*q[3];
+    double q22 = q[2]*q[2], q23 = q[2]*q[3];
+    double q33 = q[3]*q[3];
+    double U[3][3] = {{q00+q11-q22-q33, 2*(q12-q03), 2*(q13+q02)},
+                      {2*(q12+q03), q00-q11+q22-q33, 2*(q23-q01)},
+                      {2*(q13-q02), 2*(q23+q01), q00-q11-q22+q33}};
+
+    // Rotate the reference positions and compute the forces.  The particles are all distinct, so
+    // each thread can write to its own range of them.
+
+    double scale = 1.0/(rmsd*numParticles);
+    Vec3 shift = origin+center;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++) {
+            const Vec3& p = referencePos[i];
+            Vec3 rotatedRef(U[0][0]*p[0] + U[1][0]*p[1] + U[2][0]*p[2],
+                            U[0][1]*p[0] + U[1][1]*p[1] + U[2][1]*p[2],
+                            U[0][2]*p[0] + U[1][2]*p[1] + U[2][2]*p[2]);
+            int index = particles[i];
+            forces[index] -= (atomCoordinates[index]-shift-rotatedRef)*scale;
+        }
+    });
+    threads.waitForThreads();
+    return rmsd;
+}
+
+static double det3(double a00, double a01, double a02, double a10, double a11, double a12, double a20, double a21, double a22) {
+    return a00*(a11*a22-a12*a21) - a01*(a10*a22-a12*a20) + a02*(a10*a21-a11*a20);
+}
+
+double CpuRMSDForce::findLargestEigenvalue(const double F[4][4], double upperBound, double q[4]) {
+    // The characteristic polynomial of a traceless 4x4 matrix is x^4 + c2*x^2 + c1*x + c0.  See
+    // Theobald, "Rapid calculation of RMSDs using a quaternion-based characteristic polynomial"
+    // (doi: 10.1107/S0108767305015266).
+
+    double trace2 = 0, trace3 = 0;
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++) {
+            trace2 += F[i][j]*F[i][j];
+            for (int k = 0; k < 4; k++)
+                trace3 += F[i][j]*F[j][k]*F[k][i];
+        }
+    double det = 0;
+    for (int j = 0; j < 4; j++) {
+        int c[3], n = 0;
+        for (int k = 0; k < 4; k++)
+            if (k != j)
+                c[n++] = k;
+        double minor = det3(F[1][c[0]], F[1][c[1]], F[1][c[2]], F[2][c[0]], F[2][c[1]], F[2][c[2]], F[3][c[0]], F[3][c[1]], F[3][c[2]]);
+        det += (j%2 == 0 ? 1 : -1)*F[0][j]*minor;
+    }
+    double c2 = -0.5*trace2;
+    double c1 = -trace3/3.0;
+    double c0 = det;
+    double lambda = upperBound;
+    for (int iteration = 0; iteration < 50; iteration++) {
+        double lambda2 = lambda*lambda;
+        double p = (lambda2+c2)*lambda2 + c1*lambda + c0;
+        double dp = 4*lambda2*lambda + 2*c2*lambda + c1;
+        if (dp == 0)
+            break;
+        double delta = p/dp;
+        lambda -= delta;
+        if (fabs(delta) < 1e-11*fabs(lambda))
+            break;
+    }
+
+    // Each row of the adjugate of F-lambda*I is proportional to the eigenvector.  Use the one with
+    // the largest norm.
+
+    double M[4][4];
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            M[i][j] = F[i][j] - (i == j ? lambda : 0.0);
+    double bestNorm = 0;
+    for (int i = 0; i < 4; i++) {
+        double row[4];
+        double norm = 0;
+        for (int j = 0; j < 4; j++) {
+            int r[3], c[3], nr = 0, nc = 0;
+            for (int k = 0; k < 4; k++) {
+                if (k != j)
+                    r[nr++] = k;
+                if (k != i)
+                    c[nc++] = k;
+            }
+            double minor = det3(M[r[0]][c[0]], M[r[0]][c[1]], M[r[0]][c[2]], M[r[1]][c[0]], M[r[1]][c[1]], M[r[1]][c[2]], M[r[2]][c[0]], M[r[2]][c[1]], M[r[2]][c[2]]);
+            row[j] = ((i+j)%2 == 0 ? minor : -minor);
+            norm += row[j]*row[j];
+        }
+        if (norm > bestNorm) {
+            bestNorm = norm;
+            double invNorm = 1.0/sqrt(norm);
+            for (int j = 0; j < 4; j++)
+                q[j] = row[j]*invNorm;
+        }
+    }
+    double scale = lambda*lambda*lambda;
+    if (lambda > 0 && bestNorm > 1e-12*scale*scale)
+        return lambda;
+
+    // The largest eigenvalue is degenerate or nearly so, so the adjugate cannot be used.  Fall back
+    // to a full eigendecomposition.
+
+    TNT::Array2D<double> matrix(4, 4);
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            matrix[i][j] = F[i][j];
+    JAMA::Eigenvalue<double> eigen(matrix);
+    TNT::Array1D<double> values;
+    eigen.getRealEigenvalues(values);
+    TNT::Array2D<double> vectors;
+    eigen.getV(vectors);
+    for (int i = 0; i < 4; i++)
+        q[i] = vectors[i][3];
+    return values[3];
+}
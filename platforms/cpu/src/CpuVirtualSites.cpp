@@ -0,0 +1,238 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026      Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuVirtualSites.h"
+#include "ReferenceForce.h"
+#include "openmm/VirtualSite.h"
+#include <algorithm>
+
+using namespace OpenMM;
+using namespace std;
+
+// Groups with fewer sites than this are processed on the calling thread.
+static const int MinSitesForThreads = 256;
+
+CpuVirtualSites::CpuVirtualSites(const System& system, ThreadPool& threads) : ReferenceVirtualSites(system), threads(threads) {
+    // Assign each site to a level one higher than the highest level of any particle it depends on.
+    // Sites come after their dependencies in getOrder(), so one pass is sufficient.
+
+    vector<int> level(system.getNumParticles(), 0);
+    vector<vector<int> > levelSites;
+    for (int i : getOrder()) {
+        const VirtualSite& site = system.getVirtualSite(i);
+        int siteLevel = 0;
+        for (int j = 0; j < site.getNumParticles(); j++)
+            siteLevel = max(siteLevel, level[site.getParticle(j)]);
+        level[i] = siteLevel+1;
+        if (levelSites.size() < level[i])
+            levelSites.resize(level[i]);
+        levelSites[siteLevel].push_back(i);
+    }
+
+    // Positions can be computed for all sites in a level at once.  Forces can be distributed for a
+    // set of sites at once only if none of them share a parent particle, so greedily divide each
+    // level into sets with no shared particles.
+
+    vector<vector<int> > particleSets(system.getNumParticles());
+    for (auto& sites : levelSites) {
+        positionGroups.push_back(createGroup(system, sites));
+        vector<vector<int> > sets;
+        for (int i : sites) {
+            const VirtualSite& site = system.getVirtualSite(i);
+            int set = 0;
+            bool conflict = true;
+            while (conflict) {
+                conflict = false;
+                for (int j = 0; j < site.getNumParticles() && !conflict; j++) {
+                    vector<int>& used = particleSets[site.getParticle(j)];
+                    conflict = (find(used.begin(), used.end(), set) != used.end());
+                }
+                if (conflict)
+                    set++;
+            }
+            for (int j = 0; j < site.getNumParticles(); j++)
+                particleSets[site.getParticle(j)].push_back(set);
+            if (sets.size() <= set)
+                sets.resize(set+1);
+            sets[set].push_back(i);
+        }
+        for (auto& set : sets)
+            forceGroups.push_back(createGroup(system, set));
+        for (int i : sites) {
+            const VirtualSite& site = system.getVirtualSite(i);
+            for (int j = 0; j < site.getNumParticles(); j++)
+                particleSets[site.getParticle(j)].clear();
+        }
+    }
+}
+
+CpuVirtualSites::SiteGroup CpuVirtualSites::createGroup(const System& system, const vector<int>& sites) {
+    SiteGroup group(4);
+    group[SiteBlock::TwoParticleAverage].particlesPerSite = 2;
+    group[SiteBlock::ThreeParticleAverage].particlesPerSite = 3;
+    group[SiteBlock::OutOfPlane].particlesPerSite = 3;
+    group[SiteBlock::Other].particlesPerSite = 0;
+    for (int i = 0; i < 4; i++)
+        group[i].type = (SiteBlock::Type) i;
+    for (int i : sites) {
+        const VirtualSite& site = system.getVirtualSite(i);
+        if (dynamic_cast<const TwoParticleAverageSite*>(&site) != NULL) {
+            const TwoParticleAverageSite& s = dynamic_cast<const TwoParticleAverageSite&>(site);
+            SiteBlock& block = group[SiteBlock::TwoParticleAverage];
+            block.sites.push_back(i);
+            for (int j = 0; j < 2; j++) {
+                block.particles.push_back(s.getParticle(j));
+                block.weights.push_back(s.getWeight(j));
+            }
+        }
+        else if (dynamic_cast<const ThreeParticleAverageSite*>(&site) != NULL) {
+            const ThreeParticleAverageSite& s = dynamic_cast<const ThreeParticleAverageSite&>(site);
+            SiteBlock& block = group[SiteBlock::ThreeParticleAverage];
+            block.sites.push_back(i);
+            for (int j = 0; j < 3; j++) {
+                block.particles.push_back(s.getParticle(j));
+                block.weights.push_back(s.getWeight(j));
+            }
+        }
+        else if (dynamic_cast<const OutOfPlaneSite*>(&site) != NULL) {
+            const OutOfPlaneSite& s = dynamic_cast<const OutOfPlaneSite&>(site);
+            SiteBlock& block = group[SiteBlock::OutOfPlane];
+            block.sites.push_back(i);
+            for (int j = 0; j < 3; j++)
+                block.particles.push_back(s.getParticle(j));
+            block.weights.push_back(s.getWeight12());
+            block.weights.push_back(s.getWeight13());
+            block.weights.push_back(s.getWeightCross());
+        }
+        else
+            group[SiteBlock::Other].sites.push_back(i);
+    }
+    return group;
+}
+
+void CpuVirtualSites::processGroup(const SiteGroup& group, const function<void(const SiteBlock&, int, int)>& function) const {
+    int numSites = 0;
+    for (const SiteBlock& block : group)
+        numSites += block.sites.size();
+    if (numSites < MinSitesForThreads) {
+        for (const SiteBlock& block : group)
+            if (block.sites.size() > 0)
+                function(block, 0, block.sites.size());
+        return;
+    }
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int numThreads = threads.getNumThreads();
+        for (const SiteBlock& block : group) {
+            int size = block.sites.size();
+            int start = threadIndex*size/numThreads;
+            int end = (threadIndex+1)*size/numThreads;
+            if (end > start)
+                function(block, start, end);
+        }
+    });
+    threads.waitForThreads();
+}
+
+void CpuVirtualSites::computePositions(const System& system, vector<Vec3>& atomCoordinates, const Vec3* boxVectors) const {
+    Vec3 recipBoxVectors[3];
+    ReferenceForce::invertBoxVectors(boxVectors, recipBoxVectors);
+    Vec3* pos = &atomCoordinates[0];
+    for (const SiteGroup& group : positionGroups) {
+        processGroup(group, [&] (const SiteBlock& block, int start, int end) {
+            const int* p = block.particles.data();
+            const double* w = block.weights.data();
+            switch (block.type) {
+                case SiteBlock::TwoParticleAverage:
+                    for (int i = start; i < end; i++)
+                        pos[block.sites[i]] = pos[p[2*i]]*w[2*i] + pos[p[2*i+1]]*w[2*i+1];
+                    break;
+                case SiteBlock::ThreeParticleAverage:
+                    for (int i = start; i < end; i++)
+                        pos[block.sites[i]] = pos[p[3*i]]*w[3*i] + pos[p[3*i+1]]*w[3*i+1] + pos[p[3*i+2]]*w[3*i+2];
+                    break;
+                case SiteBlock::OutOfPlane:
+                    for (int i = start; i < end; i++) {
+                        Vec3 v12 = pos[p[3*i+1]]-pos[p[3*i]];
+                        Vec3 v13 = pos[p[3*i+2]]-pos[p[3*i]];
+                        pos[block.sites[i]] = pos[p[3*i]] + v12*w[3*i] + v13*w[3*i+1] + v12.cross(v13)*w[3*i+2];
+                    }
+                    break;
+                default:
+                    for (int i = start; i < end; i++)
+                        computeSitePosition(system, block.sites[i], atomCoordinates, boxVectors, recipBoxVectors);
+            }
+        });
+    }
+}
+
+void CpuVirtualSites::distributeForces(const System& system, const vector<Vec3>& atomCoordinates, vector<Vec3>& forces, const Vec3* boxVectors) const {
+    Vec3 recipBoxVectors[3];
+    ReferenceForce::invertBoxVectors(boxVectors, recipBoxVectors);
+    const Vec3* pos = &atomCoordinates[0];
+    Vec3* force = &forces[0];
+    for (auto group = forceGroups.rbegin(); group != forceGroups.rend(); ++group) {
+        processGroup(*group, [&] (const SiteBlock& block, int start, int end) {
+            const int* p = block.particles.data();
+            const double* w = block.weights.data();
+            switch (block.type) {
+                case SiteBlock::TwoParticleAverage:
+                    for (int i = start; i < end; i++) {
+                        Vec3 f = force[block.sites[i]];
+                        force[p[2*i]] += f*w[2*i];
+                        force[p[2*i+1]] += f*w[2*i+1];
+                    }
+                    break;
+                case SiteBlock::ThreeParticleAverage:
+                    for (int i = start; i < end; i++) {
+                        Vec3 f = force[block.sites[i]];
+                        force[p[3*i]] += f*w[3*i];
+                        force[p[3*i+1]] += f*w[3*i+1];
+                        force[p[3*i+2]] += f*w[3*i+2];
+                    }
+                    break;
+                case SiteBlock::OutOfPlane:
+                    for (int i = start; i < end; i++) {
+                        Vec3 f = force[block.sites[i]];
+                        Vec3 v12 = pos[p[3*i+1]]-pos[p[3*i]];
+                        Vec3 v13 = pos[p[3*i+2]]-pos[p[3*i]];
+                        double w12 = w[3*i], w13 = w[3*i+1], wcross = w[3*i+2];
+                        Vec3 f2 = f*w12 + v13.cross(f)*wcross;
+                        Vec3 f3 = f*w13 - v12.cross(f)*wcross;
+                        force[p[3*i]] += f-f2-f3;
+                        force[p[3*i+1]] += f2;
+                        force[p[3*i+2]] += f3;
+                    }
+                    break;
+                default:
+                    for (int i = start; i < end; i++)
+                        distributeSiteForce(system, block.sites[i], atomCoordinates, forces, boxVectors, recipBoxVectors);
+            }
+        });
+    }
+}
@@ -31,8 +31,17 @@
   #define _USE_MATH_DEFINES // Needed to get M_PI
 #endif
 #include "CpuPlatform.h"
+#include "ReferencePlatform.h"
+#include "openmm/Context.h"
+#include "openmm/State.h"
+#include "openmm/System.h"
+#include "openmm/VerletIntegrator.h"
+#include "openmm/internal/AssertionUtilities.h"
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <string>
+#include <vector>
 
 OpenMM::CpuPlatform platform;
 
@@ -42,3 +51,50 @@ void initializeTests(int argc, char* argv[]) {
         exit(0);
     }
 }
+
+/**
+ * Compute a System with the Reference platform and with this one, and check that the positions of virtual sites,
+ * the energy, the forces, and the energy parameter derivatives agree.  This platform always uses several threads,
+ * so the parallel code paths get tested even on a machine with a single core.  If numSteps is greater than 0,
+ * both Contexts are then integrated for that many steps and the final positions are compared.
+ *
+ * @param system       the System to compute
+ * @param positions    the positions of the particles
+ * @param energyTol    the tolerance for the energy and energy parameter derivatives
+ * @param forceTol     the tolerance for forces
+ * @param parameters   values to set for global parameters before computing the System
+ * @param numSteps     the number of steps to integrate after comparing forces
+ */
+void compareToReference(const OpenMM::System& system, const std::vector<OpenMM::Vec3>& positions, double energyTol, double forceTol,
+        const std::map<std::string, double>& parameters=std::map<std::string, double>(), int numSteps=0) {
+    using namespace OpenMM;
+    VerletIntegrator integrator1(0.001);
+    VerletIntegrator integrator2(0.001);
+    ReferencePlatform reference;
+    Context context1(system, integrator1, reference);
+    Context context2(system, integrator2, platform, {{"Threads", "3"}});
+    for (Context* context : {&context1, &context2}) {
+        context->setPositions(positions);
+        for (auto& param : parameters)
+            context->setParameter(param.first, param.second);
+        context->computeVirtualSites();
+    }
+    int types = State::Positions | State::Forces | State::Energy | State::ParameterDerivatives;
+    State state1 = context1.getState(types);
+    State state2 = context2.getState(types);
+    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), energyTol);
+    for (auto& deriv : state1.getEnergyParameterDerivatives())
+        ASSERT_EQUAL_TOL(deriv.second, state2.getEnergyParameterDerivatives().at(deriv.first), energyTol);
+    for (int i = 0; i < system.getNumParticles(); i++) {
+        ASSERT_EQUAL_VEC(state1.getPositions()[i], state2.getPositions()[i], 1e-10);
+        ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], forceTol);
+    }
+    if (numSteps > 0) {
+        integrator1.step(numSteps);
+        integrator2.step(numSteps);
+        state1 = context1.getState(State::Positions);
+        state2 = context2.getState(State::Positions);
+        for (int i = 0; i < system.getNumParticles(); i++)
+            ASSERT_EQUAL_VEC(state1.getPositions()[i], state2.getPositions()[i], forceTol);
+    }
+}
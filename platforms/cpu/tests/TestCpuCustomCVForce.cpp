@@ -0,0 +1,98 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomCVForce.h"
+#include "openmm/NonbondedForce.h"
+#include "ReferencePlatform.h"
+
+void testNonbondedCVs() {
+    // Use collective variables that are computed by CPU kernels with their own force buffers,
+    // and compare to the Reference platform.
+
+    const int numParticles = 200;
+    const double boxSize = 3.0;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    CustomCVForce* cv = new CustomCVForce("0.01*v1^2+scale*v2+v3");
+    cv->addGlobalParameter("scale", 0.5);
+    cv->addEnergyParameterDerivative("scale");
+    NonbondedForce* v1 = new NonbondedForce();
+    v1->setNonbondedMethod(NonbondedForce::PME);
+    v1->setCutoffDistance(1.0);
+    CustomNonbondedForce* v2 = new CustomNonbondedForce("eps*(sigma/r)^6");
+    v2->addGlobalParameter("eps", 0.3);
+    v2->addGlobalParameter("sigma", 0.3);
+    v2->addEnergyParameterDerivative("eps");
+    v2->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    v2->setCutoffDistance(1.0);
+    CustomExternalForce* v3 = new CustomExternalForce("0.1*x^2");
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        v1->addParticle(i%2 == 0 ? 0.5 : -0.5, 0.3, 0.5);
+        v2->addParticle();
+        v3->addParticle(i);
+        positions.push_back(Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize);
+    }
+    cv->addCollectiveVariable("v1", v1);
+    cv->addCollectiveVariable("v2", v2);
+    cv->addCollectiveVariable("v3", v3);
+    system.addForce(cv);
+    VerletIntegrator integrator1(0.001);
+    ReferencePlatform reference;
+    Context context1(system, integrator1, reference);
+    context1.setPositions(positions);
+    VerletIntegrator integrator2(0.001);
+    Context context2(system, integrator2, platform);
+    context2.setPositions(positions);
+    ASSERT_EQUAL(platform.getName(), cv->getInnerContext(context2).getPlatform().getName());
+    for (int step = 0; step < 2; step++) {
+        State state1 = context1.getState(State::Energy | State::Forces | State::ParameterDerivatives);
+        State state2 = context2.getState(State::Energy | State::Forces | State::ParameterDerivatives);
+        ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+        for (int i = 0; i < numParticles; i++)
+            ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-4);
+        ASSERT_EQUAL_TOL(state1.getEnergyParameterDerivatives().at("scale"), state2.getEnergyParameterDerivatives().at("scale"), 1e-5);
+        ASSERT_EQUAL_TOL(state1.getEnergyParameterDerivatives().at("eps"), state2.getEnergyParameterDerivatives().at("eps"), 1e-5);
+        vector<double> values1, values2;
+        cv->getCollectiveVariableValues(context1, values1);
+        cv->getCollectiveVariableValues(context2, values2);
+        for (int i = 0; i < 3; i++)
+            ASSERT_EQUAL_TOL(values1[i], values2[i], 1e-5);
+        context1.setParameter("scale", 1.5);
+        context2.setParameter("scale", 1.5);
+    }
+}
+
+void runPlatformTests() {
+    testNonbondedCVs();
+}
@@ -0,0 +1,73 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomCentroidBondForce.h"
+
+void testLargeSystem() {
+    // Create many bonds whose groups overlap, so they are split between blocks and threads, and
+    // compare to the Reference platform.
+
+    const int numParticles = 600;
+    const int numGroups = 150;
+    const int numBonds = 500;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(6, 0, 0), Vec3(0, 6, 0), Vec3(0, 0, 6));
+    for (int i = 0; i < numParticles; i++)
+        system.addParticle(1.0+(i%3));
+    CustomCentroidBondForce* force = new CustomCentroidBondForce(3, "k*(distance(g1,g2)-r0)^2+scale*cos(angle(g1,g2,g3))");
+    force->addGlobalParameter("scale", 0.5);
+    force->addPerBondParameter("k");
+    force->addGlobalParameter("r0", 0.4);
+    force->addEnergyParameterDerivative("r0");
+    force->setUsesPeriodicBoundaryConditions(true);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numGroups; i++) {
+        vector<int> atoms;
+        for (int j = 0; j < 3; j++)
+            atoms.push_back((int) (genrand_real2(sfmt)*numParticles));
+        force->addGroup(atoms);
+    }
+    for (int i = 0; i < numBonds; i++) {
+        vector<int> groups;
+        for (int j = 0; j < 3; j++)
+            groups.push_back((i+j*(1+i%7))%numGroups);
+        force->addBond(groups, {1.0+genrand_real2(sfmt)});
+    }
+    system.addForce(force);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        positions[i] = Vec3(6*genrand_real2(sfmt), 6*genrand_real2(sfmt), 6*genrand_real2(sfmt));
+    compareToReference(system, positions, 1e-5, 1e-4, {{"scale", 0.8}});
+}
+
+void runPlatformTests() {
+    testLargeSystem();
+}
@@ -0,0 +1,76 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomCompoundBondForce.h"
+
+void testLargeSystem(bool periodic, bool useCoordinates) {
+    // Create a chain of particles with bonds that depend on distances, angles, dihedrals, and
+    // optionally coordinates and a point function of arbitrary arguments.  Compare to the Reference
+    // platform.  Expressions that use coordinates directly are computed in double precision, and
+    // the others with SIMD.
+
+    const int numParticles = 1500;
+    const double boxSize = 4.0;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0.5, boxSize, 0), Vec3(0, -0.7, boxSize));
+    string energy = "k*(distance(p1,p2)-r0)^2 + 0.3*cos(angle(p1,p2,p3)) + 0.2*sin(dihedral(p1,p2,p3,p4)+phase) + 0.1*angle(p2,p3,p4)*distance(p2,p1)";
+    if (useCoordinates)
+        energy += " + 0.05*x1*z4 + 0.01*pointdistance(x1,y1,z1,0,0,0)";
+    CustomCompoundBondForce* force = new CustomCompoundBondForce(4, energy);
+    force->addGlobalParameter("k", 2.0);
+    force->addPerBondParameter("r0");
+    force->addPerBondParameter("phase");
+    force->addEnergyParameterDerivative("k");
+    force->setUsesPeriodicBoundaryConditions(periodic);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        positions[i] = Vec3(boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt));
+    }
+    for (int i = 0; i < numParticles-3; i++)
+        force->addBond({i, i+1, i+2, i+3}, {0.5+genrand_real2(sfmt), genrand_real2(sfmt)});
+    for (int i = 0; i < 200; i++) {
+        int p1 = (int) (numParticles*genrand_real2(sfmt));
+        int p4 = (int) (numParticles*genrand_real2(sfmt));
+        if (p1 != p4)
+            force->addBond({p1, (p1+7)%numParticles, (p4+11)%numParticles, p4}, {1.0, 0.5});
+    }
+    system.addForce(force);
+    compareToReference(system, positions, 1e-5, 1e-4);
+}
+
+void runPlatformTests() {
+    testLargeSystem(false, true);
+    testLargeSystem(true, true);
+    testLargeSystem(false, false);
+    testLargeSystem(true, false);
+}
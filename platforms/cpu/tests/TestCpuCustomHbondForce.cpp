@@ -0,0 +1,73 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestCustomHbondForce.h"
+
+void testTriclinicWithAngles(CustomHbondForce::NonbondedMethod method) {
+    // Create a system of three atom groups in a triclinic box, with an energy that depends on
+    // distances, angles, and dihedrals.  Compare to the Reference platform.
+
+    const int numGroups = 600;
+    const double cutoff = 0.9;
+    Vec3 a(4.0, 0, 0), b(0.8, 3.8, 0), c(-0.6, 1.1, 3.6);
+    System system;
+    system.setDefaultPeriodicBoxVectors(a, b, c);
+    CustomHbondForce* force = new CustomHbondForce("k*(distance(d1,a1)-r0)^2 + angleScale*cos(angle(a1,d1,d2)) + scale*sin(dihedral(a2,a1,d1,d2))");
+    force->addGlobalParameter("k", 1.5);
+    force->addGlobalParameter("angleScale", 0.2);
+    force->addPerDonorParameter("r0");
+    force->addPerAcceptorParameter("scale");
+    force->setNonbondedMethod(method);
+    force->setCutoffDistance(cutoff);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numGroups; i++) {
+        Vec3 pos = a*genrand_real2(sfmt) + b*genrand_real2(sfmt) + c*genrand_real2(sfmt);
+        int first = system.getNumParticles();
+        for (int j = 0; j < 3; j++) {
+            system.addParticle(1.0);
+            positions.push_back(pos+Vec3(0.1*j, 0.05*genrand_real2(sfmt), 0.1*genrand_real2(sfmt)));
+        }
+        if (i%2 == 0)
+            force->addDonor(first, first+1, first+2, {0.3+0.2*genrand_real2(sfmt)});
+        else
+            force->addAcceptor(first, first+1, first+2, {genrand_real2(sfmt)});
+    }
+    for (int i = 0; i < force->getNumDonors(); i += 7)
+        force->addExclusion(i, (i*3)%force->getNumAcceptors());
+    system.addForce(force);
+    compareToReference(system, positions, 1e-5, 1e-4, {{"k", 1.2}});
+}
+
+void runPlatformTests() {
+    testTriclinicWithAngles(CustomHbondForce::CutoffNonPeriodic);
+    testTriclinicWithAngles(CustomHbondForce::CutoffPeriodic);
+}
@@ -30,5 +30,64 @@
 #include "CpuTests.h"
 #include "TestGayBerneForce.h"
 
+void testCompareToReference(bool triclinic) {
+    // Simulate a large system of ellipsoids, each of which has its orientation defined by two
+    // point particles, and compare the result to the Reference platform and between thread counts.
+
+    const int numMolecules = 400;
+    const double boxSize = 4.0;
+    System system;
+    Vec3 a(boxSize, 0, 0), b(0, boxSize, 0), c(0, 0, boxSize);
+    if (triclinic) {
+        b = Vec3(0.5, boxSize, 0);
+        c = Vec3(-0.7, 0.9, boxSize);
+    }
+    system.setDefaultPeriodicBoxVectors(a, b, c);
+    GayBerneForce* gb = new GayBerneForce();
+    gb->setNonbondedMethod(GayBerneForce::CutoffPeriodic);
+    gb->setCutoffDistance(1.2);
+    gb->setSwitchingDistance(1.0);
+    gb->setUseSwitchingFunction(true);
+    system.addForce(gb);
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numMolecules; i++) {
+        int first = system.addParticle(1.0);
+        system.addParticle(1.0);
+        system.addParticle(1.0);
+        gb->addParticle(0.3, 1.0, first+1, first+2, 0.5, 0.3, 0.2, 1.0, 0.8, 0.6);
+        gb->addParticle(0.2, 0.5, -1, -1, 0.2, 0.2, 0.2, 1.0, 1.0, 1.0);
+        gb->addParticle(0.2, 0.0, -1, -1, 0.2, 0.2, 0.2, 1.0, 1.0, 1.0);
+        gb->addException(first, first+1, 0.0, 0.0);
+        gb->addException(first, first+2, 0.0, 0.0);
+        gb->addException(first+1, first+2, 0.0, 0.0);
+        Vec3 pos(boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt));
+        Vec3 dir1(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+        Vec3 dir2(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+        positions.push_back(pos);
+        positions.push_back(pos+dir1*(0.2/sqrt(dir1.dot(dir1))));
+        positions.push_back(pos+dir2*(0.2/sqrt(dir2.dot(dir2))));
+    }
+    compareToReference(system, positions, 1e-5, 1e-4);
+
+    // Torques are converted to forces in each thread's single precision force buffer, so the
+    // result depends slightly on how the work is divided.  Make sure it stays within tolerance.
+
+    VerletIntegrator integrator1(0.001);
+    VerletIntegrator integrator2(0.001);
+    Context context1(system, integrator1, platform, {{"Threads", "1"}});
+    Context context2(system, integrator2, platform, {{"Threads", "3"}});
+    context1.setPositions(positions);
+    context2.setPositions(positions);
+    State state1 = context1.getState(State::Forces | State::Energy);
+    State state2 = context2.getState(State::Forces | State::Energy);
+    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+    for (int i = 0; i < system.getNumParticles(); i++)
+        ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-4);
+}
+
 void runPlatformTests() {
+    testCompareToReference(false);
+    testCompareToReference(true);
 }
@@ -34,6 +34,7 @@
 #include "openmm/internal/AssertionUtilities.h"
 #include "openmm/internal/ThreadPool.h"
 #include "AlignedArray.h"
+#include "CpuExclusionList.h"
 #include "CpuNeighborList.h"
 #include "CpuPlatform.h"
 #include "sfmt/SFMT.h"
@@ -46,10 +47,7 @@
 using namespace OpenMM;
 using namespace std;
 
-void testNeighborList(bool periodic, bool triclinic) {
-    const int numParticles = 500;
-    const float cutoff = 2.0f;
-    Vec3 boxVectors[3];
+void createBoxVectors(bool triclinic, Vec3* boxVectors) {
     if (triclinic) {
         boxVectors[0] = Vec3(10, 0, 0);
         boxVectors[1] = Vec3(4, 9, 0);
@@ -60,15 +58,10 @@ void testNeighborList(bool periodic, bool triclinic) {
         boxVectors[1] = Vec3(0, 9, 0);
         boxVectors[2] = Vec3(0, 0, 11);
     }
-    const float boxSize[3] = {(float) boxVectors[0][0], (float) boxVectors[1][1], (float) boxVectors[2][2]};
-    const int blockSize = 8;
-    OpenMM_SFMT::SFMT sfmt;
-    init_gen_rand(0, sfmt);
-    AlignedArray<float> positions(4*numParticles);
-    for (int i = 0; i < 4*numParticles; i++)
-        if (i%4 < 3)
-            positions[i] = boxSize[i%4]*genrand_real2(sfmt);
-    vector<set<int> > exclusions(numParticles);
+}
+
+void createExclusions(int numParticles, vector<set<int> >& exclusions) {
+    exclusions.resize(numParticles);
     for (int i = 0; i < numParticles; i++) {
         int num = min(i+1, 10);
         for (int j = 0; j < num; j++) {
@@ -76,10 +69,13 @@ void testNeighborList(bool periodic, bool triclinic) {
             exclusions[i-j].insert(i);
         }
     }
-    ThreadPool threads;
-    CpuNeighborList neighborList(blockSize);
-    neighborList.computeNeighborList(numParticles, positions, exclusions, boxVectors, periodic, cutoff, threads);
-    
+}
+
+void verifyNeighborList(const CpuNeighborList& neighborList, int numParticles, const AlignedArray<float>& positions, const vector<set<int> >& exclusions,
+        const Vec3* boxVectors, bool periodic, float cutoff) {
+    const float boxSize[3] = {(float) boxVectors[0][0], (float) boxVectors[1][1], (float) boxVectors[2][2]};
+    const int blockSize = neighborList.getBlockSize();
+
     // Convert the neighbor list to a set for faster lookup.
     
     set<pair<int, int> > neighbors;
@@ -117,15 +113,173 @@ void testNeighborList(bool periodic, bool triclinic) {
         }
 }
 
+void testNeighborList(bool periodic, bool triclinic) {
+    const int numParticles = 500;
+    const float cutoff = 2.0f;
+    Vec3 boxVectors[3];
+    createBoxVectors(triclinic, boxVectors);
+    const float boxSize[3] = {(float) boxVectors[0][0], (float) boxVectors[1][1], (float) boxVectors[2][2]};
+    const int blockSize = 8;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    AlignedArray<float> positions(4*numParticles);
+    for (int i = 0; i < 4*numParticles; i++)
+        if (i%4 < 3)
+            positions[i] = boxSize[i%4]*genrand_real2(sfmt);
+    vector<set<int> > exclusions;
+    createExclusions(numParticles, exclusions);
+    CpuExclusionList exclusionList(exclusions);
+    ThreadPool threads;
+    CpuNeighborList neighborList(blockSize);
+    neighborList.computeNeighborList(numParticles, positions, exclusionList, boxVectors, periodic, cutoff, threads);
+    verifyNeighborList(neighborList, numParticles, positions, exclusions, boxVectors, periodic, cutoff);
+
+    // Rebuild it after moving half the particles.  Blocks whose atoms have not changed reuse their exclusions.
+
+    for (int i = 0; i < numParticles; i += 2)
+        for (int j = 0; j < 3; j++)
+            positions[4*i+j] = boxSize[j]*genrand_real2(sfmt);
+    neighborList.computeNeighborList(numParticles, positions, exclusionList, boxVectors, periodic, cutoff, threads);
+    verifyNeighborList(neighborList, numParticles, positions, exclusions, boxVectors, periodic, cutoff);
+
+    // Replace the exclusions with a different list stored in the same object.  The cached exclusions must not be reused.
+
+    vector<set<int> > selfExclusions(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        selfExclusions[i].insert(i);
+    exclusionList = CpuExclusionList(selfExclusions);
+    neighborList.computeNeighborList(numParticles, positions, exclusionList, boxVectors, periodic, cutoff, threads);
+    verifyNeighborList(neighborList, numParticles, positions, selfExclusions, boxVectors, periodic, cutoff);
+}
+
+void testExclusionList() {
+    vector<set<int> > exclusions(5);
+    exclusions[0].insert(3);
+    exclusions[0].insert(1);
+    exclusions[1].insert(0);
+    exclusions[3].insert(0);
+    CpuExclusionList list(exclusions);
+    ASSERT_EQUAL(5, list.getNumAtoms());
+    ASSERT_EQUAL(2, list.getNumExclusions(0));
+    ASSERT_EQUAL(1, list.getExclusions(0)[0]);
+    ASSERT_EQUAL(3, list.getExclusions(0)[1]);
+    ASSERT_EQUAL(0, list.getNumExclusions(2));
+    ASSERT(list.isExcluded(0, 3));
+    ASSERT(list.isExcluded(3, 0));
+    ASSERT(!list.isExcluded(0, 2));
+    ASSERT(!list.isExcluded(4, 0));
+    ASSERT(list == CpuExclusionList(exclusions));
+    ASSERT(list != CpuExclusionList(5));
+    exclusions[4].insert(2);
+    ASSERT(list != CpuExclusionList(exclusions));
+    CpuExclusionList copy = list;
+    ASSERT_EQUAL(list.getVersion(), copy.getVersion());
+    ASSERT(list.getVersion() != CpuExclusionList(exclusions).getVersion());
+
+    // Building the list from pairs should give the same result, even with duplicates.
+
+    vector<pair<int, int> > pairs = {{0, 3}, {1, 0}, {3, 0}, {0, 1}};
+    ThreadPool threads(2);
+    ASSERT(CpuExclusionList(5, pairs, threads) == list);
+}
+
+void testIncrementalUpdate(bool periodic, bool triclinic) {
+    const int numParticles = 500;
+    const float cutoff = 2.0f;
+    Vec3 boxVectors[3];
+    createBoxVectors(triclinic, boxVectors);
+    const float boxSize[3] = {(float) boxVectors[0][0], (float) boxVectors[1][1], (float) boxVectors[2][2]};
+    const int blockSize = 8;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    AlignedArray<float> positions(4*numParticles);
+    for (int i = 0; i < 4*numParticles; i++)
+        if (i%4 < 3)
+            positions[i] = boxSize[i%4]*genrand_real2(sfmt);
+    float minPos[3], maxPos[3];
+    for (int j = 0; j < 3; j++) {
+        minPos[j] = maxPos[j] = positions[j];
+        for (int i = 0; i < numParticles; i++) {
+            minPos[j] = min(minPos[j], positions[4*i+j]);
+            maxPos[j] = max(maxPos[j], positions[4*i+j]);
+        }
+    }
+    vector<set<int> > exclusions;
+    createExclusions(numParticles, exclusions);
+    CpuExclusionList exclusionList(exclusions);
+    ThreadPool threads;
+    CpuNeighborList neighborList(blockSize);
+
+    // The first update has nothing to build on, so it should do a full build.
+
+    vector<int> moved;
+    ASSERT(!neighborList.updateNeighborList(numParticles, positions, moved, exclusionList, boxVectors, periodic, cutoff, threads));
+    verifyNeighborList(neighborList, numParticles, positions, exclusions, boxVectors, periodic, cutoff);
+
+    // Repeatedly move a few particles a short distance and update the list.  Particles stay inside the region
+    // covered by the original positions.
+
+    for (int iteration = 0; iteration < 5; iteration++) {
+        moved.clear();
+        for (int i = 0; i < numParticles; i++)
+            if (genrand_real2(sfmt) < 0.1) {
+                moved.push_back(i);
+                for (int j = 0; j < 3; j++) {
+                    float delta = 0.2f*(genrand_real2(sfmt)-0.5f);
+                    float pos = positions[4*i+j]+delta;
+                    if (pos < minPos[j] || pos > maxPos[j])
+                        pos = positions[4*i+j]-delta;
+                    positions[4*i+j] = pos;
+                }
+            }
+        ASSERT(neighborList.updateNeighborList(numParticles, positions, moved, exclusionList, boxVectors, periodic, cutoff, threads));
+        verifyNeighborList(neighborList, numParticles, positions, exclusions, boxVectors, periodic, cutoff);
+    }
+
+    // In a rectangular box, a particle can be wrapped across the periodic boundary.
+
+    if (periodic && !triclinic) {
+        int first = 0;
+        for (int i = 1; i < numParticles; i++)
+            if (positions[4*i] < positions[4*first])
+                first = i;
+        positions[4*first] += boxSize[0]-0.1f;
+        if (positions[4*first] >= boxSize[0])
+            positions[4*first] -= boxSize[0];
+        moved.clear();
+        moved.push_back(first);
+        ASSERT(neighborList.updateNeighborList(numParticles, positions, moved, exclusionList, boxVectors, periodic, cutoff, threads));
+        verifyNeighborList(neighborList, numParticles, positions, exclusions, boxVectors, periodic, cutoff);
+    }
+
+    // Moving a particle far from the rest of its block requires a full rebuild.
+
+    moved.clear();
+    moved.push_back(0);
+    for (int j = 0; j < 3; j++)
+        positions[j] += (positions[j] > 0.5f*boxSize[j] ? -0.4f : 0.4f)*boxSize[j];
+    ASSERT(!neighborList.updateNeighborList(numParticles, positions, moved, exclusionList, boxVectors, periodic, cutoff, threads));
+    verifyNeighborList(neighborList, numParticles, positions, exclusions, boxVectors, periodic, cutoff);
+
+    // So does changing the cutoff.
+
+    ASSERT(!neighborList.updateNeighborList(numParticles, positions, moved, exclusionList, boxVectors, periodic, 0.75f*cutoff, threads));
+    verifyNeighborList(neighborList, numParticles, positions, exclusions, boxVectors, periodic, 0.75f*cutoff);
+}
+
 int main() {
     try {
         if (!CpuPlatform::isProcessorSupported()) {
             cout << "CPU is not supported.  Exiting." << endl;
             return 0;
         }
+        testExclusionList();
         testNeighborList(false, false);
         testNeighborList(true, false);
         testNeighborList(true, true);
+        testIncrementalUpdate(false, false);
+        testIncrementalUpdate(true, false);
+        testIncrementalUpdate(true, true);
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
@@ -30,6 +30,96 @@
 #include "CpuTests.h"
 #include "TestNonbondedForce.h"
 
+void testThreadAffinity() {
+    // Pinning threads should not change the results.
+
+    const int numParticles = 1000;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(6, 0, 0), Vec3(0, 6, 0), Vec3(0, 0, 6));
+    NonbondedForce *nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::PME);
+    system.addForce(nonbonded);
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 1 : -1, 0.2, 0.5);
+        positions.push_back(Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*6);
+    }
+    VerletIntegrator integrator1(0.001);
+    Context context1(system, integrator1, platform);
+    ASSERT_EQUAL("none", platform.getPropertyValue(context1, CpuPlatform::CpuThreadAffinity()));
+    context1.setPositions(positions);
+    State state1 = context1.getState(State::Forces | State::Energy);
+    for (string affinity : {"core", "node"}) {
+        VerletIntegrator integrator2(0.001);
+        map<string, string> properties;
+        properties[CpuPlatform::CpuThreadAffinity()] = affinity;
+        Context context2(system, integrator2, platform, properties);
+        ASSERT_EQUAL(affinity, platform.getPropertyValue(context2, CpuPlatform::CpuThreadAffinity()));
+        context2.setPositions(positions);
+        State state2 = context2.getState(State::Forces | State::Energy);
+        ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+        for (int i = 0; i < numParticles; i++)
+            ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-4);
+    }
+
+    // An illegal value should throw an exception.
+
+    VerletIntegrator integrator3(0.001);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreadAffinity()] = "socket";
+    bool thrown = false;
+    try {
+        Context context3(system, integrator3, platform, properties);
+    }
+    catch (const OpenMMException& exception) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void testThreadTiming() {
+    // When timing is enabled, the busy and idle time of every thread should be recorded.
+
+    const int numParticles = 500;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(5, 0, 0), Vec3(0, 5, 0), Vec3(0, 0, 5));
+    NonbondedForce *nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    system.addForce(nonbonded);
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 1 : -1, 0.2, 0.5);
+        positions.push_back(Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*5);
+    }
+    VerletIntegrator integrator(0.001);
+    map<string, string> properties;
+    properties[CpuPlatform::CpuThreads()] = "2";
+    Context context(system, integrator, platform, properties);
+    context.setPositions(positions);
+    context.setTimingEnabled(true);
+    context.getState(State::Forces);
+    map<string, double> times;
+    map<string, int> counts;
+    context.getTimingStatistics(times, counts);
+    ASSERT_EQUAL(1, counts["Neighbor list"]);
+    ASSERT_EQUAL(1, counts["Force 0 (NonbondedForce)"]);
+    for (int i = 0; i < 2; i++) {
+        string thread = "Thread "+to_string(i);
+        ASSERT_EQUAL(1, counts[thread+" busy"]);
+        ASSERT_EQUAL(1, counts[thread+" idle"]);
+        ASSERT(times[thread+" busy"] > 0.0);
+        ASSERT(times[thread+" idle"] >= 0.0);
+    }
+}
+
 void runPlatformTests() {
     testHugeSystem();
+    testThreadAffinity();
+    testThreadTiming();
 }
@@ -0,0 +1,69 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuTests.h"
+#include "TestVirtualSites.h"
+
+void testLargeSystem() {
+    // Create many molecules that each have several types of virtual sites, some of which share
+    // parent particles or depend on other sites.  Compare to the Reference platform.
+
+    const int numMolecules = 500;
+    System system;
+    CustomExternalForce* force = new CustomExternalForce("x^2+2*y^2-0.5*z^2+x*y+z");
+    system.addForce(force);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numMolecules; i++) {
+        int first = system.getNumParticles();
+        Vec3 center(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt));
+        for (int j = 0; j < 3; j++) {
+            system.addParticle(1.0);
+            positions.push_back(center + Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.2);
+        }
+        for (int j = 0; j < 6; j++) {
+            system.addParticle(0.0);
+            positions.push_back(Vec3());
+        }
+        system.setVirtualSite(first+3, new TwoParticleAverageSite(first, first+1, 0.3, 0.7));
+        system.setVirtualSite(first+4, new ThreeParticleAverageSite(first, first+1, first+2, 0.2, 0.3, 0.5));
+        system.setVirtualSite(first+5, new OutOfPlaneSite(first, first+1, first+2, 0.3, 0.4, 0.5));
+        system.setVirtualSite(first+6, new LocalCoordinatesSite(first, first+1, first+2, Vec3(0.4, 0.3, 0.3), Vec3(-1.0, 0.5, 0.5), Vec3(0.0, -1.0, 1.0), Vec3(0.2, 0.1, -0.3)));
+        system.setVirtualSite(first+7, new TwoParticleAverageSite(first+3, first+2, 0.6, 0.4));
+        system.setVirtualSite(first+8, new OutOfPlaneSite(first+7, first+5, first, 0.2, 0.5, -0.3));
+    }
+    for (int i = 0; i < system.getNumParticles(); i++)
+        force->addParticle(i);
+    compareToReference(system, positions, 1e-5, 1e-5, std::map<std::string, double>(), 5);
+}
+
+void runPlatformTests() {
+    testLargeSystem();
+}
@@ -32,9 +32,8 @@ namespace OpenMM {
 class ReferenceCustomAngleIxn : public ReferenceBondIxn {
 
    private:
-      Lepton::CompiledExpression energyExpression;
-      Lepton::CompiledExpression forceExpression;
-      std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
+      Lepton::CompiledExpression expression;
+      int numEnergyParamDerivs;
       CompiledExpressionSet expressionSet;
       std::vector<int> angleParamIndex;
       int thetaIndex;
@@ -48,11 +47,16 @@ class ReferenceCustomAngleIxn : public ReferenceBondIxn {
 
          Constructor
 
+         @param expression            a compiled expression whose values are the energy, its derivative
+                                      with respect to the internal coordinate, and then the derivatives
+                                      of the energy with respect to each global parameter
+         @param parameterNames        the names of the per-interaction parameters
+         @param numEnergyParamDerivs  the number of parameter derivatives computed by the expression
+
          --------------------------------------------------------------------------------------- */
 
-       ReferenceCustomAngleIxn(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledExpression& forceExpression,
-                              const std::vector<std::string>& parameterNames,
-                              const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions);
+       ReferenceCustomAngleIxn(const Lepton::CompiledExpression& expression, const std::vector<std::string>& parameterNames,
+                              int numEnergyParamDerivs);
 
       /**---------------------------------------------------------------------------------------
 
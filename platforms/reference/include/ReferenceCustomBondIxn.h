@@ -33,9 +33,8 @@ namespace OpenMM {
 class ReferenceCustomBondIxn : public ReferenceBondIxn {
 
    private:
-      Lepton::CompiledExpression energyExpression;
-      Lepton::CompiledExpression forceExpression;
-      std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
+      Lepton::CompiledExpression expression;
+      int numEnergyParamDerivs;
       CompiledExpressionSet expressionSet;
       std::vector<int> bondParamIndex;
       int rIndex;
@@ -49,11 +48,16 @@ class ReferenceCustomBondIxn : public ReferenceBondIxn {
 
          Constructor
 
+         @param expression            a compiled expression whose values are the energy, its derivative
+                                      with respect to the internal coordinate, and then the derivatives
+                                      of the energy with respect to each global parameter
+         @param parameterNames        the names of the per-interaction parameters
+         @param numEnergyParamDerivs  the number of parameter derivatives computed by the expression
+
          --------------------------------------------------------------------------------------- */
 
-       ReferenceCustomBondIxn(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledExpression& forceExpression,
-                              const std::vector<std::string>& parameterNames,
-                              const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions);
+       ReferenceCustomBondIxn(const Lepton::CompiledExpression& expression, const std::vector<std::string>& parameterNames,
+                              int numEnergyParamDerivs);
 
       /**---------------------------------------------------------------------------------------
 
@@ -43,6 +43,8 @@ private:
     std::vector<Lepton::CompiledExpression> variableDerivExpressions;
     std::vector<Lepton::CompiledExpression> paramDerivExpressions;
     std::vector<double> globalValues, cvValues;
+    std::vector<std::vector<Vec3> > cvForces;
+    std::vector<std::map<std::string, double> > cvDerivs;
     std::vector<Lepton::CustomFunction*> tabulatedFunctions;
 
 public:
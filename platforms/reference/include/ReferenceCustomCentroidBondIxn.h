@@ -41,30 +41,15 @@ class ReferenceCustomCentroidBondIxn : public ReferenceBondIxn {
       std::vector<std::vector<int> > groupAtoms;
       std::vector<std::vector<double> > normalizedWeights;
       std::vector<std::vector<int> > bondGroups;
+      std::vector<std::string> bondParamNames;
       CompiledExpressionSet expressionSet;
-      Lepton::CompiledExpression energyExpression;
-      std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
-      std::vector<int> bondParamIndex;
+      Lepton::CompiledExpression expression;
+      int numEnergyParamDerivs;
       std::vector<PositionTermInfo> positionTerms;
-      int numParameters;
       bool usePeriodic;
       Vec3 boxVectors[3];
 
 
-      /**---------------------------------------------------------------------------------------
-
-         Calculate custom interaction for one bond
-
-         @param bond             the index of the bond
-         @param groupCenters     group center coordinates
-         @param forces           force array (forces added)
-         @param totalEnergy      total energy
-
-         --------------------------------------------------------------------------------------- */
-
-      void calculateOneIxn(int bond, std::vector<OpenMM::Vec3>& groupCenters,
-                           std::vector<OpenMM::Vec3>& forces, double* totalEnergy, double* energyParamDerivs);
-
       void computeDelta(int group1, int group2, double* delta, std::vector<OpenMM::Vec3>& groupCenters) const;
 
       static double computeAngle(double* vec1, double* vec2);
@@ -80,7 +65,7 @@ class ReferenceCustomCentroidBondIxn : public ReferenceBondIxn {
 
        ReferenceCustomCentroidBondIxn(int numGroupsPerBond, const std::vector<std::vector<int> >& groupAtoms,
                                const std::vector<std::vector<double> >& normalizedWeights, const std::vector<std::vector<int> >& bondGroups, const Lepton::ParsedExpression& energyExpression,
-                               const std::vector<std::string>& bondParameterNames, const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions);
+                               const std::vector<std::string>& bondParameterNames, const std::vector<std::string>& energyParamDerivNames);
 
       /**---------------------------------------------------------------------------------------
 
@@ -133,10 +118,9 @@ class ReferenceCustomCentroidBondIxn : public ReferenceBondIxn {
 class ReferenceCustomCentroidBondIxn::PositionTermInfo {
 public:
     std::string name;
-    int group, component, index;
-    Lepton::CompiledExpression forceExpression;
-    PositionTermInfo(const std::string& name, int group, int component, const Lepton::CompiledExpression& forceExpression) :
-            name(name), group(group), component(component), forceExpression(forceExpression) {
+    int group, component, valueIndex;
+    PositionTermInfo(const std::string& name, int group, int component, int valueIndex) :
+            name(name), group(group), component(component), valueIndex(valueIndex) {
     }
 };
 
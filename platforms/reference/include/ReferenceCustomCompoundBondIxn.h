@@ -40,8 +40,8 @@ class ReferenceCustomCompoundBondIxn : public ReferenceBondIxn {
       class ParticleTermInfo;
       std::vector<std::vector<int> > bondAtoms;
       CompiledExpressionSet expressionSet;
-      Lepton::CompiledExpression energyExpression;
-      std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
+      Lepton::CompiledExpression expression;
+      int numEnergyParamDerivs;
       std::vector<int> bondParamIndex;
       std::vector<ParticleTermInfo> particleTerms;
       int numParameters;
@@ -77,7 +77,7 @@ class ReferenceCustomCompoundBondIxn : public ReferenceBondIxn {
          --------------------------------------------------------------------------------------- */
 
        ReferenceCustomCompoundBondIxn(int numParticlesPerBond, const std::vector<std::vector<int> >& bondAtoms, const Lepton::ParsedExpression& energyExpression,
-                               const std::vector<std::string>& bondParameterNames, const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions);
+                               const std::vector<std::string>& bondParameterNames, const std::vector<std::string>& energyParamDerivNames);
 
       /**---------------------------------------------------------------------------------------
 
@@ -130,10 +130,9 @@ class ReferenceCustomCompoundBondIxn : public ReferenceBondIxn {
 class ReferenceCustomCompoundBondIxn::ParticleTermInfo {
 public:
     std::string name;
-    int atom, component, index;
-    Lepton::CompiledExpression forceExpression;
-    ParticleTermInfo(const std::string& name, int atom, int component, const Lepton::CompiledExpression& forceExpression) :
-            name(name), atom(atom), component(component), forceExpression(forceExpression) {
+    int atom, component, index, valueIndex;
+    ParticleTermInfo(const std::string& name, int atom, int component, int valueIndex) :
+            name(name), atom(atom), component(component), valueIndex(valueIndex) {
     }
 };
 
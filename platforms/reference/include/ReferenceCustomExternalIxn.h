@@ -34,19 +34,10 @@ namespace OpenMM {
 class ReferenceCustomExternalIxn {
 
    private:
-      Lepton::CompiledExpression energyExpression;
-      Lepton::CompiledExpression forceExpressionX;
-      Lepton::CompiledExpression forceExpressionY;
-      Lepton::CompiledExpression forceExpressionZ;
-      std::vector<double*> energyParams;
-      std::vector<double*> forceXParams;
-      std::vector<double*> forceYParams;
-      std::vector<double*> forceZParams;
-      double *energyX, *energyY, *energyZ;
-      double *forceXX, *forceXY, *forceXZ;
-      double *forceYX, *forceYY, *forceYZ;
-      double *forceZX, *forceZY, *forceZZ;
-      int numParameters;
+      Lepton::CompiledExpression expression;
+      std::vector<std::string> paramNames;
+      std::vector<double> x, y, z, energies, forceX, forceY, forceZ;
+      std::vector<std::vector<double> > paramValues;
 
    public:
 
@@ -54,11 +45,13 @@ class ReferenceCustomExternalIxn {
 
          Constructor
 
+         @param expression      a compiled expression whose values are the energy and its derivatives
+                                with respect to x, y, and z
+         @param parameterNames  the names of the per-particle parameters
+
          --------------------------------------------------------------------------------------- */
 
-       ReferenceCustomExternalIxn(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledExpression& forceExpressionX,
-                              const Lepton::CompiledExpression& forceExpressionY, const Lepton::CompiledExpression& forceExpressionZ,
-                              const std::vector<std::string>& parameterNames);
+       ReferenceCustomExternalIxn(const Lepton::CompiledExpression& expression, const std::vector<std::string>& parameterNames);
 
       /**---------------------------------------------------------------------------------------
 
@@ -78,18 +71,19 @@ class ReferenceCustomExternalIxn {
 
       /**---------------------------------------------------------------------------------------
 
-         Calculate Custom External Force
+         Calculate Custom External Force.  The expression is evaluated for all particles
+         in a single batch.
 
-         @param atomIndex        the index of the atom to apply the force to
+         @param particles        the indices of the atoms to apply the force to
          @param atomCoordinates  atom coordinates
-         @param parameters       parameter values
+         @param parameters       parameter values for each entry in particles
          @param forces           force array (forces added)
          @param energy           energy is added to this
 
          --------------------------------------------------------------------------------------- */
 
-      void calculateForce(int atomIndex, std::vector<OpenMM::Vec3>& atomCoordinates,
-                          std::vector<double>& parameters, std::vector<OpenMM::Vec3>& forces, double* energy) const;
+      void calculateForces(const std::vector<int>& particles, std::vector<OpenMM::Vec3>& atomCoordinates,
+                           const std::vector<std::vector<double> >& parameters, std::vector<OpenMM::Vec3>& forces, double* energy);
 
 
 };
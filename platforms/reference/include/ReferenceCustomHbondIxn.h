@@ -52,22 +52,38 @@ class ReferenceCustomHbondIxn : public ReferenceBondIxn {
       std::vector<AngleTermInfo> angleTerms;
       std::vector<DihedralTermInfo> dihedralTerms;
 
+      void getAtoms(int donor, int acceptor, int* atoms) const;
+
+      const std::string& getTermName(int index) const;
+
+      double getTermValue(int index) const;
+
+      const Lepton::ExpressionProgram& getForceExpression(int index) const;
+
       /**---------------------------------------------------------------------------------------
 
-         Calculate custom interaction between a donor and an acceptor
+         Compute the distances, angles, and dihedrals for a donor-acceptor pair
 
-         @param donor            the index of the donor
-         @param acceptor         the index of the acceptor
+         @param atoms            the indices of the acceptor atoms followed by the donor atoms
          @param atomCoordinates  atom coordinates
-         @param variables        the values of variables that may appear in expressions
+
+         --------------------------------------------------------------------------------------- */
+
+      void computeTerms(const int* atoms, std::vector<OpenMM::Vec3>& atomCoordinates) const;
+
+      /**---------------------------------------------------------------------------------------
+
+         Apply the forces for a donor-acceptor pair.  This must be called immediately after
+         computeTerms() for the same pair.
+
+         @param atoms            the indices of the acceptor atoms followed by the donor atoms
+         @param termDerivs       the derivative of the energy with respect to each distance, angle,
+                                 and dihedral, in that order
          @param forces           force array (forces added)
-         @param totalEnergy      total energy
 
          --------------------------------------------------------------------------------------- */
 
-      void calculateOneIxn(int donor, int acceptor, std::vector<OpenMM::Vec3>& atomCoordinates,
-                           std::map<std::string, double>& variables, std::vector<OpenMM::Vec3>& forces,
-                           double* totalEnergy) const;
+      void applyForces(const int* atoms, const double* termDerivs, std::vector<OpenMM::Vec3>& forces) const;
 
       void computeDelta(int atom1, int atom2, double* delta, std::vector<OpenMM::Vec3>& atomCoordinates) const;
 
@@ -165,6 +181,7 @@ public:
     std::string name;
     int p1, p2;
     Lepton::ExpressionProgram forceExpression;
+    mutable double value;
     mutable double delta[ReferenceForce::LastDeltaRIndex];
     DistanceTermInfo(const std::string& name, const std::vector<int>& atoms, const Lepton::ExpressionProgram& forceExpression) :
             name(name), p1(atoms[0]), p2(atoms[1]), forceExpression(forceExpression) {
@@ -176,6 +193,7 @@ public:
     std::string name;
     int p1, p2, p3;
     Lepton::ExpressionProgram forceExpression;
+    mutable double value;
     mutable double delta1[ReferenceForce::LastDeltaRIndex];
     mutable double delta2[ReferenceForce::LastDeltaRIndex];
     AngleTermInfo(const std::string& name, const std::vector<int>& atoms, const Lepton::ExpressionProgram& forceExpression) :
@@ -188,6 +206,7 @@ public:
     std::string name;
     int p1, p2, p3, p4;
     Lepton::ExpressionProgram forceExpression;
+    mutable double value;
     mutable double delta1[ReferenceForce::LastDeltaRIndex];
     mutable double delta2[ReferenceForce::LastDeltaRIndex];
     mutable double delta3[ReferenceForce::LastDeltaRIndex];
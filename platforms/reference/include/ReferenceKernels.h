@@ -110,6 +110,27 @@ public:
      * energy directly, <i>or</i> add it to an internal buffer so that it will be included here.
      */
     double finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid);
+    /**
+     * Get whether this kernel implements finishGroupComputation().
+     */
+    bool supportsGroupComputation() const {
+        return true;
+    }
+    /**
+     * This is called by ContextImpl::calcForcesAndEnergyByGroup() after calcForcesAndEnergy() has been called on
+     * every ForceImpl for one force group.  It retrieves the forces and energy parameter derivatives accumulated
+     * for the group, then resets them to zero.
+     *
+     * @param context       the context in which to execute this kernel
+     * @param includeForce  true if forces should be computed
+     * @param includeEnergy true if potential energy should be computed
+     * @param group         the index of the force group that was just computed
+     * @param forces        on exit, if includeForce is true, this contains the forces from the group
+     * @param derivs        on exit, this contains the energy parameter derivatives from the group
+     * @return the potential energy of the group that was added to internal buffers
+     */
+    double finishGroupComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int group,
+            std::vector<Vec3>& forces, std::map<std::string, double>& derivs);
 private:
     std::vector<Vec3> savedForces;
 };
@@ -361,8 +382,6 @@ private:
     ReferenceCustomBondIxn* ixn;
     std::vector<std::vector<int> >bondIndexArray;
     std::vector<std::vector<double> >bondParamArray;
-    Lepton::CompiledExpression energyExpression, forceExpression;
-    std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
     std::vector<std::string> parameterNames, globalParameterNames, energyParamDerivNames;
     bool usePeriodic;
 };
@@ -440,8 +459,6 @@ private:
     ReferenceCustomAngleIxn* ixn;
     std::vector<std::vector<int> >angleIndexArray;
     std::vector<std::vector<double> >angleParamArray;
-    Lepton::CompiledExpression energyExpression, forceExpression;
-    std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
     std::vector<std::string> parameterNames, globalParameterNames, energyParamDerivNames;
     bool usePeriodic;
 };
@@ -597,8 +614,6 @@ private:
     ReferenceCustomTorsionIxn* ixn;
     std::vector<std::vector<int> >torsionIndexArray;
     std::vector<std::vector<double> >torsionParamArray;
-    Lepton::CompiledExpression energyExpression, forceExpression;
-    std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
     std::vector<std::string> parameterNames, globalParameterNames, energyParamDerivNames;
     bool usePeriodic;
 };
@@ -927,7 +942,6 @@ private:
     ReferenceCustomExternalIxn* ixn;
     std::vector<int> particles;
     std::vector<std::vector<double> > particleParamArray;
-    Lepton::CompiledExpression energyExpression, forceExpressionX, forceExpressionY, forceExpressionZ;
     std::vector<std::string> parameterNames, globalParameterNames;
     Vec3* boxVectors;
 };
@@ -1906,6 +1920,28 @@ public:
      * @param innerContext2  the second context created by the ATMForce for computing displaced energy
      */
     void copyState(ContextImpl& context, ContextImpl& innerContext0, ContextImpl& innerContext1);
+    /**
+     * Get whether this kernel implements copySharedState() and applySharedForces().
+     */
+    bool supportsSharedForces() const {
+        return true;
+    }
+    /**
+     * Copy state information to the context that computes the Forces which do not act on any
+     * displaced particle.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param sharedContext  the context created by the ATMForce for computing the energy shared by both states
+     */
+    void copySharedState(ContextImpl& context, ContextImpl& sharedContext);
+    /**
+     * Scale the forces from the shared context and apply them to the main context.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param sharedContext  the context created by the ATMForce for computing the energy shared by both states
+     * @param scale          the derivative of the final energy with respect to the shared energy
+     */
+    void applySharedForces(ContextImpl& context, ContextImpl& sharedContext, double scale);
 private:
     int numParticles;
     std::vector<Vec3> displ1, displ0;
@@ -27,6 +27,7 @@
 
 #include "ReferencePairIxn.h"
 #include "ReferenceNeighborList.h"
+#include "openmm/internal/ThreadPool.h"
 
 namespace OpenMM {
 
@@ -46,6 +47,7 @@ class ReferenceLJCoulombIxn {
       double alphaEwald, alphaDispersionEwald;
       int numRx, numRy, numRz;
       int meshDim[3], dispersionMeshDim[3];
+      ThreadPool* threads;
 
       // parameter indices
 
@@ -167,6 +169,16 @@ class ReferenceLJCoulombIxn {
 
       void setPeriodicExceptions(bool periodic);
 
+      /**---------------------------------------------------------------------------------------
+
+         Set a thread pool to parallelize the reciprocal space PME calculation over.
+
+         @param threads  the thread pool to use
+
+         --------------------------------------------------------------------------------------- */
+
+      void setThreadPool(ThreadPool& threads);
+
       /**---------------------------------------------------------------------------------------
       
          Calculate LJ Coulomb pair ixn
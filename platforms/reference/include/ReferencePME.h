@@ -38,6 +38,8 @@
 
 namespace OpenMM {
 
+class ThreadPool;
+
 typedef double rvec[3];
 
 
@@ -66,6 +68,22 @@ pme_init(pme_t* ppme,
          int pme_order,
          double epsilon_r);
 
+/*
+ * Set a thread pool to parallelize the calculation over.  Charge spreading, the
+ * convolution, force and charge derivative interpolation, and the FFTs are then
+ * divided between its threads.  The results do not depend on the number of threads.
+ * By default (or if threads is NULL) everything except the FFTs runs on the calling thread.
+ *
+ * Arguments:
+ *
+ * pme         Opaque pme_t object, must have been initialized with pme_init()
+ * threads     The thread pool to use.  It must remain valid until pme_destroy() is called
+ *             or a different thread pool is set.
+ */
+int OPENMM_EXPORT
+pme_set_threads(pme_t pme,
+                ThreadPool* threads);
+
 /*
  * Evaluate reciprocal space PME energy and forces.
  *
@@ -53,6 +53,7 @@ public:
     double evaluate(const double* arguments) const;
     double evaluateDerivative(const double* arguments, const int* derivOrder) const;
     CustomFunction* clone() const;
+    bool getUniformSpline(const int* derivOrder, Lepton::UniformSpline& spline) const;
 private:
     ReferenceContinuous1DFunction(const ReferenceContinuous1DFunction& other);
     const Continuous1DFunction& function;
@@ -71,6 +72,7 @@ public:
     double evaluate(const double* arguments) const;
     double evaluateDerivative(const double* arguments, const int* derivOrder) const;
     CustomFunction* clone() const;
+    bool getUniformSpline(const int* derivOrder, Lepton::UniformSpline& spline) const;
 private:
     ReferenceContinuous2DFunction(const ReferenceContinuous2DFunction& other);
     const Continuous2DFunction& function;
@@ -160,6 +162,7 @@ public:
     double evaluate(const double* arguments) const;
     double evaluateDerivative(const double* arguments, const int* derivOrder) const;
     CustomFunction* clone() const;
+    bool getUniformSpline(const int* derivOrder, Lepton::UniformSpline& spline) const;
 private:
     std::shared_ptr<const CustomFunction> pointer;
 };
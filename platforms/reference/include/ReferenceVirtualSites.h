@@ -39,14 +39,31 @@ namespace OpenMM {
 class OPENMM_EXPORT ReferenceVirtualSites {
 public:
     ReferenceVirtualSites(const System& system);
+    virtual ~ReferenceVirtualSites() {
+    }
     /**
      * Compute the positions of all virtual sites.
      */
-    void computePositions(const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates, const Vec3* boxVectors) const;
+    virtual void computePositions(const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates, const Vec3* boxVectors) const;
     /**
      * Distribute forces from virtual sites to the atoms they are based on.
      */
-    void distributeForces(const System& system, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces, const Vec3* boxVectors) const;
+    virtual void distributeForces(const System& system, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces, const Vec3* boxVectors) const;
+protected:
+    /**
+     * Get the indices of all virtual sites, ordered so that every site comes after any other sites it depends on.
+     */
+    const std::vector<int>& getOrder() const {
+        return order;
+    }
+    /**
+     * Compute the position of a single virtual site.
+     */
+    static void computeSitePosition(const System& system, int index, std::vector<Vec3>& atomCoordinates, const Vec3* boxVectors, const Vec3* recipBoxVectors);
+    /**
+     * Distribute the force on a single virtual site to the atoms it is based on.
+     */
+    static void distributeSiteForce(const System& system, int index, const std::vector<Vec3>& atomCoordinates, std::vector<Vec3>& forces, const Vec3* boxVectors, const Vec3* recipBoxVectors);
 private:
     std::vector<int> order;
 };
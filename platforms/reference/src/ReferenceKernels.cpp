@@ -193,6 +193,21 @@ double ReferenceCalcForcesAndEnergyKernel::finishComputation(ContextImpl& contex
     return 0.0;
 }
 
+double ReferenceCalcForcesAndEnergyKernel::finishGroupComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int group,
+            vector<Vec3>& forces, map<string, double>& derivs) {
+    if (includeForce) {
+        vector<Vec3>& forceData = extractForces(context);
+        extractVirtualSites(context).distributeForces(context.getSystem(), extractPositions(context), forceData, extractBoxVectors(context));
+        forces.assign(forceData.begin(), forceData.end());
+        fill(forceData.begin(), forceData.end(), Vec3());
+    }
+    map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
+    derivs = energyParamDerivs;
+    for (auto& deriv : energyParamDerivs)
+        deriv.second = 0;
+    return 0.0;
+}
+
 void ReferenceUpdateStateDataKernel::initialize(const System& system) {
     int numParticles = system.getNumParticles();
     masses.resize(numParticles);
@@ -446,8 +461,9 @@ void ReferenceCalcCustomBondForceKernel::initialize(const System& system, const
     // Parse the expression used to calculate the force.
 
     Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction()).optimize();
-    energyExpression = expression.createCompiledExpression();
-    forceExpression = expression.differentiate("r").createCompiledExpression();
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(expression);
+    expressions.push_back(expression.differentiate("r"));
     for (int i = 0; i < numParameters; i++)
         parameterNames.push_back(force.getPerBondParameterName(i));
     for (int i = 0; i < force.getNumGlobalParameters(); i++)
@@ -455,14 +471,14 @@ void ReferenceCalcCustomBondForceKernel::initialize(const System& system, const
     for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++) {
         string param = force.getEnergyParameterDerivativeName(i);
         energyParamDerivNames.push_back(param);
-        energyParamDerivExpressions.push_back(expression.differentiate(param).createCompiledExpression());
+        expressions.push_back(expression.differentiate(param));
     }
     set<string> variables;
     variables.insert("r");
     variables.insert(parameterNames.begin(), parameterNames.end());
     variables.insert(globalParameterNames.begin(), globalParameterNames.end());
     validateVariables(expression.getRootNode(), variables);
-    ixn = new ReferenceCustomBondIxn(energyExpression, forceExpression, parameterNames, energyParamDerivExpressions);
+    ixn = new ReferenceCustomBondIxn(Lepton::ParsedExpression::createCompiledExpression(expressions), parameterNames, energyParamDerivNames.size());
 }
 
 double ReferenceCalcCustomBondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
@@ -576,8 +592,9 @@ void ReferenceCalcCustomAngleForceKernel::initialize(const System& system, const
     // Parse the expression used to calculate the force.
 
     Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction()).optimize();
-    energyExpression = expression.createCompiledExpression();
-    forceExpression = expression.differentiate("theta").createCompiledExpression();
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(expression);
+    expressions.push_back(expression.differentiate("theta"));
     for (int i = 0; i < numParameters; i++)
         parameterNames.push_back(force.getPerAngleParameterName(i));
     for (int i = 0; i < force.getNumGlobalParameters(); i++)
@@ -585,14 +602,14 @@ void ReferenceCalcCustomAngleForceKernel::initialize(const System& system, const
     for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++) {
         string param = force.getEnergyParameterDerivativeName(i);
         energyParamDerivNames.push_back(param);
-        energyParamDerivExpressions.push_back(expression.differentiate(param).createCompiledExpression());
+        expressions.push_back(expression.differentiate(param));
     }
     set<string> variables;
     variables.insert("theta");
     variables.insert(parameterNames.begin(), parameterNames.end());
     variables.insert(globalParameterNames.begin(), globalParameterNames.end());
     validateVariables(expression.getRootNode(), variables);
-    ixn = new ReferenceCustomAngleIxn(energyExpression, forceExpression, parameterNames, energyParamDerivExpressions);
+    ixn = new ReferenceCustomAngleIxn(Lepton::ParsedExpression::createCompiledExpression(expressions), parameterNames, energyParamDerivNames.size());
 }
 
 double ReferenceCalcCustomAngleForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
@@ -837,8 +854,9 @@ void ReferenceCalcCustomTorsionForceKernel::initialize(const System& system, con
     // Parse the expression used to calculate the force.
 
     Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction()).optimize();
-    energyExpression = expression.createCompiledExpression();
-    forceExpression = expression.differentiate("theta").createCompiledExpression();
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(expression);
+    expressions.push_back(expression.differentiate("theta"));
     for (int i = 0; i < numParameters; i++)
         parameterNames.push_back(force.getPerTorsionParameterName(i));
     for (int i = 0; i < force.getNumGlobalParameters(); i++)
@@ -846,14 +864,14 @@ void ReferenceCalcCustomTorsionForceKernel::initialize(const System& system, con
     for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++) {
         string param = force.getEnergyParameterDerivativeName(i);
         energyParamDerivNames.push_back(param);
-        energyParamDerivExpressions.push_back(expression.differentiate(param).createCompiledExpression());
+        expressions.push_back(expression.differentiate(param));
     }
     set<string> variables;
     variables.insert("theta");
     variables.insert(parameterNames.begin(), parameterNames.end());
     variables.insert(globalParameterNames.begin(), globalParameterNames.end());
     validateVariables(expression.getRootNode(), variables);
-    ixn = new ReferenceCustomTorsionIxn(energyExpression, forceExpression, parameterNames, energyParamDerivExpressions);
+    ixn = new ReferenceCustomTorsionIxn(Lepton::ParsedExpression::createCompiledExpression(expressions), parameterNames, energyParamDerivNames.size());
 }
 
 double ReferenceCalcCustomTorsionForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
@@ -1027,6 +1045,7 @@ double ReferenceCalcNonbondedForceKernel::execute(ContextImpl& context, bool inc
     }
     if (useSwitchingFunction)
         clj.setUseSwitchingFunction(switchingDistance);
+    clj.setThreadPool(extractThreadPool(context));
     clj.calculatePairIxn(numParticles, posData, particleParamArray, exclusions, forceData, includeEnergy ? &energy : NULL, includeDirect, includeReciprocal);
     if (includeDirect) {
         ReferenceBondForce refBondForce;
@@ -1932,10 +1951,11 @@ void ReferenceCalcCustomExternalForceKernel::initialize(const System& system, co
     ReferencePointDistanceFunction periodicDistance(true, &boxVectors);
     functions["periodicdistance"] = &periodicDistance;
     Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction(), functions).optimize();
-    energyExpression = expression.createCompiledExpression();
-    forceExpressionX = expression.differentiate("x").createCompiledExpression();
-    forceExpressionY = expression.differentiate("y").createCompiledExpression();
-    forceExpressionZ = expression.differentiate("z").createCompiledExpression();
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(expression);
+    expressions.push_back(expression.differentiate("x"));
+    expressions.push_back(expression.differentiate("y"));
+    expressions.push_back(expression.differentiate("z"));
     for (int i = 0; i < numParameters; i++)
         parameterNames.push_back(force.getPerParticleParameterName(i));
     for (int i = 0; i < force.getNumGlobalParameters(); i++)
@@ -1947,7 +1967,7 @@ void ReferenceCalcCustomExternalForceKernel::initialize(const System& system, co
     variables.insert(parameterNames.begin(), parameterNames.end());
     variables.insert(globalParameterNames.begin(), globalParameterNames.end());
     validateVariables(expression.getRootNode(), variables);
-    ixn = new ReferenceCustomExternalIxn(energyExpression, forceExpressionX, forceExpressionY, forceExpressionZ, parameterNames);
+    ixn = new ReferenceCustomExternalIxn(Lepton::ParsedExpression::createCompiledExpression(expressions), parameterNames);
 
 }
 
@@ -1960,8 +1980,7 @@ double ReferenceCalcCustomExternalForceKernel::execute(ContextImpl& context, boo
     for (auto& name : globalParameterNames)
         globalParameters[name] = context.getParameter(name);
     ixn->setGlobalParameters(globalParameters);
-    for (int i = 0; i < numParticles; ++i)
-        ixn->calculateForce(particles[i], posData, particleParamArray[i], forceData, includeEnergy ? &energy : NULL);
+    ixn->calculateForces(particles, posData, particleParamArray, forceData, includeEnergy ? &energy : NULL);
     return energy;
 }
 
@@ -2181,13 +2200,9 @@ void ReferenceCalcCustomCentroidBondForceKernel::createInteraction(const CustomC
         bondParameterNames.push_back(force.getPerBondParameterName(i));
     for (int i = 0; i < force.getNumGlobalParameters(); i++)
         globalParameterNames.push_back(force.getGlobalParameterName(i));
-    vector<Lepton::CompiledExpression> energyParamDerivExpressions;
-    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++) {
-        string param = force.getEnergyParameterDerivativeName(i);
-        energyParamDerivNames.push_back(param);
-        energyParamDerivExpressions.push_back(energyExpression.differentiate(param).createCompiledExpression());
-    }
-    ixn = new ReferenceCustomCentroidBondIxn(force.getNumGroupsPerBond(), groupAtoms, normalizedWeights, bondGroups, energyExpression, bondParameterNames, energyParamDerivExpressions);
+    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
+        energyParamDerivNames.push_back(force.getEnergyParameterDerivativeName(i));
+    ixn = new ReferenceCustomCentroidBondIxn(force.getNumGroupsPerBond(), groupAtoms, normalizedWeights, bondGroups, energyExpression, bondParameterNames, energyParamDerivNames);
 
     // Delete the custom functions.
 
@@ -2297,13 +2312,9 @@ void ReferenceCalcCustomCompoundBondForceKernel::createInteraction(const CustomC
         bondParameterNames.push_back(force.getPerBondParameterName(i));
     for (int i = 0; i < force.getNumGlobalParameters(); i++)
         globalParameterNames.push_back(force.getGlobalParameterName(i));
-    vector<Lepton::CompiledExpression> energyParamDerivExpressions;
-    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++) {
-        string param = force.getEnergyParameterDerivativeName(i);
-        energyParamDerivNames.push_back(param);
-        energyParamDerivExpressions.push_back(energyExpression.differentiate(param).createCompiledExpression());
-    }
-    ixn = new ReferenceCustomCompoundBondIxn(force.getNumParticlesPerBond(), bondParticles, energyExpression, bondParameterNames, energyParamDerivExpressions);
+    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
+        energyParamDerivNames.push_back(force.getEnergyParameterDerivativeName(i));
+    ixn = new ReferenceCustomCompoundBondIxn(force.getNumParticlesPerBond(), bondParticles, energyExpression, bondParameterNames, energyParamDerivNames);
 
     // Delete the custom functions.
 
@@ -3491,6 +3502,27 @@ void ReferenceCalcATMForceKernel::copyState(ContextImpl& context, ContextImpl& i
 
 }
 
+void ReferenceCalcATMForceKernel::copySharedState(ContextImpl& context, ContextImpl& sharedContext) {
+    sharedContext.setPositions(extractPositions(context));
+
+    Vec3 a, b, c;
+    context.getPeriodicBoxVectors(a, b, c);
+    sharedContext.setPeriodicBoxVectors(a, b, c);
+    sharedContext.setTime(context.getTime());
+
+    map<string, double> innerParameters = sharedContext.getParameters();
+    for (auto& param : innerParameters)
+        sharedContext.setParameter(param.first, context.getParameter(param.first));
+}
+
+void ReferenceCalcATMForceKernel::applySharedForces(ContextImpl& context, ContextImpl& sharedContext, double scale) {
+    vector<Vec3>& force = extractForces(context);
+    vector<Vec3>& sharedForce = extractForces(sharedContext);
+    if (fabs(scale) > std::numeric_limits<float>::min())
+        for (int i = 0; i < force.size(); i++)
+            force[i] += scale*sharedForce[i];
+}
+
 void ReferenceCalcATMForceKernel::copyParametersToContext(ContextImpl& context, const ATMForce& force) {
     if (force.getNumParticles() != numParticles)
           throw OpenMMException("copyParametersToContext: The number of ATMForce particles has changed");
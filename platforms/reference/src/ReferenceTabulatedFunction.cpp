@@ -59,6 +59,7 @@ static double wrap(double t, double min, double max) {
 using namespace OpenMM;
 using namespace std;
 using Lepton::CustomFunction;
+using Lepton::UniformSpline;
 
 extern "C" OPENMM_EXPORT CustomFunction* createReferenceTabulatedFunction(const TabulatedFunction& function) {
     CustomFunction* fn;
@@ -119,6 +120,35 @@ CustomFunction* ReferenceContinuous1DFunction::clone() const {
     return new ReferenceContinuous1DFunction(*this);
 }
 
+bool ReferenceContinuous1DFunction::getUniformSpline(const int* derivOrder, UniformSpline& spline) const {
+    // Convert the spline for each interval to a cubic polynomial in the fractional position t within it.
+
+    int numCells = x.size()-1;
+    double h = (max-min)/numCells;
+    spline.dimensions = 1;
+    spline.size[0] = numCells;
+    spline.min[0] = min;
+    spline.max[0] = max;
+    spline.periodic = periodic;
+    spline.coefficients.resize(4*numCells);
+    for (int i = 0; i < numCells; i++) {
+        double c[4];
+        c[0] = values[i];
+        c[1] = values[i+1]-values[i]-h*h*(2*derivs[i]+derivs[i+1])/6;
+        c[2] = h*h*derivs[i]/2;
+        c[3] = h*h*(derivs[i+1]-derivs[i])/6;
+        if (derivOrder[0] == 0)
+            for (int j = 0; j < 4; j++)
+                spline.coefficients[4*i+j] = c[j];
+        else {
+            for (int j = 0; j < 3; j++)
+                spline.coefficients[4*i+j] = (j+1)*c[j+1]/h;
+            spline.coefficients[4*i+3] = 0;
+        }
+    }
+    return (derivOrder[0] < 2);
+}
+
 ReferenceContinuous2DFunction::ReferenceContinuous2DFunction(const Continuous2DFunction& function) : function(function) {
     periodic = function.getPeriodic();
     function.getFunctionParameters(xsize, ysize, values, xmin, xmax, ymin, ymax);
@@ -174,6 +204,43 @@ CustomFunction* ReferenceContinuous2DFunction::clone() const {
     return new ReferenceContinuous2DFunction(*this);
 }
 
+bool ReferenceContinuous2DFunction::getUniformSpline(const int* derivOrder, UniformSpline& spline) const {
+    if (derivOrder[0]+derivOrder[1] > 1)
+        return false;
+    int numCells = (xsize-1)*(ysize-1);
+    double hx = (xmax-xmin)/(xsize-1);
+    double hy = (ymax-ymin)/(ysize-1);
+    spline.dimensions = 2;
+    spline.size[0] = xsize-1;
+    spline.size[1] = ysize-1;
+    spline.min[0] = xmin;
+    spline.max[0] = xmax;
+    spline.min[1] = ymin;
+    spline.max[1] = ymax;
+    spline.periodic = periodic;
+    spline.coefficients.resize(16*numCells, 0.0);
+    for (int cell = 0; cell < numCells; cell++) {
+        // SplineFitter stores the coefficient of t^i*u^j at index 4*i+j.
+
+        const vector<double>& coeff = c[cell];
+        double* dest = &spline.coefficients[16*cell];
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++) {
+                if (derivOrder[0] == 1) {
+                    if (i > 0)
+                        dest[(i-1)+4*j] = i*coeff[4*i+j]/hx;
+                }
+                else if (derivOrder[1] == 1) {
+                    if (j > 0)
+                        dest[i+4*(j-1)] = j*coeff[4*i+j]/hy;
+                }
+                else
+                    dest[i+4*j] = coeff[4*i+j];
+            }
+    }
+    return true;
+}
+
 ReferenceContinuous3DFunction::ReferenceContinuous3DFunction(const Continuous3DFunction& function) : function(function) {
     periodic = function.getPeriodic();
     function.getFunctionParameters(xsize, ysize, zsize, values, xmin, xmax, ymin, ymax, zmin, zmax);
@@ -331,3 +398,7 @@ double SharedFunctionWrapper::evaluateDerivative(const double* arguments, const
 CustomFunction* SharedFunctionWrapper::clone() const {
     return new SharedFunctionWrapper(pointer);
 }
+
+bool SharedFunctionWrapper::getUniformSpline(const int* derivOrder, UniformSpline& spline) const {
+    return pointer->getUniformSpline(derivOrder, spline);
+}
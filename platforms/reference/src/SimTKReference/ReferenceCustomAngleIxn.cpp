@@ -37,14 +37,10 @@ using namespace std;
 
    --------------------------------------------------------------------------------------- */
 
-ReferenceCustomAngleIxn::ReferenceCustomAngleIxn(const Lepton::CompiledExpression& energyExpression,
-        const Lepton::CompiledExpression& forceExpression, const vector<string>& parameterNames,
-        const vector<Lepton::CompiledExpression> energyParamDerivExpressions) :
-        energyExpression(energyExpression), forceExpression(forceExpression), usePeriodic(false), energyParamDerivExpressions(energyParamDerivExpressions) {
-    expressionSet.registerExpression(this->energyExpression);
-    expressionSet.registerExpression(this->forceExpression);
-    for (int i = 0; i < this->energyParamDerivExpressions.size(); i++)
-        expressionSet.registerExpression(this->energyParamDerivExpressions[i]);
+ReferenceCustomAngleIxn::ReferenceCustomAngleIxn(const Lepton::CompiledExpression& expression,
+        const vector<string>& parameterNames, int numEnergyParamDerivs) :
+        expression(expression), numEnergyParamDerivs(numEnergyParamDerivs), usePeriodic(false) {
+    expressionSet.registerExpression(this->expression);
     thetaIndex = expressionSet.getVariableIndex("theta");
     numParameters = parameterNames.size();
     for (auto& param : parameterNames)
@@ -126,8 +122,8 @@ void ReferenceCustomAngleIxn::calculateBondIxn(vector<int>& atomIndices,
 
    // Compute the force and energy, and apply them to the atoms.
    
-   double energy = energyExpression.evaluate();
-   double dEdR = forceExpression.evaluate();
+   double energy = expression.evaluate();
+   double dEdR = expression.getValue(1);
    double termA =  dEdR/(deltaR[0][ReferenceForce::R2Index]*rp);
    double termC = -dEdR/(deltaR[1][ReferenceForce::R2Index]*rp);
 
@@ -151,8 +147,8 @@ void ReferenceCustomAngleIxn::calculateBondIxn(vector<int>& atomIndices,
 
    // Record parameter derivatives.
 
-   for (int i = 0; i < energyParamDerivExpressions.size(); i++)
-       energyParamDerivs[i] += energyParamDerivExpressions[i].evaluate();
+   for (int i = 0; i < numEnergyParamDerivs; i++)
+       energyParamDerivs[i] += expression.getValue(i+2);
    
    // accumulate energies
 
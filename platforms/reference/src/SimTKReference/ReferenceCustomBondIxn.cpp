@@ -38,14 +38,10 @@ using namespace OpenMM;
 
    --------------------------------------------------------------------------------------- */
 
-ReferenceCustomBondIxn::ReferenceCustomBondIxn(const Lepton::CompiledExpression& energyExpression,
-        const Lepton::CompiledExpression& forceExpression, const vector<string>& parameterNames,
-        const vector<Lepton::CompiledExpression> energyParamDerivExpressions) :
-        energyExpression(energyExpression), forceExpression(forceExpression), usePeriodic(false), energyParamDerivExpressions(energyParamDerivExpressions) {
-    expressionSet.registerExpression(this->energyExpression);
-    expressionSet.registerExpression(this->forceExpression);
-    for (int i = 0; i < this->energyParamDerivExpressions.size(); i++)
-        expressionSet.registerExpression(this->energyParamDerivExpressions[i]);
+ReferenceCustomBondIxn::ReferenceCustomBondIxn(const Lepton::CompiledExpression& expression,
+        const vector<string>& parameterNames, int numEnergyParamDerivs) :
+        expression(expression), numEnergyParamDerivs(numEnergyParamDerivs), usePeriodic(false) {
+    expressionSet.registerExpression(this->expression);
     rIndex = expressionSet.getVariableIndex("r");
     numParameters = parameterNames.size();
     for (auto& param : parameterNames)
@@ -106,7 +102,8 @@ void ReferenceCustomBondIxn::calculateBondIxn(vector<int>& atomIndices,
        ReferenceForce::getDeltaR(atomCoordinates[atomAIndex], atomCoordinates[atomBIndex], deltaR);
    
    expressionSet.setVariable(rIndex, deltaR[ReferenceForce::RIndex]);
-   double dEdR            = forceExpression.evaluate();
+   double energy          = expression.evaluate();
+   double dEdR            = expression.getValue(1);
    dEdR                   = deltaR[ReferenceForce::RIndex] > 0 ? (dEdR/deltaR[ReferenceForce::RIndex]) : 0;
 
    forces[atomAIndex][0] += dEdR*deltaR[ReferenceForce::XIndex];
@@ -117,8 +114,8 @@ void ReferenceCustomBondIxn::calculateBondIxn(vector<int>& atomIndices,
    forces[atomBIndex][1] -= dEdR*deltaR[ReferenceForce::YIndex];
    forces[atomBIndex][2] -= dEdR*deltaR[ReferenceForce::ZIndex];
 
-   for (int i = 0; i < energyParamDerivExpressions.size(); i++)
-       energyParamDerivs[i] += energyParamDerivExpressions[i].evaluate();
+   for (int i = 0; i < numEnergyParamDerivs; i++)
+       energyParamDerivs[i] += expression.getValue(i+2);
    if (totalEnergy != NULL)
-       *totalEnergy += energyExpression.evaluate();
+       *totalEnergy += energy;
 }
@@ -129,22 +129,16 @@ void ReferenceCustomCVForce::calculateIxn(ContextImpl& innerContext, vector<Vec3
     // Compute the collective variables, and their derivatives with respect to particle positions.
     
     int numCVs = variableNames.size();
-    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(innerContext.getPlatformData());
-    vector<Vec3>& innerForces = *((vector<Vec3>*) data->forces);
-    map<string, double>& innerDerivs = *((map<string, double>*) data->energyParameterDerivatives);
-    vector<vector<Vec3> > cvForces;
-    vector<map<string, double> > cvDerivs;
-    for (int i = 0; i < numCVs; i++) {
-        cvValues[i] = innerContext.calcForcesAndEnergy(true, true, 1<<i);
-        cvForces.push_back(innerForces);
-        cvDerivs.push_back(innerDerivs);
-    }
+    int numParticles = atomCoordinates.size();
+    vector<int> groups(numCVs);
+    for (int i = 0; i < numCVs; i++)
+        groups[i] = i;
+    innerContext.calcForcesAndEnergyByGroup(true, groups, cvValues, cvForces, cvDerivs);
     
     // Compute the energy and forces.
     
     for (int i = 0; i < globalParameterNames.size(); i++)
         globalValues[i] = globalParameters.at(globalParameterNames[i]);
-    int numParticles = atomCoordinates.size();
     if (totalEnergy != NULL)
         *totalEnergy += energyExpression.evaluate();
     for (int i = 0; i < numCVs; i++) {
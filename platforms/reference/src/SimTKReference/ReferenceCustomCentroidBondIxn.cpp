@@ -40,28 +40,27 @@ using namespace OpenMM;
 ReferenceCustomCentroidBondIxn::ReferenceCustomCentroidBondIxn(int numGroupsPerBond, const vector<vector<int> >& groupAtoms,
             const vector<vector<double> >& normalizedWeights, const vector<vector<int> >& bondGroups,
             const Lepton::ParsedExpression& energyExpression, const vector<string>& bondParameterNames,
-            const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions) :
-            groupAtoms(groupAtoms), normalizedWeights(normalizedWeights), bondGroups(bondGroups), energyExpression(energyExpression.createCompiledExpression()),
-            usePeriodic(false), energyParamDerivExpressions(energyParamDerivExpressions) {
-    expressionSet.registerExpression(this->energyExpression);
-    for (int i = 0; i < this->energyParamDerivExpressions.size(); i++)
-        expressionSet.registerExpression(this->energyParamDerivExpressions[i]);
+            const vector<string>& energyParamDerivNames) :
+            groupAtoms(groupAtoms), normalizedWeights(normalizedWeights), bondGroups(bondGroups), bondParamNames(bondParameterNames),
+            numEnergyParamDerivs(energyParamDerivNames.size()), usePeriodic(false) {
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(energyExpression);
     for (int i = 0; i < numGroupsPerBond; i++) {
         stringstream xname, yname, zname;
         xname << 'x' << (i+1);
         yname << 'y' << (i+1);
         zname << 'z' << (i+1);
-        positionTerms.push_back(ReferenceCustomCentroidBondIxn::PositionTermInfo(xname.str(), i, 0, energyExpression.differentiate(xname.str()).createCompiledExpression()));
-        positionTerms.push_back(ReferenceCustomCentroidBondIxn::PositionTermInfo(yname.str(), i, 1, energyExpression.differentiate(yname.str()).createCompiledExpression()));
-        positionTerms.push_back(ReferenceCustomCentroidBondIxn::PositionTermInfo(zname.str(), i, 2, energyExpression.differentiate(zname.str()).createCompiledExpression()));
+        positionTerms.push_back(ReferenceCustomCentroidBondIxn::PositionTermInfo(xname.str(), i, 0, expressions.size()));
+        expressions.push_back(energyExpression.differentiate(xname.str()));
+        positionTerms.push_back(ReferenceCustomCentroidBondIxn::PositionTermInfo(yname.str(), i, 1, expressions.size()));
+        expressions.push_back(energyExpression.differentiate(yname.str()));
+        positionTerms.push_back(ReferenceCustomCentroidBondIxn::PositionTermInfo(zname.str(), i, 2, expressions.size()));
+        expressions.push_back(energyExpression.differentiate(zname.str()));
     }
-    for (int i = 0; i < positionTerms.size(); i++) {
-        expressionSet.registerExpression(positionTerms[i].forceExpression);
-        positionTerms[i].index = expressionSet.getVariableIndex(positionTerms[i].name);
-    }
-    numParameters = bondParameterNames.size();
-    for (int i = 0; i < numParameters; i++)
-        bondParamIndex.push_back(expressionSet.getVariableIndex(bondParameterNames[i]));
+    for (auto& paramName : energyParamDerivNames)
+        expressions.push_back(energyExpression.differentiate(paramName));
+    expression = Lepton::ParsedExpression::createCompiledExpression(expressions);
+    expressionSet.registerExpression(expression);
 }
 
 ReferenceCustomCentroidBondIxn::~ReferenceCustomCentroidBondIxn() {
@@ -87,48 +86,59 @@ void ReferenceCustomCentroidBondIxn::calculatePairIxn(vector<Vec3>& atomCoordina
             groupCenters[group] += atomCoordinates[groupAtoms[group][i]]*normalizedWeights[group][i];
     }
 
-    // Compute the forces on groups.
+    // Gather the values of the variables for every bond into arrays.
 
     for (auto& param : globalParameters)
         expressionSet.setVariable(expressionSet.getVariableIndex(param.first), param.second);
-    vector<Vec3> groupForces(numGroups);
     int numBonds = bondGroups.size();
-    for (int bond = 0; bond < numBonds; bond++) {
-        for (int i = 0; i < numParameters; i++)
-            expressionSet.setVariable(bondParamIndex[i], bondParameters[bond][i]);
-        calculateOneIxn(bond, groupCenters, groupForces, totalEnergy, energyParamDerivs);
+    int numParameters = bondParamNames.size();
+    int numTerms = positionTerms.size();
+    vector<vector<double> > inputs(numTerms+numParameters, vector<double>(numBonds));
+    map<string, const double*> variables;
+    for (int i = 0; i < numTerms; i++) {
+        const PositionTermInfo& term = positionTerms[i];
+        for (int bond = 0; bond < numBonds; bond++)
+            inputs[i][bond] = groupCenters[bondGroups[bond][term.group]][term.component];
+        variables[term.name] = inputs[i].data();
     }
-
-    // Apply the forces to the individual atoms.
-
-    for (int group = 0; group < numGroups; group++) {
-        for (int i = 0; i < groupAtoms[group].size(); i++)
-            forces[groupAtoms[group][i]] += groupForces[group]*normalizedWeights[group][i];
+    for (int i = 0; i < numParameters; i++) {
+        vector<double>& values = inputs[numTerms+i];
+        for (int bond = 0; bond < numBonds; bond++)
+            values[bond] = bondParameters[bond][i];
+        variables[bondParamNames[i]] = values.data();
     }
-}
 
-void ReferenceCustomCentroidBondIxn::calculateOneIxn(int bond, vector<Vec3>& groupCenters,
-                        vector<Vec3>& forces, double* totalEnergy, double* energyParamDerivs) {
-    // Compute all of the variables the energy can depend on.
+    // Evaluate the energy and all its derivatives for every bond at once.
 
-    const vector<int>& groups = bondGroups[bond];
-    for (auto& term : positionTerms)
-        expressionSet.setVariable(term.index, groupCenters[groups[term.group]][term.component]);
+    int numValues = expression.getNumValues();
+    vector<vector<double> > outputs(numValues, vector<double>(numBonds));
+    vector<double*> results(numValues);
+    for (int i = 0; i < numValues; i++)
+        results[i] = outputs[i].data();
+    if (totalEnergy == NULL)
+        results[0] = NULL;
+    expression.evaluate(numBonds, variables, results);
 
-    // Apply forces based on particle coordinates.
+    // Compute the forces on groups.
 
+    vector<Vec3> groupForces(numGroups);
     for (auto& term : positionTerms)
-        forces[groups[term.group]][term.component] -= term.forceExpression.evaluate();
+        for (int bond = 0; bond < numBonds; bond++)
+            groupForces[bondGroups[bond][term.group]][term.component] -= outputs[term.valueIndex][bond];
+    if (totalEnergy)
+        for (int bond = 0; bond < numBonds; bond++)
+            *totalEnergy += outputs[0][bond];
+    int firstDeriv = numValues-numEnergyParamDerivs;
+    for (int i = 0; i < numEnergyParamDerivs; i++)
+        for (int bond = 0; bond < numBonds; bond++)
+            energyParamDerivs[i] += outputs[firstDeriv+i][bond];
 
-    // Add the energy
+    // Apply the forces to the individual atoms.
 
-    if (totalEnergy)
-        *totalEnergy += energyExpression.evaluate();
-    
-    // Compute derivatives of the energy.
-    
-    for (int i = 0; i < energyParamDerivExpressions.size(); i++)
-        energyParamDerivs[i] += energyParamDerivExpressions[i].evaluate();
+    for (int group = 0; group < numGroups; group++) {
+        for (int i = 0; i < groupAtoms[group].size(); i++)
+            forces[groupAtoms[group][i]] += groupForces[group]*normalizedWeights[group][i];
+    }
 }
 
 void ReferenceCustomCentroidBondIxn::computeDelta(int group1, int group2, double* delta, vector<Vec3>& groupCenters) const {
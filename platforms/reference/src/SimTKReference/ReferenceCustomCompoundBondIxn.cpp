@@ -45,25 +45,29 @@ using namespace OpenMM;
 
 ReferenceCustomCompoundBondIxn::ReferenceCustomCompoundBondIxn(int numParticlesPerBond, const vector<vector<int> >& bondAtoms,
             const Lepton::ParsedExpression& energyExpression, const vector<string>& bondParameterNames,
-            const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions) :
-            bondAtoms(bondAtoms), energyExpression(energyExpression.createCompiledExpression()), usePeriodic(false),
-            energyParamDerivExpressions(energyParamDerivExpressions) {
-    expressionSet.registerExpression(this->energyExpression);
-    for (int i = 0; i < this->energyParamDerivExpressions.size(); i++)
-        expressionSet.registerExpression(this->energyParamDerivExpressions[i]);
+            const vector<string>& energyParamDerivNames) :
+            bondAtoms(bondAtoms), numEnergyParamDerivs(energyParamDerivNames.size()),
+            usePeriodic(false) {
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(energyExpression);
     for (int i = 0; i < numParticlesPerBond; i++) {
         stringstream xname, yname, zname;
         xname << 'x' << (i+1);
         yname << 'y' << (i+1);
         zname << 'z' << (i+1);
-        particleTerms.push_back(ReferenceCustomCompoundBondIxn::ParticleTermInfo(xname.str(), i, 0, energyExpression.differentiate(xname.str()).createCompiledExpression()));
-        particleTerms.push_back(ReferenceCustomCompoundBondIxn::ParticleTermInfo(yname.str(), i, 1, energyExpression.differentiate(yname.str()).createCompiledExpression()));
-        particleTerms.push_back(ReferenceCustomCompoundBondIxn::ParticleTermInfo(zname.str(), i, 2, energyExpression.differentiate(zname.str()).createCompiledExpression()));
+        particleTerms.push_back(ReferenceCustomCompoundBondIxn::ParticleTermInfo(xname.str(), i, 0, expressions.size()));
+        expressions.push_back(energyExpression.differentiate(xname.str()));
+        particleTerms.push_back(ReferenceCustomCompoundBondIxn::ParticleTermInfo(yname.str(), i, 1, expressions.size()));
+        expressions.push_back(energyExpression.differentiate(yname.str()));
+        particleTerms.push_back(ReferenceCustomCompoundBondIxn::ParticleTermInfo(zname.str(), i, 2, expressions.size()));
+        expressions.push_back(energyExpression.differentiate(zname.str()));
     }
-    for (int i = 0; i < particleTerms.size(); i++) {
-        expressionSet.registerExpression(particleTerms[i].forceExpression);
+    for (auto& paramName : energyParamDerivNames)
+        expressions.push_back(energyExpression.differentiate(paramName));
+    expression = Lepton::ParsedExpression::createCompiledExpression(expressions);
+    expressionSet.registerExpression(expression);
+    for (int i = 0; i < particleTerms.size(); i++)
         particleTerms[i].index = expressionSet.getVariableIndex(particleTerms[i].name);
-    }
     numParameters = bondParameterNames.size();
     for (int i = 0; i < numParameters; i++)
         bondParamIndex.push_back(expressionSet.getVariableIndex(bondParameterNames[i]));
@@ -130,20 +134,25 @@ void ReferenceCustomCompoundBondIxn::calculateOneIxn(int bond, vector<Vec3>& ato
     for (auto& term : particleTerms)
         expressionSet.setVariable(term.index, atomCoordinates[atoms[term.atom]][term.component]);
     
+    // Evaluate the energy and all its derivatives at once.
+    
+    double energy = expression.evaluate();
+    
     // Apply forces based on particle coordinates.
     
     for (auto& term : particleTerms)
-        forces[atoms[term.atom]][term.component] -= term.forceExpression.evaluate();
+        forces[atoms[term.atom]][term.component] -= expression.getValue(term.valueIndex);
 
     // Add the energy
 
     if (totalEnergy)
-        *totalEnergy += energyExpression.evaluate();
+        *totalEnergy += energy;
     
     // Compute derivatives of the energy.
     
-    for (int i = 0; i < energyParamDerivExpressions.size(); i++)
-        energyParamDerivs[i] += energyParamDerivExpressions[i].evaluate();
+    int firstDeriv = expression.getNumValues()-numEnergyParamDerivs;
+    for (int i = 0; i < numEnergyParamDerivs; i++)
+        energyParamDerivs[i] += expression.getValue(firstDeriv+i);
 }
 
 void ReferenceCustomCompoundBondIxn::computeDelta(int atom1, int atom2, double* delta, vector<Vec3>& atomCoordinates) const {
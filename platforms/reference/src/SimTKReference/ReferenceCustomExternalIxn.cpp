@@ -38,31 +38,8 @@ using namespace OpenMM;
 
    --------------------------------------------------------------------------------------- */
 
-ReferenceCustomExternalIxn::ReferenceCustomExternalIxn(const Lepton::CompiledExpression& energyExpression,
-        const Lepton::CompiledExpression& forceExpressionX, const Lepton::CompiledExpression& forceExpressionY,
-        const Lepton::CompiledExpression& forceExpressionZ, const vector<string>& parameterNames) :
-        energyExpression(energyExpression), forceExpressionX(forceExpressionX), forceExpressionY(forceExpressionY),
-        forceExpressionZ(forceExpressionZ) {
-
-    energyX = ReferenceForce::getVariablePointer(this->energyExpression, "x");
-    energyY = ReferenceForce::getVariablePointer(this->energyExpression, "y");
-    energyZ = ReferenceForce::getVariablePointer(this->energyExpression, "z");
-    forceXX = ReferenceForce::getVariablePointer(this->forceExpressionX, "x");
-    forceXY = ReferenceForce::getVariablePointer(this->forceExpressionX, "y");
-    forceXZ = ReferenceForce::getVariablePointer(this->forceExpressionX, "z");
-    forceYX = ReferenceForce::getVariablePointer(this->forceExpressionY, "x");
-    forceYY = ReferenceForce::getVariablePointer(this->forceExpressionY, "y");
-    forceYZ = ReferenceForce::getVariablePointer(this->forceExpressionY, "z");
-    forceZX = ReferenceForce::getVariablePointer(this->forceExpressionZ, "x");
-    forceZY = ReferenceForce::getVariablePointer(this->forceExpressionZ, "y");
-    forceZZ = ReferenceForce::getVariablePointer(this->forceExpressionZ, "z");
-    numParameters = parameterNames.size();
-    for (auto& param : parameterNames) {
-        energyParams.push_back(ReferenceForce::getVariablePointer(this->energyExpression, param));
-        forceXParams.push_back(ReferenceForce::getVariablePointer(this->forceExpressionX, param));
-        forceYParams.push_back(ReferenceForce::getVariablePointer(this->forceExpressionY, param));
-        forceZParams.push_back(ReferenceForce::getVariablePointer(this->forceExpressionZ, param));
-    }
+ReferenceCustomExternalIxn::ReferenceCustomExternalIxn(const Lepton::CompiledExpression& expression,
+        const vector<string>& parameterNames) : expression(expression), paramNames(parameterNames) {
 }
 
 /**---------------------------------------------------------------------------------------
@@ -75,56 +52,64 @@ ReferenceCustomExternalIxn::~ReferenceCustomExternalIxn() {
 }
 
 void ReferenceCustomExternalIxn::setGlobalParameters(std::map<std::string, double> parameters) {
-    for (auto& param : parameters) {
-        ReferenceForce::setVariable(ReferenceForce::getVariablePointer(this->energyExpression, param.first), param.second);
-        ReferenceForce::setVariable(ReferenceForce::getVariablePointer(this->forceExpressionX, param.first), param.second);
-        ReferenceForce::setVariable(ReferenceForce::getVariablePointer(this->forceExpressionY, param.first), param.second);
-        ReferenceForce::setVariable(ReferenceForce::getVariablePointer(this->forceExpressionZ, param.first), param.second);
-    }
+    for (auto& param : parameters)
+        ReferenceForce::setVariable(ReferenceForce::getVariablePointer(this->expression, param.first), param.second);
 }
 
 /**---------------------------------------------------------------------------------------
 
    Calculate Custom External Ixn
 
-   @param atomIndex        the index of the atom to apply the force to
+   @param particles        the indices of the atoms to apply the force to
    @param atomCoordinates  atom coordinates
-   @param parameters       parameters values
+   @param parameters       parameter values for each entry in particles
    @param forces           force array (forces added to input values)
    @param energy           energy is added to this
 
    --------------------------------------------------------------------------------------- */
 
-void ReferenceCustomExternalIxn::calculateForce(int atomIndex,
-                                                vector<Vec3>& atomCoordinates,
-                                                vector<double>& parameters,
-                                                vector<Vec3>& forces,
-                                                double* energy) const {
-
-   for (int i = 0; i < numParameters; i++) {
-       ReferenceForce::setVariable(energyParams[i], parameters[i]);
-       ReferenceForce::setVariable(forceXParams[i], parameters[i]);
-       ReferenceForce::setVariable(forceYParams[i], parameters[i]);
-       ReferenceForce::setVariable(forceZParams[i], parameters[i]);
+void ReferenceCustomExternalIxn::calculateForces(const vector<int>& particles,
+                                                 vector<Vec3>& atomCoordinates,
+                                                 const vector<vector<double> >& parameters,
+                                                 vector<Vec3>& forces,
+                                                 double* energy) {
+
+   // Gather the inputs into arrays and evaluate the expression for all particles at once.
+
+   int numParticles = particles.size();
+   int numParameters = paramNames.size();
+   x.resize(numParticles);
+   y.resize(numParticles);
+   z.resize(numParticles);
+   energies.resize(numParticles);
+   forceX.resize(numParticles);
+   forceY.resize(numParticles);
+   forceZ.resize(numParticles);
+   paramValues.resize(numParameters);
+   for (int j = 0; j < numParameters; j++)
+       paramValues[j].resize(numParticles);
+   for (int i = 0; i < numParticles; i++) {
+       const Vec3& pos = atomCoordinates[particles[i]];
+       x[i] = pos[0];
+       y[i] = pos[1];
+       z[i] = pos[2];
+       for (int j = 0; j < numParameters; j++)
+           paramValues[j][i] = parameters[i][j];
+   }
+   map<string, const double*> variables = {{"x", x.data()}, {"y", y.data()}, {"z", z.data()}};
+   for (int j = 0; j < numParameters; j++)
+       variables[paramNames[j]] = paramValues[j].data();
+   expression.evaluate(numParticles, variables, {energy == NULL ? NULL : energies.data(), forceX.data(), forceY.data(), forceZ.data()});
+
+   // Accumulate the results.
+
+   for (int i = 0; i < numParticles; i++) {
+       Vec3& f = forces[particles[i]];
+       f[0] -= forceX[i];
+       f[1] -= forceY[i];
+       f[2] -= forceZ[i];
    }
-   ReferenceForce::setVariable(energyX, atomCoordinates[atomIndex][0]);
-   ReferenceForce::setVariable(energyY, atomCoordinates[atomIndex][1]);
-   ReferenceForce::setVariable(energyZ, atomCoordinates[atomIndex][2]);
-   ReferenceForce::setVariable(forceXX, atomCoordinates[atomIndex][0]);
-   ReferenceForce::setVariable(forceXY, atomCoordinates[atomIndex][1]);
-   ReferenceForce::setVariable(forceXZ, atomCoordinates[atomIndex][2]);
-   ReferenceForce::setVariable(forceYX, atomCoordinates[atomIndex][0]);
-   ReferenceForce::setVariable(forceYY, atomCoordinates[atomIndex][1]);
-   ReferenceForce::setVariable(forceYZ, atomCoordinates[atomIndex][2]);
-   ReferenceForce::setVariable(forceZX, atomCoordinates[atomIndex][0]);
-   ReferenceForce::setVariable(forceZY, atomCoordinates[atomIndex][1]);
-   ReferenceForce::setVariable(forceZZ, atomCoordinates[atomIndex][2]);
-
-   // ---------------------------------------------------------------------------------------
-
-   forces[atomIndex][0] -= forceExpressionX.evaluate();
-   forces[atomIndex][1] -= forceExpressionY.evaluate();
-   forces[atomIndex][2] -= forceExpressionZ.evaluate();
    if (energy != NULL)
-       *energy += energyExpression.evaluate();
+       for (int i = 0; i < numParticles; i++)
+           *energy += energies[i];
 }
@@ -120,77 +120,144 @@ void ReferenceCustomHbondIxn::calculatePairIxn(vector<Vec3>& atomCoordinates, ve
                                              vector<set<int> >& exclusions, const map<string, double>& globalParameters, vector<Vec3>& forces,
                                              double* totalEnergy) const {
 
-   map<string, double> variables = globalParameters;
-
-   // allocate and initialize exclusion array
-
    int numDonors = donorAtoms.size();
    int numAcceptors = acceptorAtoms.size();
+   int numTerms = distanceTerms.size()+angleTerms.size()+dihedralTerms.size();
+   vector<int> pairAcceptors;
+   vector<vector<double> > termValues(numTerms), termDerivs(numTerms);
+   vector<double> energies;
+   map<string, vector<double> > values;
+   int atoms[6];
 
    for (int donor = 0; donor < numDonors; donor++) {
-      // Initialize per-donor parameters.
-
-      for (int j = 0; j < (int) donorParamNames.size(); j++)
-          variables[donorParamNames[j]] = donorParameters[donor][j];
-
-      // loop over atom pairs
+      // Find the acceptors that interact with this donor, and compute the variables the energy can
+      // depend on for each of them.
 
+      pairAcceptors.clear();
+      for (int i = 0; i < numTerms; i++)
+          termValues[i].clear();
       for (int acceptor = 0; acceptor < numAcceptors; acceptor++) {
-         if (exclusions[donor].find(acceptor) == exclusions[donor].end()) {
-             for (int j = 0; j < (int) acceptorParamNames.size(); j++)
-                 variables[acceptorParamNames[j]] = acceptorParameters[acceptor][j];
-             calculateOneIxn(donor, acceptor, atomCoordinates, variables, forces, totalEnergy);
+         if (exclusions[donor].find(acceptor) != exclusions[donor].end())
+             continue;
+         getAtoms(donor, acceptor, atoms);
+         if (cutoff) {
+             double delta[ReferenceForce::LastDeltaRIndex];
+             computeDelta(atoms[0], atoms[3], delta, atomCoordinates);
+             if (delta[ReferenceForce::RIndex] >= cutoffDistance)
+                 continue;
          }
+         pairAcceptors.push_back(acceptor);
+         computeTerms(atoms, atomCoordinates);
+         for (int i = 0; i < numTerms; i++)
+             termValues[i].push_back(getTermValue(i));
       }
-   }
-}
+      int numPairs = pairAcceptors.size();
+      if (numPairs == 0)
+          continue;
 
-  /**---------------------------------------------------------------------------------------
+      // Gather the values of all variables into arrays.  Donor parameters override global parameters,
+      // and acceptor parameters override both.
 
-     Calculate custom interaction between a donor and an acceptor
+      values.clear();
+      for (auto& param : globalParameters)
+          values[param.first].assign(numPairs, param.second);
+      for (int j = 0; j < (int) donorParamNames.size(); j++)
+          values[donorParamNames[j]].assign(numPairs, donorParameters[donor][j]);
+      for (int j = 0; j < (int) acceptorParamNames.size(); j++) {
+          vector<double>& param = values[acceptorParamNames[j]];
+          param.resize(numPairs);
+          for (int k = 0; k < numPairs; k++)
+              param[k] = acceptorParameters[pairAcceptors[k]][j];
+      }
+      map<string, const double*> variables;
+      for (auto& value : values)
+          variables[value.first] = value.second.data();
+      for (int i = 0; i < numTerms; i++)
+          variables[getTermName(i)] = termValues[i].data();
 
-     @param donor            the index of the donor
-     @param acceptor         the index of the acceptor
-     @param atomCoordinates  atom coordinates
-     @param variables        the values of variables that may appear in expressions
-     @param forces           force array (forces added)
-     @param energyByAtom     atom energy
-     @param totalEnergy      total energy
+      // Evaluate the energy and its derivatives for all pairs at once.
 
-     --------------------------------------------------------------------------------------- */
+      for (int i = 0; i < numTerms; i++) {
+          termDerivs[i].resize(numPairs);
+          getForceExpression(i).evaluate(numPairs, variables, termDerivs[i].data());
+      }
+      if (totalEnergy) {
+          energies.resize(numPairs);
+          energyExpression.evaluate(numPairs, variables, energies.data());
+          for (int k = 0; k < numPairs; k++)
+              *totalEnergy += energies[k];
+      }
 
-void ReferenceCustomHbondIxn::calculateOneIxn(int donor, int acceptor, vector<Vec3>& atomCoordinates,
-                        map<string, double>& variables, vector<Vec3>& forces, double* totalEnergy) const {
+      // Apply the forces.  The geometry is cheap to compute, so recompute it rather than storing it
+      // for every pair.
 
-    int atoms[6];
+      vector<double> derivs(numTerms);
+      for (int k = 0; k < numPairs; k++) {
+          getAtoms(donor, pairAcceptors[k], atoms);
+          computeTerms(atoms, atomCoordinates);
+          for (int i = 0; i < numTerms; i++)
+              derivs[i] = termDerivs[i][k];
+          applyForces(atoms, derivs.data(), forces);
+      }
+   }
+}
+
+void ReferenceCustomHbondIxn::getAtoms(int donor, int acceptor, int* atoms) const {
     atoms[0] = acceptorAtoms[acceptor][0];
     atoms[1] = acceptorAtoms[acceptor][1];
     atoms[2] = acceptorAtoms[acceptor][2];
     atoms[3] = donorAtoms[donor][0];
     atoms[4] = donorAtoms[donor][1];
     atoms[5] = donorAtoms[donor][2];
+}
 
-    // Compute the distance between the primary donor and acceptor atoms, and compare to the cutoff.
+const string& ReferenceCustomHbondIxn::getTermName(int index) const {
+    if (index < distanceTerms.size())
+        return distanceTerms[index].name;
+    index -= distanceTerms.size();
+    if (index < angleTerms.size())
+        return angleTerms[index].name;
+    return dihedralTerms[index-angleTerms.size()].name;
+}
 
-    if (cutoff) {
-        double delta[ReferenceForce::LastDeltaRIndex];
-        computeDelta(atoms[0], atoms[3], delta, atomCoordinates);
-        if (delta[ReferenceForce::RIndex] >= cutoffDistance)
-            return;
-    }
+double ReferenceCustomHbondIxn::getTermValue(int index) const {
+    if (index < distanceTerms.size())
+        return distanceTerms[index].value;
+    index -= distanceTerms.size();
+    if (index < angleTerms.size())
+        return angleTerms[index].value;
+    return dihedralTerms[index-angleTerms.size()].value;
+}
+
+const Lepton::ExpressionProgram& ReferenceCustomHbondIxn::getForceExpression(int index) const {
+    if (index < distanceTerms.size())
+        return distanceTerms[index].forceExpression;
+    index -= distanceTerms.size();
+    if (index < angleTerms.size())
+        return angleTerms[index].forceExpression;
+    return dihedralTerms[index-angleTerms.size()].forceExpression;
+}
 
-    // Compute all of the variables the energy can depend on.
+  /**---------------------------------------------------------------------------------------
+
+     Compute the distances, angles, and dihedrals for a donor-acceptor pair
 
+     @param atoms            the indices of the acceptor atoms followed by the donor atoms
+     @param atomCoordinates  atom coordinates
+
+     --------------------------------------------------------------------------------------- */
+
+void ReferenceCustomHbondIxn::computeTerms(const int* atoms, vector<Vec3>& atomCoordinates) const {
     for (int i = 0; i < (int) distanceTerms.size(); i++) {
         const DistanceTermInfo& term = distanceTerms[i];
         computeDelta(atoms[term.p1], atoms[term.p2], term.delta, atomCoordinates);
-        variables[term.name] = term.delta[ReferenceForce::RIndex];
+        term.value = term.delta[ReferenceForce::RIndex];
     }
     for (int i = 0; i < (int) angleTerms.size(); i++) {
         const AngleTermInfo& term = angleTerms[i];
         computeDelta(atoms[term.p1], atoms[term.p2], term.delta1, atomCoordinates);
         computeDelta(atoms[term.p3], atoms[term.p2], term.delta2, atomCoordinates);
-        variables[term.name] = computeAngle(term.delta1, term.delta2);
+        term.value = computeAngle(term.delta1, term.delta2);
     }
     for (int i = 0; i < (int) dihedralTerms.size(); i++) {
         const DihedralTermInfo& term = dihedralTerms[i];
@@ -199,26 +266,42 @@ void ReferenceCustomHbondIxn::calculateOneIxn(int donor, int acceptor, vector<Ve
         computeDelta(atoms[term.p4], atoms[term.p3], term.delta3, atomCoordinates);
         double dotDihedral, signOfDihedral;
         double* crossProduct[] = {term.cross1, term.cross2};
-        variables[term.name] = getDihedralAngleBetweenThreeVectors(term.delta1, term.delta2, term.delta3, crossProduct, &dotDihedral, term.delta1, &signOfDihedral, 1);
+        term.value = getDihedralAngleBetweenThreeVectors(term.delta1, term.delta2, term.delta3, crossProduct, &dotDihedral, term.delta1, &signOfDihedral, 1);
     }
+}
+
+  /**---------------------------------------------------------------------------------------
+
+     Apply the forces for a donor-acceptor pair.  This must be called immediately after
+     computeTerms() for the same pair.
+
+     @param atoms            the indices of the acceptor atoms followed by the donor atoms
+     @param termDerivs       the derivative of the energy with respect to each distance, angle,
+                             and dihedral, in that order
+     @param forces           force array (forces added)
+
+     --------------------------------------------------------------------------------------- */
+
+void ReferenceCustomHbondIxn::applyForces(const int* atoms, const double* termDerivs, vector<Vec3>& forces) const {
 
     // Apply forces based on distances.
 
     for (int i = 0; i < (int) distanceTerms.size(); i++) {
         const DistanceTermInfo& term = distanceTerms[i];
-        double dEdR = term.forceExpression.evaluate(variables)/(term.delta[ReferenceForce::RIndex]);
+        double dEdR = termDerivs[i]/(term.delta[ReferenceForce::RIndex]);
         for (int i = 0; i < 3; i++) {
            double force  = -dEdR*term.delta[i];
            forces[atoms[term.p1]][i] -= force;
            forces[atoms[term.p2]][i] += force;
         }
     }
+    termDerivs += distanceTerms.size();
 
     // Apply forces based on angles.
 
     for (int i = 0; i < (int) angleTerms.size(); i++) {
         const AngleTermInfo& term = angleTerms[i];
-        double dEdTheta = term.forceExpression.evaluate(variables);
+        double dEdTheta = termDerivs[i];
         double thetaCross[ReferenceForce::LastDeltaRIndex];
         SimTKOpenMMUtilities::crossProductVector3(term.delta1, term.delta2, thetaCross);
         double lengthThetaCross = sqrt(DOT3(thetaCross, thetaCross));
@@ -241,11 +324,13 @@ void ReferenceCustomHbondIxn::calculateOneIxn(int donor, int acceptor, vector<Ve
         }
     }
 
+    termDerivs += angleTerms.size();
+
     // Apply forces based on dihedrals.
 
     for (int i = 0; i < (int) dihedralTerms.size(); i++) {
         const DihedralTermInfo& term = dihedralTerms[i];
-        double dEdTheta = term.forceExpression.evaluate(variables);
+        double dEdTheta = termDerivs[i];
         double internalF[4][3];
         double forceFactors[4];
         double normCross1 = DOT3(term.cross1, term.cross1);
@@ -271,11 +356,6 @@ void ReferenceCustomHbondIxn::calculateOneIxn(int donor, int acceptor, vector<Ve
             forces[atoms[term.p4]][i] += internalF[3][i];
         }
     }
-
-    // Add the energy
-
-    if (totalEnergy)
-        *totalEnergy += energyExpression.evaluate(variables);
 }
 
 void ReferenceCustomHbondIxn::computeDelta(int atom1, int atom2, double* delta, vector<Vec3>& atomCoordinates) const {
@@ -37,14 +37,10 @@ using namespace OpenMM;
 
    --------------------------------------------------------------------------------------- */
 
-ReferenceCustomTorsionIxn::ReferenceCustomTorsionIxn(const Lepton::CompiledExpression& energyExpression,
-        const Lepton::CompiledExpression& forceExpression, const vector<string>& parameterNames,
-        const vector<Lepton::CompiledExpression> energyParamDerivExpressions) :
-        energyExpression(energyExpression), forceExpression(forceExpression), usePeriodic(false), energyParamDerivExpressions(energyParamDerivExpressions) {
-    expressionSet.registerExpression(this->energyExpression);
-    expressionSet.registerExpression(this->forceExpression);
-    for (int i = 0; i < this->energyParamDerivExpressions.size(); i++)
-        expressionSet.registerExpression(this->energyParamDerivExpressions[i]);
+ReferenceCustomTorsionIxn::ReferenceCustomTorsionIxn(const Lepton::CompiledExpression& expression,
+        const vector<string>& parameterNames, int numEnergyParamDerivs) :
+        expression(expression), numEnergyParamDerivs(numEnergyParamDerivs), usePeriodic(false) {
+    expressionSet.registerExpression(this->expression);
     thetaIndex = expressionSet.getVariableIndex("theta");
     numParameters = parameterNames.size();
     for (auto& param : parameterNames)
@@ -128,7 +124,8 @@ void ReferenceCustomTorsionIxn::calculateBondIxn(vector<int>& atomIndices,
 
    // evaluate delta angle, dE/d(angle)
 
-   double dEdAngle = forceExpression.evaluate();
+   double energy = expression.evaluate();
+   double dEdAngle = expression.getValue(1);
 
    // compute force
 
@@ -169,12 +166,12 @@ void ReferenceCustomTorsionIxn::calculateBondIxn(vector<int>& atomIndices,
 
    // Record parameter derivatives.
 
-   for (int i = 0; i < energyParamDerivExpressions.size(); i++)
-       energyParamDerivs[i] += energyParamDerivExpressions[i].evaluate();
+   for (int i = 0; i < numEnergyParamDerivs; i++)
+       energyParamDerivs[i] += expression.getValue(i+2);
 
    // accumulate energies
 
    if (totalEnergy != NULL)
-       *totalEnergy += energyExpression.evaluate();
+       *totalEnergy += energy;
 }
 
@@ -48,7 +48,7 @@ using namespace OpenMM;
 
    --------------------------------------------------------------------------------------- */
 
-ReferenceLJCoulombIxn::ReferenceLJCoulombIxn() : cutoff(false), useSwitch(false), periodic(false), periodicExceptions(false), ewald(false), pme(false), ljpme(false) {
+ReferenceLJCoulombIxn::ReferenceLJCoulombIxn() : cutoff(false), useSwitch(false), periodic(false), periodicExceptions(false), ewald(false), pme(false), ljpme(false), threads(NULL) {
 }
 
 /**---------------------------------------------------------------------------------------
@@ -171,6 +171,10 @@ void ReferenceLJCoulombIxn::setPeriodicExceptions(bool periodic) {
     periodicExceptions = periodic;
 }
 
+void ReferenceLJCoulombIxn::setThreadPool(ThreadPool& threads) {
+    this->threads = &threads;
+}
+
 /**---------------------------------------------------------------------------------------
 
    Calculate Ewald ixn
@@ -246,6 +250,7 @@ void ReferenceLJCoulombIxn::calculateEwaldIxn(int numberOfAtoms, vector<Vec3>& a
         pme_t          pmedata; /* abstract handle for PME data */
 
         pme_init(&pmedata,alphaEwald,numberOfAtoms,meshDim,5,1);
+        pme_set_threads(pmedata, threads);
 
         vector<double> charges(numberOfAtoms);
         for (int i = 0; i < numberOfAtoms; i++)
@@ -260,6 +265,7 @@ void ReferenceLJCoulombIxn::calculateEwaldIxn(int numberOfAtoms, vector<Vec3>& a
         if (ljpme) {
             // Dispersion reciprocal space terms
             pme_init(&pmedata,alphaDispersionEwald,numberOfAtoms,dispersionMeshDim,5,1);
+            pme_set_threads(pmedata, threads);
 
             std::vector<Vec3> dpmeforces(numberOfAtoms);
             for (int i = 0; i < numberOfAtoms; i++)
@@ -33,10 +33,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <complex>
+#include <functional>
 
 #include "ReferencePME.h"
 #include "ReferenceForce.h"
 #include "SimTKOpenMMRealType.h"
+#include "openmm/internal/ThreadPool.h"
 
 #ifdef _MSC_VER
   #define POCKETFFT_NO_VECTORS
@@ -91,10 +93,48 @@ struct pme
      * the central cell, i.e., in this case we would assume all coordinates fall in -10 nm < x,y,z < 20 nm.
      */
 
+    int *        xbucketstart;         /* Array of length ngrid[0]+1. The atoms whose x grid index is i are
+                                        * xbucketatoms[xbucketstart[i]] ... xbucketatoms[xbucketstart[i+1]-1].
+                                        * Updated every step together with particleindex.
+                                        */
+    int *        xbucketatoms;         /* Array of length natoms, atom indices sorted by x grid index */
+
     double       epsilon_r;             /* Dielectric coefficient to use, typically 1.0 */
+
+    ThreadPool * threads;              /* Thread pool used to parallelize the calculation, or NULL to run serially */
 };
 
 
+/* Divide the range [0, n) into contiguous pieces and call task(start, end) for each one.
+ *
+ * If a thread pool has been set with pme_set_threads(), every thread processes one piece in parallel.
+ * Otherwise the whole range is processed on the calling thread.
+ */
+static void
+pme_parallel_for(pme_t pme, int n, const function<void(int, int)>& task)
+{
+    int numTasks = (pme->threads == NULL ? 1 : min(n, pme->threads->getNumThreads()));
+    if (numTasks <= 1)
+    {
+        task(0, n);
+        return;
+    }
+    pme->threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        if (threadIndex < numTasks)
+            task((int) ((long long) threadIndex*n/numTasks), (int) ((long long) (threadIndex+1)*n/numTasks));
+    });
+    pme->threads->waitForThreads();
+}
+
+
+/* Number of threads pocketfft should use for the 3D transforms. Zero lets pocketfft choose. */
+static size_t
+pme_fft_threads(pme_t pme)
+{
+    return (pme->threads == NULL ? 0 : pme->threads->getNumThreads());
+}
+
+
 /* Internal setup routines */
 
 
@@ -203,60 +243,84 @@ pme_update_grid_index_and_fraction(pme_t    pme,
                                    const Vec3 periodicBoxVectors[3],
                                    const Vec3 recipBoxVectors[3])
 {
-    int    i;
-    int    d;
-    double t;
-    int    ti;
-
-    for (i=0;i<pme->natoms;i++)
+    pme_parallel_for(pme, pme->natoms, [&] (int start, int end)
     {
-        /* Index calculation (Look mom, no conditionals!):
-         *
-         * Both for Cuda and modern CPUs it is nice to avoid conditionals, but we still need to apply periodic boundary conditions.
-         * Instead of having loops to add/subtract the box dimension, we do it this way:
-         *
-         * 1. First add the box size, to make sure this atom coordinate isnt -0.1 or something.
-         *    After this we assume all fractional box positions are *positive*.
-         *    The reason for this is that we always want to round coordinates _down_ to get
-         *    their grid index, and when taking the integer part of -3.4 we would get -3, not -4 as we want.
-         *    Since we anyway need the grid indices to fall in the central box, it is more convenient
-         *    to first manipulate the coordinates to be positive.
-         * 2. Convert to integer grid index
-         *    Since we have added a whole box unit in step 1, this index might actually be larger than
-         *    the grid dimension. Examples, assuming 10*10*10nm box and grid dimension 100*100*100 (spacing 0.1 nm):
-         *
-         *    coordinate is { 0.543 , 6.235 , -0.73 }
-         *
-         *    x[i][d]/box[d]                      becomes   { 0.0543 , 0.6235 , -0.073 }
-         *    (x[i][d]/box[d] + 1.0)              becomes   { 1.0543 , 1.6235 , 0.927 }
-         *    (x[i][d]/box[d] + 1.0)*ngrid[d]     becomes   { 105.43 , 162.35 , 92.7 }
-         *
-         *    integer part is now { 105 , 162 , 92 }
-         *
-         *    The fraction is calculates as t-ti, which becomes { 0.43 , 0.35 , 0.7 }
-         *
-         * 3. Take the first integer index part (which can be larger than the grid) modulo the grid dimension
-         *
-         *    Now we get { 5 , 62 , 92 }
-         *
-         *    Voila, both index and fraction, entirely without conditionals. The one limitation here is that
-         *    we only add one box length, so if the particle had a coordinate <=-10.0, we would be screwed.
-         *    In principle we can of course add 100.0, but that just moves the problem, it doesnt solve it.
-         *    In practice, MD programs will apply PBC to reset particles inside the central box to avoid
-         *    numerical problems, so this shouldnt cause any problems.
-         *    (And, by adding 100.0 box lengths, we would lose a bit of numerical accuracy here!)
-         */
-        Vec3 coord = atomCoordinates[i];
-        for (d=0;d<3;d++)
+        for (int i=start;i<end;i++)
         {
-            t = coord[0]*recipBoxVectors[0][d]+coord[1]*recipBoxVectors[1][d]+coord[2]*recipBoxVectors[2][d];
-            t = (t-floor(t))*pme->ngrid[d];
-            ti = (int) t;
+            /* Index calculation (Look mom, no conditionals!):
+             *
+             * Both for Cuda and modern CPUs it is nice to avoid conditionals, but we still need to apply periodic boundary conditions.
+             * Instead of having loops to add/subtract the box dimension, we do it this way:
+             *
+             * 1. First add the box size, to make sure this atom coordinate isnt -0.1 or something.
+             *    After this we assume all fractional box positions are *positive*.
+             *    The reason for this is that we always want to round coordinates _down_ to get
+             *    their grid index, and when taking the integer part of -3.4 we would get -3, not -4 as we want.
+             *    Since we anyway need the grid indices to fall in the central box, it is more convenient
+             *    to first manipulate the coordinates to be positive.
+             * 2. Convert to integer grid index
+             *    Since we have added a whole box unit in step 1, this index might actually be larger than
+             *    the grid dimension. Examples, assuming 10*10*10nm box and grid dimension 100*100*100 (spacing 0.1 nm):
+             *
+             *    coordinate is { 0.543 , 6.235 , -0.73 }
+             *
+             *    x[i][d]/box[d]                      becomes   { 0.0543 , 0.6235 , -0.073 }
+             *    (x[i][d]/box[d] + 1.0)              becomes   { 1.0543 , 1.6235 , 0.927 }
+             *    (x[i][d]/box[d] + 1.0)*ngrid[d]     becomes   { 105.43 , 162.35 , 92.7 }
+             *
+             *    integer part is now { 105 , 162 , 92 }
+             *
+             *    The fraction is calculates as t-ti, which becomes { 0.43 , 0.35 , 0.7 }
+             *
+             * 3. Take the first integer index part (which can be larger than the grid) modulo the grid dimension
+             *
+             *    Now we get { 5 , 62 , 92 }
+             *
+             *    Voila, both index and fraction, entirely without conditionals. The one limitation here is that
+             *    we only add one box length, so if the particle had a coordinate <=-10.0, we would be screwed.
+             *    In principle we can of course add 100.0, but that just moves the problem, it doesnt solve it.
+             *    In practice, MD programs will apply PBC to reset particles inside the central box to avoid
+             *    numerical problems, so this shouldnt cause any problems.
+             *    (And, by adding 100.0 box lengths, we would lose a bit of numerical accuracy here!)
+             */
+            Vec3 coord = atomCoordinates[i];
+            for (int d=0;d<3;d++)
+            {
+                double t = coord[0]*recipBoxVectors[0][d]+coord[1]*recipBoxVectors[1][d]+coord[2]*recipBoxVectors[2][d];
+                t = (t-floor(t))*pme->ngrid[d];
+                int ti = (int) t;
 
-            pme->particlefraction[i][d] = t - ti;
-            pme->particleindex[i][d]    = ti % pme->ngrid[d];
+                pme->particlefraction[i][d] = t - ti;
+                pme->particleindex[i][d]    = ti % pme->ngrid[d];
+            }
         }
+    });
+
+    /* Sort the atoms into buckets by x grid index (a counting sort), so the charge spreading can
+     * find the atoms that touch a given range of x planes without looping over all of them.
+     */
+    int nx = pme->ngrid[0];
+    for (int i=0;i<=nx;i++)
+    {
+        pme->xbucketstart[i] = 0;
+    }
+    for (int i=0;i<pme->natoms;i++)
+    {
+        pme->xbucketstart[pme->particleindex[i][0]+1]++;
     }
+    for (int i=0;i<nx;i++)
+    {
+        pme->xbucketstart[i+1] += pme->xbucketstart[i];
+    }
+    for (int i=0;i<pme->natoms;i++)
+    {
+        pme->xbucketatoms[pme->xbucketstart[pme->particleindex[i][0]]++] = i;
+    }
+    for (int i=nx;i>0;i--)
+    {
+        pme->xbucketstart[i] = pme->xbucketstart[i-1];
+    }
+    pme->xbucketstart[0] = 0;
 }
 
 
@@ -268,134 +332,144 @@ pme_update_grid_index_and_fraction(pme_t    pme,
 static void
 pme_update_bsplines(pme_t    pme)
 {
-    int       i,j,k,l;
-    int       order;
-    double    dr,div;
-    double *  data;
-    double *  ddata;
-
-    order = pme->order;
+    int order = pme->order;
 
-    for (i=0; (i<pme->natoms); i++)
+    pme_parallel_for(pme, pme->natoms, [&] (int start, int end)
     {
-        for (j=0; j<3; j++)
+        int       j,k,l;
+        double    dr,div;
+        double *  data;
+        double *  ddata;
+
+        for (int i=start; i<end; i++)
         {
-            /* dr is relative offset from lower cell limit */
-            dr = pme->particlefraction[i][j];
+            for (j=0; j<3; j++)
+            {
+                /* dr is relative offset from lower cell limit */
+                dr = pme->particlefraction[i][j];
 
-            data  = &(pme->bsplines_theta[j][i*order]);
-            ddata = &(pme->bsplines_dtheta[j][i*order]);
-            data[order-1] = 0;
-            data[1]       = dr;
-            data[0]       = 1-dr;
+                data  = &(pme->bsplines_theta[j][i*order]);
+                ddata = &(pme->bsplines_dtheta[j][i*order]);
+                data[order-1] = 0;
+                data[1]       = dr;
+                data[0]       = 1-dr;
 
-            for (k=3; k<order; k++)
-            {
-                div = 1.0/(k-1.0);
-                data[k-1] = div*dr*data[k-2];
-                for (l=1; l<(k-1); l++)
+                for (k=3; k<order; k++)
                 {
-                    data[k-l-1] = div*((dr+l)*data[k-l-2]+(k-l-dr)*data[k-l-1]);
+                    div = 1.0/(k-1.0);
+                    data[k-1] = div*dr*data[k-2];
+                    for (l=1; l<(k-1); l++)
+                    {
+                        data[k-l-1] = div*((dr+l)*data[k-l-2]+(k-l-dr)*data[k-l-1]);
+                    }
+                    data[0] = div*(1-dr)*data[0];
                 }
-                data[0] = div*(1-dr)*data[0];
-            }
 
-            /* differentiate */
-            ddata[0] = -data[0];
+                /* differentiate */
+                ddata[0] = -data[0];
 
-            for (k=1; k<order; k++)
-            {
-                ddata[k] = data[k-1]-data[k];
-            }
+                for (k=1; k<order; k++)
+                {
+                    ddata[k] = data[k-1]-data[k];
+                }
 
-            div           = 1.0/(order-1);
-            data[order-1] = div*dr*data[order-2];
+                div           = 1.0/(order-1);
+                data[order-1] = div*dr*data[order-2];
 
-            for (l=1; l<(order-1); l++)
-            {
-                data[order-l-1] = div*((dr+l)*data[order-l-2]+(order-l-dr)*data[order-l-1]);
+                for (l=1; l<(order-1); l++)
+                {
+                    data[order-l-1] = div*((dr+l)*data[order-l-2]+(order-l-dr)*data[order-l-1]);
+                }
+                data[0] = div*(1-dr)*data[0];
             }
-            data[0] = div*(1-dr)*data[0];
         }
-    }
+    });
 }
 
 
 static void
 pme_grid_spread_charge(pme_t pme, const vector<double>& charges)
 {
-    int       order;
-    int       i;
-    int       ix,iy,iz;
-    int       x0index,y0index,z0index;
-    int       xindex,yindex,zindex;
-    int       index;
-    double    q;
-    double *  thetax;
-    double *  thetay;
-    double *  thetaz;
+    int order = pme->order;
+    int nx    = pme->ngrid[0];
+    int ny    = pme->ngrid[1];
+    int nz    = pme->ngrid[2];
 
-    order = pme->order;
-
-    /* Reset the grid */
-    for (i=0;i<pme->ngrid[0]*pme->ngrid[1]*pme->ngrid[2];i++)
-    {
-        pme->grid[i] = complex<double>(0, 0);
-    }
-
-    for (i=0;i<pme->natoms;i++)
+    /* Each piece of work owns a contiguous slab of x planes [firstPlane, lastPlane) and is the only one
+     * that writes to it, so slabs can be processed in parallel without locks or private copies of the grid.
+     *
+     * As a neat optimization, we only spread in the forward direction, but apply PBC!
+     *
+     * Since we are going to do an FFT on the grid, it doesn't matter where the data is,
+     * in frequency space the result will be the same.
+     *
+     * So, the influence function (bsplines) will probably be something like (0.15,0.35,0.35,0.15),
+     * with largest weight 2-3 steps forward (you don't need to understand that for the implementation :-)
+     * Effectively, you can look at this as translating the entire grid.
+     *
+     * Why do we do this stupid thing?
+     *
+     * 1) The loops get much simpler
+     * 2) Just looking forward will hopefully get us more cache hits
+     * 3) When we parallelize things, we only need to communicate in one direction instead of two!
+     *
+     * Point 3 is what makes the slabs work: an atom with x grid index i only touches planes i ... i+order-1,
+     * so the atoms contributing to a slab are those in the x buckets firstPlane-order+1 ... lastPlane-1.
+     * Atoms are always visited in bucket order, so the result does not depend on the number of threads.
+     */
+    pme_parallel_for(pme, nx, [&] (int firstPlane, int lastPlane)
     {
-        q = charges[i];
-
-        /* Grid index for the actual atom position */
-        x0index = pme->particleindex[i][0];
-        y0index = pme->particleindex[i][1];
-        z0index = pme->particleindex[i][2];
-
-        /* Bspline factors for this atom in each dimension , calculated from fractional coordinates */
-        thetax  = &(pme->bsplines_theta[0][i*order]);
-        thetay  = &(pme->bsplines_theta[1][i*order]);
-        thetaz  = &(pme->bsplines_theta[2][i*order]);
-
-        /* Loop over norder*norder*norder (typically 5*5*5) neighbor cells.
-         *
-         * As a neat optimization, we only spread in the forward direction, but apply PBC!
-         *
-         * Since we are going to do an FFT on the grid, it doesn't matter where the data is,
-         * in frequency space the result will be the same.
-         *
-         * So, the influence function (bsplines) will probably be something like (0.15,0.35,0.35,0.15),
-         * with largest weight 2-3 steps forward (you don't need to understand that for the implementation :-)
-         * Effectively, you can look at this as translating the entire grid.
-         *
-         * Why do we do this stupid thing?
-         *
-         * 1) The loops get much simpler
-         * 2) Just looking forward will hopefully get us more cache hits
-         * 3) When we parallelize things, we only need to communicate in one direction instead of two!
-         */
-
-        for (ix=0;ix<order;ix++)
+        /* Reset this slab of the grid */
+        for (int i=firstPlane*ny*nz;i<lastPlane*ny*nz;i++)
         {
-            /* Calculate index, apply PBC so we spread to index 0/1/2 when a particle is close to the upper limit of the grid */
-            xindex = (x0index + ix) % pme->ngrid[0];
+            pme->grid[i] = complex<double>(0, 0);
+        }
 
-            for (iy=0;iy<order;iy++)
+        int numBuckets = min(lastPlane-firstPlane+order-1, nx);
+        for (int bucket=0;bucket<numBuckets;bucket++)
+        {
+            int x0index = ((firstPlane-order+1+bucket) % nx + nx) % nx;
+            for (int atom=pme->xbucketstart[x0index];atom<pme->xbucketstart[x0index+1];atom++)
             {
-                yindex = (y0index + iy) % pme->ngrid[1];
+                int i = pme->xbucketatoms[atom];
+                double q = charges[i];
+
+                /* Grid index for the actual atom position */
+                int y0index = pme->particleindex[i][1];
+                int z0index = pme->particleindex[i][2];
 
-                for (iz=0;iz<order;iz++)
+                /* Bspline factors for this atom in each dimension , calculated from fractional coordinates */
+                const double* thetax = &(pme->bsplines_theta[0][i*order]);
+                const double* thetay = &(pme->bsplines_theta[1][i*order]);
+                const double* thetaz = &(pme->bsplines_theta[2][i*order]);
+
+                /* Loop over norder*norder*norder (typically 5*5*5) neighbor cells, keeping only the planes in this slab */
+                for (int ix=0;ix<order;ix++)
                 {
-                    /* Can be optimized, but we keep it simple here */
-                    zindex            = (z0index + iz) % pme->ngrid[2];
-                    /* Calculate index in the charge grid */
-                    index             = xindex*pme->ngrid[1]*pme->ngrid[2] + yindex*pme->ngrid[2] + zindex;
-                    /* Add the charge times the bspline spread/interpolation factors to this grid position */
-                    pme->grid[index] += q*thetax[ix]*thetay[iy]*thetaz[iz];
+                    /* Calculate index, apply PBC so we spread to index 0/1/2 when a particle is close to the upper limit of the grid */
+                    int xindex = (x0index + ix) % nx;
+                    if (xindex < firstPlane || xindex >= lastPlane)
+                    {
+                        continue;
+                    }
+                    double qx = q*thetax[ix];
+
+                    for (int iy=0;iy<order;iy++)
+                    {
+                        int yindex = (y0index + iy) % ny;
+                        double qxy = qx*thetay[iy];
+                        complex<double>* row = pme->grid + xindex*ny*nz + yindex*nz;
+
+                        for (int iz=0;iz<order;iz++)
+                        {
+                            /* Add the charge times the bspline spread/interpolation factors to this grid position */
+                            row[(z0index + iz) % nz] += qxy*thetaz[iz];
+                        }
+                    }
                 }
             }
         }
-    }
+    });
 }
 
 
@@ -406,23 +480,12 @@ pme_reciprocal_convolution(pme_t     pme,
                            const Vec3 recipBoxVectors[3],
                            double *  energy)
 {
-    int kx,ky,kz;
     int nx,ny,nz;
-    double mx,my,mz;
-    double mhx,mhy,mhz,m2;
     double one_4pi_eps;
-    double virxx,virxy,virxz,viryy,viryz,virzz;
-    double bx,by,bz;
-    double d1,d2;
-    double eterm,vfactor,struct2,ets2;
-    double esum;
     double factor;
-    double denom;
     double boxfactor;
     double maxkx,maxky,maxkz;
 
-    complex<double> *ptr;
-
     nx = pme->ngrid[0];
     ny = pme->ngrid[1];
     nz = pme->ngrid[2];
@@ -431,75 +494,82 @@ pme_reciprocal_convolution(pme_t     pme,
     factor = M_PI*M_PI/(pme->ewaldcoeff*pme->ewaldcoeff);
     boxfactor = M_PI*periodicBoxVectors[0][0]*periodicBoxVectors[1][1]*periodicBoxVectors[2][2];
 
-    esum = 0;
-    virxx = 0;
-    virxy = 0;
-    virxz = 0;
-    viryy = 0;
-    viryz = 0;
-    virzz = 0;
-
     maxkx = (nx+1)/2;
     maxky = (ny+1)/2;
     maxkz = (nz+1)/2;
 
-    for (kx=0;kx<nx;kx++)
+    /* The x planes are independent, so they are processed in parallel. Each plane's energy is stored
+     * separately and summed in order at the end, so the result does not depend on the number of threads.
+     */
+    vector<double> planeEnergy(nx);
+    pme_parallel_for(pme, nx, [&] (int firstPlane, int lastPlane)
     {
-        /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
-        mx  = (kx<maxkx) ? kx : (kx-nx);
-        mhx = mx*recipBoxVectors[0][0];
-        bx  = boxfactor*pme->bsplines_moduli[0][kx];
-
-        for (ky=0;ky<ny;ky++)
+        for (int kx=firstPlane;kx<lastPlane;kx++)
         {
+            double esum = 0;
+
             /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
-            my  = (ky<maxky) ? ky : (ky-ny);
-            mhy = mx*recipBoxVectors[1][0]+my*recipBoxVectors[1][1];
-            by  = pme->bsplines_moduli[1][ky];
+            double mx  = (kx<maxkx) ? kx : (kx-nx);
+            double mhx = mx*recipBoxVectors[0][0];
+            double bx  = boxfactor*pme->bsplines_moduli[0][kx];
 
-            for (kz=0;kz<nz;kz++)
+            for (int ky=0;ky<ny;ky++)
             {
-                /* Pointer to the grid cell in question */
-                ptr       = pme->grid + kx*ny*nz + ky*nz + kz;
-
-                /* The zero frequency term is undefined due to division by the frequency below.  Set this term to zero;
-                 * in the case that the net charge of the system is non-zero, this is equivalent to applying a uniform
-                 * neutralizing background charge density.  The contribution to the energy and charge derivatives of
-                 * this neutralizing plasma is applied elsewhere.  If this term is not zeroed, however, energies and
-                 * forces will be unaffected but charge derivatives for non-neutral systems will be incorrect!
-                 */
-                if (kx==0 && ky==0 && kz==0)
-                {
-                    *ptr = 0;
-                    continue;
-                }
-
                 /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
-                mz        = (kz<maxkz) ? kz : (kz-nz);
-                mhz       = mx*recipBoxVectors[2][0]+my*recipBoxVectors[2][1]+mz*recipBoxVectors[2][2];
-
-                /* Get grid data for this frequency */
-                d1        = ptr->real();
-                d2        = ptr->imag();
+                double my  = (ky<maxky) ? ky : (ky-ny);
+                double mhy = mx*recipBoxVectors[1][0]+my*recipBoxVectors[1][1];
+                double by  = pme->bsplines_moduli[1][ky];
 
-                /* Calculate the convolution - see the Essman/Darden paper for the equation! */
-                m2        = mhx*mhx+mhy*mhy+mhz*mhz;
-                bz        = pme->bsplines_moduli[2][kz];
-                denom     = m2*bx*by*bz;
-
-                eterm     = one_4pi_eps*exp(-factor*m2)/denom;
-
-                /* write back convolution data to grid */
-                ptr->real(d1*eterm);
-                ptr->imag(d2*eterm);
-
-                struct2   = (d1*d1+d2*d2);
-
-                /* Long-range PME contribution to the energy for this frequency */
-                ets2      = eterm*struct2;
-                esum     += ets2;
+                for (int kz=0;kz<nz;kz++)
+                {
+                    /* Pointer to the grid cell in question */
+                    complex<double>* ptr = pme->grid + kx*ny*nz + ky*nz + kz;
+
+                    /* The zero frequency term is undefined due to division by the frequency below.  Set this term to zero;
+                     * in the case that the net charge of the system is non-zero, this is equivalent to applying a uniform
+                     * neutralizing background charge density.  The contribution to the energy and charge derivatives of
+                     * this neutralizing plasma is applied elsewhere.  If this term is not zeroed, however, energies and
+                     * forces will be unaffected but charge derivatives for non-neutral systems will be incorrect!
+                     */
+                    if (kx==0 && ky==0 && kz==0)
+                    {
+                        *ptr = 0;
+                        continue;
+                    }
+
+                    /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
+                    double mz     = (kz<maxkz) ? kz : (kz-nz);
+                    double mhz    = mx*recipBoxVectors[2][0]+my*recipBoxVectors[2][1]+mz*recipBoxVectors[2][2];
+
+                    /* Get grid data for this frequency */
+                    double d1     = ptr->real();
+                    double d2     = ptr->imag();
+
+                    /* Calculate the convolution - see the Essman/Darden paper for the equation! */
+                    double m2     = mhx*mhx+mhy*mhy+mhz*mhz;
+                    double bz     = pme->bsplines_moduli[2][kz];
+                    double denom  = m2*bx*by*bz;
+
+                    double eterm  = one_4pi_eps*exp(-factor*m2)/denom;
+
+                    /* write back convolution data to grid */
+                    ptr->real(d1*eterm);
+                    ptr->imag(d2*eterm);
+
+                    double struct2 = (d1*d1+d2*d2);
+
+                    /* Long-range PME contribution to the energy for this frequency */
+                    esum += eterm*struct2;
+                }
             }
+            planeEnergy[kx] = esum;
         }
+    });
+
+    double esum = 0;
+    for (int kx=0;kx<nx;kx++)
+    {
+        esum += planeEnergy[kx];
     }
 
     /* The factor 0.5 is nothing special, but it is better to have it here than inside the loop :-) */
@@ -513,28 +583,16 @@ dpme_reciprocal_convolution(pme_t pme,
                            const Vec3 recipBoxVectors[3],
                            double* energy)
 {
-    int kx,ky,kz;
     int nx,ny,nz;
-    double mx,my,mz;
-    double mhx,mhy,mhz,m2;
-    double bx,by,bz;
-    double d1,d2;
-    double eterm,struct2,ets2;
-    double esum;
-    double denom;
     double boxfactor;
     double maxkx,maxky,maxkz;
 
-    complex<double> *ptr;
-
     nx = pme->ngrid[0];
     ny = pme->ngrid[1];
     nz = pme->ngrid[2];
 
     boxfactor = -2*M_PI*sqrt(M_PI) / (6.0*periodicBoxVectors[0][0]*periodicBoxVectors[1][1]*periodicBoxVectors[2][2]);
 
-    esum = 0;
-
     maxkx = (nx+1)/2;
     maxky = (ny+1)/2;
     maxkz = (nz+1)/2;
@@ -543,65 +601,78 @@ dpme_reciprocal_convolution(pme_t pme,
     double fac1 = 2.0*M_PI*M_PI*M_PI*sqrt(M_PI);
     double fac2 = pme->ewaldcoeff*pme->ewaldcoeff*pme->ewaldcoeff;
     double fac3 = -2.0*pme->ewaldcoeff*M_PI*M_PI;
-    double b, m, m3, expfac, expterm, erfcterm;
 
-    for (kx=0;kx<nx;kx++)
+    /* See pme_reciprocal_convolution() for how the work is divided between threads */
+    vector<double> planeEnergy(nx);
+    pme_parallel_for(pme, nx, [&] (int firstPlane, int lastPlane)
     {
-        /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
-        mx  = ((kx<maxkx) ? kx : (kx-nx));
-        mhx = mx*recipBoxVectors[0][0];
-        bx  = pme->bsplines_moduli[0][kx];
-
-        for (ky=0;ky<ny;ky++)
+        for (int kx=firstPlane;kx<lastPlane;kx++)
         {
+            double esum = 0;
+
             /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
-            my  = ((ky<maxky) ? ky : (ky-ny));
-            mhy = mx*recipBoxVectors[1][0]+my*recipBoxVectors[1][1];
-            by  = pme->bsplines_moduli[1][ky];
+            double mx  = ((kx<maxkx) ? kx : (kx-nx));
+            double mhx = mx*recipBoxVectors[0][0];
+            double bx  = pme->bsplines_moduli[0][kx];
 
-            for (kz=0;kz<nz;kz++)
+            for (int ky=0;ky<ny;ky++)
             {
-                /*
-                 * Unlike the Coulombic case, there's an m=0 term so all terms are considered here.
-                 */
-
                 /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
-                mz        = ((kz<maxkz) ? kz : (kz-nz));
-                mhz       = mx*recipBoxVectors[2][0]+my*recipBoxVectors[2][1]+mz*recipBoxVectors[2][2];
+                double my  = ((ky<maxky) ? ky : (ky-ny));
+                double mhy = mx*recipBoxVectors[1][0]+my*recipBoxVectors[1][1];
+                double by  = pme->bsplines_moduli[1][ky];
+
+                for (int kz=0;kz<nz;kz++)
+                {
+                    /*
+                     * Unlike the Coulombic case, there's an m=0 term so all terms are considered here.
+                     */
 
-                /* Pointer to the grid cell in question */
-                ptr       = pme->grid + kx*ny*nz + ky*nz + kz;
+                    /* Calculate frequency. Grid indices in the upper half correspond to negative frequencies! */
+                    double mz     = ((kz<maxkz) ? kz : (kz-nz));
+                    double mhz    = mx*recipBoxVectors[2][0]+my*recipBoxVectors[2][1]+mz*recipBoxVectors[2][2];
 
-                /* Get grid data for this frequency */
-                d1        = ptr->real();
-                d2        = ptr->imag();
+                    /* Pointer to the grid cell in question */
+                    complex<double>* ptr = pme->grid + kx*ny*nz + ky*nz + kz;
 
-                /* Calculate the convolution - see the Essman/Darden paper for the equation! */
-                m2        = mhx*mhx+mhy*mhy+mhz*mhz;
-                bz        = pme->bsplines_moduli[2][kz];
-                denom     = boxfactor / (bx*by*bz);
+                    /* Get grid data for this frequency */
+                    double d1     = ptr->real();
+                    double d2     = ptr->imag();
 
-                m = sqrt(m2);
-                m3 = m*m2;
-                b = bfac*m;
-                expfac = -b*b;
-                erfcterm = erfc(b);
-                expterm = exp(expfac);
+                    /* Calculate the convolution - see the Essman/Darden paper for the equation! */
+                    double m2     = mhx*mhx+mhy*mhy+mhz*mhz;
+                    double bz     = pme->bsplines_moduli[2][kz];
+                    double denom  = boxfactor / (bx*by*bz);
 
-                eterm     = (fac1*erfcterm*m3 + expterm*(fac2 + fac3*m2)) * denom;
+                    double m = sqrt(m2);
+                    double m3 = m*m2;
+                    double b = bfac*m;
+                    double expfac = -b*b;
+                    double erfcterm = erfc(b);
+                    double expterm = exp(expfac);
 
-                /* write back convolution data to grid */
-                ptr->real(d1*eterm);
-                ptr->imag(d2*eterm);
+                    double eterm  = (fac1*erfcterm*m3 + expterm*(fac2 + fac3*m2)) * denom;
 
-                struct2   = (d1*d1+d2*d2);
+                    /* write back convolution data to grid */
+                    ptr->real(d1*eterm);
+                    ptr->imag(d2*eterm);
 
-                /* Long-range PME contribution to the energy for this frequency */
-                ets2      = eterm*struct2;
-                esum     += ets2;
+                    double struct2 = (d1*d1+d2*d2);
+
+                    /* Long-range PME contribution to the energy for this frequency */
+                    esum += eterm*struct2;
+                }
             }
+            planeEnergy[kx] = esum;
         }
+    });
+
+    double esum = 0;
+    for (int kx=0;kx<nx;kx++)
+    {
+        esum += planeEnergy[kx];
     }
+
     // Remember the C6 energy is attractive, hence the negative sign.
     *energy = 0.5*esum;
 }
@@ -613,23 +684,7 @@ pme_grid_interpolate_force(pme_t pme,
                            const vector<double>& charges,
                            vector<Vec3>& forces)
 {
-    int       i;
-    int       ix,iy,iz;
-    int       x0index,y0index,z0index;
-    int       xindex,yindex,zindex;
-    int       index;
     int       order;
-    double    q;
-    double *  thetax;
-    double *  thetay;
-    double *  thetaz;
-    double *  dthetax;
-    double *  dthetay;
-    double *  dthetaz;
-    double    tx,ty,tz;
-    double    dtx,dty,dtz;
-    double    fx,fy,fz;
-    double    gridvalue;
     int       nx,ny,nz;
 
     nx    = pme->ngrid[0];
@@ -638,71 +693,91 @@ pme_grid_interpolate_force(pme_t pme,
 
     order = pme->order;
 
-    /* This is almost identical to the charge spreading routine! */
-
-    for (i=0;i<pme->natoms;i++)
+    /* This is almost identical to the charge spreading routine, except that each atom only
+     * writes its own force, so the atoms can simply be divided between threads.
+     */
+    pme_parallel_for(pme, pme->natoms, [&] (int start, int end)
     {
-        fx = fy = fz = 0;
-
-        q = charges[i];
+        int       ix,iy,iz;
+        int       x0index,y0index,z0index;
+        int       xindex,yindex,zindex;
+        int       index;
+        double    q;
+        double *  thetax;
+        double *  thetay;
+        double *  thetaz;
+        double *  dthetax;
+        double *  dthetay;
+        double *  dthetaz;
+        double    tx,ty,tz;
+        double    dtx,dty,dtz;
+        double    fx,fy,fz;
+        double    gridvalue;
+
+        for (int i=start;i<end;i++)
+        {
+            fx = fy = fz = 0;
 
-        /* Grid index for the actual atom position */
-        x0index = pme->particleindex[i][0];
-        y0index = pme->particleindex[i][1];
-        z0index = pme->particleindex[i][2];
+            q = charges[i];
 
-        /* Bspline factors for this atom in each dimension , calculated from fractional coordinates */
-        thetax  = &(pme->bsplines_theta[0][i*order]);
-        thetay  = &(pme->bsplines_theta[1][i*order]);
-        thetaz  = &(pme->bsplines_theta[2][i*order]);
-        dthetax = &(pme->bsplines_dtheta[0][i*order]);
-        dthetay = &(pme->bsplines_dtheta[1][i*order]);
-        dthetaz = &(pme->bsplines_dtheta[2][i*order]);
+            /* Grid index for the actual atom position */
+            x0index = pme->particleindex[i][0];
+            y0index = pme->particleindex[i][1];
+            z0index = pme->particleindex[i][2];
 
-        /* See pme_grid_spread_charge() for comments about the order here, and only interpolation in one direction */
+            /* Bspline factors for this atom in each dimension , calculated from fractional coordinates */
+            thetax  = &(pme->bsplines_theta[0][i*order]);
+            thetay  = &(pme->bsplines_theta[1][i*order]);
+            thetaz  = &(pme->bsplines_theta[2][i*order]);
+            dthetax = &(pme->bsplines_dtheta[0][i*order]);
+            dthetay = &(pme->bsplines_dtheta[1][i*order]);
+            dthetaz = &(pme->bsplines_dtheta[2][i*order]);
 
-        /* Since we will add order^3 (typically 5*5*5=125) terms to the force on each particle, we use temporary fx/fy/fz
-         * variables, and only add it to memory forces[] at the end.
-         */
-        for (ix=0;ix<order;ix++)
-        {
-            xindex = (x0index + ix) % pme->ngrid[0];
-            /* Get both the bspline factor and its derivative with respect to the x coordinate! */
-            tx     = thetax[ix];
-            dtx    = dthetax[ix];
+            /* See pme_grid_spread_charge() for comments about the order here, and only interpolation in one direction */
 
-            for (iy=0;iy<order;iy++)
+            /* Since we will add order^3 (typically 5*5*5=125) terms to the force on each particle, we use temporary fx/fy/fz
+             * variables, and only add it to memory forces[] at the end.
+             */
+            for (ix=0;ix<order;ix++)
             {
-                yindex = (y0index + iy) % pme->ngrid[1];
-                /* bspline + derivative wrt y */
-                ty     = thetay[iy];
-                dty    = dthetay[iy];
+                xindex = (x0index + ix) % pme->ngrid[0];
+                /* Get both the bspline factor and its derivative with respect to the x coordinate! */
+                tx     = thetax[ix];
+                dtx    = dthetax[ix];
 
-                for (iz=0;iz<order;iz++)
+                for (iy=0;iy<order;iy++)
                 {
-                    /* Can be optimized, but we keep it simple here */
-                    zindex               = (z0index + iz) % pme->ngrid[2];
-                    /* bspline + derivative wrt z */
-                    tz                   = thetaz[iz];
-                    dtz                  = dthetaz[iz];
-                    index                = xindex*pme->ngrid[1]*pme->ngrid[2] + yindex*pme->ngrid[2] + zindex;
-
-                    /* Get the fft+convoluted+ifft:d data from the grid, which must be real by definition */
-                    /* Checking that the imaginary part is indeed zero might be a good check :-) */
-                    gridvalue            = pme->grid[index].real();
-
-                    /* The d component of the force is calculated by taking the derived bspline in dimension d, normal bsplines in the other two */
-                    fx                  += dtx*ty*tz*gridvalue;
-                    fy                  += tx*dty*tz*gridvalue;
-                    fz                  += tx*ty*dtz*gridvalue;
+                    yindex = (y0index + iy) % pme->ngrid[1];
+                    /* bspline + derivative wrt y */
+                    ty     = thetay[iy];
+                    dty    = dthetay[iy];
+
+                    for (iz=0;iz<order;iz++)
+                    {
+                        /* Can be optimized, but we keep it simple here */
+                        zindex               = (z0index + iz) % pme->ngrid[2];
+                        /* bspline + derivative wrt z */
+                        tz                   = thetaz[iz];
+                        dtz                  = dthetaz[iz];
+                        index                = xindex*pme->ngrid[1]*pme->ngrid[2] + yindex*pme->ngrid[2] + zindex;
+
+                        /* Get the fft+convoluted+ifft:d data from the grid, which must be real by definition */
+                        /* Checking that the imaginary part is indeed zero might be a good check :-) */
+                        gridvalue            = pme->grid[index].real();
+
+                        /* The d component of the force is calculated by taking the derived bspline in dimension d, normal bsplines in the other two */
+                        fx                  += dtx*ty*tz*gridvalue;
+                        fy                  += tx*dty*tz*gridvalue;
+                        fz                  += tx*ty*dtz*gridvalue;
+                    }
                 }
             }
+            /* Update memory force, note that we multiply by charge and some box stuff */
+            forces[i][0] -= q*(fx*nx*recipBoxVectors[0][0]);
+            forces[i][1] -= q*(fx*nx*recipBoxVectors[1][0]+fy*ny*recipBoxVectors[1][1]);
+            forces[i][2] -= q*(fx*nx*recipBoxVectors[2][0]+fy*ny*recipBoxVectors[2][1]+fz*nz*recipBoxVectors[2][2]);
         }
-        /* Update memory force, note that we multiply by charge and some box stuff */
-        forces[i][0] -= q*(fx*nx*recipBoxVectors[0][0]);
-        forces[i][1] -= q*(fx*nx*recipBoxVectors[1][0]+fy*ny*recipBoxVectors[1][1]);
-        forces[i][2] -= q*(fx*nx*recipBoxVectors[2][0]+fy*ny*recipBoxVectors[2][1]+fz*nz*recipBoxVectors[2][2]);
-    }
+    });
 }
 
 
@@ -713,85 +788,85 @@ pme_grid_interpolate_charge_derivatives(pme_t pme,
                                         vector<double>& chargeDerivatives,
                                         const vector<int>& chargeIndices)
 {
-    int       nderiv, ideriv, i;
-    int       ix,iy,iz;
-    int       x0index,y0index,z0index;
-    int       xindex,yindex,zindex;
-    int       index;
+    int       nderiv;
     int       order;
-    double    q;
-    double *  thetax;
-    double *  thetay;
-    double *  thetaz;
-    double    tx,ty,tz;
-    double    dq;
-    double    gridvalue;
-    int       nx,ny,nz;
-
-    nx    = pme->ngrid[0];
-    ny    = pme->ngrid[1];
-    nz    = pme->ngrid[2];
 
     order = pme->order;
 
     /* This is similar to pme_grid_interpolate_force() */
-    
+
     nderiv = chargeIndices.size();
-    for (ideriv=0;ideriv<nderiv;ideriv++)
+    pme_parallel_for(pme, nderiv, [&] (int start, int end)
     {
-        i = chargeIndices[ideriv];
-        dq = 0;
-
-        q = charges[i];
+        int       i;
+        int       ix,iy,iz;
+        int       x0index,y0index,z0index;
+        int       xindex,yindex,zindex;
+        int       index;
+        double    q;
+        double *  thetax;
+        double *  thetay;
+        double *  thetaz;
+        double    tx,ty,tz;
+        double    dq;
+        double    gridvalue;
+
+        for (int ideriv=start;ideriv<end;ideriv++)
+        {
+            i = chargeIndices[ideriv];
+            dq = 0;
 
-        /* Grid index for the actual atom position */
-        x0index = pme->particleindex[i][0];
-        y0index = pme->particleindex[i][1];
-        z0index = pme->particleindex[i][2];
+            q = charges[i];
 
-        /* Bspline factors for this atom in each dimension , calculated from fractional coordinates */
-        thetax  = &(pme->bsplines_theta[0][i*order]);
-        thetay  = &(pme->bsplines_theta[1][i*order]);
-        thetaz  = &(pme->bsplines_theta[2][i*order]);
+            /* Grid index for the actual atom position */
+            x0index = pme->particleindex[i][0];
+            y0index = pme->particleindex[i][1];
+            z0index = pme->particleindex[i][2];
 
-        /* See pme_grid_spread_charge() for comments about the order here, and only interpolation in one direction */
+            /* Bspline factors for this atom in each dimension , calculated from fractional coordinates */
+            thetax  = &(pme->bsplines_theta[0][i*order]);
+            thetay  = &(pme->bsplines_theta[1][i*order]);
+            thetaz  = &(pme->bsplines_theta[2][i*order]);
 
-        /* Since we will add order^3 (typically 5*5*5=125) terms to the charge
-         * derivative on each particle, we use a temporary dq variable, and only
-         * add it to memory forces[] at the end.
-         */
-        for (ix=0;ix<order;ix++)
-        {
-            xindex = (x0index + ix) % pme->ngrid[0];
-            /* Get the bspline factor with respect to the x coordinate */
-            tx     = thetax[ix];
+            /* See pme_grid_spread_charge() for comments about the order here, and only interpolation in one direction */
 
-            for (iy=0;iy<order;iy++)
+            /* Since we will add order^3 (typically 5*5*5=125) terms to the charge
+             * derivative on each particle, we use a temporary dq variable, and only
+             * add it to memory forces[] at the end.
+             */
+            for (ix=0;ix<order;ix++)
             {
-                yindex = (y0index + iy) % pme->ngrid[1];
-                /* bspline wrt y */
-                ty     = thetay[iy];
+                xindex = (x0index + ix) % pme->ngrid[0];
+                /* Get the bspline factor with respect to the x coordinate */
+                tx     = thetax[ix];
 
-                for (iz=0;iz<order;iz++)
+                for (iy=0;iy<order;iy++)
                 {
-                    /* Can be optimized, but we keep it simple here */
-                    zindex    = (z0index + iz) % pme->ngrid[2];
-                    /* bspline wrt z */
-                    tz        = thetaz[iz];
-                    index     = xindex*pme->ngrid[1]*pme->ngrid[2] + yindex*pme->ngrid[2] + zindex;
-
-                    /* Get the fft+convoluted+ifft:d data from the grid, which must be real by definition */
-                    /* Checking that the imaginary part is indeed zero might be a good check :-) */
-                    gridvalue = pme->grid[index].real();
-
-                    /* The d component of the force is calculated by taking the derived bspline in dimension d, normal bsplines in the other two */
-                    dq       += tx*ty*tz*gridvalue;
+                    yindex = (y0index + iy) % pme->ngrid[1];
+                    /* bspline wrt y */
+                    ty     = thetay[iy];
+
+                    for (iz=0;iz<order;iz++)
+                    {
+                        /* Can be optimized, but we keep it simple here */
+                        zindex    = (z0index + iz) % pme->ngrid[2];
+                        /* bspline wrt z */
+                        tz        = thetaz[iz];
+                        index     = xindex*pme->ngrid[1]*pme->ngrid[2] + yindex*pme->ngrid[2] + zindex;
+
+                        /* Get the fft+convoluted+ifft:d data from the grid, which must be real by definition */
+                        /* Checking that the imaginary part is indeed zero might be a good check :-) */
+                        gridvalue = pme->grid[index].real();
+
+                        /* The d component of the force is calculated by taking the derived bspline in dimension d, normal bsplines in the other two */
+                        dq       += tx*ty*tz*gridvalue;
+                    }
                 }
             }
-        }
 
-        chargeDerivatives[ideriv] += dq;
-    }
+            chargeDerivatives[ideriv] += dq;
+        }
+    });
 }
 
 
@@ -825,6 +900,11 @@ pme_init(pme_t *       ppme,
 
     pme->particlefraction = (rvec *)malloc(sizeof(rvec)*natoms);
     pme->particleindex    = (ivec *)malloc(sizeof(ivec)*natoms);
+    pme->xbucketstart     = (int *)malloc(sizeof(int)*(ngrid[0]+1));
+    pme->xbucketatoms     = (int *)malloc(sizeof(int)*natoms);
+
+    /* Run serially unless a thread pool is provided with pme_set_threads() */
+    pme->threads          = NULL;
 
     /* Allocate charge grid storage */
     pme->grid        = (complex<double> *)malloc(sizeof(complex<double>)*ngrid[0]*ngrid[1]*ngrid[2]);
@@ -839,6 +919,13 @@ pme_init(pme_t *       ppme,
 
 
 
+int
+pme_set_threads(pme_t pme, ThreadPool* threads)
+{
+    pme->threads = threads;
+
+    return 0;
+}
 
 
 int pme_exec(pme_t       pme,
@@ -875,13 +962,13 @@ int pme_exec(pme_t       pme,
     vector<ptrdiff_t> stride = {(ptrdiff_t) (pme->ngrid[1]*pme->ngrid[2]*sizeof(complex<double>)),
                                 (ptrdiff_t) (pme->ngrid[2]*sizeof(complex<double>)),
                                 (ptrdiff_t) sizeof(complex<double>)};
-    pocketfft::c2c(shape, stride, stride, axes, true, pme->grid, pme->grid, 1.0, 0);
+    pocketfft::c2c(shape, stride, stride, axes, true, pme->grid, pme->grid, 1.0, pme_fft_threads(pme));
 
     /* solve in k-space */
     pme_reciprocal_convolution(pme,periodicBoxVectors,recipBoxVectors,energy);
 
     /* do 3d-invfft */
-    pocketfft::c2c(shape, stride, stride, axes, false, pme->grid, pme->grid, 1.0, 0);
+    pocketfft::c2c(shape, stride, stride, axes, false, pme->grid, pme->grid, 1.0, pme_fft_threads(pme));
 
     /* Get the particle forces from the grid and bsplines in the pme structure */
     pme_grid_interpolate_force(pme,recipBoxVectors,charges,forces);
@@ -924,14 +1011,14 @@ int pme_exec_charge_derivatives(pme_t pme,
     vector<ptrdiff_t> stride = {(ptrdiff_t) (pme->ngrid[1]*pme->ngrid[2]*sizeof(complex<double>)),
                                 (ptrdiff_t) (pme->ngrid[2]*sizeof(complex<double>)),
                                 (ptrdiff_t) sizeof(complex<double>)};
-    pocketfft::c2c(shape, stride, stride, axes, true, pme->grid, pme->grid, 1.0, 0);
+    pocketfft::c2c(shape, stride, stride, axes, true, pme->grid, pme->grid, 1.0, pme_fft_threads(pme));
 
     /* solve in k-space */
     double energy;
     pme_reciprocal_convolution(pme,periodicBoxVectors,recipBoxVectors,&energy);
 
     /* do 3d-invfft */
-    pocketfft::c2c(shape, stride, stride, axes, false, pme->grid, pme->grid, 1.0, 0);
+    pocketfft::c2c(shape, stride, stride, axes, false, pme->grid, pme->grid, 1.0, pme_fft_threads(pme));
 
     /* Get the charge derivatives from the grid and bsplines in the pme structure */
     pme_grid_interpolate_charge_derivatives(pme,recipBoxVectors,charges,chargeDerivatives,chargeIndices);
@@ -974,13 +1061,13 @@ int pme_exec_dpme(pme_t       pme,
     vector<ptrdiff_t> stride = {(ptrdiff_t) (pme->ngrid[1]*pme->ngrid[2]*sizeof(complex<double>)),
                                 (ptrdiff_t) (pme->ngrid[2]*sizeof(complex<double>)),
                                 (ptrdiff_t) sizeof(complex<double>)};
-    pocketfft::c2c(shape, stride, stride, axes, true, pme->grid, pme->grid, 1.0, 0);
+    pocketfft::c2c(shape, stride, stride, axes, true, pme->grid, pme->grid, 1.0, pme_fft_threads(pme));
 
     /* solve in k-space */
     dpme_reciprocal_convolution(pme,periodicBoxVectors,recipBoxVectors,energy);
 
     /* do 3d-invfft */
-    pocketfft::c2c(shape, stride, stride, axes, false, pme->grid, pme->grid, 1.0, 0);
+    pocketfft::c2c(shape, stride, stride, axes, false, pme->grid, pme->grid, 1.0, pme_fft_threads(pme));
 
     /* Get the particle forces from the grid and bsplines in the pme structure */
     pme_grid_interpolate_force(pme,recipBoxVectors,c6s,forces);
@@ -1005,6 +1092,8 @@ pme_destroy(pme_t    pme)
 
     free(pme->particlefraction);
     free(pme->particleindex);
+    free(pme->xbucketstart);
+    free(pme->xbucketatoms);
 
     /* destroy structure itself */
     free(pme);
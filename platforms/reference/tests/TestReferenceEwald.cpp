@@ -30,6 +30,8 @@
 #include "ReferenceTests.h"
 #include "TestEwald.h"
 #include "ReferencePME.h"
+#include "openmm/internal/ThreadPool.h"
+#include "sfmt/SFMT.h"
 
 void testReferencePmeDerivatives() {
     // Ensures that derivatives reported by the reference PME implementation
@@ -108,6 +110,62 @@ void testReferencePmeDerivatives() {
     pme_destroy(pme);
 }
 
+void testReferencePmeThreads() {
+    // Running PME on a thread pool should give the same results as running it serially,
+    // including for grids with fewer planes per thread than the interpolation order.
+
+    Vec3 boxVectors[3] = {
+        Vec3(4, 0, 0),
+        Vec3(-1, 4.5, 0),
+        Vec3(1.5, 1, 5)
+    };
+    int numParticles = 1000;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions(numParticles);
+    vector<double> charges(numParticles), c6s(numParticles);
+    vector<int> indices;
+    for (int i = 0; i < numParticles; i++) {
+        positions[i] = boxVectors[0]*genrand_real2(sfmt) + boxVectors[1]*genrand_real2(sfmt) + boxVectors[2]*genrand_real2(sfmt);
+        charges[i] = genrand_real2(sfmt)-0.5;
+        c6s[i] = genrand_real2(sfmt);
+        if (i%3 == 0)
+            indices.push_back(i);
+    }
+    int gridSizes[2][3] = {{36, 40, 45}, {7, 12, 10}};
+    for (auto& gridSize : gridSizes) {
+        pme_t pme;
+        pme_init(&pme, 3.0, numParticles, gridSize, 5, 1);
+        double expectedEnergy, expectedDispersionEnergy;
+        vector<Vec3> expectedForces(numParticles), expectedDispersionForces(numParticles);
+        vector<double> expectedDerivatives(indices.size());
+        pme_exec(pme, positions, expectedForces, charges, boxVectors, &expectedEnergy);
+        pme_exec_dpme(pme, positions, expectedDispersionForces, c6s, boxVectors, &expectedDispersionEnergy);
+        pme_exec_charge_derivatives(pme, positions, expectedDerivatives, indices, charges, boxVectors);
+        for (int numThreads : {3, 4}) {
+            ThreadPool threads(numThreads);
+            pme_set_threads(pme, &threads);
+            double energy, dispersionEnergy;
+            vector<Vec3> forces(numParticles), dispersionForces(numParticles);
+            vector<double> derivatives(indices.size());
+            pme_exec(pme, positions, forces, charges, boxVectors, &energy);
+            pme_exec_dpme(pme, positions, dispersionForces, c6s, boxVectors, &dispersionEnergy);
+            pme_exec_charge_derivatives(pme, positions, derivatives, indices, charges, boxVectors);
+            pme_set_threads(pme, NULL);
+            ASSERT_EQUAL_TOL(expectedEnergy, energy, 1e-10);
+            ASSERT_EQUAL_TOL(expectedDispersionEnergy, dispersionEnergy, 1e-10);
+            for (int i = 0; i < numParticles; i++) {
+                ASSERT_EQUAL_VEC(expectedForces[i], forces[i], 1e-10);
+                ASSERT_EQUAL_VEC(expectedDispersionForces[i], dispersionForces[i], 1e-10);
+            }
+            for (int i = 0; i < indices.size(); i++)
+                ASSERT_EQUAL_TOL(expectedDerivatives[i], derivatives[i], 1e-10);
+        }
+        pme_destroy(pme);
+    }
+}
+
 void runPlatformTests() {
     testReferencePmeDerivatives();
+    testReferencePmeThreads();
 }
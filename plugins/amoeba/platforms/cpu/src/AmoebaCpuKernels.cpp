@@ -0,0 +1,84 @@
+/* -------------------------------------------------------------------------- *
+ *                              OpenMMAmoeba                                  *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as published   *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.      *
+ * -------------------------------------------------------------------------- */
+
+#include "AmoebaCpuKernels.h"
+#include "ReferencePlatform.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/AmoebaVdwForceImpl.h"
+#include "openmm/internal/ContextImpl.h"
+
+using namespace OpenMM;
+using namespace std;
+
+static vector<Vec3>& extractPositions(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return *data->positions;
+}
+
+static Vec3* extractBoxVectors(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return data->periodicBoxVectors;
+}
+
+/* -------------------------------------------------------------------------- *
+ *                                AmoebaVdw                                   *
+ * -------------------------------------------------------------------------- */
+
+CpuCalcAmoebaVdwForceKernel::~CpuCalcAmoebaVdwForceKernel() {
+    if (ixn != NULL)
+        delete ixn;
+}
+
+void CpuCalcAmoebaVdwForceKernel::initialize(const System& system, const AmoebaVdwForce& force) {
+    numParticles = force.getNumParticles();
+    usePeriodic = (force.getNonbondedMethod() == AmoebaVdwForce::CutoffPeriodic);
+    cutoff = force.getCutoffDistance();
+    dispersionCoefficient = force.getUseDispersionCorrection() ? AmoebaVdwForceImpl::calcDispersionCorrection(system, force) : 0.0;
+    ixn = new CpuAmoebaVdwForce(force);
+    data.isPeriodic |= usePeriodic;
+}
+
+double CpuCalcAmoebaVdwForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    Vec3* boxVectors = extractBoxVectors(context);
+    if (usePeriodic) {
+        double minAllowedSize = 1.999999*cutoff;
+        if (boxVectors[0][0] < minAllowedSize || boxVectors[1][1] < minAllowedSize || boxVectors[2][2] < minAllowedSize)
+            throw OpenMMException("The periodic box size has decreased to less than twice the cutoff.");
+    }
+    double lambda = context.getParameter(AmoebaVdwForce::Lambda());
+    double energy = ixn->calculateForce(extractPositions(context), data.threadForce, boxVectors, lambda, data.threads);
+    if (usePeriodic)
+        energy += dispersionCoefficient/(boxVectors[0][0]*boxVectors[1][1]*boxVectors[2][2]);
+    return energy;
+}
+
+void CpuCalcAmoebaVdwForceKernel::copyParametersToContext(ContextImpl& context, const AmoebaVdwForce& force) {
+    if (numParticles != force.getNumParticles())
+        throw OpenMMException("updateParametersInContext: The number of particles has changed");
+    delete ixn;
+    ixn = NULL;
+    ixn = new CpuAmoebaVdwForce(force);
+    if (force.getUseDispersionCorrection())
+        dispersionCoefficient = AmoebaVdwForceImpl::calcDispersionCorrection(context.getSystem(), force);
+}
@@ -0,0 +1,77 @@
+#ifndef AMOEBA_OPENMM_CPU_KERNELS_H_
+#define AMOEBA_OPENMM_CPU_KERNELS_H_
+
+/* -------------------------------------------------------------------------- *
+ *                              OpenMMAmoeba                                  *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as published   *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.      *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuAmoebaVdwForce.h"
+#include "CpuPlatform.h"
+#include "openmm/amoebaKernels.h"
+#include "openmm/AmoebaVdwForce.h"
+
+namespace OpenMM {
+
+/**
+ * This kernel is invoked by AmoebaVdwForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CpuCalcAmoebaVdwForceKernel : public CalcAmoebaVdwForceKernel {
+public:
+    CpuCalcAmoebaVdwForceKernel(const std::string& name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcAmoebaVdwForceKernel(name, platform),
+            data(data), ixn(NULL) {
+    }
+    ~CpuCalcAmoebaVdwForceKernel();
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param force      the AmoebaVdwForce this kernel will be used for
+     */
+    void initialize(const System& system, const AmoebaVdwForce& force);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, bool includeForces, bool includeEnergy);
+    /**
+     * Copy changed parameters over to a context.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the AmoebaVdwForce to copy the parameters from
+     */
+    void copyParametersToContext(ContextImpl& context, const AmoebaVdwForce& force);
+private:
+    CpuPlatform::PlatformData& data;
+    CpuAmoebaVdwForce* ixn;
+    int numParticles;
+    bool usePeriodic;
+    double cutoff, dispersionCoefficient;
+};
+
+} // namespace OpenMM
+
+#endif /*AMOEBA_OPENMM_CPU_KERNELS_H_*/
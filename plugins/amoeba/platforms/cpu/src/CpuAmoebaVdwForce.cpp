@@ -0,0 +1,335 @@
+/* -------------------------------------------------------------------------- *
+ *                              OpenMMAmoeba                                  *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as published   *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.      *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuAmoebaVdwForce.h"
+#include "openmm/internal/AmoebaVdwForceImpl.h"
+#include <cmath>
+#include <set>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuAmoebaVdwForce::CpuAmoebaVdwForce(const AmoebaVdwForce& force) : neighborList(NULL) {
+    numParticles = force.getNumParticles();
+    nonbondedMethod = force.getNonbondedMethod();
+    potentialFunction = force.getPotentialFunction();
+    alchemicalMethod = force.getAlchemicalMethod();
+    softcorePower = force.getSoftcorePower();
+    softcoreAlpha = force.getSoftcoreAlpha();
+
+    // The taper is applied over the last 10% of the cutoff distance, as in the other platforms.
+
+    cutoff = (float) force.getCutoffDistance();
+    double taper = 0.9*force.getCutoffDistance();
+    double width = taper-force.getCutoffDistance();
+    taperCutoff = (float) taper;
+    taperC3 = (float) (10.0/pow(width, 3.0));
+    taperC4 = (float) (15.0/pow(width, 4.0));
+    taperC5 = (float) (6.0/pow(width, 5.0));
+
+    // Record the parameters.  Sigma and epsilon are stored in tables indexed by pairs of types.
+
+    vector<vector<double> > sigmaMatrix, epsilonMatrix;
+    AmoebaVdwForceImpl::createParameterMatrix(force, particleType, sigmaMatrix, epsilonMatrix);
+    numTypes = sigmaMatrix.size();
+    sigmaTable.resize(numTypes*numTypes);
+    epsilonTable.resize(numTypes*numTypes);
+    for (int i = 0; i < numTypes; i++)
+        for (int j = 0; j < numTypes; j++) {
+            sigmaTable[i*numTypes+j] = (float) sigmaMatrix[i][j];
+            epsilonTable[i*numTypes+j] = (float) epsilonMatrix[i][j];
+        }
+    indexIV.resize(numParticles);
+    reduction.resize(numParticles);
+    scaleFactor.resize(numParticles);
+    isAlchemical.resize(numParticles);
+    vector<set<int> > exclusionSets(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        int type;
+        double sigma, epsilon, reductionFactor, scale;
+        bool alchemical;
+        force.getParticleParameters(i, indexIV[i], sigma, epsilon, reductionFactor, alchemical, type, scale);
+        reduction[i] = (float) reductionFactor;
+        scaleFactor[i] = (float) scale;
+        isAlchemical[i] = (alchemical ? 1.0f : 0.0f);
+        vector<int> particleExclusions;
+        force.getParticleExclusions(i, particleExclusions);
+        for (int j : particleExclusions) {
+            if (j != i) {
+                exclusionSets[i].insert(j);
+                exclusionSets[j].insert(i);
+            }
+        }
+    }
+    exclusions = CpuExclusionList(exclusionSets);
+    reducedPositions.resize(4*numParticles);
+    wrappedPositions.resize(4*numParticles);
+    for (int i = 0; i < reducedPositions.size(); i++) {
+        reducedPositions[i] = 0.0f;
+        wrappedPositions[i] = 0.0f;
+    }
+
+    // Without a cutoff every pair interacts, so the neighbor list only needs to be built once.
+
+    neighborList = new CpuNeighborList(4);
+    if (nonbondedMethod == AmoebaVdwForce::NoCutoff)
+        neighborList->createDenseNeighborList(numParticles, exclusions);
+}
+
+CpuAmoebaVdwForce::~CpuAmoebaVdwForce() {
+    if (neighborList != NULL)
+        delete neighborList;
+}
+
+double CpuAmoebaVdwForce::calculateForce(const vector<Vec3>& positions, vector<AlignedArray<float> >& threadForce,
+                                         const Vec3* boxVectors, double lambda, ThreadPool& threads) {
+    // Compute the reduced positions.  Interactions are computed from the unwrapped positions, which
+    // avoids losing precision when particles are far from the origin, but the neighbor list is built
+    // from positions wrapped into the periodic box.
+
+    bool periodic = (nonbondedMethod == AmoebaVdwForce::CutoffPeriodic);
+    Vec3 invBoxSize(1.0/boxVectors[0][0], 1.0/boxVectors[1][1], 1.0/boxVectors[2][2]);
+    for (int i = 0; i < numParticles; i++) {
+        Vec3 pos = positions[i];
+        if (reduction[i] != 0.0f) {
+            const Vec3& parentPos = positions[indexIV[i]];
+            pos = (pos-parentPos)*reduction[i] + parentPos;
+        }
+        reducedPositions[4*i] = (float) pos[0];
+        reducedPositions[4*i+1] = (float) pos[1];
+        reducedPositions[4*i+2] = (float) pos[2];
+        if (periodic) {
+            pos -= boxVectors[2]*floor(pos[2]*invBoxSize[2]);
+            pos -= boxVectors[1]*floor(pos[1]*invBoxSize[1]);
+            pos -= boxVectors[0]*floor(pos[0]*invBoxSize[0]);
+            wrappedPositions[4*i] = (float) pos[0];
+            wrappedPositions[4*i+1] = (float) pos[1];
+            wrappedPositions[4*i+2] = (float) pos[2];
+        }
+    }
+    if (periodic) {
+        neighborList->computeNeighborList(numParticles, wrappedPositions, exclusions, boxVectors, true, cutoff, threads);
+        for (int i = 0; i < 3; i++)
+            periodicBoxVectors[i] = boxVectors[i];
+        triclinic = (boxVectors[1][0] != 0.0 || boxVectors[2][0] != 0.0 || boxVectors[2][1] != 0.0);
+    }
+
+    // Record the parameters for the threads.
+
+    this->threadForce = &threadForce;
+    lambdaScale = (float) pow(lambda, softcorePower);
+    softcore = (float) (softcoreAlpha*(1.0-lambda)*(1.0-lambda));
+    int numThreads = threads.getNumThreads();
+    threadEnergy.resize(numThreads);
+
+    // Signal the threads to start running and wait for them to finish.
+
+    atomicCounter = 0;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeForce(threads, threadIndex); });
+    threads.waitForThreads();
+
+    // Combine the energies from all the threads.
+
+    double energy = 0.0;
+    for (int i = 0; i < numThreads; i++)
+        energy += threadEnergy[i];
+    return energy;
+}
+
+void CpuAmoebaVdwForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
+    float* forces = &(*threadForce)[threadIndex][0];
+    double energy = 0.0;
+    int numBlocks = neighborList->getNumBlocks();
+    while (true) {
+        int blockIndex = atomicCounter++;
+        if (blockIndex >= numBlocks)
+            break;
+        computeBlock(blockIndex, forces, energy);
+    }
+    threadEnergy[threadIndex] = energy;
+}
+
+void CpuAmoebaVdwForce::computeBlock(int blockIndex, float* forces, double& energy) {
+    const float dhal = 0.07f;
+    const float ghal = 0.12f;
+    const float dhal1 = 1.07f;
+    const float ghal1 = 1.12f;
+    const float dhal1Pow7 = (float) pow((double) dhal1, 7.0);
+    bool periodic = (nonbondedMethod == AmoebaVdwForce::CutoffPeriodic);
+    fvec4 boxSize(0.0f), invBoxSize(0.0f);
+    if (periodic) {
+        boxSize = fvec4(periodicBoxVectors[0][0], periodicBoxVectors[1][1], periodicBoxVectors[2][2], 0);
+        invBoxSize = fvec4(1/periodicBoxVectors[0][0], 1/periodicBoxVectors[1][1], 1/periodicBoxVectors[2][2], 0);
+    }
+    float cutoff2 = cutoff*cutoff;
+
+    // Load the positions and parameters of the atoms in the block.
+
+    const int32_t* blockAtom = &neighborList->getSortedAtoms()[4*blockIndex];
+    fvec4 blockAtomPos[4];
+    int32_t blockTypeOffset[4];
+    float blockScale[4], blockAlchemical[4];
+    for (int k = 0; k < 4; k++) {
+        int atom = blockAtom[k];
+        blockAtomPos[k] = fvec4(&reducedPositions[4*atom]);
+        blockTypeOffset[k] = particleType[atom]*numTypes;
+        blockScale[k] = scaleFactor[atom];
+        blockAlchemical[k] = isAlchemical[atom];
+    }
+    fvec4 blockAtomX, blockAtomY, blockAtomZ, blockAtomW;
+    transpose(blockAtomPos, blockAtomX, blockAtomY, blockAtomZ, blockAtomW);
+    fvec4 scaleI(blockScale);
+    fvec4 alchemicalI(blockAlchemical);
+    fvec4 blockAtomForceX(0.0f), blockAtomForceY(0.0f), blockAtomForceZ(0.0f);
+    fvec4 blockEnergy(0.0f);
+
+    // Loop over neighbors.
+
+    CpuNeighborList::NeighborIterator neighbors = neighborList->getNeighborIterator(blockIndex);
+    while (neighbors.next()) {
+        int atom = neighbors.getNeighbor();
+        const float* posJ = &reducedPositions[4*atom];
+        fvec4 dx = blockAtomX-posJ[0];
+        fvec4 dy = blockAtomY-posJ[1];
+        fvec4 dz = blockAtomZ-posJ[2];
+        if (periodic) {
+            if (triclinic) {
+                fvec4 scale3 = floor(dz*invBoxSize[2]+0.5f);
+                dx -= scale3*(float) periodicBoxVectors[2][0];
+                dy -= scale3*(float) periodicBoxVectors[2][1];
+                dz -= scale3*(float) periodicBoxVectors[2][2];
+                fvec4 scale2 = floor(dy*invBoxSize[1]+0.5f);
+                dx -= scale2*(float) periodicBoxVectors[1][0];
+                dy -= scale2*(float) periodicBoxVectors[1][1];
+                fvec4 scale1 = floor(dx*invBoxSize[0]+0.5f);
+                dx -= scale1*(float) periodicBoxVectors[0][0];
+            }
+            else {
+                dx -= round(dx*invBoxSize[0])*boxSize[0];
+                dy -= round(dy*invBoxSize[1])*boxSize[1];
+                dz -= round(dz*invBoxSize[2])*boxSize[2];
+            }
+        }
+        fvec4 r2 = dx*dx + dy*dy + dz*dz;
+        fvec4 include = fvec4::expandBitsToMask(~neighbors.getExclusions());
+        if (periodic)
+            include = blendZero(r2 < cutoff2, include);
+        if (!any(include))
+            continue;
+
+        // Excluded lanes may hold coincident atoms, so give them a harmless distance.
+
+        r2 = blend(1.0f, r2, include);
+        fvec4 r = sqrt(r2);
+
+        // Look up the parameters for each pair.
+
+        int32_t tableIndex[4];
+        int typeJ = particleType[atom];
+        for (int k = 0; k < 4; k++)
+            tableIndex[k] = blockTypeOffset[k]+typeJ;
+        fvec4 sigma(sigmaTable.data(), tableIndex);
+        fvec4 epsilon = fvec4(epsilonTable.data(), tableIndex)*scaleI*scaleFactor[atom];
+        fvec4 softcoreTerm(0.0f);
+        if (alchemicalMethod != AmoebaVdwForce::None) {
+            fvec4 alchemicalPair;
+            if (alchemicalMethod == AmoebaVdwForce::Decouple)
+                alchemicalPair = (alchemicalI != isAlchemical[atom]);
+            else
+                alchemicalPair = (alchemicalI+isAlchemical[atom] > 0.0f);
+            epsilon = blend(epsilon, epsilon*lambdaScale, alchemicalPair);
+            softcoreTerm = blendZero(softcore, alchemicalPair);
+        }
+
+        // Compute the interaction.
+
+        fvec4 pairEnergy, dEdR;
+        if (potentialFunction == AmoebaVdwForce::LennardJones) {
+            fvec4 pp1 = sigma/r;
+            fvec4 pp2 = pp1*pp1;
+            fvec4 pp6 = pp2*pp2*pp2;
+            fvec4 pp12 = pp6*pp6;
+            pairEnergy = 4.0f*epsilon*(pp12-pp6);
+            dEdR = -24.0f*epsilon*(2.0f*pp12-pp6)/r;
+        }
+        else {
+            fvec4 rho = r/sigma;
+            fvec4 rho2 = rho*rho;
+            fvec4 rho6 = rho2*rho2*rho2;
+            fvec4 rhoplus = rho+dhal;
+            fvec4 rhodec2 = rhoplus*rhoplus;
+            fvec4 rhodec = rhodec2*rhodec2*rhodec2;
+            fvec4 s1 = 1.0f/(softcoreTerm+rhodec*rhoplus);
+            fvec4 s2 = 1.0f/(softcoreTerm+rho6*rho+ghal);
+            fvec4 t1 = dhal1Pow7*s1;
+            fvec4 t2 = ghal1*s2;
+            fvec4 t2min = t2-2.0f;
+            fvec4 dt1 = -7.0f*rhodec*t1*s1;
+            fvec4 dt2 = -7.0f*rho6*t2*s2;
+            pairEnergy = epsilon*t1*t2min;
+            dEdR = epsilon*(dt1*t2min+t1*dt2)/sigma;
+        }
+        if (periodic) {
+            fvec4 inTaper = (r > taperCutoff);
+            if (any(inTaper)) {
+                fvec4 delta = r-taperCutoff;
+                fvec4 taper = 1.0f+delta*delta*delta*(taperC3+delta*(taperC4+delta*taperC5));
+                fvec4 dtaper = delta*delta*(3.0f*taperC3+delta*(4.0f*taperC4+delta*5.0f*taperC5));
+                dEdR = blend(dEdR, pairEnergy*dtaper+dEdR*taper, inTaper);
+                pairEnergy = blend(pairEnergy, pairEnergy*taper, inTaper);
+            }
+        }
+        blockEnergy += blendZero(pairEnergy, include);
+
+        // Accumulate the forces.
+
+        fvec4 forceFactor = blendZero(dEdR/r, include);
+        fvec4 fx = dx*forceFactor;
+        fvec4 fy = dy*forceFactor;
+        fvec4 fz = dz*forceFactor;
+        blockAtomForceX -= fx;
+        blockAtomForceY -= fy;
+        blockAtomForceZ -= fz;
+        addSiteForce(atom, reduceToVec3(fx, fy, fz), forces);
+    }
+
+    // Record the forces on the block atoms and the energy.
+
+    fvec4 f[4];
+    transpose(blockAtomForceX, blockAtomForceY, blockAtomForceZ, 0.0f, f);
+    for (int k = 0; k < 4; k++)
+        addSiteForce(blockAtom[k], f[k], forces);
+    energy += reduceAdd(blockEnergy);
+}
+
+void CpuAmoebaVdwForce::addSiteForce(int atom, fvec4 force, float* forces) const {
+    int parent = indexIV[atom];
+    if (parent == atom)
+        (fvec4(forces+4*atom)+force).store(forces+4*atom);
+    else {
+        float factor = reduction[atom];
+        (fvec4(forces+4*atom)+force*factor).store(forces+4*atom);
+        (fvec4(forces+4*parent)+force*(1.0f-factor)).store(forces+4*parent);
+    }
+}
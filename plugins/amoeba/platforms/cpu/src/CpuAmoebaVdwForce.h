@@ -0,0 +1,110 @@
+#ifndef OPENMM_CPU_AMOEBA_VDW_FORCE_H__
+#define OPENMM_CPU_AMOEBA_VDW_FORCE_H__
+
+/* -------------------------------------------------------------------------- *
+ *                              OpenMMAmoeba                                  *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as published   *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.      *
+ * -------------------------------------------------------------------------- */
+
+#include "AlignedArray.h"
+#include "CpuExclusionList.h"
+#include "CpuNeighborList.h"
+#include "openmm/AmoebaVdwForce.h"
+#include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
+#include "openmm/internal/vectorize.h"
+#include <atomic>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class computes an AmoebaVdwForce on the CPU platform.  Interactions are computed between
+ * the reduced positions of the particles, four at a time with SIMD, looping over the blocks of a
+ * CpuNeighborList.  With a cutoff the neighbor list is rebuilt from the reduced positions on every
+ * call, so it contains exactly the pairs that interact.  Forces on reduced sites are divided between
+ * each particle and its parent in the same way as AmoebaReferenceVdwForce.
+ */
+class CpuAmoebaVdwForce {
+public:
+    /**
+     * Create a new CpuAmoebaVdwForce.
+     *
+     * @param force    the AmoebaVdwForce to take the parameters from
+     */
+    CpuAmoebaVdwForce(const AmoebaVdwForce& force);
+
+    ~CpuAmoebaVdwForce();
+
+    /**
+     * Compute the forces and energy.
+     *
+     * @param positions      the positions of all particles
+     * @param threadForce    the force on each particle is added to the buffer for the thread that computed it
+     * @param boxVectors     the periodic box vectors
+     * @param lambda         the value of the alchemical parameter
+     * @param threads        the thread pool to use
+     * @return the energy of the interaction
+     */
+    double calculateForce(const std::vector<Vec3>& positions, std::vector<AlignedArray<float> >& threadForce,
+                          const Vec3* boxVectors, double lambda, ThreadPool& threads);
+
+    /**
+     * This routine contains the code executed by each thread.
+     */
+    void threadComputeForce(ThreadPool& threads, int threadIndex);
+
+private:
+    int numParticles, numTypes;
+    AmoebaVdwForce::NonbondedMethod nonbondedMethod;
+    AmoebaVdwForce::PotentialFunction potentialFunction;
+    AmoebaVdwForce::AlchemicalMethod alchemicalMethod;
+    int softcorePower;
+    double softcoreAlpha;
+    float cutoff, taperCutoff, taperC3, taperC4, taperC5;
+    std::vector<int> particleType, indexIV;
+    std::vector<float> reduction, scaleFactor, isAlchemical, sigmaTable, epsilonTable;
+    CpuExclusionList exclusions;
+    CpuNeighborList* neighborList;
+    AlignedArray<float> reducedPositions, wrappedPositions;
+    std::vector<double> threadEnergy;
+    // The following variables are used to make information accessible to the individual threads.
+    std::vector<AlignedArray<float> >* threadForce;
+    Vec3 periodicBoxVectors[3];
+    bool triclinic;
+    float lambdaScale, softcore;
+    std::atomic<int> atomicCounter;
+
+    /**
+     * Compute the interactions of one block of the neighbor list.
+     */
+    void computeBlock(int blockIndex, float* forces, double& energy);
+
+    /**
+     * Add the force acting on a particle's reduced site, dividing it between the particle and its parent.
+     */
+    void addSiteForce(int atom, fvec4 force, float* forces) const;
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_CPU_AMOEBA_VDW_FORCE_H__
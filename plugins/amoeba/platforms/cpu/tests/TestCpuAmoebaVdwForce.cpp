@@ -0,0 +1,101 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+
+#include "CpuAmoebaTests.h"
+#include "TestAmoebaVdwForce.h"
+
+void compareToReference(AmoebaVdwForce::NonbondedMethod method, AmoebaVdwForce::PotentialFunction potential,
+        AmoebaVdwForce::AlchemicalMethod alchemicalMethod, bool triclinic) {
+    // Build a box of water-like molecules and compare the result to the Reference platform.  With a cutoff,
+    // the Reference platform selects the interacting pairs based on the unreduced positions, so the
+    // hydrogens are only reduced toward their oxygens when there is no cutoff.
+
+    const int gridSize = 7;
+    const double boxSize = 3.0;
+    const double reduction = (method == AmoebaVdwForce::NoCutoff ? 0.91 : 0.0);
+    System system;
+    Vec3 a(boxSize, 0, 0), b(0, boxSize, 0), c(0, 0, boxSize);
+    if (triclinic) {
+        b = Vec3(0.4, boxSize, 0);
+        c = Vec3(-0.3, 0.5, boxSize);
+    }
+    system.setDefaultPeriodicBoxVectors(a, b, c);
+    AmoebaVdwForce* vdw = new AmoebaVdwForce();
+    vdw->setNonbondedMethod(method);
+    vdw->setCutoffDistance(0.9);
+    vdw->setPotentialFunction(potential);
+    vdw->setAlchemicalMethod(alchemicalMethod);
+    vdw->setUseDispersionCorrection(true);
+    system.addForce(vdw);
+    vector<Vec3> positions;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < gridSize; i++)
+        for (int j = 0; j < gridSize; j++)
+            for (int k = 0; k < gridSize; k++) {
+                int oxygen = system.addParticle(16.0);
+                system.addParticle(1.0);
+                system.addParticle(1.0);
+                bool alchemical = (oxygen < 30);
+                double scale = (oxygen%9 == 0 ? 0.8 : 1.0);
+                vdw->addParticle(oxygen, 0.3405, 0.46, 0.0, alchemical, scale);
+                vdw->addParticle(oxygen, 0.2655, 0.056, reduction, alchemical);
+                vdw->addParticle(oxygen, 0.2655, 0.056, reduction, alchemical);
+                vector<int> exclusions = {oxygen, oxygen+1, oxygen+2};
+                for (int m = 0; m < 3; m++)
+                    vdw->setParticleExclusions(oxygen+m, exclusions);
+                Vec3 pos = (a*(i+0.2*genrand_real2(sfmt)) + b*(j+0.2*genrand_real2(sfmt)) + c*(k+0.2*genrand_real2(sfmt)))/gridSize;
+                Vec3 dir1(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+                Vec3 dir2(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+                positions.push_back(pos);
+                positions.push_back(pos+dir1*(0.1/sqrt(dir1.dot(dir1))));
+                positions.push_back(pos+dir2*(0.1/sqrt(dir2.dot(dir2))));
+            }
+    VerletIntegrator integrator1(0.001);
+    VerletIntegrator integrator2(0.001);
+    Context context1(system, integrator1, Platform::getPlatformByName("Reference"));
+    Context context2(system, integrator2, platform, {{"Threads", "3"}});
+    for (Context* context : {&context1, &context2}) {
+        context->setPositions(positions);
+        context->setParameter(AmoebaVdwForce::Lambda(), 0.6);
+    }
+    State state1 = context1.getState(State::Forces | State::Energy);
+    State state2 = context2.getState(State::Forces | State::Energy);
+    ASSERT_EQUAL_TOL(state1.getPotentialEnergy(), state2.getPotentialEnergy(), 1e-5);
+    for (int i = 0; i < system.getNumParticles(); i++)
+        ASSERT_EQUAL_VEC(state1.getForces()[i], state2.getForces()[i], 1e-4);
+}
+
+void runPlatformTests() {
+    compareToReference(AmoebaVdwForce::CutoffPeriodic, AmoebaVdwForce::Buffered147, AmoebaVdwForce::Decouple, false);
+    compareToReference(AmoebaVdwForce::CutoffPeriodic, AmoebaVdwForce::Buffered147, AmoebaVdwForce::Annihilate, true);
+    compareToReference(AmoebaVdwForce::CutoffPeriodic, AmoebaVdwForce::LennardJones, AmoebaVdwForce::None, true);
+    compareToReference(AmoebaVdwForce::NoCutoff, AmoebaVdwForce::Buffered147, AmoebaVdwForce::Decouple, false);
+}
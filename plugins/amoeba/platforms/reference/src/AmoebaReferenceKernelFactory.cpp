@@ -29,6 +29,7 @@
 #include "openmm/OpenMMException.h"
 
 using namespace OpenMM;
+using namespace std;
 
 #ifdef OPENMM_BUILDING_STATIC_LIBRARY
 static void registerPlatforms() {
@@ -45,13 +46,19 @@ extern "C" OPENMM_EXPORT void registerKernelFactories() {
     for (int i = 0; i < Platform::getNumPlatforms(); i++) {
         Platform& platform = Platform::getPlatform(i);
         if (dynamic_cast<ReferencePlatform*>(&platform) != NULL) {
-             AmoebaReferenceKernelFactory* factory = new AmoebaReferenceKernelFactory();
-             platform.registerKernelFactory(CalcAmoebaTorsionTorsionForceKernel::Name(), factory);
-             platform.registerKernelFactory(CalcAmoebaVdwForceKernel::Name(), factory);
-             platform.registerKernelFactory(CalcAmoebaMultipoleForceKernel::Name(), factory);
-             platform.registerKernelFactory(CalcAmoebaGeneralizedKirkwoodForceKernel::Name(), factory);
-             platform.registerKernelFactory(CalcAmoebaWcaDispersionForceKernel::Name(), factory);
-             platform.registerKernelFactory(CalcHippoNonbondedForceKernel::Name(), factory);
+             // Platforms derived from ReferencePlatform may already have optimized versions of
+             // some kernels, so only fill in the ones that are missing.
+
+             AmoebaReferenceKernelFactory* factory = NULL;
+             for (const string& name : {CalcAmoebaTorsionTorsionForceKernel::Name(), CalcAmoebaVdwForceKernel::Name(),
+                     CalcAmoebaMultipoleForceKernel::Name(), CalcAmoebaGeneralizedKirkwoodForceKernel::Name(),
+                     CalcAmoebaWcaDispersionForceKernel::Name(), CalcHippoNonbondedForceKernel::Name()}) {
+                 if (!platform.supportsKernels({name})) {
+                     if (factory == NULL)
+                         factory = new AmoebaReferenceKernelFactory();
+                     platform.registerKernelFactory(name, factory);
+                 }
+             }
         }
     }
 }
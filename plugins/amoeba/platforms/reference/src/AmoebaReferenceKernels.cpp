@@ -72,6 +72,11 @@ static Vec3* extractBoxVectors(ContextImpl& context) {
     return data->periodicBoxVectors;
 }
 
+static ThreadPool& extractThreadPool(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return data->threads;
+}
+
 // ***************************************************************************
 
 ReferenceCalcAmoebaTorsionTorsionForceKernel::ReferenceCalcAmoebaTorsionTorsionForceKernel(const std::string& name, const Platform& platform, const System& system) :
@@ -332,6 +337,9 @@ AmoebaReferenceMultipoleForce* ReferenceCalcAmoebaMultipoleForceKernel::setupAmo
          amoebaReferenceMultipoleForce = new AmoebaReferenceMultipoleForce(AmoebaReferenceMultipoleForce::NoCutoff);
     }
 
+    amoebaReferenceMultipoleForce->setThreadPool(&extractThreadPool(context));
+    amoebaReferenceMultipoleForce->setPreconditionerCache(&preconditioner);
+
     // set polarization type
 
     if (polarizationType == AmoebaMultipoleForce::Mutual) {
@@ -358,12 +366,33 @@ double ReferenceCalcAmoebaMultipoleForceKernel::execute(ContextImpl& context, bo
 
     AmoebaReferenceMultipoleForce* amoebaReferenceMultipoleForce = setupAmoebaReferenceMultipoleForce(context);
 
+    // Start the mutual induced dipole solver from a linear extrapolation of the dipoles
+    // from the previous two steps.
+
+    if (polarizationType == AmoebaMultipoleForce::Mutual && lastInducedDipoles.size() > 0) {
+        if (previousInducedDipoles.size() == 0)
+            amoebaReferenceMultipoleForce->setInitialInducedDipoles(lastInducedDipoles, lastInducedDipolesPolar);
+        else {
+            vector<Vec3> guess(numMultipoles), guessPolar(numMultipoles);
+            for (int i = 0; i < numMultipoles; i++) {
+                guess[i] = lastInducedDipoles[i]*2.0 - previousInducedDipoles[i];
+                guessPolar[i] = lastInducedDipolesPolar[i]*2.0 - previousInducedDipolesPolar[i];
+            }
+            amoebaReferenceMultipoleForce->setInitialInducedDipoles(guess, guessPolar);
+        }
+    }
+
     vector<Vec3>& posData = extractPositions(context);
     vector<Vec3>& forceData = extractForces(context);
     double energy = amoebaReferenceMultipoleForce->calculateForceAndEnergy(posData, charges, dipoles, quadrupoles, tholes,
                                                                            dampingFactors, polarity, axisTypes, 
                                                                            multipoleAtomZs, multipoleAtomXs, multipoleAtomYs,
                                                                            multipoleAtomCovalentInfo, forceData);
+    if (polarizationType == AmoebaMultipoleForce::Mutual) {
+        previousInducedDipoles.swap(lastInducedDipoles);
+        previousInducedDipolesPolar.swap(lastInducedDipolesPolar);
+        amoebaReferenceMultipoleForce->getLastInducedDipoles(lastInducedDipoles, lastInducedDipolesPolar);
+    }
 
     delete amoebaReferenceMultipoleForce;
 
@@ -509,6 +538,17 @@ void ReferenceCalcAmoebaMultipoleForceKernel::copyParametersToContext(ContextImp
         quadrupoles[quadrupoleIndex++] = quadrupolesD[7];
         quadrupoles[quadrupoleIndex++] = quadrupolesD[8];
     }
+
+    // The dipoles from earlier steps are no longer a useful starting point.
+
+    lastInducedDipoles.clear();
+    lastInducedDipolesPolar.clear();
+    previousInducedDipoles.clear();
+    previousInducedDipolesPolar.clear();
+
+    // The preconditioner depends on the damping factors and Thole parameters, so rebuild it.
+
+    preconditioner.positions.clear();
 }
 
 void ReferenceCalcAmoebaMultipoleForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
@@ -713,12 +753,12 @@ double ReferenceCalcAmoebaVdwForceKernel::execute(ContextImpl& context, bool inc
             if (boxVectors[0][0] < minAllowedSize || boxVectors[1][1] < minAllowedSize || boxVectors[2][2] < minAllowedSize)
                 throw OpenMMException("The periodic box size has decreased to less than twice the cutoff.");
             vdwForce.setPeriodicBox(boxVectors);
-            energy  = vdwForce.calculateForceAndEnergy(numParticles, lambda, posData, *neighborList, forceData);
+            energy  = vdwForce.calculateForceAndEnergy(numParticles, lambda, posData, *neighborList, forceData, extractThreadPool(context));
             energy += dispersionCoefficient/(boxVectors[0][0]*boxVectors[1][1]*boxVectors[2][2]);
         }
     }
     else
-        energy = vdwForce.calculateForceAndEnergy(numParticles, lambda, posData, forceData);
+        energy = vdwForce.calculateForceAndEnergy(numParticles, lambda, posData, forceData, extractThreadPool(context));
     return static_cast<double>(energy);
 }
 
@@ -813,6 +853,7 @@ void ReferenceCalcHippoNonbondedForceKernel::initialize(const System& system, co
 }
 
 void ReferenceCalcHippoNonbondedForceKernel::setupAmoebaReferenceHippoNonbondedForce(ContextImpl& context) {
+    ixn->setThreadPool(&extractThreadPool(context));
     if (ixn->getNonbondedMethod() == HippoNonbondedForce::PME) {
         AmoebaReferencePmeHippoNonbondedForce* force = dynamic_cast<AmoebaReferencePmeHippoNonbondedForce*>(ixn);
         Vec3* boxVectors = extractBoxVectors(context);
@@ -194,6 +194,16 @@ private:
     double cutoffDistance;
     std::vector<int> pmeGridDimension;
 
+    // Converged induced dipoles from the two most recent force evaluations, used to
+    // extrapolate a starting guess for the next one.
+
+    std::vector<Vec3> lastInducedDipoles, lastInducedDipolesPolar;
+    std::vector<Vec3> previousInducedDipoles, previousInducedDipolesPolar;
+
+    // Preconditioner for the mutual induced dipole solver, kept until the positions change.
+
+    AmoebaReferenceMultipoleForce::PreconditionerCache preconditioner;
+
     const System& system;
 };
 
@@ -43,7 +43,7 @@
 using std::vector;
 using namespace OpenMM;
 
-AmoebaReferenceHippoNonbondedForce::AmoebaReferenceHippoNonbondedForce(const HippoNonbondedForce& force) : _electric(ONE_4PI_EPS0) {
+AmoebaReferenceHippoNonbondedForce::AmoebaReferenceHippoNonbondedForce(const HippoNonbondedForce& force) : _electric(ONE_4PI_EPS0), _threads(NULL) {
     _numParticles = force.getNumParticles();
     particleData.resize(_numParticles);
     std::vector<double> dipoles, quadrupoles;
@@ -98,6 +98,10 @@ void AmoebaReferenceHippoNonbondedForce::setExtrapolationCoefficients(const std:
     }
 }
 
+void AmoebaReferenceHippoNonbondedForce::setThreadPool(ThreadPool* threads) {
+    _threads = threads;
+}
+
 double AmoebaReferenceHippoNonbondedForce::normalizeVec3(Vec3& vectorToNormalize) const {
     double norm = sqrt(vectorToNormalize.dot(vectorToNormalize));
     if (norm > 0.0)
@@ -592,10 +596,26 @@ void AmoebaReferenceHippoNonbondedForce::calculateFixedMultipoleFieldPairIxn(con
 }
 
 void AmoebaReferenceHippoNonbondedForce::calculateFixedMultipoleField() {
-    for (int i = 0; i < _numParticles; i++)
-        for (int j = 0; j < _numParticles; j++)
+    // Each pair interaction only modifies the field at particle I, so rows can be divided
+    // between threads without any extra buffers.
+
+    int numParticles = _numParticles;
+    auto computeRow = [&] (int i) {
+        for (int j = 0; j < numParticles; j++)
             if (i != j)
                 calculateFixedMultipoleFieldPairIxn(particleData[i], particleData[j]);
+    };
+    if (_threads == NULL || _threads->getNumThreads() == 1) {
+        for (int i = 0; i < numParticles; i++)
+            computeRow(i);
+        return;
+    }
+    int numThreads = _threads->getNumThreads();
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        for (int i = threadIndex; i < numParticles; i += numThreads)
+            computeRow(i);
+    });
+    _threads->waitForThreads();
 }
 
 void AmoebaReferenceHippoNonbondedForce::initializeInducedDipoles() {
@@ -605,7 +625,8 @@ void AmoebaReferenceHippoNonbondedForce::initializeInducedDipoles() {
 }
 
 void AmoebaReferenceHippoNonbondedForce::calculateInducedDipolePairIxns(const MultipoleParticleData& particleI,
-                                                                        const MultipoleParticleData& particleJ) {
+                                                                        const MultipoleParticleData& particleJ,
+                                                                        vector<Vec3>& field) const {
     int i = particleI.index;
     int j = particleJ.index;
     if (i == j)
@@ -625,8 +646,39 @@ void AmoebaReferenceHippoNonbondedForce::calculateInducedDipolePairIxns(const Mu
     double rInv3 = rInv*rInv2;
     double scale3 = -fdamp3*rInv3;
     double scale5 = 3*fdamp5*rInv3*rInv2;
-    _inducedDipoleField[i] += _inducedDipole[j]*scale3 + deltaR*scale5*(_inducedDipole[j].dot(deltaR));
-    _inducedDipoleField[j] += _inducedDipole[i]*scale3 + deltaR*scale5*(_inducedDipole[i].dot(deltaR));
+    field[i] += _inducedDipole[j]*scale3 + deltaR*scale5*(_inducedDipole[j].dot(deltaR));
+    field[j] += _inducedDipole[i]*scale3 + deltaR*scale5*(_inducedDipole[i].dot(deltaR));
+}
+
+void AmoebaReferenceHippoNonbondedForce::calculateInducedDipolePairFields(std::function<void (const MultipoleParticleData&, const MultipoleParticleData&, vector<Vec3>&)> pairIxn) {
+    int numParticles = _numParticles;
+    if (_threads == NULL || _threads->getNumThreads() == 1) {
+        for (int i = 0; i < numParticles; i++)
+            for (int j = i+1; j < numParticles; j++)
+                pairIxn(particleData[i], particleData[j], _inducedDipoleField);
+        return;
+    }
+
+    // Each thread accumulates into its own copy of the field, using interleaved rows.
+
+    int numThreads = _threads->getNumThreads();
+    vector<vector<Vec3> > threadField(numThreads);
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        vector<Vec3>& field = threadField[threadIndex];
+        field.assign(numParticles, Vec3());
+        for (int i = threadIndex; i < numParticles; i += numThreads)
+            for (int j = i+1; j < numParticles; j++)
+                pairIxn(particleData[i], particleData[j], field);
+    });
+    _threads->waitForThreads();
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int t = 0; t < numThreads; t++)
+            for (int i = start; i < end; i++)
+                _inducedDipoleField[i] += threadField[t][i];
+    });
+    _threads->waitForThreads();
 }
 
 void AmoebaReferenceHippoNonbondedForce::calculateInducedDipoleFields(const vector<MultipoleParticleData>& particleData, int optOrder) {
@@ -637,9 +689,9 @@ void AmoebaReferenceHippoNonbondedForce::calculateInducedDipoleFields(const vect
 
     // Add fields from all induced dipoles.
 
-    for (int ii = 0; ii < _numParticles; ii++)
-        for (int jj = ii; jj < _numParticles; jj++)
-            calculateInducedDipolePairIxns(particleData[ii], particleData[jj]);
+    calculateInducedDipolePairFields([this] (const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ, vector<Vec3>& field) {
+        calculateInducedDipolePairIxns(particleI, particleJ, field);
+    });
 }
 
 void AmoebaReferenceHippoNonbondedForce::convergeInduceDipolesByExtrapolation(const vector<MultipoleParticleData>& particleData) {
@@ -1310,12 +1362,15 @@ void AmoebaReferenceHippoNonbondedForce::mapTorqueToForce(vector<Vec3>& torques,
 
 double AmoebaReferenceHippoNonbondedForce::calculateInteractions(vector<Vec3>& torques, vector<Vec3>& forces) {
 
-    // main loop over particle pairs
+    // main loop over particle pairs.  The quasi-internal frame moments are stored in local copies
+    // of the particle data so rows can be processed by several threads at once.
 
-    double energy = 0.0;
-    for (int i = 0; i < _numParticles; i++) {
-        for (int j = i+1; j < _numParticles; j++) {
-            Vec3 deltaR = particleData[j].position - particleData[i].position;
+    int numParticles = _numParticles;
+    auto computeRow = [&] (int i, vector<Vec3>& forces, vector<Vec3>& torques) {
+        double energy = 0.0;
+        MultipoleParticleData particleI = particleData[i];
+        for (int j = i+1; j < numParticles; j++) {
+            Vec3 deltaR = particleData[j].position - particleI.position;
             if (_nonbondedMethod == HippoNonbondedForce::PME)
                 getPeriodicDelta(deltaR);
             double r2 = deltaR.dot(deltaR);
@@ -1324,18 +1379,19 @@ double AmoebaReferenceHippoNonbondedForce::calculateInteractions(vector<Vec3>& t
             double r = sqrt(r2);
             double mat[3][3];
             formQIRotationMatrix(deltaR, r, mat);
-            particleData[i].qiDipole = rotateVectorToQI(particleData[i].dipole, mat);
-            particleData[j].qiDipole = rotateVectorToQI(particleData[j].dipole, mat);
-            particleData[i].qiInducedDipole = rotateVectorToQI(_inducedDipole[i], mat);
-            particleData[j].qiInducedDipole = rotateVectorToQI(_inducedDipole[j], mat);
-            rotateQuadrupoleToQI(particleData[i].quadrupole, particleData[i].qiQuadrupole, mat);
-            rotateQuadrupoleToQI(particleData[j].quadrupole, particleData[j].qiQuadrupole, mat);
+            MultipoleParticleData particleJ = particleData[j];
+            particleI.qiDipole = rotateVectorToQI(particleI.dipole, mat);
+            particleJ.qiDipole = rotateVectorToQI(particleJ.dipole, mat);
+            particleI.qiInducedDipole = rotateVectorToQI(_inducedDipole[i], mat);
+            particleJ.qiInducedDipole = rotateVectorToQI(_inducedDipole[j], mat);
+            rotateQuadrupoleToQI(particleI.quadrupole, particleI.qiQuadrupole, mat);
+            rotateQuadrupoleToQI(particleJ.quadrupole, particleJ.qiQuadrupole, mat);
             Vec3 force, labForce, torqueI, torqueJ;
-            energy += calculateElectrostaticPairIxn(particleData[i], particleData[j], r, force, torqueI, torqueJ);
-            calculateInducedDipolePairIxn(particleData[i], particleData[j], deltaR, r, force, torqueI, torqueJ, labForce);
-            energy += calculateDispersionPairIxn(particleData[i], particleData[j], r, force);
-            energy += calculateRepulsionPairIxn(particleData[i], particleData[j], r, force, torqueI, torqueJ);
-            energy += calculateChargeTransferPairIxn(particleData[i], particleData[j], r, force);
+            energy += calculateElectrostaticPairIxn(particleI, particleJ, r, force, torqueI, torqueJ);
+            calculateInducedDipolePairIxn(particleI, particleJ, deltaR, r, force, torqueI, torqueJ, labForce);
+            energy += calculateDispersionPairIxn(particleI, particleJ, r, force);
+            energy += calculateRepulsionPairIxn(particleI, particleJ, r, force, torqueI, torqueJ);
+            energy += calculateChargeTransferPairIxn(particleI, particleJ, r, force);
             force = rotateVectorFromQI(force, mat);
             torqueI = rotateVectorFromQI(torqueI, mat);
             torqueJ = rotateVectorFromQI(torqueJ, mat);
@@ -1344,6 +1400,40 @@ double AmoebaReferenceHippoNonbondedForce::calculateInteractions(vector<Vec3>& t
             torques[i] += torqueI;
             torques[j] += torqueJ;
         }
+        return energy;
+    };
+    double energy = 0.0;
+    if (_threads == NULL || _threads->getNumThreads() == 1) {
+        for (int i = 0; i < numParticles; i++)
+            energy += computeRow(i, forces, torques);
+    }
+    else {
+        // Each thread accumulates into its own copy of the forces and torques, using interleaved rows.
+
+        int numThreads = _threads->getNumThreads();
+        vector<vector<Vec3> > threadForces(numThreads), threadTorques(numThreads);
+        vector<double> threadEnergy(numThreads);
+        _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+            threadForces[threadIndex].assign(numParticles, Vec3());
+            threadTorques[threadIndex].assign(numParticles, Vec3());
+            double threadSum = 0.0;
+            for (int i = threadIndex; i < numParticles; i += numThreads)
+                threadSum += computeRow(i, threadForces[threadIndex], threadTorques[threadIndex]);
+            threadEnergy[threadIndex] = threadSum;
+        });
+        _threads->waitForThreads();
+        _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+            int start = threadIndex*numParticles/numThreads;
+            int end = (threadIndex+1)*numParticles/numThreads;
+            for (int t = 0; t < numThreads; t++)
+                for (int i = start; i < end; i++) {
+                    forces[i] += threadForces[t][i];
+                    torques[i] += threadTorques[t][i];
+                }
+        });
+        _threads->waitForThreads();
+        for (int t = 0; t < numThreads; t++)
+            energy += threadEnergy[t];
     }
     for (int i = 0; i < _numParticles; i++)
         energy -= (0.5*_electric/particleData[i].polarizability)*_ptDipoleD[0][i].dot(_inducedDipole[i]);
@@ -2419,9 +2509,9 @@ void AmoebaReferencePmeHippoNonbondedForce::calculateInducedDipoleFields(const v
 
     // Add fields from direct space interactions.
 
-    for (int i = 0; i < _numParticles; i++)
-        for (int j = i+1; j < _numParticles; j++)
-            calculateDirectInducedDipolePairIxns(particleData[i], particleData[j]);
+    calculateInducedDipolePairFields([this] (const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ, vector<Vec3>& field) {
+        calculateDirectInducedDipolePairIxns(particleI, particleJ, field);
+    });
 
     // reciprocal space ixns
 
@@ -2454,7 +2544,8 @@ void AmoebaReferencePmeHippoNonbondedForce::calculateDirectInducedDipolePairIxn(
 }
 
 void AmoebaReferencePmeHippoNonbondedForce::calculateDirectInducedDipolePairIxns(const MultipoleParticleData& particleI,
-                                                                                 const MultipoleParticleData& particleJ) {
+                                                                                 const MultipoleParticleData& particleJ,
+                                                                                 vector<Vec3>& field) const {
     int i = particleI.index;
     int j = particleJ.index;
     if (i == j)
@@ -2490,8 +2581,8 @@ void AmoebaReferencePmeHippoNonbondedForce::calculateDirectInducedDipolePairIxns
     double bn2 = (3*bn1+alsq2n*exp2a)*rInv2;
     double scale3 = -bn1 + (1-fdamp3)*rInv3;
     double scale5 = bn2 - 3*(1-fdamp5)*rInv3*rInv2;
-    _inducedDipoleField[i] += _inducedDipole[j]*scale3 + deltaR*scale5*(_inducedDipole[j].dot(deltaR));
-    _inducedDipoleField[j] += _inducedDipole[i]*scale3 + deltaR*scale5*(_inducedDipole[i].dot(deltaR));
+    field[i] += _inducedDipole[j]*scale3 + deltaR*scale5*(_inducedDipole[j].dot(deltaR));
+    field[j] += _inducedDipole[i]*scale3 + deltaR*scale5*(_inducedDipole[i].dot(deltaR));
 }
 
 double AmoebaReferencePmeHippoNonbondedForce::calculatePmeSelfEnergy(const vector<MultipoleParticleData>& particleData) const {
@@ -27,7 +27,9 @@
 #include "openmm/HippoNonbondedForce.h"
 #include "openmm/System.h"
 #include "openmm/Vec3.h"
+#include "openmm/internal/ThreadPool.h"
 #include <array>
+#include <functional>
 #include <map>
 #include <utility>
 #include <vector>
@@ -125,6 +127,14 @@ public:
      */
     void setExtrapolationCoefficients(const std::vector<double> &coefficients);
 
+    /**
+     * Set the ThreadPool to use for parallelizing the pair loops.  If this is not set, all
+     * calculations are done on the calling thread.
+     *
+     * @param threads the ThreadPool to use, or NULL
+     */
+    void setThreadPool(ThreadPool* threads);
+
     /**
      * Calculate force and energy.
      *
@@ -191,6 +201,7 @@ protected:
     };
 
     unsigned int _numParticles;
+    ThreadPool* _threads;
     HippoNonbondedForce::NonbondedMethod _nonbondedMethod;
     double _electric, _cutoffDistance, _cutoffDistanceSquared, _switchingDistance;
     std::map<std::pair<int, int>, Exception> exceptions;
@@ -392,8 +403,19 @@ protected:
      *
      * @param particleI     positions and parameters (charge, labFrame dipoles, quadrupoles, ...) for particle I
      * @param particleJ     positions and parameters (charge, labFrame dipoles, quadrupoles, ...) for particle J
+     * @param field         the fields at both particles are added to this
+     */
+    void calculateInducedDipolePairIxns(const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ,
+                                        std::vector<Vec3>& field) const;
+
+    /**
+     * Loop over particle pairs (i, j) with j > i and add the fields due to induced dipoles to _inducedDipoleField.
+     * If a ThreadPool has been set, the pairs are divided between threads and each thread accumulates into
+     * its own copy of the field.
+     *
+     * @param pairIxn       the function to compute the fields for one pair
      */
-    void calculateInducedDipolePairIxns(const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ);
+    void calculateInducedDipolePairFields(std::function<void (const MultipoleParticleData&, const MultipoleParticleData&, std::vector<Vec3>&)> pairIxn);
 
     /**
      * Calculate induced dipole fields.
@@ -795,9 +817,11 @@ private:
      * 
      * @param particleI    positions and parameters (charge, labFrame dipoles, quadrupoles, ...) for particle I
      * @param particleJ    positions and parameters (charge, labFrame dipoles, quadrupoles, ...) for particle J
+     * @param field        the fields at both particles are added to this
      */
     void calculateDirectInducedDipolePairIxns(const MultipoleParticleData& particleI,
-                                              const MultipoleParticleData& particleJ);
+                                              const MultipoleParticleData& particleJ,
+                                              std::vector<Vec3>& field) const;
 
     /**
      * Initialize induced dipoles
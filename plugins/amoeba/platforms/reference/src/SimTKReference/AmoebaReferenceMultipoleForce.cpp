@@ -26,8 +26,10 @@
 #include "openmm/internal/AmoebaGeneralizedKirkwoodForceImpl.h"
 #include "SimTKOpenMMRealType.h"
 #include "ReferenceForce.h"
+#include "ReferenceNeighborList.h"
 #include "jama_svd.h"
 #include <algorithm>
+#include <set>
 #ifdef _MSC_VER
   #define POCKETFFT_NO_VECTORS
 #endif
@@ -74,6 +76,9 @@ AmoebaReferenceMultipoleForce::AmoebaReferenceMultipoleForce(NonbondedMethod non
 void AmoebaReferenceMultipoleForce::initialize()
 {
 
+    _threads = NULL;
+    _preconditioner = &_localPreconditioner;
+
     unsigned int index    = 0;
     _mScale[index++]      = 0.0;
     _mScale[index++]      = 0.0;
@@ -185,6 +190,28 @@ void AmoebaReferenceMultipoleForce::setMutualInducedDipoleTargetEpsilon(double m
     _mutualInducedDipoleTargetEpsilon = mutualInducedDipoleTargetEpsilon;
 }
 
+void AmoebaReferenceMultipoleForce::setThreadPool(ThreadPool* threads)
+{
+    _threads = threads;
+}
+
+void AmoebaReferenceMultipoleForce::setInitialInducedDipoles(const vector<Vec3>& inducedDipole, const vector<Vec3>& inducedDipolePolar)
+{
+    _initialInducedDipole = inducedDipole;
+    _initialInducedDipolePolar = inducedDipolePolar;
+}
+
+void AmoebaReferenceMultipoleForce::getLastInducedDipoles(vector<Vec3>& inducedDipole, vector<Vec3>& inducedDipolePolar) const
+{
+    inducedDipole = _inducedDipole;
+    inducedDipolePolar = _inducedDipolePolar;
+}
+
+void AmoebaReferenceMultipoleForce::setPreconditionerCache(PreconditionerCache* cache)
+{
+    _preconditioner = cache;
+}
+
 void AmoebaReferenceMultipoleForce::setupScaleMaps(const vector< vector< vector<int> > >& multipoleParticleCovalentInfo)
 {
 
@@ -704,6 +731,15 @@ void AmoebaReferenceMultipoleForce::calculateFixedMultipoleFieldPairIxn(const Mu
                                                                         const MultipoleParticleData& particleJ,
                                                                         double dScale, double pScale)
 {
+    addFixedMultipoleFieldPairIxn(particleI, particleJ, dScale, pScale, _fixedMultipoleField, _fixedMultipoleFieldPolar);
+}
+
+void AmoebaReferenceMultipoleForce::addFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI,
+                                                                  const MultipoleParticleData& particleJ,
+                                                                  double dScale, double pScale,
+                                                                  vector<Vec3>& fixedMultipoleField,
+                                                                  vector<Vec3>& fixedMultipoleFieldPolar) const
+{
 
     if (particleI.particleIndex == particleJ.particleIndex)
         return;
@@ -736,8 +772,8 @@ void AmoebaReferenceMultipoleForce::calculateFixedMultipoleFieldPairIxn(const Mu
     Vec3 field                              = deltaR*factor + particleJ.dipole*rr3 - qDotDelta*rr5_2;
 
     unsigned int particleIndex                = particleI.particleIndex;
-    _fixedMultipoleField[particleIndex]      -= field*dScale;
-    _fixedMultipoleFieldPolar[particleIndex] -= field*pScale;
+    fixedMultipoleField[particleIndex]       -= field*dScale;
+    fixedMultipoleFieldPolar[particleIndex]  -= field*pScale;
 
     // field at particle J due multipoles at particle I
 
@@ -751,8 +787,8 @@ void AmoebaReferenceMultipoleForce::calculateFixedMultipoleFieldPairIxn(const Mu
 
     field                                     = deltaR*factor - particleI.dipole*rr3 - qDotDelta*rr5_2;
     particleIndex                             = particleJ.particleIndex;
-    _fixedMultipoleField[particleIndex]      += field*dScale;
-    _fixedMultipoleFieldPolar[particleIndex] += field*pScale;
+    fixedMultipoleField[particleIndex]       += field*dScale;
+    fixedMultipoleFieldPolar[particleIndex]  += field*pScale;
 }
 
 void AmoebaReferenceMultipoleForce::calculateFixedMultipoleField(const vector<MultipoleParticleData>& particleData)
@@ -760,11 +796,9 @@ void AmoebaReferenceMultipoleForce::calculateFixedMultipoleField(const vector<Mu
 
     // calculate fixed multipole fields
 
-    // loop includes diagonal term ii == jj for GK ixn; other calculateFixedMultipoleFieldPairIxn() methods
-    // skip calculations for this case
-
-    for (unsigned int ii = 0; ii < _numParticles; ii++) {
-        for (unsigned int jj = ii; jj < _numParticles; jj++) {
+    int numParticles = _numParticles;
+    auto computeRow = [&] (int ii, vector<Vec3>& field, vector<Vec3>& fieldPolar) {
+        for (int jj = ii+1; jj < numParticles; jj++) {
 
             // if site jj is less than max covalent scaling index then get/apply scaling constants
             // otherwise add unmodified field and fieldPolar to particle fields
@@ -774,9 +808,36 @@ void AmoebaReferenceMultipoleForce::calculateFixedMultipoleField(const vector<Mu
                 getDScaleAndPScale(ii, jj, dScale, pScale);
             else
                 dScale = pScale = 1.0;
-            calculateFixedMultipoleFieldPairIxn(particleData[ii], particleData[jj], dScale, pScale);
+            addFixedMultipoleFieldPairIxn(particleData[ii], particleData[jj], dScale, pScale, field, fieldPolar);
         }
+    };
+    if (_threads == NULL || _threads->getNumThreads() == 1) {
+        for (int ii = 0; ii < numParticles; ii++)
+            computeRow(ii, _fixedMultipoleField, _fixedMultipoleFieldPolar);
+        return;
     }
+
+    // Each thread accumulates into its own copy of the fields, using interleaved rows.
+
+    int numThreads = _threads->getNumThreads();
+    vector<vector<Vec3> > threadField(numThreads), threadFieldPolar(numThreads);
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        threadField[threadIndex].assign(numParticles, Vec3());
+        threadFieldPolar[threadIndex].assign(numParticles, Vec3());
+        for (int ii = threadIndex; ii < numParticles; ii += numThreads)
+            computeRow(ii, threadField[threadIndex], threadFieldPolar[threadIndex]);
+    });
+    _threads->waitForThreads();
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int t = 0; t < numThreads; t++)
+            for (int i = start; i < end; i++) {
+                _fixedMultipoleField[i] += threadField[t][i];
+                _fixedMultipoleFieldPolar[i] += threadFieldPolar[t][i];
+            }
+    });
+    _threads->waitForThreads();
 }
 
 void AmoebaReferenceMultipoleForce::initializeInducedDipoles(vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleFields)
@@ -888,9 +949,64 @@ void AmoebaReferenceMultipoleForce::calculateInducedDipoleFields(const vector<Mu
 
     // Add fields from all induced dipoles.
 
-    for (unsigned int ii = 0; ii < particleData.size(); ii++)
-        for (unsigned int jj = ii; jj < particleData.size(); jj++)
-            calculateInducedDipolePairIxns(particleData[ii], particleData[jj], updateInducedDipoleFields);
+    calculateInducedDipolePairFields(particleData, updateInducedDipoleFields, true,
+            [this] (const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ, vector<UpdateInducedDipoleFieldStruct>& fields) {
+        calculateInducedDipolePairIxns(particleI, particleJ, fields);
+    });
+}
+
+void AmoebaReferenceMultipoleForce::calculateInducedDipolePairFields(const vector<MultipoleParticleData>& particleData,
+                                                                     vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleFields, bool includeSelf,
+                                                                     std::function<void (const MultipoleParticleData&, const MultipoleParticleData&, vector<UpdateInducedDipoleFieldStruct>&)> pairIxn)
+{
+    int numParticles = particleData.size();
+    int firstOffset = (includeSelf ? 0 : 1);
+    if (_threads == NULL || _threads->getNumThreads() == 1) {
+        for (int ii = 0; ii < numParticles; ii++)
+            for (int jj = ii+firstOffset; jj < numParticles; jj++)
+                pairIxn(particleData[ii], particleData[jj], updateInducedDipoleFields);
+        return;
+    }
+
+    // Each thread accumulates into its own copy of the fields.  Rows are interleaved between
+    // threads so each one gets a similar share of the triangular loop.
+
+    int numThreads = _threads->getNumThreads();
+    int numFields = updateInducedDipoleFields.size();
+    vector<vector<UpdateInducedDipoleFieldStruct> > threadFields(numThreads, updateInducedDipoleFields);
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        vector<UpdateInducedDipoleFieldStruct>& fields = threadFields[threadIndex];
+        for (auto& field : fields) {
+            std::fill(field.inducedDipoleField.begin(), field.inducedDipoleField.end(), Vec3());
+            for (auto& gradient : field.inducedDipoleFieldGradient)
+                std::fill(gradient.begin(), gradient.end(), 0.0);
+        }
+        for (int ii = threadIndex; ii < numParticles; ii += numThreads)
+            for (int jj = ii+firstOffset; jj < numParticles; jj++)
+                pairIxn(particleData[ii], particleData[jj], fields);
+    });
+    _threads->waitForThreads();
+
+    // Add the contributions from all threads, with each thread handling a range of particles.
+
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int k = 0; k < numFields; k++) {
+            UpdateInducedDipoleFieldStruct& field = updateInducedDipoleFields[k];
+            bool hasGradient = (field.inducedDipoleFieldGradient.size() > 0);
+            for (int t = 0; t < numThreads; t++) {
+                const UpdateInducedDipoleFieldStruct& threadField = threadFields[t][k];
+                for (int i = start; i < end; i++) {
+                    field.inducedDipoleField[i] += threadField.inducedDipoleField[i];
+                    if (hasGradient)
+                        for (int m = 0; m < field.inducedDipoleFieldGradient[i].size(); m++)
+                            field.inducedDipoleFieldGradient[i][m] += threadField.inducedDipoleFieldGradient[i][m];
+                }
+            }
+        }
+    });
+    _threads->waitForThreads();
 }
 
 void AmoebaReferenceMultipoleForce::convergeInduceDipolesByExtrapolation(const vector<MultipoleParticleData>& particleData, vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleField) {
@@ -1009,6 +1125,239 @@ void AmoebaReferenceMultipoleForce::convergeInduceDipolesByDIIS(const vector<Mul
 
 }
 
+void AmoebaReferenceMultipoleForce::buildInducedDipolePreconditioner(const vector<MultipoleParticleData>& particleData)
+{
+
+    // The preconditioner approximates the inverse of (1/polarity - T) by 2*polarity + polarity*Ts*polarity,
+    // where Ts includes only the Thole damped dipole-dipole interactions within a short cutoff.  This is
+    // the same sparse preconditioner Tinker uses, with the same diagonal factor of 2 and the same 4.5
+    // Angstrom cutoff.  Without the factor of 2 it is often worse than no preconditioner.  It only depends on
+    // the positions and box, so if neither has changed since it was last built, reuse it.
+
+    PreconditionerCache& cache = *_preconditioner;
+    const Vec3* boxVectors = getPeriodicBoxVectors();
+    vector<Vec3> key(_numParticles);
+    for (unsigned int ii = 0; ii < _numParticles; ii++)
+        key[ii] = particleData[ii].position;
+    if (boxVectors != NULL)
+        key.insert(key.end(), boxVectors, boxVectors+3);
+    if (key == cache.positions)
+        return;
+    double cutoff = 0.45;
+    if (boxVectors != NULL)
+        cutoff = std::min(cutoff, 0.5*std::min(boxVectors[0][0], std::min(boxVectors[1][1], boxVectors[2][2])));
+
+    // Find pairs of polarizable particles within the cutoff.
+
+    vector<int> polarizable;
+    vector<Vec3> polarizablePositions;
+    for (unsigned int ii = 0; ii < _numParticles; ii++)
+        if (particleData[ii].polarity != 0.0) {
+            polarizable.push_back(ii);
+            polarizablePositions.push_back(particleData[ii].position);
+        }
+    NeighborList neighborList;
+    computeNeighborListVoxelHash(neighborList, polarizable.size(), polarizablePositions, vector<std::set<int> >(polarizable.size()),
+                                 boxVectors, boxVectors != NULL, cutoff, 0.0);
+
+    // Compute the upper triangle of the symmetric tensor rr3*I + rr5*deltaR*deltaR^T for each pair.
+
+    int numPairs = neighborList.size();
+    vector<double> pairTensors(6*numPairs);
+    auto computeTensors = [&] (int start, int end) {
+        vector<double> rrI(2);
+        for (int pair = start; pair < end; pair++) {
+            const MultipoleParticleData& particleI = particleData[polarizable[neighborList[pair].first]];
+            const MultipoleParticleData& particleJ = particleData[polarizable[neighborList[pair].second]];
+            Vec3 deltaR = particleJ.position - particleI.position;
+            getPeriodicDelta(deltaR);
+            getAndScaleInverseRs(particleI.dampingFactor, particleJ.dampingFactor, particleI.thole, particleJ.thole, sqrt(deltaR.dot(deltaR)), rrI);
+            double rr3 = -rrI[0];
+            double rr5 = rrI[1];
+            double* t = &pairTensors[6*pair];
+            t[0] = rr3 + rr5*deltaR[0]*deltaR[0];
+            t[1] = rr5*deltaR[0]*deltaR[1];
+            t[2] = rr5*deltaR[0]*deltaR[2];
+            t[3] = rr3 + rr5*deltaR[1]*deltaR[1];
+            t[4] = rr5*deltaR[1]*deltaR[2];
+            t[5] = rr3 + rr5*deltaR[2]*deltaR[2];
+        }
+    };
+    if (_threads == NULL || _threads->getNumThreads() == 1)
+        computeTensors(0, numPairs);
+    else {
+        int numThreads = _threads->getNumThreads();
+        _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+            computeTensors((int) ((long long) threadIndex*numPairs/numThreads), (int) ((long long) (threadIndex+1)*numPairs/numThreads));
+        });
+        _threads->waitForThreads();
+    }
+
+    // Store every pair in the rows of both particles so each row can be applied independently.
+
+    cache.rowStart.assign(_numParticles+1, 0);
+    for (auto& pair : neighborList) {
+        cache.rowStart[polarizable[pair.first]+1]++;
+        cache.rowStart[polarizable[pair.second]+1]++;
+    }
+    for (unsigned int ii = 0; ii < _numParticles; ii++)
+        cache.rowStart[ii+1] += cache.rowStart[ii];
+    cache.neighbors.resize(2*numPairs);
+    cache.tensors.resize(12*numPairs);
+    vector<int> nextEntry(cache.rowStart.begin(), cache.rowStart.end()-1);
+    for (int pair = 0; pair < numPairs; pair++) {
+        int ii = polarizable[neighborList[pair].first];
+        int jj = polarizable[neighborList[pair].second];
+        int entryI = nextEntry[ii]++;
+        int entryJ = nextEntry[jj]++;
+        cache.neighbors[entryI] = jj;
+        cache.neighbors[entryJ] = ii;
+        for (int m = 0; m < 6; m++) {
+            cache.tensors[6*entryI+m] = pairTensors[6*pair+m];
+            cache.tensors[6*entryJ+m] = pairTensors[6*pair+m];
+        }
+    }
+    cache.positions.swap(key);
+}
+
+void AmoebaReferenceMultipoleForce::applyInducedDipolePreconditioner(const vector<MultipoleParticleData>& particleData,
+                                                                     const vector<Vec3>& residual, vector<Vec3>& output) const
+{
+    const PreconditionerCache& cache = *_preconditioner;
+    output.resize(_numParticles);
+    auto applyRows = [&] (int start, int end) {
+        for (int ii = start; ii < end; ii++) {
+            Vec3 sum;
+            for (int entry = cache.rowStart[ii]; entry < cache.rowStart[ii+1]; entry++) {
+                const double* t = &cache.tensors[6*entry];
+                const Vec3& rj = residual[cache.neighbors[entry]];
+                sum += Vec3(t[0]*rj[0] + t[1]*rj[1] + t[2]*rj[2],
+                            t[1]*rj[0] + t[3]*rj[1] + t[4]*rj[2],
+                            t[2]*rj[0] + t[4]*rj[1] + t[5]*rj[2]);
+            }
+            output[ii] = residual[ii]*2.0 + sum*particleData[ii].polarity;
+        }
+    };
+    if (_threads == NULL || _threads->getNumThreads() == 1)
+        applyRows(0, _numParticles);
+    else {
+        int numThreads = _threads->getNumThreads();
+        _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+            applyRows(threadIndex*_numParticles/numThreads, (threadIndex+1)*_numParticles/numThreads);
+        });
+        _threads->waitForThreads();
+    }
+}
+
+bool AmoebaReferenceMultipoleForce::convergeInduceDipolesByPCG(const vector<MultipoleParticleData>& particleData, vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleField) {
+
+    // The induced dipoles satisfy (1/polarity - T)*mu = E, where T is the dipole field tensor and E is
+    // the fixed multipole field.  This matrix is symmetric, so we solve it with preconditioned conjugate
+    // gradients.  To avoid dividing by the polarity, residuals are stored multiplied by it.  This makes
+    // them identical to the errors used by DIIS, and they are zero for nonpolarizable particles.
+
+    // Inner product in which the equations are symmetric: sum(a[i].b[i]/polarity[i]).
+
+    auto polarityWeightedDot = [&] (const vector<Vec3>& a, const vector<Vec3>& b) {
+        double sum = 0.0;
+        for (int i = 0; i < _numParticles; i++)
+            if (particleData[i].polarity != 0.0)
+                sum += a[i].dot(b[i])/particleData[i].polarity;
+        return sum;
+    };
+    int numFields = updateInducedDipoleField.size();
+    setMutualInducedDipoleConverged(false);
+    buildInducedDipolePreconditioner(particleData);
+    calculateInducedDipoleFields(particleData, updateInducedDipoleField);
+    vector<vector<Vec3> > residual(numFields, vector<Vec3>(_numParticles));
+    vector<vector<Vec3> > preconditioned(numFields);
+    vector<vector<Vec3> > search(numFields);
+    vector<double> residualDotPreconditioned(numFields);
+    for (int k = 0; k < numFields; k++) {
+        UpdateInducedDipoleFieldStruct& field = updateInducedDipoleField[k];
+        for (int i = 0; i < _numParticles; i++)
+            residual[k][i] = (*field.fixedMultipoleField)[i] + field.inducedDipoleField[i]*particleData[i].polarity - (*field.inducedDipoles)[i];
+        applyInducedDipolePreconditioner(particleData, residual[k], preconditioned[k]);
+        search[k] = preconditioned[k];
+        residualDotPreconditioned[k] = polarityWeightedDot(residual[k], preconditioned[k]);
+    }
+    vector<UpdateInducedDipoleFieldStruct> searchField;
+    for (int k = 0; k < numFields; k++) {
+        UpdateInducedDipoleFieldStruct& field = updateInducedDipoleField[k];
+        searchField.push_back(UpdateInducedDipoleFieldStruct(*field.fixedMultipoleField, search[k], *field.extrapolatedDipoles, *field.extrapolatedDipoleFieldGradient));
+    }
+    int iteration = 0;
+    while (true) {
+        double maxEpsilon = 0;
+        for (int k = 0; k < numFields; k++) {
+            double epsilon = 0;
+            for (int i = 0; i < _numParticles; i++)
+                epsilon += residual[k][i].dot(residual[k][i]);
+            if (epsilon > maxEpsilon)
+                maxEpsilon = epsilon;
+        }
+        maxEpsilon = _debye*sqrt(maxEpsilon/_numParticles);
+        if (maxEpsilon < getMutualInducedDipoleTargetEpsilon() || iteration == getMaximumMutualInducedDipoleIterations())
+            break;
+        iteration++;
+
+        // Compute the field from the search directions and take a step along them.
+
+        calculateInducedDipoleFields(particleData, searchField);
+        for (int k = 0; k < numFields; k++) {
+            if (residualDotPreconditioned[k] == 0.0)
+                continue;
+            vector<Vec3>& p = search[k];
+            vector<Vec3>& tp = searchField[k].inducedDipoleField;
+            double pDotAp = 0.0;
+            for (int i = 0; i < _numParticles; i++)
+                if (particleData[i].polarity != 0.0)
+                    pDotAp += p[i].dot(p[i])/particleData[i].polarity - p[i].dot(tp[i]);
+            if (!(pDotAp > 0.0))
+                return false;
+            double alpha = residualDotPreconditioned[k]/pDotAp;
+            vector<Vec3>& dipoles = *updateInducedDipoleField[k].inducedDipoles;
+            for (int i = 0; i < _numParticles; i++) {
+                dipoles[i] += p[i]*alpha;
+                residual[k][i] -= (p[i] - tp[i]*particleData[i].polarity)*alpha;
+            }
+            applyInducedDipolePreconditioner(particleData, residual[k], preconditioned[k]);
+            double newResidualDotPreconditioned = polarityWeightedDot(residual[k], preconditioned[k]);
+            if (!(newResidualDotPreconditioned >= 0.0))
+                return false;
+            double beta = newResidualDotPreconditioned/residualDotPreconditioned[k];
+            residualDotPreconditioned[k] = newResidualDotPreconditioned;
+            for (int i = 0; i < _numParticles; i++)
+                p[i] = preconditioned[k][i] + p[i]*beta;
+        }
+    }
+
+    // Recompute the field from the final dipoles.  This leaves the fields (and for PME, the reciprocal
+    // space potentials) consistent with the dipoles, and it guards against the recursively updated
+    // residuals drifting away from the true ones.
+
+    calculateInducedDipoleFields(particleData, updateInducedDipoleField);
+    double maxEpsilon = 0;
+    for (int k = 0; k < numFields; k++) {
+        UpdateInducedDipoleFieldStruct& field = updateInducedDipoleField[k];
+        double epsilon = 0;
+        for (int i = 0; i < _numParticles; i++) {
+            Vec3 error = (*field.fixedMultipoleField)[i] + field.inducedDipoleField[i]*particleData[i].polarity - (*field.inducedDipoles)[i];
+            epsilon += error.dot(error);
+        }
+        if (epsilon > maxEpsilon)
+            maxEpsilon = epsilon;
+    }
+    maxEpsilon = _debye*sqrt(maxEpsilon/_numParticles);
+    bool converged = (maxEpsilon < getMutualInducedDipoleTargetEpsilon());
+    if (!converged && iteration < getMaximumMutualInducedDipoleIterations())
+        return false;
+    setMutualInducedDipoleConverged(converged);
+    setMutualInducedDipoleEpsilon(maxEpsilon);
+    setMutualInducedDipoleIterations(iteration);
+    return true;
+}
+
 void AmoebaReferenceMultipoleForce::computeDIISCoefficients(const vector<vector<Vec3> >& prevErrors, vector<double>& coefficients) const {
     int steps = coefficients.size();
     if (steps == 1) {
@@ -1079,9 +1428,17 @@ void AmoebaReferenceMultipoleForce::calculateInducedDipoles(const vector<Multipo
     }
 
     // UpdateInducedDipoleFieldStruct contains induced dipole, fixed multipole fields and fields
-    // due to other induced dipoles at each site
-    if (getPolarizationType() == AmoebaReferenceMultipoleForce::Mutual)
-        convergeInduceDipolesByDIIS(particleData, updateInducedDipoleField);
+    // due to other induced dipoles at each site.  For mutual polarization, start from the
+    // extrapolated guess if one was provided, and fall back to DIIS if the conjugate gradient
+    // solver breaks down.
+    if (getPolarizationType() == AmoebaReferenceMultipoleForce::Mutual) {
+        if (_initialInducedDipole.size() == _numParticles && _initialInducedDipolePolar.size() == _numParticles) {
+            _inducedDipole = _initialInducedDipole;
+            _inducedDipolePolar = _initialInducedDipolePolar;
+        }
+        if (!convergeInduceDipolesByPCG(particleData, updateInducedDipoleField))
+            convergeInduceDipolesByDIIS(particleData, updateInducedDipoleField);
+    }
     else if (getPolarizationType() == AmoebaReferenceMultipoleForce::Extrapolated)
         convergeInduceDipolesByExtrapolation(particleData, updateInducedDipoleField);
 }
@@ -1728,33 +2085,77 @@ void AmoebaReferenceMultipoleForce::mapTorqueToForce(vector<MultipoleParticleDat
     }
 }
 
-double AmoebaReferenceMultipoleForce::calculateElectrostatic(const vector<MultipoleParticleData>& particleData,
-                                                             vector<Vec3>& torques,
-                                                             vector<Vec3>& forces)
+double AmoebaReferenceMultipoleForce::calculateElectrostaticPairs(const vector<MultipoleParticleData>& particleData,
+                                                                  vector<Vec3>& torques, vector<Vec3>& forces,
+                                                                  std::function<double (const MultipoleParticleData&, const MultipoleParticleData&, const vector<double>&,
+                                                                                        vector<Vec3>&, vector<Vec3>&)> pairIxn)
 {
-    double energy = 0.0;
-    vector<double> scaleFactors(LAST_SCALE_TYPE_INDEX);
-    for (auto& s : scaleFactors)
-        s = 1.0;
+    int numParticles = particleData.size();
+    auto computeRow = [&] (int ii, vector<double>& scaleFactors, vector<Vec3>& forces, vector<Vec3>& torques) {
+        double energy = 0.0;
+        for (int jj = ii+1; jj < numParticles; jj++) {
+            if (jj <= _maxScaleIndex[ii])
+                getMultipoleScaleFactors(ii, jj, scaleFactors);
+            energy += pairIxn(particleData[ii], particleData[jj], scaleFactors, forces, torques);
+            if (jj <= _maxScaleIndex[ii])
+                for (auto& s : scaleFactors)
+                    s = 1.0;
+        }
+        return energy;
+    };
+    if (_threads == NULL || _threads->getNumThreads() == 1) {
+        vector<double> scaleFactors(LAST_SCALE_TYPE_INDEX, 1.0);
+        double energy = 0.0;
+        for (int ii = 0; ii < numParticles; ii++)
+            energy += computeRow(ii, scaleFactors, forces, torques);
+        return energy;
+    }
 
-    // main loop over particle pairs
+    // Each thread accumulates into its own copy of the forces and torques, using interleaved rows.
+
+    int numThreads = _threads->getNumThreads();
+    vector<vector<Vec3> > threadForces(numThreads), threadTorques(numThreads);
+    vector<double> threadEnergy(numThreads);
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        threadForces[threadIndex].assign(numParticles, Vec3());
+        threadTorques[threadIndex].assign(numParticles, Vec3());
+        vector<double> scaleFactors(LAST_SCALE_TYPE_INDEX, 1.0);
+        double energy = 0.0;
+        for (int ii = threadIndex; ii < numParticles; ii += numThreads)
+            energy += computeRow(ii, scaleFactors, threadForces[threadIndex], threadTorques[threadIndex]);
+        threadEnergy[threadIndex] = energy;
+    });
+    _threads->waitForThreads();
+    _threads->execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int t = 0; t < numThreads; t++)
+            for (int i = start; i < end; i++) {
+                forces[i] += threadForces[t][i];
+                torques[i] += threadTorques[t][i];
+            }
+    });
+    _threads->waitForThreads();
 
-    for (unsigned int ii = 0; ii < particleData.size(); ii++) {
-        for (unsigned int jj = ii+1; jj < particleData.size(); jj++) {
+    // Sum the energies in a fixed order so the result does not depend on scheduling.
 
-            if (jj <= _maxScaleIndex[ii]) {
-                getMultipoleScaleFactors(ii, jj, scaleFactors);
-            }
+    double energy = 0.0;
+    for (int t = 0; t < numThreads; t++)
+        energy += threadEnergy[t];
+    return energy;
+}
 
-            energy += calculateElectrostaticPairIxn(particleData[ii], particleData[jj], scaleFactors, forces, torques);
+double AmoebaReferenceMultipoleForce::calculateElectrostatic(const vector<MultipoleParticleData>& particleData,
+                                                             vector<Vec3>& torques,
+                                                             vector<Vec3>& forces)
+{
+    // main loop over particle pairs
 
-            if (jj <= _maxScaleIndex[ii]) {
-                for (unsigned int kk = 0; kk < LAST_SCALE_TYPE_INDEX; kk++) {
-                    scaleFactors[kk] = 1.0;
-                }
-            }
-        }
-    }
+    double energy = calculateElectrostaticPairs(particleData, torques, forces,
+            [this] (const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ, const vector<double>& scaleFactors,
+                    vector<Vec3>& forces, vector<Vec3>& torques) {
+        return calculateElectrostaticPairIxn(particleI, particleJ, scaleFactors, forces, torques);
+    });
     if (getPolarizationType() == AmoebaReferenceMultipoleForce::Extrapolated) {
         double prefac = (_electric/_dielectric);
         for (int i = 0; i < _numParticles; i++) {
@@ -2191,6 +2592,24 @@ void AmoebaReferenceGeneralizedKirkwoodMultipoleForce::zeroFixedMultipoleFields(
     initializeVec3Vector(_gkField);
 }
 
+void AmoebaReferenceGeneralizedKirkwoodMultipoleForce::calculateFixedMultipoleField(const vector<MultipoleParticleData>& particleData)
+{
+
+    // loop includes diagonal term ii == jj for the Kirkwood field; the vacuum part of
+    // calculateFixedMultipoleFieldPairIxn() skips calculations for this case
+
+    for (unsigned int ii = 0; ii < _numParticles; ii++) {
+        for (unsigned int jj = ii; jj < _numParticles; jj++) {
+            double dScale, pScale;
+            if (jj <= _maxScaleIndex[ii])
+                getDScaleAndPScale(ii, jj, dScale, pScale);
+            else
+                dScale = pScale = 1.0;
+            calculateFixedMultipoleFieldPairIxn(particleData[ii], particleData[jj], dScale, pScale);
+        }
+    }
+}
+
 void AmoebaReferenceGeneralizedKirkwoodMultipoleForce::calculateFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI,
                                                                                            const MultipoleParticleData& particleJ,
                                                                                            double dScale, double pScale)
@@ -5147,9 +5566,11 @@ void AmoebaReferencePmeMultipoleForce::initializeBSplineModuli()
     }
 }
 
-void AmoebaReferencePmeMultipoleForce::calculateFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI,
-                                                                           const MultipoleParticleData& particleJ,
-                                                                           double dscale, double pscale)
+void AmoebaReferencePmeMultipoleForce::addFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI,
+                                                                     const MultipoleParticleData& particleJ,
+                                                                     double dscale, double pscale,
+                                                                     vector<Vec3>& fixedMultipoleField,
+                                                                     vector<Vec3>& fixedMultipoleFieldPolar) const
 {
 
     unsigned int iIndex    = particleI.particleIndex;
@@ -5230,11 +5651,11 @@ void AmoebaReferencePmeMultipoleForce::calculateFixedMultipoleFieldPairIxn(const
     // increment the field at each site due to this interaction
 
 
-    _fixedMultipoleField[iIndex]      += fim - fid;
-    _fixedMultipoleField[jIndex]      += fjm - fjd;
+    fixedMultipoleField[iIndex]       += fim - fid;
+    fixedMultipoleField[jIndex]       += fjm - fjd;
 
-    _fixedMultipoleFieldPolar[iIndex] += fim - fip;
-    _fixedMultipoleFieldPolar[jIndex] += fjm - fjp;
+    fixedMultipoleFieldPolar[iIndex]  += fim - fip;
+    fixedMultipoleFieldPolar[jIndex]  += fjm - fjp;
 }
 
 void AmoebaReferencePmeMultipoleForce::calculateFixedMultipoleField(const vector<MultipoleParticleData>& particleData)
@@ -6146,11 +6567,10 @@ void AmoebaReferencePmeMultipoleForce::calculateInducedDipoleFields(const vector
 
     // Add fields from direct space interactions.
 
-    for (unsigned int ii = 0; ii < particleData.size(); ii++) {
-        for (unsigned int jj = ii + 1; jj < particleData.size(); jj++) {
-            calculateDirectInducedDipolePairIxns(particleData[ii], particleData[jj], updateInducedDipoleFields);
-        }
-    }
+    calculateInducedDipolePairFields(particleData, updateInducedDipoleFields, false,
+            [this] (const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ, vector<UpdateInducedDipoleFieldStruct>& fields) {
+        calculateDirectInducedDipolePairIxns(particleI, particleJ, fields);
+    });
 
     // reciprocal space ixns
 
@@ -6837,28 +7257,13 @@ double AmoebaReferencePmeMultipoleForce::calculatePmeDirectElectrostaticPairIxn(
 double AmoebaReferencePmeMultipoleForce::calculateElectrostatic(const vector<MultipoleParticleData>& particleData,
                                                                 vector<Vec3>& torques, vector<Vec3>& forces)
 {
-    double energy = 0.0;
-    vector<double> scaleFactors(LAST_SCALE_TYPE_INDEX);
-    for (auto& s : scaleFactors)
-        s = 1.0;
-
     // loop over particle pairs for direct space interactions
 
-    for (unsigned int ii = 0; ii < particleData.size(); ii++) {
-        for (unsigned int jj = ii+1; jj < particleData.size(); jj++) {
-
-            if (jj <= _maxScaleIndex[ii]) {
-                getMultipoleScaleFactors(ii, jj, scaleFactors);
-            }
-
-            energy += calculatePmeDirectElectrostaticPairIxn(particleData[ii], particleData[jj], scaleFactors, forces, torques);
-
-            if (jj <= _maxScaleIndex[ii]) {
-                for (auto& s : scaleFactors)
-                    s = 1.0;
-            }
-        }
-    }
+    double energy = calculateElectrostaticPairs(particleData, torques, forces,
+            [this] (const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ, const vector<double>& scaleFactors,
+                    vector<Vec3>& forces, vector<Vec3>& torques) {
+        return calculatePmeDirectElectrostaticPairIxn(particleI, particleJ, scaleFactors, forces, torques);
+    });
 
     // The polarization energy
     calculatePmeSelfTorque(particleData, torques);
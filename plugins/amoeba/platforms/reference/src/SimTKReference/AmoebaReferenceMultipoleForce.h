@@ -27,6 +27,8 @@
 #include "openmm/AmoebaMultipoleForce.h"
 #include "openmm/Vec3.h"
 #include "AmoebaReferenceGeneralizedKirkwoodForce.h"
+#include "openmm/internal/ThreadPool.h"
+#include <functional>
 #include <map>
 #include <complex>
 
@@ -467,6 +469,60 @@ public:
      */
     int getMaximumMutualInducedDipoleIterations() const;
 
+    /**
+     * Set the ThreadPool to use for parallelizing the field and electrostatic pair loops.  If this
+     * is not set, all calculations are done on the calling thread.
+     *
+     * @param threads the ThreadPool to use, or NULL
+     *
+     */
+    void setThreadPool(ThreadPool* threads);
+
+    /**
+     * Set the initial guess for the mutual induced dipoles.  This is typically extrapolated from the
+     * converged dipoles of previous steps.  It is ignored unless the polarization type is Mutual and
+     * the vectors have one element per particle.
+     *
+     * @param inducedDipole       initial guess for the induced dipoles
+     * @param inducedDipolePolar  initial guess for the polar induced dipoles
+     *
+     */
+    void setInitialInducedDipoles(const std::vector<Vec3>& inducedDipole, const std::vector<Vec3>& inducedDipolePolar);
+
+    /**
+     * Get the induced dipoles computed by the most recent calculation.
+     *
+     * @param inducedDipole       the induced dipoles are stored into this
+     * @param inducedDipolePolar  the polar induced dipoles are stored into this
+     *
+     */
+    void getLastInducedDipoles(std::vector<Vec3>& inducedDipole, std::vector<Vec3>& inducedDipolePolar) const;
+
+    /**
+     * The sparse preconditioner used by the conjugate gradient solver for mutual induced dipoles, stored
+     * in compressed row form with both (i, j) and (j, i) entries for every pair.  It only depends on the
+     * positions, the periodic box, and the particle parameters, so it can be kept between calculations.
+     */
+    class PreconditionerCache {
+    public:
+        /**
+         * The particle positions (followed by the box vectors, if periodic) the preconditioner was built for.
+         * Clear this to force it to be rebuilt, for example after particle parameters change.
+         */
+        std::vector<Vec3> positions;
+        std::vector<int> rowStart, neighbors;
+        std::vector<double> tensors;
+    };
+
+    /**
+     * Set the object in which to store the preconditioner for the mutual induced dipole solver.  The
+     * preconditioner is only rebuilt when the positions differ from the ones stored in it.  If this is
+     * not set, an internal object is used that only lasts as long as this one.
+     *
+     * @param cache the object to store the preconditioner in
+     */
+    void setPreconditionerCache(PreconditionerCache* cache);
+
     /**
      * Calculate force and energy.
      *
@@ -751,6 +807,12 @@ protected:
     double  _mutualInducedDipoleTargetEpsilon;
     double  _debye;
 
+    ThreadPool* _threads;
+    std::vector<Vec3> _initialInducedDipole;
+    std::vector<Vec3> _initialInducedDipolePolar;
+    PreconditionerCache* _preconditioner;
+    PreconditionerCache _localPreconditioner;
+
     /**
      * Helper constructor method to centralize initialization of objects.
      *
@@ -969,6 +1031,38 @@ protected:
     virtual void calculateFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ,
                                                      double dScale, double pScale);
 
+    /**
+     * Calculate the field at particle I due fixed multipoles at particle J and vice versa, adding them
+     * to the specified arrays instead of the member fields.  This allows calculateFixedMultipoleField()
+     * to call it from multiple threads at once.
+     *
+     * @param particleI               positions and parameters (charge, labFrame dipoles, quadrupoles, ...) for particle I
+     * @param particleJ               positions and parameters (charge, labFrame dipoles, quadrupoles, ...) for particle J
+     * @param dScale                  d-scale value for i-j interaction
+     * @param pScale                  p-scale value for i-j interaction
+     * @param field                   the direct field is added to this
+     * @param fieldPolar              the polar field is added to this
+     */
+    virtual void addFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ,
+                                               double dScale, double pScale, std::vector<Vec3>& field, std::vector<Vec3>& fieldPolar) const;
+
+    /**
+     * Loop over particle pairs (i, j) with j > i and accumulate electrostatic forces, torques, and energy.
+     * If a ThreadPool has been set, the pairs are divided between threads and each thread accumulates into
+     * its own copy of the forces and torques.
+     *
+     * @param particleData      vector of particle positions and parameters (charge, labFrame dipoles, quadrupoles, ...)
+     * @param torques           output torques
+     * @param forces            output forces
+     * @param pairIxn           the function to compute the interaction for one pair
+     *
+     * @return energy
+     */
+    double calculateElectrostaticPairs(const std::vector<MultipoleParticleData>& particleData,
+                                       std::vector<Vec3>& torques, std::vector<Vec3>& forces,
+                                       std::function<double (const MultipoleParticleData&, const MultipoleParticleData&, const std::vector<double>&,
+                                                             std::vector<Vec3>&, std::vector<Vec3>&)> pairIxn);
+
     /**
      * Initialize induced dipoles
      *
@@ -1011,6 +1105,50 @@ protected:
      */
     virtual void calculateInducedDipoleFields(const std::vector<MultipoleParticleData>& particleData,
                                               std::vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleFields);
+
+    /**
+     * Loop over particle pairs and accumulate the fields due to induced dipoles.  If a ThreadPool has been set,
+     * the pairs are divided between threads and each thread accumulates into its own copy of the fields.
+     *
+     * @param particleData              vector of particle positions and parameters (charge, labFrame dipoles, quadrupoles, ...)
+     * @param updateInducedDipoleFields vector of UpdateInducedDipoleFieldStruct containing input induced dipoles and output fields
+     * @param includeSelf               whether to call pairIxn for the pair (i, i)
+     * @param pairIxn                   the function to compute the interaction for one pair
+     */
+    void calculateInducedDipolePairFields(const std::vector<MultipoleParticleData>& particleData,
+                                          std::vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleFields, bool includeSelf,
+                                          std::function<void (const MultipoleParticleData&, const MultipoleParticleData&, std::vector<UpdateInducedDipoleFieldStruct>&)> pairIxn);
+
+    /**
+     * Build the sparse preconditioner used by convergeInduceDipolesByPCG().  For every pair of particles
+     * closer than a short cutoff, this records the Thole damped dipole-dipole interaction tensor.  Nothing
+     * is done if the preconditioner cache already holds one built for the current positions.
+     *
+     * @param particleData              vector of particle positions and parameters (charge, labFrame dipoles, quadrupoles, ...)
+     */
+    void buildInducedDipolePreconditioner(const std::vector<MultipoleParticleData>& particleData);
+
+    /**
+     * Apply the sparse preconditioner to the scaled residual of one set of induced dipoles.
+     *
+     * @param particleData              vector of particle positions and parameters (charge, labFrame dipoles, quadrupoles, ...)
+     * @param residual                  the residual multiplied by each particle's polarity
+     * @param output                    the preconditioned residual is stored into this
+     */
+    void applyInducedDipolePreconditioner(const std::vector<MultipoleParticleData>& particleData,
+                                          const std::vector<Vec3>& residual, std::vector<Vec3>& output) const;
+
+    /**
+     * Converge induced dipoles with a preconditioned conjugate gradient solver.  If the solver breaks down or
+     * fails to reach the target epsilon, this returns false and the caller should fall back to DIIS.
+     *
+     * @param particleData              vector of particle positions and parameters (charge, labFrame dipoles, quadrupoles, ...)
+     * @param updateInducedDipoleFields vector of UpdateInducedDipoleFieldStruct containing input induced dipoles and output fields
+     * @return true if the dipoles converged
+     */
+    virtual bool convergeInduceDipolesByPCG(const std::vector<MultipoleParticleData>& particleData,
+                                            std::vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleFields);
+
     /**
      * Calculated induced dipoles using extrapolated perturbation theory.
      *
@@ -1193,6 +1331,13 @@ protected:
      * 
      */
     virtual void getPeriodicDelta(Vec3& deltaR) const {};
+
+    /**
+     * Get the periodic box vectors, or NULL if periodic boundary conditions are not used.
+     */
+    virtual const Vec3* getPeriodicBoxVectors() const {
+        return NULL;
+    }
 };
 
 class AmoebaReferenceGeneralizedKirkwoodMultipoleForce : public AmoebaReferenceMultipoleForce {
@@ -1303,6 +1448,14 @@ private:
     void calculateFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ,
                                              double dScale, double pScale);
 
+    /**
+     * Calculate fixed multipole fields.  The pair interactions also accumulate the Kirkwood field,
+     * so this is done on a single thread.
+     *
+     * @param particleData vector of particle data
+     */
+    void calculateFixedMultipoleField(const vector<MultipoleParticleData>& particleData);
+
     /**
      * Calculate induced dipoles.
      * 
@@ -1520,6 +1673,13 @@ private:
      */
     void getPeriodicDelta(Vec3& deltaR) const;
 
+    /**
+     * Get the periodic box vectors.
+     */
+    const Vec3* getPeriodicBoxVectors() const {
+        return _periodicBoxVectors;
+    }
+
     /**
      * Calculate damped inverse distances.
      * 
@@ -1547,9 +1707,11 @@ private:
      * @param particleJ               positions and parameters (charge, labFrame dipoles, quadrupoles, ...) for particle J
      * @param dScale                  d-scale value for i-j interaction
      * @param pScale                  p-scale value for i-j interaction
+     * @param field                   the direct field is added to this
+     * @param fieldPolar              the polar field is added to this
      */
-    void calculateFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ,
-                                             double dscale, double pscale);
+    void addFixedMultipoleFieldPairIxn(const MultipoleParticleData& particleI, const MultipoleParticleData& particleJ,
+                                       double dscale, double pscale, std::vector<Vec3>& field, std::vector<Vec3>& fieldPolar) const;
     
     /**
      * Calculate fixed multipole fields.
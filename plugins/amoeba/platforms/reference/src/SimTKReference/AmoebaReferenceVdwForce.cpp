@@ -194,144 +194,132 @@ void AmoebaReferenceVdwForce::setReducedPositions(int numParticles,
     }
 }
 
-double AmoebaReferenceVdwForce::calculateForceAndEnergy(int numParticles, double lambda,
-                                                        const vector<Vec3>& particlePositions,
-                                                        vector<Vec3>& forces) const {
+double AmoebaReferenceVdwForce::calculatePairForce(int siteI, int siteJ, double lambda, const vector<Vec3>& reducedPositions,
+                                                   vector<Vec3>& forces) const {
 
-    // set reduced coordinates
+    double combinedSigma = sigmaMatrix[particleType[siteI]][particleType[siteJ]];
+    double combinedEpsilon = epsilonMatrix[particleType[siteI]][particleType[siteJ]];
 
-    std::vector<Vec3> reducedPositions;
-    setReducedPositions(numParticles, particlePositions, indexIVs, reductions, reducedPositions);
+    // Apply per particle scale factors (for CpHMD).
+    combinedEpsilon *= scaleFactors[siteI] * scaleFactors[siteJ];
 
-    // loop over all particle pairs
+    double softcore        = 0.0;
+    bool isAlchemicalI     = isAlchemical[siteI];
+    bool isAlchemicalJ     = isAlchemical[siteJ];
 
-    //    (1) initialize exclusion vector
-    //    (2) calculate pair ixn, if not excluded
-    //    (3) accumulate forces: if particle is a site where interaction position != particle position,
-    //        then call addReducedForce() to apportion force to particle and its covalent partner
-    //        based on reduction factor
-    //    (4) reset exclusion vector
+    if (this->_alchemicalMethod == AmoebaVdwForce::Decouple && (isAlchemicalI != isAlchemicalJ)) {
+       combinedEpsilon *= pow(lambda, this->_n);
+       softcore = this->_alpha * pow(1.0 - lambda, 2);
+    }
+    else if (this->_alchemicalMethod == AmoebaVdwForce::Annihilate && (isAlchemicalI || isAlchemicalJ)) {
+       combinedEpsilon *= pow(lambda, this->_n);
+       softcore = this->_alpha * pow(1.0 - lambda, 2);
+    }
 
-    double energy = 0.0;
-    std::vector<unsigned int> exclusions(numParticles, 0);
-    for (unsigned int ii = 0; ii < static_cast<unsigned int>(numParticles); ii++) {
-
-        bool isAlchemicalI = isAlchemical[ii];
-        for (int jj : allExclusions[ii])
-            exclusions[jj] = 1;
-
-        for (unsigned int jj = ii+1; jj < static_cast<unsigned int>(numParticles); jj++) {
-            if (exclusions[jj] == 0) {
-                double combinedSigma = sigmaMatrix[particleType[ii]][particleType[jj]];
-                double combinedEpsilon = epsilonMatrix[particleType[ii]][particleType[jj]];
-                double softcore = 0.0;
-
-                // Apply per particle scale factors (for CpHMD).
-                combinedEpsilon *= scaleFactors[ii] * scaleFactors[jj];
-
-                if (this->_alchemicalMethod == AmoebaVdwForce::Decouple && (isAlchemicalI != isAlchemical[jj])) {
-                   combinedEpsilon *= pow(lambda, this->_n);
-                   softcore = this->_alpha * pow(1.0 - lambda, 2);
-                }
-                else if (this->_alchemicalMethod == AmoebaVdwForce::Annihilate && (isAlchemicalI || isAlchemical[jj])) {
-                   combinedEpsilon *= pow(lambda, this->_n);
-                   softcore = this->_alpha * pow(1.0 - lambda, 2);
-                }
-
-                Vec3 force;
-                energy += calculatePairIxn(combinedSigma, combinedEpsilon, softcore,
-                                           reducedPositions[ii], reducedPositions[jj], force);
-
-                if (indexIVs[ii] == ii) {
-                    forces[ii][0] -= force[0];
-                    forces[ii][1] -= force[1];
-                    forces[ii][2] -= force[2];
-                }
-                else {
-                    addReducedForce(ii, indexIVs[ii], reductions[ii], -1.0, force, forces);
-                }
-                if (indexIVs[jj] == jj) {
-                    forces[jj][0] += force[0];
-                    forces[jj][1] += force[1];
-                    forces[jj][2] += force[2];
-                }
-                else {
-                    addReducedForce(jj, indexIVs[jj], reductions[jj], 1.0, force, forces);
-                }
-
-            }
-        }
+    Vec3 force;
+    double energy = calculatePairIxn(combinedSigma, combinedEpsilon, softcore,
+                                     reducedPositions[siteI], reducedPositions[siteJ], force);
 
-        for (int jj : allExclusions[ii])
-            exclusions[jj] = 0;
-    }
+    // accumulate forces: if particle is a site where interaction position != particle position,
+    // then call addReducedForce() to apportion force to particle and its covalent partner
+    // based on reduction factor
 
+    if (indexIVs[siteI] == siteI)
+        forces[siteI] -= force;
+    else
+        addReducedForce(siteI, indexIVs[siteI], reductions[siteI], -1.0, force, forces);
+    if (indexIVs[siteJ] == siteJ)
+        forces[siteJ] += force;
+    else
+        addReducedForce(siteJ, indexIVs[siteJ], reductions[siteJ], 1.0, force, forces);
+    return energy;
+}
+
+double AmoebaReferenceVdwForce::sumThreadResults(int numParticles, ThreadPool& threads, vector<Vec3>& forces) const {
+    int numThreads = threads.getNumThreads();
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++)
+            for (int j = 0; j < numThreads; j++)
+                forces[i] += threadForce[j][i];
+    });
+    threads.waitForThreads();
+
+    // Sum the energies in a fixed order so the result does not depend on scheduling.
+
+    double energy = 0.0;
+    for (int i = 0; i < numThreads; i++)
+        energy += threadEnergy[i];
     return energy;
 }
 
 double AmoebaReferenceVdwForce::calculateForceAndEnergy(int numParticles, double lambda,
                                                         const vector<Vec3>& particlePositions,
-                                                        const NeighborList& neighborList,
-                                                        vector<Vec3>& forces) const {
+                                                        vector<Vec3>& forces, ThreadPool& threads) const {
 
     // set reduced coordinates
 
     std::vector<Vec3> reducedPositions;
     setReducedPositions(numParticles, particlePositions, indexIVs, reductions, reducedPositions);
 
-    // loop over neighbor list
-    //    (1) calculate pair vdw ixn
-    //    (2) accumulate forces: if particle is a site where interaction position != particle position,
-    //        then call addReducedForce() to apportion force to particle and its covalent partner
-    //        based on reduction factor
-
-    double energy = 0.0;
-    for (unsigned int ii = 0; ii < neighborList.size(); ii++) {
-
-        OpenMM::AtomPair pair       = neighborList[ii];
-        int siteI                   = pair.first;
-        int siteJ                   = pair.second;
-
-        double combinedSigma = sigmaMatrix[particleType[siteI]][particleType[siteJ]];
-        double combinedEpsilon = epsilonMatrix[particleType[siteI]][particleType[siteJ]];
+    // loop over all particle pairs, dividing rows between threads.  Rows are interleaved
+    // so that each thread gets a similar share of the triangular pair matrix.
+    //    (1) initialize exclusion vector
+    //    (2) calculate pair ixn, if not excluded
+    //    (3) reset exclusion vector
+
+    int numThreads = threads.getNumThreads();
+    threadForce.resize(numThreads);
+    threadEnergy.resize(numThreads);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        vector<Vec3>& f = threadForce[threadIndex];
+        f.assign(numParticles, Vec3());
+        double energy = 0.0;
+        std::vector<unsigned int> exclusions(numParticles, 0);
+        for (int ii = threadIndex; ii < numParticles; ii += numThreads) {
+            for (int jj : allExclusions[ii])
+                exclusions[jj] = 1;
+            for (int jj = ii+1; jj < numParticles; jj++)
+                if (exclusions[jj] == 0)
+                    energy += calculatePairForce(ii, jj, lambda, reducedPositions, f);
+            for (int jj : allExclusions[ii])
+                exclusions[jj] = 0;
+        }
+        threadEnergy[threadIndex] = energy;
+    });
+    threads.waitForThreads();
+    return sumThreadResults(numParticles, threads, forces);
+}
 
-        // Apply per particle scale factors (for CpHMD).
-        combinedEpsilon *= scaleFactors[siteI] * scaleFactors[siteJ];
+double AmoebaReferenceVdwForce::calculateForceAndEnergy(int numParticles, double lambda,
+                                                        const vector<Vec3>& particlePositions,
+                                                        const NeighborList& neighborList,
+                                                        vector<Vec3>& forces, ThreadPool& threads) const {
 
-        double softcore        = 0.0;
-        int isAlchemicalI      = isAlchemical[siteI];
-        int isAlchemicalJ      = isAlchemical[siteJ];
+    // set reduced coordinates
 
-        if (this->_alchemicalMethod == AmoebaVdwForce::Decouple && (isAlchemicalI != isAlchemicalJ)) {
-           combinedEpsilon *= pow(lambda, this->_n);
-           softcore = this->_alpha * pow(1.0 - lambda, 2);
-        }
-        else if (this->_alchemicalMethod == AmoebaVdwForce::Annihilate && (isAlchemicalI || isAlchemicalJ)) {
-           combinedEpsilon *= pow(lambda, this->_n);
-           softcore = this->_alpha * pow(1.0 - lambda, 2);
-        }
+    std::vector<Vec3> reducedPositions;
+    setReducedPositions(numParticles, particlePositions, indexIVs, reductions, reducedPositions);
 
-        Vec3 force;
-        energy += calculatePairIxn(combinedSigma, combinedEpsilon, softcore,
-                                   reducedPositions[siteI], reducedPositions[siteJ], force);
-                
-        if (indexIVs[siteI] == siteI) {
-            forces[siteI][0] -= force[0];
-            forces[siteI][1] -= force[1];
-            forces[siteI][2] -= force[2];
-        }
-        else {
-            addReducedForce(siteI, indexIVs[siteI], reductions[siteI], -1.0, force, forces);
+    // loop over neighbor list, giving each thread a contiguous range of pairs
+
+    int numThreads = threads.getNumThreads();
+    int numPairs = neighborList.size();
+    threadForce.resize(numThreads);
+    threadEnergy.resize(numThreads);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        vector<Vec3>& f = threadForce[threadIndex];
+        f.assign(numParticles, Vec3());
+        double energy = 0.0;
+        int start = (int) ((long long) threadIndex*numPairs/numThreads);
+        int end = (int) ((long long) (threadIndex+1)*numPairs/numThreads);
+        for (int ii = start; ii < end; ii++) {
+            const OpenMM::AtomPair& pair = neighborList[ii];
+            energy += calculatePairForce(pair.first, pair.second, lambda, reducedPositions, f);
         }
-        if (indexIVs[siteJ] == siteJ) {
-            forces[siteJ][0] += force[0];
-            forces[siteJ][1] += force[1];
-            forces[siteJ][2] += force[2];
-        }
-        else {
-            addReducedForce(siteJ, indexIVs[siteJ], reductions[siteJ], 1.0, force, forces);
-        }
-    }
-
-    return energy;
+        threadEnergy[threadIndex] = energy;
+    });
+    threads.waitForThreads();
+    return sumThreadResults(numParticles, threads, forces);
 }
@@ -28,6 +28,7 @@
 #include "openmm/Vec3.h"
 #include "openmm/AmoebaVdwForce.h"
 #include "ReferenceNeighborList.h"
+#include "openmm/internal/ThreadPool.h"
 #include <set>
 #include <string>
 #include <vector>
@@ -90,13 +91,14 @@ public:
        @param lambda                  lambda value
        @param particlePositions       Cartesian coordinates of particles
        @param forces                  add forces to this vector
+       @param threads                 the ThreadPool to use for parallelizing the calculation
     
        @return energy
     
        --------------------------------------------------------------------------------------- */
     
     double calculateForceAndEnergy(int numParticles, double lambda, const std::vector<OpenMM::Vec3>& particlePositions,
-                                   std::vector<OpenMM::Vec3>& forces) const;
+                                   std::vector<OpenMM::Vec3>& forces, ThreadPool& threads) const;
          
     /**---------------------------------------------------------------------------------------
     
@@ -107,13 +109,14 @@ public:
        @param particlePositions       Cartesian coordinates of particles
        @param neighborList            neighbor list
        @param forces                  add forces to this vector
+       @param threads                 the ThreadPool to use for parallelizing the calculation
     
        @return energy
     
        --------------------------------------------------------------------------------------- */
     
     double calculateForceAndEnergy(int numParticles, double lambda, const std::vector<OpenMM::Vec3>& particlePositions, 
-                                   const NeighborList& neighborList, std::vector<OpenMM::Vec3>& forces) const;
+                                   const NeighborList& neighborList, std::vector<OpenMM::Vec3>& forces, ThreadPool& threads) const;
          
 private:
     // taper coefficient indices
@@ -139,6 +142,8 @@ private:
     std::vector<bool> isAlchemical;
     std::vector<std::set<int> > allExclusions;
     Vec3 _periodicBoxVectors[3];
+    mutable std::vector<std::vector<Vec3> > threadForce;
+    mutable std::vector<double> threadEnergy;
 
     /**---------------------------------------------------------------------------------------
     
@@ -207,6 +212,38 @@ private:
                             const Vec3& particleIPosition, const Vec3& particleJPosition,
                             Vec3& force) const;
 
+    /**---------------------------------------------------------------------------------------
+    
+       Calculate the interaction between two sites, including combining rules, per particle
+       scale factors, and alchemical softening, and add the resulting forces
+    
+       @param  siteI                index of the first particle
+       @param  siteJ                index of the second particle
+       @param  lambda               lambda value
+       @param  reducedPositions     interaction site positions
+       @param  forces               add forces to this vector
+    
+       @return energy for ixn
+
+       --------------------------------------------------------------------------------------- */
+    
+    double calculatePairForce(int siteI, int siteJ, double lambda, const std::vector<Vec3>& reducedPositions,
+                              std::vector<OpenMM::Vec3>& forces) const;
+
+    /**---------------------------------------------------------------------------------------
+    
+       Add the per-thread forces into the output vector and return the total energy
+    
+       @param  numParticles         number of particles
+       @param  threads              the ThreadPool used for the calculation
+       @param  forces               add forces to this vector
+    
+       @return the sum of the per-thread energies
+
+       --------------------------------------------------------------------------------------- */
+    
+    double sumThreadResults(int numParticles, ThreadPool& threads, std::vector<OpenMM::Vec3>& forces) const;
+
 };
 
 }
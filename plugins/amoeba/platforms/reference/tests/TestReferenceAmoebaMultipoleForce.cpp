@@ -29,5 +29,94 @@
 
 #include "ReferenceAmoebaTests.h"
 #include "TestAmoebaMultipoleForce.h"
+#include "AmoebaReferenceMultipoleForce.h"
+#include "sfmt/SFMT.h"
 
-void runPlatformTests() {}
+/**
+ * A multipole force that always solves for mutual induced dipoles with DIIS, as was done
+ * before the conjugate gradient solver was added.
+ */
+class DIISMultipoleForce : public AmoebaReferenceMultipoleForce {
+protected:
+    bool convergeInduceDipolesByPCG(const vector<MultipoleParticleData>& particleData, vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleFields) {
+        return false;
+    }
+};
+
+void testPCGInducedDipoles() {
+    // Build a box of water-like molecules with random permanent dipoles.
+
+    int gridSize = 4;
+    int numParticles = 3*gridSize*gridSize*gridSize;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    vector<double> charges, dipoles, quadrupoles(9*numParticles, 0.0), tholes(numParticles, 0.39), dampingFactors, polarity;
+    vector<int> axisTypes(numParticles, AmoebaMultipoleForce::NoAxisType), atomZ(numParticles, -1), atomX(numParticles, -1), atomY(numParticles, -1);
+    vector<vector<vector<int> > > covalentInfo(numParticles, vector<vector<int> >(AmoebaMultipoleForce::CovalentEnd));
+    for (int i = 0; i < gridSize; i++)
+        for (int j = 0; j < gridSize; j++)
+            for (int k = 0; k < gridSize; k++) {
+                int first = positions.size();
+                Vec3 center = Vec3(i, j, k)*0.31 + Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.02;
+                positions.push_back(center);
+                positions.push_back(center+Vec3(0.1, 0.0, 0.0));
+                positions.push_back(center+Vec3(-0.03, 0.095, 0.0));
+                for (int m = 0; m < 3; m++) {
+                    double alpha = (m == 0 ? 0.000837 : 0.000496);
+                    charges.push_back(m == 0 ? -0.5 : 0.25);
+                    polarity.push_back(alpha);
+                    dampingFactors.push_back(pow(alpha, 1.0/6.0));
+                    for (int n = 0; n < 3; n++)
+                        dipoles.push_back(0.01*(genrand_real2(sfmt)-0.5));
+                    for (int n = 0; n < 3; n++) {
+                        if (n != m)
+                            covalentInfo[first+m][m == 0 || n == 0 ? AmoebaMultipoleForce::Covalent12 : AmoebaMultipoleForce::Covalent13].push_back(first+n);
+                        covalentInfo[first+m][AmoebaMultipoleForce::PolarizationCovalent11].push_back(first+n);
+                    }
+                }
+            }
+
+    // Solve for the induced dipoles with DIIS and with PCG.  They should agree, and PCG should
+    // need fewer iterations.
+
+    DIISMultipoleForce diis;
+    diis.setPolarizationType(AmoebaReferenceMultipoleForce::Mutual);
+    diis.setMutualInducedDipoleTargetEpsilon(1e-6);
+    vector<Vec3> expectedDipoles;
+    diis.calculateInducedDipoles(positions, charges, dipoles, quadrupoles, tholes, dampingFactors, polarity, axisTypes,
+            atomZ, atomX, atomY, covalentInfo, expectedDipoles);
+    ASSERT(diis.getMutualInducedDipoleConverged());
+    AmoebaReferenceMultipoleForce::PreconditionerCache cache;
+    for (int numThreads : {1, 3}) {
+        ThreadPool threads(numThreads);
+        AmoebaReferenceMultipoleForce pcg;
+        pcg.setThreadPool(&threads);
+        pcg.setPreconditionerCache(&cache);
+        pcg.setPolarizationType(AmoebaReferenceMultipoleForce::Mutual);
+        pcg.setMutualInducedDipoleTargetEpsilon(1e-6);
+        vector<Vec3> inducedDipoles;
+        pcg.calculateInducedDipoles(positions, charges, dipoles, quadrupoles, tholes, dampingFactors, polarity, axisTypes,
+                atomZ, atomX, atomY, covalentInfo, inducedDipoles);
+        ASSERT(pcg.getMutualInducedDipoleConverged());
+        ASSERT(pcg.getMutualInducedDipoleIterations() < diis.getMutualInducedDipoleIterations());
+        for (int i = 0; i < numParticles; i++)
+            ASSERT_EQUAL_VEC(expectedDipoles[i], inducedDipoles[i], 1e-6);
+        ASSERT_EQUAL(numParticles, cache.positions.size());
+    }
+
+    // Moving a particle should cause the preconditioner to be rebuilt.
+
+    positions[0] += Vec3(0.01, 0.0, 0.0);
+    AmoebaReferenceMultipoleForce pcg;
+    pcg.setPreconditionerCache(&cache);
+    pcg.setPolarizationType(AmoebaReferenceMultipoleForce::Mutual);
+    vector<Vec3> inducedDipoles;
+    pcg.calculateInducedDipoles(positions, charges, dipoles, quadrupoles, tholes, dampingFactors, polarity, axisTypes,
+            atomZ, atomX, atomY, covalentInfo, inducedDipoles);
+    ASSERT_EQUAL_VEC(positions[0], cache.positions[0], 0.0);
+}
+
+void runPlatformTests() {
+    testPCGInducedDipoles();
+}
@@ -29,5 +29,64 @@
 
 #include "ReferenceAmoebaTests.h"
 #include "TestAmoebaVdwForce.h"
+#include "AmoebaReferenceVdwForce.h"
 
-void runPlatformTests() {}
+void testVdwThreads() {
+    // Computing the interaction on a thread pool should give the same result as computing it serially,
+    // both with and without a neighbor list.
+
+    int numParticles = 300;
+    double boxSize = 2.5;
+    double cutoff = 0.9;
+    AmoebaVdwForce force;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        int parent = (i%3 == 0 ? i : i-i%3);
+        force.addParticle(parent, 0.3+0.1*genrand_real2(sfmt), 0.1+0.5*genrand_real2(sfmt), (i == parent ? 0.0 : 0.9), i < 30);
+        positions[i] = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize;
+        if (i != parent)
+            positions[i] = positions[parent] + Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.1;
+    }
+    for (int i = 0; i < numParticles; i += 3) {
+        vector<int> exclusions = {i, i+1, i+2};
+        for (int j = 0; j < 3; j++)
+            force.setParticleExclusions(i+j, exclusions);
+    }
+    force.setCutoffDistance(cutoff);
+    Vec3 boxVectors[] = {Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize)};
+    for (bool periodic : {false, true}) {
+        force.setNonbondedMethod(periodic ? AmoebaVdwForce::CutoffPeriodic : AmoebaVdwForce::NoCutoff);
+        AmoebaReferenceVdwForce vdw;
+        vdw.initialize(force);
+        NeighborList neighborList;
+        if (periodic) {
+            computeNeighborListVoxelHash(neighborList, numParticles, positions, vdw.getExclusions(), boxVectors, true, cutoff, 0.0);
+            vdw.setPeriodicBox(boxVectors);
+        }
+        ThreadPool serial(1);
+        vector<Vec3> expectedForces(numParticles);
+        double expectedEnergy;
+        if (periodic)
+            expectedEnergy = vdw.calculateForceAndEnergy(numParticles, 0.7, positions, neighborList, expectedForces, serial);
+        else
+            expectedEnergy = vdw.calculateForceAndEnergy(numParticles, 0.7, positions, expectedForces, serial);
+        for (int numThreads : {2, 5}) {
+            ThreadPool threads(numThreads);
+            vector<Vec3> forces(numParticles);
+            double energy;
+            if (periodic)
+                energy = vdw.calculateForceAndEnergy(numParticles, 0.7, positions, neighborList, forces, threads);
+            else
+                energy = vdw.calculateForceAndEnergy(numParticles, 0.7, positions, forces, threads);
+            ASSERT_EQUAL_TOL(expectedEnergy, energy, 1e-10);
+            for (int i = 0; i < numParticles; i++)
+                ASSERT_EQUAL_VEC(expectedForces[i], forces[i], 1e-10);
+        }
+    }
+}
+
+void runPlatformTests() {
+    testVdwThreads();
+}
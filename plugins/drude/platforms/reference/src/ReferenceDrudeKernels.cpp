@@ -35,6 +35,8 @@
 #include "ReferenceConstraints.h"
 #include "ReferenceVirtualSites.h"
 #include "ReferenceForce.h"
+#include <algorithm>
+#include <functional>
 #include <set>
 
 using namespace OpenMM;
@@ -60,6 +62,11 @@ static Vec3* extractBoxVectors(ContextImpl& context) {
     return data->periodicBoxVectors;
 }
 
+static ThreadPool& extractThreadPool(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return data->threads;
+}
+
 static ReferenceConstraints& extractConstraints(ContextImpl& context) {
     ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
     return *data->constraints;
@@ -110,98 +117,137 @@ void ReferenceCalcDrudeForceKernel::initialize(const System& system, const Drude
     periodic = force.usesPeriodicBoundaryConditions();
 }
 
+double ReferenceCalcDrudeForceKernel::computeSpringForce(int index, const vector<Vec3>& pos, vector<Vec3>& force) const {
+    int p = particle[index];
+    int p1 = particle1[index];
+    int p2 = particle2[index];
+    int p3 = particle3[index];
+    int p4 = particle4[index];
+    double energy = 0;
+
+    double a1 = (p2 == -1 ? 1 : aniso12[index]);
+    double a2 = (p3 == -1 || p4 == -1 ? 1 : aniso34[index]);
+    double a3 = 3-a1-a2;
+    double k3 = ONE_4PI_EPS0*charge[index]*charge[index]/(polarizability[index]*a3);
+    double k1 = ONE_4PI_EPS0*charge[index]*charge[index]/(polarizability[index]*a1) - k3;
+    double k2 = ONE_4PI_EPS0*charge[index]*charge[index]/(polarizability[index]*a2) - k3;
+
+    // Compute the isotropic force.
+
+    Vec3 delta = pos[p]-pos[p1];
+    double r2 = delta.dot(delta);
+    energy += 0.5*k3*r2;
+    force[p] -= delta*k3;
+    force[p1] += delta*k3;
+
+    // Compute the first anisotropic force.
+
+    if (p2 != -1) {
+        Vec3 dir = pos[p1]-pos[p2];
+        double invDist = 1.0/sqrt(dir.dot(dir));
+        dir *= invDist;
+        double rprime = dir.dot(delta);
+        energy += 0.5*k1*rprime*rprime;
+        Vec3 f1 = dir*(k1*rprime); 
+        Vec3 f2 = (delta-dir*rprime)*(k1*rprime*invDist);
+        force[p] -= f1;
+        force[p1] += f1-f2;
+        force[p2] += f2;
+    }
+
+    // Compute the second anisotropic force.
+
+    if (p3 != -1 && p4 != -1) {
+        Vec3 dir = pos[p3]-pos[p4];
+        double invDist = 1.0/sqrt(dir.dot(dir));
+        dir *= invDist;
+        double rprime = dir.dot(delta);
+        energy += 0.5*k2*rprime*rprime;
+        Vec3 f1 = dir*(k2*rprime);
+        Vec3 f2 = (delta-dir*rprime)*(k2*rprime*invDist);
+        force[p] -= f1;
+        force[p1] += f1;
+        force[p3] -= f2;
+        force[p4] += f2;
+    }
+    return energy;
+}
+
+double ReferenceCalcDrudeForceKernel::computeScreenedPairForce(int index, const vector<Vec3>& pos, const Vec3* boxVectors, vector<Vec3>& force) const {
+    int dipole1 = pair1[index];
+    int dipole2 = pair2[index];
+    int dipole1Particles[] = {particle[dipole1], particle1[dipole1]};
+    int dipole2Particles[] = {particle[dipole2], particle1[dipole2]};
+    double uscale = pairThole[index]/pow(polarizability[dipole1]*polarizability[dipole2], 1.0/6.0);
+    double energy = 0;
+    for (int j = 0; j < 2; j++)
+        for (int k = 0; k < 2; k++) {
+            int p1 = dipole1Particles[j];
+            int p2 = dipole2Particles[k];
+            double chargeProduct = charge[dipole1]*charge[dipole2]*(j == k ? 1 : -1);
+            double deltaR[ReferenceForce::LastDeltaRIndex];
+            if (periodic)
+                ReferenceForce::getDeltaRPeriodic(pos[p2], pos[p1], boxVectors, deltaR);
+            else
+                ReferenceForce::getDeltaR(pos[p2], pos[p1], deltaR);
+            Vec3 delta(deltaR[ReferenceForce::XIndex], deltaR[ReferenceForce::YIndex], deltaR[ReferenceForce::ZIndex]);
+            double r = deltaR[ReferenceForce::RIndex];
+            double u = r*uscale;
+            double screening = 1.0 - (1.0+0.5*u)*exp(-u);
+            energy += ONE_4PI_EPS0*chargeProduct*screening/r;
+            Vec3 f = delta*(ONE_4PI_EPS0*chargeProduct/(r*r))*(screening/r-0.5*(1+u)*exp(-u)*uscale);
+            force[p1] += f;
+            force[p2] -= f;
+        }
+    return energy;
+}
+
 double ReferenceCalcDrudeForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
     vector<Vec3>& pos = extractPositions(context);
     vector<Vec3>& force = extractForces(context);
+    Vec3* boxVectors = extractBoxVectors(context);
+    ThreadPool& threads = extractThreadPool(context);
+    int numThreads = threads.getNumThreads();
     int numParticles = particle.size();
-    double energy = 0;
-    
-    // Compute the interactions from the harmonic springs.
-    
-    for (int i = 0; i < numParticles; i++) {
-        int p = particle[i];
-        int p1 = particle1[i];
-        int p2 = particle2[i];
-        int p3 = particle3[i];
-        int p4 = particle4[i];
-        
-        double a1 = (p2 == -1 ? 1 : aniso12[i]);
-        double a2 = (p3 == -1 || p4 == -1 ? 1 : aniso34[i]);
-        double a3 = 3-a1-a2;
-        double k3 = ONE_4PI_EPS0*charge[i]*charge[i]/(polarizability[i]*a3);
-        double k1 = ONE_4PI_EPS0*charge[i]*charge[i]/(polarizability[i]*a1) - k3;
-        double k2 = ONE_4PI_EPS0*charge[i]*charge[i]/(polarizability[i]*a2) - k3;
-        
-        // Compute the isotropic force.
-        
-        Vec3 delta = pos[p]-pos[p1];
-        double r2 = delta.dot(delta);
-        energy += 0.5*k3*r2;
-        force[p] -= delta*k3;
-        force[p1] += delta*k3;
-        
-        // Compute the first anisotropic force.
-        
-        if (p2 != -1) {
-            Vec3 dir = pos[p1]-pos[p2];
-            double invDist = 1.0/sqrt(dir.dot(dir));
-            dir *= invDist;
-            double rprime = dir.dot(delta);
-            energy += 0.5*k1*rprime*rprime;
-            Vec3 f1 = dir*(k1*rprime); 
-            Vec3 f2 = (delta-dir*rprime)*(k1*rprime*invDist);
-            force[p] -= f1;
-            force[p1] += f1-f2;
-            force[p2] += f2;
-        }
-        
-        // Compute the second anisotropic force.
-        
-        if (p3 != -1 && p4 != -1) {
-            Vec3 dir = pos[p3]-pos[p4];
-            double invDist = 1.0/sqrt(dir.dot(dir));
-            dir *= invDist;
-            double rprime = dir.dot(delta);
-            energy += 0.5*k2*rprime*rprime;
-            Vec3 f1 = dir*(k2*rprime);
-            Vec3 f2 = (delta-dir*rprime)*(k2*rprime*invDist);
-            force[p] -= f1;
-            force[p1] += f1;
-            force[p3] -= f2;
-            force[p4] += f2;
-        }
-    }
-    
-    // Compute the screened interaction between bonded dipoles.
-    
     int numPairs = pair1.size();
-    Vec3* boxVectors = extractBoxVectors(context);
-    for (int i = 0; i < numPairs; i++) {
-        int dipole1 = pair1[i];
-        int dipole2 = pair2[i];
-        int dipole1Particles[] = {particle[dipole1], particle1[dipole1]};
-        int dipole2Particles[] = {particle[dipole2], particle1[dipole2]};
-        double uscale = pairThole[i]/pow(polarizability[dipole1]*polarizability[dipole2], 1.0/6.0);
-        for (int j = 0; j < 2; j++)
-            for (int k = 0; k < 2; k++) {
-                int p1 = dipole1Particles[j];
-                int p2 = dipole2Particles[k];
-                double chargeProduct = charge[dipole1]*charge[dipole2]*(j == k ? 1 : -1);
-                double deltaR[ReferenceForce::LastDeltaRIndex];
-                if (periodic)
-                    ReferenceForce::getDeltaRPeriodic(pos[p2], pos[p1], boxVectors, deltaR);
-                else
-                    ReferenceForce::getDeltaR(pos[p2], pos[p1], deltaR);
-                Vec3 delta(deltaR[ReferenceForce::XIndex], deltaR[ReferenceForce::YIndex], deltaR[ReferenceForce::ZIndex]);
-                double r = deltaR[ReferenceForce::RIndex];
-                double u = r*uscale;
-                double screening = 1.0 - (1.0+0.5*u)*exp(-u);
-                energy += ONE_4PI_EPS0*chargeProduct*screening/r;
-                Vec3 f = delta*(ONE_4PI_EPS0*chargeProduct/(r*r))*(screening/r-0.5*(1+u)*exp(-u)*uscale);
-                force[p1] += f;
-                force[p2] -= f;
-            }
+    int numAtoms = force.size();
+
+    // Compute the harmonic springs and the screened interactions between bonded dipoles.
+    // Thread 0 accumulates directly into the context's forces, while every other thread
+    // uses its own buffer.
+
+    threadForce.resize(numThreads);
+    threadEnergy.resize(numThreads);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        vector<Vec3>* forces = &force;
+        if (threadIndex > 0) {
+            forces = &threadForce[threadIndex];
+            forces->assign(numAtoms, Vec3());
+        }
+        double energy = 0;
+        for (int i = threadIndex; i < numParticles; i += numThreads)
+            energy += computeSpringForce(i, pos, *forces);
+        for (int i = threadIndex; i < numPairs; i += numThreads)
+            energy += computeScreenedPairForce(i, pos, boxVectors, *forces);
+        threadEnergy[threadIndex] = energy;
+    });
+    threads.waitForThreads();
+
+    // Sum the forces from the other threads.
+
+    if (numThreads > 1) {
+        threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            int start = threadIndex*numAtoms/numThreads;
+            int end = (threadIndex+1)*numAtoms/numThreads;
+            for (int j = 1; j < numThreads; j++)
+                for (int i = start; i < end; i++)
+                    force[i] += threadForce[j][i];
+        });
+        threads.waitForThreads();
     }
+    double energy = 0;
+    for (int i = 0; i < numThreads; i++)
+        energy += threadEnergy[i];
     return energy;
 }
 
@@ -258,55 +304,85 @@ void ReferenceIntegrateDrudeLangevinStepKernel::execute(ContextImpl& context, co
     vector<Vec3>& pos = extractPositions(context);
     vector<Vec3>& vel = extractVelocities(context);
     vector<Vec3>& force = extractForces(context);
-    
-    // Update velocities of ordinary particles.
-    
+    ThreadPool& threads = data.threads;
+    int numThreads = threads.getNumThreads();
+    int numNormal = normalParticles.size();
+    int numPairs = pairParticles.size();
+
+    // Generate the random numbers on a single thread, in the same order they would be used
+    // by a serial loop over particles, so the trajectory does not depend on the number of
+    // threads.
+
+    randoms.resize(3*numNormal+6*numPairs);
+    for (int i = 0; i < numNormal; i++)
+        if (particleInvMass[normalParticles[i]] != 0.0)
+            for (int j = 0; j < 3; j++)
+                randoms[3*i+j] = SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
+    for (int i = 0; i < 6*numPairs; i++)
+        randoms[3*numNormal+i] = SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
+    const double* pairRandoms = &randoms[3*numNormal];
+
     const double vscale = exp(-integrator.getStepSize()*integrator.getFriction());
     const double fscale = (1-vscale)/integrator.getFriction();
     const double kT = BOLTZ*integrator.getTemperature();
     const double noisescale = sqrt(2*kT*integrator.getFriction())*sqrt(0.5*(1-vscale*vscale)/integrator.getFriction());
-    for (int index : normalParticles) {
-        double invMass = particleInvMass[index];
-        if (invMass != 0.0) {
-            double sqrtInvMass = sqrt(invMass);
-            for (int j = 0; j < 3; j++)
-                vel[index][j] = vscale*vel[index][j] + fscale*invMass*force[index][j] + noisescale*sqrtInvMass*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
-        }
-    }
-    
-    // Update velocities of Drude particle pairs.
-    
     const double vscaleDrude = exp(-integrator.getStepSize()*integrator.getDrudeFriction());
     const double fscaleDrude = (1-vscaleDrude)/integrator.getDrudeFriction();
     const double kTDrude = BOLTZ*integrator.getDrudeTemperature();
     const double noisescaleDrude = sqrt(2*kTDrude*integrator.getDrudeFriction())*sqrt(0.5*(1-vscaleDrude*vscaleDrude)/integrator.getDrudeFriction());
-    for (int i = 0; i < (int) pairParticles.size(); i++) {
-        int p1 = pairParticles[i].first;
-        int p2 = pairParticles[i].second;
-        double mass1fract = pairInvTotalMass[i]/particleInvMass[p1];
-        double mass2fract = pairInvTotalMass[i]/particleInvMass[p2];
-        double sqrtInvTotalMass = sqrt(pairInvTotalMass[i]);
-        double sqrtInvReducedMass = sqrt(pairInvReducedMass[i]);
-        Vec3 cmVel = vel[p1]*mass1fract+vel[p2]*mass2fract;
-        Vec3 relVel = vel[p2]-vel[p1];
-        Vec3 cmForce = force[p1]+force[p2];
-        Vec3 relForce = force[p2]*mass1fract - force[p1]*mass2fract;
-        for (int j = 0; j < 3; j++) {
-            cmVel[j] = vscale*cmVel[j] + fscale*pairInvTotalMass[i]*cmForce[j] + noisescale*sqrtInvTotalMass*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
-            relVel[j] = vscaleDrude*relVel[j] + fscaleDrude*pairInvReducedMass[i]*relForce[j] + noisescaleDrude*sqrtInvReducedMass*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        // Update velocities of ordinary particles.
+
+        int start = threadIndex*numNormal/numThreads;
+        int end = (threadIndex+1)*numNormal/numThreads;
+        for (int i = start; i < end; i++) {
+            int index = normalParticles[i];
+            double invMass = particleInvMass[index];
+            if (invMass != 0.0) {
+                double sqrtInvMass = sqrt(invMass);
+                for (int j = 0; j < 3; j++)
+                    vel[index][j] = vscale*vel[index][j] + fscale*invMass*force[index][j] + noisescale*sqrtInvMass*randoms[3*i+j];
+            }
         }
-        vel[p1] = cmVel-relVel*mass2fract;
-        vel[p2] = cmVel+relVel*mass1fract;
-    }
+
+        // Update velocities of Drude particle pairs.
+
+        start = threadIndex*numPairs/numThreads;
+        end = (threadIndex+1)*numPairs/numThreads;
+        for (int i = start; i < end; i++) {
+            int p1 = pairParticles[i].first;
+            int p2 = pairParticles[i].second;
+            double mass1fract = pairInvTotalMass[i]/particleInvMass[p1];
+            double mass2fract = pairInvTotalMass[i]/particleInvMass[p2];
+            double sqrtInvTotalMass = sqrt(pairInvTotalMass[i]);
+            double sqrtInvReducedMass = sqrt(pairInvReducedMass[i]);
+            Vec3 cmVel = vel[p1]*mass1fract+vel[p2]*mass2fract;
+            Vec3 relVel = vel[p2]-vel[p1];
+            Vec3 cmForce = force[p1]+force[p2];
+            Vec3 relForce = force[p2]*mass1fract - force[p1]*mass2fract;
+            for (int j = 0; j < 3; j++) {
+                cmVel[j] = vscale*cmVel[j] + fscale*pairInvTotalMass[i]*cmForce[j] + noisescale*sqrtInvTotalMass*pairRandoms[6*i+2*j];
+                relVel[j] = vscaleDrude*relVel[j] + fscaleDrude*pairInvReducedMass[i]*relForce[j] + noisescaleDrude*sqrtInvReducedMass*pairRandoms[6*i+2*j+1];
+            }
+            vel[p1] = cmVel-relVel*mass2fract;
+            vel[p2] = cmVel+relVel*mass1fract;
+        }
+    });
+    threads.waitForThreads();
 
     // Update the particle positions.
     
     int numParticles = particleInvMass.size();
     vector<Vec3> xPrime(numParticles);
     double dt = integrator.getStepSize();
-    for (int i = 0; i < numParticles; i++)
-        if (particleInvMass[i] != 0.0)
-            xPrime[i] = pos[i]+vel[i]*dt;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++)
+            if (particleInvMass[i] != 0.0)
+                xPrime[i] = pos[i]+vel[i]*dt;
+    });
+    threads.waitForThreads();
     
     // Apply constraints.
     
@@ -315,12 +391,17 @@ void ReferenceIntegrateDrudeLangevinStepKernel::execute(ContextImpl& context, co
     // Record the constrained positions and velocities.
     
     double dtInv = 1.0/dt;
-    for (int i = 0; i < numParticles; i++) {
-        if (particleInvMass[i] != 0.0) {
-            vel[i] = (xPrime[i]-pos[i])*dtInv;
-            pos[i] = xPrime[i];
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++) {
+            if (particleInvMass[i] != 0.0) {
+                vel[i] = (xPrime[i]-pos[i])*dtInv;
+                pos[i] = xPrime[i];
+            }
         }
-    }
+    });
+    threads.waitForThreads();
 
     // Apply hard wall constraints.
 
@@ -442,15 +523,22 @@ void ReferenceIntegrateDrudeSCFStepKernel::execute(ContextImpl& context, const D
     
     // Update the positions and velocities.
     
+    ThreadPool& threads = data.threads;
+    int numThreads = threads.getNumThreads();
     int numParticles = particleInvMass.size();
     vector<Vec3> xPrime(numParticles);
     double dt = integrator.getStepSize();
-    for (int i = 0; i < numParticles; i++) {
-        if (particleInvMass[i] != 0.0) {
-            vel[i] += force[i]*particleInvMass[i]*dt;
-            xPrime[i] = pos[i]+vel[i]*dt;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++) {
+            if (particleInvMass[i] != 0.0) {
+                vel[i] += force[i]*particleInvMass[i]*dt;
+                xPrime[i] = pos[i]+vel[i]*dt;
+            }
         }
-    }
+    });
+    threads.waitForThreads();
         
     // Apply constraints.
     
@@ -459,12 +547,17 @@ void ReferenceIntegrateDrudeSCFStepKernel::execute(ContextImpl& context, const D
     // Record the constrained positions and velocities.
     
     double dtInv = 1.0/dt;
-    for (int i = 0; i < numParticles; i++) {
-        if (particleInvMass[i] != 0.0) {
-            vel[i] = (xPrime[i]-pos[i])*dtInv;
-            pos[i] = xPrime[i];
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; i++) {
+            if (particleInvMass[i] != 0.0) {
+                vel[i] = (xPrime[i]-pos[i])*dtInv;
+                pos[i] = xPrime[i];
+            }
         }
-    }
+    });
+    threads.waitForThreads();
     
     // Update the positions of virtual sites and Drude particles.
     
@@ -478,16 +571,44 @@ double ReferenceIntegrateDrudeSCFStepKernel::computeKineticEnergy(ContextImpl& c
     return computeShiftedKineticEnergy(context, particleInvMass, 0.5*integrator.getStepSize());
 }
 
+double ReferenceIntegrateDrudeSCFStepKernel::sumOverDrudeParticles(const function<double (int, int)>& task) {
+    ThreadPool& threads = data.threads;
+    int numThreads = threads.getNumThreads();
+    int numDrude = particle.size();
+    threadSums.resize(numThreads);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        threadSums[threadIndex] = task(threadIndex*numDrude/numThreads, (threadIndex+1)*numDrude/numThreads);
+    });
+    threads.waitForThreads();
+    double sum = 0;
+    for (int i = 0; i < numThreads; i++)
+        sum += threadSums[i];
+    return sum;
+}
+
 void ReferenceIntegrateDrudeSCFStepKernel::minimize(ContextImpl& context, double tolerance) {
+    // Minimize the energy with respect to the Drude particle positions, holding all other particles
+    // fixed, using L-BFGS.  The inverse spring constants serve as the initial inverse Hessian, which
+    // is exact for an isolated Drude particle.  Steps that increase the energy are cut back.  It has
+    // converged once the force on every Drude particle is below the tolerance.
+
+    const int maxIterations = 50;
+    const int maxHistory = 8;
     vector<Vec3>& pos = extractPositions(context);
     vector<Vec3>& force = extractForces(context);
     int numDrude = particle.size();
-    double lastForce = 0;
-    for (int iteration = 0; iteration < 50; iteration++) {
-        context.calcForcesAndEnergy(true, false, context.getIntegrator().getIntegrationForceGroups());
-        double totalForce = 0;
-        for (int i = 0; i < numDrude; i++) {
-            int p = particle[i];
+    if (numDrude == 0)
+        return;
+    lastPos.resize(numDrude);
+    lastGradient.resize(numDrude);
+    direction.resize(numDrude);
+    invHessian.resize(numDrude);
+    historyS.resize(maxHistory, vector<Vec3>(numDrude));
+    historyY.resize(maxHistory, vector<Vec3>(numDrude));
+    vector<double> historyRho(maxHistory), historyAlpha(maxHistory);
+    int historySize = 0, historyNext = 0;
+    sumOverDrudeParticles([&] (int start, int end) {
+        for (int i = start; i < end; i++) {
             int p1 = particle1[i];
             int p2 = particle2[i];
             int p3 = particle3[i];
@@ -495,23 +616,158 @@ void ReferenceIntegrateDrudeSCFStepKernel::minimize(ContextImpl& context, double
             Vec3 fscale(k3[i], k3[i], k3[i]);
             if (p2 != -1) {
                 Vec3 dir = pos[p1]-pos[p2];
-                dir /= sqrt(dir.dot(dir));;
+                dir /= sqrt(dir.dot(dir));
                 fscale += k1[i]*dir;
             }
             if (p3 != -1 && p4 != -1) {
                 Vec3 dir = pos[p3]-pos[p4];
-                dir /= sqrt(dir.dot(dir));;
+                dir /= sqrt(dir.dot(dir));
                 fscale += k2[i]*dir;
             }
-            Vec3 f = force[p];
-            double f2 = f.dot(f);
-            totalForce += f2;
-            double damping = (sqrt(f2) > 10*tolerance ? 0.5 : 1.0);
-            for (int i = 0; i < 3; i++)
-                pos[p][i] += damping*f[i]/fscale[i];
+            invHessian[i] = Vec3(1/fscale[0], 1/fscale[1], 1/fscale[2]);
         }
-        if (sqrt(totalForce/(3*numDrude)) < tolerance || (iteration > 0 && totalForce > 0.9*lastForce))
+        return 0.0;
+    });
+    auto moveAlongDirection = [&] (double stepSize) {
+        sumOverDrudeParticles([&] (int start, int end) {
+            for (int i = start; i < end; i++)
+                pos[particle[i]] = lastPos[i]+direction[i]*stepSize;
+            return 0.0;
+        });
+    };
+    bool hasLastPos = false, converged = false;
+    double lastEnergy = 0, stepSize = 1;
+    for (int iteration = 0; iteration < maxIterations; iteration++) {
+        double energy = context.calcForcesAndEnergy(true, true, context.getIntegrator().getIntegrationForceGroups());
+        if (hasLastPos && energy > lastEnergy+1e-10*fabs(lastEnergy)) {
+            // The step increased the energy, so try a shorter one.  If that fails too, stop at the
+            // best positions found.
+
+            if (stepSize < 0.1) {
+                moveAlongDirection(0.0);
+                break;
+            }
+            stepSize *= 0.5;
+            moveAlongDirection(stepSize);
+            continue;
+        }
+
+        // Accept the new positions and record the change in position and gradient.
+
+        vector<Vec3>& s = historyS[historyNext];
+        vector<Vec3>& y = historyY[historyNext];
+        bool updateHistory = hasLastPos;
+        double tolerance2 = tolerance*tolerance;
+        double numUnconverged = sumOverDrudeParticles([&] (int start, int end) {
+            double count = 0;
+            for (int i = start; i < end; i++) {
+                int p = particle[i];
+                Vec3 gradient = -force[p];
+                if (updateHistory) {
+                    s[i] = pos[p]-lastPos[i];
+                    y[i] = gradient-lastGradient[i];
+                }
+                lastPos[i] = pos[p];
+                lastGradient[i] = gradient;
+                if (gradient.dot(gradient) >= tolerance2)
+                    count++;
+            }
+            return count;
+        });
+        lastEnergy = energy;
+        hasLastPos = true;
+        if (numUnconverged == 0) {
+            converged = true;
             break;
-        lastForce = totalForce;
+        }
+        if (updateHistory) {
+            double sy = sumOverDrudeParticles([&] (int start, int end) {
+                double sum = 0;
+                for (int i = start; i < end; i++)
+                    sum += s[i].dot(y[i]);
+                return sum;
+            });
+            if (sy > 0) {
+                historyRho[historyNext] = 1/sy;
+                historyNext = (historyNext+1)%maxHistory;
+                historySize = min(historySize+1, maxHistory);
+            }
+            else
+                historySize = 0;
+        }
+
+        // Compute the search direction with the L-BFGS two loop recursion.
+
+        sumOverDrudeParticles([&] (int start, int end) {
+            for (int i = start; i < end; i++)
+                direction[i] = lastGradient[i];
+            return 0.0;
+        });
+        for (int k = 0; k < historySize; k++) {
+            int index = (historyNext-1-k+maxHistory)%maxHistory;
+            const vector<Vec3>& sk = historyS[index];
+            const vector<Vec3>& yk = historyY[index];
+            double alpha = historyRho[index]*sumOverDrudeParticles([&] (int start, int end) {
+                double sum = 0;
+                for (int i = start; i < end; i++)
+                    sum += sk[i].dot(direction[i]);
+                return sum;
+            });
+            historyAlpha[index] = alpha;
+            sumOverDrudeParticles([&] (int start, int end) {
+                for (int i = start; i < end; i++)
+                    direction[i] -= yk[i]*alpha;
+                return 0.0;
+            });
+        }
+        sumOverDrudeParticles([&] (int start, int end) {
+            for (int i = start; i < end; i++)
+                for (int j = 0; j < 3; j++)
+                    direction[i][j] *= invHessian[i][j];
+            return 0.0;
+        });
+        for (int k = historySize-1; k >= 0; k--) {
+            int index = (historyNext-1-k+maxHistory)%maxHistory;
+            const vector<Vec3>& sk = historyS[index];
+            const vector<Vec3>& yk = historyY[index];
+            double beta = historyRho[index]*sumOverDrudeParticles([&] (int start, int end) {
+                double sum = 0;
+                for (int i = start; i < end; i++)
+                    sum += yk[i].dot(direction[i]);
+                return sum;
+            });
+            double scale = historyAlpha[index]-beta;
+            sumOverDrudeParticles([&] (int start, int end) {
+                for (int i = start; i < end; i++)
+                    direction[i] += sk[i]*scale;
+                return 0.0;
+            });
+        }
+
+        // The step is minus the inverse Hessian times the gradient.  If it is not a descent
+        // direction, discard the history and fall back to the diagonal preconditioner.
+
+        double slope = sumOverDrudeParticles([&] (int start, int end) {
+            double sum = 0;
+            for (int i = start; i < end; i++)
+                sum += direction[i].dot(lastGradient[i]);
+            return sum;
+        });
+        bool resetHistory = !(slope > 0);
+        if (resetHistory)
+            historySize = 0;
+        sumOverDrudeParticles([&] (int start, int end) {
+            for (int i = start; i < end; i++) {
+                if (resetHistory)
+                    for (int j = 0; j < 3; j++)
+                        direction[i][j] = lastGradient[i][j]*invHessian[i][j];
+                direction[i] = -direction[i];
+            }
+            return 0.0;
+        });
+        stepSize = 1;
+        moveAlongDirection(stepSize);
     }
+    if (!converged && hasLastPos)
+        moveAlongDirection(0.0);
 }
@@ -33,6 +33,7 @@
 #include "ReferencePlatform.h"
 #include "openmm/DrudeKernels.h"
 #include "openmm/Vec3.h"
+#include <functional>
 #include <utility>
 #include <vector>
 
@@ -71,10 +72,14 @@ public:
      */
     void copyParametersToContext(ContextImpl& context, const DrudeForce& force);
 private:
+    double computeSpringForce(int index, const std::vector<Vec3>& pos, std::vector<Vec3>& force) const;
+    double computeScreenedPairForce(int index, const std::vector<Vec3>& pos, const Vec3* boxVectors, std::vector<Vec3>& force) const;
     std::vector<int> particle, particle1, particle2, particle3, particle4;
     std::vector<double> charge, polarizability, aniso12, aniso34;
     std::vector<int> pair1, pair2;
     std::vector<double> pairThole;
+    std::vector<std::vector<Vec3> > threadForce;
+    std::vector<double> threadEnergy;
     bool periodic;
 };
 
@@ -117,6 +122,7 @@ private:
     std::vector<double> particleInvMass;
     std::vector<double> pairInvTotalMass;
     std::vector<double> pairInvReducedMass;
+    std::vector<double> randoms;
 };
 
 /**
@@ -152,11 +158,19 @@ public:
     double computeKineticEnergy(ContextImpl& context, const DrudeSCFIntegrator& integrator);
 private:
     void minimize(ContextImpl& context, double tolerance);
+    /**
+     * Divide the Drude particles between threads and sum the values returned by task(start, end)
+     * for each thread's range.
+     */
+    double sumOverDrudeParticles(const std::function<double (int, int)>& task);
     ReferencePlatform::PlatformData& data;
     std::vector<double> particleInvMass;
     double maxDrudeDistance;
     std::vector<int> particle, particle1, particle2, particle3, particle4;
     std::vector<double> k1, k2, k3;
+    std::vector<Vec3> lastPos, lastGradient, direction, invHessian;
+    std::vector<std::vector<Vec3> > historyS, historyY;
+    std::vector<double> threadSums;
 };
 
 } // namespace OpenMM
@@ -33,7 +33,28 @@ extern "C" void registerDrudeReferenceKernelFactories();
 
 using namespace OpenMM;
 
+/**
+ * The Drude kernels divide their work over the Context's thread pool.  The Reference platform always
+ * creates one thread per processor, so this subclass exposes the "Threads" property to let tests
+ * choose how many threads are used.
+ */
+class ThreadedReferencePlatform : public ReferencePlatform {
+public:
+    ThreadedReferencePlatform() {
+        platformProperties.push_back("Threads");
+        setPropertyDefaultValue("Threads", "1");
+    }
+    const std::string& getName() const {
+        static const std::string name = "ThreadedReference";
+        return name;
+    }
+};
+
+ThreadedReferencePlatform* threadedPlatform = NULL;
+
 void setupKernels (int argc, char* argv[]) {
+    threadedPlatform = new ThreadedReferencePlatform();
+    Platform::registerPlatform(threadedPlatform);
     registerDrudeReferenceKernelFactories();
     platform = dynamic_cast<ReferencePlatform&>(Platform::getPlatformByName("Reference"));
     initializeTests(argc, argv);
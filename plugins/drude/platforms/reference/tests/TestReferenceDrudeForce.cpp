@@ -30,4 +30,43 @@
 #include "ReferenceDrudeTests.h"
 #include "TestDrudeForce.h"
 
-void runPlatformTests() {}
+void testThreadCounts() {
+    // Create many anisotropic Drude particles with screened pairs, and make sure the result does not
+    // depend on how the work is divided between threads.
+
+    const int numMolecules = 300;
+    const double boxSize = 3.0;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    DrudeForce* drude = new DrudeForce();
+    drude->setUsesPeriodicBoundaryConditions(true);
+    system.addForce(drude);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numMolecules; i++) {
+        int first = system.getNumParticles();
+        Vec3 center = Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize;
+        for (int j = 0; j < 5; j++) {
+            system.addParticle(1.0);
+            positions.push_back(center+Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.1);
+        }
+        drude->addParticle(first+1, first, first+2, first+3, first+4, -1.0, 0.001, 0.8, 1.1);
+        if (i > 0)
+            drude->addScreenedPair(i-1, i, 2.5);
+    }
+    State state[2];
+    for (int i = 0; i < 2; i++) {
+        VerletIntegrator integ(0.001);
+        Context context(system, integ, *threadedPlatform, {{"Threads", i == 0 ? "1" : "3"}});
+        context.setPositions(positions);
+        state[i] = context.getState(State::Forces | State::Energy);
+    }
+    ASSERT_EQUAL_TOL(state[0].getPotentialEnergy(), state[1].getPotentialEnergy(), 1e-10);
+    for (int i = 0; i < system.getNumParticles(); i++)
+        ASSERT_EQUAL_VEC(state[0].getForces()[i], state[1].getForces()[i], 1e-10);
+}
+
+void runPlatformTests() {
+    testThreadCounts();
+}
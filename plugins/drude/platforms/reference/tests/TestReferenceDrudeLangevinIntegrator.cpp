@@ -30,4 +30,48 @@
 #include "ReferenceDrudeTests.h"
 #include "TestDrudeLangevinIntegrator.h"
 
-void runPlatformTests() {}
+void testThreadCounts() {
+    // Random numbers are generated in the same order regardless of the number of threads, so the
+    // trajectory should not depend on it.
+
+    const int numMolecules = 100;
+    const double boxSize = 2.5;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    nonbonded->setCutoffDistance(1.0);
+    DrudeForce* drude = new DrudeForce();
+    system.addForce(nonbonded);
+    system.addForce(drude);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numMolecules; i++) {
+        int startIndex = system.getNumParticles();
+        system.addParticle(10.0);
+        system.addParticle(0.5);
+        nonbonded->addParticle(1.0, 0.3, 0.5);
+        nonbonded->addParticle(-1.0, 1.0, 0.0);
+        nonbonded->addException(startIndex, startIndex+1, 0, 1, 0);
+        drude->addParticle(startIndex+1, startIndex, -1, -1, -1, -1.0, 0.001, 1, 1);
+        Vec3 pos = Vec3(i%5, (i/5)%5, i/25)*0.5 + Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.05;
+        positions.push_back(pos);
+        positions.push_back(pos+Vec3(0.01, 0, 0));
+    }
+    vector<Vec3> finalPositions[2];
+    for (int i = 0; i < 2; i++) {
+        DrudeLangevinIntegrator integ(300.0, 50.0, 10.0, 50.0, 0.0005);
+        integ.setRandomNumberSeed(5);
+        Context context(system, integ, *threadedPlatform, {{"Threads", i == 0 ? "1" : "3"}});
+        context.setPositions(positions);
+        integ.step(20);
+        finalPositions[i] = context.getState(State::Positions).getPositions();
+    }
+    for (int i = 0; i < system.getNumParticles(); i++)
+        ASSERT_EQUAL_VEC(finalPositions[0][i], finalPositions[1][i], 1e-8);
+}
+
+void runPlatformTests() {
+    testThreadCounts();
+}
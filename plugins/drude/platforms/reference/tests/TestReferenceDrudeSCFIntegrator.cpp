@@ -29,5 +29,117 @@
 
 #include "ReferenceDrudeTests.h"
 #include "TestDrudeSCFIntegrator.h"
+#include "openmm/CustomExternalForce.h"
 
-void runPlatformTests() {}
+void createPolarizableSystem(System& system, vector<Vec3>& positions) {
+    // Create a cluster of polarizable atoms, each made of a core and a Drude particle.
+
+    const int gridSize = 4;
+    const double spacing = 0.35;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    DrudeForce* drude = new DrudeForce();
+    system.addForce(nonbonded);
+    system.addForce(drude);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < gridSize; i++)
+        for (int j = 0; j < gridSize; j++)
+            for (int k = 0; k < gridSize; k++) {
+                int startIndex = system.getNumParticles();
+                system.addParticle(10.0);
+                system.addParticle(0.0);
+                double charge = (startIndex%4 == 0 ? 0.5 : -0.5);
+                nonbonded->addParticle(charge+1.0, 0.3, 0.5);
+                nonbonded->addParticle(-1.0, 1.0, 0.0);
+                nonbonded->addException(startIndex, startIndex+1, 0, 1, 0);
+                drude->addParticle(startIndex+1, startIndex, -1, -1, -1, -1.0, 0.001, 1, 1);
+                Vec3 pos = Vec3(i, j, k)*spacing + Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.05;
+                positions.push_back(pos);
+                positions.push_back(pos);
+            }
+}
+
+void testConvergence() {
+    // After every step, the force on each Drude particle should be below the requested tolerance.
+
+    const double tolerance = 0.01;
+    System system;
+    vector<Vec3> positions;
+    createPolarizableSystem(system, positions);
+    DrudeSCFIntegrator integ(0.001);
+    integ.setMinimizationErrorTolerance(tolerance);
+    Context context(system, integ, *threadedPlatform, {{"Threads", "3"}});
+    context.setPositions(positions);
+    context.setVelocitiesToTemperature(300.0, 1);
+    for (int i = 0; i < 10; i++) {
+        integ.step(1);
+        State state = context.getState(State::Forces);
+        for (int j = 1; j < system.getNumParticles(); j += 2)
+            ASSERT(sqrt(state.getForces()[j].dot(state.getForces()[j])) < tolerance);
+    }
+}
+
+void testThreadCounts() {
+    // The trajectory should not depend on the number of threads, beyond the differences allowed by
+    // the minimization tolerance.
+
+    System system;
+    vector<Vec3> positions;
+    createPolarizableSystem(system, positions);
+    vector<Vec3> finalPositions[2];
+    for (int i = 0; i < 2; i++) {
+        DrudeSCFIntegrator integ(0.001);
+        integ.setMinimizationErrorTolerance(0.01);
+        Context context(system, integ, *threadedPlatform, {{"Threads", i == 0 ? "1" : "3"}});
+        context.setPositions(positions);
+        context.setVelocitiesToTemperature(300.0, 1);
+        integ.step(10);
+        finalPositions[i] = context.getState(State::Positions).getPositions();
+    }
+    for (int i = 0; i < system.getNumParticles(); i++)
+        ASSERT_EQUAL_VEC(finalPositions[0][i], finalPositions[1][i], 1e-5);
+}
+
+void testRejectUphillStep() {
+    // A single Drude particle feels a stiff harmonic force in addition to its spring, so the step
+    // predicted from the spring constant alone overshoots.  It lands at the bottom of a narrow well,
+    // where the energy is much higher than at the start.  That step must be cut back rather than
+    // accepted, so the particle ends up at the minimum near the origin instead of in the well.
+
+    const double k = 100.0;
+    const double a = 1000.0;
+    const double x0 = 0.1;
+    const double width = 0.2;
+    const double offset = 0.3;
+    const double landing = x0-(2*a+k)*x0/k;
+    const double depth = -(2*a+k)*landing*width/(2*offset*exp(-offset*offset));
+    System system;
+    system.addParticle(0.0);
+    system.addParticle(0.0);
+    DrudeForce* drude = new DrudeForce();
+    drude->addParticle(1, 0, -1, -1, -1, 1.0, ONE_4PI_EPS0/k, 1, 1);
+    system.addForce(drude);
+    CustomExternalForce* external = new CustomExternalForce("a*x^2-depth*exp(-((x-center)/width)^2)");
+    external->addGlobalParameter("a", a);
+    external->addGlobalParameter("depth", depth);
+    external->addGlobalParameter("center", landing-offset*width);
+    external->addGlobalParameter("width", width);
+    external->addParticle(1);
+    system.addForce(external);
+    DrudeSCFIntegrator integ(0.001);
+    integ.setMinimizationErrorTolerance(1e-4);
+    Context context(system, integ, *threadedPlatform, {{"Threads", "3"}});
+    context.setPositions({Vec3(), Vec3(x0, 0, 0)});
+    double initialEnergy = context.getState(State::Energy).getPotentialEnergy();
+    integ.step(1);
+    State state = context.getState(State::Energy | State::Positions | State::Forces);
+    ASSERT(state.getPotentialEnergy() < initialEnergy);
+    ASSERT_EQUAL_VEC(Vec3(), state.getPositions()[1], 1e-6);
+    ASSERT(sqrt(state.getForces()[1].dot(state.getForces()[1])) < 1e-4);
+}
+
+void runPlatformTests() {
+    testConvergence();
+    testThreadCounts();
+    testRejectUphillStep();
+}
@@ -35,6 +35,7 @@
   #define POCKETFFT_NO_VECTORS
 #endif
 #include "pocketfft_hdronly.h"
+#include <algorithm>
 #include <complex>
 
 using namespace OpenMM;
@@ -55,6 +56,29 @@ static vector<Vec3>& extractForces(ContextImpl& context) {
     return *data->forces;
 }
 
+static ThreadPool& extractThreadPool(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return data->threads;
+}
+
+/**
+ * Compute FFTs of the given length along the first axis of a (length x numColumns) array,
+ * dividing the columns between threads.  Each thread's block of columns is transformed in
+ * a single call, which lets pocketfft vectorize across them.
+ */
+static void transformColumns(ThreadPool& threads, vector<complex<double> >& data, int length, int numColumns, bool forward) {
+    int numThreads = threads.getNumThreads();
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        size_t start = ((long long) threadIndex)*numColumns/numThreads;
+        size_t end = ((long long) threadIndex+1)*numColumns/numThreads;
+        if (start == end)
+            return;
+        pocketfft::stride_t stride = {(ptrdiff_t) (numColumns*sizeof(complex<double>)), (ptrdiff_t) sizeof(complex<double>)};
+        pocketfft::c2c({(size_t) length, end-start}, stride, stride, {0}, forward, &data[start], &data[start], 1.0, 1);
+    });
+    threads.waitForThreads();
+}
+
 void ReferenceIntegrateRPMDStepKernel::initialize(const System& system, const RPMDIntegrator& integrator) {
     int numCopies = integrator.getNumCopies();
     int numParticles = system.getNumParticles();
@@ -106,12 +130,11 @@ void ReferenceIntegrateRPMDStepKernel::initialize(const System& system, const RP
 void ReferenceIntegrateRPMDStepKernel::execute(ContextImpl& context, const RPMDIntegrator& integrator, bool forcesAreValid) {
     const int numCopies = positions.size();
     const int numParticles = positions[0].size();
+    const int numColumns = 3*numParticles;
     const double dt = integrator.getStepSize();
-    const double halfdt = 0.5*dt;
     const System& system = context.getSystem();
-    vector<Vec3>& pos = extractPositions(context);
-    vector<Vec3>& vel = extractVelocities(context);
-    vector<Vec3>& f = extractForces(context);
+    ThreadPool& threads = extractThreadPool(context);
+    const int numThreads = threads.getNumThreads();
     
     // Loop over copies and compute the force on each one.
     
@@ -120,87 +143,67 @@ void ReferenceIntegrateRPMDStepKernel::execute(ContextImpl& context, const RPMDI
 
     // Apply the PILE-L thermostat.
     
-    vector<complex<double>> v(numCopies);
-    vector<complex<double>> q(numCopies);
+    if (integrator.getApplyThermostat())
+        applyThermostat(context, integrator);
+
+    // Update velocities.
+    
+    updateVelocities(context, integrator);
+    
+    // Evolve the free ring polymer by transforming to the frequency domain.
+
     const double hbar = 1.054571628e-34*AVOGADRO/(1000*1e-12);
     const double scale = 1.0/sqrt((double) numCopies);
     const double nkT = numCopies*BOLTZ*integrator.getTemperature();
     const double twown = 2.0*nkT/hbar;
-    const double c1_0 = exp(-halfdt*integrator.getFriction());
-    const double c2_0 = sqrt(1.0-c1_0*c1_0);
-    if (integrator.getApplyThermostat()) {
-        for (int particle = 0; particle < numParticles; particle++) {
+    modePositions.resize(numCopies*numColumns);
+    modeVelocities.resize(numCopies*numColumns);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        for (int particle = threadIndex; particle < numParticles; particle += numThreads)
+            for (int component = 0; component < 3; component++)
+                for (int k = 0; k < numCopies; k++) {
+                    modePositions[k*numColumns+3*particle+component] = complex<double>(scale*positions[k][particle][component], 0.0);
+                    modeVelocities[k*numColumns+3*particle+component] = complex<double>(scale*velocities[k][particle][component], 0.0);
+                }
+    });
+    threads.waitForThreads();
+    transformColumns(threads, modePositions, numCopies, numColumns, true);
+    transformColumns(threads, modeVelocities, numCopies, numColumns, true);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        for (int particle = threadIndex; particle < numParticles; particle += numThreads) {
             if (system.getParticleMass(particle) == 0.0)
                 continue;
-            const double c3_0 = c2_0*sqrt(nkT/system.getParticleMass(particle));
             for (int component = 0; component < 3; component++) {
-                for (int k = 0; k < numCopies; k++)
-                    v[k] = complex<double>(scale*velocities[k][particle][component], 0.0);
-                pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, true, v.data(), v.data(), 1.0, 0);
-
-                // Apply a local Langevin thermostat to the centroid mode.
-
-                v[0].real(v[0].real()*c1_0 + c3_0*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
-
-                // Use critical damping white noise for the remaining modes.
-
-                for (int k = 1; k <= numCopies/2; k++) {
-                    const bool isCenter = (numCopies%2 == 0 && k == numCopies/2);
+                complex<double>* q = &modePositions[3*particle+component];
+                complex<double>* v = &modeVelocities[3*particle+component];
+                q[0] += v[0]*dt;
+                for (int k = 1; k < numCopies; k++) {
                     const double wk = twown*sin(k*M_PI/numCopies);
-                    const double c1 = exp(-2.0*wk*halfdt);
-                    const double c2 = sqrt((1.0-c1*c1)/2) * (isCenter ? sqrt(2.0) : 1.0);
-                    const double c3 = c2*sqrt(nkT/system.getParticleMass(particle));
-                    double rand1 = c3*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
-                    double rand2 = (isCenter ? 0.0 : c3*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
-                    v[k] = v[k]*c1 + complex<double>(rand1, rand2);
-                    if (k < numCopies-k)
-                        v[numCopies-k] = v[numCopies-k]*c1 + complex<double>(rand1, -rand2);
+                    const double wt = wk*dt;
+                    const double coswt = cos(wt);
+                    const double sinwt = sin(wt);
+                    const complex<double> vprime = v[k*numColumns]*coswt - q[k*numColumns]*(wk*sinwt); // Advance velocity from t to t+dt
+                    q[k*numColumns] = v[k*numColumns]*(sinwt/wk) + q[k*numColumns]*coswt; // Advance position from t to t+dt
+                    v[k*numColumns] = vprime;
                 }
-                pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, false, v.data(), v.data(), 1.0, 0);
-                for (int k = 0; k < numCopies; k++)
-                    velocities[k][particle][component] = scale*v[k].real();
             }
         }
-    }
-
-    // Update velocities.
-    
-    for (int i = 0; i < numCopies; i++)
-        for (int j = 0; j < numParticles; j++)
-            if (system.getParticleMass(j) != 0.0)
-                velocities[i][j] += forces[i][j]*(halfdt/system.getParticleMass(j));
-    
-    // Evolve the free ring polymer by transforming to the frequency domain.
-
-    for (int particle = 0; particle < numParticles; particle++) {
-        if (system.getParticleMass(particle) == 0.0)
-            continue;
-        for (int component = 0; component < 3; component++) {
-            for (int k = 0; k < numCopies; k++) {
-                q[k] = complex<double>(scale*positions[k][particle][component], 0.0);
-                v[k] = complex<double>(scale*velocities[k][particle][component], 0.0);
-            }
-            pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, true, q.data(), q.data(), 1.0, 0);
-            pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, true, v.data(), v.data(), 1.0, 0);
-            q[0] += v[0]*dt;
-            for (int k = 1; k < numCopies; k++) {
-                const double wk = twown*sin(k*M_PI/numCopies);
-                const double wt = wk*dt;
-                const double coswt = cos(wt);
-                const double sinwt = sin(wt);
-                const double wm = wk*system.getParticleMass(particle);
-                const complex<double> vprime = v[k]*coswt - q[k]*(wk*sinwt); // Advance velocity from t to t+dt
-                q[k] = v[k]*(sinwt/wk) + q[k]*coswt; // Advance position from t to t+dt
-                v[k] = vprime;
-            }
-            pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, false, q.data(), q.data(), 1.0, 0);
-            pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, false, v.data(), v.data(), 1.0, 0);
-            for (int k = 0; k < numCopies; k++) {
-                positions[k][particle][component] = scale*q[k].real();
-                velocities[k][particle][component] = scale*v[k].real();
-            }
+    });
+    threads.waitForThreads();
+    transformColumns(threads, modePositions, numCopies, numColumns, false);
+    transformColumns(threads, modeVelocities, numCopies, numColumns, false);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        for (int particle = threadIndex; particle < numParticles; particle += numThreads) {
+            if (system.getParticleMass(particle) == 0.0)
+                continue;
+            for (int component = 0; component < 3; component++)
+                for (int k = 0; k < numCopies; k++) {
+                    positions[k][particle][component] = scale*modePositions[k*numColumns+3*particle+component].real();
+                    velocities[k][particle][component] = scale*modeVelocities[k*numColumns+3*particle+component].real();
+                }
         }
-    }
+    });
+    threads.waitForThreads();
     
     // Calculate forces based on the updated positions.
     
@@ -208,26 +211,84 @@ void ReferenceIntegrateRPMDStepKernel::execute(ContextImpl& context, const RPMDI
 
     // Update velocities.
     
-    for (int i = 0; i < numCopies; i++)
-        for (int j = 0; j < numParticles; j++)
-            if (system.getParticleMass(j) != 0.0)
-                velocities[i][j] += forces[i][j]*(halfdt/system.getParticleMass(j));
+    updateVelocities(context, integrator);
 
     // Apply the PILE-L thermostat again.
     
-    if (integrator.getApplyThermostat()) {
-        for (int particle = 0; particle < numParticles; particle++) {
+    if (integrator.getApplyThermostat())
+        applyThermostat(context, integrator);
+    
+    // Update the time.
+    
+    context.setTime(context.getTime()+dt);
+}
+
+void ReferenceIntegrateRPMDStepKernel::updateVelocities(ContextImpl& context, const RPMDIntegrator& integrator) {
+    const int numCopies = positions.size();
+    const int numParticles = positions[0].size();
+    const double halfdt = 0.5*integrator.getStepSize();
+    const System& system = context.getSystem();
+    ThreadPool& threads = extractThreadPool(context);
+    const int numThreads = threads.getNumThreads();
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = 0; i < numCopies; i++)
+            for (int j = start; j < end; j++)
+                if (system.getParticleMass(j) != 0.0)
+                    velocities[i][j] += forces[i][j]*(halfdt/system.getParticleMass(j));
+    });
+    threads.waitForThreads();
+}
+
+void ReferenceIntegrateRPMDStepKernel::applyThermostat(ContextImpl& context, const RPMDIntegrator& integrator) {
+    const int numCopies = positions.size();
+    const int numParticles = positions[0].size();
+    const int numColumns = 3*numParticles;
+    const double halfdt = 0.5*integrator.getStepSize();
+    const System& system = context.getSystem();
+    ThreadPool& threads = extractThreadPool(context);
+    const int numThreads = threads.getNumThreads();
+    const double hbar = 1.054571628e-34*AVOGADRO/(1000*1e-12);
+    const double scale = 1.0/sqrt((double) numCopies);
+    const double nkT = numCopies*BOLTZ*integrator.getTemperature();
+    const double twown = 2.0*nkT/hbar;
+    const double c1_0 = exp(-halfdt*integrator.getFriction());
+    const double c2_0 = sqrt(1.0-c1_0*c1_0);
+
+    // Each degree of freedom uses exactly numCopies random numbers.  Generate them all on one thread,
+    // in the order a serial loop over particles would use them, so the result does not depend on the
+    // number of threads.
+
+    thermostatRandoms.resize(numColumns*numCopies);
+    for (int particle = 0; particle < numParticles; particle++)
+        if (system.getParticleMass(particle) != 0.0)
+            for (int i = 0; i < 3*numCopies; i++)
+                thermostatRandoms[3*particle*numCopies+i] = SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
+
+    // Transform the velocities of all particles to normal modes at once.
+
+    modeVelocities.resize(numCopies*numColumns);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        for (int particle = threadIndex; particle < numParticles; particle += numThreads)
+            for (int component = 0; component < 3; component++)
+                for (int k = 0; k < numCopies; k++)
+                    modeVelocities[k*numColumns+3*particle+component] = complex<double>(scale*velocities[k][particle][component], 0.0);
+    });
+    threads.waitForThreads();
+    transformColumns(threads, modeVelocities, numCopies, numColumns, true);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        for (int particle = threadIndex; particle < numParticles; particle += numThreads) {
             if (system.getParticleMass(particle) == 0.0)
                 continue;
             const double c3_0 = c2_0*sqrt(nkT/system.getParticleMass(particle));
             for (int component = 0; component < 3; component++) {
-                for (int k = 0; k < numCopies; k++)
-                    v[k] = complex<double>(scale*velocities[k][particle][component], 0.0);
-                pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, true, v.data(), v.data(), 1.0, 0);
+                complex<double>* v = &modeVelocities[3*particle+component];
+                const double* randoms = &thermostatRandoms[(3*particle+component)*numCopies];
 
                 // Apply a local Langevin thermostat to the centroid mode.
 
-                v[0].real(v[0].real()*c1_0 + c3_0*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
+                v[0].real(v[0].real()*c1_0 + c3_0*(*randoms++));
 
                 // Use critical damping white noise for the remaining modes.
 
@@ -237,30 +298,38 @@ void ReferenceIntegrateRPMDStepKernel::execute(ContextImpl& context, const RPMDI
                     const double c1 = exp(-2.0*wk*halfdt);
                     const double c2 = sqrt((1.0-c1*c1)/2) * (isCenter ? sqrt(2.0) : 1.0);
                     const double c3 = c2*sqrt(nkT/system.getParticleMass(particle));
-                    double rand1 = c3*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
-                    double rand2 = (isCenter ? 0.0 : c3*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
-                    v[k] = v[k]*c1 + complex<double>(rand1, rand2);
+                    double rand1 = c3*(*randoms++);
+                    double rand2 = (isCenter ? 0.0 : c3*(*randoms++));
+                    v[k*numColumns] = v[k*numColumns]*c1 + complex<double>(rand1, rand2);
                     if (k < numCopies-k)
-                        v[numCopies-k] = v[numCopies-k]*c1 + complex<double>(rand1, -rand2);
+                        v[(numCopies-k)*numColumns] = v[(numCopies-k)*numColumns]*c1 + complex<double>(rand1, -rand2);
                 }
-                pocketfft::c2c({(size_t) numCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, false, v.data(), v.data(), 1.0, 0);
-                for (int k = 0; k < numCopies; k++)
-                    velocities[k][particle][component] = scale*v[k].real();
             }
         }
-    }
-    
-    // Update the time.
-    
-    context.setTime(context.getTime()+dt);
+    });
+    threads.waitForThreads();
+    transformColumns(threads, modeVelocities, numCopies, numColumns, false);
+    threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        for (int particle = threadIndex; particle < numParticles; particle += numThreads) {
+            if (system.getParticleMass(particle) == 0.0)
+                continue;
+            for (int component = 0; component < 3; component++)
+                for (int k = 0; k < numCopies; k++)
+                    velocities[k][particle][component] = scale*modeVelocities[k*numColumns+3*particle+component].real();
+        }
+    });
+    threads.waitForThreads();
 }
 
 void ReferenceIntegrateRPMDStepKernel::computeForces(ContextImpl& context, const RPMDIntegrator& integrator) {
     const int totalCopies = positions.size();
     const int numParticles = positions[0].size();
+    const int numColumns = 3*numParticles;
     vector<Vec3>& pos = extractPositions(context);
     vector<Vec3>& vel = extractVelocities(context);
     vector<Vec3>& f = extractForces(context);
+    ThreadPool& threads = extractThreadPool(context);
+    const int numThreads = threads.getNumThreads();
     
     // Compute forces from all groups that didn't have a specified contraction.
     
@@ -283,32 +352,37 @@ void ReferenceIntegrateRPMDStepKernel::computeForces(ContextImpl& context, const
     
     // Now loop over contractions and compute forces from them.
     
+    modePositions.resize(totalCopies*numColumns);
     for (auto& g : groupsByCopies) {
         int copies = g.first;
         int groupFlags = g.second;
+        int start = (copies+1)/2;
+        int end = totalCopies-copies+start;
         
-        // Find the contracted positions.
+        // Find the contracted positions.  Transform to the frequency domain, set high frequency
+        // components to zero, and transform back.
         
-        vector<complex<double>> q(totalCopies);
         const double scale1 = 1.0/totalCopies;
-        for (int particle = 0; particle < numParticles; particle++) {
-            for (int component = 0; component < 3; component++) {
-                // Transform to the frequency domain, set high frequency components to zero, and transform back.
-                
-                for (int k = 0; k < totalCopies; k++)
-                    q[k] = complex<double>(positions[k][particle][component], 0.0);
-                pocketfft::c2c({(size_t) totalCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, true, q.data(), q.data(), 1.0, 0);
-                if (copies > 1) {
-                    int start = (copies+1)/2;
-                    int end = totalCopies-copies+start;
-                    for (int k = end; k < totalCopies; k++)
-                        q[k-(totalCopies-copies)] = q[k];
-                    pocketfft::c2c({(size_t) copies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, false, q.data(), q.data(), 1.0, 0);
-                }
-                for (int k = 0; k < copies; k++)
-                    contractedPositions[k][particle][component] = scale1*q[k].real();
-            }
+        threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            for (int particle = threadIndex; particle < numParticles; particle += numThreads)
+                for (int component = 0; component < 3; component++)
+                    for (int k = 0; k < totalCopies; k++)
+                        modePositions[k*numColumns+3*particle+component] = complex<double>(positions[k][particle][component], 0.0);
+        });
+        threads.waitForThreads();
+        transformColumns(threads, modePositions, totalCopies, numColumns, true);
+        if (copies > 1) {
+            for (int k = end; k < totalCopies; k++)
+                copy(&modePositions[k*numColumns], &modePositions[(k+1)*numColumns], &modePositions[(k-(totalCopies-copies))*numColumns]);
+            transformColumns(threads, modePositions, copies, numColumns, false);
         }
+        threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            for (int particle = threadIndex; particle < numParticles; particle += numThreads)
+                for (int component = 0; component < 3; component++)
+                    for (int k = 0; k < copies; k++)
+                        contractedPositions[k][particle][component] = scale1*modePositions[k*numColumns+3*particle+component].real();
+        });
+        threads.waitForThreads();
         
         // Compute forces.
 
@@ -319,28 +393,30 @@ void ReferenceIntegrateRPMDStepKernel::computeForces(ContextImpl& context, const
             contractedForces[i] = f;
         }
         
-        // Apply the forces to the original copies.
+        // Apply the forces to the original copies.  Transform to the frequency domain, pad with
+        // zeros, and transform back.
         
         const double scale2 = 1.0/copies;
-        for (int particle = 0; particle < numParticles; particle++) {
-            for (int component = 0; component < 3; component++) {
-                // Transform to the frequency domain, pad with zeros, and transform back.
-                
-                for (int k = 0; k < copies; k++)
-                    q[k] = complex<double>(contractedForces[k][particle][component], 0.0);
-                if (copies > 1)
-                    pocketfft::c2c({(size_t) copies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, true, q.data(), q.data(), 1.0, 0);
-                int start = (copies+1)/2;
-                int end = totalCopies-copies+start;
-                for (int k = end; k < totalCopies; k++)
-                    q[k] = q[k-(totalCopies-copies)];
-                for (int k = start; k < end; k++)
-                    q[k] = complex<double>(0, 0);
-                pocketfft::c2c({(size_t) totalCopies}, {sizeof(complex<double>)}, {sizeof(complex<double>)}, {0}, false, q.data(), q.data(), 1.0, 0);
-                for (int k = 0; k < totalCopies; k++)
-                    forces[k][particle][component] += scale2*q[k].real();
-            }
-        }
+        threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            for (int particle = threadIndex; particle < numParticles; particle += numThreads)
+                for (int component = 0; component < 3; component++)
+                    for (int k = 0; k < copies; k++)
+                        modePositions[k*numColumns+3*particle+component] = complex<double>(contractedForces[k][particle][component], 0.0);
+        });
+        threads.waitForThreads();
+        if (copies > 1)
+            transformColumns(threads, modePositions, copies, numColumns, true);
+        for (int k = totalCopies-1; k >= end; k--)
+            copy(&modePositions[(k-(totalCopies-copies))*numColumns], &modePositions[(k-(totalCopies-copies)+1)*numColumns], &modePositions[k*numColumns]);
+        fill(&modePositions[start*numColumns], &modePositions[end*numColumns], complex<double>(0, 0));
+        transformColumns(threads, modePositions, totalCopies, numColumns, false);
+        threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            for (int particle = threadIndex; particle < numParticles; particle += numThreads)
+                for (int component = 0; component < 3; component++)
+                    for (int k = 0; k < totalCopies; k++)
+                        forces[k][particle][component] += scale2*modePositions[k*numColumns+3*particle+component].real();
+        });
+        threads.waitForThreads();
     }
 }
 
@@ -33,6 +33,7 @@
 #include "ReferencePlatform.h"
 #include "openmm/RpmdKernels.h"
 #include "openmm/Vec3.h"
+#include <complex>
 
 namespace OpenMM {
 
@@ -82,11 +83,15 @@ public:
     void copyToContext(int copy, ContextImpl& context);
 private:
     void computeForces(ContextImpl& context, const RPMDIntegrator& integrator);
+    void updateVelocities(ContextImpl& context, const RPMDIntegrator& integrator);
+    void applyThermostat(ContextImpl& context, const RPMDIntegrator& integrator);
     std::vector<std::vector<Vec3> > positions;
     std::vector<std::vector<Vec3> > velocities;
     std::vector<std::vector<Vec3> > forces;
     std::vector<std::vector<Vec3> > contractedPositions;
     std::vector<std::vector<Vec3> > contractedForces;
+    std::vector<std::complex<double> > modePositions, modeVelocities;
+    std::vector<double> thermostatRandoms;
     std::map<int, int> groupsByCopies;
     int groupsNotContracted;
 };
@@ -34,6 +34,7 @@
 #include "openmm/internal/AssertionUtilities.h"
 #include "openmm/CMMotionRemover.h"
 #include "openmm/Context.h"
+#include "openmm/CustomExternalForce.h"
 #include "openmm/CustomNonbondedForce.h"
 #include "openmm/HarmonicBondForce.h"
 #include "openmm/NonbondedForce.h"
@@ -423,6 +424,50 @@ void testContractions() {
     ASSERT_USUALLY_EQUAL_TOL(expectedKE, meanKE, 1e-2);
 }
 
+void testContractionToMostCopies() {
+    // Contract a harmonic force to almost as many copies as the system has.  The ring polymer
+    // stays band limited, so the contraction is exact and the trajectory should match one
+    // computed without contractions.
+
+    const int numParticles = 5;
+    const int numCopies = 10;
+    const double temperature = 300.0;
+    System system;
+    CustomExternalForce* force = new CustomExternalForce("500*(x^2+y^2+z^2)");
+    force->setForceGroup(1);
+    system.addForce(force);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(2.0);
+        force->addParticle(i);
+    }
+    map<int, int> contractions;
+    contractions[1] = 8;
+    RPMDIntegrator integ1(numCopies, temperature, 1.0, 0.001);
+    RPMDIntegrator integ2(numCopies, temperature, 1.0, 0.001, contractions);
+    integ1.setApplyThermostat(false);
+    integ2.setApplyThermostat(false);
+    Context context1(system, integ1, platform);
+    Context context2(system, integ2, platform);
+    vector<Vec3> positions(numParticles);
+    for (int copy = 0; copy < numCopies; copy++) {
+        double phase = 2*M_PI*copy/numCopies;
+        for (int i = 0; i < numParticles; i++)
+            positions[i] = Vec3(0.1*i+0.02*cos(phase), 0.03*sin(2*phase), 0.01*cos(3*phase)-0.02*sin(phase));
+        integ1.setPositions(copy, positions);
+        integ2.setPositions(copy, positions);
+    }
+    integ1.step(10);
+    integ2.step(10);
+    for (int copy = 0; copy < numCopies; copy++) {
+        State state1 = integ1.getState(copy, State::Positions | State::Velocities);
+        State state2 = integ2.getState(copy, State::Positions | State::Velocities);
+        for (int i = 0; i < numParticles; i++) {
+            ASSERT_EQUAL_VEC(state1.getPositions()[i], state2.getPositions()[i], 1e-6);
+            ASSERT_EQUAL_VEC(state1.getVelocities()[i], state2.getVelocities()[i], 1e-6);
+        }
+    }
+}
+
 void testWithoutThermostat() {
     const int numParticles = 20;
     const int numCopies = 10;
@@ -549,6 +594,7 @@ int main(int argc, char* argv[]) {
         testCMMotionRemoval();
         testVirtualSites();
         testContractions();
+        testContractionToMostCopies();
         testWithoutThermostat();
         testWithBarostat();
         runPlatformTests();
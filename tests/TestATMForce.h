@@ -813,6 +813,229 @@ void testSimulation() {
     }
 }
 
+void testSharedForces() {
+    // Forces that do not act on any displaced particle are evaluated only once.  Compare to
+    // an equivalent System where the same interaction is computed by a CustomNonbondedForce
+    // without interaction groups, which is always evaluated in both states.
+
+    int numParticles = 20;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numParticles; i++)
+        positions.push_back(Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt)));
+    vector<State> states;
+    vector<double> perturbationEnergies;
+    for (int mode = 0; mode < 2; mode++) {
+        System system;
+        ATMForce* atm = new ATMForce("0.3*u0 + Lambda*u1 + 0.01*u1^2");
+        atm->addGlobalParameter("Lambda", 0.5);
+        for (int i = 0; i < numParticles; i++) {
+            system.addParticle(1.0);
+            if (i < numParticles-2)
+                atm->addParticle();
+            else
+                atm->addParticle(new ATMForce::FixedDisplacement(Vec3(0.5, -0.2, 0.3)));
+        }
+        CustomBondForce* perturbed = new CustomBondForce("0.5*r^2");
+        for (int i = numParticles-4; i < numParticles-2; i++)
+            perturbed->addBond(i, i+2);
+        atm->addForce(perturbed);
+        if (mode == 0) {
+            CustomBondForce* bonds = new CustomBondForce("k*(r-0.2)^2");
+            bonds->addGlobalParameter("k", 1.0);
+            for (int i = 0; i < numParticles-3; i++)
+                bonds->addBond(i, i+1);
+            atm->addForce(bonds);
+        }
+        else {
+            CustomNonbondedForce* bonds = new CustomNonbondedForce("a1*a2*k*(r-0.2)^2*delta(abs(p1-p2)-1)");
+            bonds->addGlobalParameter("k", 1.0);
+            bonds->addPerParticleParameter("p");
+            bonds->addPerParticleParameter("a");
+            for (int i = 0; i < numParticles; i++)
+                bonds->addParticle({(double) i, i < numParticles-2 ? 1.0 : 0.0});
+            atm->addForce(bonds);
+        }
+        system.addForce(atm);
+        VerletIntegrator integrator(1.0);
+        Context context(system, integrator, platform);
+        context.setPositions(positions);
+        context.setParameter("k", 2.5);
+        states.push_back(context.getState(State::Energy | State::Forces));
+        double u0, u1, energy;
+        atm->getPerturbationEnergy(context, u1, u0, energy);
+        perturbationEnergies.push_back(u0);
+        perturbationEnergies.push_back(u1);
+        if (mode == 0) {
+            // The bonds cannot act on a particle that becomes displaced.
+
+            atm->setParticleTransformation(0, new ATMForce::FixedDisplacement(Vec3(1, 0, 0)));
+            bool threwException = false;
+            try {
+                atm->updateParametersInContext(context);
+            }
+            catch (OpenMMException& ex) {
+                threwException = true;
+            }
+            ASSERT(threwException);
+        }
+    }
+    ASSERT_EQUAL_TOL(states[1].getPotentialEnergy(), states[0].getPotentialEnergy(), 1e-6);
+    ASSERT_EQUAL_TOL(perturbationEnergies[2], perturbationEnergies[0], 1e-6);
+    ASSERT_EQUAL_TOL(perturbationEnergies[3], perturbationEnergies[1], 1e-6);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(states[1].getForces()[i], states[0].getForces()[i], 1e-6);
+}
+
+void testSharedNonbonded() {
+    // A NonbondedForce or a CustomNonbondedForce with interaction groups is evaluated only once
+    // if no displaced particle takes part in it.  Compare to an equivalent System where they
+    // cannot be shared: the NonbondedForce has a parameter offset (with no effect) on a displaced
+    // particle, and the CustomNonbondedForce has no interaction groups.
+
+    int numParticles = 30;
+    int numDisplaced = 3;
+    double boxSize = 2.5;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < numParticles; i++)
+        positions.push_back(Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*boxSize);
+    vector<double> c(numParticles);
+    for (int i = 0; i < numParticles-numDisplaced; i++)
+        c[i] = genrand_real2(sfmt);
+    vector<State> states;
+    vector<double> perturbationEnergies;
+    for (int mode = 0; mode < 2; mode++) {
+        System system;
+        system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+        ATMForce* atm = new ATMForce("0.3*u0 + Lambda*u1");
+        atm->addGlobalParameter("Lambda", 0.5);
+        NonbondedForce* nonbonded = new NonbondedForce();
+        nonbonded->setNonbondedMethod(NonbondedForce::PME);
+        nonbonded->setCutoffDistance(1.0);
+        CustomNonbondedForce* custom = new CustomNonbondedForce("c1*c2/(r^2+0.1)");
+        custom->addPerParticleParameter("c");
+        custom->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+        custom->setCutoffDistance(1.0);
+        set<int> environment;
+        for (int i = 0; i < numParticles; i++) {
+            system.addParticle(1.0);
+            bool displaced = (i >= numParticles-numDisplaced);
+            if (displaced)
+                atm->addParticle(new ATMForce::FixedDisplacement(Vec3(0.8, -0.3, 0.2)));
+            else
+                atm->addParticle();
+            nonbonded->addParticle(displaced ? 0.0 : (i%2 == 0 ? 0.5 : -0.5), 0.3, displaced ? 0.0 : 0.5);
+            custom->addParticle({c[i]});
+            if (!displaced)
+                environment.insert(i);
+        }
+        nonbonded->addException(0, numParticles-1, 0.0, 1.0, 0.0);
+        if (mode == 0)
+            custom->addInteractionGroup(environment, environment);
+        else {
+            nonbonded->addGlobalParameter("q", 0.0);
+            nonbonded->addParticleParameterOffset("q", numParticles-1, 1.0, 0.0, 0.0);
+        }
+        atm->addForce(nonbonded);
+        atm->addForce(custom);
+
+        // The displaced particles interact with the environment through this Force.
+
+        CustomBondForce* bonds = new CustomBondForce("0.5*(r-0.3)^2");
+        for (int i = 0; i < numDisplaced; i++)
+            bonds->addBond(i, numParticles-numDisplaced+i);
+        atm->addForce(bonds);
+        system.addForce(atm);
+        VerletIntegrator integrator(1.0);
+        Context context(system, integrator, platform);
+        context.setPositions(positions);
+        states.push_back(context.getState(State::Energy | State::Forces));
+        double u0, u1, energy;
+        atm->getPerturbationEnergy(context, u1, u0, energy);
+        perturbationEnergies.push_back(u0);
+        perturbationEnergies.push_back(u1);
+    }
+    ASSERT_EQUAL_TOL(states[1].getPotentialEnergy(), states[0].getPotentialEnergy(), 1e-5);
+    ASSERT_EQUAL_TOL(perturbationEnergies[2], perturbationEnergies[0], 1e-5);
+    ASSERT_EQUAL_TOL(perturbationEnergies[3], perturbationEnergies[1], 1e-5);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(states[1].getForces()[i], states[0].getForces()[i], 1e-5);
+}
+
+void testSplitNonbonded(NonbondedForce::NonbondedMethod method) {
+    // When displaced particles are charged, a NonbondedForce without Ewald or PME is split into the
+    // interactions between undisplaced particles, evaluated once, and the interactions involving a
+    // displaced particle, evaluated for each state.  Compare to an equivalent System where it cannot
+    // be split because of a parameter offset (with no effect) on a displaced particle.
+
+    int gridSize = 4;
+    int numParticles = gridSize*gridSize*gridSize;
+    int numDisplaced = 4;
+    double boxSize = 3.0;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    vector<double> sigma, epsilon;
+    for (int i = 0; i < numParticles; i++) {
+        Vec3 site(i%gridSize, (i/gridSize)%gridSize, i/(gridSize*gridSize));
+        positions.push_back(site*(boxSize/gridSize) + Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt))*0.2);
+        sigma.push_back(0.25+0.1*genrand_real2(sfmt));
+        epsilon.push_back(0.2+0.5*genrand_real2(sfmt));
+    }
+    vector<State> states;
+    vector<double> perturbationEnergies;
+    for (int mode = 0; mode < 2; mode++) {
+        System system;
+        system.setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+        ATMForce* atm = new ATMForce("0.3*u0 + Lambda*u1");
+        atm->addGlobalParameter("Lambda", 0.5);
+        NonbondedForce* nonbonded = new NonbondedForce();
+        nonbonded->setNonbondedMethod(method);
+        nonbonded->setCutoffDistance(1.2);
+        if (method == NonbondedForce::CutoffPeriodic) {
+            nonbonded->setUseSwitchingFunction(true);
+            nonbonded->setSwitchingDistance(1.0);
+            nonbonded->setUseDispersionCorrection(false);
+        }
+        for (int i = 0; i < numParticles; i++) {
+            system.addParticle(1.0);
+            bool displaced = (i >= numParticles-numDisplaced);
+            if (displaced)
+                atm->addParticle(new ATMForce::FixedDisplacement(Vec3(0.6, -0.3, 0.2)));
+            else
+                atm->addParticle();
+            nonbonded->addParticle(i%2 == 0 ? 0.4 : -0.4, sigma[i], epsilon[i]);
+        }
+        nonbonded->addException(numParticles-1, numParticles-2, 0.05, 0.3, 0.1);
+        nonbonded->addException(numParticles-1, 5, -0.1, 0.3, 0.2);
+        nonbonded->addException(numParticles-3, 7, 0.0, 1.0, 0.0);
+        nonbonded->addException(0, 1, 0.08, 0.3, 0.3);
+        nonbonded->addException(2, 3, 0.0, 1.0, 0.0);
+        if (mode == 1) {
+            nonbonded->addGlobalParameter("q", 0.0);
+            nonbonded->addParticleParameterOffset("q", numParticles-1, 1.0, 0.0, 0.0);
+        }
+        atm->addForce(nonbonded);
+        system.addForce(atm);
+        VerletIntegrator integrator(1.0);
+        Context context(system, integrator, platform);
+        context.setPositions(positions);
+        states.push_back(context.getState(State::Energy | State::Forces));
+        double u0, u1, energy;
+        atm->getPerturbationEnergy(context, u1, u0, energy);
+        perturbationEnergies.push_back(u0);
+        perturbationEnergies.push_back(u1);
+    }
+    ASSERT_EQUAL_TOL(states[1].getPotentialEnergy(), states[0].getPotentialEnergy(), 1e-5);
+    ASSERT_EQUAL_TOL(perturbationEnergies[2], perturbationEnergies[0], 1e-5);
+    ASSERT_EQUAL_TOL(perturbationEnergies[3], perturbationEnergies[1], 1e-5);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(states[1].getForces()[i], states[0].getForces()[i], 1e-5);
+}
+
 void runPlatformTests();
 
 int main(int argc, char* argv[]) {
@@ -832,6 +1055,11 @@ int main(int argc, char* argv[]) {
         testChangingBoxVectors();
         testMolecules();
         testSimulation();
+        testSharedForces();
+        testSharedNonbonded();
+        testSplitNonbonded(NonbondedForce::NoCutoff);
+        testSplitNonbonded(NonbondedForce::CutoffNonPeriodic);
+        testSplitNonbonded(NonbondedForce::CutoffPeriodic);
         runPlatformTests();
     }
     catch(const exception& e) {
@@ -39,6 +39,7 @@
 #include "openmm/HarmonicBondForce.h"
 #include "openmm/System.h"
 #include "openmm/VerletIntegrator.h"
+#include "openmm/VirtualSite.h"
 #include "sfmt/SFMT.h"
 #include <algorithm>
 #include <iostream>
@@ -266,6 +267,60 @@ void testMolecules() {
     }
 }
 
+void testManyCVs() {
+    // Create a CustomCVForce with many collective variables, one of which involves a virtual site,
+    // and compare it to an equivalent CustomBondForce.
+
+    const int numCVs = 12;
+    System system;
+    for (int i = 0; i < numCVs+1; i++)
+        system.addParticle(1.0);
+    system.addParticle(0.0);
+    system.setVirtualSite(numCVs+1, new TwoParticleAverageSite(0, 1, 0.3, 0.7));
+    string expression = "0";
+    CustomCVForce* cv = new CustomCVForce("");
+    CustomBondForce* bonds = new CustomBondForce("c*r^2");
+    bonds->addPerBondParameter("c");
+    bonds->setForceGroup(1);
+    for (int i = 0; i < numCVs; i++) {
+        stringstream name;
+        name << "v" << i;
+        CustomBondForce* v = new CustomBondForce("r");
+        int particle = (i == numCVs-1 ? numCVs+1 : i+1);
+        v->addBond(i, particle);
+        cv->addCollectiveVariable(name.str(), v);
+        bonds->addBond(i, particle, {0.1*(i+1)});
+        stringstream term;
+        term << "+" << 0.1*(i+1) << "*" << name.str() << "^2";
+        expression += term.str();
+    }
+    cv->setEnergyFunction(expression);
+    system.addForce(cv);
+    system.addForce(bonds);
+    VerletIntegrator integrator(1.0);
+    Context context(system, integrator, platform);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions;
+    for (int i = 0; i < system.getNumParticles(); i++)
+        positions.push_back(Vec3(genrand_real2(sfmt), genrand_real2(sfmt), genrand_real2(sfmt)));
+    context.setPositions(positions);
+    context.computeVirtualSites();
+    State state1 = context.getState(State::Energy | State::Forces | State::Positions, false, 1);
+    State state2 = context.getState(State::Energy | State::Forces, false, 2);
+    ASSERT_EQUAL_TOL(state2.getPotentialEnergy(), state1.getPotentialEnergy(), 1e-5);
+    for (int i = 0; i < system.getNumParticles(); i++)
+        ASSERT_EQUAL_VEC(state2.getForces()[i], state1.getForces()[i], 1e-5);
+    vector<double> values;
+    cv->getCollectiveVariableValues(context, values);
+    ASSERT_EQUAL(numCVs, values.size());
+    for (int i = 0; i < numCVs; i++) {
+        int particle = (i == numCVs-1 ? numCVs+1 : i+1);
+        Vec3 delta = state1.getPositions()[particle]-state1.getPositions()[i];
+        ASSERT_EQUAL_TOL(sqrt(delta.dot(delta)), values[i], 1e-5);
+    }
+}
+
 void runPlatformTests();
 
 int main(int argc, char* argv[]) {
@@ -276,6 +331,7 @@ int main(int argc, char* argv[]) {
         testTabulatedFunction();
         testReordering();
         testMolecules();
+        testManyCVs();
         runPlatformTests();
     }
     catch(const exception& e) {
@@ -31,6 +31,7 @@
 #include "openmm/CustomNonbondedForce.h"
 #include "openmm/NonbondedForce.h"
 #include "openmm/OpenMMException.h"
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <vector>
@@ -121,6 +122,80 @@ void testFindExceptions() {
     }
 }
 
+/**
+ * Test rings, where two particles can be connected by paths of different lengths.  The shortest
+ * path should determine whether they are excluded or a 1-4.
+ */
+
+void testRings() {
+    for (int ringSize = 3; ringSize <= 7; ringSize++) {
+        NonbondedForce nonbonded;
+        vector<pair<int, int> > bonds;
+        for (int i = 0; i < ringSize; i++) {
+            nonbonded.addParticle(1.0, 1.0, 1.0);
+            bonds.push_back(make_pair(i, (i+1)%ringSize));
+        }
+        nonbonded.createExceptionsFromBonds(bonds, 0.5, 0.5);
+        int expectedExceptions = 0;
+        for (int i = 0; i < ringSize; i++)
+            for (int j = 0; j < i; j++) {
+                int separation = min(i-j, ringSize-(i-j));
+                if (separation <= 3)
+                    expectedExceptions++;
+            }
+        ASSERT_EQUAL(expectedExceptions, nonbonded.getNumExceptions());
+        int lastParticle1 = -1, lastParticle2 = -1;
+        for (int i = 0; i < nonbonded.getNumExceptions(); i++) {
+            int particle1, particle2;
+            double chargeProd, sigma, epsilon;
+            nonbonded.getExceptionParameters(i, particle1, particle2, chargeProd, sigma, epsilon);
+            ASSERT(particle1 < particle2);
+            ASSERT(particle2 > lastParticle2 || (particle2 == lastParticle2 && particle1 > lastParticle1));
+            lastParticle1 = particle1;
+            lastParticle2 = particle2;
+            int separation = min(particle2-particle1, ringSize-(particle2-particle1));
+            if (separation == 3) {
+                ASSERT_EQUAL_TOL(0.5, chargeProd, 1e-10);
+            }
+            else {
+                ASSERT_EQUAL(0.0, chargeProd);
+            }
+        }
+    }
+}
+
+/**
+ * Test creating exceptions when the force already has some.
+ */
+
+void testExistingExceptions() {
+    NonbondedForce nonbonded;
+    for (int i = 0; i < 6; i++)
+        nonbonded.addParticle(1.0, 1.0, 1.0);
+    nonbonded.addException(0, 5, 0.0, 1.0, 0.0);
+    vector<pair<int, int> > bonds = {{0, 1}, {1, 2}};
+    nonbonded.createExceptionsFromBonds(bonds, 0.5, 0.5);
+    ASSERT_EQUAL(4, nonbonded.getNumExceptions());
+    int particle1, particle2;
+    double chargeProd, sigma, epsilon;
+    nonbonded.getExceptionParameters(3, particle1, particle2, chargeProd, sigma, epsilon);
+    ASSERT_EQUAL(1, particle1);
+    ASSERT_EQUAL(2, particle2);
+
+    // Creating an exception that already exists should fail and leave the existing ones unchanged.
+
+    bonds = {{3, 4}, {2, 1}};
+    try {
+        nonbonded.createExceptionsFromBonds(bonds, 0.5, 0.5);
+        throw std::exception();
+    }
+    catch (const OpenMMException& ex) {
+        // This should have thrown an exception.
+    }
+    ASSERT_EQUAL(4, nonbonded.getNumExceptions());
+    nonbonded.addException(3, 4, 0.0, 1.0, 0.0);
+}
+
 /**
  * Test replacing existing exclusions.
  */
@@ -219,6 +294,8 @@ void testFindCustomExclusions() {
 int main() {
     try {
         testFindExceptions();
+        testRings();
+        testExistingExceptions();
         testReplaceExceptions();
         testFindCustomExclusions();
     }
@@ -34,7 +34,11 @@
 #include "openmm/Platform.h"
 #include "openmm/System.h"
 #include "openmm/VerletIntegrator.h"
+#include "sfmt/SFMT.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <utility>
 #include <vector>
 
 using namespace OpenMM;
@@ -64,11 +68,71 @@ void testFindMolecules() {
         for (int j = 0; j < moleculeSize[i]; j++)
             ASSERT_EQUAL(particleMolecule[molecules[i][j]], i);
     }
+
+    // The time spent creating the Context should have been recorded.
+
+    map<string, double> times;
+    context.getStartupTimes(times);
+    ASSERT(times.find("Initialize kernels") != times.end());
+    ASSERT(times.find("Initialize force 0 (HarmonicBondForce)") != times.end());
+    ASSERT(times.find("Find molecules") != times.end());
+    for (auto& entry : times)
+        ASSERT(entry.second >= 0.0);
+}
+
+void testFindMoleculesFromBonds() {
+    // Create a large random set of bonds, so they can be processed in parallel.
+
+    const int numParticles = 300000;
+    const int numBonds = 250000;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<pair<int, int> > bonds;
+    vector<vector<int> > particleBonds(numParticles);
+    for (int i = 0; i < numBonds; i++) {
+        int p1 = (int) (genrand_real2(sfmt)*numParticles);
+        int p2 = min(numParticles-1, p1+(int) (genrand_real2(sfmt)*20));
+        bonds.push_back(make_pair(p1, p2));
+        particleBonds[p1].push_back(p2);
+        particleBonds[p2].push_back(p1);
+    }
+
+    // Find the molecules with a simple breadth first search to compare against.
+
+    vector<int> expectedMolecule(numParticles, -1);
+    int numMolecules = 0;
+    for (int i = 0; i < numParticles; i++)
+        if (expectedMolecule[i] == -1) {
+            vector<int> queue = {i};
+            expectedMolecule[i] = numMolecules;
+            for (int j = 0; j < queue.size(); j++)
+                for (int k : particleBonds[queue[j]])
+                    if (expectedMolecule[k] == -1) {
+                        expectedMolecule[k] = numMolecules;
+                        queue.push_back(k);
+                    }
+            numMolecules++;
+        }
+
+    // Both versions of findMolecules() should give the same result, whether or not bonds are processed in parallel.
+
+    vector<vector<int> > molecules = ContextImpl::findMolecules(numParticles, bonds, 3);
+    ASSERT_EQUAL(numMolecules, molecules.size());
+    for (int i = 0; i < numMolecules; i++) {
+        for (int j = 0; j < molecules[i].size(); j++) {
+            ASSERT_EQUAL(i, expectedMolecule[molecules[i][j]]);
+            if (j > 0)
+                ASSERT(molecules[i][j] > molecules[i][j-1]);
+        }
+    }
+    ASSERT(molecules == ContextImpl::findMolecules(numParticles, particleBonds));
+    ASSERT(molecules == ContextImpl::findMolecules(numParticles, bonds));
 }
 
 int main() {
     try {
         testFindMolecules();
+        testFindMoleculesFromBonds();
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
@@ -5,6 +5,8 @@
 #include <iostream>
 #include <limits>
 #include <map>
+#include <sstream>
+#include <thread>
 
 using namespace Lepton;
 using namespace OpenMM;
@@ -37,6 +39,89 @@ class ExampleFunction : public CustomFunction {
     }
 };
 
+/**
+ * This is a custom function that provides a representation as a uniform spline.  It is the product
+ * of a cubic polynomial in each argument.
+ */
+
+class PolynomialSplineFunction : public CustomFunction {
+public:
+    PolynomialSplineFunction(int dimensions, bool periodic) : dimensions(dimensions), periodic(periodic) {
+    }
+    int getNumArguments() const {
+        return dimensions;
+    }
+    double evaluate(const double* arguments) const {
+        int derivOrder[] = {0, 0};
+        return evaluateDerivative(arguments, derivOrder);
+    }
+    double evaluateDerivative(const double* arguments, const int* derivOrder) const {
+        double result = 1.0;
+        for (int i = 0; i < dimensions; i++) {
+            double x = arguments[i];
+            if (periodic)
+                x -= (max[i]-min[i])*floor((x-min[i])/(max[i]-min[i]));
+            else if (x < min[i] || x > max[i])
+                return 0.0;
+            double c[4];
+            getPolynomial(i, derivOrder[i], c);
+            result *= ((c[3]*x + c[2])*x + c[1])*x + c[0];
+        }
+        return result;
+    }
+    CustomFunction* clone() const {
+        return new PolynomialSplineFunction(dimensions, periodic);
+    }
+    bool getUniformSpline(const int* derivOrder, UniformSpline& spline) const {
+        spline.dimensions = dimensions;
+        spline.periodic = periodic;
+        vector<vector<double> > cellCoeff(dimensions);
+        for (int i = 0; i < dimensions; i++) {
+            spline.size[i] = size[i];
+            spline.min[i] = min[i];
+            spline.max[i] = max[i];
+
+            // Expand the polynomial around the start of each cell.
+
+            double c[4];
+            getPolynomial(i, derivOrder[i], c);
+            double h = (max[i]-min[i])/size[i];
+            for (int cell = 0; cell < size[i]; cell++) {
+                double x0 = min[i]+cell*h;
+                cellCoeff[i].push_back(c[0] + c[1]*x0 + c[2]*x0*x0 + c[3]*x0*x0*x0);
+                cellCoeff[i].push_back((c[1] + 2*c[2]*x0 + 3*c[3]*x0*x0)*h);
+                cellCoeff[i].push_back((c[2] + 3*c[3]*x0)*h*h);
+                cellCoeff[i].push_back(c[3]*h*h*h);
+            }
+        }
+        if (dimensions == 1)
+            spline.coefficients = cellCoeff[0];
+        else
+            for (int celly = 0; celly < size[1]; celly++)
+                for (int cellx = 0; cellx < size[0]; cellx++)
+                    for (int j = 0; j < 4; j++)
+                        for (int i = 0; i < 4; i++)
+                            spline.coefficients.push_back(cellCoeff[0][4*cellx+i]*cellCoeff[1][4*celly+j]);
+        return true;
+    }
+private:
+    void getPolynomial(int axis, int derivOrder, double* c) const {
+        const double coeff[2][4] = {{0.0, -2.0, 0.0, 1.0}, {1.0, 1.0, -1.0, 0.0}};
+        for (int i = 0; i < 4; i++)
+            c[i] = coeff[axis][i];
+        if (derivOrder == 1) {
+            for (int i = 0; i < 3; i++)
+                c[i] = (i+1)*c[i+1];
+            c[3] = 0.0;
+        }
+    }
+    int dimensions;
+    bool periodic;
+    const int size[2] = {4, 3};
+    const double min[2] = {-1.0, 0.0};
+    const double max[2] = {3.0, 2.0};
+};
+
 /**
  * Verify that an expression gives the correct value.
  */
@@ -283,6 +368,274 @@ void testCustomFunction(const string& expression, const string& equivalent) {
     verifySameValue(deriv3, deriv4, 2.0, -3.0);
 }
 
+/**
+ * Compare the vectorized versions of standard math functions to the exact values over a range
+ * of arguments.
+ */
+
+void verifyVectorFunction(const string& expression, double minX, double maxX, double y, double (*function)(double, double), double tol, bool relative=false) {
+    ParsedExpression parsed = Parser::parse(expression);
+    for (int width : CompiledVectorExpression::getAllowedWidths()) {
+        CompiledVectorExpression vector = parsed.createCompiledVectorExpression(width);
+        if (vector.getVariables().find("y") != vector.getVariables().end())
+            for (int j = 0; j < width; j++)
+                vector.getVariablePointer("y")[j] = y;
+        int numPoints = 1000;
+        for (int i = 0; i < numPoints; i += width) {
+            for (int j = 0; j < width; j++)
+                vector.getVariablePointer("x")[j] = minX + (maxX-minX)*(i+j)/(numPoints-1);
+            const float* result = vector.evaluate();
+            for (int j = 0; j < width; j++) {
+                double x = vector.getVariablePointer("x")[j];
+                if (relative) {
+                    ASSERT_EQUAL_TOL(1.0, result[j]/function(x, y), tol);
+                }
+                else {
+                    ASSERT_EQUAL_TOL(function(x, y), result[j], tol);
+                }
+            }
+        }
+    }
+}
+
+void verifySpecialValue(const string& expression, double x, double expected, double y=0.0) {
+    ParsedExpression parsed = Parser::parse(expression);
+    for (int width : CompiledVectorExpression::getAllowedWidths()) {
+        CompiledVectorExpression vector = parsed.createCompiledVectorExpression(width);
+        if (vector.getVariables().find("y") != vector.getVariables().end())
+            for (int j = 0; j < width; j++)
+                vector.getVariablePointer("y")[j] = y;
+        for (int j = 0; j < width; j++)
+            vector.getVariablePointer("x")[j] = x;
+        const float* result = vector.evaluate();
+        for (int j = 0; j < width; j++) {
+            if (std::isnan(expected)) {
+                ASSERT(std::isnan(result[j]));
+            }
+            else {
+                ASSERT_EQUAL(expected, result[j]);
+            }
+        }
+    }
+}
+
+void testVectorMathFunctions() {
+    verifyVectorFunction("exp(x)", -80.0, 80.0, 0.0, [] (double x, double y) {return exp(x);}, 1e-6);
+    verifyVectorFunction("exp(x)", -5.0, 5.0, 0.0, [] (double x, double y) {return exp(x);}, 1e-6);
+    verifyVectorFunction("log(x)", 1e-30, 1e30, 0.0, [] (double x, double y) {return log(x);}, 1e-6);
+    verifyVectorFunction("log(x)", 0.01, 10.0, 0.0, [] (double x, double y) {return log(x);}, 1e-6);
+    verifyVectorFunction("sin(x)", -1000.0, 1000.0, 0.0, [] (double x, double y) {return sin(x);}, 1e-6);
+    verifyVectorFunction("cos(x)", -1000.0, 1000.0, 0.0, [] (double x, double y) {return cos(x);}, 1e-6);
+    verifyVectorFunction("sin(x)", -4.0, 4.0, 0.0, [] (double x, double y) {return sin(x);}, 1e-6);
+    verifyVectorFunction("cos(x)", -4.0, 4.0, 0.0, [] (double x, double y) {return cos(x);}, 1e-6);
+    verifyVectorFunction("atan(x)", -100.0, 100.0, 0.0, [] (double x, double y) {return atan(x);}, 1e-6);
+    verifyVectorFunction("atan(x)", -2.0, 2.0, 0.0, [] (double x, double y) {return atan(x);}, 1e-6);
+    verifyVectorFunction("erfc(x)", -3.0, 9.0, 0.0, [] (double x, double y) {return erfc(x);}, 1e-6);
+    verifyVectorFunction("exp(x)", -80.0, -10.0, 0.0, [] (double x, double y) {return exp(x);}, 1e-6, true);
+    verifyVectorFunction("erfc(x)", 3.0, 9.0, 0.0, [] (double x, double y) {return erfc(x);}, 1e-5, true);
+    verifyVectorFunction("x^y", 1e-10, 1e-3, 2.7, [] (double x, double y) {return pow(x, y);}, 1e-5, true);
+    verifyVectorFunction("x^y", 0.01, 10.0, 2.7, [] (double x, double y) {return pow(x, y);}, 1e-5);
+    verifyVectorFunction("x^y", -10.0, 10.0, 3.0, [] (double x, double y) {return pow(x, y);}, 1e-5);
+    verifyVectorFunction("y^x", -3.0, 3.0, 2.5, [] (double x, double y) {return pow(y, x);}, 1e-5);
+    verifyVectorFunction("x^1.5", 0.0, 10.0, 0.0, [] (double x, double y) {return pow(x, 1.5);}, 1e-5);
+    verifySpecialValue("exp(x)", -200.0, 0.0);
+    verifySpecialValue("exp(x)", 200.0, numeric_limits<double>::infinity());
+    verifySpecialValue("log(x)", 0.0, -numeric_limits<double>::infinity());
+    verifySpecialValue("log(x)", -1.0, numeric_limits<double>::quiet_NaN());
+    verifySpecialValue("log(x)", numeric_limits<double>::infinity(), numeric_limits<double>::infinity());
+    verifySpecialValue("x^0.5", -2.0, numeric_limits<double>::quiet_NaN());
+    verifySpecialValue("x^3", -2.0, -8.0);
+    verifySpecialValue("x^1.5", 0.0, 0.0);
+    verifySpecialValue("erfc(x)", 20.0, 0.0);
+    verifySpecialValue("erfc(x)", -20.0, 2.0);
+    verifySpecialValue("y^x", numeric_limits<double>::quiet_NaN(), 1.0, 1.0);
+    verifySpecialValue("x^y", numeric_limits<double>::quiet_NaN(), 1.0, 0.0);
+    verifySpecialValue("x^y", numeric_limits<double>::quiet_NaN(), numeric_limits<double>::quiet_NaN(), 2.0);
+}
+
+/**
+ * Test evaluating custom functions that can be represented as uniform splines.
+ */
+
+void testVectorSplineFunctions() {
+    for (int dimensions = 1; dimensions <= 2; dimensions++) {
+        for (bool periodic : {false, true}) {
+            map<string, CustomFunction*> functions;
+            PolynomialSplineFunction fn(dimensions, periodic);
+            functions["f"] = &fn;
+            ParsedExpression expr = Parser::parse(dimensions == 1 ? "f(x)" : "f(x, y)", functions);
+            vector<ParsedExpression> expressions = {expr, expr.differentiate("x")};
+            if (dimensions == 2)
+                expressions.push_back(expr.differentiate("y"));
+            for (ParsedExpression& e : expressions) {
+                for (int width : CompiledVectorExpression::getAllowedWidths()) {
+                    CompiledVectorExpression vector = e.createCompiledVectorExpression(width);
+                    for (int i = 0; i < 200; i += width) {
+                        map<string, double> variables;
+                        for (int j = 0; j < width; j++) {
+                            vector.getVariablePointer("x")[j] = -2.0 + 0.0313*(i+j);
+                            if (dimensions == 2)
+                                vector.getVariablePointer("y")[j] = -0.5 + 0.0171*(i+j);
+                        }
+                        const float* result = vector.evaluate();
+                        for (int j = 0; j < width; j++) {
+                            variables["x"] = vector.getVariablePointer("x")[j];
+                            if (dimensions == 2)
+                                variables["y"] = vector.getVariablePointer("y")[j];
+                            ASSERT_EQUAL_TOL(e.evaluate(variables), result[j], 1e-5);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Test compiling several expressions into a single CompiledExpression or CompiledVectorExpression.
+ */
+
+void testMultipleExpressions() {
+    ParsedExpression energy = Parser::parse("exp(-2*x)*sin(y)+x^2").optimize();
+    vector<ParsedExpression> expressions = {energy, energy.differentiate("x").optimize(), energy.differentiate("y").optimize(), Parser::parse("y"), Parser::parse("3")};
+    CompiledExpression compiled = ParsedExpression::createCompiledExpression(expressions);
+    ASSERT_EQUAL(expressions.size(), compiled.getNumValues());
+    map<string, double> variables;
+    for (double x : {-1.0, 0.5, 2.0}) {
+        variables["x"] = x;
+        variables["y"] = 1.5-x;
+        compiled.getVariableReference("x") = variables["x"];
+        compiled.getVariableReference("y") = variables["y"];
+        ASSERT_EQUAL_TOL(expressions[0].evaluate(variables), compiled.evaluate(), 1e-10);
+        for (int i = 0; i < expressions.size(); i++)
+            ASSERT_EQUAL_TOL(expressions[i].evaluate(variables), compiled.getValue(i), 1e-10);
+    }
+    for (int width : CompiledVectorExpression::getAllowedWidths()) {
+        CompiledVectorExpression vector = ParsedExpression::createCompiledVectorExpression(expressions, width);
+        ASSERT_EQUAL(expressions.size(), vector.getNumValues());
+        for (int j = 0; j < width; j++) {
+            vector.getVariablePointer("x")[j] = 0.3*j-1.0;
+            vector.getVariablePointer("y")[j] = 0.1*j;
+        }
+        vector.evaluate();
+        for (int j = 0; j < width; j++) {
+            variables["x"] = vector.getVariablePointer("x")[j];
+            variables["y"] = vector.getVariablePointer("y")[j];
+            for (int i = 0; i < expressions.size(); i++)
+                ASSERT_EQUAL_TOL(expressions[i].evaluate(variables), vector.getValue(i)[j], 1e-5);
+        }
+    }
+}
+
+void testLargeExpression() {
+    // Build an expression with many terms that share subexpressions, and make sure optimizing
+    // and differentiating it give correct results.  With a tree that must be copied at every
+    // step this would take several seconds.
+
+    stringstream expression;
+    for (int i = 0; i < 500; i++) {
+        if (i > 0)
+            expression << "+";
+        expression << "l" << (i%3) << "*eps*((sigma/(r+" << (0.01*i) << "))^12-(sigma/(r+" << (0.01*i) << "))^6)*exp(-k*r)";
+    }
+    ParsedExpression energy = Parser::parse(expression.str()).optimize();
+    ParsedExpression dEdr = energy.differentiate("r").optimize();
+    ParsedExpression dEdl = energy.differentiate("l1").optimize();
+    map<string, double> variables = {{"l0", 0.3}, {"l1", 0.5}, {"l2", 0.7}, {"eps", 1.2}, {"sigma", 0.9}, {"k", 0.2}, {"r", 1.1}};
+    double delta = 1e-5;
+    map<string, double> offset = variables;
+    offset["r"] = variables["r"]+delta;
+    double plus = energy.evaluate(offset);
+    offset["r"] = variables["r"]-delta;
+    double minus = energy.evaluate(offset);
+    ASSERT_EQUAL_TOL((plus-minus)/(2*delta), dEdr.evaluate(variables), 1e-5);
+    offset = variables;
+    offset["l1"] = 0.0;
+    ASSERT_EQUAL_TOL((energy.evaluate(variables)-energy.evaluate(offset))/variables["l1"], dEdl.evaluate(variables), 1e-8);
+}
+
+/**
+ * Optimizing and differentiating copies of an expression that share nodes should be safe to do on several
+ * threads at once.
+ */
+
+void testConcurrentDifferentiation() {
+    ParsedExpression energy = Parser::parse("eps*((sigma/r)^12-(sigma/r)^6)*exp(-k*r)+eps*((sigma/r)^12-(sigma/r)^6)*cos(r)").optimize();
+    map<string, double> variables = {{"eps", 1.2}, {"sigma", 0.9}, {"k", 0.2}, {"r", 1.1}};
+    double expected = energy.differentiate("r").optimize().evaluate(variables);
+    const int numThreads = 4;
+    vector<double> results(numThreads);
+    vector<thread> threads;
+    for (int i = 0; i < numThreads; i++)
+        threads.push_back(thread([&, i] () {
+            ParsedExpression copy = energy;
+            for (int j = 0; j < 200; j++)
+                results[i] = (j%2 == 0 ? energy : copy).differentiate("r").optimize().evaluate(variables);
+        }));
+    for (thread& t : threads)
+        t.join();
+    for (int i = 0; i < numThreads; i++)
+        ASSERT_EQUAL_TOL(expected, results[i], 1e-10);
+}
+
+/**
+ * Test evaluating expressions at many points at once.
+ */
+
+void testBatchEvaluation() {
+    ParsedExpression energy = Parser::parse("c*exp(-2*x)*sin(y)+x^2/(y+3)-sqrt(x*x+1)+select(x, 2*y, 1)").optimize();
+    vector<ParsedExpression> expressions = {energy, energy.differentiate("x").optimize(), energy.differentiate("y").optimize()};
+    const int numPoints = 13;
+    vector<double> x(numPoints), y(numPoints), c(numPoints, 1.5);
+    vector<float> xf(numPoints), yf(numPoints);
+    for (int i = 0; i < numPoints; i++) {
+        x[i] = xf[i] = 0.25*i-1.0;
+        y[i] = yf[i] = 0.1*i;
+    }
+    map<string, double> variables = {{"c", 1.5}};
+    vector<vector<double> > expected(expressions.size(), vector<double>(numPoints));
+    for (int i = 0; i < numPoints; i++) {
+        variables["x"] = x[i];
+        variables["y"] = y[i];
+        for (int j = 0; j < expressions.size(); j++)
+            expected[j][i] = expressions[j].evaluate(variables);
+    }
+
+    // Test ExpressionProgram.
+
+    for (int j = 0; j < expressions.size(); j++) {
+        vector<double> results(numPoints);
+        expressions[j].createProgram().evaluate(numPoints, {{"x", &x[0]}, {"y", &y[0]}, {"c", &c[0]}}, &results[0]);
+        for (int i = 0; i < numPoints; i++)
+            ASSERT_EQUAL_TOL(expected[j][i], results[i], 1e-10);
+    }
+
+    // Test CompiledExpression.  The value of c is set once and shared by all points, and one of
+    // the results is not requested.
+
+    CompiledExpression compiled = ParsedExpression::createCompiledExpression(expressions);
+    compiled.getVariableReference("c") = 1.5;
+    vector<double> value(numPoints), derivY(numPoints);
+    compiled.evaluate(numPoints, {{"x", &x[0]}, {"y", &y[0]}, {"z", &c[0]}}, {&value[0], NULL, &derivY[0]});
+    for (int i = 0; i < numPoints; i++) {
+        ASSERT_EQUAL_TOL(expected[0][i], value[i], 1e-10);
+        ASSERT_EQUAL_TOL(expected[2][i], derivY[i], 1e-10);
+    }
+
+    // Test CompiledVectorExpression.  The number of points is not a multiple of the width.
+
+    for (int width : CompiledVectorExpression::getAllowedWidths()) {
+        CompiledVectorExpression vector = ParsedExpression::createCompiledVectorExpression(expressions, width);
+        for (int i = 0; i < width; i++)
+            vector.getVariablePointer("c")[i] = 1.5;
+        std::vector<std::vector<float> > results(expressions.size(), std::vector<float>(numPoints));
+        vector.evaluate(numPoints, {{"x", &xf[0]}, {"y", &yf[0]}}, {&results[0][0], &results[1][0], &results[2][0]});
+        for (int j = 0; j < expressions.size(); j++)
+            for (int i = 0; i < numPoints; i++)
+                ASSERT_EQUAL_TOL(expected[j][i], results[j][i], 1e-5);
+    }
+}
+
 int main() {
     try {
         verifyEvaluation("5", 5.0);
@@ -370,6 +723,12 @@ int main() {
         verifyDerivative("select(x, x^2, 3*x)", "select(x, 2*x, 3)");
         testCustomFunction("custom(x, y)/2", "x*y");
         testCustomFunction("custom(x^2, 1)+custom(2, y-1)", "2*x^2+4*(y-1)");
+        testVectorMathFunctions();
+        testVectorSplineFunctions();
+        testMultipleExpressions();
+        testLargeExpression();
+        testConcurrentDifferentiation();
+        testBatchEvaluation();
         cout << Parser::parse("x*x").optimize() << endl;
         cout << Parser::parse("x*(x*x)").optimize() << endl;
         cout << Parser::parse("(x*x)*x").optimize() << endl;
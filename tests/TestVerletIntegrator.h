@@ -37,6 +37,7 @@
 #include "SimTKOpenMMRealType.h"
 #include "sfmt/SFMT.h"
 #include <iostream>
+#include <map>
 #include <vector>
 
 using namespace OpenMM;
@@ -324,6 +325,60 @@ void testForceGroups() {
     ASSERT(pos[2] == 0);
 }
 
+void testTimingStatistics() {
+    System system;
+    system.addParticle(1.0);
+    system.addParticle(1.0);
+    system.addParticle(1.0);
+    system.addConstraint(0, 1, 1.0);
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    bonds->addBond(1, 2, 1.5, 1.0);
+    bonds->setName("Bonds");
+    system.addForce(bonds);
+    CustomExternalForce* external = new CustomExternalForce("x");
+    external->addParticle(0);
+    external->setForceGroup(1);
+    system.addForce(external);
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    context.setPositions({Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(2, 0, 0)});
+
+    // Nothing should be recorded until timing is enabled.
+
+    ASSERT(!context.getTimingEnabled());
+    integrator.step(5);
+    map<string, double> times;
+    map<string, int> counts;
+    context.getTimingStatistics(times, counts);
+    ASSERT(times.empty());
+    ASSERT(counts.empty());
+
+    // Enable timing and check that each Force is recorded only when its group is computed.
+
+    context.setTimingEnabled(true);
+    ASSERT(context.getTimingEnabled());
+    integrator.step(5);
+    context.getState(State::Energy, false, 1<<1);
+    context.applyConstraints(1e-5);
+    context.getTimingStatistics(times, counts);
+    ASSERT_EQUAL(5, counts["Force 0 (Bonds)"]);
+    ASSERT_EQUAL(6, counts["Force 1 (CustomExternalForce)"]);
+    ASSERT_EQUAL(1, counts["Constraints"]);
+    ASSERT_EQUAL(counts.size(), times.size());
+    for (auto& entry : times)
+        ASSERT(entry.second >= 0.0);
+
+    // Resetting should discard the statistics, and disabling timing should stop recording new ones.
+
+    context.resetTimingStatistics();
+    context.getTimingStatistics(times, counts);
+    ASSERT(times.empty());
+    context.setTimingEnabled(false);
+    integrator.step(5);
+    context.getTimingStatistics(times, counts);
+    ASSERT(times.empty());
+}
+
 void runPlatformTests();
 
 int main(int argc, char* argv[]) {
@@ -337,6 +392,7 @@ int main(int argc, char* argv[]) {
         testConstrainedChain(1500);
         testInitialTemperature();
         testForceGroups();
+        testTimingStatistics();
         runPlatformTests();
     }
     catch(const exception& e) {
@@ -0,0 +1,629 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit.                   *
+ * See https://openmm.org/development.                                        *
+ *                                                                            *
+ * Portions copyright (c) 2025 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+/**
+ * This program times individual parts of OpenMM in isolation: the kernels for
+ * various Forces, constraints, integrators, serialization, and Context creation.
+ * Each benchmark is run for every requested combination of platform, system size,
+ * and (for platforms that support it) number of threads.  The results are written
+ * as JSON so they can be compared between builds to detect performance regressions.
+ *
+ * Usage: RunBenchmarks [options]
+ *
+ *   --platforms Reference,CPU   the platforms to benchmark
+ *   --sizes 3000,24000          the approximate numbers of particles in the test systems
+ *   --threads 1,4               the thread counts to use for platforms that support them
+ *   --filter NAME               only run benchmarks whose names contain this string
+ *   --min-time SECONDS          the minimum time to spend repeating each benchmark
+ *   --plugins DIRECTORY         the directory to load plugins from
+ *   --output FILE               write the results to a file instead of stdout
+ *   --quick                     run each benchmark once on a tiny system (for testing)
+ *   --list                      list the available benchmarks and exit
+ */
+
+#ifdef WIN32
+  #define _USE_MATH_DEFINES // Needed to get M_PI
+#endif
+#include "openmm/Context.h"
+#include "openmm/CustomBondForce.h"
+#include "openmm/CustomIntegrator.h"
+#include "openmm/CustomNonbondedForce.h"
+#include "openmm/HarmonicAngleForce.h"
+#include "openmm/HarmonicBondForce.h"
+#include "openmm/LangevinMiddleIntegrator.h"
+#include "openmm/NonbondedForce.h"
+#include "openmm/NoseHooverIntegrator.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/PeriodicTorsionForce.h"
+#include "openmm/Platform.h"
+#include "openmm/System.h"
+#include "openmm/VerletIntegrator.h"
+#include "openmm/internal/hardware.h"
+#include "openmm/internal/timer.h"
+#include "openmm/serialization/XmlSerializer.h"
+#include "lepton/CompiledExpression.h"
+#include "lepton/ParsedExpression.h"
+#include "lepton/Parser.h"
+#include "sfmt/SFMT.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+struct Options {
+    vector<string> platforms = {"Reference", "CPU"};
+    vector<int> sizes = {3000, 24000};
+    vector<int> threads;
+    string filter, output, pluginDir;
+    double minTime = 0.5;
+    bool quick = false, list = false;
+};
+
+struct Result {
+    string name, platform;
+    int particles, threads, iterations;
+    double mean, min, median;
+};
+
+/**
+ * The configuration a benchmark is being run in.  platform is NULL for benchmarks
+ * that do not depend on the platform, and threads is 0 when the platform does not
+ * let the number of threads be set.
+ */
+struct Config {
+    Platform* platform;
+    int particles, threads;
+    map<string, string> properties;
+};
+
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(const Options& options) : options(options) {
+    }
+    /**
+     * Time a benchmark and record the result.
+     *
+     * @param name      the name of the benchmark
+     * @param config    the configuration it is being run in
+     * @param body      the operation to time
+     * @param prepare   an operation to perform (untimed) before each call to body
+     * @param work      the number of units of work (e.g. time steps) that each call to body performs.
+     *                  The reported times are per unit of work.
+     */
+    void time(const string& name, const Config& config, function<void()> body, function<void()> prepare=nullptr, int work=1) {
+        string platformName = (config.platform == NULL ? "" : config.platform->getName());
+        cerr << name;
+        if (!platformName.empty())
+            cerr << " " << platformName;
+        if (config.particles > 0)
+            cerr << " " << config.particles << " particles";
+        if (config.threads > 0)
+            cerr << ", " << config.threads << " threads";
+        cerr << endl;
+
+        // Call it once first so one-time initialization is not included in the timing.
+
+        if (prepare)
+            prepare();
+        body();
+        vector<double> times;
+        double totalTime = 0.0;
+        int maxIterations = (options.quick ? 1 : 1000);
+        while (times.size() < maxIterations && (times.size() < 3 || totalTime < options.minTime)) {
+            if (prepare)
+                prepare();
+            double start = getCurrentTime();
+            body();
+            double elapsed = getCurrentTime()-start;
+            times.push_back(elapsed/work);
+            totalTime += elapsed;
+        }
+        record(name, config, times);
+    }
+    /**
+     * Record the result of a benchmark whose times were measured by other means.
+     *
+     * @param name      the name of the benchmark
+     * @param config    the configuration it was run in
+     * @param times     the time taken by each iteration
+     */
+    void record(const string& name, const Config& config, vector<double> times) {
+        Result result;
+        result.name = name;
+        result.platform = (config.platform == NULL ? "" : config.platform->getName());
+        result.particles = config.particles;
+        result.threads = config.threads;
+        result.iterations = times.size();
+        double totalTime = 0.0;
+        for (double t : times)
+            totalTime += t;
+        result.mean = totalTime/times.size();
+        sort(times.begin(), times.end());
+        result.min = times[0];
+        result.median = times[times.size()/2];
+        results.push_back(result);
+    }
+    void writeResults(ostream& out) const {
+        out << "{\n";
+        out << "  \"version\": " << quote(Platform::getOpenMMVersion()) << ",\n";
+        out << "  \"benchmarks\": [";
+        for (int i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    {\"name\": " << quote(r.name);
+            out << ", \"platform\": " << (r.platform.empty() ? "null" : quote(r.platform));
+            out << ", \"particles\": " << r.particles;
+            out << ", \"threads\": " << (r.threads == 0 ? "null" : to_string(r.threads));
+            out << ", \"iterations\": " << r.iterations;
+            out << ", \"mean_seconds\": " << r.mean;
+            out << ", \"median_seconds\": " << r.median;
+            out << ", \"min_seconds\": " << r.min << "}";
+        }
+        out << "\n  ]\n}" << endl;
+    }
+private:
+    static string quote(const string& s) {
+        string result = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result+"\"";
+    }
+    const Options& options;
+    vector<Result> results;
+};
+
+// Functions for building test systems.
+
+/**
+ * Create a periodic box of rigid water molecules with approximately the requested number of particles.
+ * The System has constraints but no Forces.
+ */
+static System* createWaterBox(int numParticles, vector<Vec3>& positions) {
+    const double density = 33.4; // molecules/nm^3
+    const double bondLength = 0.09572;
+    const double angle = 104.52*M_PI/180;
+    int numMolecules = max(2, numParticles/3);
+    int cells = (int) ceil(cbrt((double) numMolecules));
+    double boxSize = cbrt(numMolecules/density);
+    double spacing = boxSize/cells;
+    System* system = new System();
+    system->setDefaultPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    positions.clear();
+    Vec3 h1(bondLength, 0, 0), h2(bondLength*cos(angle), bondLength*sin(angle), 0);
+    for (int i = 0; i < numMolecules; i++) {
+        int o = system->addParticle(15.999);
+        system->addParticle(1.008);
+        system->addParticle(1.008);
+        system->addConstraint(o, o+1, bondLength);
+        system->addConstraint(o, o+2, bondLength);
+        system->addConstraint(o+1, o+2, sqrt((h1-h2).dot(h1-h2)));
+
+        // Place the oxygen at the center of a lattice cell and give the molecule a random orientation.
+
+        Vec3 center((i%cells+0.5)*spacing, ((i/cells)%cells+0.5)*spacing, (i/(cells*cells)+0.5)*spacing);
+        Vec3 axis(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+        axis /= sqrt(axis.dot(axis));
+        double theta = 2*M_PI*genrand_real2(sfmt);
+        auto rotate = [&] (Vec3 v) {
+            return v*cos(theta) + axis.cross(v)*sin(theta) + axis*axis.dot(v)*(1-cos(theta));
+        };
+        positions.push_back(center);
+        positions.push_back(center+rotate(h1));
+        positions.push_back(center+rotate(h2));
+    }
+    return system;
+}
+
+static double getWaterCutoff(const System& system) {
+    Vec3 a, b, c;
+    system.getDefaultPeriodicBoxVectors(a, b, c);
+    return min(0.9, 0.45*a[0]);
+}
+
+static NonbondedForce* createWaterNonbonded(const System& system, NonbondedForce::NonbondedMethod method) {
+    NonbondedForce* force = new NonbondedForce();
+    force->setNonbondedMethod(method);
+    force->setCutoffDistance(getWaterCutoff(system));
+    for (int i = 0; i < system.getNumParticles(); i += 3) {
+        force->addParticle(-0.834, 0.315, 0.636);
+        force->addParticle(0.417, 1.0, 0.0);
+        force->addParticle(0.417, 1.0, 0.0);
+        force->addException(i, i+1, 0.0, 1.0, 0.0);
+        force->addException(i, i+2, 0.0, 1.0, 0.0);
+        force->addException(i+1, i+2, 0.0, 1.0, 0.0);
+    }
+    return force;
+}
+
+/**
+ * Create a long chain of particles following a random walk, with no Forces or constraints.
+ */
+static System* createChain(int numParticles, vector<Vec3>& positions) {
+    System* system = new System();
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    positions.clear();
+    Vec3 pos;
+    for (int i = 0; i < numParticles; i++) {
+        system->addParticle(12.0);
+        positions.push_back(pos);
+        Vec3 step(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5);
+        pos += step*(0.15/sqrt(step.dot(step)));
+    }
+    return system;
+}
+
+static vector<Vec3> perturbPositions(const vector<Vec3>& positions, double amount) {
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(1, sfmt);
+    vector<Vec3> result(positions);
+    for (Vec3& pos : result)
+        pos += Vec3(genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5, genrand_real2(sfmt)-0.5)*amount;
+    return result;
+}
+
+// The benchmarks.
+
+/**
+ * Time computing the forces and energy for a System that contains a single Force.
+ */
+static void benchmarkForce(BenchmarkRunner& runner, const string& name, const Config& config, System& system, const vector<Vec3>& positions) {
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, *config.platform, config.properties);
+    context.setPositions(positions);
+    runner.time(name, config, [&] () {
+        context.getState(State::Forces | State::Energy);
+    });
+}
+
+static void runForceBenchmarks(BenchmarkRunner& runner, const Config& config, const Options& options) {
+    auto include = [&] (const string& name) {
+        return name.find(options.filter) != string::npos;
+    };
+    vector<Vec3> positions;
+    vector<pair<string, NonbondedForce::NonbondedMethod> > nonbondedMethods = {
+        {"NonbondedForce (cutoff)", NonbondedForce::CutoffPeriodic},
+        {"NonbondedForce (PME)", NonbondedForce::PME},
+        {"NonbondedForce (LJPME)", NonbondedForce::LJPME}
+    };
+    for (auto& method : nonbondedMethods) {
+        if (!include(method.first))
+            continue;
+        unique_ptr<System> system(createWaterBox(config.particles, positions));
+        system->addForce(createWaterNonbonded(*system, method.second));
+        benchmarkForce(runner, method.first, config, *system, positions);
+    }
+    if (include("CustomNonbondedForce")) {
+        unique_ptr<System> system(createWaterBox(config.particles, positions));
+        CustomNonbondedForce* force = new CustomNonbondedForce("4*eps*((sigma/r)^12-(sigma/r)^6)+138.935456*q1*q2/r; sigma=0.5*(sigma1+sigma2); eps=sqrt(eps1*eps2)");
+        force->addPerParticleParameter("q");
+        force->addPerParticleParameter("sigma");
+        force->addPerParticleParameter("eps");
+        force->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+        force->setCutoffDistance(getWaterCutoff(*system));
+        for (int i = 0; i < system->getNumParticles(); i += 3) {
+            force->addParticle({-0.834, 0.315, 0.636});
+            force->addParticle({0.417, 1.0, 0.0});
+            force->addParticle({0.417, 1.0, 0.0});
+            force->addExclusion(i, i+1);
+            force->addExclusion(i, i+2);
+            force->addExclusion(i+1, i+2);
+        }
+        system->addForce(force);
+        benchmarkForce(runner, "CustomNonbondedForce", config, *system, positions);
+    }
+    if (include("CustomBondForce")) {
+        unique_ptr<System> system(createChain(config.particles, positions));
+        CustomBondForce* force = new CustomBondForce("k*(r-r0)^2+d*(1-exp(-a*(r-r0)))^2");
+        force->addGlobalParameter("k", 1000.0);
+        force->addPerBondParameter("r0");
+        force->addPerBondParameter("d");
+        force->addPerBondParameter("a");
+        for (int i = 1; i < config.particles; i++)
+            force->addBond(i-1, i, {0.15, 400.0, 20.0});
+        system->addForce(force);
+        benchmarkForce(runner, "CustomBondForce", config, *system, positions);
+    }
+    if (include("HarmonicBondForce")) {
+        unique_ptr<System> system(createChain(config.particles, positions));
+        HarmonicBondForce* force = new HarmonicBondForce();
+        for (int i = 1; i < config.particles; i++)
+            force->addBond(i-1, i, 0.15, 1000.0);
+        system->addForce(force);
+        benchmarkForce(runner, "HarmonicBondForce", config, *system, positions);
+    }
+    if (include("HarmonicAngleForce")) {
+        unique_ptr<System> system(createChain(config.particles, positions));
+        HarmonicAngleForce* force = new HarmonicAngleForce();
+        for (int i = 2; i < config.particles; i++)
+            force->addAngle(i-2, i-1, i, 1.9, 100.0);
+        system->addForce(force);
+        benchmarkForce(runner, "HarmonicAngleForce", config, *system, positions);
+    }
+    if (include("PeriodicTorsionForce")) {
+        unique_ptr<System> system(createChain(config.particles, positions));
+        PeriodicTorsionForce* force = new PeriodicTorsionForce();
+        for (int i = 3; i < config.particles; i++)
+            force->addTorsion(i-3, i-2, i-1, i, 3, 0.0, 5.0);
+        system->addForce(force);
+        benchmarkForce(runner, "PeriodicTorsionForce", config, *system, positions);
+    }
+}
+
+static void runConstraintBenchmarks(BenchmarkRunner& runner, const Config& config, const Options& options) {
+    vector<Vec3> positions;
+    if (string("Constraints (SETTLE)").find(options.filter) != string::npos) {
+        unique_ptr<System> system(createWaterBox(config.particles, positions));
+        vector<Vec3> perturbed = perturbPositions(positions, 0.01);
+        VerletIntegrator integrator(0.001);
+        Context context(*system, integrator, *config.platform, config.properties);
+        runner.time("Constraints (SETTLE)", config, [&] () {
+            context.applyConstraints(1e-5);
+        }, [&] () {
+            context.setPositions(perturbed);
+        });
+    }
+    if (string("Constraints (CCMA)").find(options.filter) != string::npos) {
+        unique_ptr<System> system(createChain(config.particles, positions));
+        for (int i = 1; i < config.particles; i++)
+            system->addConstraint(i-1, i, 0.15);
+        vector<Vec3> perturbed = perturbPositions(positions, 0.01);
+        VerletIntegrator integrator(0.001);
+        Context context(*system, integrator, *config.platform, config.properties);
+        runner.time("Constraints (CCMA)", config, [&] () {
+            context.applyConstraints(1e-5);
+        }, [&] () {
+            context.setPositions(perturbed);
+        });
+    }
+}
+
+static void runIntegratorBenchmarks(BenchmarkRunner& runner, const Config& config, const Options& options) {
+    // Each integrator simulates a box of water with PME.
+
+    const int steps = (options.quick ? 2 : 10);
+    vector<pair<string, function<Integrator*()> > > integrators = {
+        {"VerletIntegrator", [] () {return new VerletIntegrator(0.001);}},
+        {"LangevinMiddleIntegrator", [] () {return new LangevinMiddleIntegrator(300.0, 1.0, 0.001);}},
+        {"NoseHooverIntegrator", [] () {return new NoseHooverIntegrator(300.0, 1.0, 0.001);}},
+        {"CustomIntegrator", [] () {
+            CustomIntegrator* integrator = new CustomIntegrator(0.001);
+            integrator->addPerDofVariable("x1", 0);
+            integrator->addUpdateContextState();
+            integrator->addComputePerDof("v", "v+0.5*dt*f/m");
+            integrator->addComputePerDof("x", "x+dt*v");
+            integrator->addComputePerDof("x1", "x");
+            integrator->addConstrainPositions();
+            integrator->addComputePerDof("v", "v+0.5*dt*f/m+(x-x1)/dt");
+            integrator->addConstrainVelocities();
+            return integrator;
+        }}
+    };
+    vector<Vec3> positions;
+    for (auto& entry : integrators) {
+        if (entry.first.find(options.filter) == string::npos)
+            continue;
+        unique_ptr<System> system(createWaterBox(config.particles, positions));
+        system->addForce(createWaterNonbonded(*system, NonbondedForce::PME));
+        unique_ptr<Integrator> integrator(entry.second());
+        Context context(*system, *integrator, *config.platform, config.properties);
+        context.setPositions(positions);
+        context.setVelocitiesToTemperature(300.0);
+        runner.time(entry.first, config, [&] () {
+            integrator->step(steps);
+        }, nullptr, steps);
+    }
+}
+
+static void runContextBenchmarks(BenchmarkRunner& runner, const Config& config, const Options& options) {
+    if (string("Context creation").find(options.filter) == string::npos)
+        return;
+    vector<Vec3> positions;
+    unique_ptr<System> system(createWaterBox(config.particles, positions));
+    system->addForce(createWaterNonbonded(*system, NonbondedForce::PME));
+    VerletIntegrator integrator(0.001);
+    map<string, vector<double> > phaseTimes;
+    runner.time("Context creation", config, [&] () {
+        Context context(*system, integrator, *config.platform, config.properties);
+        map<string, double> times;
+        context.getStartupTimes(times);
+        for (auto& phase : times)
+            phaseTimes[phase.first].push_back(phase.second);
+    });
+
+    // Report how long each phase of creating the Context took.
+
+    for (auto& phase : phaseTimes)
+        runner.record("Context creation: "+phase.first, config, phase.second);
+}
+
+static void runSerializationBenchmarks(BenchmarkRunner& runner, const Config& config, const Options& options) {
+    vector<Vec3> positions;
+    unique_ptr<System> system(createWaterBox(config.particles, positions));
+    system->addForce(createWaterNonbonded(*system, NonbondedForce::PME));
+    stringstream buffer;
+    XmlSerializer::serialize<System>(system.get(), "System", buffer);
+    string xml = buffer.str();
+    if (string("Serialize System").find(options.filter) != string::npos)
+        runner.time("Serialize System", config, [&] () {
+            stringstream out;
+            XmlSerializer::serialize<System>(system.get(), "System", out);
+        });
+    if (string("Deserialize System").find(options.filter) != string::npos)
+        runner.time("Deserialize System", config, [&] () {
+            stringstream in(xml);
+            delete XmlSerializer::deserialize<System>(in);
+        });
+}
+
+static void runLeptonBenchmarks(BenchmarkRunner& runner, const Config& config, const Options& options) {
+    // Time processing a typical energy expression for a custom force: parsing, optimizing,
+    // differentiating, and compiling it.
+
+    if (string("Lepton expression").find(options.filter) == string::npos)
+        return;
+    string expression = "4*eps*((sigma/r)^12-(sigma/r)^6)+138.935456*q1*q2*(1/r+krf*r^2-crf)*step(cutoff-r); sigma=0.5*(sigma1+sigma2); eps=sqrt(eps1*eps2)";
+    runner.time("Lepton expression", config, [&] () {
+        Lepton::ParsedExpression energy = Lepton::Parser::parse(expression).optimize();
+        Lepton::CompiledExpression force = energy.differentiate("r").optimize().createCompiledExpression();
+    });
+}
+
+// Command line processing.
+
+template <class T>
+static vector<T> parseList(const string& value) {
+    vector<T> result;
+    stringstream stream(value);
+    string item;
+    while (getline(stream, item, ',')) {
+        T element;
+        stringstream(item) >> element;
+        result.push_back(element);
+    }
+    return result;
+}
+
+static Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--quick")
+            options.quick = true;
+        else if (arg == "--list")
+            options.list = true;
+        else if (i+1 == argc)
+            throw OpenMMException("Missing value for option "+arg);
+        else if (arg == "--platforms")
+            options.platforms = parseList<string>(argv[++i]);
+        else if (arg == "--sizes")
+            options.sizes = parseList<int>(argv[++i]);
+        else if (arg == "--threads")
+            options.threads = parseList<int>(argv[++i]);
+        else if (arg == "--filter")
+            options.filter = argv[++i];
+        else if (arg == "--min-time")
+            stringstream(argv[++i]) >> options.minTime;
+        else if (arg == "--plugins")
+            options.pluginDir = argv[++i];
+        else if (arg == "--output")
+            options.output = argv[++i];
+        else
+            throw OpenMMException("Unknown option: "+arg);
+    }
+    if (options.quick) {
+        options.sizes = {600};
+        if (options.threads.empty())
+            options.threads = {2};
+    }
+    if (options.threads.empty()) {
+        options.threads = {1};
+        if (getNumProcessors() > 1)
+            options.threads.push_back(getNumProcessors());
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        Options options = parseOptions(argc, argv);
+        if (options.list) {
+            for (string name : {"NonbondedForce (cutoff)", "NonbondedForce (PME)", "NonbondedForce (LJPME)", "CustomNonbondedForce",
+                    "CustomBondForce", "HarmonicBondForce", "HarmonicAngleForce", "PeriodicTorsionForce", "Constraints (SETTLE)",
+                    "Constraints (CCMA)", "VerletIntegrator", "LangevinMiddleIntegrator", "NoseHooverIntegrator", "CustomIntegrator",
+                    "Context creation", "Serialize System", "Deserialize System", "Lepton expression"})
+                cout << name << endl;
+            return 0;
+        }
+        Platform::loadPluginsFromDirectory(options.pluginDir.empty() ? Platform::getDefaultPluginsDirectory() : options.pluginDir);
+        BenchmarkRunner runner(options);
+        for (string platformName : options.platforms) {
+            Platform* platform;
+            try {
+                platform = &Platform::getPlatformByName(platformName);
+            }
+            catch (const OpenMMException& ex) {
+                cerr << "Skipping unavailable platform " << platformName << endl;
+                continue;
+            }
+            const vector<string>& propertyNames = platform->getPropertyNames();
+            bool setThreads = (find(propertyNames.begin(), propertyNames.end(), "Threads") != propertyNames.end());
+            for (int size : options.sizes)
+                for (int threads : (setThreads ? options.threads : vector<int>{0})) {
+                    Config config;
+                    config.platform = platform;
+                    config.particles = size;
+                    config.threads = threads;
+                    if (setThreads)
+                        config.properties["Threads"] = to_string(threads);
+                    runForceBenchmarks(runner, config, options);
+                    runConstraintBenchmarks(runner, config, options);
+                    runIntegratorBenchmarks(runner, config, options);
+                    runContextBenchmarks(runner, config, options);
+                }
+        }
+
+        // These benchmarks do not depend on the platform.
+
+        Config config;
+        config.platform = NULL;
+        config.threads = 0;
+        for (int size : options.sizes) {
+            config.particles = size;
+            runSerializationBenchmarks(runner, config, options);
+        }
+        config.particles = 0;
+        runLeptonBenchmarks(runner, config, options);
+        if (options.output.empty())
+            runner.writeResults(cout);
+        else {
+            ofstream out(options.output);
+            runner.writeResults(out);
+        }
+    }
+    catch (const exception& e) {
+        cerr << "exception: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -83,6 +83,8 @@ SKIP_METHODS = [('State', 'getPositions'),
                 ('Context',  'getIntegrator'),
                 ('Context',  'createCheckpoint'),
                 ('Context',  'loadCheckpoint'),
+                ('Context',  'getTimingStatistics'),
+                ('Context',  'getStartupTimes'),
                 ('CudaPlatform',),
                 ('HipPlatform',),
                 ('Force',    'Force'),
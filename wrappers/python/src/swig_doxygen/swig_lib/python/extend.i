@@ -126,6 +126,41 @@ Parameters:
     stream << checkpoint;
     self->loadCheckpoint(stream);
   }
+
+  %feature("docstring") getTimingStatistics "Get the timing statistics that have been recorded since timing was enabled or
+resetTimingStatistics() was last called.
+
+Returns: a dict mapping the name of each phase of the computation to a tuple (total time in seconds, number of times executed)
+"
+  PyObject* getTimingStatistics() const {
+    std::map<std::string, double> times;
+    std::map<std::string, int> counts;
+    self->getTimingStatistics(times, counts);
+    PyObject* result = PyDict_New();
+    for (auto& entry : times) {
+      PyObject* value = Py_BuildValue("(di)", entry.second, counts[entry.first]);
+      PyDict_SetItemString(result, entry.first.c_str(), value);
+      Py_DECREF(value);
+    }
+    return result;
+  }
+
+  %feature("docstring") getStartupTimes "Get the wall clock time spent in each phase of creating this Context.  These times are
+always recorded, whether or not timing is enabled.
+
+Returns: a dict mapping the name of each phase to the time in seconds spent in it
+"
+  PyObject* getStartupTimes() const {
+    std::map<std::string, double> times;
+    self->getStartupTimes(times);
+    PyObject* result = PyDict_New();
+    for (auto& entry : times) {
+      PyObject* value = PyFloat_FromDouble(entry.second);
+      PyDict_SetItemString(result, entry.first.c_str(), value);
+      Py_DECREF(value);
+    }
+    return result;
+  }
 }
 
 %extend OpenMM::Integrator {